@@ -0,0 +1,189 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "api/api_dialogs_snapshot.h"
+
+#include "main/main_session.h"
+#include "data/data_session.h"
+#include "storage/localstorage.h"
+#include "storage/serialize_common.h"
+#include "history/history.h"
+
+namespace Api {
+namespace {
+
+constexpr auto kSnapshotVersion = qint32(1);
+
+template <typename Type>
+[[nodiscard]] QByteArray SerializeMtp(const std::optional<Type> &value) {
+	auto result = mtpBuffer();
+	if (value) {
+		value->write(result);
+	}
+	return Serialize::mtpBufferToBytes(result);
+}
+
+[[nodiscard]] QByteArray SerializeSnapshot(
+		const std::optional<MTPmessages_PeerDialogs> &pinned,
+		const std::optional<MTPmessages_Dialogs> &firstSlice) {
+	auto result = QByteArray();
+	{
+		QDataStream stream(&result, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< kSnapshotVersion
+			<< SerializeMtp(pinned)
+			<< SerializeMtp(firstSlice);
+	}
+	return result;
+}
+
+} // namespace
+
+DialogsSnapshot::DialogsSnapshot(not_null<Main::Session*> session)
+: _session(session) {
+}
+
+bool DialogsSnapshot::apply() {
+	if (_applied) {
+		return false;
+	}
+	_applied = true;
+
+	const auto serialized = Local::ReadDialogsSnapshot();
+	if (serialized.isEmpty()) {
+		return false;
+	}
+	QDataStream stream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto version = qint32();
+	auto pinned = QByteArray();
+	auto firstSlice = QByteArray();
+	stream >> version >> pinned >> firstSlice;
+	if (stream.status() != QDataStream::Ok
+		|| version != kSnapshotVersion) {
+		return false;
+	}
+	_pinned = Serialize::readMtp<MTPmessages_PeerDialogs>(
+		Serialize::mtpBufferFromBytes(pinned));
+	_firstSlice = Serialize::readMtp<MTPmessages_Dialogs>(
+		Serialize::mtpBufferFromBytes(firstSlice));
+
+	const auto start = crl::now();
+	applyPinned();
+	applyFirstSlice();
+	_session->data().chatsListChanged(nullptr);
+	DEBUG_LOG(("Dialogs Info: Snapshot applied in %1 ms."
+		).arg(crl::now() - start));
+	return true;
+}
+
+void DialogsSnapshot::applyPinned() {
+	if (!_pinned) {
+		return;
+	}
+	_pinned->match([&](const MTPDmessages_peerDialogs &data) {
+		const auto owner = &_session->data();
+		owner->processUsers(data.vusers());
+		owner->processChats(data.vchats());
+		owner->clearPinnedChats(nullptr);
+		owner->applyDialogs(
+			nullptr,
+			data.vmessages().v,
+			data.vdialogs().v);
+		owner->notifyPinnedDialogsOrderUpdated();
+	});
+}
+
+void DialogsSnapshot::applyFirstSlice() {
+	if (!_firstSlice) {
+		return;
+	}
+	_firstSlice->match([](const MTPDmessages_dialogsNotModified &) {
+	}, [&](const auto &data) {
+		const auto owner = &_session->data();
+		owner->processUsers(data.vusers());
+		owner->processChats(data.vchats());
+		owner->applyDialogs(
+			nullptr,
+			data.vmessages().v,
+			data.vdialogs().v);
+		for (const auto &dialog : data.vdialogs().v) {
+			dialog.match([&](const MTPDdialog &fields) {
+				_unconfirmed.emplace(
+					owner->history(peerFromMTP(fields.vpeer())));
+			}, [](const MTPDdialogFolder &) {
+			});
+		}
+	});
+}
+
+void DialogsSnapshot::rememberPinned(const MTPmessages_PeerDialogs &result) {
+	_pinned = result;
+	save();
+}
+
+void DialogsSnapshot::rememberFirstSlice(const MTPmessages_Dialogs &result) {
+	if (result.type() == mtpc_messages_dialogsNotModified) {
+		return;
+	}
+	dropUnconfirmed(result);
+	_firstSlice = result;
+	save();
+}
+
+void DialogsSnapshot::dropUnconfirmed(const MTPmessages_Dialogs &result) {
+	auto unconfirmed = base::take(_unconfirmed);
+	if (unconfirmed.empty()) {
+		return;
+	}
+	result.match([](const MTPDmessages_dialogsNotModified &) {
+	}, [&](const auto &data) {
+		for (const auto &dialog : data.vdialogs().v) {
+			dialog.match([&](const MTPDdialog &fields) {
+				const auto peerId = peerFromMTP(fields.vpeer());
+				if (const auto history = _session->data().historyLoaded(
+						peerId)) {
+					unconfirmed.remove(history);
+				}
+			}, [](const MTPDdialogFolder &) {
+			});
+		}
+	});
+	for (const auto history : unconfirmed) {
+		// Pinned chats are not in the slice, they are checked separately.
+		if (history->isPinnedDialog()) {
+			continue;
+		}
+		_dropped.emplace(history);
+		_session->data().removeChatListEntry(history);
+		_session->data().chatsListChanged(history->folder());
+	}
+}
+
+void DialogsSnapshot::confirm(not_null<History*> history) {
+	if (_dropped.remove(history)) {
+		history->updateChatListExistence();
+	}
+}
+
+void DialogsSnapshot::save() {
+	// Serializing a full slice takes a while, do it on a worker thread.
+	// Only the newest of the prepared snapshots is written.
+	const auto generation = ++_saveGeneration;
+	const auto weak = base::make_weak(this);
+	crl::async([=, pinned = _pinned, firstSlice = _firstSlice] {
+		auto serialized = SerializeSnapshot(pinned, firstSlice);
+		crl::on_main(weak, [=, serialized = std::move(serialized)] {
+			if (_saveGeneration == generation) {
+				Local::WriteDialogsSnapshot(serialized);
+			}
+		});
+	});
+}
+
+} // namespace Api
@@ -0,0 +1,55 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class History;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Api {
+
+// Keeps the pinned chats and the first slice of the main chats list
+// in local storage, so that the list is painted right after launch
+// and then reconciled by the usual requests to the server.
+class DialogsSnapshot final : public base::has_weak_ptr {
+public:
+	explicit DialogsSnapshot(not_null<Main::Session*> session);
+
+	// Applies the saved snapshot only once, returns false if there was
+	// nothing to apply.
+	bool apply();
+
+	void rememberPinned(const MTPmessages_PeerDialogs &result);
+
+	// Chats from the snapshot that this first server slice
+	// doesn't have are removed from the list until confirmed.
+	void rememberFirstSlice(const MTPmessages_Dialogs &result);
+
+	// Brings back a chat removed after the first slice
+	// if a later slice has it after all.
+	void confirm(not_null<History*> history);
+
+private:
+	void applyPinned();
+	void applyFirstSlice();
+	void dropUnconfirmed(const MTPmessages_Dialogs &result);
+	void save();
+
+	const not_null<Main::Session*> _session;
+	std::optional<MTPmessages_PeerDialogs> _pinned;
+	std::optional<MTPmessages_Dialogs> _firstSlice;
+	base::flat_set<not_null<History*>> _unconfirmed;
+	base::flat_set<not_null<History*>> _dropped;
+	int _saveGeneration = 0;
+	bool _applied = false;
+
+};
+
+} // namespace Api
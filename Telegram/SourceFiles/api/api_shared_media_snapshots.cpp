@@ -0,0 +1,220 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "api/api_shared_media_snapshots.h"
+
+#include "main/main_session.h"
+#include "data/data_peer.h"
+#include "data/data_search_controller.h"
+#include "storage/storage_facade.h"
+#include "storage/storage_shared_media.h"
+#include "storage/localstorage.h"
+#include "storage/serialize_common.h"
+
+namespace Api {
+namespace {
+
+constexpr auto kSnapshotsVersion = qint32(1);
+constexpr auto kSnapshotsLimit = 8;
+
+[[nodiscard]] mtpBuffer SerializeSlice(const MTPmessages_Messages &result) {
+	auto buffer = mtpBuffer();
+	result.match([&](const MTPDmessages_channelMessages &data) {
+		// Don't keep the channel pts, it will be old when applied.
+		MTP_messages_messagesSlice(
+			MTP_flags(0),
+			data.vcount(),
+			MTPint(),
+			data.vmessages(),
+			data.vchats(),
+			data.vusers()
+		).write(buffer);
+	}, [&](const auto &data) {
+		result.write(buffer);
+	});
+	return buffer;
+}
+
+} // namespace
+
+SharedMediaSnapshots::SharedMediaSnapshots(
+	not_null<Main::Session*> session)
+: _session(session) {
+}
+
+bool SharedMediaSnapshots::IsNewestSlice(
+		MsgId messageId,
+		Data::LoadDirection direction) {
+	return (direction == Data::LoadDirection::Around)
+		&& (messageId >= ServerMaxMsgId - 1);
+}
+
+void SharedMediaSnapshots::apply(
+		not_null<PeerData*> peer,
+		Storage::SharedMediaType type,
+		MsgId messageId,
+		Data::LoadDirection direction) {
+	if (!IsNewestSlice(messageId, direction)) {
+		return;
+	}
+	const auto key = Key{ peer->id, type };
+	if (_applied.contains(key)) {
+		return;
+	}
+	_applied.emplace(key);
+	read();
+	const auto i = ranges::find(_entries, key, [](const Entry &entry) {
+		return Key{ entry.peerId, entry.type };
+	});
+	if (i == end(_entries)) {
+		return;
+	}
+	const auto saved = Serialize::readMtp<MTPmessages_Messages>(
+		i->serialized);
+	if (!saved) {
+		_entries.erase(i);
+		save();
+		return;
+	}
+	_unconfirmed.emplace(key, std::vector<MsgId>());
+
+	// The viewer asks for the slice while handling its own update,
+	// so we add the saved slice to the storage a bit later.
+	crl::on_main(this, [=, result = *saved] {
+		const auto i = _unconfirmed.find(key);
+		if (i == end(_unconfirmed)) {
+			// The server slice was already received.
+			return;
+		}
+		auto parsed = ParseSearchResult(
+			peer,
+			type,
+			messageId,
+			direction,
+			result);
+		i->second = parsed.messageIds;
+		_session->storage().add(Storage::SharedMediaAddSlice(
+			peer->id,
+			type,
+			std::move(parsed.messageIds),
+			parsed.noSkipRange,
+			parsed.fullCount));
+	});
+}
+
+void SharedMediaSnapshots::invalidate(
+		not_null<PeerData*> peer,
+		Storage::SharedMediaType type,
+		const std::vector<MsgId> &received) {
+	const auto saved = _unconfirmed.take(Key{ peer->id, type });
+	if (!saved) {
+		return;
+	}
+	for (const auto messageId : *saved) {
+		if (ranges::find(received, messageId) == end(received)) {
+			_session->storage().remove(Storage::SharedMediaRemoveOne(
+				peer->id,
+				type,
+				messageId));
+		}
+	}
+}
+
+void SharedMediaSnapshots::remember(
+		not_null<PeerData*> peer,
+		Storage::SharedMediaType type,
+		MsgId messageId,
+		Data::LoadDirection direction,
+		const MTPmessages_Messages &result) {
+	if (!IsNewestSlice(messageId, direction)
+		|| result.type() == mtpc_messages_messagesNotModified) {
+		return;
+	}
+	read();
+	const auto key = Key{ peer->id, type };
+	_entries.erase(ranges::remove(_entries, key, [](const Entry &entry) {
+		return Key{ entry.peerId, entry.type };
+	}), end(_entries));
+	_entries.insert(
+		begin(_entries),
+		Entry{ peer->id, type, SerializeSlice(result) });
+	if (int(_entries.size()) > kSnapshotsLimit) {
+		_entries.resize(kSnapshotsLimit);
+	}
+	save();
+}
+
+void SharedMediaSnapshots::read() {
+	if (_read) {
+		return;
+	}
+	_read = true;
+
+	const auto serialized = Local::ReadSharedMediaSnapshots();
+	if (serialized.isEmpty()) {
+		return;
+	}
+	QDataStream stream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+	auto version = qint32();
+	auto count = qint32();
+	stream >> version >> count;
+	if (stream.status() != QDataStream::Ok
+		|| version != kSnapshotsVersion
+		|| count < 0
+		|| count > kSnapshotsLimit) {
+		return;
+	}
+	auto entries = std::vector<Entry>();
+	entries.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		auto peerId = quint64();
+		auto type = qint32();
+		auto bytes = QByteArray();
+		stream >> peerId >> type >> bytes;
+		if (stream.status() != QDataStream::Ok) {
+			return;
+		}
+		const auto mediaType = static_cast<Storage::SharedMediaType>(type);
+		if (!Storage::IsValidSharedMediaType(mediaType)) {
+			continue;
+		}
+		entries.push_back({
+			PeerId(peerId),
+			mediaType,
+			Serialize::mtpBufferFromBytes(bytes)
+		});
+	}
+	_entries = std::move(entries);
+}
+
+void SharedMediaSnapshots::save() {
+	// Only the newest of the prepared snapshots is written.
+	const auto generation = ++_saveGeneration;
+	const auto weak = base::make_weak(this);
+	crl::async([=, entries = _entries] {
+		auto serialized = QByteArray();
+		if (!entries.empty()) {
+			QDataStream stream(&serialized, QIODevice::WriteOnly);
+			stream.setVersion(QDataStream::Qt_5_1);
+			stream << kSnapshotsVersion << qint32(entries.size());
+			for (const auto &entry : entries) {
+				stream
+					<< quint64(entry.peerId)
+					<< qint32(entry.type)
+					<< Serialize::mtpBufferToBytes(entry.serialized);
+			}
+		}
+		crl::on_main(weak, [=, serialized = std::move(serialized)] {
+			if (_saveGeneration == generation) {
+				Local::WriteSharedMediaSnapshots(serialized);
+			}
+		});
+	});
+}
+
+} // namespace Api
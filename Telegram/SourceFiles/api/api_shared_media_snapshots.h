@@ -0,0 +1,81 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class PeerData;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Data {
+enum class LoadDirection : char;
+} // namespace Data
+
+namespace Storage {
+enum class SharedMediaType : signed char;
+} // namespace Storage
+
+namespace Api {
+
+// Keeps the newest shared media slice of a few recently opened peers
+// in local storage, so that the media tab is painted right away,
+// while the newest slice is requested from the server as usual.
+class SharedMediaSnapshots final : public base::has_weak_ptr {
+public:
+	explicit SharedMediaSnapshots(not_null<Main::Session*> session);
+
+	[[nodiscard]] static bool IsNewestSlice(
+		MsgId messageId,
+		Data::LoadDirection direction);
+
+	// Adds the saved slice to the storage once for a peer and a type,
+	// until the newest slice from the server replaces it.
+	void apply(
+		not_null<PeerData*> peer,
+		Storage::SharedMediaType type,
+		MsgId messageId,
+		Data::LoadDirection direction);
+
+	// Called with the newest slice from the server before it is added
+	// to the storage. Removes the saved messages that it doesn't have.
+	void invalidate(
+		not_null<PeerData*> peer,
+		Storage::SharedMediaType type,
+		const std::vector<MsgId> &received);
+
+	void remember(
+		not_null<PeerData*> peer,
+		Storage::SharedMediaType type,
+		MsgId messageId,
+		Data::LoadDirection direction,
+		const MTPmessages_Messages &result);
+
+private:
+	struct Entry {
+		PeerId peerId = 0;
+		Storage::SharedMediaType type = Storage::SharedMediaType();
+		mtpBuffer serialized;
+	};
+	using Key = std::pair<PeerId, Storage::SharedMediaType>;
+
+	void read();
+	void save();
+
+	const not_null<Main::Session*> _session;
+	std::vector<Entry> _entries; // Most recently remembered first.
+
+	// Saved message ids that the server didn't confirm yet.
+	base::flat_map<Key, std::vector<MsgId>> _unconfirmed;
+	base::flat_set<Key> _applied;
+	int _saveGeneration = 0;
+	bool _read = false;
+
+};
+
+} // namespace Api
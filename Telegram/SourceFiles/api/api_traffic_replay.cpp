@@ -0,0 +1,138 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "api/api_traffic_replay.h"
+
+#ifdef _DEBUG
+
+#include "mtproto/details/mtproto_traffic_recorder.h"
+#include "mtproto/mtp_instance.h"
+#include "main/main_session.h"
+#include "data/data_session.h"
+#include "history/history.h"
+
+namespace Api {
+namespace {
+
+template <typename Type>
+[[nodiscard]] std::optional<Type> ReadResponse(const mtpBuffer &buffer) {
+	auto result = Type();
+	auto from = buffer.constData();
+	const auto end = from + buffer.size();
+	return result.read(from, end) ? std::make_optional(result) : std::nullopt;
+}
+
+// Responses to requests can't be passed to their handlers offline,
+// so the common lists of messages are applied to Data::Session directly.
+[[nodiscard]] bool ApplyResponse(
+		not_null<Data::Session*> owner,
+		const mtpBuffer &buffer) {
+	switch (mtpTypeId(buffer[0])) {
+	case mtpc_messages_messages:
+	case mtpc_messages_messagesSlice:
+	case mtpc_messages_channelMessages: {
+		const auto result = ReadResponse<MTPmessages_Messages>(buffer);
+		if (!result) {
+			return false;
+		}
+		result->match([](const MTPDmessages_messagesNotModified &) {
+		}, [&](const auto &data) {
+			owner->processUsers(data.vusers());
+			owner->processChats(data.vchats());
+			owner->processMessages(
+				data.vmessages(),
+				NewMessageType::Existing);
+		});
+		return true;
+	} break;
+
+	case mtpc_messages_dialogs:
+	case mtpc_messages_dialogsSlice: {
+		const auto result = ReadResponse<MTPmessages_Dialogs>(buffer);
+		if (!result) {
+			return false;
+		}
+		result->match([](const MTPDmessages_dialogsNotModified &) {
+		}, [&](const auto &data) {
+			owner->processUsers(data.vusers());
+			owner->processChats(data.vchats());
+			owner->processMessages(data.vmessages(), NewMessageType::Last);
+		});
+		return true;
+	} break;
+
+	case mtpc_updates_difference:
+	case mtpc_updates_differenceSlice: {
+		const auto result = ReadResponse<MTPupdates_Difference>(buffer);
+		if (!result) {
+			return false;
+		}
+		const auto apply = [&](const auto &data) {
+			owner->processUsers(data.vusers());
+			owner->processChats(data.vchats());
+			owner->processMessages(
+				data.vnew_messages(),
+				NewMessageType::Unread);
+		};
+		result->match([&](const MTPDupdates_difference &data) {
+			apply(data);
+		}, [&](const MTPDupdates_differenceSlice &data) {
+			apply(data);
+		}, [](const auto &) {
+		});
+		return true;
+	} break;
+	}
+	return false;
+}
+
+} // namespace
+
+void ReplayTraffic(not_null<Main::Session*> session, const QString &path) {
+	if (!cTestMode()) {
+		// The replayed updates and messages would be applied
+		// to the real account data and saved to its local storage.
+		LOG(("Replay Error: Traffic is replayed only in -testmode."));
+		return;
+	}
+	const auto records = MTP::details::ReadTrafficRecords(path);
+	if (!records || records->empty()) {
+		return;
+	}
+	const auto instance = session->mtp();
+	const auto owner = &session->data();
+
+	auto updates = 0;
+	auto responses = 0;
+	auto skipped = 0;
+	const auto started = crl::now();
+	for (const auto &record : *records) {
+		const auto &data = record.data;
+		if (!record.requestId) {
+			instance->globalCallback(
+				data.constData(),
+				data.constData() + data.size());
+			++updates;
+		} else if (ApplyResponse(owner, data)) {
+			++responses;
+		} else {
+			++skipped;
+		}
+	}
+	const auto duration = crl::now() - started;
+	LOG(("Replay Info: %1 updates and %2 responses (%3 skipped) "
+		"recorded in %4 ms processed in %5 ms."
+		).arg(updates
+		).arg(responses
+		).arg(skipped
+		).arg(records->back().time
+		).arg(duration));
+}
+
+} // namespace Api
+
+#endif // _DEBUG
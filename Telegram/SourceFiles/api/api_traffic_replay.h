@@ -0,0 +1,25 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#ifdef _DEBUG
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Api {
+
+// Feeds the traffic recorded with -mtprecord through the usual updates
+// handling and Data::Session and logs how long the processing took.
+// Works only in -testmode, so that a real account is never touched.
+void ReplayTraffic(not_null<Main::Session*> session, const QString &path);
+
+} // namespace Api
+
+#endif // _DEBUG
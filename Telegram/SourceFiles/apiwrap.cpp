@@ -10,6 +10,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "api/api_text_entities.h"
 #include "api/api_self_destruct.h"
 #include "api/api_sensitive_content.h"
+#include "api/api_dialogs_snapshot.h"
+#include "api/api_shared_media_snapshots.h"
 #include "data/data_drafts.h"
 #include "data/data_photo.h"
 #include "data/data_web_page.h"
@@ -88,15 +90,22 @@ constexpr auto kForwardMessagesOnAdd = 100;
 constexpr auto kProxyPromotionInterval = TimeId(60 * 60);
 constexpr auto kProxyPromotionMinDelay = TimeId(10);
 constexpr auto kSmallDelayMs = 5;
+constexpr auto kPeersBatchLimit = 100;
 constexpr auto kUnreadMentionsPreloadIfLess = 5;
 constexpr auto kUnreadMentionsFirstRequestLimit = 10;
 constexpr auto kUnreadMentionsNextRequestLimit = 100;
 constexpr auto kSharedMediaLimit = 100;
+constexpr auto kUserPhotosPreloadCount = 2;
 //constexpr auto kFeedMessagesLimit = 50; // #feed
 constexpr auto kReadFeaturedSetsTimeout = crl::time(1000);
+constexpr auto kMarkMediaReadDelay = crl::time(500);
+constexpr auto kDeleteMessagesLimit = 100;
 constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
+constexpr auto kFileLoaderWorkersLimit = 4;
 //constexpr auto kFeedReadTimeout = crl::time(1000); // #feed
 constexpr auto kStickersByEmojiInvalidateTimeout = crl::time(60 * 60 * 1000);
+constexpr auto kStickerSetCacheTimeout = crl::time(60 * 1000);
+constexpr auto kStickerSetCacheLimit = 16;
 constexpr auto kNotifySettingSaveTimeout = crl::time(1000);
 constexpr auto kDialogsFirstLoad = 20;
 constexpr auto kDialogsPerPage = 500;
@@ -228,16 +237,25 @@ ApiWrap::ApiWrap(not_null<Main::Session*> session)
 : MTP::Sender(session->account().mtp())
 , _session(session)
 , _messageDataResolveDelayed([=] { resolveMessageDatas(); })
+, _peersResolveDelayed([=] { resolvePeers(); })
 , _webPagesTimer([=] { resolveWebPages(); })
+, _markMediaReadTimer([=] { sendMarkMediaRead(); })
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
-, _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
+, _fileLoader(std::make_unique<TaskQueue>(
+	kFileLoaderQueueStopTimeout,
+	QThread::InheritPriority,
+	std::clamp(QThread::idealThreadCount(), 1, kFileLoaderWorkersLimit)))
 //, _feedReadTimer([=] { readFeeds(); }) // #feed
 , _proxyPromotionTimer([=] { refreshProxyPromotion(); })
 , _updateNotifySettingsTimer([=] { sendNotifySettingsUpdates(); })
 , _selfDestruct(std::make_unique<Api::SelfDestruct>(this))
-, _sensitiveContent(std::make_unique<Api::SensitiveContent>(this)) {
+, _sensitiveContent(std::make_unique<Api::SensitiveContent>(this))
+, _dialogsSnapshot(std::make_unique<Api::DialogsSnapshot>(session))
+, _sharedMediaSnapshots(
+	std::make_unique<Api::SharedMediaSnapshots>(session))
+, _pollReloadsResolveDelayed([=] { resolvePollReloads(); }) {
 	crl::on_main([=] {
 		// You can't use _session->lifetime() in the constructor,
 		// only queued, because it is not constructed yet.
@@ -246,6 +264,12 @@ ApiWrap::ApiWrap(not_null<Main::Session*> session)
 			photoUploadReady(data.fullId, data.file);
 		}, _session->lifetime());
 
+		_session->data().stickersUpdated(
+		) | rpl::start_with_next([=] {
+			// Cached results carry the installed / archived flags.
+			_stickerSetFullCache.clear();
+		}, _session->lifetime());
+
 		setupSupportMode();
 	});
 }
@@ -785,6 +809,12 @@ void ApiWrap::requestContacts() {
 void ApiWrap::requestDialogs(Data::Folder *folder) {
 	if (folder && !_foldersLoadState.contains(folder)) {
 		_foldersLoadState.emplace(folder, DialogsLoadState());
+	} else if (!folder
+		&& _dialogsLoadState
+		&& !_dialogsLoadState->offsetDate
+		&& !_dialogsLoadState->requestId) {
+		// Paint the chats list from disk while the first slice loads.
+		_dialogsSnapshot->apply();
 	}
 	requestMoreDialogs(folder);
 }
@@ -814,7 +844,10 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 			: MTP_inputPeerEmpty()),
 		MTP_int(loadCount),
 		MTP_int(hash)
-	)).done([=](const MTPmessages_Dialogs &result) {
+	)).parseInBackground().done([=](const MTPmessages_Dialogs &result) {
+		if (!folder && firstLoad) {
+			_dialogsSnapshot->rememberFirstSlice(result);
+		}
 		const auto state = dialogsLoadState(folder);
 		const auto count = result.match([](
 				const MTPDmessages_dialogsNotModified &) {
@@ -968,6 +1001,9 @@ void ApiWrap::requestPinnedDialogs(Data::Folder *folder) {
 		MTP_int(folder ? folder->id() : 0)
 	)).done([=](const MTPmessages_PeerDialogs &result) {
 		finalize();
+		if (!folder) {
+			_dialogsSnapshot->rememberPinned(result);
+		}
 		result.match([&](const MTPDmessages_peerDialogs &data) {
 			_session->data().processUsers(data.vusers());
 			_session->data().processChats(data.vchats());
@@ -1088,6 +1124,7 @@ void ApiWrap::sendDialogRequests() {
 
 void ApiWrap::dialogEntryApplied(not_null<History*> history) {
 	history->dialogEntryApplied();
+	_dialogsSnapshot->confirm(history);
 	if (const auto callbacks = _dialogRequestsPending.take(history)) {
 		for (const auto &callback : *callbacks) {
 			callback();
@@ -1312,38 +1349,145 @@ void ApiWrap::requestPeer(not_null<PeerData*> peer) {
 	if (_fullPeerRequests.contains(peer) || _peerRequests.contains(peer)) {
 		return;
 	}
+	_peerRequests.insert(peer, 0);
+	_peersResolveDelayed.call();
+}
 
-	const auto requestId = [&] {
-		const auto failHandler = [=](const RPCError &error) {
-			_peerRequests.remove(peer);
-		};
-		const auto chatHandler = [=](const MTPmessages_Chats &result) {
-			_peerRequests.remove(peer);
-			const auto &chats = result.match([](const auto &data) {
-				return data.vchats();
-			});
-			_session->data().applyMaximumChatVersions(chats);
-			_session->data().processChats(chats);
-		};
+void ApiWrap::resolvePeers() {
+	auto peers = std::vector<not_null<PeerData*>>();
+	for (auto i = _peerRequests.cbegin(); i != _peerRequests.cend(); ++i) {
+		if (!i.value()) {
+			peers.push_back(i.key());
+		}
+	}
+	if (!peers.empty()) {
+		requestPeers(peers, kPeersBatchLimit);
+	}
+}
+
+void ApiWrap::requestPeers(
+		const std::vector<not_null<PeerData*>> &peers,
+		int batchLimit) {
+	auto users = std::vector<not_null<UserData*>>();
+	auto chats = std::vector<not_null<ChatData*>>();
+	auto channels = std::vector<not_null<ChannelData*>>();
+	for (const auto peer : peers) {
 		if (const auto user = peer->asUser()) {
-			return request(MTPusers_GetUsers(
-				MTP_vector<MTPInputUser>(1, user->inputUser)
-			)).done([=](const MTPVector<MTPUser> &result) {
-				_peerRequests.remove(user);
-				_session->data().processUsers(result);
-			}).fail(failHandler).send();
+			users.push_back(user);
 		} else if (const auto chat = peer->asChat()) {
-			return request(MTPmessages_GetChats(
-				MTP_vector<MTPint>(1, chat->inputChat)
-			)).done(chatHandler).fail(failHandler).send();
+			chats.push_back(chat);
 		} else if (const auto channel = peer->asChannel()) {
-			return request(MTPchannels_GetChannels(
-				MTP_vector<MTPInputChannel>(1, channel->inputChannel)
-			)).done(chatHandler).fail(failHandler).send();
+			channels.push_back(channel);
+		} else {
+			Unexpected("Peer type in requestPeers.");
 		}
-		Unexpected("Peer type in requestPeer.");
-	}();
-	_peerRequests.insert(peer, requestId);
+	}
+
+	const auto sendBatched = [&](const auto &peers, auto send) {
+		for (auto from = begin(peers); from != end(peers);) {
+			const auto left = int(end(peers) - from);
+			const auto till = from + std::min(left, batchLimit);
+			const auto requestId = send(from, till);
+			auto &batch = _peerRequestsById[requestId];
+			batch.reserve(till - from);
+			for (auto i = from; i != till; ++i) {
+				_peerRequests[i->get()] = requestId;
+				batch.push_back(i->get());
+			}
+			from = till;
+		}
+	};
+	const auto failHandler = [=](
+			const RPCError &error,
+			mtpRequestId requestId) {
+		peerRequestFailed(error, requestId);
+	};
+	const auto chatsHandler = [=](
+			const MTPmessages_Chats &result,
+			mtpRequestId requestId) {
+		finalizePeerRequest(requestId);
+		const auto &chats = result.match([](const auto &data) {
+			return data.vchats();
+		});
+		_session->data().applyMaximumChatVersions(chats);
+		_session->data().processChats(chats);
+	};
+	sendBatched(users, [&](auto from, auto till) {
+		auto list = QVector<MTPInputUser>();
+		list.reserve(till - from);
+		for (auto i = from; i != till; ++i) {
+			list.push_back((*i)->inputUser);
+		}
+		return request(MTPusers_GetUsers(
+			MTP_vector<MTPInputUser>(list)
+		)).done([=](
+				const MTPVector<MTPUser> &result,
+				mtpRequestId requestId) {
+			finalizePeerRequest(requestId);
+			_session->data().processUsers(result);
+		}).fail(failHandler).send();
+	});
+	sendBatched(chats, [&](auto from, auto till) {
+		auto list = QVector<MTPint>();
+		list.reserve(till - from);
+		for (auto i = from; i != till; ++i) {
+			list.push_back((*i)->inputChat);
+		}
+		return request(MTPmessages_GetChats(
+			MTP_vector<MTPint>(list)
+		)).done(chatsHandler).fail(failHandler).send();
+	});
+	sendBatched(channels, [&](auto from, auto till) {
+		auto list = QVector<MTPInputChannel>();
+		list.reserve(till - from);
+		for (auto i = from; i != till; ++i) {
+			list.push_back((*i)->inputChannel);
+		}
+		return request(MTPchannels_GetChannels(
+			MTP_vector<MTPInputChannel>(list)
+		)).done(chatsHandler).fail(failHandler).send();
+	});
+	DEBUG_LOG(("API Info: Requested peers in batches, "
+		"users: %1, chats: %2, channels: %3."
+		).arg(users.size()
+		).arg(chats.size()
+		).arg(channels.size()));
+}
+
+void ApiWrap::peerRequestFailed(
+		const RPCError &error,
+		mtpRequestId requestId) {
+	const auto i = _peerRequestsById.find(requestId);
+	if (i == end(_peerRequestsById)) {
+		return;
+	} else if (i->second.size() > 1) {
+		// One bad peer fails the whole batch, so ask for each one alone.
+		const auto peers = std::move(i->second);
+		_peerRequestsById.erase(i);
+		requestPeers(peers, 1);
+		return;
+	}
+	const auto peers = i->second;
+	finalizePeerRequest(requestId);
+	for (const auto peer : peers) {
+		LOG(("API Error: Could not request peer %1, error: %2."
+			).arg(peer->id
+			).arg(error.type()));
+	}
+}
+
+void ApiWrap::finalizePeerRequest(mtpRequestId requestId) {
+	const auto i = _peerRequestsById.find(requestId);
+	if (i == end(_peerRequestsById)) {
+		return;
+	}
+	for (const auto peer : i->second) {
+		const auto j = _peerRequests.find(peer.get());
+		if (j != _peerRequests.end() && j.value() == requestId) {
+			_peerRequests.erase(j);
+		}
+	}
+	_peerRequestsById.erase(i);
 }
 
 void ApiWrap::requestPeerSettings(not_null<PeerData*> peer) {
@@ -1452,42 +1596,16 @@ void ApiWrap::migrateFail(not_null<PeerData*> peer, const RPCError &error) {
 
 void ApiWrap::markMediaRead(
 		const base::flat_set<not_null<HistoryItem*>> &items) {
-	auto markedIds = QVector<MTPint>();
-	auto channelMarkedIds = base::flat_map<
-		not_null<ChannelData*>,
-		QVector<MTPint>>();
-	markedIds.reserve(items.size());
 	for (const auto item : items) {
-		if ((!item->isUnreadMedia() || item->out())
-			&& !item->isUnreadMention()) {
-			continue;
-		}
-		item->markMediaRead();
-		if (!IsServerMsgId(item->id)) {
-			continue;
-		}
-		if (const auto channel = item->history()->peer->asChannel()) {
-			channelMarkedIds[channel].push_back(MTP_int(item->id));
-		} else {
-			markedIds.push_back(MTP_int(item->id));
-		}
-	}
-	if (!markedIds.isEmpty()) {
-		request(MTPmessages_ReadMessageContents(
-			MTP_vector<MTPint>(markedIds)
-		)).done([=](const MTPmessages_AffectedMessages &result) {
-			applyAffectedMessages(result);
-		}).send();
-	}
-	for (const auto &channelIds : channelMarkedIds) {
-		request(MTPchannels_ReadMessageContents(
-			channelIds.first->inputChannel,
-			MTP_vector<MTPint>(channelIds.second)
-		)).send();
+		markMediaReadDelayed(item);
 	}
 }
 
 void ApiWrap::markMediaRead(not_null<HistoryItem*> item) {
+	markMediaReadDelayed(item);
+}
+
+void ApiWrap::markMediaReadDelayed(not_null<HistoryItem*> item) {
 	if ((!item->isUnreadMedia() || item->out())
 		&& !item->isUnreadMention()) {
 		return;
@@ -1496,18 +1614,48 @@ void ApiWrap::markMediaRead(not_null<HistoryItem*> item) {
 	if (!IsServerMsgId(item->id)) {
 		return;
 	}
-	const auto ids = MTP_vector<MTPint>(1, MTP_int(item->id));
+
+	// Mentions are read while painting, collect the ids of all the
+	// messages read while scrolling and send them in a single request.
 	if (const auto channel = item->history()->peer->asChannel()) {
-		request(MTPchannels_ReadMessageContents(
-			channel->inputChannel,
-			ids
-		)).send();
+		_markMediaReadChannelIds[channel].push_back(MTP_int(item->id));
 	} else {
-		request(MTPmessages_ReadMessageContents(
-			ids
-		)).done([=](const MTPmessages_AffectedMessages &result) {
+		_markMediaReadIds.push_back(MTP_int(item->id));
+	}
+	if (!_markMediaReadTimer.isActive()) {
+		_markMediaReadTimer.callOnce(kMarkMediaReadDelay);
+	}
+}
+
+void ApiWrap::sendMarkMediaRead() {
+	_markMediaReadTimer.cancel();
+
+	// The requests are tracked, so that quitting waits for them.
+	const auto finished = [=](mtpRequestId requestId) {
+		_markMediaReadRequests.remove(requestId);
+		checkQuitPreventFinished();
+	};
+	if (!_markMediaReadIds.isEmpty()) {
+		_markMediaReadRequests.emplace(request(MTPmessages_ReadMessageContents(
+			MTP_vector<MTPint>(base::take(_markMediaReadIds))
+		)).done([=](
+				const MTPmessages_AffectedMessages &result,
+				mtpRequestId requestId) {
 			applyAffectedMessages(result);
-		}).send();
+			finished(requestId);
+		}).fail([=](const RPCError &error, mtpRequestId requestId) {
+			finished(requestId);
+		}).send());
+	}
+	for (auto &[channel, ids] : base::take(_markMediaReadChannelIds)) {
+		_markMediaReadRequests.emplace(request(MTPchannels_ReadMessageContents(
+			channel->inputChannel,
+			MTP_vector<MTPint>(std::move(ids))
+		)).done([=](const MTPBool &result, mtpRequestId requestId) {
+			finished(requestId);
+		}).fail([=](const RPCError &error, mtpRequestId requestId) {
+			finished(requestId);
+		}).send());
 	}
 }
 
@@ -1970,6 +2118,94 @@ void ApiWrap::requestStickerSets() {
 	}
 }
 
+void ApiWrap::requestStickerSet(
+		const MTPInputStickerSet &set,
+		Fn<void(const MTPmessages_StickerSet &)> done,
+		Fn<void(const RPCError &)> fail) {
+	const auto key = set.match([](const MTPDinputStickerSetID &data) {
+		return "id:" + QString::number(data.vid().v);
+	}, [](const MTPDinputStickerSetShortName &data) {
+		return "name:" + qs(data.vshort_name()).toLower();
+	}, [](const auto &) {
+		return QString();
+	});
+	if (key.isEmpty()) {
+		request(MTPmessages_GetStickerSet(
+			set
+		)).done([=](const MTPmessages_StickerSet &result) {
+			if (done) done(result);
+		}).fail([=](const RPCError &error) {
+			if (fail) fail(error);
+		}).send();
+		return;
+	}
+
+	const auto now = crl::now();
+	const auto cached = _stickerSetFullCache.find(key);
+	if (cached != end(_stickerSetFullCache)) {
+		if (now - cached->second.received < kStickerSetCacheTimeout) {
+			const auto result = cached->second.result;
+			if (done) done(result);
+			return;
+		}
+		_stickerSetFullCache.erase(cached);
+	}
+
+	auto &pending = _stickerSetFullRequests[key];
+	if (done) {
+		pending.done.push_back(std::move(done));
+	}
+	if (fail) {
+		pending.fail.push_back(std::move(fail));
+	}
+	if (pending.requestId) {
+		return;
+	}
+	const auto finish = [=] {
+		const auto i = _stickerSetFullRequests.find(key);
+		if (i == end(_stickerSetFullRequests)) {
+			return StickerSetFullRequest();
+		}
+		auto result = std::move(i->second);
+		_stickerSetFullRequests.erase(i);
+		return result;
+	};
+	pending.requestId = request(MTPmessages_GetStickerSet(
+		set
+	)).done([=](const MTPmessages_StickerSet &result) {
+		cacheStickerSet(key, result);
+		for (const auto &callback : finish().done) {
+			callback(result);
+		}
+	}).fail([=](const RPCError &error) {
+		for (const auto &callback : finish().fail) {
+			callback(error);
+		}
+	}).send();
+}
+
+void ApiWrap::cacheStickerSet(
+		const QString &key,
+		const MTPmessages_StickerSet &result) {
+	const auto now = crl::now();
+	auto &cache = _stickerSetFullCache;
+	cache.remove(key);
+	for (auto i = begin(cache); i != end(cache);) {
+		if (now - i->second.received >= kStickerSetCacheTimeout) {
+			i = cache.erase(i);
+		} else {
+			++i;
+		}
+	}
+	if (int(cache.size()) >= kStickerSetCacheLimit) {
+		cache.erase(ranges::min_element(
+			cache,
+			ranges::less(),
+			[](const auto &pair) { return pair.second.received; }));
+	}
+	cache.emplace(key, StickerSetFullCached{ result, now });
+}
+
 void ApiWrap::saveStickerSets(
 		const Stickers::Order &localOrder,
 		const Stickers::Order &localRemoved) {
@@ -2531,17 +2767,29 @@ void ApiWrap::deleteMessages(
 			history->requestChatListMessage();
 		}
 	};
-	if (const auto channel = peer->asChannel()) {
-		request(MTPchannels_DeleteMessages(
-			channel->inputChannel,
-			MTP_vector<MTPint>(ids)
-		)).done(done).send();
-	} else {
-		using Flag = MTPmessages_DeleteMessages::Flag;
-		request(MTPmessages_DeleteMessages(
-			MTP_flags(revoke ? Flag::f_revoke : Flag(0)),
-			MTP_vector<MTPint>(ids)
-		)).done(done).send();
+	const auto send = [&](const QVector<MTPint> &chunk) {
+		if (const auto channel = peer->asChannel()) {
+			request(MTPchannels_DeleteMessages(
+				channel->inputChannel,
+				MTP_vector<MTPint>(chunk)
+			)).done(done).send();
+		} else {
+			using Flag = MTPmessages_DeleteMessages::Flag;
+			request(MTPmessages_DeleteMessages(
+				MTP_flags(revoke ? Flag::f_revoke : Flag(0)),
+				MTP_vector<MTPint>(chunk)
+			)).done(done).send();
+		}
+	};
+	if (ids.size() <= kDeleteMessagesLimit) {
+		send(ids);
+		return;
+	}
+
+	// The server deletes at most kDeleteMessagesLimit messages at once,
+	// all the chunks are sent right away and go in one container.
+	for (auto i = 0; i < ids.size(); i += kDeleteMessagesLimit) {
+		send(ids.mid(i, kDeleteMessagesLimit));
 	}
 }
 
@@ -2618,16 +2866,19 @@ void ApiWrap::saveDraftsToCloud() {
 }
 
 bool ApiWrap::isQuitPrevent() {
-	if (_draftsSaveRequestIds.empty()) {
+	if (_markMediaReadTimer.isActive()) {
+		sendMarkMediaRead();
+	}
+	if (_draftsSaveRequestIds.empty() && _markMediaReadRequests.empty()) {
 		return false;
 	}
-	LOG(("ApiWrap prevents quit, saving drafts..."));
+	LOG(("ApiWrap prevents quit, saving drafts and read contents..."));
 	saveDraftsToCloud();
 	return true;
 }
 
 void ApiWrap::checkQuitPreventFinished() {
-	if (_draftsSaveRequestIds.empty()) {
+	if (_draftsSaveRequestIds.empty() && _markMediaReadRequests.empty()) {
 		if (App::quitting()) {
 			LOG(("ApiWrap doesn't prevent quit any more."));
 		}
@@ -3083,6 +3334,10 @@ void ApiWrap::refreshFileReference(
 				MTP_long(data.themeId),
 				MTP_long(data.accessHash)),
 			MTP_long(0)));
+	}, [&](Data::FileOriginWebPage data) {
+		request(MTPmessages_GetWebPage(
+			MTP_string(data.url),
+			MTP_int(0)));
 	}, [&](std::nullopt_t) {
 		fail();
 	});
@@ -4042,6 +4297,7 @@ void ApiWrap::requestSharedMedia(
 	if (_sharedMediaRequests.contains(key)) {
 		return;
 	}
+	_sharedMediaSnapshots->apply(peer, type, messageId, slice);
 
 	auto prepared = Api::PrepareSearchRequest(
 		peer,
@@ -4078,6 +4334,9 @@ void ApiWrap::sharedMediaDone(
 		messageId,
 		slice,
 		result);
+	if (Api::SharedMediaSnapshots::IsNewestSlice(messageId, slice)) {
+		_sharedMediaSnapshots->invalidate(peer, type, parsed.messageIds);
+	}
 	_session->storage().add(Storage::SharedMediaAddSlice(
 		peer->id,
 		type,
@@ -4085,6 +4344,7 @@ void ApiWrap::sharedMediaDone(
 		parsed.noSkipRange,
 		parsed.fullCount
 	));
+	_sharedMediaSnapshots->remember(peer, type, messageId, slice, result);
 }
 
 void ApiWrap::requestUserPhotos(
@@ -4106,10 +4366,20 @@ void ApiWrap::requestUserPhotos(
 		userPhotosDone(user, afterId, result);
 	}).fail([this, user](const RPCError &error) {
 		_userPhotosRequests.remove(user);
+		_userPhotosPreloadPending.remove(user);
 	}).send();
 	_userPhotosRequests.emplace(user, requestId);
 }
 
+void ApiWrap::preloadUserPhotos(not_null<UserData*> user) {
+	if (!user->userpicPhotoId() || _userPhotosPreloaded.contains(user)) {
+		return;
+	}
+	_userPhotosPreloaded.emplace(user);
+	_userPhotosPreloadPending.emplace(user);
+	requestUserPhotos(user, 0);
+}
+
 void ApiWrap::userPhotosDone(
 		not_null<UserData*> user,
 		PhotoId photoId,
@@ -4141,6 +4411,19 @@ void ApiWrap::userPhotosDone(
 			photoIds.push_back(photoData->id);
 		}
 	}
+	if (!photoId && _userPhotosPreloadPending.contains(user)) {
+		// Opening the first photos in the media viewer should be instant.
+		// Only thumbnails are loaded, full photos are loaded on demand.
+		_userPhotosPreloadPending.remove(user);
+		const auto count = std::min(
+			int(photoIds.size()),
+			kUserPhotosPreloadCount);
+		for (auto i = 0; i != count; ++i) {
+			const auto id = photoIds[i];
+			_session->data().photo(id)->loadThumbnail(
+				Data::FileOriginUserPhoto(user->bareId(), id));
+		}
+	}
 	_session->storage().add(Storage::UserPhotosAddSlice(
 		user->id,
 		std::move(photoIds),
@@ -5945,16 +6228,91 @@ void ApiWrap::reloadPollResults(not_null<HistoryItem*> item) {
 		|| _pollReloadRequestIds.contains(itemId)) {
 		return;
 	}
-	const auto requestId = request(MTPmessages_GetPollResults(
-		item->history()->peer->input,
-		MTP_int(item->id)
-	)).done([=](const MTPUpdates &result) {
-		_pollReloadRequestIds.erase(itemId);
-		applyUpdates(result);
-	}).fail([=](const RPCError &error) {
-		_pollReloadRequestIds.erase(itemId);
-	}).send();
-	_pollReloadRequestIds.emplace(itemId, requestId);
+	_pollReloadRequestIds.emplace(itemId, 0);
+	_pollReloadsResolveDelayed.call();
+}
+
+void ApiWrap::resolvePollReloads() {
+	// messages.getPollResults takes a single message, while getMessages
+	// returns the polls with their results for all the visible ones.
+	auto ids = base::flat_map<ChannelData*, QVector<MTPInputMessage>>();
+	for (auto i = begin(_pollReloadRequestIds)
+		; i != end(_pollReloadRequestIds);) {
+		if (i->second) {
+			++i;
+		} else if (const auto item = _session->data().message(i->first)) {
+			ids[item->history()->peer->asChannel()].push_back(
+				MTP_inputMessageID(MTP_int(item->id)));
+			++i;
+		} else {
+			i = _pollReloadRequestIds.erase(i);
+		}
+	}
+	for (const auto &[key, list] : ids) {
+		const auto channel = key;
+		const auto done = [=](
+				const MTPmessages_Messages &result,
+				mtpRequestId requestId) {
+			gotPollReloads(channel, result);
+			finalizePollReloads(requestId);
+		};
+		const auto fail = [=](const RPCError &error, mtpRequestId requestId) {
+			finalizePollReloads(requestId);
+		};
+		const auto requestId = channel
+			? request(MTPchannels_GetMessages(
+				channel->inputChannel,
+				MTP_vector<MTPInputMessage>(list)
+			)).done(done).fail(fail).afterDelay(kSmallDelayMs).send()
+			: request(MTPmessages_GetMessages(
+				MTP_vector<MTPInputMessage>(list)
+			)).done(done).fail(fail).afterDelay(kSmallDelayMs).send();
+		const auto channelId = channel ? channel->bareId() : NoChannel;
+		for (auto &[itemId, id] : _pollReloadRequestIds) {
+			if (!id && itemId.channel == channelId) {
+				id = requestId;
+			}
+		}
+	}
+}
+
+void ApiWrap::gotPollReloads(
+		ChannelData *channel,
+		const MTPmessages_Messages &result) {
+	const auto apply = [&](const auto &data) {
+		_session->data().processUsers(data.vusers());
+		_session->data().processChats(data.vchats());
+		for (const auto &message : data.vmessages().v) {
+			message.match([&](const MTPDmessage &data) {
+				const auto media = data.vmedia();
+				if (media && media->type() == mtpc_messageMediaPoll) {
+					_session->data().processPoll(
+						media->c_messageMediaPoll());
+				}
+			}, [](const auto &) {
+			});
+		}
+	};
+	result.match([&](const MTPDmessages_channelMessages &data) {
+		if (channel) {
+			channel->ptsReceived(data.vpts().v);
+		}
+		apply(data);
+	}, [](const MTPDmessages_messagesNotModified &) {
+	}, [&](const auto &data) {
+		apply(data);
+	});
+}
+
+void ApiWrap::finalizePollReloads(mtpRequestId requestId) {
+	for (auto i = begin(_pollReloadRequestIds)
+		; i != end(_pollReloadRequestIds);) {
+		if (i->second == requestId) {
+			i = _pollReloadRequestIds.erase(i);
+		} else {
+			++i;
+		}
+	}
 }
 
 void ApiWrap::readServerHistory(not_null<History*> history) {
@@ -85,6 +85,8 @@ QString RequestKey(Types &&...values) {
 
 class SelfDestruct;
 class SensitiveContent;
+class DialogsSnapshot;
+class SharedMediaSnapshots;
 
 } // namespace Api
 
@@ -263,6 +265,13 @@ public:
 	void requestAttachedStickerSets(not_null<PhotoData*> photo);
 	void scheduleStickerSetRequest(uint64 setId, uint64 access);
 	void requestStickerSets();
+
+	// Identical concurrent requests share one messages.getStickerSet
+	// and the result is reused for a short time or until stickers change.
+	void requestStickerSet(
+		const MTPInputStickerSet &set,
+		Fn<void(const MTPmessages_StickerSet &)> done,
+		Fn<void(const RPCError &)> fail = nullptr);
 	void saveStickerSets(
 		const Stickers::Order &localOrder,
 		const Stickers::Order &localRemoved);
@@ -339,6 +348,7 @@ public:
 	void requestUserPhotos(
 		not_null<UserData*> user,
 		PhotoId afterId);
+	void preloadUserPhotos(not_null<UserData*> user);
 
 	//void requestFeedChannels( // #feed
 	//	not_null<Data::Feed*> feed);
@@ -524,6 +534,17 @@ private:
 	void saveDraftsToCloud();
 
 	void resolveMessageDatas();
+	void resolvePollReloads();
+	void gotPollReloads(
+		ChannelData *channel,
+		const MTPmessages_Messages &result);
+	void finalizePollReloads(mtpRequestId requestId);
+	void resolvePeers();
+	void requestPeers(
+		const std::vector<not_null<PeerData*>> &peers,
+		int batchLimit);
+	void peerRequestFailed(const RPCError &error, mtpRequestId requestId);
+	void finalizePeerRequest(mtpRequestId requestId);
 	void gotMessageDatas(ChannelData *channel, const MTPmessages_Messages &result, mtpRequestId requestId);
 	void finalizeMessageDataRequest(
 		ChannelData *channel,
@@ -550,11 +571,16 @@ private:
 		int availableCount,
 		const QVector<MTPChannelParticipant> &list);
 	void resolveWebPages();
+	void markMediaReadDelayed(not_null<HistoryItem*> item);
+	void sendMarkMediaRead();
 	void gotWebPages(
 		ChannelData *channel,
 		const MTPmessages_Messages &result,
 		mtpRequestId req);
 	void gotStickerSet(uint64 setId, const MTPmessages_StickerSet &result);
+	void cacheStickerSet(
+		const QString &key,
+		const MTPmessages_StickerSet &result);
 
 	void channelRangeDifferenceSend(
 		not_null<ChannelData*> channel,
@@ -698,6 +724,10 @@ private:
 	using PeerRequests = QMap<PeerData*, mtpRequestId>;
 	PeerRequests _fullPeerRequests;
 	PeerRequests _peerRequests;
+	base::flat_map<
+		mtpRequestId,
+		std::vector<not_null<PeerData*>>> _peerRequestsById;
+	SingleQueuedInvokation _peersResolveDelayed;
 	base::flat_set<not_null<PeerData*>> _requestedPeerSettings;
 
 	PeerRequests _participantsRequests;
@@ -727,8 +757,27 @@ private:
 	QMap<WebPageData*, mtpRequestId> _webPagesPending;
 	base::Timer _webPagesTimer;
 
+	QVector<MTPint> _markMediaReadIds;
+	base::flat_map<
+		not_null<ChannelData*>,
+		QVector<MTPint>> _markMediaReadChannelIds;
+	base::flat_set<mtpRequestId> _markMediaReadRequests;
+	base::Timer _markMediaReadTimer;
+
 	QMap<uint64, QPair<uint64, mtpRequestId> > _stickerSetRequests;
 
+	struct StickerSetFullRequest {
+		mtpRequestId requestId = 0;
+		std::vector<Fn<void(const MTPmessages_StickerSet &)>> done;
+		std::vector<Fn<void(const RPCError &)>> fail;
+	};
+	struct StickerSetFullCached {
+		MTPmessages_StickerSet result;
+		crl::time received = 0;
+	};
+	base::flat_map<QString, StickerSetFullRequest> _stickerSetFullRequests;
+	base::flat_map<QString, StickerSetFullCached> _stickerSetFullCache;
+
 	QMap<ChannelData*, mtpRequestId> _channelAmInRequests;
 	base::flat_map<not_null<UserData*>, mtpRequestId> _blockRequests;
 	base::flat_map<not_null<PeerData*>, mtpRequestId> _exportInviteRequests;
@@ -774,6 +823,8 @@ private:
 		SliceType>, mtpRequestId> _sharedMediaRequests;
 
 	base::flat_map<not_null<UserData*>, mtpRequestId> _userPhotosRequests;
+	base::flat_set<not_null<UserData*>> _userPhotosPreloaded;
+	base::flat_set<not_null<UserData*>> _userPhotosPreloadPending;
 
 	//base::flat_set<not_null<Data::Feed*>> _feedChannelsGetRequests; // #feed
 	//base::flat_map<
@@ -875,10 +926,13 @@ private:
 
 	const std::unique_ptr<Api::SelfDestruct> _selfDestruct;
 	const std::unique_ptr<Api::SensitiveContent> _sensitiveContent;
+	const std::unique_ptr<Api::DialogsSnapshot> _dialogsSnapshot;
+	const std::unique_ptr<Api::SharedMediaSnapshots> _sharedMediaSnapshots;
 
 	base::flat_map<FullMsgId, mtpRequestId> _pollVotesRequestIds;
 	base::flat_map<FullMsgId, mtpRequestId> _pollCloseRequestIds;
 	base::flat_map<FullMsgId, mtpRequestId> _pollReloadRequestIds;
+	SingleQueuedInvokation _pollReloadsResolveDelayed;
 
 	mtpRequestId _wallPaperRequestId = 0;
 	QString _wallPaperSlug;
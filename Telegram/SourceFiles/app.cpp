@@ -67,7 +67,7 @@ namespace {
 		QPixmap p[4];
 	};
 	QVector<CornersPixmaps> corners;
-	using CornersMap = QMap<uint32, CornersPixmaps>;
+	using CornersMap = QMap<uint64, CornersPixmaps>;
 	CornersMap cornersMap;
 	QImage cornersMaskLarge[4], cornersMaskSmall[4];
 
@@ -315,7 +315,7 @@ namespace App {
 		App::quit();
 	}
 
-	QImage readImage(QByteArray data, QByteArray *format, bool opaque, bool *animated) {
+	QImage readImage(QByteArray data, QByteArray *format, bool opaque, bool *animated, QSize shrinkBox) {
 		QByteArray tmpFormat;
 		QImage result;
 		QBuffer buffer(&data);
@@ -326,8 +326,20 @@ namespace App {
 			QImageReader reader(&buffer, *format);
 #ifndef OS_MAC_OLD
 			reader.setAutoTransform(true);
+			if (!shrinkBox.isEmpty()
+				&& (reader.transformation()
+					& QImageIOHandler::TransformationRotate90)) {
+				shrinkBox.transpose();
+			}
 #endif // OS_MAC_OLD
 			if (animated) *animated = reader.supportsAnimation() && reader.imageCount() > 1;
+			const auto size = shrinkBox.isEmpty() ? QSize() : reader.size();
+			if (size.isValid()
+				&& (size.width() > shrinkBox.width()
+					|| size.height() > shrinkBox.height())) {
+				// JPEG and WebP handlers use scaled decoding for this.
+				reader.setScaledSize(size.scaled(shrinkBox, Qt::KeepAspectRatio));
+			}
 			QByteArray fmt = reader.format();
 			if (!fmt.isEmpty()) *format = fmt;
 			if (!reader.read(&result)) {
@@ -373,6 +385,19 @@ namespace App {
 			if (animated) *animated = false;
 			return QImage();
 		}
+		{
+			// Check the header before reading the whole file in memory,
+			// so that sending a large non-image file doesn't load it.
+			QImageReader probe(&f);
+			if (!probe.canRead()) {
+				if (animated) *animated = false;
+				return QImage();
+			}
+		}
+		if (!f.seek(0)) {
+			if (animated) *animated = false;
+			return QImage();
+		}
 		auto imageBytes = f.readAll();
 		auto result = readImage(imageBytes, format, opaque, animated);
 		if (content && !result.isNull()) {
@@ -493,7 +518,8 @@ namespace App {
 	}
 
 	void roundRect(Painter &p, int32 x, int32 y, int32 w, int32 h, style::color bg, ImageRoundRadius radius, RectParts parts) {
-		auto colorKey = ((uint32(bg->c.alpha()) & 0xFF) << 24) | ((uint32(bg->c.red()) & 0xFF) << 16) | ((uint32(bg->c.green()) & 0xFF) << 8) | ((uint32(bg->c.blue()) & 0xFF) << 24);
+		// Small and large corners of the same color are different pixmaps.
+		const auto colorKey = (uint64(radius) << 32) | uint64(bg->c.rgba());
 		auto i = cornersMap.find(colorKey);
 		if (i == cornersMap.cend()) {
 			QImage images[4];
@@ -787,6 +787,7 @@ void DeleteMessagesBox::deleteAndClear() {
 
 	base::flat_map<not_null<PeerData*>, QVector<MTPint>> idsByPeer;
 	base::flat_map<not_null<PeerData*>, QVector<MTPint>> scheduledIdsByPeer;
+	_session->data().startMessagesBatch();
 	for (const auto itemId : _ids) {
 		if (const auto item = _session->data().message(itemId)) {
 			const auto history = item->history();
@@ -813,6 +814,7 @@ void DeleteMessagesBox::deleteAndClear() {
 			}
 		}
 	}
+	_session->data().finishMessagesBatch();
 
 	for (const auto &[peer, ids] : idsByPeer) {
 		peer->session().api().deleteMessages(peer, ids, revoke);
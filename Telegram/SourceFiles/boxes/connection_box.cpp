@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/qthelp_url.h"
 #include "base/call_delayed.h"
 #include "core/application.h"
+#include "core/core_proxy_rotation.h"
 #include "main/main_account.h"
 #include "mtproto/facade.h"
 #include "ui/widgets/checkbox.h"
@@ -156,11 +157,13 @@ private:
 	void setupButtons(int id, not_null<ProxyRow*> button);
 	int rowHeight() const;
 	void refreshProxyForCalls();
+	void refreshProxyRotation();
 
 	not_null<ProxiesBoxController*> _controller;
 	QPointer<Ui::Checkbox> _tryIPv6;
 	std::shared_ptr<Ui::RadioenumGroup<ProxyData::Settings>> _proxySettings;
 	QPointer<Ui::SlideWrap<Ui::Checkbox>> _proxyForCalls;
+	QPointer<Ui::SlideWrap<Ui::Checkbox>> _proxyRotation;
 	QPointer<Ui::DividerLabel> _about;
 	base::unique_qptr<Ui::RpWidget> _noRows;
 	object_ptr<Ui::VerticalLayout> _initialWrap;
@@ -589,6 +592,23 @@ void ProxiesBox::setupContent() {
 			0,
 			st::proxyTryIPv6Padding.right(),
 			st::proxyTryIPv6Padding.top()));
+	_proxyRotation = inner->add(
+		object_ptr<Ui::SlideWrap<Ui::Checkbox>>(
+			inner,
+			object_ptr<Ui::Checkbox>(
+				inner,
+				tr::lng_proxy_auto_switch(tr::now),
+				Core::App().settings().proxyRotationEnabled()),
+			style::margins(
+				0,
+				st::proxyUsePadding.top(),
+				0,
+				st::proxyUsePadding.bottom())),
+		style::margins(
+			st::proxyTryIPv6Padding.left(),
+			0,
+			st::proxyTryIPv6Padding.right(),
+			st::proxyTryIPv6Padding.top()));
 
 	_about = inner->add(
 		object_ptr<Ui::DividerLabel>(
@@ -611,6 +631,7 @@ void ProxiesBox::setupContent() {
 			addNewProxy();
 		}
 		refreshProxyForCalls();
+		refreshProxyRotation();
 	});
 	_tryIPv6->checkedChanges(
 	) | rpl::start_with_next([=](bool checked) {
@@ -627,11 +648,18 @@ void ProxiesBox::setupContent() {
 		_controller->setProxyForCalls(checked);
 	}, _proxyForCalls->lifetime());
 
+	_proxyRotation->entity()->checkedChanges(
+	) | rpl::start_with_next([=](bool checked) {
+		_controller->setProxyRotation(checked);
+	}, _proxyRotation->lifetime());
+
 	if (_rows.empty()) {
 		createNoRowsLabel();
 	}
 	refreshProxyForCalls();
 	_proxyForCalls->finishAnimating();
+	refreshProxyRotation();
+	_proxyRotation->finishAnimating();
 
 	inner->resizeToWidth(st::boxWideWidth);
 
@@ -658,6 +686,15 @@ void ProxiesBox::refreshProxyForCalls() {
 		anim::type::normal);
 }
 
+void ProxiesBox::refreshProxyRotation() {
+	if (!_proxyRotation) {
+		return;
+	}
+	_proxyRotation->toggle(
+		(_proxySettings->value() == ProxyData::Settings::Enabled),
+		anim::type::normal);
+}
+
 int ProxiesBox::rowHeight() const {
 	return st::proxyRowPadding.top()
 		+ st::semiboldFont->height
@@ -1364,6 +1401,16 @@ void ProxiesBoxController::setProxyForCalls(bool enabled) {
 	saveDelayed();
 }
 
+void ProxiesBoxController::setProxyRotation(bool enabled) {
+	auto &settings = Core::App().settings();
+	if (settings.proxyRotationEnabled() == enabled) {
+		return;
+	}
+	settings.setProxyRotationEnabled(enabled);
+	Core::App().proxyRotation().refresh();
+	saveDelayed();
+}
+
 void ProxiesBoxController::setTryIPv6(bool enabled) {
 	if (Global::TryIPv6() == enabled) {
 		return;
@@ -128,7 +128,9 @@ public:
 		rpl::producer<QString> clear,
 		const Database::TaggedSummary &data);
 
-	void update(const Database::TaggedSummary &data);
+	void update(
+		const Database::TaggedSummary &data,
+		const Database::TaggedUsage &usage);
 	void toggleProgress(bool shown);
 
 	rpl::producer<> clearRequests() const;
@@ -139,7 +141,9 @@ protected:
 
 private:
 	QString titleText(const Database::TaggedSummary &data) const;
-	QString sizeText(const Database::TaggedSummary &data) const;
+	QString sizeText(
+		const Database::TaggedSummary &data,
+		const Database::TaggedUsage &usage) const;
 	void radialAnimationCallback();
 
 	Fn<QString(size_type)> _titleFactory;
@@ -164,17 +168,19 @@ LocalStorageBox::Row::Row(
 	st::localStorageRowTitle)
 , _description(
 	this,
-	sizeText(data),
+	sizeText(data, Database::TaggedUsage()),
 	st::localStorageRowSize)
 , _clear(this, std::move(clear), st::localStorageClear) {
 	_clear->setVisible(data.count != 0);
 }
 
-void LocalStorageBox::Row::update(const Database::TaggedSummary &data) {
+void LocalStorageBox::Row::update(
+		const Database::TaggedSummary &data,
+		const Database::TaggedUsage &usage) {
 	if (data.count != 0) {
 		_title->setText(titleText(data));
 	}
-	_description->setText(sizeText(data));
+	_description->setText(sizeText(data, usage));
 	_clear->setVisible(data.count != 0);
 }
 
@@ -258,10 +264,23 @@ QString LocalStorageBox::Row::titleText(const Database::TaggedSummary &data) con
 	return _titleFactory(data.count);
 }
 
-QString LocalStorageBox::Row::sizeText(const Database::TaggedSummary &data) const {
-	return data.totalSize
-		? formatSizeText(data.totalSize)
-		: tr::lng_local_storage_empty(tr::now);
+QString LocalStorageBox::Row::sizeText(
+		const Database::TaggedSummary &data,
+		const Database::TaggedUsage &usage) const {
+	if (!data.totalSize) {
+		return tr::lng_local_storage_empty(tr::now);
+	}
+	const auto size = formatSizeText(data.totalSize);
+	const auto requests = usage.hits + usage.misses;
+	if (!requests) {
+		return size;
+	}
+	return tr::lng_local_storage_hit_rate(
+		tr::now,
+		lt_size,
+		size,
+		lt_percent,
+		QString::number(usage.hits * 100 / requests));
 }
 
 LocalStorageBox::LocalStorageBox(
@@ -305,11 +324,13 @@ void LocalStorageBox::prepare() {
 
 void LocalStorageBox::updateRow(
 		not_null<Ui::SlideWrap<Row>*> row,
-		const Database::TaggedSummary *data) {
+		const Database::TaggedSummary *data,
+		const Database::TaggedUsage *usage) {
+	static const auto empty = Database::TaggedUsage();
 	const auto summary = (_rows.find(0)->second == row);
 	const auto shown = (data && data->count && data->totalSize) || summary;
 	if (shown) {
-		row->entity()->update(*data);
+		row->entity()->update(*data, usage ? *usage : empty);
 	}
 	row->toggle(shown, anim::type::normal);
 }
@@ -325,15 +346,22 @@ void LocalStorageBox::update(
 	}
 	for (const auto &entry : _rows) {
 		if (entry.first == kFakeMediaCacheTag) {
-			updateRow(entry.second, &_statsBig.full);
+			updateRow(
+				entry.second,
+				&_statsBig.full,
+				&_statsBig.fullUsage);
 		} else if (entry.first) {
+			// Misses of absent keys are not counted by tag, so the
+			// per tag hit rate would be too high and is not shown.
 			const auto i = _stats.tagged.find(entry.first);
 			updateRow(
 				entry.second,
-				(i != end(_stats.tagged)) ? &i->second : nullptr);
+				(i != end(_stats.tagged)) ? &i->second : nullptr,
+				nullptr);
 		} else {
 			const auto full = summary();
-			updateRow(entry.second, &full);
+			const auto usage = summaryUsage();
+			updateRow(entry.second, &full, &usage);
 		}
 	}
 }
@@ -345,6 +373,12 @@ auto LocalStorageBox::summary() const -> Database::TaggedSummary {
 	return result;
 }
 
+auto LocalStorageBox::summaryUsage() const -> Database::TaggedUsage {
+	auto result = _stats.fullUsage;
+	result.merge(_statsBig.fullUsage);
+	return result;
+}
+
 void LocalStorageBox::clearByTag(uint16 tag) {
 	if (tag == kFakeMediaCacheTag) {
 		_dbBig->clear();
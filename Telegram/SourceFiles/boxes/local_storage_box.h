@@ -54,7 +54,8 @@ private:
 	void update(Database::Stats &&stats, Database::Stats &&statsBig);
 	void updateRow(
 		not_null<Ui::SlideWrap<Row>*> row,
-		const Database::TaggedSummary *data);
+		const Database::TaggedSummary *data,
+		const Database::TaggedUsage *usage);
 	void setupControls();
 	void setupLimits(not_null<Ui::VerticalLayout*> container);
 	void updateMediaLimit();
@@ -65,6 +66,7 @@ private:
 	void save();
 
 	Database::TaggedSummary summary() const;
+	Database::TaggedUsage summaryUsage() const;
 
 	template <
 		typename Value,
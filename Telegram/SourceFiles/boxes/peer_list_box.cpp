@@ -33,6 +33,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <rpl/range.h>
 
+namespace {
+
+// Huge lists keep the texts laid out only for the rows painted lately.
+constexpr auto kMaxInitializedRows = 512;
+
+} // namespace
+
 auto PaintUserpicCallback(
 	not_null<PeerData*> peer,
 	bool respectSavedMessagesChat)
@@ -558,6 +565,18 @@ void PeerListRow::lazyInitialize(const style::PeerListItem &st) {
 	refreshStatus();
 }
 
+void PeerListRow::lazyUnload() {
+	if (!_initialized) {
+		return;
+	}
+	_initialized = false;
+	_name = Ui::Text::String();
+	if (_statusType != StatusType::Custom) {
+		_status = Ui::Text::String();
+		_statusValidTill = 0;
+	}
+}
+
 void PeerListRow::createCheckbox(Fn<void()> updateCallback) {
 	_checkbox = std::make_unique<Ui::RoundImageCheckbox>(
 		st::contactsPhotoCheckbox,
@@ -734,6 +753,69 @@ void PeerListContent::refreshIndices() {
 	}
 }
 
+void PeerListContent::repositionRow(
+		not_null<PeerListRow*> row,
+		Fn<bool(const PeerListRow &a, const PeerListRow &b)> compare) {
+	if (row->isSearchResult()) {
+		return;
+	}
+	const auto index = row->absoluteIndex();
+
+	Assert(index >= 0 && index < int(_rows.size()));
+	Assert(_rows[index].get() == row);
+
+	// Take the row out and binary search its place in the rest.
+	const auto from = begin(_rows) + index;
+	const auto after = std::upper_bound(
+		begin(_rows),
+		from,
+		row,
+		[&](not_null<PeerListRow*> a, const std::unique_ptr<PeerListRow> &b) {
+			return compare(*a, *b);
+		});
+	const auto before = std::lower_bound(
+		from + 1,
+		end(_rows),
+		row,
+		[&](const std::unique_ptr<PeerListRow> &a, not_null<PeerListRow*> b) {
+			return compare(*a, *b);
+		});
+	auto changedFrom = index;
+	auto changedTill = index + 1;
+	if (after != from) {
+		changedFrom = after - begin(_rows);
+		std::rotate(after, from, from + 1);
+	} else if (before != from + 1) {
+		changedTill = before - begin(_rows);
+		std::rotate(from, from + 1, before);
+	} else {
+		return;
+	}
+	for (auto i = changedFrom; i != changedTill; ++i) {
+		_rows[i]->setAbsoluteIndex(i);
+	}
+
+	// The search index entries are kept in the same order.
+	for (const auto ch : row->nameFirstLetters()) {
+		const auto i = _searchIndex.find(ch);
+		if (i == end(_searchIndex)) {
+			continue;
+		}
+		auto &entry = i->second;
+		entry.erase(ranges::remove(entry, row), end(entry));
+		entry.insert(
+			std::upper_bound(
+				begin(entry),
+				end(entry),
+				row,
+				[&](not_null<PeerListRow*> a, not_null<PeerListRow*> b) {
+					return a->absoluteIndex() < b->absoluteIndex();
+				}),
+			row);
+	}
+	update();
+}
+
 void PeerListContent::removeRowAtIndex(
 		std::vector<std::unique_ptr<PeerListRow>> &from,
 		int index) {
@@ -788,6 +870,7 @@ void PeerListContent::clearAllContent() {
 	_searchIndex.clear();
 	_rows.clear();
 	_searchRows.clear();
+	_initializedRows.clear();
 	_searchQuery
 		= _normalizedSearchQuery
 		= _mentionHighlight
@@ -1099,6 +1182,18 @@ void PeerListContent::contextMenuEvent(QContextMenuEvent *e) {
 	}
 }
 
+void PeerListContent::rememberInitializedRow(not_null<PeerListRow*> row) {
+	_initializedRows.push_back(row->id());
+	while (int(_initializedRows.size()) > kMaxInitializedRows) {
+		// A row still on the screen is laid out again when painted.
+		const auto id = _initializedRows.front();
+		_initializedRows.pop_front();
+		if (const auto found = findRow(id); found && found != row) {
+			found->lazyUnload();
+		}
+	}
+}
+
 void PeerListContent::setPressed(Selected pressed) {
 	if (auto row = getRow(_pressed.index)) {
 		row->stopLastRipple();
@@ -1111,6 +1206,9 @@ crl::time PeerListContent::paintRow(Painter &p, crl::time ms, RowIndex index) {
 	auto row = getRow(index);
 	Assert(row != nullptr);
 
+	if (!row->isInitialized()) {
+		rememberInitializedRow(row);
+	}
 	row->lazyInitialize(_st.item);
 
 	auto refreshStatusAt = row->refreshStatusTime();
@@ -14,6 +14,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/sender.h"
 #include "base/timer.h"
 
+#include <deque>
+
 namespace style {
 struct PeerList;
 struct PeerListItem;
@@ -178,6 +180,13 @@ public:
 	}
 
 	virtual void lazyInitialize(const style::PeerListItem &st);
+
+	// Forgets the name and status texts till the row is painted again.
+	void lazyUnload();
+	bool isInitialized() const {
+		return _initialized;
+	}
+
 	virtual void paintStatusText(
 		Painter &p,
 		const style::PeerListItem &st,
@@ -187,11 +196,6 @@ public:
 		int outerWidth,
 		bool selected);
 
-protected:
-	bool isInitialized() const {
-		return _initialized;
-	}
-
 private:
 	void createCheckbox(Fn<void()> updateCallback);
 	void setCheckedInternal(bool checked, SetStyle style);
@@ -253,6 +257,11 @@ public:
 	virtual int peerListFullRowsCount() = 0;
 	virtual PeerListRow *peerListFindRow(PeerListRowId id) = 0;
 	virtual void peerListSortRows(Fn<bool(const PeerListRow &a, const PeerListRow &b)> compare) = 0;
+
+	// Moves one row of the sorted list to its place after it has changed.
+	virtual void peerListRepositionRow(
+		not_null<PeerListRow*> row,
+		Fn<bool(const PeerListRow &a, const PeerListRow &b)> compare) = 0;
 	virtual int peerListPartitionRows(Fn<bool(const PeerListRow &a)> border) = 0;
 
 	template <typename PeerDataRange>
@@ -481,6 +490,9 @@ public:
 		refreshIndices();
 		update();
 	}
+	void repositionRow(
+		not_null<PeerListRow*> row,
+		Fn<bool(const PeerListRow &a, const PeerListRow &b)> compare);
 
 	std::unique_ptr<PeerListState> saveState() const;
 	void restoreState(std::unique_ptr<PeerListState> state);
@@ -569,6 +581,7 @@ private:
 	QRect getActionRect(not_null<PeerListRow*> row, RowIndex index) const;
 
 	crl::time paintRow(Painter &p, crl::time ms, RowIndex index);
+	void rememberInitializedRow(not_null<PeerListRow*> row);
 
 	void addRowEntry(not_null<PeerListRow*> row);
 	void addToSearchIndex(not_null<PeerListRow*> row);
@@ -630,6 +643,7 @@ private:
 	object_ptr<Ui::FlatLabel> _searchLoading = { nullptr };
 
 	std::vector<std::unique_ptr<PeerListRow>> _searchRows;
+	std::deque<PeerListRowId> _initializedRows;
 	base::Timer _repaintByStatus;
 	base::unique_qptr<Ui::PopupMenu> _contextMenu;
 
@@ -719,6 +733,11 @@ public:
 			});
 		});
 	}
+	void peerListRepositionRow(
+			not_null<PeerListRow*> row,
+			Fn<bool(const PeerListRow &a, const PeerListRow &b)> compare) override {
+		_content->repositionRow(row, std::move(compare));
+	}
 	int peerListPartitionRows(
 			Fn<bool(const PeerListRow &a)> border) override {
 		auto result = 0;
@@ -39,6 +39,7 @@ constexpr auto kForwardMessagesOnAdd = 100;
 constexpr auto kParticipantsFirstPageCount = 16;
 constexpr auto kParticipantsPerPage = 200;
 constexpr auto kSortByOnlineDelay = crl::time(1000);
+constexpr auto kRepositionChangedRowsLimit = 8;
 
 void RemoveAdmin(
 		not_null<ChannelData*> channel,
@@ -675,12 +676,12 @@ ParticipantsOnlineSorter::ParticipantsOnlineSorter(
 	not_null<PeerListDelegate*> delegate)
 : _peer(peer)
 , _delegate(delegate)
-, _sortByOnlineTimer([=] { sort(); }) {
+, _sortByOnlineTimer([=] { sortChanged(); }) {
 	const auto handleUpdate = [=](const Notify::PeerUpdate &update) {
 		const auto peerId = update.peer->id;
 		if (const auto row = _delegate->peerListFindRow(peerId)) {
 			row->refreshStatus();
-			sortDelayed();
+			sortDelayed(row);
 		}
 	};
 
@@ -690,17 +691,44 @@ ParticipantsOnlineSorter::ParticipantsOnlineSorter(
 	sort();
 }
 
-void ParticipantsOnlineSorter::sortDelayed() {
+void ParticipantsOnlineSorter::sortDelayed(not_null<PeerListRow*> row) {
+	_changed.emplace(row->id());
 	if (!_sortByOnlineTimer.isActive()) {
 		_sortByOnlineTimer.callOnce(kSortByOnlineDelay);
 	}
 }
 
-void ParticipantsOnlineSorter::sort() {
+bool ParticipantsOnlineSorter::sortEnabled() const {
 	const auto channel = _peer->asChannel();
-	if (channel
-		&& (!channel->isMegagroup()
-			|| channel->membersCount() > Global::ChatSizeMax())) {
+	return !channel
+		|| (channel->isMegagroup()
+			&& channel->membersCount() <= Global::ChatSizeMax());
+}
+
+void ParticipantsOnlineSorter::sortChanged() {
+	// A few changed statuses are moved to their places one by one,
+	// the rest of the rows stay sorted between the full resorts.
+	const auto changed = base::take(_changed);
+	if (!sortEnabled() || int(changed.size()) > kRepositionChangedRowsLimit) {
+		sort();
+		return;
+	}
+	const auto now = base::unixtime::now();
+	const auto compare = [=](const PeerListRow &a, const PeerListRow &b) {
+		return Data::SortByOnlineValue(a.peer()->asUser(), now) >
+			Data::SortByOnlineValue(b.peer()->asUser(), now);
+	};
+	for (const auto id : changed) {
+		if (const auto row = _delegate->peerListFindRow(id)) {
+			_delegate->peerListRepositionRow(row, compare);
+		}
+	}
+	refreshOnlineCount();
+}
+
+void ParticipantsOnlineSorter::sort() {
+	_changed.clear();
+	if (!sortEnabled()) {
 		_onlineCount = 0;
 		return;
 	}
@@ -1974,9 +2002,59 @@ bool ParticipantsBoxSearchController::searchInCache() {
 			i->second.requestedCount);
 		return true;
 	}
+	addFromPrefixCache();
 	return false;
 }
 
+void ParticipantsBoxSearchController::addFromPrefixCache() {
+	// Results of a shorter cached query are filtered here to be shown
+	// right away. The server also matches transliterated names, so the
+	// request is sent anyway and its results are added to these.
+	auto found = (const CacheEntry*)nullptr;
+	auto foundLength = 0;
+	for (const auto &[query, entry] : _cache) {
+		if (query.size() > foundLength
+			&& query.size() < _query.size()
+			&& _query.startsWith(query)) {
+			found = &entry;
+			foundLength = query.size();
+		}
+	}
+	if (!found) {
+		return;
+	}
+	const auto words = TextUtilities::PrepareSearchWords(_query);
+	const auto matches = [&](not_null<UserData*> user) {
+		for (const auto &word : words) {
+			const auto inName = ranges::any_of(
+				user->nameWords(),
+				[&](const QString &nameWord) {
+					return nameWord.startsWith(word);
+				});
+			if (!inName
+				&& !user->username.startsWith(word, Qt::CaseInsensitive)) {
+				return false;
+			}
+		}
+		return true;
+	};
+	const auto overrideRole = (_role == Role::Admins)
+		? Role::Members
+		: _role;
+	found->result.match([&](const MTPDchannels_channelParticipants &data) {
+		for (const auto &participant : data.vparticipants().v) {
+			const auto user = _additional->applyParticipant(
+				participant,
+				overrideRole);
+			if (user && matches(user)) {
+				delegate()->peerListSearchAddRow(user);
+			}
+		}
+	}, [](const MTPDchannels_channelParticipantsNotModified &) {
+	});
+	delegate()->peerListSearchRefreshRows();
+}
+
 bool ParticipantsBoxSearchController::loadMoreRows() {
 	if (_query.isEmpty()) {
 		return false;
@@ -60,12 +60,15 @@ public:
 	rpl::producer<int> onlineCountValue() const;
 
 private:
-	void sortDelayed();
+	void sortDelayed(not_null<PeerListRow*> row);
+	void sortChanged();
+	[[nodiscard]] bool sortEnabled() const;
 	void refreshOnlineCount();
 
 	not_null<PeerData*> _peer;
 	not_null<PeerListDelegate*> _delegate;
 	base::Timer _sortByOnlineTimer;
+	base::flat_set<PeerListRowId> _changed;
 	rpl::variable<int> _onlineCount = 0;
 
 };
@@ -285,6 +288,7 @@ private:
 
 	void searchOnServer();
 	bool searchInCache();
+	void addFromPrefixCache();
 	void searchDone(
 		mtpRequestId requestId,
 		const MTPchannels_ChannelParticipants &result,
@@ -152,6 +152,8 @@ private:
 	QRect countRealGeometry() const;
 	QRect countCurrentGeometry(float64 progress) const;
 	void prepareCache(QSize size, int shrink);
+	void validatePhoto();
+	void validateFileThumb();
 	void drawSimpleFrame(Painter &p, QRect to, QSize size) const;
 
 	Ui::GroupMediaLayout _layout;
@@ -162,7 +164,7 @@ private:
 	QImage _albumCache;
 	QPoint _albumPosition;
 	RectParts _albumCorners = RectPart::None;
-	QPixmap _photo;
+	QPixmap _photo; // Prepared on first paint, like _fileThumb.
 	QPixmap _fileThumb;
 	QString _name;
 	QString _status;
@@ -186,36 +188,6 @@ AlbumThumb::AlbumThumb(
 
 	moveToLayout(layout);
 
-	using Option = Images::Option;
-	const auto previewWidth = _fullPreview.width();
-	const auto previewHeight = _fullPreview.height();
-	const auto imageWidth = std::max(
-		previewWidth / cIntRetinaFactor(),
-		st::minPhotoSize);
-	const auto imageHeight = std::max(
-		previewHeight / cIntRetinaFactor(),
-		st::minPhotoSize);
-	_photo = App::pixmapFromImageInPlace(Images::prepare(
-		_fullPreview,
-		previewWidth,
-		previewHeight,
-		Option::RoundedLarge | Option::RoundedAll,
-		imageWidth,
-		imageHeight));
-
-	const auto idealSize = st::sendMediaFileThumbSize * cIntRetinaFactor();
-	const auto fileThumbSize = (previewWidth > previewHeight)
-		? QSize(previewWidth * idealSize / previewHeight, idealSize)
-		: QSize(idealSize, previewHeight * idealSize / previewWidth);
-	_fileThumb = App::pixmapFromImageInPlace(Images::prepare(
-		_fullPreview,
-		fileThumbSize.width(),
-		fileThumbSize.height(),
-		Option::RoundedSmall | Option::RoundedAll,
-		st::sendMediaFileThumbSize,
-		st::sendMediaFileThumbSize
-	));
-
 	const auto availableFileWidth = st::sendMediaPreviewSize
 		- st::sendMediaFileThumbSkip
 		- st::sendMediaFileThumbSize;
@@ -295,7 +267,49 @@ void AlbumThumb::moveToLayout(const Ui::GroupMediaLayout &layout) {
 }
 
 int AlbumThumb::photoHeight() const {
-	return _photo.height() / cIntRetinaFactor();
+	return std::max(
+		_fullPreview.height() / cIntRetinaFactor(),
+		st::minPhotoSize);
+}
+
+void AlbumThumb::validatePhoto() {
+	if (!_photo.isNull()) {
+		return;
+	}
+	using Option = Images::Option;
+	const auto previewWidth = _fullPreview.width();
+	const auto previewHeight = _fullPreview.height();
+	const auto imageWidth = std::max(
+		previewWidth / cIntRetinaFactor(),
+		st::minPhotoSize);
+	_photo = App::pixmapFromImageInPlace(Images::prepare(
+		_fullPreview,
+		previewWidth,
+		previewHeight,
+		Option::RoundedLarge | Option::RoundedAll,
+		imageWidth,
+		photoHeight()));
+}
+
+void AlbumThumb::validateFileThumb() {
+	if (!_fileThumb.isNull()) {
+		return;
+	}
+	using Option = Images::Option;
+	const auto previewWidth = _fullPreview.width();
+	const auto previewHeight = _fullPreview.height();
+	const auto idealSize = st::sendMediaFileThumbSize * cIntRetinaFactor();
+	const auto fileThumbSize = (previewWidth > previewHeight)
+		? QSize(previewWidth * idealSize / previewHeight, idealSize)
+		: QSize(idealSize, previewHeight * idealSize / previewWidth);
+	_fileThumb = App::pixmapFromImageInPlace(Images::prepare(
+		_fullPreview,
+		fileThumbSize.width(),
+		fileThumbSize.height(),
+		Option::RoundedSmall | Option::RoundedAll,
+		st::sendMediaFileThumbSize,
+		st::sendMediaFileThumbSize
+	));
 }
 
 void AlbumThumb::paintInAlbum(
@@ -484,6 +498,7 @@ void AlbumThumb::drawSimpleFrame(Painter &p, QRect to, QSize size) const {
 }
 
 void AlbumThumb::paintPhoto(Painter &p, int left, int top, int outerWidth) {
+	validatePhoto();
 	const auto width = _photo.width() / cIntRetinaFactor();
 	p.drawPixmapLeft(
 		left + (st::sendMediaPreviewSize - width) / 2,
@@ -497,6 +512,7 @@ void AlbumThumb::paintFile(Painter &p, int left, int top, int outerWidth) {
 		+ st::sendMediaFileThumbSize
 		+ st::sendMediaFileThumbSkip;
 
+	validateFileThumb();
 	p.drawPixmap(left, top, _fileThumb);
 	p.setFont(st::semiboldFont);
 	p.setPen(st::historyFileNameInFg);
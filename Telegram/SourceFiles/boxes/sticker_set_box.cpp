@@ -233,14 +233,15 @@ StickerSetBox::Inner::Inner(
 	}, [&](const MTPDinputStickerSetAnimatedEmoji &) {
 	});
 
-	_api.request(MTPmessages_GetStickerSet(
-		_input
-	)).done([=](const MTPmessages_StickerSet &result) {
-		gotSet(result);
-	}).fail([=](const RPCError &error) {
-		_loaded = true;
-		Ui::show(Box<InformBox>(tr::lng_stickers_not_found(tr::now)));
-	}).send();
+	_controller->session().api().requestStickerSet(
+		_input,
+		crl::guard(this, [=](const MTPmessages_StickerSet &result) {
+			gotSet(result);
+		}),
+		crl::guard(this, [=](const RPCError &error) {
+			_loaded = true;
+			Ui::show(Box<InformBox>(tr::lng_stickers_not_found(tr::now)));
+		}));
 
 	_controller->session().api().updateStickers();
 
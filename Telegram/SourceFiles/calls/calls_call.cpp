@@ -332,6 +332,9 @@ void Call::redial() {
 }
 
 QString Call::getDebugLog() const {
+	if (!_controller) {
+		return _finalDebugLog;
+	}
 	const auto debug = _controller->GetDebugString();
 	return QString::fromUtf8(debug.data(), debug.size());
 }
@@ -898,6 +901,10 @@ void Call::handleControllerError(int error) {
 
 void Call::destroyController() {
 	if (_controller) {
+		// Keep the last stats around for tuning the call network paths.
+		_finalDebugLog = getDebugLog();
+		DEBUG_LOG(("Call Info: Final stats: %1").arg(_finalDebugLog));
+
 		DEBUG_LOG(("Call Info: Destroying call controller.."));
 		_controller.reset();
 		DEBUG_LOG(("Call Info: Call controller destroyed."));
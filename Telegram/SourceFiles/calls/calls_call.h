@@ -211,6 +211,7 @@ private:
 	uint64 _keyFingerprint = 0;
 
 	ControllerPointer _controller;
+	QString _finalDebugLog;
 
 	std::unique_ptr<Media::Audio::Track> _waitingTrack;
 
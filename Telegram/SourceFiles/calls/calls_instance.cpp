@@ -35,6 +35,8 @@ constexpr auto kServerConfigUpdateTimeoutMs = 24 * 3600 * crl::time(1000);
 Instance::Instance(not_null<Main::Session*> session)
 : _session(session)
 , _api(_session->api().instance()) {
+	// Have the config and the server random ready for the first call.
+	prefetchDhConfig();
 }
 
 void Instance::startOutgoingCall(not_null<UserData*> user) {
@@ -141,6 +143,17 @@ void Instance::refreshDhConfig() {
 	Expects(_currentCall != nullptr);
 
 	const auto weak = base::make_weak(_currentCall);
+	if (!_dhConfigRandom.empty()) {
+		// Use the config received in advance, saving a server round-trip.
+		auto random = base::take(_dhConfigRandom);
+		crl::on_main(weak, [=, random = std::move(random)] {
+			if (const auto call = weak.get()) {
+				call->start(random);
+			}
+		});
+		prefetchDhConfig();
+		return;
+	}
 	_api.request(MTPmessages_GetDhConfig(
 		MTP_int(_dhConfig.version),
 		MTP_int(MTP::ModExpFirst::kRandomPowerSize)
@@ -153,6 +166,7 @@ void Instance::refreshDhConfig() {
 		if (!random.empty()) {
 			Assert(random.size() == MTP::ModExpFirst::kRandomPowerSize);
 			call->start(random);
+			prefetchDhConfig();
 		} else {
 			callFailed(call);
 		}
@@ -165,6 +179,24 @@ void Instance::refreshDhConfig() {
 	}).send();
 }
 
+void Instance::prefetchDhConfig() {
+	if (_dhConfigPrefetchRequestId) {
+		return;
+	}
+	_dhConfigPrefetchRequestId = _api.request(MTPmessages_GetDhConfig(
+		MTP_int(_dhConfig.version),
+		MTP_int(MTP::ModExpFirst::kRandomPowerSize)
+	)).done([=](const MTPmessages_DhConfig &result) {
+		_dhConfigPrefetchRequestId = 0;
+		const auto random = updateDhConfig(result);
+		if (!random.empty()) {
+			_dhConfigRandom = bytes::make_vector(random);
+		}
+	}).fail([=](const RPCError &error) {
+		_dhConfigPrefetchRequestId = 0;
+	}).send();
+}
+
 bytes::const_span Instance::updateDhConfig(
 		const MTPmessages_DhConfig &data) {
 	const auto validRandom = [](const QByteArray & random) {
@@ -66,6 +66,7 @@ private:
 	void requestMicrophonePermissionOrFail(Fn<void()> onSuccess) override;
 
 	void refreshDhConfig();
+	void prefetchDhConfig();
 	void refreshServerConfig();
 	bytes::const_span updateDhConfig(const MTPmessages_DhConfig &data);
 
@@ -77,6 +78,10 @@ private:
 
 	DhConfig _dhConfig;
 
+	// Server random for the next call, each one is used only once.
+	bytes::vector _dhConfigRandom;
+	mtpRequestId _dhConfigPrefetchRequestId = 0;
+
 	crl::time _lastServerConfigUpdateTime = 0;
 	mtpRequestId _serverConfigRequestId = 0;
 
@@ -158,7 +158,7 @@ bool FieldAutocomplete::clearFilteredBotCommands() {
 namespace {
 template <typename T, typename U>
 inline int indexOfInFirstN(const T &v, const U &elem, int last) {
-	for (auto b = v.cbegin(), i = b, e = b + qMax(v.size(), last); i != e; ++i) {
+	for (auto b = v.cbegin(), i = b, e = b + qMin(v.size(), last); i != e; ++i) {
 		if (*i == elem) {
 			return (i - b);
 		}
@@ -242,35 +242,34 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 			}
 		}
 		if (_chat) {
-			auto ordered = QMultiMap<TimeId, not_null<UserData*>>();
-			const auto byOnline = [&](not_null<UserData*> user) {
-				return Data::SortByOnlineValue(user, now);
-			};
+			// Last authors go first, then the other participants by online.
+			auto added = base::flat_set<not_null<UserData*>>();
+			auto ordered = std::vector<std::pair<TimeId, UserData*>>();
 			mrows.reserve(mrows.size() + (_chat->participants.empty() ? _chat->lastAuthors.size() : _chat->participants.size()));
+			for (const auto user : _chat->lastAuthors) {
+				if (user->isInaccessible()) continue;
+				if (!listAllSuggestions && filterNotPassedByName(user)) continue;
+				if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
+				mrows.push_back(user);
+				added.emplace(user);
+			}
 			if (_chat->noParticipantInfo()) {
 				Auth().api().requestFullPeer(_chat);
 			} else if (!_chat->participants.empty()) {
+				ordered.reserve(_chat->participants.size());
 				for (const auto user : _chat->participants) {
 					if (user->isInaccessible()) continue;
+					if (added.contains(user)) continue;
 					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
 					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
-					ordered.insertMulti(byOnline(user), user);
+					ordered.emplace_back(Data::SortByOnlineValue(user, now), user);
 				}
 			}
-			for (const auto user : _chat->lastAuthors) {
-				if (user->isInaccessible()) continue;
-				if (!listAllSuggestions && filterNotPassedByName(user)) continue;
-				if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
+			ranges::stable_sort(ordered, std::greater<>(), [](const auto &pair) {
+				return pair.first;
+			});
+			for (const auto &[online, user] : ordered) {
 				mrows.push_back(user);
-				if (!ordered.isEmpty()) {
-					ordered.remove(byOnline(user), user);
-				}
-			}
-			if (!ordered.isEmpty()) {
-				for (auto i = ordered.cend(), b = ordered.cbegin(); i != b;) {
-					--i;
-					mrows.push_back(i.value());
-				}
 			}
 		} else if (_channel && _channel->isMegagroup()) {
 			QMultiMap<int32, UserData*> ordered;
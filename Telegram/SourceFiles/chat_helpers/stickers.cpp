@@ -299,7 +299,7 @@ void RequestSetToPushFaved(not_null<DocumentData*> document) {
 		}
 		SetIsFaved(document, std::move(list));
 	};
-	MTP::send(MTPmessages_GetStickerSet(document->sticker()->set), rpcDone([document, addAnyway](const MTPmessages_StickerSet &result) {
+	document->session().api().requestStickerSet(document->sticker()->set, [document, addAnyway](const MTPmessages_StickerSet &result) {
 		Expects(result.type() == mtpc_messages_stickerSet);
 		auto list = std::vector<not_null<EmojiPtr>>();
 		auto &d = result.c_messages_stickerSet();
@@ -316,14 +316,10 @@ void RequestSetToPushFaved(not_null<DocumentData*> document) {
 			}
 		}
 		addAnyway(std::move(list));
-	}), rpcFail([addAnyway](const RPCError &error) {
-		if (MTP::isDefaultHandledError(error)) {
-			return false;
-		}
+	}, [addAnyway](const RPCError &error) {
 		// Perhaps this is a deleted sticker pack. Add anyway.
 		addAnyway({});
-		return true;
-	}));
+	});
 }
 
 void SetIsNotFaved(not_null<DocumentData*> document) {
@@ -1206,6 +1202,62 @@ std::unique_ptr<Lottie::SinglePlayer> LottiePlayerFromDocument(
 	return LottieFromDocument(method, document, uint8(keyShift), box);
 }
 
+LottieSharedPlayer::LottieSharedPlayer(
+	std::unique_ptr<Lottie::SinglePlayer> player)
+: _player(std::move(player)) {
+}
+
+bool LottieSharedPlayer::markFrameShown(int index) {
+	if (_shownIndex == index) {
+		return false;
+	}
+	_shownIndex = index;
+	return _player->markFrameShown();
+}
+
+std::shared_ptr<LottieSharedPlayer> LottieSharedPlayerFromDocument(
+		not_null<DocumentData*> document,
+		const Lottie::ColorReplacements *replacements,
+		LottieSize sizeTag,
+		QSize box,
+		Lottie::Quality quality) {
+	using Key = std::tuple<DocumentId, uint8, LottieSize, int, int>;
+	static auto Players = base::flat_map<
+		Key,
+		std::weak_ptr<LottieSharedPlayer>>();
+
+	const auto tag = replacements ? replacements->tag : uint8(0);
+	const auto key = Key{
+		document->id,
+		tag,
+		sizeTag,
+		box.width(),
+		box.height() };
+	const auto i = Players.find(key);
+	if (i != end(Players)) {
+		if (auto result = i->second.lock()) {
+			return result;
+		}
+	}
+	for (auto j = begin(Players); j != end(Players);) {
+		if (j->second.expired()) {
+			j = Players.erase(j);
+		} else {
+			++j;
+		}
+	}
+
+	auto result = std::make_shared<LottieSharedPlayer>(
+		LottiePlayerFromDocument(
+			document,
+			replacements,
+			sizeTag,
+			box,
+			quality));
+	Players.emplace(key, result);
+	return result;
+}
+
 not_null<Lottie::Animation*> LottieAnimationFromDocument(
 		not_null<Lottie::MultiPlayer*> player,
 		not_null<DocumentData*> document,
@@ -133,6 +133,7 @@ enum class LottieSize : uchar {
 	StickersFooter,
 	SetsListThumbnail,
 	InlineResults,
+	MediaPreview,
 };
 
 [[nodiscard]] std::unique_ptr<Lottie::SinglePlayer> LottiePlayerFromDocument(
@@ -148,6 +149,31 @@ enum class LottieSize : uchar {
 	QSize box,
 	Lottie::Quality quality = Lottie::Quality(),
 	std::shared_ptr<Lottie::FrameRenderer> renderer = nullptr);
+// Looping stickers of the same size play in step, so all the views of
+// one sticker can paint the frames of one player.
+class LottieSharedPlayer final {
+public:
+	explicit LottieSharedPlayer(std::unique_ptr<Lottie::SinglePlayer> player);
+
+	[[nodiscard]] not_null<Lottie::SinglePlayer*> player() const {
+		return _player.get();
+	}
+
+	// Each frame is marked shown once, by the first view painting it.
+	bool markFrameShown(int index);
+
+private:
+	std::unique_ptr<Lottie::SinglePlayer> _player;
+	int _shownIndex = -1;
+
+};
+
+[[nodiscard]] std::shared_ptr<LottieSharedPlayer> LottieSharedPlayerFromDocument(
+	not_null<DocumentData*> document,
+	const Lottie::ColorReplacements *replacements,
+	LottieSize sizeTag,
+	QSize box,
+	Lottie::Quality quality = Lottie::Quality());
 [[nodiscard]] not_null<Lottie::Animation*> LottieAnimationFromDocument(
 	not_null<Lottie::MultiPlayer*> player,
 	not_null<DocumentData*> document,
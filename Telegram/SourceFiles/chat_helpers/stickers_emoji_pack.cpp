@@ -32,8 +32,7 @@ class EmojiImageLoader {
 public:
 	EmojiImageLoader(
 		crl::weak_on_queue<EmojiImageLoader> weak,
-		std::shared_ptr<UniversalImages> images,
-		bool largeEnabled);
+		std::shared_ptr<UniversalImages> images);
 
 	[[nodiscard]] QImage prepare(EmojiPtr emoji);
 	void switchTo(std::shared_ptr<UniversalImages> images);
@@ -309,15 +308,10 @@ QByteArray ImageSource::bytesForCache() {
 
 EmojiImageLoader::EmojiImageLoader(
 	crl::weak_on_queue<EmojiImageLoader> weak,
-	std::shared_ptr<UniversalImages> images,
-	bool largeEnabled)
+	std::shared_ptr<UniversalImages> images)
 : _weak(std::move(weak))
 , _images(std::move(images)) {
 	Expects(_images != nullptr);
-
-	if (largeEnabled) {
-		_images->ensureLoaded();
-	}
 }
 
 QImage EmojiImageLoader::prepare(EmojiPtr emoji) {
@@ -392,7 +386,7 @@ std::shared_ptr<UniversalImages> EmojiImageLoader::releaseImages() {
 
 EmojiPack::EmojiPack(not_null<Main::Session*> session)
 : _session(session)
-, _imageLoader(prepareSourceImages(), session->settings().largeEmoji())
+, _imageLoader(prepareSourceImages())
 , _clearTimer([=] { clearSourceImages(); }) {
 	refresh();
 
@@ -481,6 +475,10 @@ std::shared_ptr<Image> EmojiPack::image(EmojiPtr emoji) {
 	auto result = std::make_shared<Image>(
 		std::make_unique<details::ImageSource>(emoji, &_imageLoader));
 	i->second = result;
+
+	// The source images are loaded by the loader when the first emoji
+	// is prepared, we don't need them any longer once it is done.
+	_clearTimer.callOnce(details::kClearSourceTimeout);
 	return result;
 }
 
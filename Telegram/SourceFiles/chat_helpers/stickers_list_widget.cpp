@@ -44,6 +44,8 @@ namespace {
 constexpr auto kInlineItemsMaxPerRow = 5;
 constexpr auto kSearchRequestDelay = 400;
 constexpr auto kRecentDisplayLimit = 20;
+constexpr auto kLottieFastScrollScreensPerSecond = 3;
+constexpr auto kLottieFastScrollResumeDelay = crl::time(150);
 
 bool SetInMyList(MTPDstickerSet::Flags flags) {
 	return (flags & MTPDstickerSet::Flag::f_installed_date)
@@ -836,7 +838,11 @@ StickersListWidget::StickersListWidget(
 , _addWidth(st::stickersTrendingAdd.font->width(_addText))
 , _settings(this, tr::lng_stickers_you_have(tr::now))
 , _previewTimer([=] { showPreview(); })
-, _searchRequestTimer([=] { sendSearchRequest(); }) {
+, _searchRequestTimer([=] { sendSearchRequest(); })
+, _lottieFastScrollTimer([=] {
+	_lottieFastScroll = false;
+	update();
+}) {
 	setMouseTracking(true);
 	setAttribute(Qt::WA_OpaquePaintEvent);
 
@@ -887,6 +893,7 @@ void StickersListWidget::visibleTopBottomUpdated(
 		int visibleTop,
 		int visibleBottom) {
 	Inner::visibleTopBottomUpdated(visibleTop, visibleBottom);
+	checkLottieFastScroll(visibleTop, visibleBottom);
 	if (_section == Section::Featured) {
 		checkVisibleFeatured(visibleTop, visibleBottom);
 	} else {
@@ -895,6 +902,25 @@ void StickersListWidget::visibleTopBottomUpdated(
 	validateSelectedIcon(ValidateIconAnimations::Full);
 }
 
+void StickersListWidget::checkLottieFastScroll(
+		int visibleTop,
+		int visibleBottom) {
+	// While the panel is scrolled fast players stay at their current
+	// frames, the rows fly by too quickly to see the animation anyway.
+	const auto now = crl::now();
+	const auto elapsed = std::max(now - _lottieScrollTime, crl::time(1));
+	const auto distance = std::abs(visibleTop - _lottieScrollTop);
+	const auto fast = distance * crl::time(1000) > elapsed
+		* (visibleBottom - visibleTop)
+		* kLottieFastScrollScreensPerSecond;
+	_lottieScrollTop = visibleTop;
+	_lottieScrollTime = now;
+	if (fast) {
+		_lottieFastScroll = true;
+		_lottieFastScrollTimer.callOnce(kLottieFastScrollResumeDelay);
+	}
+}
+
 void StickersListWidget::checkVisibleFeatured(
 		int visibleTop,
 		int visibleBottom) {
@@ -949,6 +975,19 @@ int StickersListWidget::featuredRowHeight() const {
 
 template <typename Callback>
 bool StickersListWidget::enumerateSections(Callback callback) const {
+	if (!sectionsLayoutValid()) {
+		return computeSections(std::move(callback));
+	}
+	for (const auto &info : _sectionsLayout) {
+		if (!callback(info)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename Callback>
+bool StickersListWidget::computeSections(Callback callback) const {
 	auto info = SectionInfo();
 	const auto &sets = shownSets();
 	for (auto i = 0; i != sets.size(); ++i) {
@@ -979,9 +1018,38 @@ bool StickersListWidget::enumerateSections(Callback callback) const {
 	return true;
 }
 
+void StickersListWidget::refreshSectionsLayout() {
+	_sectionsLayout.clear();
+	_sectionsLayout.reserve(shownSets().size());
+	computeSections([&](const SectionInfo &info) {
+		_sectionsLayout.push_back(info);
+		return true;
+	});
+	_sectionsLayoutGeneration = _sectionsGeneration;
+	_sectionsLayoutSection = _section;
+	_sectionsLayoutColumnCount = _columnCount;
+	_sectionsLayoutSingleSize = _singleSize;
+}
+
+void StickersListWidget::invalidateSectionsLayout() {
+	++_sectionsGeneration;
+	_sectionsLayout.clear();
+}
+
+bool StickersListWidget::sectionsLayoutValid() const {
+	return (_sectionsLayoutGeneration == _sectionsGeneration)
+		&& (_sectionsLayout.size() == shownSets().size())
+		&& (_sectionsLayoutSection == _section)
+		&& (_sectionsLayoutColumnCount == _columnCount)
+		&& (_sectionsLayoutSingleSize == _singleSize);
+}
+
 StickersListWidget::SectionInfo StickersListWidget::sectionInfo(int section) const {
 	Expects(section >= 0 && section < shownSets().size());
 
+	if (sectionsLayoutValid()) {
+		return _sectionsLayout[section];
+	}
 	auto result = SectionInfo();
 	enumerateSections([searchForSection = section, &result](const SectionInfo &info) {
 		if (info.section == searchForSection) {
@@ -994,6 +1062,14 @@ StickersListWidget::SectionInfo StickersListWidget::sectionInfo(int section) con
 }
 
 StickersListWidget::SectionInfo StickersListWidget::sectionInfoByOffset(int yOffset) const {
+	if (sectionsLayoutValid() && !_sectionsLayout.empty()) {
+		const auto i = ranges::upper_bound(
+			_sectionsLayout,
+			yOffset,
+			ranges::less(),
+			&SectionInfo::rowsBottom);
+		return (i != end(_sectionsLayout)) ? *i : _sectionsLayout.back();
+	}
 	auto result = SectionInfo();
 	enumerateSections([this, &result, yOffset](const SectionInfo &info) {
 		if (yOffset < info.rowsBottom || info.section == shownSets().size() - 1) {
@@ -1021,6 +1097,7 @@ int StickersListWidget::countDesiredHeight(int newWidth) {
 		- st::buttonRadius;
 	_singleSize = QSize(singleWidth, singleWidth);
 	setColumnCount(columnCount);
+	refreshSectionsLayout();
 
 	auto visibleHeight = minimalHeight();
 	auto minimalHeight = (visibleHeight - st::stickerPanPadding);
@@ -1142,6 +1219,7 @@ void StickersListWidget::refreshSearchRows(
 		}
 	});
 
+	invalidateSectionsLayout();
 	_searchSets.clear();
 	fillLocalSearchRows(_searchNextQuery);
 
@@ -1473,7 +1551,9 @@ void StickersListWidget::paintStickers(Painter &p, QRect clip) {
 }
 
 void StickersListWidget::markLottieFrameShown(Set &set) {
-	if (const auto player = set.lottiePlayer) {
+	if (_lottieFastScroll) {
+		return;
+	} else if (const auto player = set.lottiePlayer) {
 		const auto paused = controller()->isGifPausedAtLeastFor(
 			Window::GifPauseReason::SavedGifs);
 		if (!paused) {
@@ -2101,6 +2181,7 @@ void StickersListWidget::refreshStickers() {
 }
 
 void StickersListWidget::refreshMySets() {
+	invalidateSectionsLayout();
 	_mySets.clear();
 	_favedStickersMap.clear();
 	_mySets.reserve(session().data().stickerSetsOrder().size() + 3);
@@ -2116,6 +2197,7 @@ void StickersListWidget::refreshMySets() {
 }
 
 void StickersListWidget::refreshFeaturedSets() {
+	invalidateSectionsLayout();
 	_featuredSets.clear();
 	_featuredSets.reserve(session().data().featuredStickerSetsOrder().size());
 
@@ -2126,6 +2208,7 @@ void StickersListWidget::refreshFeaturedSets() {
 }
 
 void StickersListWidget::refreshSearchSets() {
+	invalidateSectionsLayout();
 	refreshSearchIndex();
 
 	const auto &sets = session().data().stickerSets();
@@ -2341,6 +2424,7 @@ auto StickersListWidget::collectRecentStickers() -> std::vector<Sticker> {
 
 void StickersListWidget::refreshRecentStickers(bool performResize) {
 	clearSelection();
+	invalidateSectionsLayout();
 
 	auto recentPack = collectRecentStickers();
 	auto recentIt = std::find_if(_mySets.begin(), _mySets.end(), [](auto &set) {
@@ -2738,6 +2822,7 @@ void StickersListWidget::refreshMegagroupSetGeometry() {
 	_megagroupSetButtonTextWidth = st::stickerGroupCategoryAdd.font->width(_megagroupSetButtonText);
 	auto buttonWidth = _megagroupSetButtonTextWidth - st::stickerGroupCategoryAdd.width;
 	_megagroupSetButtonRect = QRect(left, top, buttonWidth, st::stickerGroupCategoryAdd.height);
+	invalidateSectionsLayout();
 }
 
 void StickersListWidget::showMegagroupSet(ChannelData *megagroup) {
@@ -196,8 +196,13 @@ private:
 
 	template <typename Callback>
 	bool enumerateSections(Callback callback) const;
+	template <typename Callback>
+	bool computeSections(Callback callback) const;
 	SectionInfo sectionInfo(int section) const;
 	SectionInfo sectionInfoByOffset(int yOffset) const;
+	void refreshSectionsLayout();
+	void invalidateSectionsLayout();
+	bool sectionsLayoutValid() const;
 
 	void setSection(Section section);
 	void displaySet(uint64 setId);
@@ -253,6 +258,7 @@ private:
 	void setupLottie(Set &set, int section, int index);
 	void markLottieFrameShown(Set &set);
 	void checkVisibleLottie();
+	void checkLottieFastScroll(int visibleTop, int visibleBottom);
 	void pauseInvisibleLottieIn(const SectionInfo &info);
 	void destroyLottieIn(Set &set);
 	void refillLottieData();
@@ -320,6 +326,15 @@ private:
 	int _columnCount = 1;
 	QSize _singleSize;
 
+	// Geometry of shownSets(), rebuilt in countDesiredHeight().
+	// The generation is bumped each time the shown sets are refilled.
+	std::vector<SectionInfo> _sectionsLayout;
+	int _sectionsGeneration = 0;
+	int _sectionsLayoutGeneration = -1;
+	Section _sectionsLayoutSection = Section::Stickers;
+	int _sectionsLayoutColumnCount = 0;
+	QSize _sectionsLayoutSingleSize;
+
 	OverState _selected;
 	OverState _pressed;
 	QPoint _lastMousePosition;
@@ -345,6 +360,10 @@ private:
 	mtpRequestId _searchRequestId = 0;
 
 	base::flat_map<uint64, LottieSet> _lottieData;
+	int _lottieScrollTop = 0;
+	crl::time _lottieScrollTime = 0;
+	bool _lottieFastScroll = false;
+	base::Timer _lottieFastScrollTimer;
 
 	rpl::event_stream<not_null<DocumentData*>> _chosen;
 	rpl::event_stream<> _scrollUpdated;
@@ -23,11 +23,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_session.h"
 #include "lang/lang_keys.h"
 #include "mainwindow.h"
+#include "core/application.h"
+#include "core/core_scheduler.h"
 #include "observer_peer.h"
 #include "apiwrap.h"
 #include "styles/style_chat_helpers.h"
 
 namespace ChatHelpers {
+namespace {
+
+constexpr auto kWarmUpDelay = crl::time(5000);
+constexpr auto kWarmUpIdleTime = crl::time(1000);
+
+} // namespace
 
 class TabbedSelector::SlideAnimation : public Ui::RoundShadowAnimation {
 public:
@@ -375,6 +383,9 @@ TabbedSelector::TabbedSelector(
 	setAttribute(Qt::WA_OpaquePaintEvent, false);
 	showAll();
 	hide();
+
+	_warmUpTimer.setCallback([=] { postWarmUp(); });
+	_warmUpTimer.callOnce(kWarmUpDelay);
 }
 
 TabbedSelector::~TabbedSelector() = default;
@@ -628,12 +639,42 @@ void TabbedSelector::hideFinished() {
 	_slideAnimation.reset();
 }
 
+void TabbedSelector::postWarmUp() {
+	if (!isHidden()) {
+		return;
+	}
+	const auto idle = crl::now() - Core::App().lastNonIdleTime();
+	if (idle < kWarmUpIdleTime) {
+		_warmUpTimer.callOnce(kWarmUpIdleTime - idle);
+		return;
+	}
+	Core::App().scheduler().post(
+		Core::TaskPriority::Background,
+		"tabbed_warm_up",
+		crl::guard(this, [=] { warmUp(); }));
+}
+
+void TabbedSelector::warmUp() {
+	if (!isHidden() || _warmedUpTab) {
+		return;
+	}
+
+	// Prepare the tab that will be shown first, so that the first panel
+	// opening doesn't have to build the layout and request thumbnails.
+	currentTab()->widget()->refreshRecent();
+	currentTab()->widget()->preloadImages();
+	_warmedUpTab = _currentTabType;
+}
+
 void TabbedSelector::showStarted() {
+	_warmUpTimer.cancel();
 	if (full()) {
 		session().api().updateStickers();
 	}
-	currentTab()->widget()->refreshRecent();
-	currentTab()->widget()->preloadImages();
+	if (base::take(_warmedUpTab) != _currentTabType) {
+		currentTab()->widget()->refreshRecent();
+		currentTab()->widget()->preloadImages();
+	}
 	_a_slide.stop();
 	_slideAnimation.reset();
 	showAll();
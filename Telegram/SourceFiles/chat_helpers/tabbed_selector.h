@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/sender.h"
 #include "main/main_session.h"
 #include "base/object_ptr.h"
+#include "base/timer.h"
 
 namespace InlineBots {
 class Result;
@@ -158,6 +159,8 @@ private:
 	void handleScroll();
 
 	QImage grabForAnimation();
+	void postWarmUp();
+	void warmUp();
 
 	void scrollToY(int y);
 
@@ -202,6 +205,8 @@ private:
 	object_ptr<Ui::FlatLabel> _restrictedLabel = { nullptr };
 	std::array<Tab, Tab::kCount> _tabs;
 	SelectorTab _currentTabType = SelectorTab::Emoji;
+	base::Timer _warmUpTimer;
+	std::optional<SelectorTab> _warmedUpTab;
 
 	Fn<void(SelectorTab)> _afterShownCallback;
 	Fn<void(SelectorTab)> _beforeHidingCallback;
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_document.h"
 #include "data/data_session.h"
 #include "data/data_user.h"
+#include "data/data_streaming.h"
 #include "base/timer.h"
 #include "base/concurrent_timer.h"
 #include "base/unixtime.h"
@@ -20,6 +21,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/local_url_handlers.h"
 #include "core/launcher.h"
 #include "core/ui_integration.h"
+#include "core/core_scheduler.h"
+#include "core/core_proxy_rotation.h"
+#include "core/core_stall_watchdog.h"
+#include "core/media_active_cache.h"
+#include "core/memory_usage.h"
 #include "chat_helpers/emoji_keywords.h"
 #include "storage/localstorage.h"
 #include "platform/platform_specific.h"
@@ -74,6 +80,7 @@ namespace Core {
 namespace {
 
 constexpr auto kQuitPreventTimeoutMs = 1500;
+constexpr auto kMemoryUsageLogTimeout = 10 * 60 * crl::time(1000);
 
 } // namespace
 
@@ -81,6 +88,7 @@ Application *Application::Instance = nullptr;
 
 struct Application::Private {
 	base::Timer quitTimer;
+	base::Timer memoryUsageTimer;
 	UiIntegration uiIntegration;
 };
 
@@ -88,6 +96,7 @@ Application::Application(not_null<Launcher*> launcher)
 : QObject()
 , _launcher(launcher)
 , _private(std::make_unique<Private>())
+, _scheduler(std::make_unique<Scheduler>())
 , _databases(std::make_unique<Storage::Databases>())
 , _animationsManager(std::make_unique<Ui::Animations::Manager>())
 , _dcOptions(std::make_unique<MTP::DcOptions>())
@@ -122,6 +131,8 @@ Application::Application(not_null<Launcher*> launcher)
 }
 
 Application::~Application() {
+	Platform::SetMemoryPressureCallback(nullptr);
+
 	_window.reset();
 	if (_mediaView) {
 		_mediaView->clearData();
@@ -136,6 +147,9 @@ Application::~Application() {
 	// In case it gets called after destroySession() we get missing data.
 	Local::finish();
 
+	_proxyRotation = nullptr;
+	_stallWatchdog = nullptr;
+
 	// Some MTP requests can be cancelled from data clearing.
 	unlockTerms();
 	activeAccount().destroySession();
@@ -160,6 +174,16 @@ Application::~Application() {
 }
 
 void Application::run() {
+	const auto launched = crl::now();
+	auto phaseStarted = launched;
+	const auto logPhase = [&](const char *phase) {
+		const auto now = crl::now();
+		LOG(("Startup Info: %1 took %2 ms."
+			).arg(phase
+			).arg(now - phaseStarted));
+		phaseStarted = now;
+	};
+
 	style::internal::StartFonts();
 
 	ThirdParty::start();
@@ -168,6 +192,12 @@ void Application::run() {
 
 	startLocalStorage();
 	ValidateScale();
+	logPhase("settings");
+
+	_proxyRotation = std::make_unique<ProxyRotation>();
+	if (Logs::DebugEnabled()) {
+		_stallWatchdog = std::make_unique<StallWatchdog>();
+	}
 
 	if (Local::oldSettingsVersion() < AppVersion) {
 		psNewVersion();
@@ -186,6 +216,7 @@ void Application::run() {
 	Ui::InitTextOptions();
 	Ui::Emoji::Init();
 	Media::Player::start(_audio.get());
+	logPhase("style and media");
 
 	style::ShortAnimationPlaying(
 	) | rpl::start_with_next([=](bool playing) {
@@ -219,11 +250,14 @@ void Application::run() {
 		&Application::stateChanged);
 
 	DEBUG_LOG(("Application Info: window created..."));
+	logPhase("window");
 
 	startShortcuts();
 	App::initMedia();
+	Platform::SetMemoryPressureCallback([=] { handleMemoryPressure(); });
 
 	Local::ReadMapState state = Local::readMap(QByteArray());
+	logPhase("local map");
 	if (state == Local::ReadMapPassNeeded) {
 		Global::SetLocalPasscode(true);
 		Global::RefLocalPasscodeChanged().notify();
@@ -241,6 +275,8 @@ void Application::run() {
 	}
 	DEBUG_LOG(("Application Info: showing."));
 	_window->firstShow();
+	logPhase("first show");
+	LOG(("Startup Info: total %1 ms.").arg(crl::now() - launched));
 
 	if (!locked() && cStartToSettings()) {
 		_window->showSettings();
@@ -253,6 +289,18 @@ void Application::run() {
 	}
 }
 
+void Application::handleMemoryPressure() {
+	const auto streaming = activeAccount().sessionExists()
+		? activeAccount().session().data().streaming().clearAllKeptAlive()
+		: int64(0);
+	const auto cached = MediaActiveCacheBase::Trim();
+	LOG(("Memory Info: system is low on memory, "
+		"unloaded %1 bytes of media caches "
+		"and %2 bytes of kept alive streaming."
+		).arg(cached
+		).arg(streaming));
+}
+
 bool Application::hideMediaView() {
 	if (_mediaView && !_mediaView->isHidden()) {
 		_mediaView->hide();
@@ -417,7 +465,20 @@ void Application::startLocalStorage() {
 		});
 	}, _lifetime);
 
+	_dcOptions->preferredChanged(
+	) | rpl::start_with_next([=] {
+		saveSettingsDelayed();
+	}, _lifetime);
+
 	_saveSettingsTimer.setCallback([=] { Local::writeSettings(); });
+
+	// Track the growth of long-lived sessions in the debug logs.
+	_private->memoryUsageTimer.setCallback([] {
+		if (Logs::DebugEnabled()) {
+			LogMemoryUsage();
+		}
+	});
+	_private->memoryUsageTimer.callEach(kMemoryUsageLogTimeout);
 }
 
 void Application::forceLogOut(const TextWithEntities &explanation) {
@@ -487,6 +548,9 @@ void Application::switchDebugMode() {
 		Logs::SetDebugEnabled(true);
 		_launcher->writeDebugModeSetting();
 		DEBUG_LOG(("Debug logs started."));
+		if (!_stallWatchdog) {
+			_stallWatchdog = std::make_unique<StallWatchdog>();
+		}
 		Ui::hideLayer();
 	}
 }
@@ -76,6 +76,9 @@ struct CloudTheme;
 namespace Core {
 
 class Launcher;
+class Scheduler;
+class ProxyRotation;
+class StallWatchdog;
 struct LocalUrlHandler;
 
 class Application final : public QObject, private base::Subscriber {
@@ -140,6 +143,9 @@ public:
 		MTP::ProxyData::Settings settings);
 	[[nodiscard]] rpl::producer<ProxyChange> proxyChanges() const;
 	void badMtprotoConfigurationError();
+	[[nodiscard]] ProxyRotation &proxyRotation() {
+		return *_proxyRotation;
+	}
 
 	// Databases.
 	[[nodiscard]] Storage::Databases &databases() {
@@ -171,6 +177,9 @@ public:
 	ChatHelpers::EmojiKeywords &emojiKeywords() {
 		return *_emojiKeywords;
 	}
+	[[nodiscard]] Scheduler &scheduler() {
+		return *_scheduler;
+	}
 
 	// Internal links.
 	void setInternalLinkDomain(const QString &domain) const;
@@ -235,6 +244,7 @@ private:
 	void startShortcuts();
 
 	void stateChanged(Qt::ApplicationState state);
+	void handleMemoryPressure();
 
 	friend void App::quit();
 	static void QuitAttempt();
@@ -264,6 +274,7 @@ private:
 	// Some fields are just moved from the declaration.
 	struct Private;
 	const std::unique_ptr<Private> _private;
+	const std::unique_ptr<Scheduler> _scheduler;
 	Settings _settings;
 
 	const std::unique_ptr<Storage::Databases> _databases;
@@ -286,6 +297,8 @@ private:
 	rpl::variable<bool> _passcodeLock;
 	rpl::event_stream<bool> _termsLockChanges;
 	std::unique_ptr<Window::TermsLock> _termsLock;
+	std::unique_ptr<ProxyRotation> _proxyRotation;
+	std::unique_ptr<StallWatchdog> _stallWatchdog;
 
 	base::Timer _saveSettingsTimer;
 
@@ -0,0 +1,250 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_proxy_rotation.h"
+
+#include "core/application.h"
+#include "main/main_account.h"
+#include "mtproto/facade.h"
+#include "mtproto/dc_options.h"
+#include "storage/localstorage.h"
+#include "facades.h"
+
+namespace Core {
+namespace {
+
+constexpr auto kCheckInterval = 5 * crl::time(1000);
+
+// The proxy is switched if the current one can't connect for that long.
+constexpr auto kStuckTimeout = 15 * crl::time(1000);
+
+// Connected proxies are probed rarely, the stuck ones on each check.
+constexpr auto kProbeInterval = 10 * 60 * crl::time(1000);
+constexpr auto kStuckProbeInterval = 30 * crl::time(1000);
+constexpr auto kProbeTimeout = 10 * crl::time(1000);
+
+// A working proxy is replaced only by a twice faster one and not more
+// often than once in that time, so close proxies don't flip back and forth.
+constexpr auto kMinSwitchInterval = 30 * 60 * crl::time(1000);
+constexpr auto kFasterRatio = 2;
+constexpr auto kMinPings = 2;
+
+} // namespace
+
+ProxyRotation::ProxyRotation() : _timer([=] { check(); }) {
+	subscribe(Global::RefConnectionTypeChanged(), [=] {
+		refresh();
+	});
+	refresh();
+}
+
+ProxyRotation::~ProxyRotation() = default;
+
+void ProxyRotation::refresh() {
+	if (!enabled()) {
+		_timer.cancel();
+		_probes.clear();
+		_connectingSince = 0;
+	} else if (!_timer.isActive()) {
+		_timer.callEach(kCheckInterval);
+	}
+}
+
+bool ProxyRotation::enabled() const {
+	return Core::App().settings().proxyRotationEnabled()
+		&& (Global::ProxySettings() == ProxyData::Settings::Enabled)
+		&& (Global::ProxiesList().size() > 1);
+}
+
+auto ProxyRotation::score(const ProxyData &proxy) -> Score & {
+	const auto i = ranges::find(_scores, proxy, &Score::proxy);
+	if (i != end(_scores)) {
+		return *i;
+	}
+	_scores.push_back({ proxy });
+	return _scores.back();
+}
+
+auto ProxyRotation::best() const -> const Score * {
+	const auto &list = Global::ProxiesList();
+	auto result = (const Score*)nullptr;
+	for (const auto &score : _scores) {
+		if (!score.pings
+			|| score.failures > 0
+			|| ranges::find(list, score.proxy) == end(list)) {
+			continue;
+		} else if (!result || result->ping > score.ping) {
+			result = &score;
+		}
+	}
+	return result;
+}
+
+void ProxyRotation::check() {
+	if (!enabled()) {
+		refresh();
+		return;
+	}
+	const auto now = crl::now();
+	if (MTP::dcstate() == MTP::ConnectedState) {
+		_connectingSince = 0;
+	} else if (!_connectingSince) {
+		_connectingSince = now;
+	}
+	if (!_probes.empty() && now - _probed >= kProbeTimeout) {
+		finishProbes();
+	}
+	const auto stuck = _connectingSince
+		&& (now - _connectingSince >= kStuckTimeout);
+	const auto interval = stuck ? kStuckProbeInterval : kProbeInterval;
+	if (_probes.empty() && (!_probed || now - _probed >= interval)) {
+		probe();
+	}
+}
+
+void ProxyRotation::probe() {
+	const auto &list = Global::ProxiesList();
+	_scores.erase(ranges::remove_if(_scores, [&](const Score &score) {
+		return ranges::find(list, score.proxy) == end(list);
+	}), end(_scores));
+
+	_probed = crl::now();
+	for (const auto &proxy : list) {
+		probe(proxy);
+	}
+}
+
+void ProxyRotation::probe(const ProxyData &proxy) {
+	using Variants = MTP::DcOptions::Variants;
+	using Connection = MTP::details::AbstractConnection;
+
+	const auto mtproto = Core::App().activeAccount().mtp();
+	if (!mtproto) {
+		return;
+	}
+	const auto type = (proxy.type == ProxyData::Type::Http)
+		? Variants::Http
+		: Variants::Tcp;
+	const auto dcId = mtproto->mainDcId();
+	const auto create = [&](const bytes::vector &secret) {
+		_probes.push_back({ proxy, Connection::Create(
+			mtproto,
+			type,
+			QThread::currentThread(),
+			secret,
+			proxy) });
+		const auto pointer = _probes.back().checker.get();
+		pointer->connect(pointer, &Connection::connected, [=] {
+			probeDone(pointer);
+		});
+		pointer->connect(pointer, &Connection::disconnected, [=] {
+			probeFailed(pointer);
+		});
+		pointer->connect(pointer, &Connection::error, [=] {
+			probeFailed(pointer);
+		});
+		return pointer;
+	};
+	if (proxy.type == ProxyData::Type::Mtproto) {
+		const auto secret = proxy.secretFromMtprotoPassword();
+		create(secret)->connectToServer(
+			proxy.host,
+			proxy.port,
+			secret,
+			dcId);
+		return;
+	}
+	const auto options = mtproto->dcOptions()->lookup(
+		dcId,
+		MTP::DcType::Regular,
+		true);
+	const auto &v4 = options.data[Variants::IPv4][type];
+	const auto &v6 = options.data[Variants::IPv6][type];
+	const auto &list = (v4.empty() && Global::TryIPv6()) ? v6 : v4;
+	if (list.empty()) {
+		return;
+	}
+	const auto &endpoint = list.front();
+	create(endpoint.secret)->connectToServer(
+		QString::fromStdString(endpoint.ip),
+		endpoint.port,
+		endpoint.secret,
+		dcId);
+}
+
+void ProxyRotation::probeDone(
+		not_null<MTP::details::AbstractConnection*> checker) {
+	const auto i = ranges::find(_probes, checker.get(), [](const Probe &p) {
+		return p.checker.get();
+	});
+	if (i == end(_probes)) {
+		return;
+	}
+	auto &score = this->score(i->proxy);
+	const auto ping = std::max(checker->pingTime(), crl::time(1));
+	score.ping = score.pings ? ((score.ping * 3 + ping) / 4) : ping;
+	++score.pings;
+	score.failures = 0;
+	_probes.erase(i);
+	if (_probes.empty()) {
+		switchIfBetter();
+	}
+}
+
+void ProxyRotation::probeFailed(
+		not_null<MTP::details::AbstractConnection*> checker) {
+	const auto i = ranges::find(_probes, checker.get(), [](const Probe &p) {
+		return p.checker.get();
+	});
+	if (i == end(_probes)) {
+		return;
+	}
+	++score(i->proxy).failures;
+	_probes.erase(i);
+	if (_probes.empty()) {
+		switchIfBetter();
+	}
+}
+
+void ProxyRotation::finishProbes() {
+	for (const auto &probe : base::take(_probes)) {
+		++score(probe.proxy).failures;
+	}
+	switchIfBetter();
+}
+
+void ProxyRotation::switchIfBetter() {
+	const auto current = Global::SelectedProxy();
+	const auto &was = score(current);
+	const auto found = best();
+	if (!found || found->proxy == current) {
+		return;
+	}
+	const auto now = crl::now();
+	const auto stuck = _connectingSince
+		&& (now - _connectingSince >= kStuckTimeout);
+	const auto faster = (now - _switched >= kMinSwitchInterval)
+		&& (was.pings >= kMinPings)
+		&& (found->pings >= kMinPings)
+		&& (found->ping * kFasterRatio < was.ping);
+	if (!stuck && !faster) {
+		return;
+	}
+	LOG(("Proxy Info: switching from %1:%2 to %3:%4, ping %5 ms."
+		).arg(current.host
+		).arg(current.port
+		).arg(found->proxy.host
+		).arg(found->proxy.port
+		).arg(found->ping));
+	const auto proxy = found->proxy;
+	_switched = now;
+	_connectingSince = 0;
+	Core::App().setCurrentProxy(proxy, ProxyData::Settings::Enabled);
+	Local::writeSettings();
+}
+
+} // namespace Core
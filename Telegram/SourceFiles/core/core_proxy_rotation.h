@@ -0,0 +1,62 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+#include "base/observer.h"
+#include "mtproto/connection_abstract.h"
+#include "mtproto/mtproto_proxy_data.h"
+
+namespace Core {
+
+// Probes the saved proxies in the background, keeps a smoothed ping
+// and a failures count for each of them and switches to the best one
+// when the current proxy can't connect or is much slower.
+class ProxyRotation final : private base::Subscriber {
+public:
+	ProxyRotation();
+	~ProxyRotation();
+
+	// Starts or stops the checks after the settings were changed.
+	void refresh();
+
+private:
+	using ProxyData = MTP::ProxyData;
+	using Checker = MTP::details::ConnectionPointer;
+	struct Score {
+		ProxyData proxy;
+		crl::time ping = 0;
+		int pings = 0;
+		int failures = 0;
+	};
+	struct Probe {
+		ProxyData proxy;
+		Checker checker;
+	};
+
+	[[nodiscard]] bool enabled() const;
+	[[nodiscard]] Score &score(const ProxyData &proxy);
+	[[nodiscard]] const Score *best() const;
+	void check();
+	void probe();
+	void probe(const ProxyData &proxy);
+	void probeDone(not_null<MTP::details::AbstractConnection*> checker);
+	void probeFailed(not_null<MTP::details::AbstractConnection*> checker);
+	void finishProbes();
+	void switchIfBetter();
+
+	base::Timer _timer;
+	std::vector<Score> _scores;
+	std::vector<Probe> _probes;
+	crl::time _connectingSince = 0;
+	crl::time _probed = 0;
+	crl::time _switched = 0;
+
+};
+
+} // namespace Core
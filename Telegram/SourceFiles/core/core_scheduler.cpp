@@ -0,0 +1,141 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_scheduler.h"
+
+namespace Core {
+namespace {
+
+// Half of a 60 fps frame, the rest is left for layout and painting.
+constexpr auto kFrameBudget = crl::time(8);
+constexpr auto kLongTaskDuration = crl::time(50);
+constexpr auto kStatisticsLogInterval = 5 * 60 * crl::time(1000);
+
+[[nodiscard]] int PriorityIndex(TaskPriority priority) {
+	return static_cast<int>(priority);
+}
+
+} // namespace
+
+void Scheduler::Statistics::add(crl::time duration) {
+	auto bucket = 0;
+	for (auto till = crl::time(1); bucket + 1 < kBuckets; till *= 2) {
+		if (duration < till) {
+			break;
+		}
+		++bucket;
+	}
+	++buckets[bucket];
+	++count;
+	total += duration;
+	accumulate_max(longest, duration);
+}
+
+Scheduler::Scheduler()
+: _statisticsTimer([=] { logStatistics(); }) {
+	_statisticsTimer.callEach(kStatisticsLogInterval);
+}
+
+void Scheduler::post(
+		TaskPriority priority,
+		const char *category,
+		FnMut<void()> task) {
+	Expects(task != nullptr);
+
+	_queues[PriorityIndex(priority)].push_back({
+		category,
+		std::move(task)
+	});
+	schedule();
+}
+
+void Scheduler::schedule() {
+	if (_scheduled) {
+		return;
+	}
+	_scheduled = true;
+	crl::on_main(this, [=] {
+		_scheduled = false;
+		process();
+	});
+}
+
+bool Scheduler::empty() const {
+	return ranges::all_of(_queues, [](const std::deque<Task> &queue) {
+		return queue.empty();
+	});
+}
+
+void Scheduler::process() {
+	const auto started = crl::now();
+	const auto spent = [&] {
+		return crl::now() - started;
+	};
+
+	// Input and paint tasks are never postponed to the next frame.
+	// Only the tasks queued before the pass are run, the ones that
+	// they post wait for the next pass, so a pass always ends.
+	for (const auto priority : { TaskPriority::Input, TaskPriority::Paint }) {
+		auto &queue = _queues[PriorityIndex(priority)];
+		auto left = queue.size();
+		while (left-- > 0 && runOne(queue)) {
+		}
+	}
+	for (const auto priority : {
+			TaskPriority::VisibleData,
+			TaskPriority::Background }) {
+		auto &queue = _queues[PriorityIndex(priority)];
+		auto left = queue.size();
+		while (left-- > 0 && spent() < kFrameBudget && runOne(queue)) {
+		}
+	}
+	if (!empty()) {
+		schedule();
+	}
+}
+
+bool Scheduler::runOne(std::deque<Task> &queue) {
+	if (queue.empty()) {
+		return false;
+	}
+	auto task = std::move(queue.front());
+	queue.pop_front();
+
+	const auto started = crl::now();
+	task.callback();
+	const auto duration = crl::now() - started;
+	_statistics[task.category].add(duration);
+	if (duration >= kLongTaskDuration) {
+		DEBUG_LOG(("Scheduler Warning: '%1' task took %2 ms."
+			).arg(task.category
+			).arg(duration));
+	}
+	return true;
+}
+
+void Scheduler::logStatistics() {
+	if (_statistics.empty()) {
+		return;
+	}
+	for (const auto &[category, statistics] : _statistics) {
+		auto histogram = QStringList();
+		for (const auto count : statistics.buckets) {
+			histogram.push_back(QString::number(count));
+		}
+		DEBUG_LOG(("Scheduler Info: '%1' runs %2, total %3 ms, "
+			"longest %4 ms, ms histogram "
+			"[<1,<2,<4,<8,<16,<32,>=32] %5."
+			).arg(category
+			).arg(statistics.count
+			).arg(statistics.total
+			).arg(statistics.longest
+			).arg(histogram.join(',')));
+	}
+	_statistics.clear();
+}
+
+} // namespace Core
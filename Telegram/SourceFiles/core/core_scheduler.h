@@ -0,0 +1,68 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+#include "base/weak_ptr.h"
+
+#include <deque>
+
+namespace Core {
+
+enum class TaskPriority : uchar {
+	Input,
+	Paint,
+	VisibleData,
+	Background,
+};
+
+// Runs main thread work in priority order, yielding to the event loop
+// once the frame budget is spent, so that input and painting happen
+// between the parts of a long batch. Run times are collected per task
+// category and logged from time to time to help finding what janks.
+class Scheduler final : public base::has_weak_ptr {
+public:
+	Scheduler();
+
+	// Category must be a string literal, it is compared by pointer.
+	void post(
+		TaskPriority priority,
+		const char *category,
+		FnMut<void()> task);
+
+	void logStatistics();
+
+private:
+	struct Task {
+		const char *category = nullptr;
+		FnMut<void()> callback;
+	};
+	struct Statistics {
+		static constexpr auto kBuckets = 7;
+
+		void add(crl::time duration);
+
+		std::array<int, kBuckets> buckets = { { 0 } };
+		int count = 0;
+		crl::time total = 0;
+		crl::time longest = 0;
+	};
+
+	void schedule();
+	void process();
+	bool runOne(std::deque<Task> &queue);
+	[[nodiscard]] bool empty() const;
+
+	std::array<std::deque<Task>, 4> _queues;
+	base::flat_map<const char*, Statistics> _statistics;
+	base::Timer _statisticsTimer;
+	bool _scheduled = false;
+
+};
+
+} // namespace Core
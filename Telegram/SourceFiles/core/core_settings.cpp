@@ -16,14 +16,18 @@ Settings::Variables::Variables() {
 
 QByteArray Settings::serialize() const {
 	const auto themesAccentColors = _variables.themesAccentColors.serialize();
-	auto size = Serialize::bytearraySize(themesAccentColors);
+	auto size = Serialize::bytearraySize(themesAccentColors)
+		+ sizeof(qint32) * 2;
 
 	auto result = QByteArray();
 	result.reserve(size);
 	{
 		QDataStream stream(&result, QIODevice::WriteOnly);
 		stream.setVersion(QDataStream::Qt_5_1);
-		stream << themesAccentColors;
+		stream
+			<< themesAccentColors
+			<< qint32(_variables.hardwareAcceleratedVideo ? 1 : 0)
+			<< qint32(_variables.proxyRotationEnabled ? 1 : 0);
 	}
 	return result;
 }
@@ -36,8 +40,18 @@ void Settings::constructFromSerialized(const QByteArray &serialized) {
 	QDataStream stream(serialized);
 	stream.setVersion(QDataStream::Qt_5_1);
 	QByteArray themesAccentColors;
+	qint32 hardwareAcceleratedVideo = _variables.hardwareAcceleratedVideo
+		? 1
+		: 0;
+	qint32 proxyRotationEnabled = _variables.proxyRotationEnabled ? 1 : 0;
 
 	stream >> themesAccentColors;
+	if (!stream.atEnd()) {
+		stream >> hardwareAcceleratedVideo;
+	}
+	if (!stream.atEnd()) {
+		stream >> proxyRotationEnabled;
+	}
 	if (stream.status() != QDataStream::Ok) {
 		LOG(("App Error: "
 			"Bad data for Core::Settings::constructFromSerialized()"));
@@ -46,6 +60,8 @@ void Settings::constructFromSerialized(const QByteArray &serialized) {
 	if (!_variables.themesAccentColors.setFromSerialized(themesAccentColors)) {
 		return;
 	}
+	_variables.hardwareAcceleratedVideo = (hardwareAcceleratedVideo == 1);
+	_variables.proxyRotationEnabled = (proxyRotationEnabled == 1);
 }
 
 } // namespace Core
@@ -25,12 +25,26 @@ public:
 	[[nodiscard]] Window::Theme::AccentColors &themesAccentColors() {
 		return _variables.themesAccentColors;
 	}
+	void setHardwareAcceleratedVideo(bool enabled) {
+		_variables.hardwareAcceleratedVideo = enabled;
+	}
+	[[nodiscard]] bool hardwareAcceleratedVideo() const {
+		return _variables.hardwareAcceleratedVideo;
+	}
+	void setProxyRotationEnabled(bool enabled) {
+		_variables.proxyRotationEnabled = enabled;
+	}
+	[[nodiscard]] bool proxyRotationEnabled() const {
+		return _variables.proxyRotationEnabled;
+	}
 
 private:
 	struct Variables {
 		Variables();
 
 		Window::Theme::AccentColors themesAccentColors;
+		bool hardwareAcceleratedVideo = true;
+		bool proxyRotationEnabled = false;
 	};
 
 	Variables _variables;
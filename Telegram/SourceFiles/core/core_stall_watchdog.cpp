@@ -0,0 +1,90 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_stall_watchdog.h"
+
+#include "core/crash_reports.h"
+
+namespace Core {
+namespace {
+
+constexpr auto kHeartbeatInterval = crl::time(100);
+constexpr auto kWatchInterval = crl::time(250);
+
+// A late heartbeat means the event loop was blocked for that long.
+constexpr auto kLagThreshold = crl::time(200);
+
+// Without heartbeats for that long the main thread is reported stalled.
+constexpr auto kStallThreshold = crl::time(1000);
+
+constexpr auto kStallAnnotation = "MainThreadStall";
+
+} // namespace
+
+StallWatchdog::StallWatchdog() : _heartbeat([=] { heartbeat(); }) {
+	heartbeat();
+	_heartbeat.callEach(kHeartbeatInterval);
+	_thread = std::thread([=] { watch(); });
+}
+
+StallWatchdog::~StallWatchdog() {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finished = true;
+	}
+	_wake.notify_one();
+	_thread.join();
+	CrashReports::ClearAnnotation(kStallAnnotation);
+}
+
+void StallWatchdog::heartbeat() {
+	const auto now = crl::now();
+	const auto profile = crl::profile();
+	if (_lastHeartbeatTime) {
+		const auto lag = now - _lastHeartbeatTime - kHeartbeatInterval;
+		if (lag >= kLagThreshold) {
+			DEBUG_LOG(("Main Thread Stall: event loop was blocked for %1 ms."
+				).arg(lag));
+			if (const auto sink = Logs::TraceSinkInstance.load()) {
+				sink("main", "stall", _lastHeartbeatProfile, profile);
+			}
+		}
+	}
+	if (_reported.exchange(0)) {
+		CrashReports::ClearAnnotation(kStallAnnotation);
+	}
+	_lastHeartbeatTime = now;
+	_lastHeartbeatProfile = profile;
+	_lastHeartbeat = now;
+}
+
+void StallWatchdog::watch() {
+	auto reportedFor = crl::time(0);
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_finished) {
+		_wake.wait_for(lock, std::chrono::milliseconds(kWatchInterval));
+		if (_finished) {
+			break;
+		}
+		const auto last = _lastHeartbeat.load();
+		const auto stalled = crl::now() - last;
+		if (stalled < kStallThreshold || reportedFor == last) {
+			continue;
+		}
+		reportedFor = last;
+		_reported = last;
+
+		// Reported right away, the main thread may never recover.
+		DEBUG_LOG(("Main Thread Stall: not responding for %1 ms."
+			).arg(stalled));
+		CrashReports::SetAnnotation(
+			kStallAnnotation,
+			QString::number(stalled) + " ms");
+	}
+}
+
+} // namespace Core
@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Core {
+
+// Created only with debug logs enabled. The main thread ticks a timer,
+// a separate thread logs when the ticks stop coming for too long, so
+// a stall is reported while it lasts, not only after it ends.
+class StallWatchdog final {
+public:
+	StallWatchdog();
+	~StallWatchdog();
+
+private:
+	void heartbeat();
+	void watch();
+
+	base::Timer _heartbeat;
+	crl::time _lastHeartbeatTime = 0;
+	int64 _lastHeartbeatProfile = 0;
+
+	std::atomic<crl::time> _lastHeartbeat = 0;
+	std::atomic<crl::time> _reported = 0;
+
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	bool _finished = false;
+	std::thread _thread;
+
+};
+
+} // namespace Core
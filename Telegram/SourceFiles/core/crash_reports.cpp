@@ -170,6 +170,8 @@ void SignalHandler(int signum) {
 	QMutexLocker lock(&ReportingMutex);
 	ReportingThreadId = thread;
 
+	Logs::writeQueuedOnCrash();
+
 	if (!ReportingHeaderWritten) {
 		ReportingHeaderWritten = true;
 		auto dec2hex = [](int value) -> char {
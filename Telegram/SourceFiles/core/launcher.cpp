@@ -385,6 +385,7 @@ void Launcher::processArguments() {
 	auto parseMap = std::map<QByteArray, KeyFormat> {
 		{ "-testmode"       , KeyFormat::NoValues },
 		{ "-debug"          , KeyFormat::NoValues },
+		{ "-trace"          , KeyFormat::NoValues },
 		{ "-many"           , KeyFormat::NoValues },
 		{ "-key"            , KeyFormat::OneValue },
 		{ "-autostart"      , KeyFormat::NoValues },
@@ -398,6 +399,10 @@ void Launcher::processArguments() {
 		{ "-workdir"        , KeyFormat::OneValue },
 		{ "--"              , KeyFormat::OneValue },
 		{ "-scale"          , KeyFormat::OneValue },
+#ifdef _DEBUG
+		{ "-mtprecord"      , KeyFormat::OneValue },
+		{ "-mtpreplay"      , KeyFormat::OneValue },
+#endif // _DEBUG
 	};
 	auto parseResult = QMap<QByteArray, QStringList>();
 	auto parsingKey = QByteArray();
@@ -427,6 +432,7 @@ void Launcher::processArguments() {
 	}
 	gTestMode = parseResult.contains("-testmode");
 	Logs::SetDebugEnabled(parseResult.contains("-debug"));
+	Logs::SetTraceEnabled(parseResult.contains("-trace"));
 	gManyInstance = parseResult.contains("-many");
 	gKeyFile = parseResult.value("-key", {}).join(QString()).toLower();
 	gKeyFile = gKeyFile.replace(QRegularExpression("[^a-z0-9\\-_]"), {});
@@ -447,6 +453,12 @@ void Launcher::processArguments() {
 		}
 	}
 	gStartUrl = parseResult.value("--", {}).join(QString());
+#ifdef _DEBUG
+	// Recording writes the decrypted traffic to a file in plain text,
+	// so release builds don't even accept these arguments.
+	gMtpRecordPath = parseResult.value("-mtprecord", {}).join(QString());
+	gMtpReplayPath = parseResult.value("-mtpreplay", {}).join(QString());
+#endif // _DEBUG
 
 	const auto scaleKey = parseResult.value("-scale", {});
 	if (scaleKey.size() > 0) {
@@ -11,11 +11,53 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace Core {
 
+// All the media caches also share one total limit. When their usage sum
+// is over it entries are unloaded from the cache that uses the biggest
+// part of its own limit, so that no single kind of media is emptied.
+class MediaActiveCacheBase {
+public:
+	static constexpr auto kDefaultTotalLimit = int64(192 * 1024 * 1024);
+
+	static void SetTotalLimit(int64 limit);
+	[[nodiscard]] static int64 TotalLimit();
+	[[nodiscard]] static int64 TotalUsage();
+
+	// Unloads the least recently used half of all the caches,
+	// returns the unloaded bytes count.
+	static int64 Trim();
+
+	struct Usage {
+		const char *name = nullptr;
+		int64 usage = 0;
+		int64 limit = 0;
+	};
+	[[nodiscard]] static std::vector<Usage> Usages();
+
+protected:
+	MediaActiveCacheBase(const char *name, int64 limit);
+	~MediaActiveCacheBase();
+
+	// Returns false if there was nothing to unload.
+	virtual bool unloadLowest() = 0;
+
+	static void CheckTotal();
+	static void Reduce(int64 limit);
+
+	const char *_name = nullptr;
+	int64 _usage = 0;
+	int64 _limit = 0;
+
+private:
+	[[nodiscard]] static std::vector<MediaActiveCacheBase*> &Caches();
+	[[nodiscard]] static int64 &Limit();
+
+};
+
 template <typename Type>
-class MediaActiveCache {
+class MediaActiveCache final : public MediaActiveCacheBase {
 public:
 	template <typename Unload>
-	MediaActiveCache(int64 limit, Unload &&unload);
+	MediaActiveCache(const char *name, int64 limit, Unload &&unload);
 
 	void up(Type *entry);
 	void remove(Type *entry);
@@ -25,21 +67,109 @@ public:
 	void decrement(int64 amount);
 
 private:
-	template <typename Unload>
-	void check(Unload &&unload);
+	void check();
+	bool unloadLowest() override;
 
 	base::last_used_cache<Type*> _cache;
+	Fn<void(Type*)> _unload;
 	SingleQueuedInvokation _delayed;
-	int64 _usage = 0;
-	int64 _limit = 0;
 
 };
 
+inline MediaActiveCacheBase::MediaActiveCacheBase(
+	const char *name,
+	int64 limit)
+: _name(name)
+, _limit(limit) {
+	Caches().push_back(this);
+}
+
+inline MediaActiveCacheBase::~MediaActiveCacheBase() {
+	auto &caches = Caches();
+	caches.erase(
+		std::remove(begin(caches), end(caches), this),
+		end(caches));
+}
+
+inline std::vector<MediaActiveCacheBase*> &MediaActiveCacheBase::Caches() {
+	static auto result = std::vector<MediaActiveCacheBase*>();
+	return result;
+}
+
+inline int64 &MediaActiveCacheBase::Limit() {
+	static auto result = kDefaultTotalLimit;
+	return result;
+}
+
+inline void MediaActiveCacheBase::SetTotalLimit(int64 limit) {
+	Limit() = limit;
+	CheckTotal();
+}
+
+inline int64 MediaActiveCacheBase::TotalLimit() {
+	return Limit();
+}
+
+inline int64 MediaActiveCacheBase::TotalUsage() {
+	auto result = int64(0);
+	for (const auto cache : Caches()) {
+		result += cache->_usage;
+	}
+	return result;
+}
+
+inline auto MediaActiveCacheBase::Usages() -> std::vector<Usage> {
+	auto result = std::vector<Usage>();
+	result.reserve(Caches().size());
+	for (const auto cache : Caches()) {
+		result.push_back({ cache->_name, cache->_usage, cache->_limit });
+	}
+	return result;
+}
+
+inline int64 MediaActiveCacheBase::Trim() {
+	const auto was = TotalUsage();
+	Reduce(was / 2);
+	return was - TotalUsage();
+}
+
+inline void MediaActiveCacheBase::CheckTotal() {
+	Reduce(Limit());
+}
+
+inline void MediaActiveCacheBase::Reduce(int64 limit) {
+	auto caches = Caches();
+	auto usage = TotalUsage();
+	while (usage > limit && !caches.empty()) {
+		const auto part = [](not_null<MediaActiveCacheBase*> cache) {
+			return cache->_limit
+				? (cache->_usage / float64(cache->_limit))
+				: float64(cache->_usage);
+		};
+		const auto i = std::max_element(
+			begin(caches),
+			end(caches),
+			[&](MediaActiveCacheBase *a, MediaActiveCacheBase *b) {
+				return part(a) < part(b);
+			});
+		const auto cache = *i;
+		const auto was = cache->_usage;
+		if (!cache->unloadLowest() || cache->_usage >= was) {
+			caches.erase(i);
+		}
+		usage = TotalUsage();
+	}
+}
+
 template <typename Type>
 template <typename Unload>
-MediaActiveCache<Type>::MediaActiveCache(int64 limit, Unload &&unload)
-: _delayed([=] { check(unload); })
-, _limit(limit) {
+MediaActiveCache<Type>::MediaActiveCache(
+	const char *name,
+	int64 limit,
+	Unload &&unload)
+: MediaActiveCacheBase(name, limit)
+, _unload(std::forward<Unload>(unload))
+, _delayed([=] { check(); }) {
 }
 
 template <typename Type>
@@ -69,15 +199,22 @@ void MediaActiveCache<Type>::decrement(int64 amount) {
 }
 
 template <typename Type>
-template <typename Unload>
-void MediaActiveCache<Type>::check(Unload &&unload) {
+void MediaActiveCache<Type>::check() {
 	while (_usage > _limit) {
-		if (const auto entry = _cache.take_lowest()) {
-			unload(entry);
-		} else {
+		if (!unloadLowest()) {
 			break;
 		}
 	}
+	CheckTotal();
+}
+
+template <typename Type>
+bool MediaActiveCache<Type>::unloadLowest() {
+	if (const auto entry = _cache.take_lowest()) {
+		_unload(entry);
+		return true;
+	}
+	return false;
 }
 
 } // namespace Core
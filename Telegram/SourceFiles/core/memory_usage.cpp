@@ -0,0 +1,61 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/memory_usage.h"
+
+#include "core/application.h"
+#include "core/media_active_cache.h"
+#include "main/main_account.h"
+#include "main/main_session.h"
+#include "data/data_session.h"
+#include "data/data_streaming.h"
+#include "mtproto/mtp_instance.h"
+#include "mtproto/details/mtproto_buffer_pool.h"
+
+namespace Core {
+
+void LogMemoryUsage() {
+	for (const auto &cache : MediaActiveCacheBase::Usages()) {
+		LOG(("Memory Usage: %1 cache, %2 of %3 bytes."
+			).arg(cache.name
+			).arg(cache.usage
+			).arg(cache.limit));
+	}
+	LOG(("Memory Usage: media caches, %1 of %2 bytes in total."
+		).arg(MediaActiveCacheBase::TotalUsage()
+		).arg(MediaActiveCacheBase::TotalLimit()));
+
+	auto &account = App().activeAccount();
+	if (const auto mtp = account.mtp()) {
+		LOG(("Memory Usage: network buffers pool, %1 bytes."
+			).arg(mtp->bufferPool()->pooledBytes()));
+	}
+	if (!account.sessionExists()) {
+		return;
+	}
+	const auto &data = account.session().data();
+	const auto streaming = data.streaming().stats();
+	LOG(("Memory Usage: streaming, %1 readers up to %2 bytes, "
+		"%3 kept alive about %4 bytes."
+		).arg(streaming.readers
+		).arg(streaming.readersBytes
+		).arg(streaming.keptAlive
+		).arg(streaming.keptAliveBytes));
+
+	const auto stats = data.memoryStats();
+	LOG(("Memory Usage: session, %1 peers, %2 histories, %3 messages, "
+		"%4 views, %5 photos, %6 documents, %7 webpages."
+		).arg(stats.peers
+		).arg(stats.histories
+		).arg(stats.messages
+		).arg(stats.views
+		).arg(stats.photos
+		).arg(stats.documents
+		).arg(stats.webpages));
+}
+
+} // namespace Core
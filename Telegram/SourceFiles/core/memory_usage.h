@@ -0,0 +1,16 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+
+// Writes the memory used by the media caches, streaming, the session data
+// and the network buffers to the main log.
+void LogMemoryUsage();
+
+} // namespace Core
@@ -34,6 +34,9 @@ namespace {
 
 constexpr auto kEmptyPidForCommandResponse = 0ULL;
 
+// Main thread events taking longer than that are logged in debug mode.
+constexpr auto kSlowEventDuration = crl::time(200);
+
 using ErrorSignal = void(QLocalSocket::*)(QLocalSocket::LocalSocketError);
 const auto QLocalSocket_error = ErrorSignal(&QLocalSocket::error);
 
@@ -528,7 +531,22 @@ bool Sandbox::notify(QObject *receiver, QEvent *e) {
 			return true;
 		}
 	}
-	return notifyOrInvoke(receiver, e);
+	if (!Logs::DebugEnabled()) {
+		return notifyOrInvoke(receiver, e);
+	}
+	const auto type = e->type();
+	const auto className = receiver->metaObject()->className();
+	const auto started = crl::now();
+	const auto result = notifyOrInvoke(receiver, e);
+	const auto duration = crl::now() - started;
+	if (duration >= kSlowEventDuration) {
+		DEBUG_LOG(("Main Thread Stall: %1 ms in event %2 for %3, level %4."
+			).arg(duration
+			).arg(int(type)
+			).arg(className
+			).arg(_eventNestingLevel));
+	}
+	return result;
 }
 
 void Sandbox::processPostponedCalls(int level) {
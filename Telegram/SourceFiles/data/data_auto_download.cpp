@@ -10,6 +10,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_peer.h"
 #include "data/data_photo.h"
 #include "data/data_document.h"
+#include "main/main_session.h"
+#include "storage/download_manager_mtproto.h"
 #include "ui/image/image_source.h"
 #include "ui/image/image.h"
 
@@ -74,6 +76,15 @@ Source SourceFromPeer(not_null<PeerData*> peer) {
 	}
 }
 
+bool BudgetAllows(
+		const Full &data,
+		not_null<Main::Session*> session,
+		int fileSize) {
+	return data.budgetAllows(
+		session->downloader().automaticBytesReceived(),
+		fileSize);
+}
+
 Type AutoPlayTypeFromDocument(not_null<DocumentData*> document) {
 	return document->isVideoFile()
 		? Type::AutoPlayVideo
@@ -192,10 +203,25 @@ int Full::bytesLimit(Source source, Type type) const {
 	return setOrDefault(source, type).bytesLimit(type);
 }
 
+void Full::setBudgetBytesLimit(int64 bytesLimit) {
+	Expects(bytesLimit >= 0);
+
+	_budgetLimit = bytesLimit;
+}
+
+int64 Full::budgetBytesLimit() const {
+	return _budgetLimit;
+}
+
+bool Full::budgetAllows(int64 spent, int fileSize) const {
+	return !_budgetLimit || (spent + fileSize <= _budgetLimit);
+}
+
 QByteArray Full::serialize() const {
 	auto result = QByteArray();
 	auto size = sizeof(qint8);
 	size += kSourcesCount * kTypesCount * sizeof(qint32);
+	size += sizeof(qint64);
 	result.reserve(size);
 	{
 		auto buffer = QBuffer(&result);
@@ -207,6 +233,9 @@ QByteArray Full::serialize() const {
 				stream << set(source).serialize(type);
 			}
 		}
+
+		// Older versions stop reading before the budget.
+		stream << qint64(_budgetLimit);
 	}
 	return result;
 }
@@ -234,6 +263,14 @@ bool Full::setFromSerialized(const QByteArray &serialized) {
 			}
 		}
 	}
+	if (!stream.atEnd()) {
+		auto budget = qint64();
+		stream >> budget;
+		if (stream.status() != QDataStream::Ok || budget < 0) {
+			return false;
+		}
+		temp._budgetLimit = budget;
+	}
 	if (version == kVersion1) {
 		for (const auto source : enums_view<Source>(kSourcesCount)) {
 			for (const auto type : kAutoPlayTypes) {
@@ -244,6 +281,7 @@ bool Full::setFromSerialized(const QByteArray &serialized) {
 		}
 	}
 	_data = temp._data;
+	_budgetLimit = temp._budgetLimit;
 	return true;
 }
 
@@ -269,7 +307,8 @@ bool Should(
 		|| document->isVideoFile()) {
 		return false;
 	}
-	return data.shouldDownload(source, Type::File, document->size);
+	return data.shouldDownload(source, Type::File, document->size)
+		&& BudgetAllows(data, &document->session(), document->size);
 }
 
 bool Should(
@@ -298,7 +337,8 @@ bool Should(
 	return data.shouldDownload(
 		SourceFromPeer(peer),
 		Type::Photo,
-		image->bytesSize());
+		image->bytesSize())
+		&& BudgetAllows(data, &peer->session(), image->bytesSize());
 }
 
 bool ShouldAutoPlay(
@@ -94,6 +94,12 @@ public:
 		int fileSize) const;
 	[[nodiscard]] int bytesLimit(Source source, Type type) const;
 
+	// Bytes of automatic downloads allowed in one budget window of
+	// Storage::DownloadManagerMtproto, zero means no limit.
+	void setBudgetBytesLimit(int64 bytesLimit);
+	[[nodiscard]] int64 budgetBytesLimit() const;
+	[[nodiscard]] bool budgetAllows(int64 spent, int fileSize) const;
+
 	[[nodiscard]] QByteArray serialize() const;
 	bool setFromSerialized(const QByteArray &serialized);
 
@@ -105,6 +111,7 @@ private:
 	[[nodiscard]] const Set &setOrDefault(Source source, Type type) const;
 
 	std::array<Set, kSourcesCount> _data;
+	int64 _budgetLimit = 0;
 
 };
 
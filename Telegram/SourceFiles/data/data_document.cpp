@@ -49,6 +49,7 @@ using FilePathResolve = DocumentData::FilePathResolve;
 
 Core::MediaActiveCache<DocumentData> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<DocumentData>(
+		"documents",
 		kMemoryForCache,
 		[](DocumentData *document) { document->unload(); });
 	return Instance;
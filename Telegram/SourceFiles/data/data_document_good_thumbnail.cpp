@@ -38,7 +38,7 @@ QImage Prepare(
 		QByteArray data,
 		FileType type) {
 	if (type == FileType::Video) {
-		return ::Media::Clip::PrepareForSending(path, data).thumbnail;
+		return ::Media::Clip::PrepareThumbnail(path, data);
 	} else if (type == FileType::AnimatedSticker) {
 		return Lottie::ReadThumbnail(Lottie::ReadContent(data, path));
 	} else if (type == FileType::Theme) {
@@ -197,4 +197,8 @@ UpdatedFileReferences GetFileReferences(const MTPTheme &data) {
 	return GetFileReferencesHelper(data);
 }
 
+UpdatedFileReferences GetFileReferences(const MTPWebPage &data) {
+	return GetFileReferencesHelper(data);
+}
+
 } // namespace Data
@@ -88,6 +88,17 @@ struct FileOriginTheme {
 	}
 };
 
+struct FileOriginWebPage {
+	explicit FileOriginWebPage(const QString &url) : url(url) {
+	}
+
+	QString url;
+
+	inline bool operator<(const FileOriginWebPage &other) const {
+		return url < other.url;
+	}
+};
+
 struct FileOrigin {
 	using Variant = base::optional_variant<
 		FileOriginMessage,
@@ -96,7 +107,8 @@ struct FileOrigin {
 		FileOriginStickerSet,
 		FileOriginSavedGifs,
 		FileOriginWallpaper,
-		FileOriginTheme>;
+		FileOriginTheme,
+		FileOriginWebPage>;
 
 	FileOrigin() = default;
 	FileOrigin(FileOriginMessage data) : data(data) {
@@ -113,6 +125,8 @@ struct FileOrigin {
 	}
 	FileOrigin(FileOriginTheme data) : data(data) {
 	}
+	FileOrigin(FileOriginWebPage data) : data(data) {
+	}
 
 	explicit operator bool() const {
 		return data.has_value();
@@ -158,5 +172,6 @@ UpdatedFileReferences GetFileReferences(const MTPmessages_StickerSet &data);
 UpdatedFileReferences GetFileReferences(const MTPmessages_SavedGifs &data);
 UpdatedFileReferences GetFileReferences(const MTPWallPaper &data);
 UpdatedFileReferences GetFileReferences(const MTPTheme &data);
+UpdatedFileReferences GetFileReferences(const MTPWebPage &data);
 
 } // namespace Data
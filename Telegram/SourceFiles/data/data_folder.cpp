@@ -343,7 +343,10 @@ void Folder::applyDialog(const MTPDdialogFolder &data) {
 		_chatsList.clear();
 		updateChatListExistence();
 	}
-	if (_chatsList.indexed()->size() < kLoadedChatsMinCount) {
+	// Only the first slice is needed for the collapsed row, the rest
+	// is loaded when the archive is opened and scrolled.
+	if (!_chatsList.loaded()
+		&& _chatsList.indexed()->size() < kLoadedChatsMinCount) {
 		session().api().requestDialogs(this);
 	}
 }
@@ -0,0 +1,130 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_index.h"
+
+#include "history/history_item.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMinCapacity = 64;
+
+// Load factor is kept between 1/8 and 3/4.
+[[nodiscard]] bool TooFull(int size, int capacity) {
+	return (size * 4 > capacity * 3);
+}
+
+[[nodiscard]] bool TooEmpty(int size, int capacity) {
+	return (capacity > kMinCapacity) && (size * 8 < capacity);
+}
+
+} // namespace
+
+MessagesIndex::MessagesIndex() = default;
+
+MessagesIndex::MessagesIndex(MessagesIndex &&other)
+: _entries(std::move(other._entries))
+, _mask(base::take(other._mask, -1))
+, _size(base::take(other._size)) {
+}
+
+MessagesIndex &MessagesIndex::operator=(MessagesIndex &&other) {
+	if (this != &other) {
+		_entries = std::move(other._entries);
+		_mask = base::take(other._mask, -1);
+		_size = base::take(other._size);
+	}
+	return *this;
+}
+
+MessagesIndex::~MessagesIndex() = default;
+
+int MessagesIndex::bucket(FullMsgId id) const {
+	const auto key = (uint64(uint32(id.channel)) << 32) | uint32(id.msg);
+	return int((key * 0x9E3779B97F4A7C15ULL) >> 32) & _mask;
+}
+
+int MessagesIndex::indexOf(FullMsgId id) const {
+	if (!_size) {
+		return -1;
+	}
+	for (auto i = bucket(id);; i = (i + 1) & _mask) {
+		const auto &entry = _entries[i];
+		if (!entry.item) {
+			return -1;
+		} else if (entry.id == id) {
+			return i;
+		}
+	}
+}
+
+HistoryItem *MessagesIndex::find(FullMsgId id) const {
+	const auto index = indexOf(id);
+	return (index >= 0) ? _entries[index].item.get() : nullptr;
+}
+
+int MessagesIndex::size() const {
+	return _size;
+}
+
+void MessagesIndex::insert(FullMsgId id, std::unique_ptr<HistoryItem> item) {
+	Expects(item != nullptr);
+	Expects(indexOf(id) < 0);
+
+	if (TooFull(_size + 1, _mask + 1)) {
+		rehash(std::max((_mask + 1) * 2, kMinCapacity));
+	}
+	auto i = bucket(id);
+	while (_entries[i].item) {
+		i = (i + 1) & _mask;
+	}
+	_entries[i] = Entry{ id, std::move(item) };
+	++_size;
+}
+
+std::unique_ptr<HistoryItem> MessagesIndex::take(FullMsgId id) {
+	auto i = indexOf(id);
+	if (i < 0) {
+		return nullptr;
+	}
+	auto result = std::move(_entries[i].item);
+	--_size;
+
+	// Backward shift deletion, so that we don't need tombstones.
+	for (auto j = (i + 1) & _mask; _entries[j].item; j = (j + 1) & _mask) {
+		const auto wanted = bucket(_entries[j].id);
+		const auto distance = (j - wanted) & _mask;
+		if (distance >= ((j - i) & _mask)) {
+			_entries[i] = std::move(_entries[j]);
+			i = j;
+		}
+	}
+	if (TooEmpty(_size, _mask + 1)) {
+		rehash((_mask + 1) / 2);
+	}
+	return result;
+}
+
+void MessagesIndex::rehash(int capacity) {
+	Expects(capacity > 0 && !(capacity & (capacity - 1)));
+	Expects(!TooFull(_size, capacity));
+
+	auto was = std::exchange(_entries, std::vector<Entry>(capacity));
+	_mask = capacity - 1;
+	for (auto &entry : was) {
+		if (entry.item) {
+			auto i = bucket(entry.id);
+			while (_entries[i].item) {
+				i = (i + 1) & _mask;
+			}
+			_entries[i] = std::move(entry);
+		}
+	}
+}
+
+} // namespace Data
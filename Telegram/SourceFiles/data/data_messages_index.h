@@ -0,0 +1,47 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class HistoryItem;
+
+namespace Data {
+
+// Open addressing hash table owning all the registered history items.
+// Keeps entries in one contiguous array with linear probing, so
+// a lookup is usually a single cache miss and nothing is allocated
+// per item.
+class MessagesIndex final {
+public:
+	MessagesIndex();
+	MessagesIndex(MessagesIndex &&other);
+	MessagesIndex &operator=(MessagesIndex &&other);
+	~MessagesIndex();
+
+	[[nodiscard]] HistoryItem *find(FullMsgId id) const;
+	[[nodiscard]] int size() const;
+
+	void insert(FullMsgId id, std::unique_ptr<HistoryItem> item);
+	[[nodiscard]] std::unique_ptr<HistoryItem> take(FullMsgId id);
+
+private:
+	struct Entry {
+		FullMsgId id;
+		std::unique_ptr<HistoryItem> item;
+	};
+
+	[[nodiscard]] int indexOf(FullMsgId id) const;
+	[[nodiscard]] int bucket(FullMsgId id) const;
+	void rehash(int capacity);
+
+	std::vector<Entry> _entries;
+	int _mask = -1;
+	int _size = 0;
+
+};
+
+} // namespace Data
@@ -339,6 +339,10 @@ void PeerData::updateUserpic(
 			size,
 			size);
 	});
+	if (_userpic && _userpicPhotoId == photoId && _userpicLocation == loc) {
+		// The same peers come in almost every response, skip the lookup.
+		return;
+	}
 	setUserpicChecked(photoId, loc, Images::Create(loc));
 }
 
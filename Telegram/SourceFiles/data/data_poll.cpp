@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace {
 
 constexpr auto kShortPollTimeout = 30 * crl::time(1000);
+constexpr auto kMaxShortPollTimeout = 5 * 60 * crl::time(1000);
 
 const PollAnswer *AnswerByOption(
 		const std::vector<PollAnswer> &list,
@@ -92,6 +93,7 @@ bool PollData::applyResults(const MTPPollResults &results) {
 				}
 			}
 		}
+		updateResultsReloadTimeout(changed);
 		if (!changed) {
 			return false;
 		}
@@ -102,7 +104,10 @@ bool PollData::applyResults(const MTPPollResults &results) {
 }
 
 void PollData::checkResultsReload(not_null<HistoryItem*> item, crl::time now) {
-	if (lastResultsUpdate && lastResultsUpdate + kShortPollTimeout > now) {
+	const auto timeout = _resultsReloadTimeout
+		? _resultsReloadTimeout
+		: kShortPollTimeout;
+	if (lastResultsUpdate && lastResultsUpdate + timeout > now) {
 		return;
 	} else if (closed) {
 		return;
@@ -111,6 +116,17 @@ void PollData::checkResultsReload(not_null<HistoryItem*> item, crl::time now) {
 	Auth().api().reloadPollResults(item);
 }
 
+void PollData::updateResultsReloadTimeout(bool changed) {
+	// Back off while nothing changes and add some jitter, so that
+	// the polls displayed together don't get reloaded in lockstep.
+	_resultsReloadBase = (changed || !_resultsReloadBase)
+		? kShortPollTimeout
+		: std::min(_resultsReloadBase * 2, kMaxShortPollTimeout);
+	const auto jitter = int(_resultsReloadBase / 4);
+	_resultsReloadTimeout = _resultsReloadBase
+		+ (rand_value<uint32>() % jitter);
+}
+
 PollAnswer *PollData::answerByOption(const QByteArray &option) {
 	return AnswerByOption(answers, option);
 }
@@ -51,6 +51,10 @@ private:
 	bool applyResultToAnswers(
 		const MTPPollAnswerVoters &result,
 		bool isMinResults);
+	void updateResultsReloadTimeout(bool changed);
+
+	crl::time _resultsReloadBase = 0;
+	crl::time _resultsReloadTimeout = 0;
 
 };
 
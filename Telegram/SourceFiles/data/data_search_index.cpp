@@ -0,0 +1,172 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_search_index.h"
+
+#include "data/data_session.h"
+#include "history/history_item.h"
+#include "history/history.h"
+
+namespace Data {
+namespace {
+
+[[nodiscard]] FullMsgId IndexKey(not_null<const HistoryItem*> item) {
+	return FullMsgId(item->channelId(), item->id);
+}
+
+} // namespace
+
+SearchIndex::SearchIndex(not_null<Session*> owner) : _owner(owner) {
+}
+
+void SearchIndex::add(not_null<HistoryItem*> item) {
+	if (!IsServerMsgId(item->id) || !item->isHistoryEntry()) {
+		return;
+	}
+	const auto key = IndexKey(item);
+	if (_itemWords.find(key) != end(_itemWords)
+		|| _preparing.find(key) != end(_preparing)) {
+		return;
+	}
+	const auto generation = ++_generation;
+	_preparing.emplace(key, generation);
+	_queued.push_back({ key, generation, item->originalText().text });
+	if (!_prepareScheduled) {
+		_prepareScheduled = true;
+		crl::on_main(this, [=] {
+			prepareQueued();
+		});
+	}
+}
+
+void SearchIndex::prepareQueued() {
+	_prepareScheduled = false;
+	const auto weak = base::make_weak(this);
+	crl::async([=, queued = base::take(_queued)]() mutable {
+		auto prepared = std::vector<Prepared>();
+		prepared.reserve(queued.size());
+		for (auto &entry : queued) {
+			auto words = TextUtilities::PrepareSearchWords(entry.text);
+			words.removeDuplicates();
+			prepared.push_back({
+				entry.key,
+				entry.generation,
+				std::move(words)
+			});
+		}
+		crl::on_main(weak, [=, prepared = std::move(prepared)]() mutable {
+			applyPrepared(std::move(prepared));
+		});
+	});
+}
+
+void SearchIndex::applyPrepared(std::vector<Prepared> &&prepared) {
+	for (auto &entry : prepared) {
+		const auto i = _preparing.find(entry.key);
+		if (i == end(_preparing) || i->second != entry.generation) {
+			// Removed or refreshed while the words were prepared.
+			continue;
+		}
+		_preparing.erase(i);
+		if (entry.words.isEmpty()) {
+			continue;
+		}
+		for (const auto &word : entry.words) {
+			_words[word].push_back(entry.key);
+		}
+		_itemWords.emplace(entry.key, std::move(entry.words));
+	}
+}
+
+void SearchIndex::remove(not_null<const HistoryItem*> item) {
+	const auto key = IndexKey(item);
+	_preparing.erase(key);
+	const auto i = _itemWords.find(key);
+	if (i == end(_itemWords)) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _words.find(word);
+		if (j == end(_words)) {
+			continue;
+		}
+		auto &bucket = j->second;
+		const auto k = ranges::find(bucket, key);
+		if (k != end(bucket)) {
+			*k = bucket.back();
+			bucket.pop_back();
+		}
+		if (bucket.empty()) {
+			_words.erase(j);
+		}
+	}
+	_itemWords.erase(i);
+}
+
+void SearchIndex::refresh(not_null<HistoryItem*> item) {
+	remove(item);
+	add(item);
+}
+
+std::vector<FullMsgId> SearchIndex::lookup(const QString &word) const {
+	auto result = std::vector<FullMsgId>();
+	for (auto i = _words.lower_bound(word); i != end(_words); ++i) {
+		if (!i->first.startsWith(word)) {
+			break;
+		}
+		result.insert(end(result), begin(i->second), end(i->second));
+	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), end(result));
+	return result;
+}
+
+auto SearchIndex::search(
+	const QString &query,
+	History *inHistory,
+	UserData *from,
+	int limit) const
+-> std::vector<not_null<HistoryItem*>> {
+	auto words = TextUtilities::PrepareSearchWords(query);
+	words.erase(ranges::remove_if(words, [](const QString &word) {
+		return (word.size() < kMinPrefixLength);
+	}), words.end());
+	if (words.isEmpty() || limit <= 0) {
+		return {};
+	}
+	auto ids = lookup(words.front());
+	for (auto i = 1; i < words.size() && !ids.empty(); ++i) {
+		const auto other = lookup(words[i]);
+		auto both = std::vector<FullMsgId>();
+		std::set_intersection(
+			begin(ids),
+			end(ids),
+			begin(other),
+			end(other),
+			std::back_inserter(both));
+		ids = std::move(both);
+	}
+	auto result = std::vector<not_null<HistoryItem*>>();
+	for (const auto &id : ids) {
+		const auto item = _owner->message(id);
+		if (!item
+			|| (inHistory && item->history() != inHistory)
+			|| (from && item->from().get() != from)) {
+			continue;
+		}
+		result.push_back(item);
+	}
+	ranges::sort(result, ranges::greater(), [](not_null<HistoryItem*> item) {
+		return std::make_pair(item->date(), item->id);
+	});
+	if (int(result.size()) > limit) {
+		result.erase(begin(result) + limit, end(result));
+	}
+	return result;
+}
+
+} // namespace Data
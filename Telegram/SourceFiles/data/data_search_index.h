@@ -0,0 +1,75 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "data/data_types.h"
+
+class History;
+
+namespace Data {
+
+class Session;
+
+// Inverted index of the words in loaded messages, used to show
+// search results before (or without) the server response.
+class SearchIndex final : public base::has_weak_ptr {
+public:
+	explicit SearchIndex(not_null<Session*> owner);
+
+	void add(not_null<HistoryItem*> item);
+	void remove(not_null<const HistoryItem*> item);
+	void refresh(not_null<HistoryItem*> item);
+
+	// Every query word should be a prefix of some message word.
+	// Words shorter than kMinPrefixLength are not looked up.
+	// Results are ordered from newest to oldest.
+	[[nodiscard]] std::vector<not_null<HistoryItem*>> search(
+		const QString &query,
+		History *inHistory,
+		UserData *from,
+		int limit) const;
+
+	static constexpr auto kMinPrefixLength = 2;
+
+private:
+	struct KeyHash {
+		size_t operator()(const FullMsgId &key) const {
+			return std::hash<uint64>()(
+				(uint64(uint32(key.channel)) << 32) | uint32(key.msg));
+		}
+	};
+	struct Prepared {
+		FullMsgId key;
+		uint64 generation = 0;
+		QStringList words;
+	};
+	struct Queued {
+		FullMsgId key;
+		uint64 generation = 0;
+		QString text;
+	};
+
+	void prepareQueued();
+	void applyPrepared(std::vector<Prepared> &&prepared);
+	[[nodiscard]] std::vector<FullMsgId> lookup(const QString &word) const;
+
+	const not_null<Session*> _owner;
+
+	// Words are split on a background thread, that's the slow part.
+	std::vector<Queued> _queued;
+	std::unordered_map<FullMsgId, uint64, KeyHash> _preparing;
+	uint64 _generation = 0;
+	bool _prepareScheduled = false;
+
+	// Ordered for the prefix lookups, buckets are sorted when read.
+	std::map<QString, std::vector<FullMsgId>> _words;
+	std::unordered_map<FullMsgId, QStringList, KeyHash> _itemWords;
+
+};
+
+} // namespace Data
@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 #include "apiwrap.h"
 #include "mainwidget.h"
+#include "api/api_hash.h"
 #include "api/api_text_entities.h"
 #include "core/application.h"
 #include "core/crash_reports.h" // CrashReports::SetAnnotation
@@ -58,6 +59,7 @@ namespace {
 
 constexpr auto kMaxNotifyCheckDelay = 24 * 3600 * crl::time(1000);
 constexpr auto kMaxWallpaperSize = 10 * 1024 * 1024;
+constexpr auto kMaxWebPagePreviews = 256;
 
 using ViewElement = HistoryView::Element;
 
@@ -189,6 +191,7 @@ Session::Session(not_null<Main::Session*> session)
 })
 , _unmuteByFinishedTimer([=] { unmuteByFinished(); })
 , _groups(this)
+, _searchIndex(this)
 , _scheduledMessages(std::make_unique<ScheduledMessages>(this))
 , _cloudThemes(std::make_unique<CloudThemes>(session))
 , _streaming(std::make_unique<Streaming>(this)) {
@@ -218,7 +221,6 @@ void Session::clear() {
 	_scheduledMessages = nullptr;
 	_dependentMessages.clear();
 	base::take(_messages);
-	base::take(_channelMessages);
 	_messageByRandomId.clear();
 	_sentMessagesData.clear();
 	cSetRecentInlineBots(RecentInlineBots());
@@ -227,6 +229,20 @@ void Session::clear() {
 	_histories.clear();
 }
 
+auto Session::memoryStats() const -> MemoryStats {
+	auto result = MemoryStats();
+	result.peers = int(_peers.size());
+	result.histories = int(_histories.size());
+	result.messages = _messages.size();
+	for (const auto &[item, views] : _views) {
+		result.views += int(views.size());
+	}
+	result.photos = int(_photos.size());
+	result.documents = int(_documents.size());
+	result.webpages = int(_webpages.size());
+	return result;
+}
+
 not_null<PeerData*> Session::peer(PeerId id) {
 	const auto i = _peers.find(id);
 	if (i != _peers.cend()) {
@@ -1154,14 +1170,11 @@ rpl::producer<not_null<HistoryItem*>> Session::unreadItemAdded() const {
 }
 
 void Session::changeMessageId(ChannelId channel, MsgId wasId, MsgId nowId) {
-	const auto list = messagesListForInsert(channel);
-	auto i = list->find(wasId);
-	Assert(i != list->end());
-	auto owned = std::move(i->second);
-	list->erase(i);
-	const auto [j, ok] = list->emplace(nowId, std::move(owned));
-
-	Ensures(ok);
+	auto owned = _messages.take(FullMsgId(channel, wasId));
+	Assert(owned != nullptr);
+	const auto item = owned.get();
+	_messages.insert(FullMsgId(channel, nowId), std::move(owned));
+	_searchIndex.add(item);
 }
 
 void Session::notifyItemIdChange(IdChange event) {
@@ -1403,6 +1416,7 @@ rpl::producer<not_null<UserData*>> Session::megagroupParticipantAdded(
 }
 
 void Session::notifyStickersUpdated() {
+	_stickersHashes = StickersHashes();
 	_stickersUpdated.fire({});
 }
 
@@ -1411,6 +1425,8 @@ rpl::producer<> Session::stickersUpdated() const {
 }
 
 void Session::notifyRecentStickersUpdated() {
+	_stickersHashes.recent = std::nullopt;
+	_stickersHashes.faved = std::nullopt;
 	_recentStickersUpdated.fire({});
 }
 
@@ -1419,6 +1435,7 @@ rpl::producer<> Session::recentStickersUpdated() const {
 }
 
 void Session::notifySavedGifsUpdated() {
+	_stickersHashes.savedGifs = std::nullopt;
 	_savedGifsUpdated.fire({});
 }
 
@@ -1426,6 +1443,82 @@ rpl::producer<> Session::savedGifsUpdated() const {
 	return _savedGifsUpdated.events();
 }
 
+int32 Session::stickersHash(bool checkOutdatedInfo) const {
+	auto &cached = _stickersHashes;
+	if (!cached.installed) {
+		auto result = Api::HashInit();
+		auto foundOutdated = false;
+		for (const auto setId : _stickerSetsOrder) {
+			const auto i = _stickerSets.constFind(setId);
+			if (i == _stickerSets.cend()) {
+				continue;
+			} else if (i->id == Stickers::DefaultSetId) {
+				foundOutdated = true;
+			} else if (!(i->flags & MTPDstickerSet_ClientFlag::f_special)
+				&& !(i->flags & MTPDstickerSet::Flag::f_archived)) {
+				Api::HashUpdate(result, i->hash);
+			}
+		}
+		cached.installed = Api::HashFinalize(result);
+		cached.installedOutdated = foundOutdated;
+	}
+	return (!checkOutdatedInfo || !cached.installedOutdated)
+		? *cached.installed
+		: 0;
+}
+
+int32 Session::recentStickersHash() const {
+	if (!_stickersHashes.recent) {
+		_stickersHashes.recent = specialStickerSetHash(
+			Stickers::CloudRecentSetId);
+	}
+	return *_stickersHashes.recent;
+}
+
+int32 Session::favedStickersHash() const {
+	if (!_stickersHashes.faved) {
+		_stickersHashes.faved = specialStickerSetHash(Stickers::FavedSetId);
+	}
+	return *_stickersHashes.faved;
+}
+
+int32 Session::featuredStickersHash() const {
+	if (!_stickersHashes.featured) {
+		auto result = Api::HashInit();
+		for (const auto setId : _featuredStickerSetsOrder) {
+			Api::HashUpdate(result, setId);
+
+			const auto i = _stickerSets.constFind(setId);
+			if (i != _stickerSets.cend()
+				&& (i->flags & MTPDstickerSet_ClientFlag::f_unread)) {
+				Api::HashUpdate(result, 1);
+			}
+		}
+		_stickersHashes.featured = Api::HashFinalize(result);
+	}
+	return *_stickersHashes.featured;
+}
+
+int32 Session::savedGifsHash() const {
+	if (!_stickersHashes.savedGifs) {
+		_stickersHashes.savedGifs = documentsHash(_savedGifs);
+	}
+	return *_stickersHashes.savedGifs;
+}
+
+int32 Session::specialStickerSetHash(uint64 setId) const {
+	const auto i = _stickerSets.constFind(setId);
+	return (i != _stickerSets.cend()) ? documentsHash(i->stickers) : 0;
+}
+
+int32 Session::documentsHash(const QVector<DocumentData*> &list) const {
+	auto result = Api::HashInit();
+	for (const auto document : list) {
+		Api::HashUpdate(result, document->id);
+	}
+	return Api::HashFinalize(result);
+}
+
 void Session::notifyPinnedDialogsOrderUpdated() {
 	_pinnedDialogsOrderUpdated.fire({});
 }
@@ -1682,12 +1775,16 @@ void Session::updateEditedMessage(const MTPMessage &data) {
 	}, [&](const auto &data) {
 		existing->applyEdition(data);
 	});
+	_searchIndex.refresh(existing);
 }
 
 void Session::processMessages(
 		const QVector<MTPMessage> &data,
 		NewMessageType type) {
-	auto indices = base::flat_map<uint64, int>();
+	const auto span = Logs::TraceSpan("data", "processMessages");
+
+	// Group the messages by history, so they're added in one pass each.
+	auto indices = base::flat_map<std::pair<PeerId, uint64>, int>();
 	for (int i = 0, l = data.size(); i != l; ++i) {
 		const auto &message = data[i];
 		if (message.type() == mtpc_message) {
@@ -1699,68 +1796,89 @@ void Session::processMessages(
 			}
 		}
 		const auto id = IdFromMessage(message);
-		indices.emplace((uint64(uint32(id)) << 32) | uint64(i), i);
+		indices.emplace(
+			std::make_pair(
+				PeerFromMessage(message),
+				(uint64(uint32(id)) << 32) | uint64(i)),
+			i);
 	}
-	for (const auto [position, index] : indices) {
+	const auto batch = (indices.size() > 1);
+	if (batch) {
+		startMessagesBatch();
+	}
+	for (const auto &[position, index] : indices) {
 		addNewMessage(
 			data[index],
 			MTPDmessage_ClientFlags(),
 			type);
 	}
+	if (batch) {
+		finishMessagesBatch();
+	}
 }
 
-void Session::processMessages(
-		const MTPVector<MTPMessage> &data,
-		NewMessageType type) {
-	processMessages(data.v, type);
+void Session::startMessagesBatch() {
+	++_messagesBatchDepth;
 }
 
-const Session::Messages *Session::messagesList(ChannelId channelId) const {
-	if (channelId == NoChannel) {
-		return &_messages;
+void Session::finishMessagesBatch() {
+	Expects(_messagesBatchDepth > 0);
+
+	if (--_messagesBatchDepth > 0) {
+		return;
+	}
+	for (const auto entry : base::take(_chatListSortDelayed)) {
+		entry->updateChatListSortPosition();
+	}
+	if (base::take(_unreadCounterUpdateDelayed)) {
+		Notify::unreadCounterUpdated();
 	}
-	const auto i = _channelMessages.find(channelId);
-	return (i != end(_channelMessages)) ? &i->second : nullptr;
 }
 
-auto Session::messagesListForInsert(ChannelId channelId)
--> not_null<Messages*> {
-	return (channelId == NoChannel)
-		? &_messages
-		: &_channelMessages[channelId];
+bool Session::delayChatListSortPosition(not_null<Dialogs::Entry*> entry) {
+	if (!_messagesBatchDepth) {
+		return false;
+	}
+	_chatListSortDelayed.emplace(entry);
+	return true;
+}
+
+void Session::processMessages(
+		const MTPVector<MTPMessage> &data,
+		NewMessageType type) {
+	processMessages(data.v, type);
 }
 
 HistoryItem *Session::registerMessage(std::unique_ptr<HistoryItem> item) {
 	Expects(item != nullptr);
 
 	const auto result = item.get();
-	const auto list = messagesListForInsert(result->channelId());
-	const auto i = list->find(result->id);
-	if (i != list->end()) {
+	const auto id = FullMsgId(result->channelId(), result->id);
+	if (const auto existing = _messages.find(id)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		existing->destroy();
 	}
-	list->emplace(result->id, std::move(item));
+	_messages.insert(id, std::move(item));
+	_searchIndex.add(result);
 	return result;
 }
 
 void Session::processMessagesDeleted(
 		ChannelId channelId,
 		const QVector<MTPint> &data) {
-	const auto list = messagesList(channelId);
 	const auto affected = (channelId != NoChannel)
 		? historyLoaded(peerFromChannel(channelId))
 		: nullptr;
-	if (!list && !affected) {
+	if (!_messages.size() && !affected) {
 		return;
 	}
 
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			destroyMessage(i->second.get());
+		const auto id = FullMsgId(channelId, messageId.v);
+		if (const auto item = _messages.find(id)) {
+			const auto history = item->history();
+			destroyMessage(item);
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
 			}
@@ -1809,9 +1927,12 @@ void Session::destroyMessage(not_null<HistoryItem*> item) {
 	groups().unregisterMessage(item);
 	removeDependencyMessage(item);
 	session().notifications().clearFromItem(item);
+	_searchIndex.remove(item);
 
-	const auto list = messagesListForInsert(peerToChannel(peerId));
-	list->erase(item->id);
+	// Take it out of the index before destroying, so that the index
+	// is consistent if the item destructor looks something up.
+	const auto owned = _messages.take(
+		FullMsgId(peerToChannel(peerId), item->id));
 }
 
 MsgId Session::nextLocalMessageId() {
@@ -1825,13 +1946,7 @@ HistoryItem *Session::message(ChannelId channelId, MsgId itemId) const {
 		return nullptr;
 	}
 
-	const auto data = messagesList(channelId);
-	if (!data) {
-		return nullptr;
-	}
-
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return _messages.find(FullMsgId(channelId, itemId));
 }
 
 HistoryItem *Session::message(
@@ -2069,7 +2184,11 @@ void Session::unreadStateChanged(
 	} else {
 		_chatsList.unreadStateChanged(wasState, nowState);
 	}
-	Notify::unreadCounterUpdated();
+	if (_messagesBatchDepth > 0) {
+		_unreadCounterUpdateDelayed = true;
+	} else {
+		Notify::unreadCounterUpdated();
+	}
 }
 
 void Session::unreadEntryChanged(const Dialogs::Key &key, bool added) {
@@ -3223,6 +3342,30 @@ HistoryItem *Session::findWebPageItem(not_null<WebPageData*> page) const {
 	return nullptr;
 }
 
+void Session::rememberWebPagePreview(
+		const QString &links,
+		WebPageId id) {
+	const auto i = _webpagePreviews.find(links);
+	if (i != end(_webpagePreviews)) {
+		i->second = id;
+		return;
+	}
+	_webpagePreviews.emplace(links, id);
+	_webpagePreviewsOrder.push_back(links);
+	if (int(_webpagePreviewsOrder.size()) > kMaxWebPagePreviews) {
+		_webpagePreviews.remove(_webpagePreviewsOrder.front());
+		_webpagePreviewsOrder.pop_front();
+	}
+}
+
+std::optional<WebPageId> Session::webPagePreview(
+		const QString &links) const {
+	const auto i = _webpagePreviews.find(links);
+	return (i != end(_webpagePreviews))
+		? std::make_optional(i->second)
+		: std::nullopt;
+}
+
 QString Session::findContactPhone(not_null<UserData*> contact) const {
 	const auto result = contact->phone();
 	return result.isEmpty()
@@ -13,12 +13,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/dialogs_indexed_list.h"
 #include "dialogs/dialogs_main_list.h"
 #include "data/data_groups.h"
+#include "data/data_messages_index.h"
+#include "data/data_search_index.h"
 #include "data/data_notify_settings.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
 #include "base/flags.h"
 #include "ui/effects/animations.h"
 
+#include <deque>
+
 class Image;
 class HistoryItem;
 class HistoryMessage;
@@ -83,6 +87,9 @@ public:
 	[[nodiscard]] const Groups &groups() const {
 		return _groups;
 	}
+	[[nodiscard]] const SearchIndex &searchIndex() const {
+		return _searchIndex;
+	}
 	[[nodiscard]] ScheduledMessages &scheduledMessages() const {
 		return *_scheduledMessages;
 	}
@@ -98,6 +105,18 @@ public:
 
 	void clear();
 
+	// Objects count for the memory usage summary.
+	struct MemoryStats {
+		int peers = 0;
+		int histories = 0;
+		int messages = 0;
+		int views = 0;
+		int photos = 0;
+		int documents = 0;
+		int webpages = 0;
+	};
+	[[nodiscard]] MemoryStats memoryStats() const;
+
 	void startExport(PeerData *peer = nullptr);
 	void startExport(const MTPInputPeer &singlePeer);
 	void suggestStartExport(TimeId availableAt);
@@ -303,18 +322,24 @@ public:
 		return _stickerSets;
 	}
 	Stickers::Sets &stickerSetsRef() {
+		_stickersHashes.installed = std::nullopt;
+		_stickersHashes.recent = std::nullopt;
+		_stickersHashes.faved = std::nullopt;
+		_stickersHashes.featured = std::nullopt;
 		return _stickerSets;
 	}
 	const Stickers::Order &stickerSetsOrder() const {
 		return _stickerSetsOrder;
 	}
 	Stickers::Order &stickerSetsOrderRef() {
+		_stickersHashes.installed = std::nullopt;
 		return _stickerSetsOrder;
 	}
 	const Stickers::Order &featuredStickerSetsOrder() const {
 		return _featuredStickerSetsOrder;
 	}
 	Stickers::Order &featuredStickerSetsOrderRef() {
+		_stickersHashes.featured = std::nullopt;
 		return _featuredStickerSetsOrder;
 	}
 	const Stickers::Order &archivedStickerSetsOrder() const {
@@ -327,9 +352,17 @@ public:
 		return _savedGifs;
 	}
 	Stickers::SavedGifs &savedGifsRef() {
+		_stickersHashes.savedGifs = std::nullopt;
 		return _savedGifs;
 	}
 
+	// Hashes for the messages.get*Stickers and getSavedGifs requests.
+	[[nodiscard]] int32 stickersHash(bool checkOutdatedInfo = false) const;
+	[[nodiscard]] int32 recentStickersHash() const;
+	[[nodiscard]] int32 favedStickersHash() const;
+	[[nodiscard]] int32 featuredStickersHash() const;
+	[[nodiscard]] int32 savedGifsHash() const;
+
 	void addSavedGif(not_null<DocumentData*> document);
 	void checkSavedGif(not_null<HistoryItem*> item);
 
@@ -380,6 +413,11 @@ public:
 	}
 	void destroyMessage(not_null<HistoryItem*> item);
 
+	// Chat list sorting and unread counter notifications are postponed
+	// until the end of the batch, use it to add or remove many messages.
+	void startMessagesBatch();
+	void finishMessagesBatch();
+
 	// Returns true if item found and it is not detached.
 	bool checkEntitiesAndViewsUpdate(const MTPDmessage &data);
 	void updateEditedMessage(const MTPMessage &data);
@@ -456,6 +494,11 @@ public:
 		const Dialogs::UnreadState &wasState);
 	void unreadEntryChanged(const Dialogs::Key &key, bool added);
 
+	// While a slice of messages is applied the chats list positions are
+	// updated once for each entry, when the whole slice is added.
+	[[nodiscard]] bool delayChatListSortPosition(
+		not_null<Dialogs::Entry*> entry);
+
 	void selfDestructIn(not_null<HistoryItem*> item, crl::time delay);
 
 	[[nodiscard]] not_null<PhotoData*> photo(PhotoId id);
@@ -607,6 +650,9 @@ public:
 	void stopPlayingVideoFiles();
 
 	HistoryItem *findWebPageItem(not_null<WebPageData*> page) const;
+	void rememberWebPagePreview(const QString &links, WebPageId id);
+	[[nodiscard]] std::optional<WebPageId> webPagePreview(
+		const QString &links) const;
 	QString findContactPhone(not_null<UserData*> contact) const;
 	QString findContactPhone(UserId contactId) const;
 
@@ -690,8 +736,6 @@ public:
 	void clearLocalStorage();
 
 private:
-	using Messages = std::unordered_map<MsgId, std::unique_ptr<HistoryItem>>;
-
 	void suggestStartExport();
 
 	void setupContactViewsViewer();
@@ -709,8 +753,6 @@ private:
 		Data::Folder *requestFolder,
 		const MTPDdialogFolder &data);
 
-	const Messages *messagesList(ChannelId channelId) const;
-	not_null<Messages*> messagesListForInsert(ChannelId channelId);
 	HistoryItem *registerMessage(std::unique_ptr<HistoryItem> item);
 	void changeMessageId(ChannelId channel, MsgId wasId, MsgId nowId);
 	void removeDependencyMessage(not_null<HistoryItem*> item);
@@ -797,6 +839,9 @@ private:
 		return (lastUpdate == 0)
 			|| (now >= lastUpdate + kStickersUpdateTimeout);
 	}
+	[[nodiscard]] int32 specialStickerSetHash(uint64 setId) const;
+	[[nodiscard]] int32 documentsHash(
+		const QVector<DocumentData*> &list) const;
 	void userIsContactUpdated(not_null<UserData*> user);
 
 	void setPinnedFromDialog(const Dialogs::Key &key, bool pinned);
@@ -853,6 +898,9 @@ private:
 	rpl::event_stream<not_null<const History*>> _historyUnloaded;
 	rpl::event_stream<not_null<const History*>> _historyCleared;
 	base::flat_set<not_null<History*>> _historiesChanged;
+	base::flat_set<not_null<Dialogs::Entry*>> _chatListSortDelayed;
+	int _messagesBatchDepth = 0;
+	bool _unreadCounterUpdateDelayed = false;
 	rpl::event_stream<not_null<History*>> _historyChanged;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantRemoved;
 	rpl::event_stream<MegagroupParticipant> _megagroupParticipantAdded;
@@ -874,13 +922,24 @@ private:
 	Stickers::Order _archivedStickerSetsOrder;
 	Stickers::SavedGifs _savedGifs;
 
+	// Counted lazily and dropped on each mutable access to the lists
+	// they are counted from and on each stickers update notification.
+	struct StickersHashes {
+		std::optional<int32> installed;
+		bool installedOutdated = false;
+		std::optional<int32> recent;
+		std::optional<int32> faved;
+		std::optional<int32> featured;
+		std::optional<int32> savedGifs;
+	};
+	mutable StickersHashes _stickersHashes;
+
 	Dialogs::MainList _chatsList;
 	Dialogs::IndexedList _contactsList;
 	Dialogs::IndexedList _contactsNoChatsList;
 
 	MsgId _localMessageIdCounter = StartClientMsgId;
-	Messages _messages;
-	std::map<ChannelId, Messages> _channelMessages;
+	Data::MessagesIndex _messages;
 	std::map<
 		not_null<HistoryItem*>,
 		base::flat_set<not_null<HistoryItem*>>> _dependentMessages;
@@ -916,6 +975,8 @@ private:
 	std::unordered_map<
 		not_null<const WebPageData*>,
 		base::flat_set<not_null<ViewElement*>>> _webpageViews;
+	base::flat_map<QString, WebPageId> _webpagePreviews;
+	std::deque<QString> _webpagePreviewsOrder;
 	std::unordered_map<
 		LocationPoint,
 		std::unique_ptr<LocationThumbnail>> _locations;
@@ -981,6 +1042,7 @@ private:
 	int32 _wallpapersHash = 0;
 
 	Groups _groups;
+	SearchIndex _searchIndex;
 	std::unique_ptr<ScheduledMessages> _scheduledMessages;
 	std::unique_ptr<CloudThemes> _cloudThemes;
 	std::unique_ptr<Streaming> _streaming;
@@ -0,0 +1,148 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_slab_allocator.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kChunkSize = std::size_t(64 * 1024);
+constexpr auto kSizeStep = std::max(std::size_t(16), kSlabAlignment);
+constexpr auto kMaxSlabSize = std::size_t(1024);
+constexpr auto kSizeClasses = kMaxSlabSize / kSizeStep;
+
+struct SizeClass;
+
+// Each slot starts with a pointer to its chunk when it is used
+// and with a pointer to the next free slot when it is free.
+struct Chunk {
+	not_null<SizeClass*> sizeClass;
+	Chunk *previous = nullptr;
+	Chunk *next = nullptr;
+	void *free = nullptr;
+	int used = 0;
+	int bumped = 0;
+	int capacity = 0;
+};
+
+[[nodiscard]] constexpr std::size_t AlignSize(std::size_t size) {
+	return ((size + kSlabAlignment - 1) / kSlabAlignment) * kSlabAlignment;
+}
+
+// Slot header is padded so that the objects are aligned as by operator new.
+constexpr auto kSlotHeader = AlignSize(sizeof(Chunk*));
+constexpr auto kChunkHeader = AlignSize(sizeof(Chunk));
+
+static_assert(kSizeStep % kSlabAlignment == 0);
+static_assert(__STDCPP_DEFAULT_NEW_ALIGNMENT__ >= kSlabAlignment);
+
+struct SizeClass {
+	std::size_t slotSize = 0;
+	Chunk *partial = nullptr; // Chunks with free slots.
+	int chunks = 0;
+};
+
+[[nodiscard]] not_null<SizeClass*> ChooseSizeClass(std::size_t size) {
+	static auto classes = [] {
+		auto result = std::array<SizeClass, kSizeClasses>();
+		for (auto i = std::size_t(0); i != kSizeClasses; ++i) {
+			result[i].slotSize = kSlotHeader + (i + 1) * kSizeStep;
+		}
+		return result;
+	}();
+	return &classes[(size + kSizeStep - 1) / kSizeStep - 1];
+}
+
+[[nodiscard]] char *ChunkData(not_null<Chunk*> chunk) {
+	return reinterpret_cast<char*>(chunk.get()) + kChunkHeader;
+}
+
+void Link(not_null<SizeClass*> sizeClass, not_null<Chunk*> chunk) {
+	chunk->previous = nullptr;
+	chunk->next = sizeClass->partial;
+	if (sizeClass->partial) {
+		sizeClass->partial->previous = chunk;
+	}
+	sizeClass->partial = chunk;
+}
+
+void Unlink(not_null<SizeClass*> sizeClass, not_null<Chunk*> chunk) {
+	if (chunk->previous) {
+		chunk->previous->next = chunk->next;
+	} else {
+		sizeClass->partial = chunk->next;
+	}
+	if (chunk->next) {
+		chunk->next->previous = chunk->previous;
+	}
+	chunk->previous = chunk->next = nullptr;
+}
+
+[[nodiscard]] not_null<Chunk*> CreateChunk(not_null<SizeClass*> sizeClass) {
+	const auto memory = ::operator new(kChunkSize);
+	const auto result = new (memory) Chunk{ sizeClass };
+	result->capacity = int((kChunkSize - kChunkHeader) / sizeClass->slotSize);
+	++sizeClass->chunks;
+	Link(sizeClass, result);
+	return result;
+}
+
+void DestroyChunk(not_null<Chunk*> chunk) {
+	Unlink(chunk->sizeClass, chunk);
+	--chunk->sizeClass->chunks;
+	chunk->~Chunk();
+	::operator delete(chunk.get());
+}
+
+} // namespace
+
+void *SlabAllocate(std::size_t size) {
+	if (!size || size > kMaxSlabSize) {
+		return ::operator new(size);
+	}
+	const auto sizeClass = ChooseSizeClass(size);
+	const auto chunk = sizeClass->partial
+		? not_null<Chunk*>(sizeClass->partial)
+		: CreateChunk(sizeClass);
+	auto slot = static_cast<char*>(chunk->free);
+	if (slot) {
+		chunk->free = *reinterpret_cast<void**>(slot);
+	} else {
+		slot = ChunkData(chunk) + chunk->bumped++ * sizeClass->slotSize;
+	}
+	if (++chunk->used == chunk->capacity) {
+		Unlink(sizeClass, chunk);
+	}
+	*reinterpret_cast<Chunk**>(slot) = chunk;
+	return slot + kSlotHeader;
+}
+
+void SlabFree(void *pointer, std::size_t size) {
+	if (!pointer) {
+		return;
+	} else if (!size || size > kMaxSlabSize) {
+		::operator delete(pointer);
+		return;
+	}
+	const auto slot = static_cast<char*>(pointer) - kSlotHeader;
+	const auto chunk = not_null<Chunk*>(*reinterpret_cast<Chunk**>(slot));
+	const auto sizeClass = chunk->sizeClass;
+	Assert(sizeClass == ChooseSizeClass(size));
+
+	if (chunk->used == chunk->capacity) {
+		Link(sizeClass, chunk);
+	}
+	*reinterpret_cast<void**>(slot) = chunk->free;
+	chunk->free = slot;
+	if (!--chunk->used && sizeClass->chunks > 1) {
+		// Keep one chunk so that a single object isn't created and
+		// destroyed with a whole chunk allocation every time.
+		DestroyChunk(chunk);
+	}
+}
+
+} // namespace Data
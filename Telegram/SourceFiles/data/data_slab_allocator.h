@@ -0,0 +1,22 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace Data {
+
+// Main thread only allocator for many small long living objects,
+// like history items and their views. Objects of close sizes are
+// packed in 64 KB chunks that are freed when all their objects are.
+inline constexpr auto kSlabAlignment = alignof(std::max_align_t);
+
+[[nodiscard]] void *SlabAllocate(std::size_t size);
+void SlabFree(void *pointer, std::size_t size);
+
+} // namespace Data
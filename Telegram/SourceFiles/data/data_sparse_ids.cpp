@@ -199,17 +199,34 @@ bool SparseIdsSliceBuilder::applyUpdate(
 	if (!needMergeMessages && !update.count) {
 		return false;
 	}
+	if (!needMergeMessages) {
+		mergeSliceData(
+			update.count,
+			base::flat_set<MsgId> {},
+			std::nullopt,
+			std::nullopt);
+		return true;
+	}
+
+	// The updated slice may be huge, but only the ids that can survive
+	// sliceToLimits() are worth merging, so take just the ones around.
+	const auto &messages = *update.messages;
+	const auto around = ranges::lower_bound(messages, _key);
+	const auto from = around - std::min(
+		int(around - messages.begin()),
+		_limitBefore);
+	const auto till = around + std::min(
+		int(messages.end() - around),
+		_limitAfter + 1);
 	auto skippedBefore = (update.range.from == 0)
-		? 0
+		? int(from - messages.begin())
 		: std::optional<int> {};
 	auto skippedAfter = (update.range.till == ServerMaxMsgId)
-		? 0
+		? int(messages.end() - till)
 		: std::optional<int> {};
 	mergeSliceData(
 		update.count,
-		needMergeMessages
-			? *update.messages
-			: base::flat_set<MsgId> {},
+		base::flat_set<MsgId>(from, till),
 		skippedBefore,
 		skippedAfter);
 	return true;
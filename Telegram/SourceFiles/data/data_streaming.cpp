@@ -18,6 +18,7 @@ namespace Data {
 namespace {
 
 constexpr auto kKeepAliveTimeout = 5 * crl::time(1000);
+constexpr auto kKeptAliveMemoryLimit = int64(64 * 1024 * 1024);
 
 template <typename Object>
 bool PruneDestroyedAndSet(
@@ -94,7 +95,9 @@ std::shared_ptr<Streaming::Document> Streaming::sharedDocument(
 	return result;
 }
 
-void Streaming::keepAlive(not_null<DocumentData*> document) {
+void Streaming::keepAlive(
+		not_null<DocumentData*> document,
+		PeerId peerId) {
 	const auto i = _documents.find(document);
 	if (i == end(_documents)) {
 		return;
@@ -106,21 +109,83 @@ void Streaming::keepAlive(not_null<DocumentData*> document) {
 	const auto till = crl::now() + kKeepAliveTimeout;
 	const auto j = _keptAlive.find(shared);
 	if (j != end(_keptAlive)) {
-		j->second = till;
+		j->second.till = till;
+		j->second.peerId = peerId;
 	} else {
-		_keptAlive.emplace(std::move(shared), till);
+		const auto r = _readers.find(document);
+		const auto reader = (r != end(_readers))
+			? r->second.lock()
+			: nullptr;
+		const auto bytes = reader ? reader->memoryUsageLimit() : int64(0);
+		_keptAliveBytes += bytes;
+		_keptAlive.emplace(shared, KeptAlive{ till, bytes, peerId });
 	}
+	applyKeptAliveLimit(shared);
 	if (!_keptAliveTimer.isActive()) {
 		_keptAliveTimer.callOnce(kKeepAliveTimeout);
 	}
 }
 
+void Streaming::setShownPeer(PeerId peerId) {
+	_shownPeerId = peerId;
+}
+
+void Streaming::applyKeptAliveLimit(
+		const std::shared_ptr<Document> &adding) {
+	while (_keptAliveBytes > kKeptAliveMemoryLimit) {
+		// The least recently kept alive from other peers go first.
+		auto evict = end(_keptAlive);
+		for (auto i = begin(_keptAlive); i != end(_keptAlive); ++i) {
+			if (i->first == adding) {
+				continue;
+			} else if (evict == end(_keptAlive)) {
+				evict = i;
+				continue;
+			}
+			const auto current = (i->second.peerId == _shownPeerId);
+			const auto chosen = (evict->second.peerId == _shownPeerId);
+			if ((current != chosen)
+				? chosen
+				: (i->second.till < evict->second.till)) {
+				evict = i;
+			}
+		}
+		if (evict == end(_keptAlive)) {
+			return;
+		}
+		_keptAliveBytes -= evict->second.bytes;
+		_keptAlive.erase(evict);
+	}
+}
+
+auto Streaming::stats() const -> Stats {
+	auto result = Stats();
+	for (const auto &[document, weak] : _readers) {
+		if (const auto reader = weak.lock()) {
+			++result.readers;
+			result.readersBytes += reader->memoryUsageLimit();
+		}
+	}
+	result.keptAlive = int(_keptAlive.size());
+	result.keptAliveBytes = _keptAliveBytes;
+	return result;
+}
+
+int64 Streaming::clearAllKeptAlive() {
+	const auto result = _keptAliveBytes;
+	_keptAlive.clear();
+	_keptAliveBytes = 0;
+	_keptAliveTimer.cancel();
+	return result;
+}
+
 void Streaming::clearKeptAlive() {
 	const auto now = crl::now();
 	auto min = std::numeric_limits<crl::time>::max();
 	for (auto i = begin(_keptAlive); i != end(_keptAlive);) {
-		const auto wait = (i->second - now);
+		const auto wait = (i->second.till - now);
 		if (wait <= 0) {
+			_keptAliveBytes -= i->second.bytes;
 			i = _keptAlive.erase(i);
 		} else {
 			++i;
@@ -41,10 +41,31 @@ public:
 		not_null<DocumentData*> document,
 		FileOrigin origin);
 
-	void keepAlive(not_null<DocumentData*> document);
+	// The kept alive documents of the shown chat are evicted last
+	// when the memory limit is reached, pass the document chat here.
+	void keepAlive(not_null<DocumentData*> document, PeerId peerId = 0);
+	void setShownPeer(PeerId peerId);
+
+	struct Stats {
+		int readers = 0;
+		int64 readersBytes = 0;
+		int keptAlive = 0;
+		int64 keptAliveBytes = 0;
+	};
+	[[nodiscard]] Stats stats() const;
+
+	// Returns the estimated bytes count of the released documents.
+	int64 clearAllKeptAlive();
 
 private:
+	struct KeptAlive {
+		crl::time till = 0;
+		int64 bytes = 0;
+		PeerId peerId = 0;
+	};
+
 	void clearKeptAlive();
+	void applyKeptAliveLimit(const std::shared_ptr<Document> &adding);
 
 	const not_null<Session*> _owner;
 
@@ -53,7 +74,9 @@ private:
 		not_null<DocumentData*>,
 		std::weak_ptr<Document>> _documents;
 
-	base::flat_map<std::shared_ptr<Document>, crl::time> _keptAlive;
+	base::flat_map<std::shared_ptr<Document>, KeptAlive> _keptAlive;
+	int64 _keptAliveBytes = 0;
+	PeerId _shownPeerId = 0;
 	base::Timer _keptAliveTimer;
 
 };
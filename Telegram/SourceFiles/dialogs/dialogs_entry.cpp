@@ -86,7 +86,9 @@ bool Entry::needUpdateInChatList() const {
 }
 
 void Entry::updateChatListSortPosition() {
-	if (session().supportMode()
+	if (owner().delayChatListSortPosition(this)) {
+		return;
+	} else if (session().supportMode()
 		&& _sortKeyInChatList != 0
 		&& session().settings().supportFixChatsOrder()) {
 		updateChatListEntry();
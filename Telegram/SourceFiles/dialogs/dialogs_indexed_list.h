@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "dialogs/dialogs_entry.h"
 #include "dialogs/dialogs_list.h"
+#include "dialogs/dialogs_word_index.h"
 
 class History;
 
@@ -47,6 +48,8 @@ public:
 		const auto i = _index.find(ch);
 		return (i != _index.end()) ? &i->second : nullptr;
 	}
+	// Rows of all() with a name word starting with each of the words,
+	// in the all() order.
 	std::vector<not_null<Row*>> filtered(const QStringList &words) const;
 
 	~IndexedList();
@@ -82,10 +85,14 @@ private:
 		not_null<History*> history,
 		const base::flat_set<QChar> &oldChars);
 
+	void indexNameWords(Key key, not_null<Row*> row);
+
 	SortMode _sortMode = SortMode();
 	List _list, _empty;
 	base::flat_map<QChar, List> _index;
 
+	WordIndex<Row> _words;
+
 };
 
 } // namespace Dialogs
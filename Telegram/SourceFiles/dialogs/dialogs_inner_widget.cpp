@@ -222,7 +222,7 @@ InnerWidget::InnerWidget(
 			this->update();
 		}
 		if (update.flags & (UpdateFlag::PhotoChanged | UpdateFlag::UserOccupiedChanged)) {
-			this->update();
+			updatePeerDialogRows(update.peer);
 			emit App::main()->dialogsUpdated();
 		}
 		if (update.flags & UpdateFlag::UserIsContact) {
@@ -1554,6 +1554,23 @@ void InnerWidget::updateSearchResult(not_null<PeerData*> peer) {
 	}
 }
 
+void InnerWidget::updatePeerDialogRows(not_null<PeerData*> peer) {
+	// Only chats list rows are easy to find for a peer, search results
+	// can show its userpic in different places, so repaint everything.
+	const auto history = (_state == WidgetState::Default)
+		? session().data().historyLoaded(peer)
+		: nullptr;
+	if (!history) {
+		update();
+		return;
+	}
+	updateDialogRow(RowDescriptor(history, FullMsgId()));
+	if (const auto folder = history->folder()) {
+		// Folder rows show userpics of the first chats inside.
+		updateDialogRow(RowDescriptor(folder, FullMsgId()));
+	}
+}
+
 void InnerWidget::updateDialogRow(
 		RowDescriptor row,
 		QRect updateRect,
@@ -1895,6 +1912,7 @@ InnerWidget::~InnerWidget() {
 void InnerWidget::clearSearchResults(bool clearPeerSearchResults) {
 	if (clearPeerSearchResults) _peerSearchResults.clear();
 	_searchResults.clear();
+	_localSearchResults.clear();
 	_searchedCount = _searchedMigratedCount = 0;
 	_lastSearchDate = 0;
 	_lastSearchPeer = nullptr;
@@ -1949,6 +1967,10 @@ void InnerWidget::visibleTopBottomUpdated(
 }
 
 void InnerWidget::itemRemoved(not_null<const HistoryItem*> item) {
+	_localSearchResults.erase(
+		ranges::remove(_localSearchResults, item),
+		end(_localSearchResults));
+
 	int wasCount = _searchResults.size();
 	for (auto i = _searchResults.begin(); i != _searchResults.end();) {
 		if ((*i)->item() == item) {
@@ -2006,7 +2028,9 @@ bool InnerWidget::searchReceived(
 		SearchRequestType type,
 		int fullCount) {
 	const auto uniquePeers = uniqueSearchResults();
+	auto local = std::vector<not_null<HistoryItem*>>();
 	if (type == SearchRequestType::FromStart || type == SearchRequestType::PeerFromStart) {
+		local = base::take(_localSearchResults);
 		clearSearchResults(false);
 	}
 	auto isGlobalSearch = (type == SearchRequestType::FromStart || type == SearchRequestType::FromOffset);
@@ -2060,6 +2084,13 @@ bool InnerWidget::searchReceived(
 			_lastSearchId = msgId;
 		}
 	}
+	if (!local.empty()) {
+		fullCount += mergeLocalSearchResults(
+			std::move(local),
+			lastDateFound,
+			((!_searchResults.empty()
+				&& _searchResults.front()->item() == inject) ? 1 : 0));
+	}
 	if (isMigratedSearch) {
 		_searchedMigratedCount = fullCount;
 	} else {
@@ -2078,6 +2109,60 @@ bool InnerWidget::searchReceived(
 	return lastDateFound != 0;
 }
 
+void InnerWidget::searchLocalReceived(
+		std::vector<not_null<HistoryItem*>> &&items) {
+	if (items.empty()) {
+		return;
+	}
+	clearSearchResults(false);
+	_localSearchResults = std::move(items);
+
+	const auto uniquePeers = uniqueSearchResults();
+	for (const auto item : _localSearchResults) {
+		if (!uniquePeers || !hasHistoryInResults(item->history())) {
+			_searchResults.push_back(
+				std::make_unique<FakeRow>(_searchInChat, item));
+		}
+	}
+	_searchedCount = _searchResults.size();
+	refresh();
+}
+
+// Adds the locally found messages that the server didn't return, if they
+// are not older than the last message of the server results page.
+int InnerWidget::mergeLocalSearchResults(
+		std::vector<not_null<HistoryItem*>> &&items,
+		TimeId lastDateFound,
+		int skipRows) {
+	const auto uniquePeers = uniqueSearchResults();
+	auto added = 0;
+	for (const auto item : items) {
+		if (lastDateFound && item->date() < lastDateFound) {
+			continue;
+		}
+		const auto i = ranges::find_if(_searchResults, [&](const auto &row) {
+			return (row->item() == item);
+		});
+		if (i != end(_searchResults)
+			|| (uniquePeers && hasHistoryInResults(item->history()))) {
+			continue;
+		}
+		_searchResults.push_back(
+			std::make_unique<FakeRow>(_searchInChat, item));
+		++added;
+	}
+	if (added > 0) {
+		ranges::stable_sort(
+			begin(_searchResults) + skipRows,
+			end(_searchResults),
+			ranges::greater(),
+			[](const std::unique_ptr<FakeRow> &row) {
+				return row->item()->date();
+			});
+	}
+	return added;
+}
+
 void InnerWidget::peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -76,6 +76,7 @@ public:
 		HistoryItem *inject,
 		SearchRequestType type,
 		int fullCount);
+	void searchLocalReceived(std::vector<not_null<HistoryItem*>> &&items);
 	void peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -213,6 +214,10 @@ private:
 	}
 	bool uniqueSearchResults() const;
 	bool hasHistoryInResults(not_null<History*> history) const;
+	int mergeLocalSearchResults(
+		std::vector<not_null<HistoryItem*>> &&items,
+		TimeId lastDateFound,
+		int skipRows);
 
 	int defaultRowTop(not_null<Row*> row) const;
 	void setupOnlineStatusCheck();
@@ -241,6 +246,7 @@ private:
 	friend inline constexpr auto is_flag_type(UpdateRowSection) { return true; };
 
 	void updateSearchResult(not_null<PeerData*> peer);
+	void updatePeerDialogRows(not_null<PeerData*> peer);
 	void updateDialogRow(
 		RowDescriptor row,
 		QRect updateRect = QRect(),
@@ -364,6 +370,7 @@ private:
 	int _peerSearchPressed = -1;
 
 	std::vector<std::unique_ptr<FakeRow>> _searchResults;
+	std::vector<not_null<HistoryItem*>> _localSearchResults;
 	int _searchedCount = 0;
 	int _searchedMigratedCount = 0;
 	int _searchedSelected = -1;
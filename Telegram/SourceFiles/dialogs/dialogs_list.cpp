@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "dialogs/dialogs_entry.h"
 #include "dialogs/dialogs_layout.h"
+#include "dialogs/dialogs_list_order.h"
 #include "data/data_session.h"
 #include "mainwidget.h"
 
@@ -57,24 +58,27 @@ not_null<Row*> List::addByName(Key key) {
 	return row;
 }
 
+// All rows except the adjusted one stay sorted, so the new position
+// is found by a binary search instead of a linear scan.
 void List::adjustByName(not_null<Row*> row) {
 	Expects(row->pos() >= 0 && row->pos() < _rows.size());
 
 	const auto &name = row->entry()->chatListName();
 	const auto index = row->pos();
 	const auto i = _rows.begin() + index;
-	const auto before = std::find_if(i + 1, _rows.end(), [&](Row *row) {
-		const auto &greater = row->entry()->chatListName();
-		return greater.compare(name, Qt::CaseInsensitive) >= 0;
+	const auto before = std::partition_point(i + 1, _rows.end(), [&](
+			Row *row) {
+		const auto &less = row->entry()->chatListName();
+		return less.compare(name, Qt::CaseInsensitive) < 0;
 	});
 	if (before != i + 1) {
 		rotate(i, i + 1, before);
 	} else if (i != _rows.begin()) {
-		const auto from = std::make_reverse_iterator(i);
-		const auto after = std::find_if(from, _rows.rend(), [&](Row *row) {
+		const auto after = std::partition_point(_rows.begin(), i, [&](
+				Row *row) {
 			const auto &less = row->entry()->chatListName();
 			return less.compare(name, Qt::CaseInsensitive) <= 0;
-		}).base();
+		});
 		if (after != i) {
 			rotate(after, i, i + 1);
 		}
@@ -84,23 +88,12 @@ void List::adjustByName(not_null<Row*> row) {
 void List::adjustByDate(not_null<Row*> row) {
 	Expects(_sortMode == SortMode::Date);
 
-	const auto key = row->sortKey();
-	const auto index = row->pos();
-	const auto i = _rows.begin() + index;
-	const auto before = std::find_if(i + 1, _rows.end(), [&](Row *row) {
-		return (row->sortKey() <= key);
-	});
-	if (before != i + 1) {
-		rotate(i, i + 1, before);
-	} else {
-		const auto from = std::make_reverse_iterator(i);
-		const auto after = std::find_if(from, _rows.rend(), [&](Row *row) {
-			return (row->sortKey() >= key);
-		}).base();
-		if (after != i) {
-			rotate(after, i, i + 1);
-		}
-	}
+	const auto [from, till] = MoveToSortedPlace(
+		_rows.begin(),
+		_rows.begin() + row->pos(),
+		_rows.end(),
+		[](not_null<Row*> row) { return row->sortKey(); });
+	refreshPositions(from, till);
 }
 
 bool List::moveToTop(Key key) {
@@ -119,10 +112,14 @@ void List::rotate(
 		std::vector<not_null<Row*>>::iterator middle,
 		std::vector<not_null<Row*>>::iterator last) {
 	std::rotate(first, middle, last);
+	refreshPositions(first, last);
+}
 
-	auto count = (last - first);
+void List::refreshPositions(
+		std::vector<not_null<Row*>>::iterator first,
+		std::vector<not_null<Row*>>::iterator last) {
 	auto index = (first - _rows.begin());
-	while (count--) {
+	while (first != last) {
 		(*first++)->_pos = index++;
 	}
 }
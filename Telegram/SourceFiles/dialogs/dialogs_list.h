@@ -76,6 +76,9 @@ private:
 		std::vector<not_null<Row*>>::iterator first,
 		std::vector<not_null<Row*>>::iterator middle,
 		std::vector<not_null<Row*>>::iterator last);
+	void refreshPositions(
+		std::vector<not_null<Row*>>::iterator first,
+		std::vector<not_null<Row*>>::iterator last);
 
 	SortMode _sortMode = SortMode();
 	std::vector<not_null<Row*>> _rows;
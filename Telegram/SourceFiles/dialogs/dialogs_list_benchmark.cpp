@@ -0,0 +1,240 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "dialogs/dialogs_list_order.h"
+#include "dialogs/dialogs_word_index.h"
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Usage: benchmark_dialogs [chats] [updates] [searches]
+//
+// Runs the chats list ordering and the name word index, which are used by
+// Dialogs::List and Dialogs::IndexedList, on synthetic rows: first fills
+// the index, then reorders the list on a storm of incoming messages and
+// then searches it by name word prefixes.
+//
+// Fixed random seeds are used, so the numbers of different builds are
+// comparable.
+
+namespace {
+
+using namespace Dialogs;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+	int chats = 100000;
+	int updates = 1000000;
+	int searches = 10000;
+};
+
+// Same as Dialogs::Row for the ordering and the index.
+class BenchmarkRow final {
+public:
+	explicit BenchmarkRow(int pos) : _pos(pos) {
+	}
+
+	[[nodiscard]] int pos() const {
+		return _pos;
+	}
+	void setPos(int pos) {
+		_pos = pos;
+	}
+	[[nodiscard]] uint64 sortKey() const {
+		return _sortKey;
+	}
+	void setSortKey(uint64 key) {
+		_sortKey = key;
+	}
+
+	base::flat_set<QString> words;
+
+private:
+	int _pos = 0;
+	uint64 _sortKey = 0;
+
+};
+
+using Rows = std::vector<not_null<BenchmarkRow*>>;
+
+Options ParseOptions(int argc, char *argv[]) {
+	auto result = Options();
+	const auto fields = {
+		&result.chats,
+		&result.updates,
+		&result.searches,
+	};
+	auto index = 1;
+	for (const auto field : fields) {
+		if (index < argc) {
+			const auto value = QString::fromLatin1(argv[index++]).toInt();
+			if (value > 0) {
+				*field = value;
+			}
+		}
+	}
+	return result;
+}
+
+QString MakeWord(std::mt19937 &generator) {
+	constexpr const char *kSyllables[] = {
+		"an", "bo", "ca", "de", "el", "fi", "go", "ha", "in", "jo",
+		"ka", "le", "mi", "no", "or", "pa", "ri", "sa", "te", "ul",
+		"va", "wi", "xe", "yo", "za", "ch", "sh", "th", "ar", "es",
+	};
+	const auto count = 2 + int(generator() % 3);
+	auto result = QString();
+	for (auto i = 0; i != count; ++i) {
+		result += kSyllables[generator() % std::size(kSyllables)];
+	}
+	return result;
+}
+
+std::vector<std::unique_ptr<BenchmarkRow>> MakeRows(int count) {
+	auto generator = std::mt19937(1);
+	auto result = std::vector<std::unique_ptr<BenchmarkRow>>();
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		auto row = std::make_unique<BenchmarkRow>(i);
+		const auto words = 1 + int(generator() % 3);
+		for (auto j = 0; j != words; ++j) {
+			row->words.emplace(MakeWord(generator));
+		}
+		row->setSortKey(uint64(count - i) << 32);
+		result.push_back(std::move(row));
+	}
+	return result;
+}
+
+double SecondsSince(Clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(Clock::now() - started).count();
+}
+
+void Report(const char *name, int count, double seconds) {
+	std::printf(
+		"%-28s %10d ops %10.3f s %10.0f ns/op\n",
+		name,
+		count,
+		seconds,
+		count ? (seconds * 1e9 / count) : 0.);
+}
+
+void BenchmarkIndex(
+		WordIndex<BenchmarkRow> &index,
+		const std::vector<std::unique_ptr<BenchmarkRow>> &rows) {
+	const auto started = Clock::now();
+	for (const auto &row : rows) {
+		index.add(row.get(), row->words);
+	}
+	Report("index names", int(rows.size()), SecondsSince(started));
+}
+
+// Most of the messages come to the chats on top of the list.
+void BenchmarkStorm(Rows &list, const Options &options) {
+	auto generator = std::mt19937(2);
+	auto distribution = std::geometric_distribution<int>(
+		std::min(100. / list.size(), 0.5));
+	auto date = uint64(list.size() + 1);
+	const auto started = Clock::now();
+	for (auto i = 0; i != options.updates; ++i) {
+		const auto index = distribution(generator) % int(list.size());
+		const auto row = list[index];
+		row->setSortKey(++date << 32);
+		const auto [from, till] = MoveToSortedPlace(
+			list.begin(),
+			list.begin() + index,
+			list.end(),
+			[](not_null<BenchmarkRow*> row) { return row->sortKey(); });
+		for (auto j = from; j != till; ++j) {
+			(*j)->setPos(int(j - list.begin()));
+		}
+	}
+	Report("incoming messages", options.updates, SecondsSince(started));
+
+	const auto sorted = std::is_sorted(
+		list.begin(),
+		list.end(),
+		[](not_null<BenchmarkRow*> a, not_null<BenchmarkRow*> b) {
+			return a->sortKey() > b->sortKey();
+		});
+	if (!sorted) {
+		std::printf("List order is broken.\n");
+		std::exit(1);
+	}
+}
+
+void BenchmarkSearch(
+		const WordIndex<BenchmarkRow> &index,
+		const std::vector<std::unique_ptr<BenchmarkRow>> &rows,
+		const Options &options) {
+	auto generator = std::mt19937(3);
+	const auto queries = [&](int length, int words) {
+		auto result = std::vector<QStringList>();
+		result.reserve(options.searches);
+		for (auto i = 0; i != options.searches; ++i) {
+			auto query = QStringList();
+			for (auto j = 0; j != words; ++j) {
+				const auto &row = rows[generator() % rows.size()];
+				const auto &word = *std::next(
+					row->words.begin(),
+					generator() % row->words.size());
+				query.push_back(word.mid(0, length));
+			}
+			result.push_back(std::move(query));
+		}
+		return result;
+	};
+	const auto measure = [&](const char *name, int length, int words) {
+		const auto list = queries(length, words);
+		auto found = int64();
+		const auto started = Clock::now();
+		for (const auto &query : list) {
+			found += index.filtered(query).size();
+		}
+		Report(name, options.searches, SecondsSince(started));
+		std::printf(
+			"%-28s %10.1f rows found on average\n",
+			"",
+			double(found) / options.searches);
+	};
+	measure("search one letter", 1, 1);
+	measure("search two letters", 2, 1);
+	measure("search four letters", 4, 1);
+	measure("search two words", 3, 2);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const auto options = ParseOptions(argc, argv);
+	std::printf(
+		"chats: %d, updates: %d, searches: %d\n",
+		options.chats,
+		options.updates,
+		options.searches);
+
+	const auto rows = MakeRows(options.chats);
+	auto list = Rows();
+	list.reserve(rows.size());
+	for (const auto &row : rows) {
+		list.push_back(row.get());
+	}
+
+	auto index = WordIndex<BenchmarkRow>();
+	BenchmarkIndex(index, rows);
+	BenchmarkStorm(list, options);
+	BenchmarkSearch(index, rows, options);
+	return 0;
+}
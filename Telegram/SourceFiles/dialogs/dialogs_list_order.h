@@ -0,0 +1,42 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <algorithm>
+
+namespace Dialogs {
+
+// All rows except the one at 'i' are sorted by the descending key.
+// Moves that row to its place and returns the range of the moved rows.
+template <typename Iterator, typename SortKey>
+std::pair<Iterator, Iterator> MoveToSortedPlace(
+		Iterator begin,
+		Iterator i,
+		Iterator end,
+		SortKey &&sortKey) {
+	const auto key = sortKey(*i);
+	const auto before = std::partition_point(i + 1, end, [&](
+			const auto &row) {
+		return (sortKey(row) > key);
+	});
+	if (before != i + 1) {
+		std::rotate(i, i + 1, before);
+		return { i, before };
+	}
+	const auto after = std::partition_point(begin, i, [&](
+			const auto &row) {
+		return (sortKey(row) >= key);
+	});
+	if (after != i) {
+		std::rotate(after, i, i + 1);
+		return { after, i + 1 };
+	}
+	return { i, i };
+}
+
+} // namespace Dialogs
@@ -768,6 +768,7 @@ bool Widget::onSearchMessages(bool searchCache) {
 		_searchNextRate = 0;
 		_searchFull = _searchFullMigrated = false;
 		MTP::cancel(base::take(_searchRequest));
+		searchLocally();
 		if (const auto peer = _searchInChat.peer()) {
 			const auto flags = _searchQueryFrom
 				? MTP_flags(MTPmessages_Search::Flag::f_from_id)
@@ -856,6 +857,18 @@ bool Widget::onSearchMessages(bool searchCache) {
 	return result;
 }
 
+void Widget::searchLocally() {
+	const auto history = _searchInChat.history();
+	if (_searchInChat && !history) {
+		return;
+	}
+	_inner->searchLocalReceived(session().data().searchIndex().search(
+		_searchQuery,
+		history,
+		_searchQueryFrom,
+		SearchPerPage));
+}
+
 bool Widget::searchForPeersRequired(const QString &query) const {
 	if (_searchInChat || query.isEmpty()) {
 		return false;
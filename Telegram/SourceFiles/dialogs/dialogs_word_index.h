@@ -0,0 +1,120 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+#include "base/flat_set.h"
+
+#include <map>
+
+namespace Dialogs {
+
+// Sorted name words let us find all the rows by a word prefix.
+// Row should have an int pos() method, the rows are returned in its order.
+template <typename Row>
+class WordIndex final {
+public:
+	void add(not_null<Row*> row, const base::flat_set<QString> &words);
+	void remove(not_null<Row*> row);
+	void clear();
+
+	// Rows with a name word starting with each of the words.
+	[[nodiscard]] std::vector<not_null<Row*>> filtered(
+		const QStringList &words) const;
+
+private:
+	[[nodiscard]] std::vector<not_null<Row*>> byPrefix(
+		const QString &prefix) const;
+
+	std::map<QString, base::flat_set<not_null<Row*>>> _rows;
+	base::flat_map<not_null<Row*>, std::vector<QString>> _words;
+
+};
+
+template <typename Row>
+void WordIndex<Row>::add(
+		not_null<Row*> row,
+		const base::flat_set<QString> &words) {
+	auto &list = _words[row];
+	for (const auto &word : words) {
+		_rows[word].emplace(row);
+		list.push_back(word);
+	}
+}
+
+template <typename Row>
+void WordIndex<Row>::remove(not_null<Row*> row) {
+	const auto i = _words.find(row);
+	if (i == end(_words)) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _rows.find(word);
+		if (j != end(_rows)) {
+			j->second.remove(row);
+			if (j->second.empty()) {
+				_rows.erase(j);
+			}
+		}
+	}
+	_words.erase(i);
+}
+
+template <typename Row>
+void WordIndex<Row>::clear() {
+	_rows.clear();
+	_words.clear();
+}
+
+template <typename Row>
+std::vector<not_null<Row*>> WordIndex<Row>::byPrefix(
+		const QString &prefix) const {
+	auto result = std::vector<not_null<Row*>>();
+	for (auto i = _rows.lower_bound(prefix); i != _rows.end(); ++i) {
+		if (!i->first.startsWith(prefix)) {
+			break;
+		}
+		result.insert(result.end(), i->second.begin(), i->second.end());
+	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), result.end());
+	return result;
+}
+
+template <typename Row>
+std::vector<not_null<Row*>> WordIndex<Row>::filtered(
+		const QStringList &words) const {
+	auto result = std::optional<std::vector<not_null<Row*>>>();
+	for (const auto &word : words) {
+		if (word.isEmpty()) {
+			continue;
+		}
+		auto rows = byPrefix(word);
+		if (result) {
+			auto both = std::vector<not_null<Row*>>();
+			std::set_intersection(
+				result->begin(),
+				result->end(),
+				rows.begin(),
+				rows.end(),
+				std::back_inserter(both));
+			rows = std::move(both);
+		}
+		if (rows.empty()) {
+			return {};
+		}
+		result = std::move(rows);
+	}
+	if (!result) {
+		return {};
+	}
+	ranges::sort(*result, ranges::less(), &Row::pos);
+	return std::move(*result);
+}
+
+} // namespace Dialogs
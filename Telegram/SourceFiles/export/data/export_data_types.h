@@ -571,6 +571,10 @@ struct DialogInfo {
 	bool isLeftChannel = false;
 	QString relativePath;
 
+	// Filled from the export manifest in the incremental mode.
+	int32 lastExportedMessageId = 0;
+	int alreadyExportedCount = 0;
+
 	// Filled when requesting dialog messages.
 	std::vector<int> messagesCountPerSplit;
 };
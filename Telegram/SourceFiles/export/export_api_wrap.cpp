@@ -21,9 +21,8 @@ namespace Export {
 namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
-constexpr auto kFileChunkSize = 128 * 1024;
-constexpr auto kFileRequestsCount = 2;
-constexpr auto kFileNextRequestDelay = crl::time(20);
+constexpr auto kFileChunkSize = 512 * 1024;
+constexpr auto kFileRequestsCount = 4;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
@@ -185,6 +184,10 @@ struct ApiWrap::FileProcess {
 	int offset = 0;
 	int size = 0;
 
+	// Several parts may be in flight, responses for a finished process
+	// are recognized by this id and skipped.
+	uint64 id = 0;
+
 	struct Request {
 		int offset = 0;
 		QByteArray bytes;
@@ -217,6 +220,11 @@ struct ApiWrap::DialogsProcess : ChatsProcess {
 	TimeId offsetDate = 0;
 	int32 offsetId = 0;
 	MTPInputPeer offsetPeer = MTP_inputPeerEmpty();
+
+	// Left channels are collected in parallel with the dialogs.
+	int leftChannelsCount = 0;
+	bool dialogsReceived = false;
+	bool leftChannelsReceived = false;
 };
 
 struct ApiWrap::ChatProcess {
@@ -236,6 +244,12 @@ struct ApiWrap::ChatProcess {
 	std::optional<Data::MessagesSlice> slice;
 	bool lastSlice = false;
 	int fileIndex = 0;
+
+	// The next slice is requested while files of the current one load.
+	std::optional<Data::MessagesSlice> preloaded;
+	bool preloadedLast = false;
+	bool preloading = false;
+	bool waitingPreloaded = false;
 };
 
 
@@ -349,6 +363,8 @@ std::optional<QString> ApiWrap::LoadedFileCache::find(
 
 ApiWrap::FileProcess::FileProcess(const QString &path, Output::Stats *stats)
 : file(path, stats) {
+	static auto LastId = uint64(0);
+	id = ++LastId;
 }
 
 template <typename Request>
@@ -382,6 +398,7 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 		|| location.data.type() == mtpc_inputTakeoutFileLocation);
 	Expects(_takeoutId.has_value());
 
+	const auto id = _fileProcess ? _fileProcess->id : uint64(0);
 	return std::move(_mtp.request(MTPInvokeWithTakeout<MTPupload_GetFile>(
 		MTP_long(*_takeoutId),
 		MTPupload_GetFile(
@@ -390,7 +407,9 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 			MTP_int(offset),
 			MTP_int(kFileChunkSize))
 	)).fail([=](RPCError &&result) {
-		if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
+		if (!_fileProcess || _fileProcess->id != id) {
+			return;
+		} else if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
 			&& _otherDataProcess != nullptr) {
 			filePartDone(
 				0,
@@ -631,6 +650,7 @@ void ApiWrap::requestDialogsList(
 	_dialogsProcess->progress = std::move(progress);
 	_dialogsProcess->done = std::move(done);
 
+	requestLeftChannelsIfNeeded();
 	requestDialogsSlice();
 }
 
@@ -946,6 +966,7 @@ void ApiWrap::requestMessages(
 
 	_chatProcess = std::make_unique<ChatProcess>();
 	_chatProcess->info = info;
+	_chatProcess->largestIdPlusOne = info.lastExportedMessageId + 1;
 	_chatProcess->start = std::move(start);
 	_chatProcess->fileProgress = std::move(progress);
 	_chatProcess->handleSlice = std::move(slice);
@@ -1074,6 +1095,7 @@ void ApiWrap::requestSinglePeerDialog() {
 		if (!_dialogsProcess->progress(_dialogsProcess->processedCount)) {
 			return;
 		}
+		_dialogsProcess->dialogsReceived = true;
 		finishDialogsList();
 	};
 	const auto requestUser = [&](const MTPInputUser &data) {
@@ -1143,7 +1165,9 @@ void ApiWrap::requestDialogsSlice() {
 			: info.chats.back();
 		appendDialogsSlice(std::move(info));
 
-		if (!_dialogsProcess->progress(_dialogsProcess->processedCount)) {
+		if (!_dialogsProcess->progress(
+				_dialogsProcess->processedCount
+				+ _dialogsProcess->leftChannelsCount)) {
 			return;
 		}
 
@@ -1157,7 +1181,8 @@ void ApiWrap::requestDialogsSlice() {
 			_dialogsProcess->offsetDate = 0;
 			_dialogsProcess->offsetPeer = MTP_inputPeerEmpty();
 		} else {
-			requestLeftChannelsIfNeeded();
+			_dialogsProcess->dialogsReceived = true;
+			finishDialogsList();
 			return;
 		}
 		requestDialogsSlice();
@@ -1176,26 +1201,36 @@ void ApiWrap::appendDialogsSlice(Data::DialogsInfo &&info) {
 }
 
 void ApiWrap::requestLeftChannelsIfNeeded() {
-	if (_settings->types & Settings::Type::GroupsChannelsMask) {
+	Expects(_dialogsProcess != nullptr);
+
+	if (!_settings->onlySinglePeer()
+		&& (_settings->types & Settings::Type::GroupsChannelsMask)) {
 		requestLeftChannelsList([=](int count) {
 			Expects(_dialogsProcess != nullptr);
 
+			_dialogsProcess->leftChannelsCount = count;
 			return _dialogsProcess->progress(
 				_dialogsProcess->processedCount + count);
 		}, [=](Data::DialogsInfo &&result) {
 			Expects(_dialogsProcess != nullptr);
 
 			_dialogsProcess->info.left = std::move(result.left);
+			_dialogsProcess->leftChannelsReceived = true;
 			finishDialogsList();
 		});
 	} else {
-		finishDialogsList();
+		_dialogsProcess->leftChannelsReceived = true;
 	}
 }
 
 void ApiWrap::finishDialogsList() {
 	Expects(_dialogsProcess != nullptr);
 
+	if (!_dialogsProcess->dialogsReceived
+		|| !_dialogsProcess->leftChannelsReceived) {
+		return;
+	}
+
 	const auto process = base::take(_dialogsProcess);
 	Data::FinalizeDialogsInfo(process->info, *_settings);
 	process->done(std::move(process->info));
@@ -1281,6 +1316,14 @@ void ApiWrap::appendChatsSlice(
 void ApiWrap::requestMessagesSlice() {
 	Expects(_chatProcess != nullptr);
 
+	if (_chatProcess->preloading) {
+		_chatProcess->waitingPreloaded = true;
+		return;
+	} else if (_chatProcess->preloaded) {
+		_chatProcess->lastSlice = _chatProcess->preloadedLast;
+		loadMessagesFiles(*base::take(_chatProcess->preloaded));
+		return;
+	}
 	const auto count = _chatProcess->info.messagesCountPerSplit[
 		_chatProcess->localSplitIndex];
 	if (!count) {
@@ -1293,21 +1336,54 @@ void ApiWrap::requestMessagesSlice() {
 		-kMessagesSliceLimit,
 		kMessagesSliceLimit,
 		[=](const MTPmessages_Messages &result) {
-		Expects(_chatProcess != nullptr);
+		messagesSliceReceived(result, false);
+	});
+}
 
-		result.match([&](const MTPDmessages_messagesNotModified &data) {
-			error("Unexpected messagesNotModified received.");
-		}, [&](const auto &data) {
-			if constexpr (MTPDmessages_messages::Is<decltype(data)>()) {
+void ApiWrap::preloadMessagesSlice(int32 offsetId) {
+	Expects(_chatProcess != nullptr);
+	Expects(!_chatProcess->preloading);
+	Expects(!_chatProcess->preloaded.has_value());
+
+	_chatProcess->preloading = true;
+	requestChatMessages(
+		_chatProcess->info.splits[_chatProcess->localSplitIndex],
+		offsetId,
+		-kMessagesSliceLimit,
+		kMessagesSliceLimit,
+		[=](const MTPmessages_Messages &result) {
+		messagesSliceReceived(result, true);
+	});
+}
+
+void ApiWrap::messagesSliceReceived(
+		const MTPmessages_Messages &result,
+		bool preloaded) {
+	Expects(_chatProcess != nullptr);
+
+	result.match([&](const MTPDmessages_messagesNotModified &data) {
+		error("Unexpected messagesNotModified received.");
+	}, [&](const auto &data) {
+		const auto last = MTPDmessages_messages::Is<decltype(data)>();
+		auto slice = Data::ParseMessagesSlice(
+			_chatProcess->context,
+			data.vmessages(),
+			data.vusers(),
+			data.vchats(),
+			_chatProcess->info.relativePath);
+		if (!preloaded) {
+			if (last) {
 				_chatProcess->lastSlice = true;
 			}
-			loadMessagesFiles(Data::ParseMessagesSlice(
-				_chatProcess->context,
-				data.vmessages(),
-				data.vusers(),
-				data.vchats(),
-				_chatProcess->info.relativePath));
-		});
+			loadMessagesFiles(std::move(slice));
+			return;
+		}
+		_chatProcess->preloading = false;
+		_chatProcess->preloaded = std::move(slice);
+		_chatProcess->preloadedLast = last;
+		if (base::take(_chatProcess->waitingPreloaded)) {
+			requestMessagesSlice();
+		}
 	});
 }
 
@@ -1381,6 +1457,8 @@ void ApiWrap::loadMessagesFiles(Data::MessagesSlice &&slice) {
 
 	if (slice.list.empty()) {
 		_chatProcess->lastSlice = true;
+	} else if (!_chatProcess->lastSlice) {
+		preloadMessagesSlice(slice.list.back().id + 1);
 	}
 	_chatProcess->slice = std::move(slice);
 	_chatProcess->fileIndex = 0;
@@ -1460,7 +1538,8 @@ void ApiWrap::finishMessagesSlice() {
 		&& (++_chatProcess->localSplitIndex
 			< _chatProcess->info.splits.size())) {
 		_chatProcess->lastSlice = false;
-		_chatProcess->largestIdPlusOne = 1;
+		_chatProcess->largestIdPlusOne
+			= _chatProcess->info.lastExportedMessageId + 1;
 	}
 	if (!_chatProcess->lastSlice) {
 		requestMessagesSlice();
@@ -1648,33 +1727,30 @@ auto ApiWrap::prepareFileProcess(
 }
 
 void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
+	if (!_fileProcess) {
 		return;
 	}
-
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	fileRequest(
-		_fileProcess->location,
-		_fileProcess->offset
-	).done([=](const MTPupload_File &result) {
-		filePartDone(offset, result);
-	}).send();
-	_fileProcess->offset += kFileChunkSize;
-
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
+	const auto canRequest = [&] {
+		const auto count = int(_fileProcess->requests.size());
+		return (_fileProcess->size > 0)
+			// With a known size several parts are requested in parallel.
+			? (count < kFileRequestsCount
+				&& _fileProcess->offset < _fileProcess->size)
+			: !count;
+	};
+	while (canRequest()) {
+		const auto offset = _fileProcess->offset;
+		const auto id = _fileProcess->id;
+		_fileProcess->requests.push_back({ offset });
+		fileRequest(
+			_fileProcess->location,
+			_fileProcess->offset
+		).done([=](const MTPupload_File &result) {
+			if (_fileProcess && _fileProcess->id == id) {
+				filePartDone(offset, result);
+			}
+		}).send();
+		_fileProcess->offset += kFileChunkSize;
 	}
 }
 
@@ -1741,6 +1817,10 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 void ApiWrap::filePartRefreshReference(int offset) {
 	Expects(_fileProcess != nullptr);
 
+	const auto id = _fileProcess->id;
+	const auto alive = [=] {
+		return _fileProcess && (_fileProcess->id == id);
+	};
 	const auto &origin = _fileProcess->origin;
 	if (!origin.messageId) {
 		error("FILE_REFERENCE error for non-message file.");
@@ -1762,10 +1842,14 @@ void ApiWrap::filePartRefreshReference(int offset) {
 				1,
 				MTP_inputMessageID(MTP_int(origin.messageId)))
 		)).fail([=](const RPCError &error) {
-			filePartUnavailable();
+			if (alive()) {
+				filePartUnavailable();
+			}
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
-			filePartExtractReference(offset, result);
+			if (alive()) {
+				filePartExtractReference(offset, result);
+			}
 		}).send();
 	} else {
 		splitRequest(origin.split, MTPmessages_GetMessages(
@@ -1773,10 +1857,14 @@ void ApiWrap::filePartRefreshReference(int offset) {
 				1,
 				MTP_inputMessageID(MTP_int(origin.messageId)))
 		)).fail([=](const RPCError &error) {
-			filePartUnavailable();
+			if (alive()) {
+				filePartUnavailable();
+			}
 			return true;
 		}).done([=](const MTPmessages_Messages &result) {
-			filePartExtractReference(offset, result);
+			if (alive()) {
+				filePartExtractReference(offset, result);
+			}
 		}).send();
 	}
 }
@@ -1805,11 +1893,14 @@ void ApiWrap::filePartExtractReference(
 					_fileProcess->location,
 					message.thumb().file.location);
 				if (refresh1 || refresh2) {
+					const auto id = _fileProcess->id;
 					fileRequest(
 						_fileProcess->location,
 						offset
 					).done([=](const MTPupload_File &result) {
-						filePartDone(offset, result);
+						if (_fileProcess && _fileProcess->id == id) {
+							filePartDone(offset, result);
+						}
 					}).send();
 					return;
 				}
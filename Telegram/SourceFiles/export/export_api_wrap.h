@@ -145,6 +145,10 @@ private:
 	void checkFirstMessageDate(int localSplitIndex, int count);
 	void messagesCountLoaded(int localSplitIndex, int count);
 	void requestMessagesSlice();
+	void preloadMessagesSlice(int32 offsetId);
+	void messagesSliceReceived(
+		const MTPmessages_Messages &result,
+		bool preloaded);
 	void requestChatMessages(
 		int splitIndex,
 		int offsetId,
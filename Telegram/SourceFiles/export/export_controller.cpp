@@ -11,9 +11,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/export_settings.h"
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_abstract.h"
+#include "export/output/export_output_archive.h"
+#include "export/output/export_output_manifest.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_stats.h"
 
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
 namespace Export {
 namespace {
 
@@ -59,6 +64,7 @@ private:
 	void setState(State &&state);
 	void ioError(const QString &path);
 	bool ioCatchError(Output::Result result);
+	bool packArchive();
 	void setFinishedState();
 
 	//void requestPasswordState();
@@ -70,6 +76,10 @@ private:
 	void initialize();
 	void initialized(const ApiWrap::StartInfo &info);
 	void collectDialogsList();
+	void applyManifest();
+	bool rememberDialogExported(
+		Data::PeerId peerId,
+		int alreadyExportedCount);
 	void exportPersonalInfo();
 	void exportUserpics();
 	void exportContacts();
@@ -107,6 +117,12 @@ private:
 
 	int _messagesWritten = 0;
 	int _messagesCount = 0;
+	int32 _messagesLastId = 0;
+
+	QString _manifestPath;
+	Output::Manifest _manifest;
+
+	QString _archivePath;
 
 	int _userpicsWritten = 0;
 	int _userpicsCount = 0;
@@ -237,6 +253,10 @@ void ControllerObject::startExport(
 	_settings = NormalizeSettings(settings);
 	_environment = environment;
 
+	_manifestPath = Output::Manifest::PathInFolder(
+		QDir(_settings.path).absolutePath());
+	_manifest = Output::Manifest::Read(_manifestPath);
+
 	_settings.path = Output::NormalizePath(_settings);
 	_writer = Output::CreateWriter(_settings.format);
 	fillExportSteps();
@@ -311,7 +331,7 @@ void ControllerObject::cancelExportFast() {
 
 void ControllerObject::exportNext() {
 	if (++_stepIndex >= _steps.size()) {
-		if (ioCatchError(_writer->finish())) {
+		if (ioCatchError(_writer->finish()) || !packArchive()) {
 			return;
 		}
 		_api.finishExport([=] {
@@ -356,10 +376,75 @@ void ControllerObject::collectDialogsList() {
 		return true;
 	}, [=](Data::DialogsInfo &&result) {
 		_dialogsInfo = std::move(result);
+		if (_settings.incremental) {
+			applyManifest();
+		}
 		exportNext();
 	});
 }
 
+void ControllerObject::applyManifest() {
+	const auto apply = [&](std::vector<Data::DialogInfo> &list) {
+		for (auto &info : list) {
+			info.lastExportedMessageId = _manifest.lastMessageId(
+				info.peerId);
+			info.alreadyExportedCount = _manifest.exportedCount(
+				info.peerId);
+		}
+		const auto nothingNew = [](const Data::DialogInfo &info) {
+			return (info.lastExportedMessageId > 0)
+				&& (info.topMessageId > 0)
+				&& (info.topMessageId <= info.lastExportedMessageId);
+		};
+		list.erase(ranges::remove_if(list, nothingNew), end(list));
+	};
+	apply(_dialogsInfo.chats);
+	apply(_dialogsInfo.left);
+}
+
+bool ControllerObject::rememberDialogExported(
+		Data::PeerId peerId,
+		int alreadyExportedCount) {
+	if (!_messagesLastId) {
+		return true;
+	}
+	_manifest.setLastMessageId(
+		peerId,
+		_messagesLastId,
+		alreadyExportedCount + _messagesWritten);
+
+	// Written after each chat, so that an interrupted export can be
+	// continued by an incremental one from the last finished chat.
+	return !ioCatchError(_manifest.write(_manifestPath));
+}
+
+bool ControllerObject::packArchive() {
+	if (!_settings.archive) {
+		return true;
+	}
+	const auto path = Output::ArchivePath(_settings.path);
+	if (ioCatchError(Output::PackFolder(_settings.path, path))) {
+		return false;
+	}
+	_archivePath = path;
+
+	// The manifest of the incremental exports is kept in the folder
+	// chosen by the user, which is the export folder if it was empty.
+	const auto folder = QDir(_settings.path);
+	const auto mode = QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot;
+	for (const auto &entry : folder.entryInfoList(mode)) {
+		if (entry.absoluteFilePath() == _manifestPath) {
+			continue;
+		} else if (entry.isDir()) {
+			QDir(entry.absoluteFilePath()).removeRecursively();
+		} else {
+			QFile::remove(entry.absoluteFilePath());
+		}
+	}
+	folder.rmdir(folder.absolutePath());
+	return true;
+}
+
 void ControllerObject::exportPersonalInfo() {
 	setState(statePersonalInfo());
 	_api.requestPersonalInfo([=](Data::PersonalInfo &&result) {
@@ -439,13 +524,19 @@ void ControllerObject::exportNextDialog() {
 	const auto index = ++_dialogIndex;
 	const auto info = _dialogsInfo.item(index);
 	if (info) {
+		const auto peerId = info->peerId;
+		const auto alreadyExported = info->alreadyExportedCount;
 		_api.requestMessages(*info, [=](const Data::DialogInfo &info) {
 			if (ioCatchError(_writer->writeDialogStart(info))) {
 				return false;
 			}
 			_messagesWritten = 0;
-			_messagesCount = ranges::accumulate(
-				info.messagesCountPerSplit,
+			_messagesLastId = 0;
+			// The server counts the whole history, but in the incremental
+			// mode we load only the messages after the exported ones.
+			_messagesCount = std::max(
+				ranges::accumulate(info.messagesCountPerSplit, 0)
+					- info.alreadyExportedCount,
 				0);
 			setState(stateDialogs(DownloadProgress()));
 			return true;
@@ -457,12 +548,20 @@ void ControllerObject::exportNextDialog() {
 				return false;
 			}
 			_messagesWritten += result.list.size();
+			if (!result.list.empty()) {
+				_messagesLastId = std::max(
+					_messagesLastId,
+					result.list.back().id);
+			}
 			setState(stateDialogs(DownloadProgress()));
 			return true;
 		}, [=] {
 			if (ioCatchError(_writer->writeDialogEnd())) {
 				return;
 			}
+			if (!rememberDialogExported(peerId, alreadyExported)) {
+				return;
+			}
 			exportNextDialog();
 		});
 		return;
@@ -580,7 +679,7 @@ int ControllerObject::substepsInStep(Step step) const {
 
 void ControllerObject::setFinishedState() {
 	setState(FinishedState{
-		_writer->mainFilePath(),
+		_archivePath.isEmpty() ? _writer->mainFilePath() : _archivePath,
 		_stats.filesCount(),
 		_stats.bytesCount() });
 }
@@ -77,6 +77,13 @@ struct Settings {
 	Types fullChats = DefaultFullChats();
 	MediaSettings media;
 
+	// Export only messages newer than the ones recorded in the manifest
+	// left by the previous exports to the same folder.
+	bool incremental = false;
+
+	// Pack the finished export folder into a ZIP archive next to it.
+	bool archive = false;
+
 	MTPInputPeer singlePeer = MTP_inputPeerEmpty();
 	TimeId singlePeerFrom = 0;
 	TimeId singlePeerTill = 0;
@@ -0,0 +1,256 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/output/export_output_archive.h"
+
+#include "export/output/export_output_result.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <zip.h>
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kChunkSize = 1024 * 1024;
+constexpr auto kUtf8NamesFlag = uLong(1 << 11);
+constexpr auto kCompressedSuffixes = {
+	"html",
+	"json",
+	"txt",
+	"css",
+	"js",
+};
+
+// Minizip opens files by a char path, which fails for the non-ASCII
+// Windows paths, so the archive is written through QFile.
+voidpf ZCALLBACK OpenFile(voidpf opaque, const void *path, int mode) {
+	const auto name = static_cast<const QString*>(path);
+	auto result = std::make_unique<QFile>(*name);
+	const auto read = ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER)
+		== ZLIB_FILEFUNC_MODE_READ);
+	const auto flags = read
+		? QIODevice::ReadOnly
+		: (mode & ZLIB_FILEFUNC_MODE_CREATE)
+		? (QIODevice::ReadWrite | QIODevice::Truncate)
+		: QIODevice::ReadWrite;
+	return result->open(flags) ? result.release() : nullptr;
+}
+
+uLong ZCALLBACK ReadFile(
+		voidpf opaque,
+		voidpf stream,
+		void *buffer,
+		uLong size) {
+	const auto read = static_cast<QFile*>(stream)->read(
+		static_cast<char*>(buffer),
+		size);
+	return (read > 0) ? uLong(read) : 0;
+}
+
+uLong ZCALLBACK WriteFile(
+		voidpf opaque,
+		voidpf stream,
+		const void *buffer,
+		uLong size) {
+	const auto written = static_cast<QFile*>(stream)->write(
+		static_cast<const char*>(buffer),
+		size);
+	return (written > 0) ? uLong(written) : 0;
+}
+
+ZPOS64_T ZCALLBACK TellFile(voidpf opaque, voidpf stream) {
+	return ZPOS64_T(static_cast<QFile*>(stream)->pos());
+}
+
+long ZCALLBACK SeekFile(
+		voidpf opaque,
+		voidpf stream,
+		ZPOS64_T offset,
+		int origin) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto base = (origin == ZLIB_FILEFUNC_SEEK_CUR)
+		? file->pos()
+		: (origin == ZLIB_FILEFUNC_SEEK_END)
+		? file->size()
+		: 0;
+	return file->seek(base + qint64(offset)) ? 0 : -1;
+}
+
+int ZCALLBACK CloseFile(voidpf opaque, voidpf stream) {
+	delete static_cast<QFile*>(stream);
+	return 0;
+}
+
+int ZCALLBACK FileError(voidpf opaque, voidpf stream) {
+	const auto file = static_cast<QFile*>(stream);
+	return (file->error() != QFileDevice::NoError) ? 1 : 0;
+}
+
+[[nodiscard]] zlib_filefunc64_def FileFunctions() {
+	auto result = zlib_filefunc64_def();
+	result.zopen64_file = OpenFile;
+	result.zread_file = ReadFile;
+	result.zwrite_file = WriteFile;
+	result.ztell64_file = TellFile;
+	result.zseek64_file = SeekFile;
+	result.zclose_file = CloseFile;
+	result.zerror_file = FileError;
+	result.opaque = nullptr;
+	return result;
+}
+
+[[nodiscard]] bool Compressible(const QString &relativePath) {
+	const auto suffix = QFileInfo(relativePath).suffix().toLower();
+	return ranges::find(kCompressedSuffixes, suffix)
+		!= end(kCompressedSuffixes);
+}
+
+[[nodiscard]] zip_fileinfo FileInfo(const QFileInfo &info) {
+	const auto modified = info.lastModified();
+	const auto date = modified.date();
+	const auto time = modified.time();
+
+	auto result = zip_fileinfo();
+	result.tmz_date.tm_sec = time.second();
+	result.tmz_date.tm_min = time.minute();
+	result.tmz_date.tm_hour = time.hour();
+	result.tmz_date.tm_mday = date.day();
+	result.tmz_date.tm_mon = date.month() - 1;
+	result.tmz_date.tm_year = date.year();
+	result.dosDate = 0;
+	result.internal_fa = 0;
+	result.external_fa = 0;
+	return result;
+}
+
+[[nodiscard]] Result PackFile(
+		zipFile zip,
+		const QString &path,
+		const QString &relativePath) {
+	const auto error = [&] {
+		return Result(Result::Type::Error, path);
+	};
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return error();
+	}
+	const auto info = FileInfo(QFileInfo(file));
+	const auto name = relativePath.toUtf8();
+	const auto compress = Compressible(relativePath);
+	const auto opened = zipOpenNewFileInZip4_64(
+		zip,
+		name.constData(),
+		&info,
+		nullptr, // extrafield_local
+		0, // size_extrafield_local
+		nullptr, // extrafield_global
+		0, // size_extrafield_global
+		nullptr, // comment
+		compress ? Z_DEFLATED : 0, // method
+		compress ? Z_DEFAULT_COMPRESSION : 0, // level
+		0, // raw
+		-MAX_WBITS, // windowBits
+		DEF_MEM_LEVEL, // memLevel
+		Z_DEFAULT_STRATEGY, // strategy
+		nullptr, // password
+		0, // crcForCrypting
+		0, // versionMadeBy
+		kUtf8NamesFlag, // flagBase
+		1); // zip64
+	if (opened != ZIP_OK) {
+		return error();
+	}
+	auto buffer = QByteArray(kChunkSize, Qt::Uninitialized);
+	auto result = Result::Success();
+	while (!file.atEnd()) {
+		const auto read = file.read(buffer.data(), buffer.size());
+		if (read <= 0) {
+			result = error();
+			break;
+		} else if (zipWriteInFileInZip(
+				zip,
+				buffer.constData(),
+				unsigned(read)) != ZIP_OK) {
+			result = error();
+			break;
+		}
+	}
+	if (zipCloseFileInZip(zip) != ZIP_OK && result) {
+		result = error();
+	}
+	return result;
+}
+
+} // namespace
+
+QString ArchivePath(const QString &folder) {
+	auto base = QDir(folder).absolutePath();
+	while (base.endsWith('/')) {
+		base.chop(1);
+	}
+	const auto add = [&](int i) {
+		return base
+			+ (i ? " (" + QString::number(i) + ')' : QString())
+			+ ".zip";
+	};
+	auto index = 0;
+	while (QFile::exists(add(index))) {
+		++index;
+	}
+	return add(index);
+}
+
+Result PackFolder(const QString &folder, const QString &archivePath) {
+	const auto root = QDir(folder);
+	auto paths = std::vector<QString>();
+	auto files = QDirIterator(
+		root.absolutePath(),
+		QDir::Files | QDir::Hidden,
+		QDirIterator::Subdirectories);
+	while (files.hasNext()) {
+		paths.push_back(root.relativeFilePath(files.next()));
+	}
+
+	// The files from the export root go first, the subfolders after.
+	ranges::sort(paths, std::less<>(), [](const QString &path) {
+		return std::make_pair(path.contains('/'), path);
+	});
+
+	auto functions = FileFunctions();
+	auto path = archivePath;
+	const auto zip = zipOpen2_64(
+		&path,
+		APPEND_STATUS_CREATE,
+		nullptr,
+		&functions);
+	if (!zip) {
+		return Result(Result::Type::Error, archivePath);
+	}
+	auto result = Result::Success();
+	for (const auto &relativePath : paths) {
+		result = PackFile(zip, root.filePath(relativePath), relativePath);
+		if (!result) {
+			break;
+		}
+	}
+	if (zipClose(zip, nullptr) != ZIP_OK && result) {
+		result = Result(Result::Type::Error, archivePath);
+	}
+	if (!result) {
+		QFile::remove(archivePath);
+	}
+	return result;
+}
+
+} // namespace Output
+} // namespace Export
@@ -0,0 +1,26 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <QtCore/QString>
+
+namespace Export {
+namespace Output {
+
+struct Result;
+
+// The writers append to the list pages and the index while the export
+// goes on, so the finished export folder is packed at once afterwards.
+// Text files are deflated and media files are stored as they are.
+[[nodiscard]] QString ArchivePath(const QString &folder);
+[[nodiscard]] Result PackFolder(
+	const QString &folder,
+	const QString &archivePath);
+
+} // namespace Output
+} // namespace Export
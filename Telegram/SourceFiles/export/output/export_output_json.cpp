@@ -23,16 +23,33 @@ namespace {
 
 using Context = details::JsonContext;
 
+bool NeedsEscaping(char ch) {
+	// Bytes of the line and paragraph separators start with 0xE2.
+	return (ch >= 0 && ch < 32)
+		|| (ch == '"')
+		|| (ch == '\\')
+		|| (ch == char(0xE2));
+}
+
 QByteArray SerializeString(const QByteArray &value) {
 	const auto size = value.size();
 	const auto begin = value.data();
 	const auto end = begin + size;
 
+	// Plain bytes are copied in runs between the escaped ones,
+	// most strings don't need any escaping at all.
+	auto plain = std::find_if(begin, end, NeedsEscaping);
 	auto result = QByteArray();
-	result.reserve(2 + size * 4);
+	result.reserve(2 + size + ((plain != end) ? (size / 4 + 16) : 0));
 	result.append('"');
-	for (auto p = begin; p != end; ++p) {
+	auto from = begin;
+	for (auto p = plain; p != end; ++p) {
 		const auto ch = *p;
+		if (!NeedsEscaping(ch)) {
+			continue;
+		}
+		result.append(from, p - from);
+		from = p + 1;
 		if (ch == '\n') {
 			result.append("\\n", 2);
 		} else if (ch == '\r') {
@@ -51,9 +68,7 @@ QByteArray SerializeString(const QByteArray &value) {
 			} else {
 				result.append('0' + left);
 			}
-		} else if (ch == char(0xE2)
-			&& (p + 2 < end)
-			&& *(p + 1) == char(0x80)) {
+		} else if ((p + 2 < end) && *(p + 1) == char(0x80)) {
 			if (*(p + 2) == char(0xA8)) { // Line separator.
 				result.append("\\u2028", 6);
 			} else if (*(p + 2) == char(0xA9)) { // Paragraph separator.
@@ -65,6 +80,7 @@ QByteArray SerializeString(const QByteArray &value) {
 			result.append(ch);
 		}
 	}
+	result.append(from, end - from);
 	result.append('"');
 	return result;
 }
@@ -99,8 +115,14 @@ QByteArray SerializeObject(
 	const auto guard = gsl::finally([&] { context.nesting.pop_back(); });
 	const auto next = '\n' + Indentation(context);
 
+	auto size = indent.size() + 2;
+	for (const auto &[key, value] : values) {
+		size += next.size() + key.size() + value.size() + 5;
+	}
+
 	auto first = true;
 	auto result = QByteArray();
+	result.reserve(size);
 	result.append('{');
 	for (const auto &[key, value] : values) {
 		if (value.isEmpty()) {
@@ -124,8 +146,14 @@ QByteArray SerializeArray(
 	const auto indent = Indentation(context.nesting.size());
 	const auto next = '\n' + Indentation(context.nesting.size() + 1);
 
+	auto size = indent.size() + 2;
+	for (const auto &value : values) {
+		size += next.size() + value.size() + 1;
+	}
+
 	auto first = true;
 	auto result = QByteArray();
+	result.reserve(size);
 	result.append('[');
 	for (const auto &value : values) {
 		if (first) {
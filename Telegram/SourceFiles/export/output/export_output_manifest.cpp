@@ -0,0 +1,108 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/output/export_output_manifest.h"
+
+#include "export/output/export_output_result.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QSaveFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonArray>
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kManifestName = "export_manifest.json";
+constexpr auto kManifestVersion = 1;
+
+} // namespace
+
+QString Manifest::PathInFolder(const QString &folder) {
+	return (folder.endsWith('/') ? folder : (folder + '/')) + kManifestName;
+}
+
+Manifest Manifest::Read(const QString &path) {
+	auto result = Manifest();
+	QFile f(path);
+	if (!f.open(QIODevice::ReadOnly)) {
+		return result;
+	}
+	auto error = QJsonParseError{ 0, QJsonParseError::NoError };
+	const auto document = QJsonDocument::fromJson(f.readAll(), &error);
+	if (error.error != QJsonParseError::NoError
+		|| !document.isObject()) {
+		LOG(("Export Error: Bad manifest in '%1'.").arg(path));
+		return result;
+	}
+	const auto object = document.object();
+	if (object.value("version").toInt() != kManifestVersion) {
+		LOG(("Export Error: Unknown manifest version in '%1'.").arg(path));
+		return result;
+	}
+	for (const auto &value : object.value("chats").toArray()) {
+		const auto chat = value.toObject();
+		auto ok = false;
+		const auto peerId = chat.value("id").toString().toULongLong(&ok);
+		const auto messageId = chat.value("last_message_id").toInt();
+		const auto exportedCount = chat.value("exported_count").toInt();
+		if (ok && messageId > 0) {
+			result.setLastMessageId(
+				peerId,
+				messageId,
+				std::max(exportedCount, 0));
+		}
+	}
+	return result;
+}
+
+int32 Manifest::lastMessageId(uint64 peerId) const {
+	const auto i = _chats.find(peerId);
+	return (i != end(_chats)) ? i->second.lastMessageId : 0;
+}
+
+int Manifest::exportedCount(uint64 peerId) const {
+	const auto i = _chats.find(peerId);
+	return (i != end(_chats)) ? i->second.exportedCount : 0;
+}
+
+void Manifest::setLastMessageId(
+		uint64 peerId,
+		int32 messageId,
+		int exportedCount) {
+	auto &already = _chats[peerId];
+	already.lastMessageId = std::max(already.lastMessageId, messageId);
+	already.exportedCount = exportedCount;
+}
+
+Result Manifest::write(const QString &path) const {
+	auto chats = QJsonArray();
+	for (const auto &[peerId, data] : _chats) {
+		auto chat = QJsonObject();
+		chat.insert("id", QString::number(peerId));
+		chat.insert("last_message_id", data.lastMessageId);
+		chat.insert("exported_count", data.exportedCount);
+		chats.append(chat);
+	}
+	auto object = QJsonObject();
+	object.insert("version", kManifestVersion);
+	object.insert("chats", chats);
+
+	// QSaveFile keeps the previous manifest if we fail in the middle.
+	QSaveFile f(path);
+	if (!f.open(QIODevice::WriteOnly)
+		|| f.write(QJsonDocument(object).toJson()) < 0
+		|| !f.commit()) {
+		return Result(Result::Type::FatalError, path);
+	}
+	return Result::Success();
+}
+
+} // namespace Output
+} // namespace Export
@@ -0,0 +1,45 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+
+#include <QtCore/QString>
+
+namespace Export {
+namespace Output {
+
+struct Result;
+
+// Remembers the last message exported from each chat to a folder,
+// so that an incremental export can skip everything already saved.
+class Manifest {
+public:
+	[[nodiscard]] static QString PathInFolder(const QString &folder);
+	[[nodiscard]] static Manifest Read(const QString &path);
+
+	[[nodiscard]] int32 lastMessageId(uint64 peerId) const;
+	[[nodiscard]] int exportedCount(uint64 peerId) const;
+	void setLastMessageId(
+		uint64 peerId,
+		int32 messageId,
+		int exportedCount);
+
+	[[nodiscard]] Result write(const QString &path) const;
+
+private:
+	struct Chat {
+		int32 lastMessageId = 0;
+		int exportedCount = 0;
+	};
+	base::flat_map<uint64, Chat> _chats;
+
+};
+
+} // namespace Output
+} // namespace Export
@@ -79,6 +79,9 @@ private:
 		not_null<Ui::VerticalLayout*> container);
 	void addLimitsLabel(
 		not_null<Ui::VerticalLayout*> container);
+	void addIncrementalOption(
+		not_null<Ui::VerticalLayout*> container);
+	void addArchiveOption(not_null<Ui::VerticalLayout*> container);
 	void chooseFolder();
 	void refreshButtons(
 		not_null<Ui::RpWidget*> container,
@@ -8,10 +8,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ffmpeg/ffmpeg_utility.h"
 
 #include "base/algorithm.h"
+#include "base/flat_map.h"
 #include "logs.h"
 
 #include <QImage>
 
+#include <mutex>
+
 #ifdef LIB_FFMPEG_USE_QT_PRIVATE_API
 #include <private/qdrawhelper_p.h>
 #endif // LIB_FFMPEG_USE_QT_PRIVATE_API
@@ -30,6 +33,25 @@ constexpr auto kAvioBlockSize = 4096;
 constexpr auto kTimeUnknown = std::numeric_limits<crl::time>::min();
 constexpr auto kDurationMax = crl::time(std::numeric_limits<int>::max());
 
+// Decoded frames are queued for a while before they're converted.
+constexpr auto kExtraHwFrames = 8;
+
+#ifdef Q_OS_WIN
+constexpr auto kHwDeviceTypes = std::array{
+	AV_HWDEVICE_TYPE_D3D11VA,
+	AV_HWDEVICE_TYPE_DXVA2,
+};
+#elif defined Q_OS_MAC // Q_OS_WIN
+constexpr auto kHwDeviceTypes = std::array{
+	AV_HWDEVICE_TYPE_VIDEOTOOLBOX,
+};
+#else // Q_OS_WIN || Q_OS_MAC
+constexpr auto kHwDeviceTypes = std::array{
+	AV_HWDEVICE_TYPE_VAAPI,
+	AV_HWDEVICE_TYPE_VDPAU,
+};
+#endif // Q_OS_WIN || Q_OS_MAC
+
 void AlignedImageBufferCleanupHandler(void* data) {
 	const auto buffer = static_cast<uchar*>(data);
 	delete[] buffer;
@@ -81,6 +103,106 @@ void PremultiplyLine(uchar *dst, const uchar *src, int intsCount) {
 #endif // Qt >= 5.12
 }
 
+[[nodiscard]] const AVCodecHWConfig *FindHwConfig(
+		not_null<const AVCodec*> codec,
+		AVHWDeviceType type) {
+	const auto method = AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX;
+	for (auto i = 0;; ++i) {
+		const auto config = avcodec_get_hw_config(codec, i);
+		if (!config) {
+			return nullptr;
+		} else if ((config->methods & method)
+			&& (config->device_type == type)) {
+			return config;
+		}
+	}
+}
+
+[[nodiscard]] AVPixelFormat GetHwFormat(
+		AVCodecContext *context,
+		const AVPixelFormat *formats) {
+	if (context->hw_device_ctx) {
+		const auto device = reinterpret_cast<const AVHWDeviceContext*>(
+			context->hw_device_ctx->data);
+		const auto config = FindHwConfig(context->codec, device->type);
+		for (auto i = formats; config && *i != AV_PIX_FMT_NONE; ++i) {
+			if (*i == config->pix_fmt) {
+				return *i;
+			}
+		}
+	}
+
+	// If the hardware decoder could not be initialized this format
+	// is not in the list any more and we fall back to the software one.
+	return avcodec_default_get_format(context, formats);
+}
+
+// Device contexts are created once per process and referenced by each
+// codec context, creating a device for every video is rather expensive.
+class HwDevices final {
+public:
+	~HwDevices();
+
+	[[nodiscard]] AVBufferRef *acquire(AVHWDeviceType type);
+
+private:
+	std::mutex _mutex;
+	base::flat_map<AVHWDeviceType, AVBufferRef*> _devices;
+
+};
+
+HwDevices::~HwDevices() {
+	for (auto &[type, device] : _devices) {
+		av_buffer_unref(&device);
+	}
+}
+
+AVBufferRef *HwDevices::acquire(AVHWDeviceType type) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto i = _devices.find(type);
+	if (i == end(_devices)) {
+		auto device = (AVBufferRef*)nullptr;
+		const auto error = AvErrorWrap(av_hwdevice_ctx_create(
+			&device,
+			type,
+			nullptr,
+			nullptr,
+			0));
+		if (error) {
+			LogError(qstr("av_hwdevice_ctx_create"), error);
+		}
+
+		// Remember failures as well, so we don't retry for each video.
+		i = _devices.emplace(type, error ? nullptr : device).first;
+	}
+	return i->second ? av_buffer_ref(i->second) : nullptr;
+}
+
+[[nodiscard]] HwDevices &SharedHwDevices() {
+	static auto result = HwDevices();
+	return result;
+}
+
+void AttachHwDevice(
+		not_null<AVCodecContext*> context,
+		not_null<const AVCodec*> codec) {
+	for (const auto type : kHwDeviceTypes) {
+		if (!FindHwConfig(codec, type)) {
+			continue;
+		}
+		const auto device = SharedHwDevices().acquire(type);
+		if (!device) {
+			continue;
+		}
+		DEBUG_LOG(("Video Info: Using '%1' hardware decoding."
+			).arg(av_hwdevice_get_type_name(type)));
+		context->hw_device_ctx = device;
+		context->get_format = GetHwFormat;
+		context->extra_hw_frames = kExtraHwFrames;
+		return;
+	}
+}
+
 } // namespace
 
 IOPointer MakeIOPointer(
@@ -159,9 +281,10 @@ void FormatDeleter::operator()(AVFormatContext *value) {
 	}
 }
 
-CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
+CodecPointer MakeCodecPointer(CodecDescriptor descriptor) {
 	auto error = AvErrorWrap();
 
+	const auto stream = descriptor.stream;
 	auto result = CodecPointer(avcodec_alloc_context3(nullptr));
 	const auto context = result.get();
 	if (!context) {
@@ -180,7 +303,10 @@ CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
 	if (!codec) {
 		LogError(qstr("avcodec_find_decoder"), context->codec_id);
 		return {};
-	} else if ((error = avcodec_open2(context, codec, nullptr))) {
+	} else if (descriptor.hwAllowed) {
+		AttachHwDevice(context, codec);
+	}
+	if ((error = avcodec_open2(context, codec, nullptr))) {
 		LogError(qstr("avcodec_open2"), error);
 		return {};
 	}
@@ -198,7 +324,8 @@ FramePointer MakeFramePointer() {
 }
 
 bool FrameHasData(AVFrame *frame) {
-	return (frame && frame->data[0] != nullptr);
+	// Hardware frames keep surface handles in other data pointers.
+	return frame && (frame->data[0] != nullptr || frame->hw_frames_ctx);
 }
 
 void ClearFrameMemory(AVFrame *frame) {
@@ -58,6 +58,7 @@ constexpr auto kMaxChannelAdmins = 200;
 constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kEventsFirstPage = 20;
 constexpr auto kEventsPerPage = 50;
+constexpr auto kCachedEventsFiltersLimit = 8;
 
 } // namespace
 
@@ -470,7 +471,61 @@ void InnerWidget::clearAndRequestLog() {
 	_upLoaded = false;
 	_downLoaded = true;
 	updateMinMaxIds();
-	preloadMore(Direction::Up);
+	if (!addEventsFromCache()) {
+		preloadMore(Direction::Up);
+	}
+}
+
+bool InnerWidget::addEventsFromCache() {
+	const auto i = ranges::find_if(_cachedEvents, [&](
+			const CachedEvents &cached) {
+		return (cached.filter == _filter)
+			&& (cached.searchQuery == _searchQuery);
+	});
+	if (i == end(_cachedEvents) || i->events.isEmpty()) {
+		return false;
+	}
+	std::rotate(i, i + 1, end(_cachedEvents));
+	const auto &cached = _cachedEvents.back();
+	const auto events = cached.events;
+
+	_addingEventsFromCache = true;
+	addEvents(Direction::Up, events);
+	_addingEventsFromCache = false;
+
+	// Older events continue from the cached ones when scrolled to, and
+	// the events that happened after they were cached are loaded below.
+	_upLoaded = _upLoaded || cached.upLoaded;
+	_downLoaded = false;
+	checkPreloadMore();
+	return true;
+}
+
+void InnerWidget::rememberEvents(
+		Direction direction,
+		const QVector<MTPChannelAdminLogEvent> &events) {
+	auto i = ranges::find_if(_cachedEvents, [&](
+			const CachedEvents &cached) {
+		return (cached.filter == _filter)
+			&& (cached.searchQuery == _searchQuery);
+	});
+	if (i == end(_cachedEvents)) {
+		if (_cachedEvents.size() >= kCachedEventsFiltersLimit) {
+			_cachedEvents.erase(begin(_cachedEvents));
+		}
+		_cachedEvents.push_back({ _filter, _searchQuery });
+	} else {
+		std::rotate(i, i + 1, end(_cachedEvents));
+	}
+	auto &cached = _cachedEvents.back();
+	if (direction == Direction::Up) {
+		if (events.empty()) {
+			cached.upLoaded = true;
+		}
+		cached.events.append(events);
+	} else {
+		cached.events = events + cached.events;
+	}
 }
 
 void InnerWidget::updateEmptyText() {
@@ -667,6 +722,9 @@ void InnerWidget::addEvents(Direction direction, const QVector<MTPChannelAdminLo
 	if (_filterChanged) {
 		clearAfterFilterChange();
 	}
+	if (!_addingEventsFromCache) {
+		rememberEvents(direction, events);
+	}
 
 	auto up = (direction == Direction::Up);
 	if (events.empty()) {
@@ -182,6 +182,10 @@ private:
 	void clearAfterFilterChange();
 	void clearAndRequestLog();
 	void addEvents(Direction direction, const QVector<MTPChannelAdminLogEvent> &events);
+	void rememberEvents(
+		Direction direction,
+		const QVector<MTPChannelAdminLogEvent> &events);
+	bool addEventsFromCache();
 	Element *viewForItem(const HistoryItem *item);
 
 	void toggleScrollDateShown();
@@ -241,6 +245,17 @@ private:
 	Element *_scrollDateLastItem = nullptr;
 	int _scrollDateLastItemTop = 0;
 
+	// Events received for the recently used filters and queries,
+	// from the newest to the oldest, least recently used first.
+	struct CachedEvents {
+		FilterValue filter;
+		QString searchQuery;
+		QVector<MTPChannelAdminLogEvent> events;
+		bool upLoaded = false;
+	};
+	std::vector<CachedEvents> _cachedEvents;
+	bool _addingEventsFromCache = false;
+
 	// Up - max, Down - min.
 	uint64 _maxId = 0;
 	uint64 _minId = 0;
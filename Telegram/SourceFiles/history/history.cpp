@@ -42,6 +42,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/unixtime.h"
 #include "facades.h"
 #include "styles/style_dialogs.h"
+#include "styles/style_history.h"
 
 namespace {
 
@@ -59,6 +60,8 @@ constexpr auto kStatusShowClientsideChooseContact = 6000;
 constexpr auto kStatusShowClientsidePlayGame = 10000;
 constexpr auto kSetMyActionForMs = 10000;
 constexpr auto kNewBlockEachMessage = 50;
+constexpr auto kLazyLayoutMinBlocks = 4;
+constexpr auto kLayoutBottomBlocks = 2;
 constexpr auto kSkipCloudDraftsFor = TimeId(3);
 
 } // namespace
@@ -363,9 +366,16 @@ bool History::updateSendActionNeedsAnimating(
 			Type type,
 			crl::time duration,
 			int progress = 0) {
+		const auto i = _sendActions.find(user);
+		if (i == end(_sendActions) || i->second.type != type) {
+			_sendActionsChanged = true;
+		}
 		_sendActions.emplace_or_assign(user, type, now + duration, progress);
 	};
 	action.match([&](const MTPDsendMessageTypingAction &) {
+		if (!_typing.contains(user)) {
+			_sendActionsChanged = true;
+		}
 		_typing.emplace_or_assign(user, now + kStatusShowClientsideTyping);
 	}, [&](const MTPDsendMessageRecordVideoAction &) {
 		emplaceAction(Type::RecordVideo, kStatusShowClientsideRecordVideo);
@@ -412,7 +422,10 @@ bool History::updateSendActionNeedsAnimating(
 	}, [&](const MTPDsendMessageCancelAction &) {
 		Unexpected("CancelAction here.");
 	});
-	return updateSendActionNeedsAnimating(now, true);
+
+	// Repeated actions only prolong the status, the text is rebuilt and
+	// the rows are repainted once per frame from the animation callback.
+	return !_typing.empty() || !_sendActions.empty();
 }
 
 bool History::mySendActionUpdated(SendAction::Type type, bool doing) {
@@ -465,7 +478,7 @@ bool History::paintSendAction(
 }
 
 bool History::updateSendActionNeedsAnimating(crl::time now, bool force) {
-	auto changed = force;
+	auto changed = base::take(_sendActionsChanged) || force;
 	for (auto i = begin(_typing); i != end(_typing);) {
 		if (now >= i->second) {
 			i = _typing.erase(i);
@@ -2771,12 +2784,81 @@ void History::resizeToWidth(int newWidth) {
 	_flags &= ~(Flag::f_has_pending_resized_items);
 
 	_width = newWidth;
-	int y = 0;
+
+	// Small histories are always laid out completely.
+	const auto lazy = (blocks.size() >= kLazyLayoutMinBlocks);
+	const auto windowKnown = (_layoutWindowBottom >= _layoutWindowTop);
+	const auto anchorBlock = [](Element *view) {
+		return view ? view->block() : nullptr;
+	};
+	const auto scrollTopBlock = anchorBlock(scrollTopItem);
+	const auto unreadBarBlock = anchorBlock(_unreadBarView);
+	if (!_estimatedItemHeight) {
+		_estimatedItemHeight = st::msgMargin.top()
+			+ st::msgPadding.top()
+			+ st::msgFont->height
+			+ st::msgPadding.bottom()
+			+ st::msgMargin.bottom();
+	}
+	const auto mustLayout = [&](not_null<HistoryBlock*> block, int top) {
+		if (!lazy
+			|| block->layoutRequested()
+			|| block == scrollTopBlock
+			|| block == unreadBarBlock) {
+			return true;
+		} else if (!windowKnown) {
+			const auto index = block->indexInHistory();
+			return (index + kLayoutBottomBlocks >= int(blocks.size()));
+		}
+		const auto height = block->layoutPending()
+			? std::max(block->height(), 1)
+			: block->height();
+		return (top < _layoutWindowBottom)
+			&& (top + height > _layoutWindowTop);
+	};
+	auto laidOutHeight = 0;
+	auto laidOutCount = 0;
+	auto y = 0;
 	for (const auto &block : blocks) {
-		block->setY(y);
-		y += block->resizeGetHeight(newWidth, resizeAllItems);
+		const auto raw = block.get();
+		raw->setY(y);
+		if (mustLayout(raw, y)) {
+			const auto height = raw->resizeGetHeight(
+				newWidth,
+				resizeAllItems);
+			laidOutHeight += height;
+			laidOutCount += int(raw->messages.size());
+			y += height;
+		} else {
+			y += raw->skipLayoutGetHeight(
+				newWidth,
+				resizeAllItems,
+				_estimatedItemHeight);
+		}
 	}
 	_height = y;
+	if (laidOutCount > 0) {
+		_estimatedItemHeight = std::max(laidOutHeight / laidOutCount, 1);
+	}
+}
+
+void History::setLayoutWindow(int top, int bottom) {
+	_layoutWindowTop = top;
+	_layoutWindowBottom = bottom;
+	for (const auto &block : blocks) {
+		if (block->y() >= bottom) {
+			break;
+		} else if (block->layoutPending()
+			&& block->y() + block->height() > top) {
+			setHasPendingResizedItems();
+			break;
+		}
+	}
+}
+
+void History::forgetLayoutWindow() {
+	_layoutWindowTop = 0;
+	_layoutWindowBottom = -1;
 }
 
 void History::forceFullResize() {
@@ -3167,6 +3249,15 @@ HistoryBlock::HistoryBlock(not_null<History*> history)
 }
 
 int HistoryBlock::resizeGetHeight(int newWidth, bool resizeAllItems) {
+	if (base::take(_layoutPending)) {
+		resizeAllItems = true;
+	}
+	_layoutRequested = false;
+	const auto hasPendingResizedItems = base::take(_hasPendingResizedItems);
+	if (!resizeAllItems && !hasPendingResizedItems) {
+		return _height;
+	}
+
 	auto y = 0;
 	for (const auto &message : messages) {
 		message->setY(y);
@@ -3180,9 +3271,41 @@ int HistoryBlock::resizeGetHeight(int newWidth, bool resizeAllItems) {
 	return _height;
 }
 
+int HistoryBlock::skipLayoutGetHeight(
+		int newWidth,
+		bool resizeAllItems,
+		int estimatedItemHeight) {
+	if (!_hasPendingResizedItems && (_layoutPending || !resizeAllItems)) {
+		return _height;
+	}
+	_layoutPending = true;
+	_hasPendingResizedItems = false;
+
+	// Heights from the previous layout are good enough as an estimate.
+	auto y = 0;
+	for (const auto &message : messages) {
+		message->setY(y);
+		const auto height = message->height();
+		y += (height > 0) ? height : estimatedItemHeight;
+	}
+	_height = y;
+	return _height;
+}
+
+bool HistoryBlock::requestLayout() {
+	if (!_layoutPending) {
+		return false;
+	}
+	_layoutRequested = true;
+	_history->setHasPendingResizedItems();
+	return true;
+}
+
 void HistoryBlock::remove(not_null<Element*> view) {
 	Expects(view->block() == this);
 
+	_hasPendingResizedItems = true;
+
 	_history->mainViewRemoved(this, view);
 
 	const auto blockIndex = indexInHistory();
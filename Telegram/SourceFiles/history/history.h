@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "data/data_types.h"
 #include "data/data_peer.h"
+#include "data/data_slab_allocator.h"
 #include "dialogs/dialogs_entry.h"
 #include "ui/effects/send_action_animations.h"
 #include "base/observer.h"
@@ -218,6 +219,11 @@ public:
 	void forceFullResize();
 	int height() const;
 
+	// Blocks far from the layout window keep an estimated height and
+	// are laid out only when they get into it (coordinates are local).
+	void setLayoutWindow(int top, int bottom);
+	void forgetLayoutWindow();
+
 	void itemRemoved(not_null<HistoryItem*> item);
 	void itemVanished(not_null<HistoryItem*> item);
 
@@ -487,6 +493,9 @@ private:
 	bool _mute = false;
 	int _width = 0;
 	int _height = 0;
+	int _estimatedItemHeight = 0;
+	int _layoutWindowTop = 0;
+	int _layoutWindowBottom = -1;
 	Element *_unreadBarView = nullptr;
 	Element *_firstUnreadView = nullptr;
 	HistoryService *_joinedMessage = nullptr;
@@ -530,6 +539,7 @@ private:
 	QString _sendActionString;
 	Ui::Text::String _sendActionText;
 	Ui::SendActionAnimation _sendActionAnimation;
+	bool _sendActionsChanged = false;
 	base::flat_map<SendAction::Type, crl::time> _mySendActions;
 
 	std::deque<not_null<HistoryItem*>> _notifications;
@@ -545,12 +555,41 @@ public:
 	HistoryBlock &operator=(const HistoryBlock &) = delete;
 	~HistoryBlock();
 
+	static void *operator new(std::size_t size) {
+		return Data::SlabAllocate(size);
+	}
+	static void operator delete(void *pointer, std::size_t size) {
+		Data::SlabFree(pointer, size);
+	}
+
 	std::vector<std::unique_ptr<Element>> messages;
 
 	void remove(not_null<Element*> view);
 	void refreshView(not_null<Element*> view);
 
 	int resizeGetHeight(int newWidth, bool resizeAllItems);
+
+	// Sets estimated heights instead of laying the items out.
+	int skipLayoutGetHeight(
+		int newWidth,
+		bool resizeAllItems,
+		int estimatedItemHeight);
+	[[nodiscard]] bool layoutPending() const {
+		return _layoutPending;
+	}
+
+	// Only blocks with pending resized items are walked when the width
+	// stays the same, all the others keep their height.
+	void setHasPendingResizedItems() {
+		_hasPendingResizedItems = true;
+	}
+
+	// Returns true if the block will be laid out on the next resize.
+	bool requestLayout();
+	[[nodiscard]] bool layoutRequested() const {
+		return _layoutRequested;
+	}
+
 	int y() const {
 		return _y;
 	}
@@ -595,5 +634,8 @@ protected:
 	int _y = 0;
 	int _height = 0;
 	int _indexInHistory = -1;
+	bool _hasPendingResizedItems = true;
+	bool _layoutPending = false;
+	bool _layoutRequested = false;
 
 };
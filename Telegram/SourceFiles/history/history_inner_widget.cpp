@@ -52,6 +52,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_photo.h"
 #include "data/data_user.h"
 #include "data/data_file_origin.h"
+#include "storage/cache/storage_cache_database.h"
 #include "facades.h"
 #include "app.h"
 
@@ -63,6 +64,7 @@ namespace {
 
 constexpr auto kScrollDateHideTimeout = 1000;
 constexpr auto kUnloadHeavyPartsPages = 1;
+constexpr auto kLayoutWindowPages = 1;
 
 // Helper binary search for an item in a list that is not completely
 // above the given top of the visible area or below the given bottom of the visible area
@@ -143,6 +145,11 @@ HistoryInner::HistoryInner(
 , _scrollDateHideTimer([this] { scrollDateHideByTimer(); }) {
 	Instance = this;
 
+	_history->forgetLayoutWindow();
+	if (_migrated) {
+		_migrated->forgetLayoutWindow();
+	}
+
 	_touchSelectTimer.setSingleShot(true);
 	connect(&_touchSelectTimer, SIGNAL(timeout()), this, SLOT(onTouchSelect()));
 
@@ -559,11 +566,19 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 	if (hasPendingResizedItems()) {
 		return;
 	}
+	const auto span = Logs::TraceSpan("paint", "HistoryInner");
 
 	Painter p(this);
 	auto clip = e->rect();
 	auto ms = crl::now();
 
+	// Repaints of a few separate animated parts come as one region,
+	// so the elements between the parts are not drawn again.
+	const auto region = e->region();
+	const auto inRegion = [&](int top, int height) {
+		return region.intersects(QRect(0, top, width(), height));
+	};
+
 	const auto historyDisplayedEmpty = _history->isDisplayedEmpty()
 		&& (!_migrated || _migrated->isDisplayedEmpty());
 	bool noHistoryDisplayed = _firstLoading || historyDisplayedEmpty;
@@ -615,11 +630,13 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 			p.save();
 			p.translate(0, y);
 			if (clip.y() < y + view->height()) while (y < drawToY) {
-				const auto selection = itemRenderSelection(
-					view,
-					selfromy - mtop,
-					seltoy - mtop);
-				view->draw(p, clip.translated(0, -y), selection, ms);
+				if (inRegion(y, view->height())) {
+					const auto selection = itemRenderSelection(
+						view,
+						selfromy - mtop,
+						seltoy - mtop);
+					view->draw(p, clip.translated(0, -y), selection, ms);
+				}
 
 				if (item->hasViews()) {
 					App::main()->scheduleViewIncrement(item);
@@ -661,11 +678,17 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 			while (y < drawToY) {
 				auto h = view->height();
 				if (hclip.y() < y + h && hdrawtop < y + h) {
-					const auto selection = itemRenderSelection(
-						view,
-						selfromy - htop,
-						seltoy - htop);
-					view->draw(p, hclip.translated(0, -y), selection, ms);
+					if (inRegion(y, h)) {
+						const auto selection = itemRenderSelection(
+							view,
+							selfromy - htop,
+							seltoy - htop);
+						view->draw(
+							p,
+							hclip.translated(0, -y),
+							selection,
+							ms);
+					}
 
 					if (item->hasViews()) {
 						App::main()->scheduleViewIncrement(item);
@@ -705,7 +728,8 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 				}
 
 				// paint the userpic if it intersects the painted rect
-				if (userpicTop + st::msgPhotoSize > clip.top()) {
+				if (userpicTop + st::msgPhotoSize > clip.top()
+					&& inRegion(userpicTop, st::msgPhotoSize)) {
 					const auto message = view->data()->toHistoryMessage();
 					if (const auto from = message->displayFrom()) {
 						from->paintUserpicLeft(
@@ -2132,6 +2156,59 @@ void HistoryInner::setFirstLoading(bool loading) {
 	update();
 }
 
+void HistoryInner::prefetchMediaCache(int from, int till) {
+	auto keys = std::vector<Storage::Cache::Key>();
+	const auto add = [&](Image *image) {
+		if (image && !image->loaded()) {
+			if (const auto key = image->cacheKey()) {
+				keys.push_back(*key);
+			}
+		}
+	};
+	const auto collect = [&](History *history, int historytop) {
+		if (!history || historytop < 0 || history->isEmpty()) {
+			return;
+		}
+		const auto &blocks = history->blocks;
+		auto blockIndex = BinarySearchBlocksOrItems<true>(
+			blocks,
+			from - historytop);
+		for (; blockIndex != int(blocks.size()); ++blockIndex) {
+			const auto block = blocks[blockIndex].get();
+			const auto blocktop = historytop + block->y();
+			if (blocktop >= till) {
+				break;
+			}
+			const auto &messages = block->messages;
+			auto itemIndex = BinarySearchBlocksOrItems<true>(
+				messages,
+				from - blocktop);
+			for (; itemIndex != int(messages.size()); ++itemIndex) {
+				const auto view = messages[itemIndex].get();
+				const auto itemtop = blocktop + view->y();
+				if (itemtop >= till) {
+					break;
+				} else if (itemtop + view->height() <= from) {
+					continue;
+				}
+				const auto media = view->data()->media();
+				if (!media) {
+					continue;
+				} else if (const auto photo = media->photo()) {
+					add(photo->large());
+				} else if (const auto document = media->document()) {
+					add(document->thumbnail());
+				}
+			}
+		}
+	};
+	collect(_migrated, migratedTop());
+	collect(_history, historyTop());
+	if (!keys.empty()) {
+		session().data().cache().prefetch(std::move(keys));
+	}
+}
+
 void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	auto scrolledUp = (top < _visibleAreaTop);
 	_visibleAreaTop = top;
@@ -2170,6 +2247,9 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	} else {
 		scrollDateHideByTimer();
 	}
+	updateLayoutWindow(
+		top - kLayoutWindowPages * visibleAreaHeight,
+		bottom + kLayoutWindowPages * visibleAreaHeight);
 
 	// Unload lottie animations.
 	const auto pages = kUnloadHeavyPartsPages;
@@ -2178,6 +2258,15 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	session().data().unloadHeavyViewParts(ElementDelegate(), from, till);
 }
 
+void HistoryInner::updateLayoutWindow(int from, int till) {
+	if (const auto htop = historyTop(); htop >= 0) {
+		_history->setLayoutWindow(from - htop, till - htop);
+	}
+	if (const auto mtop = migratedTop(); mtop >= 0) {
+		_migrated->setLayoutWindow(from - mtop, till - mtop);
+	}
+}
+
 bool HistoryInner::displayScrollDate() const {
 	return (_visibleAreaTop <= height() - 2 * (_visibleAreaBottom - _visibleAreaTop));
 }
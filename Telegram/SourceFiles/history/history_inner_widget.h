@@ -90,6 +90,9 @@ public:
 	// updates history->scrollTopItem/scrollTopOffset
 	void visibleAreaUpdated(int top, int bottom);
 
+	// hints the cache about media of messages in [from, till) range
+	void prefetchMediaCache(int from, int till);
+
 	int historyHeight() const;
 	int historyScrollTop() const;
 	int migratedTop() const;
@@ -253,6 +256,7 @@ private:
 
 	void toggleScrollDateShown();
 	void repaintScrollDateCallback();
+	void updateLayoutWindow(int from, int till);
 	bool displayScrollDate() const;
 	void scrollDateHide();
 	void keepScrollDateForNow();
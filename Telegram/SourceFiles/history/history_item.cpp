@@ -49,6 +49,9 @@ namespace {
 
 constexpr auto kNotificationTextLimit = 255;
 
+static_assert(alignof(HistoryMessage) <= Data::kSlabAlignment);
+static_assert(alignof(HistoryService) <= Data::kSlabAlignment);
+
 enum class MediaCheckResult {
 	Good,
 	Unsupported,
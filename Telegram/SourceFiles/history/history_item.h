@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/flags.h"
 #include "base/value_ordering.h"
 #include "data/data_media_types.h"
+#include "data/data_slab_allocator.h"
 
 enum class UnreadMentionType;
 struct HistoryMessageReplyMarkup;
@@ -68,6 +69,13 @@ public:
 		void operator()(HistoryItem *value);
 	};
 
+	static void *operator new(std::size_t size) {
+		return Data::SlabAllocate(size);
+	}
+	static void operator delete(void *pointer, std::size_t size) {
+		Data::SlabFree(pointer, size);
+	}
+
 	virtual void dependencyItemRemoved(HistoryItem *dependency) {
 	}
 	virtual bool updateDependencyItem() {
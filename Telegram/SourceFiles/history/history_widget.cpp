@@ -72,6 +72,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/audio/media_audio_capture.h"
 #include "media/player/media_player_instance.h"
 #include "core/application.h"
+#include "core/core_scheduler.h"
 #include "apiwrap.h"
 #include "history/view/history_view_top_bar_widget.h"
 #include "history/view/history_view_contact_status.h"
@@ -344,6 +345,7 @@ HistoryWidget::HistoryWidget(
 	connect(Media::Capture::instance(), SIGNAL(error()), this, SLOT(onRecordError()));
 	connect(Media::Capture::instance(), SIGNAL(updated(quint16,qint32)), this, SLOT(onRecordUpdate(quint16,qint32)));
 	connect(Media::Capture::instance(), SIGNAL(done(QByteArray,VoiceWaveform,qint32)), this, SLOT(onRecordDone(QByteArray,VoiceWaveform,qint32)));
+	connect(Media::Capture::instance(), SIGNAL(encoded(QByteArray)), this, SLOT(onRecordEncoded(QByteArray)));
 
 	_attachToggle->addClickHandler(App::LambdaDelayed(
 		st::historyAttach.ripple.hideDuration,
@@ -1379,7 +1381,12 @@ void HistoryWidget::onRecordDone(
 		QByteArray result,
 		VoiceWaveform waveform,
 		qint32 samples) {
-	if (!canWriteMessage() || result.isEmpty()) return;
+	// The finished file finds the parts uploaded so far by its content.
+	const auto uploadId = base::take(_recordingUploadId);
+	if (!canWriteMessage() || result.isEmpty()) {
+		session().uploader().cancelStreamedUpload(uploadId);
+		return;
+	}
 
 	ActivateWindow(controller());
 	const auto duration = samples / Media::Player::kDefaultFrequency;
@@ -1388,6 +1395,12 @@ void HistoryWidget::onRecordDone(
 	session().api().sendVoiceMessage(result, waveform, duration, action);
 }
 
+void HistoryWidget::onRecordEncoded(QByteArray bytes) {
+	if (_recordingUploadId) {
+		session().uploader().appendStreamedUpload(_recordingUploadId, bytes);
+	}
+}
+
 void HistoryWidget::onRecordUpdate(quint16 level, qint32 samples) {
 	if (!_recording) {
 		return;
@@ -1750,7 +1763,6 @@ void HistoryWidget::showHistory(
 	_replyEditMsg = nullptr;
 	_editMsgId = _replyToId = 0;
 	_previewData = nullptr;
-	_previewCache.clear();
 	_fieldBarCancel->hide();
 
 	_membersDropdownShowTimer.stop();
@@ -2713,6 +2725,17 @@ void HistoryWidget::visibleAreaUpdated() {
 		const auto scrollBottom = scrollTop + _scroll->height();
 		_list->visibleAreaUpdated(scrollTop, scrollBottom);
 		controller()->floatPlayerAreaUpdated().notify(true);
+		if (hasPendingResizedItems() && !_pendingRelayoutPosted) {
+			// Some lazily laid out blocks got into the visible area.
+			_pendingRelayoutPosted = true;
+			Core::App().scheduler().post(
+				Core::TaskPriority::VisibleData,
+				"history_relayout",
+				crl::guard(this, [=] {
+					_pendingRelayoutPosted = false;
+					handlePendingHistoryUpdate();
+				}));
+		}
 
 		const auto atBottom = (scrollTop >= _scroll->scrollTopMax());
 		if (_history->loadedAtBottom()
@@ -2767,6 +2790,11 @@ void HistoryWidget::preloadHistoryByScroll() {
 	if (scrollTop <= kPreloadHeightsCount * scrollHeight) {
 		loadMessages();
 	}
+	if (_list) {
+		_list->prefetchMediaCache(
+			scrollTop - kPreloadHeightsCount * scrollHeight,
+			scrollTop + (kPreloadHeightsCount + 1) * scrollHeight);
+	}
 }
 
 void HistoryWidget::checkReplyReturns() {
@@ -3353,6 +3381,8 @@ void HistoryWidget::recordStartCallback() {
 
 	emit Media::Capture::instance()->start();
 
+	session().uploader().cancelStreamedUpload(_recordingUploadId);
+	_recordingUploadId = session().uploader().startStreamedUpload();
 	_recording = _inField = true;
 	updateControlsVisibility();
 	activate();
@@ -3386,6 +3416,10 @@ void HistoryWidget::mouseReleaseEvent(QMouseEvent *e) {
 
 void HistoryWidget::stopRecording(bool send) {
 	emit Media::Capture::instance()->stop(send);
+	if (!send) {
+		session().uploader().cancelStreamedUpload(
+			base::take(_recordingUploadId));
+	}
 
 	_recordingLevel = anim::value();
 	_recordingAnimation.stop();
@@ -4990,6 +5024,7 @@ int HistoryWidget::countInitialScrollTop() {
 		result = _list->historyScrollTop();
 	} else if (_showAtMsgId && (_showAtMsgId > 0 || -_showAtMsgId < ServerMaxMsgId)) {
 		auto item = getItemFromHistoryOrMigrated(_showAtMsgId);
+		layoutBlockOf(item ? item->mainView() : nullptr);
 		auto itemTop = _list->itemTop(item);
 		if (itemTop < 0) {
 			setMsgId(0);
@@ -5012,6 +5047,7 @@ int HistoryWidget::countInitialScrollTop() {
 int HistoryWidget::countAutomaticScrollTop() {
 	auto result = ScrollMax;
 	if (const auto unread = firstUnreadMessage()) {
+		layoutBlockOf(unread);
 		result = _list->itemTop(unread);
 		const auto possibleUnreadBarTop = _scroll->scrollTopMax()
 			+ HistoryView::UnreadBar::height()
@@ -5158,6 +5194,13 @@ void HistoryWidget::updateHistoryGeometry(
 	}
 }
 
+void HistoryWidget::layoutBlockOf(HistoryView::Element *view) {
+	const auto block = view ? view->block() : nullptr;
+	if (block && block->requestLayout()) {
+		updateListSize();
+	}
+}
+
 void HistoryWidget::updateListSize() {
 	_list->recountHistoryGeometry();
 	auto washidden = _scroll->isHidden();
@@ -6162,16 +6205,17 @@ void HistoryWidget::checkPreview() {
 				previewCancel();
 			}
 		} else {
-			const auto i = _previewCache.constFind(_previewLinks);
-			if (i == _previewCache.cend()) {
+			const auto cached = session().data().webPagePreview(
+				_previewLinks);
+			if (!cached) {
 				_previewRequest = MTP::send(
 					MTPmessages_GetWebPagePreview(
 						MTP_flags(0),
 						MTP_string(_previewLinks),
 						MTPVector<MTPMessageEntity>()),
 					rpcDone(&HistoryWidget::gotPreview, _previewLinks));
-			} else if (i.value()) {
-				_previewData = session().data().webpage(i.value());
+			} else if (*cached) {
+				_previewData = session().data().webpage(*cached);
 				updatePreview();
 			} else {
 				if (_previewData && _previewData->pendingTill >= 0) previewCancel();
@@ -6201,10 +6245,15 @@ void HistoryWidget::gotPreview(QString links, const MTPMessageMedia &result, mtp
 	if (result.type() == mtpc_messageMediaWebPage) {
 		const auto &data = result.c_messageMediaWebPage().vwebpage();
 		const auto page = session().data().processWebpage(data);
-		_previewCache.insert(links, page->id);
+		session().data().rememberWebPagePreview(links, page->id);
 		if (page->pendingTill > 0 && page->pendingTill <= base::unixtime::now()) {
 			page->pendingTill = -1;
 		}
+		if (page->photo && !page->pendingTill) {
+			// The message with this preview is likely to be sent soon,
+			// have the bubble photo ready by the time it is displayed.
+			page->photo->loadThumbnail(Data::FileOriginWebPage(page->url));
+		}
 		if (links == _previewLinks && !_previewCancelled) {
 			_previewData = (page->id && page->pendingTill >= 0)
 				? page.get()
@@ -6213,7 +6262,7 @@ void HistoryWidget::gotPreview(QString links, const MTPMessageMedia &result, mtp
 		}
 		session().data().sendWebPageGamePollNotifications();
 	} else if (result.type() == mtpc_messageMediaEmpty) {
-		_previewCache.insert(links, 0);
+		session().data().rememberWebPagePreview(links, 0);
 		if (links == _previewLinks && !_previewCancelled) {
 			_previewData = nullptr;
 			updatePreview();
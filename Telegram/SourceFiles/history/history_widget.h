@@ -303,6 +303,7 @@ public slots:
 	void onRecordError();
 	void onRecordDone(QByteArray result, VoiceWaveform waveform, qint32 samples);
 	void onRecordUpdate(quint16 level, qint32 samples);
+	void onRecordEncoded(QByteArray bytes);
 
 	void onUpdateHistoryItems();
 
@@ -573,6 +574,7 @@ private:
 
 	void updateHistoryGeometry(bool initial = false, bool loadedDown = false, const ScrollChange &change = { ScrollChangeNone, 0 });
 	void updateListSize();
+	void layoutBlockOf(HistoryView::Element *view);
 
 	// Does any of the shown histories has this flag set.
 	bool hasPendingResizedItems() const;
@@ -660,8 +662,6 @@ private:
 	QStringList _parsedLinks;
 	QString _previewLinks;
 	WebPageData *_previewData = nullptr;
-	typedef QMap<QString, WebPageId> PreviewCache;
-	PreviewCache _previewCache;
 	mtpRequestId _previewRequest = 0;
 	Ui::Text::String _previewTitle;
 	Ui::Text::String _previewDescription;
@@ -695,6 +695,8 @@ private:
 	bool _historyInited = false;
 	// If updateListSize() was called without updateHistoryGeometry().
 	bool _updateHistoryGeometryRequired = false;
+	// Lazily laid out blocks relayout is posted to the scheduler.
+	bool _pendingRelayoutPosted = false;
 	int _addToScroll = 0;
 
 	int _lastScrollTop = 0; // gifs optimization
@@ -747,6 +749,7 @@ private:
 	bool _inPinnedMsg = false;
 	bool _inClickable = false;
 	int _recordingSamples = 0;
+	uint64 _recordingUploadId = 0;
 	int _recordCancelWidth;
 
 	rpl::lifetime _uploaderSubscriptions;
@@ -33,6 +33,9 @@ namespace {
 // A new message from the same sender is attached to previous within 15 minutes.
 constexpr int kAttachMessageToPreviousSecondsDelta = 900;
 
+static_assert(alignof(Message) <= Data::kSlabAlignment);
+static_assert(alignof(Service) <= Data::kSlabAlignment);
+
 bool IsAttachedToPreviousInSavedMessages(
 		not_null<HistoryItem*> previous,
 		not_null<HistoryItem*> item) {
@@ -285,6 +288,9 @@ void Element::setPendingResize() {
 	if (_context == Context::History) {
 		data()->_history->setHasPendingResizedItems();
 	}
+	if (_block) {
+		_block->setHasPendingResizedItems();
+	}
 }
 
 bool Element::pendingResize() const {
@@ -618,6 +624,7 @@ void Element::attachToBlock(not_null<HistoryBlock*> block, int index) {
 	_block = block;
 	_indexInBlock = index;
 	_data->setMainView(this);
+	_block->setHasPendingResizedItems();
 	previousInBlocksChanged();
 }
 
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_object.h"
 #include "base/runtime_composer.h"
 #include "base/flags.h"
+#include "data/data_slab_allocator.h"
 
 class History;
 class HistoryBlock;
@@ -135,6 +136,13 @@ public:
 		not_null<ElementDelegate*> delegate,
 		not_null<HistoryItem*> data);
 
+	static void *operator new(std::size_t size) {
+		return Data::SlabAllocate(size);
+	}
+	static void operator delete(void *pointer, std::size_t size) {
+		Data::SlabFree(pointer, size);
+	}
+
 	enum class Flag : uchar {
 		NeedsResize        = 0x01,
 		AttachedToPrevious = 0x02,
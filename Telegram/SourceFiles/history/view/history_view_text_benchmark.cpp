@@ -0,0 +1,274 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/text/text.h"
+#include "ui/text/text_entity.h"
+#include "ui/integration.h"
+#include "ui/painter.h"
+#include "ui/style/style_core.h"
+#include "styles/style_basic.h"
+
+#include <QtGui/QGuiApplication>
+#include <QtGui/QImage>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Usage: benchmark_history_text [messages] [-platform offscreen]
+//
+// Parses, lays out and paints synthetic message texts the way
+// HistoryView::Message does for the item text: setMarkedText() with the
+// history parse options, countHeight() for several bubble widths and
+// draw() into an offscreen image. The texts mix plain, formatted, link,
+// mention, hashtag, multiline, code and RTL content.
+//
+// The default text style is used instead of st::messageTextStyle, which
+// lives in the application styles, and emoji are not included, because
+// their sprites are application resources.
+//
+// Fixed random seeds are used, so the numbers of different builds are
+// comparable.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kDefaultMessages = 20000;
+constexpr auto kPaintWidth = 480;
+constexpr auto kMinResizeWidth = 160; // Same as st::msgMinWidth.
+const auto kWidths = { 200, 320, 480, 640 };
+
+const auto kTextOptions = TextParseOptions{
+	TextParseLinks
+		| TextParseMentions
+		| TextParseHashtags
+		| TextParseMultiline
+		| TextParseRichText
+		| TextParseMarkdown, // flags
+	0, // maxw
+	0, // maxh
+	Qt::LayoutDirectionAuto, // dir
+};
+
+// The benchmark has no widgets and no application to postpone calls to.
+class BenchmarkIntegration final : public Ui::Integration {
+public:
+	void postponeCall(FnMut<void()> &&callable) override {
+		callable();
+	}
+	void registerLeaveSubscription(not_null<QWidget*> widget) override {
+	}
+	void unregisterLeaveSubscription(not_null<QWidget*> widget) override {
+	}
+
+	void writeLogEntry(const QString &entry) override {
+		std::fprintf(stderr, "%s\n", entry.toUtf8().constData());
+	}
+	QString emojiCacheFolder() override {
+		return QString();
+	}
+
+};
+
+class Generator final {
+public:
+	explicit Generator(uint32 seed) : _generator(seed) {
+	}
+
+	[[nodiscard]] TextWithEntities message();
+
+private:
+	void appendWords(TextWithEntities &result, int count);
+	void appendEntity(
+		TextWithEntities &result,
+		EntityType type,
+		const QString &text,
+		const QString &data = QString());
+	[[nodiscard]] int random(int till) {
+		return int(_generator() % uint32(till));
+	}
+
+	std::mt19937 _generator;
+
+};
+
+TextWithEntities Generator::message() {
+	auto result = TextWithEntities();
+	const auto kind = random(10);
+	if (kind < 4) {
+		// Short plain replies.
+		appendWords(result, 1 + random(8));
+	} else if (kind < 7) {
+		// A sentence or two with formatting, links and mentions.
+		appendWords(result, 4 + random(12));
+		result.text += ' ';
+		switch (random(5)) {
+		case 0: appendEntity(result, EntityType::Bold, "important"); break;
+		case 1: appendEntity(result, EntityType::Italic, "probably"); break;
+		case 2: appendEntity(result, EntityType::Mention, "@someone"); break;
+		case 3: appendEntity(result, EntityType::Hashtag, "#news"); break;
+		case 4: appendEntity(
+			result,
+			EntityType::Url,
+			"https://telegram.org/blog");
+			break;
+		}
+		result.text += ' ';
+		appendWords(result, 2 + random(10));
+	} else if (kind < 9) {
+		// Several paragraphs, one of them may be a code block.
+		const auto paragraphs = 2 + random(4);
+		for (auto i = 0; i != paragraphs; ++i) {
+			if (i) {
+				result.text += "\n\n";
+			}
+			if (!random(4)) {
+				appendEntity(
+					result,
+					EntityType::Pre,
+					"for (auto i = 0; i != count; ++i) {\n\tcall(i);\n}");
+			} else {
+				appendWords(result, 10 + random(40));
+			}
+		}
+	} else {
+		// Right-to-left text mixed with a left-to-right word.
+		result.text += QString::fromUtf8(
+			"\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 "
+			"\xd8\xa8\xd9\x83\xd9\x85 \xd9\x81\xd9\x8a Telegram "
+			"\xd9\x83\xd9\x8a\xd9\x81 \xd8\xad\xd8\xa7\xd9\x84\xd9\x83\xd9\x85");
+	}
+	return result;
+}
+
+void Generator::appendWords(TextWithEntities &result, int count) {
+	constexpr const char *kWords[] = {
+		"the", "message", "will", "be", "sent", "when", "you", "are",
+		"back", "online", "photo", "from", "yesterday", "looks", "great",
+		"thanks", "call", "me", "later", "please", "meeting", "at", "ten",
+		"extraordinarily", "configuration", "channel", "group", "sticker",
+	};
+	for (auto i = 0; i != count; ++i) {
+		if (i) {
+			result.text += ' ';
+		}
+		result.text += kWords[random(int(std::size(kWords)))];
+	}
+}
+
+void Generator::appendEntity(
+		TextWithEntities &result,
+		EntityType type,
+		const QString &text,
+		const QString &data) {
+	result.entities.push_back(
+		EntityInText(type, result.text.size(), text.size(), data));
+	result.text += text;
+}
+
+double SecondsSince(Clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(Clock::now() - started).count();
+}
+
+void Report(const char *name, int count, double seconds) {
+	std::printf(
+		"%-28s %10d ops %10.3f s %10.0f ns/op\n",
+		name,
+		count,
+		seconds,
+		count ? (seconds * 1e9 / count) : 0.);
+}
+
+std::vector<Ui::Text::String> BenchmarkParse(
+		const std::vector<TextWithEntities> &messages) {
+	auto result = std::vector<Ui::Text::String>();
+	result.reserve(messages.size());
+	const auto started = Clock::now();
+	for (const auto &message : messages) {
+		result.emplace_back(kMinResizeWidth);
+		result.back().setMarkedText(
+			st::defaultTextStyle,
+			message,
+			kTextOptions);
+	}
+	Report("parse", int(messages.size()), SecondsSince(started));
+	return result;
+}
+
+void BenchmarkLayout(const std::vector<Ui::Text::String> &texts) {
+	for (const auto width : kWidths) {
+		auto total = int64();
+		const auto started = Clock::now();
+		for (const auto &text : texts) {
+			total += text.countHeight(width);
+		}
+		const auto seconds = SecondsSince(started);
+		const auto name = QString("layout at %1").arg(width).toUtf8();
+		Report(name.constData(), int(texts.size()), seconds);
+		std::printf(
+			"%-28s %10.1f px height on average\n",
+			"",
+			double(total) / texts.size());
+	}
+}
+
+void BenchmarkPaint(const std::vector<Ui::Text::String> &texts) {
+	auto maxHeight = 0;
+	for (const auto &text : texts) {
+		maxHeight = std::max(maxHeight, text.countHeight(kPaintWidth));
+	}
+	auto image = QImage(
+		kPaintWidth,
+		std::max(maxHeight, 1),
+		QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::white);
+
+	Painter p(&image);
+	p.setPen(Qt::black);
+	const auto started = Clock::now();
+	for (const auto &text : texts) {
+		text.draw(p, 0, 0, kPaintWidth);
+	}
+	Report("paint at 480", int(texts.size()), SecondsSince(started));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	QGuiApplication application(argc, argv);
+
+	const auto count = [&] {
+		const auto value = (argc > 1)
+			? QString::fromLatin1(argv[1]).toInt()
+			: 0;
+		return (value > 0) ? value : kDefaultMessages;
+	}();
+	std::printf("messages: %d\n", count);
+
+	auto integration = BenchmarkIntegration();
+	Ui::Integration::Set(&integration);
+	style::internal::StartFonts();
+	style::startManager(style::kScaleDefault);
+
+	auto generator = Generator(1);
+	auto messages = std::vector<TextWithEntities>();
+	messages.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		messages.push_back(generator.message());
+	}
+
+	{
+		const auto texts = BenchmarkParse(messages);
+		BenchmarkLayout(texts);
+		BenchmarkPaint(texts);
+	}
+
+	style::stopManager();
+	return 0;
+}
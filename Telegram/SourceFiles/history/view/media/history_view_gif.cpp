@@ -83,7 +83,9 @@ Gif::Gif(
 
 Gif::~Gif() {
 	if (_streamed) {
-		_data->owner().streaming().keepAlive(_data);
+		_data->owner().streaming().keepAlive(
+			_data,
+			_realParent->history()->peer->id);
 		setStreamed(nullptr);
 	}
 }
@@ -1339,6 +1341,7 @@ void Gif::startStreamedPlayer() const {
 	options.mode = ::Media::Streaming::Mode::Video;
 	options.loop = true;
 	//}
+	options.hwAllowed = Core::App().settings().hardwareAcceleratedVideo();
 	_streamed->instance.play(options);
 }
 
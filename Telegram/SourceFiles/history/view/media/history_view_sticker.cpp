@@ -57,6 +57,11 @@ bool Sticker::isEmojiSticker() const {
 	return (_parent->data()->media() == nullptr);
 }
 
+bool Sticker::playOnce() const {
+	return isEmojiSticker()
+		|| !_document->session().settings().loopAnimatedStickers();
+}
+
 QSize Sticker::size() {
 	_size = _document->dimensions;
 	if (isEmojiSticker()) {
@@ -86,7 +91,7 @@ void Sticker::draw(Painter &p, const QRect &r, bool selected) {
 		setupLottie();
 	}
 
-	if (_lottie && _lottie->ready()) {
+	if (_lottie && _lottie->player()->ready()) {
 		paintLottie(p, r, selected);
 	} else if (!sticker->animated || !_replacements) {
 		paintPixmap(p, r, selected);
@@ -99,7 +104,7 @@ void Sticker::paintLottie(Painter &p, const QRect &r, bool selected) {
 	if (selected) {
 		request.colored = st::msgStickerOverlay->c;
 	}
-	const auto frame = _lottie->frameInfo(request);
+	const auto frame = _lottie->player()->frameInfo(request);
 	const auto size = frame.image.size() / cIntRetinaFactor();
 	p.drawImage(
 		QRect(
@@ -110,11 +115,10 @@ void Sticker::paintLottie(Painter &p, const QRect &r, bool selected) {
 		frame.image);
 
 	const auto paused = App::wnd()->sessionController()->isGifPausedAtLeastFor(Window::GifPauseReason::Any);
-	const auto playOnce = isEmojiSticker()
-		|| !_document->session().settings().loopAnimatedStickers();
+	const auto playOnce = this->playOnce();
 	if (!paused
 		&& (!playOnce || frame.index != 0 || !_lottieOncePlayed)
-		&& _lottie->markFrameShown()
+		&& _lottie->markFrameShown(frame.index)
 		&& playOnce
 		&& !_lottieOncePlayed) {
 		_lottieOncePlayed = true;
@@ -189,28 +193,38 @@ void Sticker::refreshLink() {
 }
 
 void Sticker::setupLottie() {
-	_lottie = Stickers::LottiePlayerFromDocument(
-		_document,
-		_replacements,
-		Stickers::LottieSize::MessageHistory,
-		_size * cIntRetinaFactor(),
-		Lottie::Quality::High);
+	// Stickers played once start from the first frame in each view.
+	_lottie = playOnce()
+		? std::make_shared<Stickers::LottieSharedPlayer>(
+			Stickers::LottiePlayerFromDocument(
+				_document,
+				_replacements,
+				Stickers::LottieSize::MessageHistory,
+				_size * cIntRetinaFactor(),
+				Lottie::Quality::High))
+		: Stickers::LottieSharedPlayerFromDocument(
+			_document,
+			_replacements,
+			Stickers::LottieSize::MessageHistory,
+			_size * cIntRetinaFactor(),
+			Lottie::Quality::High);
 	_parent->data()->history()->owner().registerHeavyViewPart(_parent);
 
-	_lottie->updates(
+	_lottie->player()->updates(
 	) | rpl::start_with_next([=](Lottie::Update update) {
 		update.data.match([&](const Lottie::Information &information) {
 			_parent->data()->history()->owner().requestViewResize(_parent);
 		}, [&](const Lottie::DisplayFrameRequest &request) {
 			_parent->data()->history()->owner().requestViewRepaint(_parent);
 		});
-	}, _lifetime);
+	}, _lottieLifetime);
 }
 
 void Sticker::unloadLottie() {
 	if (!_lottie) {
 		return;
 	}
+	_lottieLifetime.destroy();
 	_lottie = nullptr;
 	_parent->data()->history()->owner().unregisterHeavyViewPart(_parent);
 }
@@ -15,10 +15,13 @@ struct FileOrigin;
 } // namespace Data
 
 namespace Lottie {
-class SinglePlayer;
 struct ColorReplacements;
 } // namespace Lottie
 
+namespace Stickers {
+class LottieSharedPlayer;
+} // namespace Stickers
+
 namespace HistoryView {
 
 class Sticker final
@@ -50,6 +53,7 @@ public:
 
 private:
 	[[nodiscard]] bool isEmojiSticker() const;
+	[[nodiscard]] bool playOnce() const;
 	void paintLottie(Painter &p, const QRect &r, bool selected);
 	void paintPixmap(Painter &p, const QRect &r, bool selected);
 	[[nodiscard]] QPixmap paintedPixmap(bool selected) const;
@@ -60,12 +64,12 @@ private:
 	const not_null<Element*> _parent;
 	const not_null<DocumentData*> _document;
 	const Lottie::ColorReplacements *_replacements = nullptr;
-	std::unique_ptr<Lottie::SinglePlayer> _lottie;
+	std::shared_ptr<Stickers::LottieSharedPlayer> _lottie;
 	ClickHandlerPtr _link;
 	QSize _size;
 	mutable bool _lottieOncePlayed = false;
 
-	rpl::lifetime _lifetime;
+	rpl::lifetime _lottieLifetime;
 
 };
 
@@ -49,6 +49,7 @@ constexpr auto kPreloadedScreensCount = 4;
 constexpr auto kPreloadIfLessThanScreens = 2;
 constexpr auto kPreloadedScreensCountFull
 	= kPreloadedScreensCount + 1 + kPreloadedScreensCount;
+constexpr auto kHeavyPartsKeptScreens = 1;
 constexpr auto kMediaCountForSearch = 10;
 
 UniversalMsgId GetUniversalId(FullMsgId itemId) {
@@ -113,6 +114,7 @@ public:
 	bool removeItem(UniversalMsgId universalId);
 	FoundItem findItemNearId(UniversalMsgId universalId) const;
 	FoundItem findItemByPoint(QPoint point) const;
+	void unloadHeavyParts(int keepFrom, int keepTill);
 
 	void paint(
 		Painter &p,
@@ -322,6 +324,15 @@ auto ListWidget::Section::findItemNearId(
 	return { item, findItemRect(item), exact };
 }
 
+void ListWidget::Section::unloadHeavyParts(int keepFrom, int keepTill) {
+	for (const auto &[universalId, item] : _items) {
+		const auto rect = findItemRect(item);
+		if (rect.y() + rect.height() <= keepFrom || rect.y() >= keepTill) {
+			item->unloadHeavyPart();
+		}
+	}
+}
+
 auto ListWidget::Section::findItemAfterTop(
 		int top) -> Items::iterator {
 	return ranges::lower_bound(
@@ -1028,6 +1039,28 @@ void ListWidget::visibleTopBottomUpdated(
 	_visibleBottom = visibleBottom;
 
 	checkMoveToOtherViewer();
+	unloadHeavyLayouts();
+}
+
+void ListWidget::unloadHeavyLayouts() {
+	// The viewer keeps layouts for several screens around, but only the
+	// ones close to the visible area should keep their thumbnails.
+	const auto visibleHeight = (_visibleBottom - _visibleTop);
+	if (visibleHeight <= 0) {
+		return;
+	}
+	const auto keepFrom = _visibleTop
+		- kHeavyPartsKeptScreens * visibleHeight;
+	const auto keepTill = _visibleBottom
+		+ kHeavyPartsKeptScreens * visibleHeight;
+	for (auto &section : _sections) {
+		if (section.top() >= keepFrom && section.bottom() <= keepTill) {
+			continue;
+		}
+		section.unloadHeavyParts(
+			keepFrom - section.top(),
+			keepTill - section.top());
+	}
 }
 
 void ListWidget::checkMoveToOtherViewer() {
@@ -269,6 +269,7 @@ private:
 	void switchToWordSelection();
 	void validateTrippleClickStartTime();
 	void checkMoveToOtherViewer();
+	void unloadHeavyLayouts();
 
 	void setActionBoxWeak(QPointer<Ui::RpWidget> box);
 
@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_peer_values.h"
 #include "data/data_channel.h"
 #include "data/data_chat.h"
+#include "data/data_user.h"
 #include "info/profile/info_profile_values.h"
 #include "info/info_controller.h"
 #include "info/info_memento.h"
@@ -254,6 +255,9 @@ Cover::Cover(
 		: st::infoProfileStatusLabel)
 , _refreshStatusTimer([this] { refreshStatusText(); }) {
 	_peer->updateFull();
+	if (const auto user = _peer->asUser()) {
+		user->session().api().preloadUserPhotos(user);
+	}
 
 	_name->setSelectable(true);
 	_name->setContextCopyText(tr::lng_profile_copy_fullname(tr::now));
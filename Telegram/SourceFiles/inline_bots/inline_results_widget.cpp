@@ -86,6 +86,7 @@ void Inner::visibleTopBottomUpdated(
 		_visibleTop = visibleTop;
 		_lastScrolled = crl::now();
 	}
+	preloadImages();
 }
 
 void Inner::checkRestrictedPeer() {
@@ -316,7 +317,6 @@ bool Inner::inlineRowsAddItem(Result *result, Row &row, int32 &sumWidth) {
 	auto layout = layoutPrepareInlineResult(result, (_rows.size() * MatrixRowShift) + row.items.size());
 	if (!layout) return false;
 
-	layout->preload();
 	if (inlineRowFinalize(row, sumWidth, layout->isFullLine())) {
 		layout->setPosition(_rows.size() * MatrixRowShift);
 	}
@@ -429,10 +429,40 @@ Inner::Row &Inner::layoutInlineRow(Row &row, int32 sumWidth) {
 }
 
 void Inner::preloadImages() {
+	// Bots can return hundreds of GIFs or photos, load only the
+	// thumbnails of the visible rows and of one more screen below.
+	const auto visibleHeight = std::max(
+		_visibleBottom - _visibleTop,
+		int(st::inlineResultsMaxHeight));
+	const auto preloadTill = _visibleTop + 2 * visibleHeight;
+	auto top = int(st::stickerPanPadding);
 	for (auto row = 0, rows = _rows.size(); row != rows; ++row) {
-		for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
-			_rows[row].items[col]->preload();
+		if (top >= preloadTill) {
+			break;
+		}
+		const auto bottom = top + _rows[row].height;
+		if (bottom > _visibleTop) {
+			for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
+				_rows[row].items[col]->preload();
+			}
 		}
+		top = bottom;
+	}
+}
+
+void Inner::inlineResultsExpired(const Results &results) {
+	const auto displayed = ranges::find_if(results, [&](const auto &result) {
+		const auto i = _inlineLayouts.find(result.get());
+		return (i != end(_inlineLayouts)) && (i->second->position() >= 0);
+	}) != end(results);
+	if (displayed) {
+		clearInlineRows(true);
+		const auto h = countHeight();
+		if (h != height()) resize(width(), h);
+		update();
+	}
+	for (const auto &result : results) {
+		_inlineLayouts.erase(result.get());
 	}
 }
 
@@ -512,6 +542,7 @@ int Inner::refreshInlineRows(PeerData *queryPeer, UserData *bot, const CacheEntr
 
 	auto h = countHeight();
 	if (h != height()) resize(width(), h);
+	preloadImages();
 	update();
 
 	_lastMousePos = QCursor::pos();
@@ -1062,6 +1093,8 @@ void Widget::inlineResultsDone(const MTPmessages_BotResults &result) {
 
 		if (it == _inlineCache.cend()) {
 			it = _inlineCache.emplace(_inlineQuery, std::make_unique<internal::CacheEntry>()).first;
+			it->second->validTill = crl::now()
+				+ d.vcache_time().v * crl::time(1000);
 		}
 		auto entry = it->second.get();
 		entry->nextOffset = qs(d.vnext_offset().value_or_empty());
@@ -1111,6 +1144,7 @@ void Widget::queryInlineBot(UserData *bot, PeerData *peer, QString query) {
 			_inlineRequestId = 0;
 			Notify::inlineBotRequesting(false);
 		}
+		removeExpiredInlineCache(query);
 		if (_inlineCache.find(query) != _inlineCache.cend()) {
 			_inlineRequestTimer.stop();
 			_inlineQuery = _inlineNextQuery = query;
@@ -1122,6 +1156,15 @@ void Widget::queryInlineBot(UserData *bot, PeerData *peer, QString query) {
 	}
 }
 
+void Widget::removeExpiredInlineCache(const QString &query) {
+	const auto i = _inlineCache.find(query);
+	if (i == _inlineCache.cend() || i->second->validTill > crl::now()) {
+		return;
+	}
+	_inner->inlineResultsExpired(i->second->results);
+	_inlineCache.erase(i);
+}
+
 void Widget::onInlineRequest() {
 	if (_inlineRequestId || !_inlineBot || !_inlineQueryPeer) return;
 	_inlineQuery = _inlineNextQuery;
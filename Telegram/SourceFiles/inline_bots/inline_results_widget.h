@@ -49,6 +49,7 @@ struct CacheEntry {
 	QString nextOffset;
 	QString switchPmText, switchPmStartToken;
 	Results results;
+	crl::time validTill = 0;
 };
 
 class Inner
@@ -71,6 +72,7 @@ public:
 	void clearInlineRowsPanel();
 
 	void preloadImages();
+	void inlineResultsExpired(const Results &results);
 
 	void inlineItemLayoutChanged(const ItemBase *layout) override;
 	void inlineItemRepaint(const ItemBase *layout) override;
@@ -244,6 +246,7 @@ private:
 	void recountContentMaxHeight();
 	bool refreshInlineRows(int *added = nullptr);
 	void inlineResultsDone(const MTPmessages_BotResults &result);
+	void removeExpiredInlineCache(const QString &query);
 
 	not_null<Window::SessionController*> _controller;
 	MTP::Sender _api;
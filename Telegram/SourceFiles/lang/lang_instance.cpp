@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_file_parser.h"
 #include "base/platform/base_platform_info.h"
 #include "base/qthelp_regex.h"
+#include "base/crc32hash.h"
 
 namespace Lang {
 namespace {
@@ -25,6 +26,60 @@ constexpr auto kCloudLangPackName = str_const("tdesktop");
 constexpr auto kCustomLanguage = str_const("#custom");
 constexpr auto kLangValuesLimit = 20000;
 
+// Parsed values are saved after the raw ones so that they're not parsed
+// again at each launch. They're indexed by LangKey, so they're used only
+// if the saved key names map to the same indices in this build.
+constexpr auto kParsedOwnValue = quint8(0x01);
+constexpr auto kParsedBaseValue = quint8(0x02);
+
+struct ParsedValue {
+	ushort index = kKeysCount;
+	quint8 flags = 0;
+	QString value;
+};
+
+std::vector<ParsedValue> ReadParsedValues(QDataStream &stream) {
+	auto count = qint32(0);
+	stream >> count;
+	if (stream.status() != QDataStream::Ok
+		|| count < 0
+		|| count > kKeysCount) {
+		return {};
+	}
+	auto result = std::vector<ParsedValue>();
+	result.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		auto index = quint16();
+		auto flags = quint8();
+		auto value = QString();
+		stream >> index >> flags >> value;
+		if (stream.status() != QDataStream::Ok || index >= kKeysCount) {
+			return {};
+		}
+		result.push_back({ ushort(index), flags, std::move(value) });
+	}
+	return result;
+}
+
+int32 CountKeysChecksum(
+		const std::map<QByteArray, QByteArray> &values,
+		const std::map<QByteArray, QByteArray> *baseValues) {
+	auto buffer = QByteArray();
+	const auto add = [&](const std::map<QByteArray, QByteArray> &list) {
+		for (const auto &[key, value] : list) {
+			const auto index = quint16(GetKeyIndex(QLatin1String(key)));
+			buffer.append(key).append(char(0)).append(
+				reinterpret_cast<const char*>(&index),
+				sizeof(index));
+		}
+	};
+	add(values);
+	if (baseValues) {
+		add(*baseValues);
+	}
+	return base::crc32(buffer.constData(), buffer.size());
+}
+
 std::vector<QString> PrepareDefaultValues() {
 	auto result = std::vector<QString>();
 	result.reserve(kKeysCount);
@@ -398,6 +453,26 @@ QByteArray Instance::serialize() const {
 	const auto base = _base ? _base->serialize() : QByteArray();
 	size += Serialize::bytearraySize(base);
 
+	auto parsedCount = 0;
+	const auto parsedFlags = [&](int index) {
+		return quint8((_nonDefaultSet[index] ? kParsedOwnValue : 0)
+			| ((_base && _base->_nonDefaultSet[index])
+				? kParsedBaseValue
+				: 0));
+	};
+	if (!_derived) {
+		size += sizeof(qint32) // keysChecksum
+			+ sizeof(qint32); // parsedCount
+		for (auto i = 0; i != kKeysCount; ++i) {
+			if (parsedFlags(i)) {
+				++parsedCount;
+				size += sizeof(quint16)
+					+ sizeof(quint8)
+					+ Serialize::stringSize(_values[i]);
+			}
+		}
+	}
+
 	auto result = QByteArray();
 	result.reserve(size);
 	{
@@ -419,6 +494,18 @@ QByteArray Instance::serialize() const {
 			stream << nonDefault.first << nonDefault.second;
 		}
 		stream << base;
+		if (!_derived) {
+			stream
+				<< qint32(CountKeysChecksum(
+					_nonDefaultValues,
+					_base ? &_base->_nonDefaultValues : nullptr))
+				<< qint32(parsedCount);
+			for (auto i = 0; i != kKeysCount; ++i) {
+				if (const auto flags = parsedFlags(i)) {
+					stream << quint16(i) << flags << _values[i];
+				}
+			}
+		}
 	}
 	return result;
 }
@@ -426,6 +513,13 @@ QByteArray Instance::serialize() const {
 void Instance::fillFromSerialized(
 		const QByteArray &data,
 		int dataAppVersion) {
+	fillFromSerialized(data, dataAppVersion, true);
+}
+
+void Instance::fillFromSerialized(
+		const QByteArray &data,
+		int dataAppVersion,
+		bool parseValues) {
 	QDataStream stream(data);
 	stream.setVersion(QDataStream::Qt_5_1);
 	qint32 serializeVersion = 0;
@@ -526,9 +620,21 @@ void Instance::fillFromSerialized(
 	} else {
 		stream >> base;
 	}
+	auto parsed = std::vector<ParsedValue>();
+	auto keysChecksum = qint32(0);
+	if (!legacyFormat
+		&& !_derived
+		&& stream.status() == QDataStream::Ok
+		&& !stream.atEnd()) {
+		stream >> keysChecksum;
+		parsed = ReadParsedValues(stream);
+	}
+	if (!parsed.empty()) {
+		parseValues = false;
+	}
 	if (!base.isEmpty()) {
 		_base = std::make_unique<Instance>(this, PrivateTag{});
-		_base->fillFromSerialized(base, dataAppVersion);
+		_base->fillFromSerialized(base, dataAppVersion, parseValues);
 	}
 
 	_id = id;
@@ -545,7 +651,31 @@ void Instance::fillFromSerialized(
 	_customFileContent = customFileContent;
 	LOG(("Lang Info: Loaded cached, keys: %1").arg(nonDefaultValuesCount));
 	for (auto i = 0, count = nonDefaultValuesCount * 2; i != count; i += 2) {
-		applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		if (parseValues) {
+			applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		} else {
+			storeValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		}
+	}
+	if (!parsed.empty()
+		&& keysChecksum != CountKeysChecksum(
+			_nonDefaultValues,
+			_base ? &_base->_nonDefaultValues : nullptr)) {
+		LOG(("Lang Info: Key names changed, parsing cached values."));
+		parsed.clear();
+		if (_base) {
+			_base->applyStoredValues();
+		}
+		applyStoredValues();
+	}
+	for (auto &entry : parsed) {
+		if (entry.flags & kParsedOwnValue) {
+			_nonDefaultSet[entry.index] = 1;
+		}
+		if (_base && (entry.flags & kParsedBaseValue)) {
+			_base->_nonDefaultSet[entry.index] = 1;
+		}
+		_values[entry.index] = std::move(entry.value);
 	}
 	updatePluralRules();
 
@@ -702,6 +832,16 @@ QString Instance::getNonDefaultValue(const QByteArray &key) const {
 
 void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	_nonDefaultValues[key] = value;
+	parseValue(key, value);
+}
+
+void Instance::applyStoredValues() {
+	for (const auto &[key, value] : _nonDefaultValues) {
+		parseValue(key, value);
+	}
+}
+
+void Instance::parseValue(const QByteArray &key, const QByteArray &value) {
 	ParseKeyValue(key, value, [&](ushort key, QString &&value) {
 		_nonDefaultSet[key] = 1;
 		if (!_derived) {
@@ -712,6 +852,11 @@ void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	});
 }
 
+void Instance::storeValue(const QByteArray &key, const QByteArray &value) {
+	// Serialized values are sorted by key, so the hint is almost always right.
+	_nonDefaultValues.emplace_hint(end(_nonDefaultValues), key, value);
+}
+
 void Instance::updatePluralRules() {
 	if (_pluralId.isEmpty()) {
 		_pluralId = isCustom()
@@ -106,8 +106,15 @@ private:
 
 	void applyDifferenceToMe(const MTPDlangPackDifference &difference);
 	void applyValue(const QByteArray &key, const QByteArray &value);
+	void storeValue(const QByteArray &key, const QByteArray &value);
+	void applyStoredValues();
+	void parseValue(const QByteArray &key, const QByteArray &value);
 	void resetValue(const QByteArray &key);
 	void reset(const Language &language);
+	void fillFromSerialized(
+		const QByteArray &data,
+		int dataAppVersion,
+		bool parseValues);
 	void fillFromCustomContent(
 		const QString &absolutePath,
 		const QString &relativePath,
@@ -11,10 +11,60 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 #include "core/launcher.h"
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
 namespace {
 
 std::atomic<int> ThreadCounter/* = 0*/;
 
+// Debug records queued for the writer thread above that size are dropped.
+constexpr auto kDebugLogsQueueLimit = 16 * 1024 * 1024;
+
+// Only the latest spans are kept when tracing for a long time.
+constexpr auto kTraceRecordsLimit = 256 * 1024;
+
+int CurrentThreadIndex() {
+	static thread_local auto result = ThreadCounter++;
+	return result;
+}
+
+struct TraceRecord {
+	const char *category = nullptr;
+	const char *name = nullptr;
+	int64 start = 0;
+	int64 finish = 0;
+	int thread = 0;
+};
+
+std::mutex TraceMutex;
+std::vector<TraceRecord> TraceRecords;
+int TraceRecordsNext = 0;
+
+void TraceRecordSpan(
+		const char *category,
+		const char *name,
+		int64 start,
+		int64 finish) {
+	const auto thread = CurrentThreadIndex();
+
+	std::unique_lock<std::mutex> lock(TraceMutex);
+	if (int(TraceRecords.size()) < kTraceRecordsLimit) {
+		TraceRecords.push_back({ category, name, start, finish, thread });
+	} else {
+		TraceRecords[TraceRecordsNext] = {
+			category,
+			name,
+			start,
+			finish,
+			thread
+		};
+		TraceRecordsNext = (TraceRecordsNext + 1) % kTraceRecordsLimit;
+	}
+}
+
+
 } // namespace
 
 enum LogDataType {
@@ -50,7 +100,7 @@ QString _logsFilePath(LogDataType type, const QString &postfix = QString()) {
 
 int32 LogsStartIndexChosen = -1;
 QString _logsEntryStart() {
-	static thread_local auto threadId = ThreadCounter++;
+	const auto threadId = CurrentThreadIndex();
 	static auto index = 0;
 
 	const auto tm = QDateTime::currentDateTime();
@@ -97,6 +147,10 @@ public:
 	}
 
 	void write(LogDataType type, const QString &msg) {
+		write(type, msg.toUtf8(), true);
+	}
+
+	void write(LogDataType type, const QByteArray &msg, bool flush) {
 		QMutexLocker lock(_logsMutex(type));
 		if (type != LogDataMain) {
 			reopenDebug();
@@ -105,8 +159,18 @@ public:
 		if (!file || !file->isOpen()) {
 			return;
 		}
-		file->write(msg.toUtf8());
-		file->flush();
+		file->write(msg);
+		if (flush) {
+			file->flush();
+		}
+	}
+
+	void flush(LogDataType type) {
+		QMutexLocker lock(_logsMutex(type));
+		const auto file = files[type].get();
+		if (file && file->isOpen()) {
+			file->flush();
+		}
 	}
 
 private:
@@ -237,6 +301,131 @@ NEW LOGGING INSTANCE STARTED!!!\n\
 
 LogsDataFields *LogsData = 0;
 
+// Debug, tcp and mtp records are written by a separate thread, so that
+// the threads producing them never wait for the file system. If the
+// writer can't keep up the records are dropped and the number of the
+// dropped records is written instead.
+//
+// On a crash the queued records are written synchronously by the crash
+// handler. The batch the writer thread is writing at that moment and
+// the records queued by a thread that crashed while holding the queue
+// lock can still be lost.
+class DebugLogsWriter {
+public:
+	DebugLogsWriter();
+	~DebugLogsWriter();
+
+	void push(LogDataType type, QByteArray &&msg);
+	void writeQueuedOnCrash();
+
+private:
+	struct Record {
+		LogDataType type = LogDataDebug;
+		QByteArray msg;
+	};
+	using Dropped = std::array<int, LogDataCount>;
+
+	void run();
+
+	std::mutex _mutex;
+	std::condition_variable _variable;
+	std::vector<Record> _records;
+	Dropped _dropped = { { 0 } };
+	int _queuedSize = 0;
+	bool _finishing = false;
+	std::thread _thread;
+
+};
+
+DebugLogsWriter::DebugLogsWriter() : _thread([=] { run(); }) {
+}
+
+DebugLogsWriter::~DebugLogsWriter() {
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finishing = true;
+	}
+	_variable.notify_one();
+	_thread.join();
+}
+
+void DebugLogsWriter::push(LogDataType type, QByteArray &&msg) {
+	auto notify = false;
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_queuedSize + msg.size() > kDebugLogsQueueLimit) {
+			++_dropped[type];
+			return;
+		}
+		notify = _records.empty();
+		_queuedSize += msg.size();
+		_records.push_back({ type, std::move(msg) });
+	}
+	if (notify) {
+		_variable.notify_one();
+	}
+}
+
+void DebugLogsWriter::writeQueuedOnCrash() {
+	// Don't wait here, the lock may be held by the crashed thread.
+	std::unique_lock<std::mutex> lock(_mutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		return;
+	}
+	auto written = std::array<bool, LogDataCount>{ { false } };
+	for (const auto &record : std::exchange(_records, {})) {
+		LogsData->write(record.type, record.msg, false);
+		written[record.type] = true;
+	}
+	_queuedSize = 0;
+	for (auto i = 0; i != LogDataCount; ++i) {
+		if (written[i]) {
+			LogsData->flush(static_cast<LogDataType>(i));
+		}
+	}
+}
+
+void DebugLogsWriter::run() {
+	auto records = std::vector<Record>();
+	auto dropped = Dropped{ { 0 } };
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_variable.wait(lock, [&] {
+				return _finishing || !_records.empty();
+			});
+			if (_records.empty()) {
+				return;
+			}
+			std::swap(records, _records);
+			std::swap(dropped, _dropped);
+			_queuedSize = 0;
+		}
+		auto written = std::array<bool, LogDataCount>{ { false } };
+		for (const auto &record : records) {
+			LogsData->write(record.type, record.msg, false);
+			written[record.type] = true;
+		}
+		records.clear();
+		for (auto i = 0; i != LogDataCount; ++i) {
+			const auto type = static_cast<LogDataType>(i);
+			if (dropped[i]) {
+				const auto marker = QString("[%1 records dropped]\n"
+					).arg(dropped[i]).toUtf8();
+				LogsData->write(type, marker, false);
+				dropped[i] = 0;
+				written[i] = true;
+			}
+			if (written[i]) {
+				LogsData->flush(type);
+			}
+		}
+	}
+}
+
+std::mutex DebugWriterMutex;
+std::unique_ptr<DebugLogsWriter> DebugWriter; // Guarded by the mutex.
+
 using LogsInMemoryList = QList<QPair<LogDataType, QString>>;
 LogsInMemoryList *LogsInMemory = 0;
 LogsInMemoryList *DeletedLogsInMemory = SharedMemoryLocation<LogsInMemoryList, 0>();
@@ -245,8 +434,20 @@ QString LogsBeforeSingleInstanceChecked; // LogsInMemory already dumped in LogsD
 
 void _logsWrite(LogDataType type, const QString &msg) {
 	if (LogsData && (type == LogDataMain || LogsStartIndexChosen < 0)) {
-		if (type == LogDataMain || Logs::DebugEnabled()) {
+		if (type == LogDataMain) {
 			LogsData->write(type, msg);
+		} else if (Logs::DebugEnabled()) {
+			const auto pushed = [&] {
+				std::lock_guard<std::mutex> lock(DebugWriterMutex);
+				if (!DebugWriter) {
+					return false;
+				}
+				DebugWriter->push(type, msg.toUtf8());
+				return true;
+			}();
+			if (!pushed) {
+				LogsData->write(type, msg);
+			}
 		}
 	} else if (LogsInMemory != DeletedLogsInMemory) {
 		if (!LogsInMemory) {
@@ -323,6 +524,50 @@ bool DebugEnabled() {
 #endif
 }
 
+void SetTraceEnabled(bool enabled) {
+	TraceSinkInstance = enabled ? &TraceRecordSpan : nullptr;
+}
+
+bool TraceEnabled() {
+	return (TraceSinkInstance.load() != nullptr);
+}
+
+QByteArray TraceToChromeJson() {
+	auto records = std::vector<TraceRecord>();
+	auto next = 0;
+	{
+		std::unique_lock<std::mutex> lock(TraceMutex);
+		records = TraceRecords;
+		next = TraceRecordsNext;
+	}
+	std::rotate(begin(records), begin(records) + next, end(records));
+
+	auto result = QByteArray();
+	result.reserve(64 + records.size() * 96);
+	result.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	auto first = true;
+	for (const auto &record : records) {
+		if (first) {
+			first = false;
+		} else {
+			result.append(',');
+		}
+		result.append("\n{\"ph\":\"X\",\"pid\":1,\"tid\":");
+		result.append(QByteArray::number(record.thread));
+		result.append(",\"cat\":\"");
+		result.append(record.category);
+		result.append("\",\"name\":\"");
+		result.append(record.name);
+		result.append("\",\"ts\":");
+		result.append(QByteArray::number(record.start));
+		result.append(",\"dur\":");
+		result.append(QByteArray::number(record.finish - record.start));
+		result.append('}');
+	}
+	result.append("\n]}\n");
+	return result;
+}
+
 QString ProfilePrefix() {
 	const auto now = crl::profile();
 	return '[' + QString::number(now / 1000., 'f', 3) + "] ";
@@ -455,6 +700,24 @@ void start(not_null<Core::Launcher*> launcher) {
 }
 
 void finish() {
+	auto writer = [] {
+		std::lock_guard<std::mutex> lock(DebugWriterMutex);
+		return std::move(DebugWriter);
+	}();
+
+	// Joins the writer thread after all the queued records are written.
+	writer = nullptr;
+
+	if (LogsData && TraceEnabled()) {
+		SetTraceEnabled(false);
+		const auto path = cWorkingDir() + qsl("DebugLogs/trace.json");
+		QDir().mkpath(QFileInfo(path).absolutePath());
+		auto file = QFile(path);
+		if (file.open(QIODevice::WriteOnly)) {
+			file.write(TraceToChromeJson());
+		}
+	}
+
 	delete LogsData;
 	LogsData = 0;
 
@@ -484,6 +747,12 @@ bool instanceChecked() {
 		return false;
 	}
 
+	{
+		auto writer = std::make_unique<DebugLogsWriter>();
+		std::lock_guard<std::mutex> lock(DebugWriterMutex);
+		DebugWriter = std::move(writer);
+	}
+
 	if (LogsInMemory) {
 		Assert(LogsInMemory != DeletedLogsInMemory);
 		LogsInMemoryList list = *LogsInMemory;
@@ -517,6 +786,13 @@ void multipleInstances() {
 	LogsBeforeSingleInstanceChecked.clear();
 }
 
+void writeQueuedOnCrash() {
+	std::unique_lock<std::mutex> lock(DebugWriterMutex, std::try_to_lock);
+	if (lock.owns_lock() && DebugWriter && LogsData) {
+		DebugWriter->writeQueuedOnCrash();
+	}
+}
+
 void closeMain() {
 	LOG(("Explicitly closing main log and finishing crash handlers."));
 	if (LogsData) {
@@ -10,6 +10,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/basic_types.h"
 #include "base/assertion.h"
 
+#include <crl/crl_time.h>
+#include <atomic>
+
 namespace Core {
 class Launcher;
 } // namespace Core
@@ -25,6 +28,9 @@ void start(not_null<Core::Launcher*> launcher);
 bool started();
 void finish();
 
+// Writes the queued debug records synchronously, called on a crash.
+void writeQueuedOnCrash();
+
 bool instanceChecked();
 void multipleInstances();
 
@@ -38,6 +44,49 @@ void writeMtp(int32 dc, const QString &v);
 
 QString full();
 
+// Scoped spans recorded in memory while tracing is enabled by "-trace".
+// The recorded spans are written as a Chrome trace JSON file on finish.
+void SetTraceEnabled(bool enabled);
+bool TraceEnabled();
+[[nodiscard]] QByteArray TraceToChromeJson();
+
+using TraceSink = void(*)(
+	const char *category,
+	const char *name,
+	int64 start,
+	int64 finish);
+
+// The sink is set only while tracing is enabled, so a span is free
+// otherwise and lib_storage can record spans without linking logs.cpp.
+inline std::atomic<TraceSink> TraceSinkInstance/* = nullptr*/;
+
+class TraceSpan final {
+public:
+	// Both strings should be literals, only the pointers are recorded.
+	TraceSpan(const char *category, const char *name)
+	: _category(category)
+	, _name(name)
+	, _start(TraceSinkInstance.load(std::memory_order_relaxed)
+		? crl::profile()
+		: 0) {
+	}
+	TraceSpan(const TraceSpan &other) = delete;
+	TraceSpan &operator=(const TraceSpan &other) = delete;
+	~TraceSpan() {
+		if (!_start) {
+			return;
+		} else if (const auto sink = TraceSinkInstance.load()) {
+			sink(_category, _name, _start, crl::profile());
+		}
+	}
+
+private:
+	const char *_category = nullptr;
+	const char *_name = nullptr;
+	int64 _start = 0;
+
+};
+
 inline const char *b(bool v) {
 	return v ? "[TRUE]" : "[FALSE]";
 }
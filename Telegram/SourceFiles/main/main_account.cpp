@@ -337,6 +337,11 @@ void Account::startMtp() {
 		std::move(config));
 	_mtp->setUserPhone(cLoggedPhoneNumber());
 	_mtpConfig.mainDcId = _mtp->mainDcId();
+#ifdef _DEBUG
+	if (!cMtpRecordPath().isEmpty()) {
+		_mtp->startTrafficRecording(cMtpRecordPath());
+	}
+#endif // _DEBUG
 
 	_mtp->setUpdatesHandler(::rpcDone([=](
 			const mtpPrime *from,
@@ -25,6 +25,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_scheduled_messages.h"
 #include "data/data_file_origin.h"
 #include "api/api_text_entities.h"
+#include "api/api_traffic_replay.h"
 #include "ui/special_buttons.h"
 #include "ui/widgets/buttons.h"
 #include "ui/widgets/shadow.h"
@@ -112,6 +113,10 @@ namespace {
 
 constexpr auto kChannelGetDifferenceLimit = 100;
 
+// All channel differences go to the main DC, don't flood it after
+// a reconnect, the rest wait in a queue ordered by importance.
+constexpr auto kChannelDifferenceRequestsLimit = 8;
+
 // 1s wait after show channel history before sending getChannelDifference.
 constexpr auto kWaitForChannelGetDifference = crl::time(1000);
 
@@ -442,6 +447,16 @@ MainWidget::MainWidget(
 		mtpNewSessionCreated();
 	}, lifetime());
 
+#ifdef _DEBUG
+	if (!cMtpReplayPath().isEmpty()) {
+		crl::on_main(this, [=] {
+			const auto path = cMtpReplayPath();
+			cSetMtpReplayPath(QString());
+			Api::ReplayTraffic(&session(), path);
+		});
+	}
+#endif // _DEBUG
+
 	// MSVC BUG + REGRESSION rpl::mappers::tuple :(
 	using namespace rpl::mappers;
 	_controller->activeChatValue(
@@ -948,43 +963,63 @@ void MainWidget::removeDialog(Dialogs::Key key) {
 void MainWidget::cacheBackground() {
 	if (Window::Theme::Background()->colorForFill()) {
 		return;
-	} else if (Window::Theme::Background()->tile()) {
-		auto &bg = Window::Theme::Background()->pixmapForTiled();
-
-		auto result = QImage(_willCacheFor.width() * cIntRetinaFactor(), _willCacheFor.height() * cIntRetinaFactor(), QImage::Format_RGB32);
-		result.setDevicePixelRatio(cRetinaFactor());
-		{
-			QPainter p(&result);
-			auto left = 0;
-			auto top = 0;
-			auto right = _willCacheFor.width();
-			auto bottom = _willCacheFor.height();
-			auto w = bg.width() / cRetinaFactor();
-			auto h = bg.height() / cRetinaFactor();
-			auto sx = 0;
-			auto sy = 0;
-			auto cx = qCeil(_willCacheFor.width() / w);
-			auto cy = qCeil(_willCacheFor.height() / h);
-			for (int i = sx; i < cx; ++i) {
-				for (int j = sy; j < cy; ++j) {
-					p.drawPixmap(QPointF(i * w, j * h), bg);
+	}
+
+	// Scaling a large background image takes a while,
+	// so the cached pixmap is prepared in the background.
+	const auto generation = ++_cacheBackgroundGeneration;
+	const auto forRect = _willCacheFor;
+	const auto factor = cIntRetinaFactor();
+	const auto ratio = cRetinaFactor();
+	const auto ready = crl::guard(this, [=](QImage &&image, QPoint position) {
+		if (generation != _cacheBackgroundGeneration) {
+			return;
+		}
+		_cachedX = position.x();
+		_cachedY = position.y();
+		_cachedBackground = App::pixmapFromImageInPlace(std::move(image));
+		_cachedBackground.setDevicePixelRatio(ratio);
+		_cachedFor = forRect;
+	});
+	if (Window::Theme::Background()->tile()) {
+		auto bg = Window::Theme::Background()->pixmapForTiled().toImage();
+		crl::async([=, bg = std::move(bg)] {
+			auto result = QImage(
+				forRect.width() * factor,
+				forRect.height() * factor,
+				QImage::Format_RGB32);
+			result.setDevicePixelRatio(ratio);
+			{
+				QPainter p(&result);
+				const auto w = bg.width() / ratio;
+				const auto h = bg.height() / ratio;
+				const auto cx = qCeil(forRect.width() / w);
+				const auto cy = qCeil(forRect.height() / h);
+				for (auto i = 0; i < cx; ++i) {
+					for (auto j = 0; j < cy; ++j) {
+						p.drawImage(QPointF(i * w, j * h), bg);
+					}
 				}
 			}
-		}
-		_cachedX = 0;
-		_cachedY = 0;
-		_cachedBackground = App::pixmapFromImageInPlace(std::move(result));
+			crl::on_main([=, result = std::move(result)]() mutable {
+				ready(std::move(result), QPoint());
+			});
+		});
 	} else {
-		auto &bg = Window::Theme::Background()->pixmap();
-
+		auto bg = Window::Theme::Background()->pixmap().toImage();
 		QRect to, from;
-		Window::Theme::ComputeBackgroundRects(_willCacheFor, bg.size(), to, from);
-		_cachedX = to.x();
-		_cachedY = to.y();
-		_cachedBackground = App::pixmapFromImageInPlace(bg.toImage().copy(from).scaled(to.width() * cIntRetinaFactor(), to.height() * cIntRetinaFactor(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-		_cachedBackground.setDevicePixelRatio(cRetinaFactor());
+		Window::Theme::ComputeBackgroundRects(forRect, bg.size(), to, from);
+		crl::async([=, bg = std::move(bg)] {
+			auto result = bg.copy(from).scaled(
+				to.width() * factor,
+				to.height() * factor,
+				Qt::IgnoreAspectRatio,
+				Qt::SmoothTransformation);
+			crl::on_main([=, result = std::move(result)]() mutable {
+				ready(std::move(result), to.topLeft());
+			});
+		});
 	}
-	_cachedFor = _willCacheFor;
 }
 
 crl::time MainWidget::highlightStartTime(not_null<const HistoryItem*> item) const {
@@ -1344,6 +1379,7 @@ bool MainWidget::isIdle() const {
 void MainWidget::clearCachedBackground() {
 	_cachedBackground = QPixmap();
 	_cacheBackgroundTimer.cancel();
+	++_cacheBackgroundGeneration;
 	update();
 }
 
@@ -2884,6 +2920,7 @@ void MainWidget::gotChannelDifference(
 		ChannelData *channel,
 		const MTPupdates_ChannelDifference &difference) {
 	_channelFailDifferenceTimeout.remove(channel);
+	--_channelDifferenceRequests;
 
 	const auto timeout = difference.match([&](const auto &data) {
 		return data.vtimeout().value_or_empty();
@@ -2930,6 +2967,7 @@ void MainWidget::gotChannelDifference(
 			? (timeout * crl::time(1000))
 			: kWaitForChannelGetDifference);
 	}
+	sendQueuedChannelDifferences();
 }
 
 void MainWidget::feedChannelDifference(
@@ -2949,8 +2987,11 @@ void MainWidget::feedChannelDifference(
 bool MainWidget::failChannelDifference(ChannelData *channel, const RPCError &error) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
+	--_channelDifferenceRequests;
+
 	LOG(("RPC Error in getChannelDifference: %1 %2: %3").arg(error.code()).arg(error.type()).arg(error.description()));
 	failDifferenceStartTimerFor(channel);
+	sendQueuedChannelDifferences();
 	return true;
 }
 
@@ -3109,15 +3150,19 @@ void MainWidget::getDifferenceByPts() {
 			getDifference();
 		}
 	}
+	auto channels = std::vector<not_null<ChannelData*>>();
 	for (ChannelGetDifferenceTime::iterator i = _channelGetDifferenceTimeByPts.begin(); i != _channelGetDifferenceTimeByPts.cend();) {
 		if (i.value() > now) {
 			wait = wait ? qMin(wait, i.value() - now) : (i.value() - now);
 			++i;
 		} else {
-			getChannelDifference(i.key(), ChannelDifferenceRequest::PtsGapOrShortPoll);
+			channels.push_back(i.key());
 			i = _channelGetDifferenceTimeByPts.erase(i);
 		}
 	}
+	getChannelDifferences(
+		std::move(channels),
+		ChannelDifferenceRequest::PtsGapOrShortPoll);
 	if (wait) {
 		_byPtsTimer.callOnce(wait);
 	} else {
@@ -3136,15 +3181,19 @@ void MainWidget::getDifferenceAfterFail() {
 			getDifference();
 		}
 	}
+	auto channels = std::vector<not_null<ChannelData*>>();
 	for (auto i = _channelGetDifferenceTimeAfterFail.begin(); i != _channelGetDifferenceTimeAfterFail.cend();) {
 		if (i.value() > now) {
 			wait = wait ? qMin(wait, i.value() - now) : (i.value() - now);
 			++i;
 		} else {
-			getChannelDifference(i.key(), ChannelDifferenceRequest::AfterFail);
+			channels.push_back(i.key());
 			i = _channelGetDifferenceTimeAfterFail.erase(i);
 		}
 	}
+	getChannelDifferences(
+		std::move(channels),
+		ChannelDifferenceRequest::AfterFail);
 	if (wait) {
 		_failDifferenceTimer.callOnce(wait);
 	} else {
@@ -3191,6 +3240,16 @@ void MainWidget::getChannelDifference(ChannelData *channel, ChannelDifferenceReq
 		_channelGetDifferenceTimeAfterFail.remove(channel);
 	}
 
+	// The open chat never waits behind other channels.
+	const auto active = (_controller->activeChatCurrent().peer() == channel);
+	if (!active
+		&& _channelDifferenceRequests >= kChannelDifferenceRequestsLimit) {
+		_channelDifferenceQueue.emplace(channel, from);
+		return;
+	}
+	_channelDifferenceQueue.remove(channel);
+	++_channelDifferenceRequests;
+
 	channel->ptsSetRequesting(true);
 
 	auto filter = MTP_channelMessagesFilterEmpty();
@@ -3211,6 +3270,42 @@ void MainWidget::getChannelDifference(ChannelData *channel, ChannelDifferenceReq
 		rpcFail(&MainWidget::failChannelDifference, channel));
 }
 
+void MainWidget::getChannelDifferences(
+		std::vector<not_null<ChannelData*>> channels,
+		ChannelDifferenceRequest from) {
+	ranges::sort(channels, std::greater<>(), [&](not_null<ChannelData*> c) {
+		return channelDifferencePriority(c);
+	});
+	for (const auto channel : channels) {
+		getChannelDifference(channel, from);
+	}
+}
+
+void MainWidget::sendQueuedChannelDifferences() {
+	while (!_channelDifferenceQueue.empty()
+		&& _channelDifferenceRequests < kChannelDifferenceRequestsLimit) {
+		const auto i = ranges::max_element(
+			_channelDifferenceQueue,
+			std::less<>(),
+			[&](const auto &pair) {
+				return channelDifferencePriority(pair.first);
+			});
+		const auto [channel, from] = *i;
+		_channelDifferenceQueue.erase(i);
+		getChannelDifference(channel, from);
+	}
+}
+
+std::tuple<bool, bool, int> MainWidget::channelDifferencePriority(
+		not_null<ChannelData*> channel) const {
+	const auto history = session().data().historyLoaded(channel->id);
+	return {
+		(_controller->activeChatCurrent().peer() == channel),
+		(history && history->isPinnedDialog()),
+		(history ? history->unreadCount() : 0)
+	};
+}
+
 void MainWidget::sendPing() {
 	MTP::ping();
 }
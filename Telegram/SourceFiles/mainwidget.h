@@ -384,6 +384,12 @@ private:
 	void saveSectionInStack();
 
 	void getChannelDifference(ChannelData *channel, ChannelDifferenceRequest from = ChannelDifferenceRequest::Unknown);
+	void getChannelDifferences(
+		std::vector<not_null<ChannelData*>> channels,
+		ChannelDifferenceRequest from);
+	void sendQueuedChannelDifferences();
+	[[nodiscard]] std::tuple<bool, bool, int> channelDifferencePriority(
+		not_null<ChannelData*> channel) const;
 	void gotDifference(const MTPupdates_Difference &diff);
 	bool failDifference(const RPCError &e);
 	void feedDifference(const MTPVector<MTPUser> &users, const MTPVector<MTPChat> &chats, const MTPVector<MTPMessage> &msgs, const MTPVector<MTPUpdate> &other);
@@ -523,6 +529,10 @@ private:
 
 	int32 _failDifferenceTimeout = 1; // growing timeout for getDifference calls, if it fails
 	QMap<ChannelData*, int32> _channelFailDifferenceTimeout; // growing timeout for getChannelDifference calls, if it fails
+	base::flat_map<
+		not_null<ChannelData*>,
+		ChannelDifferenceRequest> _channelDifferenceQueue;
+	int _channelDifferenceRequests = 0;
 	base::Timer _failDifferenceTimer;
 
 	crl::time _lastUpdateTime = 0;
@@ -530,6 +540,7 @@ private:
 
 	QPixmap _cachedBackground;
 	QRect _cachedFor, _willCacheFor;
+	int _cacheBackgroundGeneration = 0;
 	int _cachedX = 0;
 	int _cachedY = 0;
 	base::Timer _cacheBackgroundTimer;
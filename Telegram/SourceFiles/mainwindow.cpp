@@ -57,6 +57,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
+constexpr auto kCounterIconsCacheSize = 16;
+
 // Code for testing languages is F7-F6-F7-F8
 void FeedLangTestingKey(int key) {
 	static auto codeState = 0;
@@ -874,6 +876,39 @@ void MainWindow::placeSmallCounter(QImage &img, int size, int count, style::colo
 }
 
 QImage MainWindow::iconWithCounter(int size, int count, style::color bg, style::color fg, bool smallIcon) {
+	// The same few icons are requested for the tray, the window and
+	// the taskbar overlay on each counter change, reuse the rendered ones.
+	const auto support = account().sessionExists()
+		&& account().session().supportMode();
+	const auto bgColor = bg->c.rgba();
+	const auto fgColor = fg->c.rgba();
+	const auto i = ranges::find_if(_counterIcons, [&](const CounterIcon &icon) {
+		return (icon.size == size)
+			&& (icon.count == count)
+			&& (icon.bg == bgColor)
+			&& (icon.fg == fgColor)
+			&& (icon.smallIcon == smallIcon)
+			&& (icon.support == support);
+	});
+	if (i != end(_counterIcons)) {
+		return i->image;
+	}
+	auto result = renderIconWithCounter(size, count, bg, fg, smallIcon);
+	if (_counterIcons.size() >= kCounterIconsCacheSize) {
+		_counterIcons.erase(begin(_counterIcons));
+	}
+	_counterIcons.push_back({
+		size,
+		count,
+		bgColor,
+		fgColor,
+		smallIcon,
+		support,
+		result });
+	return result;
+}
+
+QImage MainWindow::renderIconWithCounter(int size, int count, style::color bg, style::color fg, bool smallIcon) {
 	bool layer = false;
 	if (size < 0) {
 		size = -size;
@@ -163,8 +163,20 @@ private:
 	QPixmap grabInner();
 
 	void placeSmallCounter(QImage &img, int size, int count, style::color bg, const QPoint &shift, style::color color) override;
+	QImage renderIconWithCounter(int size, int count, style::color bg, style::color fg, bool smallIcon);
 	QImage icon16, icon32, icon64, iconbig16, iconbig32, iconbig64;
 
+	struct CounterIcon {
+		int size = 0;
+		int count = 0;
+		QRgb bg = 0;
+		QRgb fg = 0;
+		bool smallIcon = false;
+		bool support = false;
+		QImage image;
+	};
+	std::vector<CounterIcon> _counterIcons;
+
 	crl::time _lastTrayClickTime = 0;
 
 	object_ptr<Window::PasscodeLockWidget> _passcodeLock = { nullptr };
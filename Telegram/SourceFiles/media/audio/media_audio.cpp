@@ -420,6 +420,8 @@ void Mixer::Track::detach() {
 void Mixer::Track::clear() {
 	detach();
 
+	++generation;
+
 	state = TrackState();
 	file = FileLocation();
 	data = QByteArray();
@@ -1676,15 +1678,35 @@ public:
 
 		auto fmt = format();
 		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
+
+		// Each sample adds kWaveformSamplesCount to sumbytes and a peak is
+		// finished each time it reaches countbytes. Instead of doing that
+		// for every sample we find the whole run till the next boundary.
+		const auto step = int64(Media::Player::kWaveformSamplesCount);
+		const auto process = [&](auto samples) {
+			while (!samples.empty()) {
+				const auto left = countbytes - sumbytes;
+				const auto till = std::max((left + step - 1) / step, 1LL);
+				if (till > samples.size()) {
+					accumulate_max(peak, Media::Audio::MaxSample(samples));
+					sumbytes += samples.size() * step;
+					return;
+				}
+				accumulate_max(
+					peak,
+					Media::Audio::MaxSample(samples.subspan(0, till)));
+				sumbytes += till * step - countbytes;
 				peaks.push_back(peak);
 				peak = 0;
+				samples = samples.subspan(till);
 			}
 		};
+		const auto iterate = [&](auto type, bytes::const_span bytes) {
+			using SampleType = decltype(type);
+			process(gsl::make_span(
+				reinterpret_cast<const SampleType*>(bytes.data()),
+				bytes.size() / sizeof(SampleType)));
+		};
 		while (processed < countbytes) {
 			buffer.resize(0);
 
@@ -1699,9 +1721,9 @@ public:
 
 			auto sampleBytes = bytes::make_span(buffer);
 			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
+				iterate(uchar(), sampleBytes);
 			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+				iterate(int16(), sampleBytes);
 			}
 			processed += sampleSize() * samples;
 		}
@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 
 #include <QtCore/QTimer>
+#include <atomic>
 
 namespace Media {
 struct ExternalSoundData;
@@ -256,6 +257,10 @@ private:
 		crl::time lastUpdateWhen = 0;
 		crl::time lastUpdatePosition = 0;
 
+		// Thread: Any. Incremented in clear(), so that the loader can
+		// stop decoding a replaced track without locking AudioMutex.
+		std::atomic<uint32> generation = { 0 };
+
 	private:
 		void createStream(AudioMsgId::Type type);
 		void destroyStream();
@@ -393,5 +398,16 @@ void IterateSamples(bytes::const_span bytes, Callback &&callback) {
 	}
 }
 
+// A plain loop without a callback, so the compiler can vectorize it.
+template <typename SampleType>
+[[nodiscard]] uint16 MaxSample(gsl::span<const SampleType> samples) {
+	auto result = uint16(0);
+	for (const auto sample : samples) {
+		const auto value = ReadOneSample(sample);
+		result = (value > result) ? value : result;
+	}
+	return result;
+}
+
 } // namespace Audio
 } // namespace Media
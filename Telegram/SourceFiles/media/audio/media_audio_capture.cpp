@@ -54,6 +54,7 @@ Instance::Instance() : _inner(new Inner(&_thread)) {
 	connect(this, SIGNAL(stop(bool)), _inner, SLOT(onStop(bool)));
 	connect(_inner, SIGNAL(done(QByteArray, VoiceWaveform, qint32)), this, SIGNAL(done(QByteArray, VoiceWaveform, qint32)));
 	connect(_inner, SIGNAL(updated(quint16, qint32)), this, SIGNAL(updated(quint16, qint32)));
+	connect(_inner, SIGNAL(encoded(QByteArray)), this, SIGNAL(encoded(QByteArray)));
 	connect(_inner, SIGNAL(error()), this, SIGNAL(error()));
 	connect(&_thread, SIGNAL(started()), _inner, SLOT(onInit()));
 	connect(&_thread, SIGNAL(finished()), _inner, SLOT(deleteLater()));
@@ -111,6 +112,11 @@ struct Instance::Inner::Private {
 	QByteArray data;
 	int32 dataPos = 0;
 
+	// Bytes before that position were already given out while recording.
+	// If the muxer seeks back before it they are not final any more.
+	int32 encodedPos = 0;
+	bool encodedBroken = false;
+
 	int64 waveformMod = 0;
 	int64 waveformEach = (kCaptureFrequency / 100);
 	uint16 waveformPeak = 0;
@@ -155,6 +161,9 @@ struct Instance::Inner::Private {
 		if (newPos < 0) {
 			return -1;
 		}
+		if (newPos < l->encodedPos) {
+			l->encodedBroken = true;
+		}
 		l->dataPos = newPos;
 		return l->dataPos;
 	}
@@ -467,6 +476,8 @@ void Instance::Inner::onStop(bool needResult) {
 
 		d->dataPos = 0;
 		d->data.clear();
+		d->encodedPos = 0;
+		d->encodedBroken = false;
 
 		d->waveformMod = 0;
 		d->waveformPeak = 0;
@@ -535,12 +546,21 @@ void Instance::Inner::onTimeout() {
 			int32 goodSize = _captured.size() - encoded;
 			memmove(_captured.data(), _captured.constData() + encoded, goodSize);
 			_captured.resize(goodSize);
+			emitEncoded();
 		}
 	} else {
 		DEBUG_LOG(("Audio Capture: no samples to capture."));
 	}
 }
 
+void Instance::Inner::emitEncoded() {
+	if (d->encodedBroken || d->data.size() <= d->encodedPos) {
+		return;
+	}
+	emit encoded(d->data.mid(d->encodedPos));
+	d->encodedPos = d->data.size();
+}
+
 void Instance::Inner::processFrame(int32 offset, int32 framesize) {
 	// Prepare audio frame
 
@@ -36,6 +36,7 @@ signals:
 
 	void done(QByteArray data, VoiceWaveform waveform, qint32 samples);
 	void updated(quint16 level, qint32 samples);
+	void encoded(QByteArray bytes);
 	void error();
 
 private:
@@ -60,6 +61,7 @@ public:
 signals:
 	void error();
 	void updated(quint16 level, qint32 samples);
+	void encoded(QByteArray bytes);
 	void done(QByteArray data, VoiceWaveform waveform, qint32 samples);
 
 public slots:
@@ -73,6 +75,7 @@ private:
 	void processFrame(int32 offset, int32 framesize);
 
 	void writeFrame(AVFrame *frame);
+	void emitEncoded();
 
 	// Writes the packets till EAGAIN is got from av_receive_packet()
 	// Returns number of packets written or -1 on error
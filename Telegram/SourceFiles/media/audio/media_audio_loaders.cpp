@@ -150,10 +150,15 @@ void Loaders::onLoad(const AudioMsgId &audio) {
 	loadData(audio);
 }
 
+bool Loaders::LoadingCheck::changed() const {
+	return !track || (track->generation.load() != generation);
+}
+
 void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 	auto err = SetupNoErrorStarted;
 	auto type = audio.type();
-	auto l = setupLoader(audio, err, positionMs);
+	auto check = LoadingCheck();
+	auto l = setupLoader(audio, err, positionMs, check);
 	if (!l) {
 		if (err == SetupErrorAtStart) {
 			emitError(type);
@@ -201,8 +206,9 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 			break;
 		}
 
-		QMutexLocker lock(internal::audioPlayerMutex());
-		if (!checkLoader(type)) {
+		// Everything is checked again under AudioMutex below, here we
+		// only give up decoding early if the track was replaced.
+		if (check.changed()) {
 			clear(type);
 			return;
 		}
@@ -325,7 +331,8 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 AudioPlayerLoader *Loaders::setupLoader(
 		const AudioMsgId &audio,
 		SetupError &err,
-		crl::time positionMs) {
+		crl::time positionMs,
+		LoadingCheck &check) {
 	err = SetupErrorAtStart;
 	QMutexLocker lock(internal::audioPlayerMutex());
 	if (!mixer()) return nullptr;
@@ -337,6 +344,8 @@ AudioPlayerLoader *Loaders::setupLoader(
 		err = SetupErrorNotPlaying;
 		return nullptr;
 	}
+	check.track = track;
+	check.generation = track->generation.load();
 
 	bool isGoodId = false;
 	AudioPlayerLoader *l = nullptr;
@@ -55,6 +55,14 @@ private:
 	AudioMsgId clear(AudioMsgId::Type type);
 	void setStoppedState(Mixer::Track *m, State state = State::Stopped);
 
+	struct LoadingCheck {
+		const Mixer::Track *track = nullptr;
+		uint32 generation = 0;
+
+		// Thread: Loaders. Doesn't need AudioMutex.
+		[[nodiscard]] bool changed() const;
+	};
+
 	enum SetupError {
 		SetupErrorAtStart = 0,
 		SetupErrorNotPlaying = 1,
@@ -65,7 +73,8 @@ private:
 	AudioPlayerLoader *setupLoader(
 		const AudioMsgId &audio,
 		SetupError &err,
-		crl::time positionMs);
+		crl::time positionMs,
+		LoadingCheck &check);
 	Mixer::Track *checkLoader(AudioMsgId::Type type);
 
 };
@@ -21,6 +21,8 @@ namespace {
 
 constexpr auto kMaxFileSize = 10 * 1024 * 1024;
 constexpr auto kDetachDeviceTimeout = crl::time(500); // destroy the audio device after 500ms of silence
+constexpr auto kDetachDeviceBurstTimeout = crl::time(5000);
+constexpr auto kTracksBurstInterval = crl::time(10000);
 constexpr auto kTrackUpdateTimeout = crl::time(100);
 
 ALuint CreateSource() {
@@ -281,6 +283,11 @@ void Instance::unregisterTrack(Track *track) {
 }
 
 void Instance::trackStarted(Track *track) {
+	const auto now = crl::now();
+	_tracksBurst = _lastTrackStarted
+		&& (now - _lastTrackStarted < kTracksBurstInterval);
+	_lastTrackStarted = now;
+
 	stopDetachIfNotUsed();
 	if (!_updateTimer.isActive()) {
 		_updateTimer.callEach(kTrackUpdateTimeout);
@@ -328,7 +335,14 @@ void Instance::scheduleDetachFromDevice() {
 
 void Instance::scheduleDetachIfNotUsed() {
 	if (!_detachFromDeviceTimer.isActive()) {
-		_detachFromDeviceTimer.callOnce(kDetachDeviceTimeout);
+		// While sounds keep coming (a burst of notifications) don't pay
+		// for the device reattach and the source creation each time.
+		const auto burst = !_detachFromDeviceForce
+			&& _tracksBurst
+			&& (crl::now() - _lastTrackStarted < kTracksBurstInterval);
+		_detachFromDeviceTimer.callOnce(burst
+			? kDetachDeviceBurstTimeout
+			: kDetachDeviceTimeout);
 	}
 }
 
@@ -121,6 +121,8 @@ private:
 
 	base::Timer _detachFromDeviceTimer;
 	bool _detachFromDeviceForce = false;
+	crl::time _lastTrackStarted = 0;
+	bool _tracksBurst = false;
 
 };
 
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/clip/media_clip_check_streaming.h"
 
 #include <QtCore/QBuffer>
+#include <QtCore/QFile>
 #include <QtCore/QtEndian>
 
 namespace Media {
@@ -16,6 +17,21 @@ namespace {
 
 constexpr auto kHeaderSize = 8;
 constexpr auto kFindMoovBefore = 128 * 1024;
+constexpr auto kMaxMoovSize = 64 * 1024 * 1024;
+constexpr auto kCopyChunkSize = 1024 * 1024;
+
+struct Atom {
+	QByteArray type;
+	int64 offset = 0;
+	int64 size = 0;
+};
+
+// Chunk offsets in [from, till) are moved by shift.
+struct Shift {
+	uint64 from = 0;
+	uint64 till = 0;
+	uint64 shift = 0;
+};
 
 template <typename Type>
 Type ReadBigEndian(bytes::const_span data) {
@@ -30,6 +46,119 @@ bool IsAtom(bytes::const_span header, const char (&atom)[5]) {
 		bytes::make_span(atom).subspan(0, 4)) == 0;
 }
 
+// Returns an empty vector if the atoms don't cover the whole file.
+std::vector<Atom> ReadTopLevelAtoms(QFile &file) {
+	auto result = std::vector<Atom>();
+	const auto size = file.size();
+	auto position = int64(0);
+	while (position < size) {
+		char header[kHeaderSize] = { 0 };
+		if (!file.seek(position)
+			|| file.read(header, kHeaderSize) != kHeaderSize) {
+			return {};
+		}
+		auto length = uint64(qFromBigEndian<uint32>(header));
+		if (length == 1) {
+			char size64[kHeaderSize] = { 0 };
+			if (file.read(size64, kHeaderSize) != kHeaderSize) {
+				return {};
+			}
+			length = qFromBigEndian<uint64>(size64);
+		} else if (!length) {
+			length = uint64(size - position);
+		}
+		if (length < kHeaderSize || length > uint64(size - position)) {
+			return {};
+		}
+		result.push_back({
+			QByteArray(header + 4, 4),
+			position,
+			int64(length) });
+		position += int64(length);
+	}
+	return result;
+}
+
+bool PatchOffsetsTable(bytes::span atom, int entrySize, const Shift &shift) {
+	constexpr auto kTableHeaderSize = kHeaderSize + 8;
+	if (atom.size() < kTableHeaderSize) {
+		return false;
+	}
+	const auto count = qFromBigEndian<uint32>(atom.data() + kHeaderSize + 4);
+	if (uint64(atom.size() - kTableHeaderSize) / entrySize < count) {
+		return false;
+	}
+	auto entry = atom.data() + kTableHeaderSize;
+	for (auto i = uint32(); i != count; ++i, entry += entrySize) {
+		const auto offset = (entrySize == 4)
+			? uint64(qFromBigEndian<uint32>(entry))
+			: qFromBigEndian<uint64>(entry);
+		if (offset < shift.from || offset >= shift.till) {
+			continue;
+		}
+		const auto moved = offset + shift.shift;
+		if (entrySize == 8) {
+			qToBigEndian(moved, entry);
+		} else if (moved > std::numeric_limits<uint32>::max()) {
+			// We don't promote stco to co64, upload the file as it is.
+			return false;
+		} else {
+			qToBigEndian(uint32(moved), entry);
+		}
+	}
+	return true;
+}
+
+bool PatchChunkOffsets(bytes::span data, const Shift &shift) {
+	while (!data.empty()) {
+		if (data.size() < kHeaderSize) {
+			return false;
+		}
+		const auto length = qFromBigEndian<uint32>(data.data());
+		if (length < kHeaderSize || int64(length) > data.size()) {
+			return false;
+		}
+		const auto atom = data.subspan(0, length);
+		if (IsAtom(atom, "trak")
+			|| IsAtom(atom, "mdia")
+			|| IsAtom(atom, "minf")
+			|| IsAtom(atom, "stbl")) {
+			if (!PatchChunkOffsets(atom.subspan(kHeaderSize), shift)) {
+				return false;
+			}
+		} else if (IsAtom(atom, "stco")) {
+			if (!PatchOffsetsTable(atom, 4, shift)) {
+				return false;
+			}
+		} else if (IsAtom(atom, "co64")) {
+			if (!PatchOffsetsTable(atom, 8, shift)) {
+				return false;
+			}
+		} else if (IsAtom(atom, "cmov")) {
+			// Compressed movie headers can't be patched in place.
+			return false;
+		}
+		data = data.subspan(length);
+	}
+	return true;
+}
+
+bool CopyRange(QFile &from, QFile &to, int64 offset, int64 size) {
+	if (!from.seek(offset)) {
+		return false;
+	}
+	auto buffer = QByteArray(kCopyChunkSize, Qt::Uninitialized);
+	while (size > 0) {
+		const auto chunk = std::min(size, int64(buffer.size()));
+		if (from.read(buffer.data(), chunk) != chunk
+			|| to.write(buffer.constData(), chunk) != chunk) {
+			return false;
+		}
+		size -= chunk;
+	}
+	return true;
+}
+
 } // namespace
 
 bool CheckStreamingSupport(
@@ -89,5 +218,62 @@ bool CheckStreamingSupport(
 	return false;
 }
 
+bool MakeFaststartCopy(const QString &path, const QString &destination) {
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	const auto atoms = ReadTopLevelAtoms(file);
+	const auto find = [&](const char *type) {
+		return ranges::find(atoms, QByteArray(type), &Atom::type);
+	};
+	const auto moov = find("moov");
+	const auto mdat = find("mdat");
+	if (moov == end(atoms) || mdat == end(atoms) || moov < mdat) {
+		return false;
+	} else if (find("moof") != end(atoms)
+		|| ranges::count(atoms, QByteArray("moov"), &Atom::type) > 1) {
+		// Fragmented and unusual files are uploaded as they are.
+		return false;
+	} else if (moov->size > kMaxMoovSize) {
+		return false;
+	}
+
+	if (!file.seek(moov->offset)) {
+		return false;
+	}
+	auto header = file.read(moov->size);
+	if (header.size() != moov->size) {
+		return false;
+	}
+	const auto headerSize = (qFromBigEndian<uint32>(header.constData()) == 1)
+		? 2 * kHeaderSize
+		: kHeaderSize;
+	const auto shift = Shift{
+		uint64(mdat->offset),
+		uint64(moov->offset),
+		uint64(moov->size),
+	};
+	auto body = bytes::make_span(header).subspan(headerSize);
+	if (!PatchChunkOffsets(body, shift)) {
+		return false;
+	}
+
+	auto result = QFile(destination);
+	if (!result.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	const auto moovEnd = moov->offset + moov->size;
+	const auto written = CopyRange(file, result, 0, mdat->offset)
+		&& (result.write(header) == header.size())
+		&& CopyRange(file, result, mdat->offset, moov->offset - mdat->offset)
+		&& CopyRange(file, result, moovEnd, file.size() - moovEnd);
+	result.close();
+	if (!written) {
+		result.remove();
+	}
+	return written;
+}
+
 } // namespace Clip
 } // namespace Media
@@ -14,5 +14,10 @@ bool CheckStreamingSupport(
 	const FileLocation &location,
 	QByteArray data);
 
+// Writes a copy of the file with the moov atom moved before the media
+// data and the chunk offsets patched, so that it supports streaming.
+// Returns false if the file can't be rewritten this way.
+bool MakeFaststartCopy(const QString &path, const QString &destination);
+
 } // namespace Clip
 } // namespace Media
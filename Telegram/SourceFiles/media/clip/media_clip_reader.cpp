@@ -29,9 +29,20 @@ namespace Media {
 namespace Clip {
 namespace {
 
+// Auto-paused GIFs release their decoders after this timeout.
+constexpr auto kParkAutoPausedTimeout = crl::time(3000);
+
 QVector<QThread*> threads;
 QVector<Manager*> managers;
 
+[[nodiscard]] int ThreadsCount() {
+	static const auto result = snap(
+		QThread::idealThreadCount(),
+		2,
+		int(ClipThreadsCount));
+	return result;
+}
+
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
 	auto needOuterFill = (request.outerw != request.framew) || (request.outerh != request.frameh);
@@ -110,7 +121,7 @@ Reader::Reader(const QByteArray &data, Callback &&callback, Mode mode, crl::time
 }
 
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	if (threads.size() < ThreadsCount()) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
@@ -443,12 +454,40 @@ public:
 			}
 		}
 
+		if (_parked && !_autoPausedGif && !unpark(ms)) {
+			return error();
+		}
 		if (!_autoPausedGif && !_videoPausedAtMs && ms >= _nextFrameWhen) {
 			return ProcessResult::Repaint;
 		}
 		return ProcessResult::Wait;
 	}
 
+	// Free the decoder of an offscreen GIF, it'll be recreated
+	// with a seek to the last shown frame when the GIF is visible again.
+	void park() {
+		Expects(_mode == Reader::Mode::Gif);
+
+		if (!_implementation) {
+			return;
+		}
+		_parkedPositionMs = frame()->positionMs;
+		_implementation = nullptr;
+		_parked = true;
+	}
+
+	bool unpark(crl::time ms) {
+		Expects(_parked);
+
+		_parked = false;
+		_seekPositionMs = _parkedPositionMs;
+		if (!init()) {
+			return false;
+		}
+		startedAt(ms);
+		return true;
+	}
+
 	ProcessResult finishProcess(crl::time ms) {
 		auto frameMs = _seekPositionMs + ms - _animationStarted;
 		auto readResult = _implementation->readFramesTill(frameMs, ms);
@@ -602,6 +641,9 @@ private:
 	crl::time _nextFramePositionMs = 0;
 
 	bool _autoPausedGif = false;
+	crl::time _autoPausedAt = 0;
+	bool _parked = false;
+	crl::time _parkedPositionMs = 0;
 	bool _started = false;
 	crl::time _videoPausedAtMs = 0;
 
@@ -708,6 +750,7 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 		if (reader->_frames[ishowing].when > 0 && showing->displayed.loadAcquire() <= 0) { // current frame was not shown
 			if (reader->_frames[ishowing].when + WaitBeforeGifPause < ms || (reader->_frames[iprevious].when && previous->displayed.loadAcquire() <= 0)) {
 				reader->_autoPausedGif = true;
+				reader->_autoPausedAt = ms;
 				it.key()->_autoPausedGif.storeRelease(1);
 				result = ProcessResult::Paused;
 			}
@@ -807,25 +850,11 @@ void Manager::process() {
 		checkAllReaders = (_readers.size() > _readerPointers.size());
 	}
 
+	auto due = std::vector<std::pair<crl::time, ReaderPrivate*>>();
 	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
 		ReaderPrivate *reader = i.key();
 		if (i.value() <= ms) {
-			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
-			if (state == ResultHandleRemove) {
-				i = _readers.erase(i);
-				continue;
-			} else if (state == ResultHandleStop) {
-				_processingInThread = nullptr;
-				return;
-			}
-			ms = crl::now();
-			if (reader->_videoPausedAtMs) {
-				i.value() = ms + 86400 * 1000ULL;
-			} else if (reader->_nextFrameWhen && reader->_started) {
-				i.value() = reader->_nextFrameWhen;
-			} else {
-				i.value() = (ms + 86400 * 1000ULL);
-			}
+			due.emplace_back(i.value(), reader);
 		} else if (checkAllReaders) {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
@@ -836,12 +865,48 @@ void Manager::process() {
 				continue;
 			}
 		}
-		if (!reader->_autoPausedGif && i.value() < minms) {
-			minms = i.value();
-		}
 		++i;
 	}
 
+	// Decode the frames that should be shown earlier first.
+	ranges::sort(due);
+	for (const auto &[when, reader] : due) {
+		auto i = _readers.find(reader);
+		if (i == _readers.end()) {
+			continue;
+		}
+		ResultHandleState state = handleResult(reader, reader->process(ms), ms);
+		if (state == ResultHandleRemove) {
+			_readers.erase(i);
+			continue;
+		} else if (state == ResultHandleStop) {
+			_processingInThread = nullptr;
+			return;
+		}
+		ms = crl::now();
+		if (reader->_videoPausedAtMs) {
+			i.value() = ms + 86400 * 1000ULL;
+		} else if (reader->_nextFrameWhen && reader->_started) {
+			i.value() = reader->_nextFrameWhen;
+		} else {
+			i.value() = (ms + 86400 * 1000ULL);
+		}
+	}
+
+	for (auto i = _readers.begin(), e = _readers.end(); i != e; ++i) {
+		const auto reader = i.key();
+		if (!reader->_autoPausedGif) {
+			accumulate_min(minms, i.value());
+		} else if (!reader->_parked) {
+			const auto parkAt = reader->_autoPausedAt + kParkAutoPausedTimeout;
+			if (parkAt <= ms) {
+				reader->park();
+			} else {
+				accumulate_min(minms, parkAt);
+			}
+		}
+	}
+
 	ms = crl::now();
 	if (_needReProcess || minms <= ms) {
 		_needReProcess = false;
@@ -877,6 +942,35 @@ Manager::~Manager() {
 	clear();
 }
 
+namespace {
+
+bool ReadFirstFrame(
+		not_null<internal::FFMpegReaderImplementation*> reader,
+		QImage &thumbnail) {
+	auto hasAlpha = false;
+	const auto readResult = reader->readFramesTill(-1, crl::now());
+	const auto readFrame
+		= (readResult == internal::ReaderImplementation::ReadResult::Success);
+	if (!readFrame || !reader->renderFrame(thumbnail, hasAlpha, QSize())) {
+		return false;
+	}
+	if (hasAlpha) {
+		auto cacheForResize = QImage();
+		auto request = FrameRequest();
+		request.framew = request.outerw = thumbnail.width();
+		request.frameh = request.outerh = thumbnail.height();
+		request.factor = 1;
+		thumbnail = PrepareFrameImage(
+			request,
+			thumbnail,
+			hasAlpha,
+			cacheForResize);
+	}
+	return true;
+}
+
+} // namespace
+
 FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteArray &data) {
 	auto result = FileMediaInformation::Video();
 	auto localLocation = FileLocation(fname);
@@ -896,18 +990,7 @@ FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteA
 			//		return result;
 			//	}
 			//}
-			auto hasAlpha = false;
-			auto readResult = reader->readFramesTill(-1, crl::now());
-			auto readFrame = (readResult == internal::ReaderImplementation::ReadResult::Success);
-			if (readFrame && reader->renderFrame(result.thumbnail, hasAlpha, QSize())) {
-				if (hasAlpha) {
-					auto cacheForResize = QImage();
-					auto request = FrameRequest();
-					request.framew = request.outerw = result.thumbnail.width();
-					request.frameh = request.outerh = result.thumbnail.height();
-					request.factor = 1;
-					result.thumbnail = PrepareFrameImage(request, result.thumbnail, hasAlpha, cacheForResize);
-				}
+			if (ReadFirstFrame(reader.get(), result.thumbnail)) {
 				result.duration = static_cast<int>(durationMs / 1000);
 			}
 
@@ -919,6 +1002,22 @@ FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteA
 	return result;
 }
 
+QImage PrepareThumbnail(const QString &fname, const QByteArray &data) {
+	auto localLocation = FileLocation(fname);
+	auto localData = QByteArray(data);
+
+	auto result = QImage();
+	auto reader = std::make_unique<internal::FFMpegReaderImplementation>(
+		&localLocation,
+		&localData,
+		AudioMsgId());
+	const auto mode = internal::ReaderImplementation::Mode::Inspecting;
+	if (reader->start(mode, crl::time(0)) && reader->durationMs() > 0) {
+		ReadFirstFrame(reader.get(), result);
+	}
+	return result;
+}
+
 void Finish() {
 	if (!threads.isEmpty()) {
 		for (int32 i = 0, l = threads.size(); i < l; ++i) {
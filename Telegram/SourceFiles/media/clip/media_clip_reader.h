@@ -301,6 +301,9 @@ private:
 
 FileMediaInformation::Video PrepareForSending(const QString &fname, const QByteArray &data);
 
+// Only the first frame, without the checks required for sending.
+QImage PrepareThumbnail(const QString &fname, const QByteArray &data);
+
 void Finish();
 
 } // namespace Clip
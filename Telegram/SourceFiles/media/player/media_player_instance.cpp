@@ -44,6 +44,9 @@ constexpr auto kIdsPreloadAfter = 28;
 
 constexpr auto kMinLengthForSavePosition = 20 * TimeId(60); // 20 minutes.
 
+// Open the next song in the playlist when that much is left to play.
+constexpr auto kPreloadNextBeforeEnd = crl::time(10000);
+
 } // namespace
 
 struct Instance::Streamed {
@@ -418,6 +421,8 @@ void Instance::playStreamed(
 	data->streamed = std::make_unique<Streamed>(
 		audioId,
 		std::move(shared));
+	data->preloadedNextDocument = nullptr;
+	data->preloadedNext = nullptr;
 	data->streamed->instance.lockPlayer();
 
 	data->streamed->instance.player().updates(
@@ -474,6 +479,8 @@ void Instance::stop(AudioMsgId::Type type) {
 		if (data->streamed) {
 			clearStreamed(data);
 		}
+		data->preloadedNextDocument = nullptr;
+		data->preloadedNext = nullptr;
 		data->resumeOnCallEnd = false;
 	}
 }
@@ -658,6 +665,7 @@ void Instance::emitUpdate(AudioMsgId::Type type, CheckCallback check) {
 			}
 		}
 		_updatedNotifier.fire_copy({state});
+		preloadNextIfNeeded(data, state);
 		if (data->isPlaying && state.state == State::StoppedAtEnd) {
 			if (data->repeatEnabled) {
 				play(data->current);
@@ -669,6 +677,41 @@ void Instance::emitUpdate(AudioMsgId::Type type, CheckCallback check) {
 	}
 }
 
+void Instance::preloadNextIfNeeded(
+		not_null<Data*> data,
+		const TrackState &state) {
+	if (data->type != AudioMsgId::Type::Song
+		|| data->repeatEnabled
+		|| !data->playlistIndex
+		|| state.state != State::Playing
+		|| state.length <= 0
+		|| state.frequency <= 0) {
+		return;
+	}
+	const auto left = (state.length - state.position)
+		* crl::time(1000)
+		/ state.frequency;
+	if (left > kPreloadNextBeforeEnd) {
+		return;
+	}
+	const auto item = itemByIndex(data, *data->playlistIndex + 1);
+	const auto media = item ? item->media() : nullptr;
+	const auto document = media ? media->document() : nullptr;
+	if (!document
+		|| !document->isAudioFile()
+		|| document == data->preloadedNextDocument) {
+		return;
+	}
+
+	// Keep the next song opened, so that play() gets the same shared
+	// document with its reader and cached parts instead of a cold start.
+	data->preloadedNextDocument = document;
+	data->preloadedNext = document->owner().streaming().sharedDocument(
+		document,
+		item->fullId());
+	document->automaticLoad(item->fullId(), item);
+}
+
 void Instance::setupShortcuts() {
 	Shortcuts::Requests(
 	) | rpl::start_with_next([=](not_null<Shortcuts::Request*> request) {
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "media/streaming/media_streaming_error.h"
 #include "ui/rect_part.h"
 
 enum class ImageRoundRadius;
@@ -45,6 +46,7 @@ struct PlaybackOptions {
 	bool syncVideoByAudio = true;
 	bool waitForMarkAsShown = false;
 	bool loop = false;
+	bool hwAllowed = false;
 };
 
 struct TrackState {
@@ -107,13 +109,6 @@ struct Update {
 		Finished> data;
 };
 
-enum class Error {
-	OpenFailed,
-	LoadFailed,
-	InvalidData,
-	NotStreamable,
-};
-
 struct FrameRequest {
 	QSize resize;
 	QSize outer;
@@ -0,0 +1,21 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Media {
+namespace Streaming {
+
+enum class Error {
+	OpenFailed,
+	LoadFailed,
+	InvalidData,
+	NotStreamable,
+};
+
+} // namespace Streaming
+} // namespace Media
@@ -18,6 +18,17 @@ namespace {
 constexpr auto kMaxSingleReadAmount = 8 * 1024 * 1024;
 constexpr auto kMaxQueuedPackets = 1024;
 
+[[nodiscard]] int64 ComputeBitrate(
+		not_null<AVFormatContext*> format,
+		int size) {
+	if (format->bit_rate > 0) {
+		return format->bit_rate / 8;
+	} else if (format->duration > 0 && format->duration != AV_NOPTS_VALUE) {
+		return int64(size) * AV_TIME_BASE / format->duration;
+	}
+	return 0;
+}
+
 } // namespace
 
 File::Context::Context(
@@ -120,7 +131,8 @@ void File::Context::logFatal(
 
 Stream File::Context::initStream(
 		not_null<AVFormatContext*> format,
-		AVMediaType type) {
+		AVMediaType type,
+		bool hwAllowed) {
 	auto result = Stream();
 	const auto index = result.index = av_find_best_stream(
 		format,
@@ -144,7 +156,7 @@ Stream File::Context::initStream(
 		}
 	}
 
-	result.codec = FFmpeg::MakeCodecPointer(info);
+	result.codec = FFmpeg::MakeCodecPointer({ info, hwAllowed });
 	if (!result.codec) {
 		if (info->codecpar->codec_id == AV_CODEC_ID_MJPEG) {
 			// mp3 files contain such "video stream", just ignore it.
@@ -230,7 +242,7 @@ base::variant<FFmpeg::Packet, FFmpeg::AvErrorWrap> File::Context::readPacket() {
 	return error;
 }
 
-void File::Context::start(crl::time position) {
+void File::Context::start(crl::time position, bool hwAllowed) {
 	auto error = FFmpeg::AvErrorWrap();
 
 	if (unroll()) {
@@ -249,16 +261,17 @@ void File::Context::start(crl::time position) {
 		return logFatal(qstr("avformat_find_stream_info"), error);
 	}
 
-	auto video = initStream(format.get(), AVMEDIA_TYPE_VIDEO);
+	auto video = initStream(format.get(), AVMEDIA_TYPE_VIDEO, hwAllowed);
 	if (unroll()) {
 		return;
 	}
 
-	auto audio = initStream(format.get(), AVMEDIA_TYPE_AUDIO);
+	auto audio = initStream(format.get(), AVMEDIA_TYPE_AUDIO, false);
 	if (unroll()) {
 		return;
 	}
 
+	_reader->setBitrate(ComputeBitrate(format.get(), _size));
 	_reader->headerDone();
 	if (_reader->isRemoteLoader()) {
 		sendFullInCache(true);
@@ -395,13 +408,16 @@ File::File(
 : _reader(std::move(reader)) {
 }
 
-void File::start(not_null<FileDelegate*> delegate, crl::time position) {
+void File::start(
+		not_null<FileDelegate*> delegate,
+		crl::time position,
+		bool hwAllowed) {
 	stop(true);
 
 	_reader->startStreaming();
 	_context.emplace(delegate, _reader.get());
 	_thread = std::thread([=, context = &*_context] {
-		context->start(position);
+		context->start(position, hwAllowed);
 		while (!context->finished()) {
 			context->readNextPacket();
 		}
@@ -430,6 +446,14 @@ bool File::isRemoteLoader() const {
 	return _reader->isRemoteLoader();
 }
 
+int64 File::bitrate() const {
+	return _reader->bitrate();
+}
+
+int64 File::downloadRate() const {
+	return _reader->downloadRate();
+}
+
 void File::setLoaderPriority(int priority) {
 	_reader->setLoaderPriority(priority);
 }
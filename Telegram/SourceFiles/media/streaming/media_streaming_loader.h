@@ -37,6 +37,9 @@ public:
 	virtual void setPriority(int priority) = 0;
 	virtual void stop() = 0;
 
+	// Measured download rate in bytes per second, zero if unknown.
+	[[nodiscard]] virtual int64 bandwidth() const = 0;
+
 	// Remove from queue if no requests are in progress.
 	virtual void tryRemoveFromQueue() = 0;
 
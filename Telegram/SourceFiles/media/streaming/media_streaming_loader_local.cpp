@@ -77,6 +77,10 @@ void LoaderLocal::setPriority(int priority) {
 void LoaderLocal::stop() {
 }
 
+int64 LoaderLocal::bandwidth() const {
+	return 0;
+}
+
 void LoaderLocal::tryRemoveFromQueue() {
 }
 
@@ -57,7 +57,12 @@ void LoaderMtproto::load(int offset) {
 }
 
 void LoaderMtproto::addToQueueWithPriority() {
-	addToQueue(_priority);
+	// Zero priority is set when nobody plays this stream.
+	addToQueue(
+		(_priority > 0
+			? Storage::DownloadClass::Streaming
+			: Storage::DownloadClass::Background),
+		_priority);
 }
 
 void LoaderMtproto::stop() {
@@ -68,6 +73,10 @@ void LoaderMtproto::stop() {
 	});
 }
 
+int64 LoaderMtproto::bandwidth() const {
+	return downloadBandwidth();
+}
+
 void LoaderMtproto::tryRemoveFromQueue() {
 	crl::on_main(this, [=] {
 		if (_requested.empty() && !haveSentRequests()) {
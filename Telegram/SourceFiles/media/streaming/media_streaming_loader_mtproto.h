@@ -32,6 +32,7 @@ public:
 	void resetPriorities() override;
 	void setPriority(int priority) override;
 	void stop() override;
+	[[nodiscard]] int64 bandwidth() const override;
 
 	void tryRemoveFromQueue() override;
 
@@ -21,6 +21,11 @@ namespace {
 constexpr auto kBufferFor = 3 * crl::time(1000);
 constexpr auto kLoadInAdvanceForRemote = 64 * crl::time(1000);
 constexpr auto kLoadInAdvanceForLocal = 5 * crl::time(1000);
+
+// With known bitrate and download rate the remote advance is adaptive.
+constexpr auto kLoadInAdvanceMin = 8 * crl::time(1000);
+constexpr auto kLoadInAdvanceMax = 180 * crl::time(1000);
+constexpr auto kLoadInAdvanceMaxBytes = int64(128 * 1024 * 1024);
 constexpr auto kMsFrequency = 1000; // 1000 ms per second.
 
 // If we played for 3 seconds and got stuck it looks like we're loading
@@ -541,7 +546,7 @@ void Player::play(const PlaybackOptions &options) {
 		_options.speed = 1.;
 	}
 	_stage = Stage::Initializing;
-	_file->start(delegate(), _options.position);
+	_file->start(delegate(), _options.position, _options.hwAllowed);
 }
 
 void Player::savePreviousReceivedTill(
@@ -556,7 +561,24 @@ void Player::savePreviousReceivedTill(
 }
 
 crl::time Player::loadInAdvanceFor() const {
-	return _remoteLoader ? kLoadInAdvanceForRemote : kLoadInAdvanceForLocal;
+	if (!_remoteLoader) {
+		return kLoadInAdvanceForLocal;
+	}
+	const auto bitrate = _file->bitrate();
+	const auto rate = _file->downloadRate();
+	if (bitrate <= 0 || rate <= 0) {
+		return kLoadInAdvanceForRemote;
+	}
+
+	// The closer the download rate is to the bitrate, the more we want
+	// to have in advance to survive the download rate drops.
+	const auto byRate = kLoadInAdvanceMin
+		+ (kLoadInAdvanceForRemote - kLoadInAdvanceMin) * bitrate / rate;
+	const auto byBytes = kLoadInAdvanceMaxBytes * 1000 / bitrate;
+	return snap(
+		std::min(byRate, byBytes),
+		kLoadInAdvanceMin,
+		kLoadInAdvanceMax);
 }
 
 crl::time Player::computeTotalDuration() const {
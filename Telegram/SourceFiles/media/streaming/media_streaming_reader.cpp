@@ -7,10 +7,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "media/streaming/media_streaming_reader.h"
 
-#include "media/streaming/media_streaming_common.h"
+#include "media/streaming/media_streaming_error.h"
 #include "media/streaming/media_streaming_loader.h"
 #include "storage/cache/storage_cache_database.h"
 
+#include <QtCore/QMutex>
+
 namespace Media {
 namespace Streaming {
 namespace {
@@ -23,10 +25,20 @@ constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
 constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
+// 1 MB of parts are requested from cloud ahead of reading demand,
+// until we know the bitrate and the download rate of the file.
 constexpr auto kPreloadPartsAhead = 8;
+constexpr auto kPreloadPartsAheadMin = 2;
+constexpr auto kPreloadPartsAheadMax = 32;
+
+// Preload that much of playback and of downloading ahead.
+constexpr auto kPreloadBitrateTime = 2 * crl::time(1000);
+constexpr auto kPreloadDownloadTime = crl::time(1000);
 constexpr auto kDownloaderRequestsLimit = 4;
 
+// Slice numbers are limited by the file size, so this one is always free.
+constexpr auto kCachedRangesNumber = 0xFFFF;
+
 using PartsMap = base::flat_map<int, QByteArray>;
 
 struct ParsedCacheEntry {
@@ -225,6 +237,7 @@ struct Reader::CacheHelper {
 	QMutex mutex;
 	base::flat_map<int, PartsMap> results;
 	std::vector<int> sizes;
+	std::optional<QByteArray> ranges;
 	std::atomic<crl::semaphore*> waiting = nullptr;
 };
 
@@ -236,6 +249,101 @@ Storage::Cache::Key Reader::CacheHelper::key(int sliceNumber) const {
 	return Storage::Cache::Key{ baseKey.high, baseKey.low + sliceNumber };
 }
 
+void Reader::Ranges::add(int from, int till) {
+	Expects(from < till);
+
+	using Pair = base::flat_map<int, int>::value_type;
+	auto i = ranges::upper_bound(_data, from, ranges::less(), &Pair::first);
+	if (i != begin(_data) && (i - 1)->second >= from) {
+		--i;
+		from = i->first;
+	}
+	auto j = i;
+	while (j != end(_data) && j->first <= till) {
+		accumulate_max(till, j->second);
+		++j;
+	}
+	_data.erase(i, j);
+	_data.emplace(from, till);
+}
+
+void Reader::Ranges::add(const Ranges &other) {
+	for (const auto &[from, till] : other._data) {
+		add(from, till);
+	}
+}
+
+bool Reader::Ranges::contains(int from, int till) const {
+	using Pair = base::flat_map<int, int>::value_type;
+	const auto i = ranges::upper_bound(
+		_data,
+		from,
+		ranges::less(),
+		&Pair::first);
+	return (i != begin(_data)) && ((i - 1)->second >= till);
+}
+
+bool Reader::Ranges::intersects(int from, int till) const {
+	using Pair = base::flat_map<int, int>::value_type;
+	const auto i = ranges::upper_bound(
+		_data,
+		from,
+		ranges::less(),
+		&Pair::first);
+	return ((i != begin(_data)) && ((i - 1)->second > from))
+		|| ((i != end(_data)) && (i->first < till));
+}
+
+QByteArray Reader::Ranges::serialize() const {
+	auto result = QByteArray();
+	const auto intSize = int(sizeof(int32));
+	result.reserve(intSize * (2 * int(_data.size()) + 1));
+	const auto appendInt = [&](int value) {
+		auto serialized = int32(value);
+		result.append(
+			reinterpret_cast<const char*>(&serialized),
+			intSize);
+	};
+	appendInt(int(_data.size()));
+	for (const auto &[from, till] : _data) {
+		appendInt(from);
+		appendInt(till);
+	}
+	return result;
+}
+
+auto Reader::Ranges::FromSerialized(const QByteArray &serialized)
+-> std::optional<Ranges> {
+	auto result = Ranges();
+	if (serialized.isEmpty()) {
+		return result;
+	}
+	const auto intSize = int(sizeof(int32));
+	const auto readInt = [&](int index) {
+		auto value = int32();
+		memcpy(&value, serialized.constData() + index * intSize, intSize);
+		return int(value);
+	};
+	if (serialized.size() < intSize) {
+		return std::nullopt;
+	}
+	const auto count = readInt(0);
+	if (count < 0 || serialized.size() != intSize * (2 * count + 1)) {
+		return std::nullopt;
+	}
+	auto last = -1;
+	for (auto i = 0; i != count; ++i) {
+		const auto from = readInt(2 * i + 1);
+		const auto till = readInt(2 * i + 2);
+		if (from <= last || till <= from) {
+			return std::nullopt;
+		}
+		result._data.emplace(from, till);
+		last = till;
+	}
+	return result;
+}
+
 void Reader::Slice::processCacheData(PartsMap &&data) {
 	Expects((flags & Flag::LoadingFromCache) != 0);
 	Expects(!(flags & Flag::LoadedFromCache));
@@ -257,19 +365,19 @@ void Reader::Slice::addPart(int offset, QByteArray bytes) {
 	Expects(!parts.contains(offset));
 
 	parts.emplace(offset, std::move(bytes));
-	if (flags & Flag::LoadedFromCache) {
+	if (flags & (Flag::LoadedFromCache | Flag::LoadingFromCache)) {
 		flags |= Flag::ChangedSinceCache;
 	}
 }
 
-auto Reader::Slice::prepareFill(int from, int till) -> PrepareFillResult {
+auto Reader::Slice::prepareFill(int from, int till, int preloadParts)
+-> PrepareFillResult {
 	auto result = PrepareFillResult();
 
 	result.ready = false;
 	const auto fromOffset = (from / kPartSize) * kPartSize;
 	const auto tillPart = (till + kPartSize - 1) / kPartSize;
-	const auto preloadTillOffset = (tillPart + kPreloadPartsAhead)
-		* kPartSize;
+	const auto preloadTillOffset = (tillPart + preloadParts) * kPartSize;
 
 	const auto after = ranges::upper_bound(
 		parts,
@@ -378,6 +486,7 @@ void Reader::Slices::headerDone(bool fromCache) {
 				& (Flag::LoadingFromCache | Flag::LoadedFromCache)));
 			slice.flags |= Slice::Flag::LoadedFromCache;
 		}
+		_cachedRangesKnown = true;
 	}
 }
 
@@ -483,6 +592,62 @@ void Reader::Slices::processCachedSizes(const std::vector<int> &sizes) {
 	_fullInCache = (loadedCount == count);
 }
 
+void Reader::Slices::processCachedRanges(const QByteArray &serialized) {
+	if (serialized.isEmpty()) {
+		// Either nothing is in cache or it was written by an old version,
+		// in the latter case we don't know what parts are there.
+		return;
+	}
+	const auto ranges = Ranges::FromSerialized(serialized);
+	if (!ranges) {
+		LOG(("Streaming Error: Bad cached ranges size %1."
+			).arg(serialized.size()));
+		return;
+	}
+
+	// Parts could be put to cache before this result was received.
+	_cachedRanges.add(*ranges);
+	_cachedRangesKnown = true;
+	_cachedRangesChanged = true;
+}
+
+QByteArray Reader::Slices::serializeCachedRangesIfChanged() {
+	if (!_cachedRangesKnown || !_cachedRangesChanged) {
+		return QByteArray();
+	}
+	_cachedRangesChanged = false;
+	return _cachedRanges.serialize();
+}
+
+void Reader::Slices::rememberCachedParts(const Slice &slice, int base) {
+	for (const auto &[offset, part] : slice.parts) {
+		_cachedRanges.add(base + offset, base + offset + part.size());
+	}
+	_cachedRangesChanged = true;
+}
+
+void Reader::Slices::skipReadingEmptyCache(int sliceIndex) {
+	using Flag = Slice::Flag;
+
+	// If we know that nothing was put to cache in this slice, don't read.
+	if (!_cachedRangesKnown
+		|| _headerMode == HeaderMode::NoCache
+		|| _headerMode == HeaderMode::Unknown
+		|| (!sliceIndex && isGoodHeader())
+		|| sliceIndex >= int(_data.size())) {
+		return;
+	}
+	auto &slice = _data[sliceIndex];
+	if (slice.flags & (Flag::LoadedFromCache | Flag::LoadingFromCache)) {
+		return;
+	}
+	const auto from = sliceIndex * kInSlice;
+	const auto till = std::min(from + kInSlice, _size);
+	if (!_cachedRanges.intersects(from, till)) {
+		slice.flags |= Flag::LoadedFromCache;
+	}
+}
+
 void Reader::Slices::checkSliceFullLoaded(int sliceNumber) {
 	if (!sliceNumber && !isFullInHeader()) {
 		return;
@@ -537,11 +702,17 @@ void Reader::Slices::processPart(
 		}
 	}
 	const auto index = offset / kInSlice;
-	_data[index].addPart(offset - index * kInSlice, std::move(bytes));
+	const auto local = offset - index * kInSlice;
+	if (_data[index].parts.contains(local)) {
+		// Received while the same part was being read from cache.
+		return;
+	}
+	_data[index].addPart(local, std::move(bytes));
 	checkSliceFullLoaded(index + 1);
 }
 
-auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
+auto Reader::Slices::fill(int offset, bytes::span buffer, int preloadParts)
+-> FillResult {
 	Expects(!buffer.empty());
 	Expects(offset >= 0 && offset < _size);
 	Expects(offset + buffer.size() <= _size);
@@ -555,7 +726,7 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 		Assert(waitingForHeaderCache());
 		return {};
 	} else if (isFullInHeader()) {
-		return fillFromHeader(offset, buffer);
+		return fillFromHeader(offset, buffer, preloadParts);
 	}
 
 	auto result = FillResult();
@@ -574,12 +745,19 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 	const auto handlePrepareResult = [&](
 			int sliceIndex,
 			const Slice::PrepareFillResult &prepared) {
-		if (cacheNotLoaded(sliceIndex)) {
+		// While the slice is read from cache we can already request
+		// the parts that we know were never put to cache.
+		const auto waiting = cacheNotLoaded(sliceIndex);
+		if (waiting && !_cachedRangesKnown) {
 			return;
 		}
 		for (const auto offset : prepared.offsetsFromLoader.values()) {
 			const auto full = offset + sliceIndex * kInSlice;
-			if (offset < kInSlice && full < _size) {
+			if (offset < kInSlice
+				&& full < _size
+				&& (!waiting || !_cachedRanges.contains(
+					full,
+					std::min(full + kPartSize, _size)))) {
 				result.offsetsFromLoader.add(full);
 			}
 		}
@@ -595,14 +773,46 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 	const auto firstTill = std::min(kInSlice, till - fromSlice * kInSlice);
 	const auto secondFrom = 0;
 	const auto secondTill = till - (fromSlice + 1) * kInSlice;
-	const auto first = _data[fromSlice].prepareFill(firstFrom, firstTill);
+	skipReadingEmptyCache(fromSlice);
+	if (fromSlice + 1 < tillSlice) {
+		skipReadingEmptyCache(fromSlice + 1);
+	}
+	const auto first = _data[fromSlice].prepareFill(
+		firstFrom,
+		firstTill,
+		preloadParts);
 	const auto second = (fromSlice + 1 < tillSlice)
-		? _data[fromSlice + 1].prepareFill(secondFrom, secondTill)
+		? _data[fromSlice + 1].prepareFill(
+			secondFrom,
+			secondTill,
+			preloadParts)
 		: Slice::PrepareFillResult();
 	handlePrepareResult(fromSlice, first);
 	if (fromSlice + 1 < tillSlice) {
 		handlePrepareResult(fromSlice + 1, second);
 	}
+
+	// Continue preloading in the next slice if it doesn't wait for cache.
+	const auto lastSlice = tillSlice - 1;
+	const auto preloadTill = ((till + kPartSize - 1) / kPartSize
+		+ preloadParts) * kPartSize;
+	const auto nextSlice = lastSlice + 1;
+	if (preloadTill > nextSlice * kInSlice) {
+		skipReadingEmptyCache(nextSlice);
+	}
+	if (preloadTill > nextSlice * kInSlice
+		&& nextSlice < int(_data.size())
+		&& !cacheNotLoaded(nextSlice)) {
+		const auto offsets = _data[nextSlice].offsetsFromLoader(
+			0,
+			std::min(preloadTill - nextSlice * kInSlice, kInSlice));
+		for (const auto offset : offsets.values()) {
+			const auto full = offset + nextSlice * kInSlice;
+			if (full < _size) {
+				result.offsetsFromLoader.add(full);
+			}
+		}
+	}
 	if (first.ready && second.ready) {
 		markSliceUsed(fromSlice);
 		CopyLoaded(
@@ -629,13 +839,16 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 	return result;
 }
 
-auto Reader::Slices::fillFromHeader(int offset, bytes::span buffer)
+auto Reader::Slices::fillFromHeader(
+		int offset,
+		bytes::span buffer,
+		int preloadParts)
 -> FillResult {
 	auto result = FillResult();
 	const auto from = offset;
 	const auto till = int(offset + buffer.size());
 
-	const auto prepared = _header.prepareFill(from, till);
+	const auto prepared = _header.prepareFill(from, till, preloadParts);
 	for (const auto full : prepared.offsetsFromLoader.values()) {
 		if (full < _size) {
 			result.offsetsFromLoader.add(full);
@@ -750,6 +963,12 @@ Reader::SerializedSlice Reader::Slices::serializeAndUnloadSlice(
 	const auto count = slice.parts.size();
 	Assert(count > 0);
 
+	const auto base = sliceNumber ? (sliceNumber - 1) * kInSlice : 0;
+	rememberCachedParts(slice, base);
+	if (writeHeaderAndSlice) {
+		rememberCachedParts(_data[0], 0);
+	}
+
 	auto result = SerializedSlice();
 	result.number = sliceNumber;
 
@@ -856,6 +1075,7 @@ Reader::Reader(
 		if (_attachedDownloader) {
 			_partsForDownloader.fire_copy(part);
 		}
+		refreshLoaderPriority();
 		if (_streamingActive) {
 			_loadedParts.emplace(std::move(part));
 		}
@@ -867,6 +1087,7 @@ Reader::Reader(
 
 	if (_cacheHelper) {
 		readFromCache(0);
+		readCachedRanges();
 	}
 }
 
@@ -1106,12 +1327,47 @@ void Reader::setLoaderPriority(int priority) {
 
 void Reader::refreshLoaderPriority() {
 	_loader->setPriority(_streamingActive ? _realPriority : 0);
+	_downloadRate.store(_loader->bandwidth(), std::memory_order_relaxed);
 }
 
 bool Reader::isRemoteLoader() const {
 	return _loader->baseCacheKey().has_value();
 }
 
+int64 Reader::bitrate() const {
+	return _bitrate.load(std::memory_order_relaxed);
+}
+
+int64 Reader::downloadRate() const {
+	return _downloadRate.load(std::memory_order_relaxed);
+}
+
+void Reader::setBitrate(int64 bitrate) {
+	_bitrate.store(bitrate, std::memory_order_relaxed);
+}
+
+int64 Reader::memoryUsageLimit() const {
+	// The header and kSlicesInMemory slices are the most we keep loaded.
+	return std::min(
+		int64(size()),
+		int64(kMaxOnlyInHeader) + int64(kSlicesInMemory) * kInSlice);
+}
+
+int Reader::preloadPartsAhead() const {
+	const auto bitrate = this->bitrate();
+	const auto rate = downloadRate();
+	if (!bitrate && !rate) {
+		return kPreloadPartsAhead;
+	}
+	const auto bytes = std::max(
+		bitrate * kPreloadBitrateTime / 1000,
+		rate * kPreloadDownloadTime / 1000);
+	return std::clamp(
+		int((bytes + kPartSize - 1) / kPartSize),
+		kPreloadPartsAheadMin,
+		kPreloadPartsAheadMax);
+}
+
 std::shared_ptr<Reader::CacheHelper> Reader::InitCacheHelper(
 		std::optional<Storage::Cache::Key> baseKey) {
 	if (!baseKey) {
@@ -1128,13 +1384,58 @@ void Reader::readFromCache(int sliceNumber) {
 	if (sliceNumber == 1 && _slices.isGoodHeader()) {
 		return readFromCache(0);
 	}
-	const auto size = _loader->size();
 	const auto key = _cacheHelper->key(sliceNumber);
+	auto keys = std::vector<Storage::Cache::Key>();
+	const auto count = _slices.requestSliceSizesCount();
+	for (auto i = 0; i != count; ++i) {
+		keys.push_back(_cacheHelper->key(i + 1));
+	}
+	_cache->getWithSizes(
+		key,
+		std::move(keys),
+		cacheResultHandler(sliceNumber));
+}
+
+void Reader::readFromCache(const std::vector<int> &sliceNumbers) {
+	Expects(_cacheHelper != nullptr);
+
+	const auto has = [&](int sliceNumber) {
+		return ranges::find(sliceNumbers, sliceNumber) != end(sliceNumbers);
+	};
+	const auto single = (sliceNumbers.size() < 2)
+		|| (_slices.requestSliceSizesCount() > 0)
+		|| has(0)
+		|| (_slices.isGoodHeader() && has(1));
+	if (single) {
+		for (const auto sliceNumber : sliceNumbers) {
+			readFromCache(sliceNumber);
+		}
+		return;
+	}
+	auto keys = ranges::view::all(
+		sliceNumbers
+	) | ranges::view::transform([&](int sliceNumber) {
+		return _cacheHelper->key(sliceNumber);
+	}) | ranges::to_vector;
+	auto handlers = ranges::view::all(
+		sliceNumbers
+	) | ranges::view::transform([&](int sliceNumber) {
+		return cacheResultHandler(sliceNumber);
+	}) | ranges::to_vector;
+	_cache->getMany(std::move(keys), [handlers = std::move(handlers)](
+			std::vector<Storage::Cache::Database::TaggedValue> &&values) {
+		for (auto i = 0; i != values.size(); ++i) {
+			handlers[i](std::move(values[i].bytes), {});
+		}
+	});
+}
+
+auto Reader::cacheResultHandler(int sliceNumber)
+-> Fn<void(QByteArray&&, std::vector<int>&&)> {
+	const auto size = _loader->size();
 	const auto cache = std::weak_ptr<CacheHelper>(_cacheHelper);
 	const auto weak = base::make_weak(this);
-	const auto ready = [=](
-			QByteArray &&result,
-			std::vector<int> &&sizes = {}) {
+	return [=](QByteArray &&result, std::vector<int> &&sizes) {
 		crl::async([
 			=,
 			result = std::move(result),
@@ -1162,12 +1463,23 @@ void Reader::readFromCache(int sliceNumber) {
 			}
 		});
 	};
-	auto keys = std::vector<Storage::Cache::Key>();
-	const auto count = _slices.requestSliceSizesCount();
-	for (auto i = 0; i != count; ++i) {
-		keys.push_back(_cacheHelper->key(i + 1));
-	}
-	_cache->getWithSizes(key, std::move(keys), ready);
+}
+
+void Reader::readCachedRanges() {
+	Expects(_cacheHelper != nullptr);
+
+	const auto cache = std::weak_ptr<CacheHelper>(_cacheHelper);
+	_cache->get(_cacheHelper->key(kCachedRangesNumber), [=](
+			QByteArray &&result) {
+		if (const auto strong = cache.lock()) {
+			QMutexLocker lock(&strong->mutex);
+			strong->ranges = std::move(result);
+			if (const auto waiting = strong->waiting.load()) {
+				strong->waiting.store(nullptr, std::memory_order_release);
+				waiting->release();
+			}
+		}
+	});
 }
 
 bool Reader::readFromCacheForDownloader(int sliceNumber) {
@@ -1186,6 +1498,12 @@ void Reader::putToCache(SerializedSlice &&slice) {
 	Expects(slice.number >= 0);
 
 	_cache->put(_cacheHelper->key(slice.number), std::move(slice.data));
+	if (auto ranges = _slices.serializeCachedRangesIfChanged()
+		; !ranges.isEmpty()) {
+		_cache->put(
+			_cacheHelper->key(kCachedRangesNumber),
+			std::move(ranges));
+	}
 }
 
 int Reader::size() const {
@@ -1255,15 +1573,16 @@ bool Reader::fill(
 bool Reader::fillFromSlices(int offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
-	auto result = _slices.fill(offset, buffer);
+	const auto span = Logs::TraceSpan("streaming", "fillFromSlices");
+
+	auto result = _slices.fill(offset, buffer, preloadPartsAhead());
 	if (!result.filled && _slices.headerWontBeFilled()) {
 		_streamingError = Error::NotStreamable;
 		return false;
 	}
 
-	for (const auto sliceNumber : result.sliceNumbersFromCache.values()) {
-		readFromCache(sliceNumber);
-	}
+	readFromCache(
+		result.sliceNumbersFromCache.values() | ranges::to_vector);
 
 	if (_cacheHelper && result.toCache.number >= 0) {
 		// If we put to cache the header (number == 0) that means we're in
@@ -1310,8 +1629,13 @@ bool Reader::processCacheResults() {
 	QMutexLocker lock(&_cacheHelper->mutex);
 	auto loaded = base::take(_cacheHelper->results);
 	auto sizes = base::take(_cacheHelper->sizes);
+	auto cachedRanges = base::take(_cacheHelper->ranges);
 	lock.unlock();
 
+	if (cachedRanges) {
+		_slices.processCachedRanges(*cachedRanges);
+	}
+
 	for (auto &[sliceNumber, cachedParts] : _downloaderReadCache) {
 		if (!cachedParts) {
 			const auto i = loaded.find(sliceNumber);
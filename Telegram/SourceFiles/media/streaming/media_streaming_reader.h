@@ -9,9 +9,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/streaming/media_streaming_loader.h"
 #include "base/bytes.h"
+#include "base/flags.h"
 #include "base/weak_ptr.h"
 #include "base/thread_safe_wrap.h"
 
+#include <deque>
+
 namespace Storage {
 class StreamedFileDownloader;
 } // namespace Storage
@@ -42,6 +45,12 @@ public:
 	// Any thread.
 	[[nodiscard]] int size() const;
 	[[nodiscard]] bool isRemoteLoader() const;
+	[[nodiscard]] int64 bitrate() const; // Bytes per second.
+	[[nodiscard]] int64 downloadRate() const; // Bytes per second.
+	void setBitrate(int64 bitrate);
+
+	// Upper bound of the bytes this reader holds in memory.
+	[[nodiscard]] int64 memoryUsageLimit() const;
 
 	// Single thread.
 	[[nodiscard]] bool fill(
@@ -74,7 +83,7 @@ public:
 	~Reader();
 
 private:
-	static constexpr auto kLoadFromRemoteMax = 8;
+	static constexpr auto kLoadFromRemoteMax = 32;
 
 	struct CacheHelper;
 
@@ -91,6 +100,23 @@ private:
 
 	};
 
+	// Merged [from, till) byte ranges, kept for the parts put to cache.
+	class Ranges {
+	public:
+		void add(int from, int till);
+		void add(const Ranges &other);
+		[[nodiscard]] bool contains(int from, int till) const;
+		[[nodiscard]] bool intersects(int from, int till) const;
+
+		[[nodiscard]] QByteArray serialize() const;
+		[[nodiscard]] static std::optional<Ranges> FromSerialized(
+			const QByteArray &serialized);
+
+	private:
+		base::flat_map<int, int> _data; // from -> till
+
+	};
+
 	struct SerializedSlice {
 		int number = -1;
 		QByteArray data;
@@ -123,7 +149,7 @@ private:
 
 		void processCacheData(PartsMap &&data);
 		void addPart(int offset, QByteArray bytes);
-		PrepareFillResult prepareFill(int from, int till);
+		PrepareFillResult prepareFill(int from, int till, int preloadParts);
 
 		// Get up to kLoadFromRemoteMax not loaded parts in from-till range.
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader(
@@ -152,10 +178,15 @@ private:
 
 		void processCacheResult(int sliceNumber, PartsMap &&result);
 		void processCachedSizes(const std::vector<int> &sizes);
+		void processCachedRanges(const QByteArray &serialized);
 		void processPart(int offset, QByteArray &&bytes);
 
-		[[nodiscard]] FillResult fill(int offset, bytes::span buffer);
+		[[nodiscard]] FillResult fill(
+			int offset,
+			bytes::span buffer,
+			int preloadParts);
 		[[nodiscard]] SerializedSlice unloadToCache();
+		[[nodiscard]] QByteArray serializeCachedRangesIfChanged();
 
 		[[nodiscard]] QByteArray partForDownloader(int offset) const;
 		[[nodiscard]] bool readCacheForDownloaderRequired(int offset);
@@ -178,10 +209,13 @@ private:
 			const Slice &slice) const;
 		[[nodiscard]] QByteArray serializeAndUnloadFirstSliceNoHeader();
 		void markSliceUsed(int sliceIndex);
+		void rememberCachedParts(const Slice &slice, int base);
+		void skipReadingEmptyCache(int sliceIndex);
 		[[nodiscard]] bool computeIsGoodHeader() const;
 		[[nodiscard]] FillResult fillFromHeader(
 			int offset,
-			bytes::span buffer);
+			bytes::span buffer,
+			int preloadParts);
 		void unloadSlice(Slice &slice) const;
 		void checkSliceFullLoaded(int sliceNumber);
 		[[nodiscard]] bool checkFullInCache() const;
@@ -193,12 +227,20 @@ private:
 		HeaderMode _headerMode = HeaderMode::Unknown;
 		bool _fullInCache = false;
 
+		Ranges _cachedRanges;
+		bool _cachedRangesKnown = false;
+		bool _cachedRangesChanged = false;
+
 	};
 
 	// 0 is for headerData, slice index = sliceNumber - 1.
 	// returns false if asked for a known-empty downloader slice cache.
 	void readFromCache(int sliceNumber);
+	void readFromCache(const std::vector<int> &sliceNumbers);
+	void readCachedRanges();
 	[[nodiscard]] bool readFromCacheForDownloader(int sliceNumber);
+	[[nodiscard]] auto cacheResultHandler(int sliceNumber)
+		-> Fn<void(QByteArray&&, std::vector<int>&&)>;
 	bool processCacheResults();
 	void putToCache(SerializedSlice &&data);
 
@@ -224,6 +266,7 @@ private:
 	void checkForDownloaderReadyOffsets();
 
 	void refreshLoaderPriority();
+	[[nodiscard]] int preloadPartsAhead() const;
 
 	static std::shared_ptr<CacheHelper> InitCacheHelper(
 		std::optional<Storage::Cache::Key> baseKey);
@@ -236,6 +279,8 @@ private:
 	std::atomic<crl::semaphore*> _waiting = nullptr;
 	std::atomic<crl::semaphore*> _sleeping = nullptr;
 	std::atomic<bool> _stopStreamingAsync = false;
+	std::atomic<int64> _bitrate = 0;
+	std::atomic<int64> _downloadRate = 0;
 	PriorityQueue _loadingOffsets;
 
 	Slices _slices;
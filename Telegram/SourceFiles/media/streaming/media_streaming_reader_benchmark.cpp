@@ -0,0 +1,520 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "media/streaming/media_streaming_reader.h"
+#include "media/streaming/media_streaming_error.h"
+#include "media/streaming/media_streaming_loader.h"
+#include "storage/cache/storage_cache_database.h"
+#include "storage/storage_encryption.h"
+#include "ui/main_queue_processor.h"
+#include "base/timer.h"
+#include <crl/crl.h>
+#include <QtCore/QCoreApplication>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+// Usage: benchmark_streaming [size_mb] [latency_ms] [bandwidth_kb]
+//   [jitter_ms] [bitrate_kb]
+//
+// Plays a scripted pattern of reads and seeks through Reader, which gets
+// the file parts from a simulated network with the given latency, jitter
+// and bandwidth in KB per second. The reads are paced by the bitrate, as
+// the player would do. The second pass repeats the script with the same
+// cache key, so it shows how much of it comes from Storage::Cache.
+//
+// Every run starts from an empty "benchmark_streaming.db" and uses fixed
+// random seeds, so the numbers of different builds are comparable.
+
+namespace Logs {
+
+// The application logs are not started in the benchmark.
+void writeMain(const QString &v) {
+	std::fprintf(stderr, "%s\n", v.toUtf8().constData());
+}
+
+} // namespace Logs
+
+namespace {
+
+using namespace Media::Streaming;
+using Storage::Cache::Database;
+
+constexpr auto kPartSize = Loader::kPartSize;
+constexpr auto kReadSize = 32 * 1024;
+constexpr auto kHeaderSize = 2 * kPartSize;
+constexpr auto kPlaySize = 2 * 1024 * 1024;
+
+const auto kName = QString("benchmark_streaming.db");
+
+const auto kKey = Storage::EncryptionKey(bytes::make_vector(
+	bytes::make_span("\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+").subspan(0, Storage::EncryptionKey::kSize)));
+
+const auto kCacheKey = Storage::Cache::Key{ 0x0000000000000102ULL, 1 };
+
+struct Options {
+	int sizeMegabytes = 32;
+	int latency = 100;
+	int bandwidth = 4096;
+	int jitter = 50;
+	int bitrate = 1024;
+};
+
+Options ParseOptions(int argc, char *argv[]) {
+	auto result = Options();
+	const auto fields = {
+		&result.sizeMegabytes,
+		&result.latency,
+		&result.bandwidth,
+		&result.jitter,
+		&result.bitrate,
+	};
+	auto index = 1;
+	for (const auto field : fields) {
+		if (index < argc) {
+			const auto value = QString::fromLatin1(argv[index++]).toInt();
+			if (value >= 0) {
+				*field = value;
+			}
+		}
+	}
+	if (!result.sizeMegabytes) {
+		result.sizeMegabytes = 1;
+	}
+	if (!result.bandwidth) {
+		result.bandwidth = 1;
+	}
+	if (!result.bitrate) {
+		result.bitrate = 1;
+	}
+	return result;
+}
+
+// Each byte depends on its position, so that the read data is checked.
+char ExpectedByte(int position) {
+	return char((position >> 8) ^ (position * 131));
+}
+
+QByteArray ExpectedBytes(int offset, int size) {
+	auto result = QByteArray(size, Qt::Uninitialized);
+	for (auto i = 0; i != size; ++i) {
+		result[i] = ExpectedByte(offset + i);
+	}
+	return result;
+}
+
+struct LoaderStats {
+	base::flat_set<int> requested;
+	base::flat_set<int> delivered;
+	int requests = 0;
+	int cancels = 0;
+	int64 bytes = 0;
+};
+
+// Requests are sent over a single link: the parts are transferred one by
+// one with the given bandwidth, and each of them arrives with the latency
+// and a random jitter after its transfer is finished.
+class SimulatedLoader final : public Loader, public base::has_weak_ptr {
+public:
+	SimulatedLoader(
+		int size,
+		const Options &options,
+		not_null<LoaderStats*> stats);
+
+	[[nodiscard]] auto baseCacheKey() const
+	-> std::optional<Storage::Cache::Key> override;
+	[[nodiscard]] int size() const override;
+
+	void load(int offset) override;
+	void cancel(int offset) override;
+	void resetPriorities() override;
+	void setPriority(int priority) override;
+	void stop() override;
+	[[nodiscard]] int64 bandwidth() const override;
+
+	void tryRemoveFromQueue() override;
+
+	// Parts will be sent from the main thread.
+	[[nodiscard]] rpl::producer<LoadedPart> parts() const override;
+
+	void attachDownloader(
+		not_null<Storage::StreamedFileDownloader*> downloader) override;
+	void clearAttachedDownloader() override;
+
+private:
+	struct Request {
+		int offset = 0;
+		crl::time arrives = 0;
+	};
+
+	// Main thread.
+	void enqueue(int offset);
+	void remove(int offset);
+	void deliver();
+	void scheduleDelivery();
+
+	const int _size = 0;
+	const crl::time _latency = 0;
+	const crl::time _jitter = 0;
+	const int64 _bandwidth = 0;
+	const not_null<LoaderStats*> _stats;
+
+	std::mt19937 _generator;
+	std::vector<Request> _requests;
+	crl::time _linkFreeAt = 0;
+	crl::time _started = 0;
+	base::Timer _timer;
+	rpl::event_stream<LoadedPart> _parts;
+
+};
+
+SimulatedLoader::SimulatedLoader(
+	int size,
+	const Options &options,
+	not_null<LoaderStats*> stats)
+: _size(size)
+, _latency(options.latency)
+, _jitter(options.jitter)
+, _bandwidth(int64(options.bandwidth) * 1024)
+, _stats(stats)
+, _generator(1)
+, _timer([=] { deliver(); }) {
+}
+
+std::optional<Storage::Cache::Key> SimulatedLoader::baseCacheKey() const {
+	return kCacheKey;
+}
+
+int SimulatedLoader::size() const {
+	return _size;
+}
+
+void SimulatedLoader::load(int offset) {
+	crl::on_main(this, [=] {
+		enqueue(offset);
+	});
+}
+
+void SimulatedLoader::cancel(int offset) {
+	crl::on_main(this, [=] {
+		remove(offset);
+	});
+}
+
+void SimulatedLoader::resetPriorities() {
+}
+
+void SimulatedLoader::setPriority(int priority) {
+}
+
+void SimulatedLoader::stop() {
+	crl::on_main(this, [=] {
+		_requests.clear();
+		_timer.cancel();
+	});
+}
+
+int64 SimulatedLoader::bandwidth() const {
+	const auto elapsed = _started ? (crl::now() - _started) : 0;
+	return (elapsed > 0) ? (_stats->bytes * 1000 / elapsed) : 0;
+}
+
+void SimulatedLoader::tryRemoveFromQueue() {
+}
+
+rpl::producer<LoadedPart> SimulatedLoader::parts() const {
+	return _parts.events();
+}
+
+void SimulatedLoader::attachDownloader(
+		not_null<Storage::StreamedFileDownloader*> downloader) {
+	Unexpected("Downloader attached to a simulated streaming loader.");
+}
+
+void SimulatedLoader::clearAttachedDownloader() {
+	Unexpected("Downloader detached from a simulated streaming loader.");
+}
+
+void SimulatedLoader::enqueue(int offset) {
+	const auto now = crl::now();
+	if (!_started) {
+		_started = now;
+	}
+	const auto size = std::min(kPartSize, _size - offset);
+	const auto transfer = crl::time(size * int64(1000) / _bandwidth);
+	const auto jitter = _jitter
+		? crl::time(_generator() % uint32(_jitter + 1))
+		: crl::time(0);
+	_linkFreeAt = std::max(now, _linkFreeAt) + transfer;
+	_requests.push_back({ offset, _linkFreeAt + _latency + jitter });
+	_stats->requested.emplace(offset);
+	++_stats->requests;
+	scheduleDelivery();
+}
+
+void SimulatedLoader::remove(int offset) {
+	const auto i = ranges::find(_requests, offset, &Request::offset);
+	if (i != end(_requests)) {
+		_requests.erase(i);
+		++_stats->cancels;
+		scheduleDelivery();
+	}
+}
+
+void SimulatedLoader::deliver() {
+	const auto now = crl::now();
+	auto ready = std::vector<int>();
+	for (auto i = begin(_requests); i != end(_requests);) {
+		if (i->arrives <= now) {
+			ready.push_back(i->offset);
+			i = _requests.erase(i);
+		} else {
+			++i;
+		}
+	}
+	for (const auto offset : ready) {
+		const auto size = std::min(kPartSize, _size - offset);
+		auto bytes = ExpectedBytes(offset, size);
+		_stats->bytes += bytes.size();
+		_stats->delivered.emplace(offset);
+		_parts.fire({ offset, std::move(bytes) });
+	}
+	scheduleDelivery();
+}
+
+void SimulatedLoader::scheduleDelivery() {
+	if (_requests.empty()) {
+		_timer.cancel();
+		return;
+	}
+	const auto first = ranges::min_element(
+		_requests,
+		ranges::less(),
+		&Request::arrives);
+	_timer.callOnce(std::max(first->arrives - crl::now(), crl::time(0)));
+}
+
+struct Segment {
+	int from = 0;
+	int till = 0;
+};
+
+// Start of playback, two seeks forward and one back to the played part.
+std::vector<Segment> Script(int size) {
+	const auto segment = [&](int from) {
+		from = std::min(from, size - kPlaySize) / kReadSize * kReadSize;
+		return Segment{ std::max(from, 0), std::min(from + kPlaySize, size) };
+	};
+	return {
+		Segment{ 0, std::min(kHeaderSize + kPlaySize, size) },
+		segment(size / 2),
+		segment(size / 4),
+		segment(kHeaderSize + kPlaySize / 2),
+	};
+}
+
+struct PassResult {
+	crl::time startup = 0;
+	crl::time duration = 0;
+	int stalls = 0;
+	crl::time stalled = 0;
+	base::flat_set<int> read;
+	std::optional<Error> error;
+	bool valid = true;
+};
+
+// Streaming thread, like the File::Context::read() of the player.
+PassResult Play(
+		not_null<Reader*> reader,
+		const std::vector<Segment> &script,
+		int64 bitrate) {
+	auto result = PassResult();
+	auto semaphore = crl::semaphore();
+	auto buffer = bytes::vector(kReadSize);
+	auto header = true;
+	const auto started = crl::now();
+	for (const auto &segment : script) {
+		auto position = crl::now();
+		for (auto offset = segment.from; offset < segment.till;) {
+			const auto size = std::min(kReadSize, segment.till - offset);
+			const auto span = bytes::make_span(buffer).subspan(0, size);
+			const auto requested = crl::now();
+			auto waited = false;
+			while (!reader->fill(offset, span, &semaphore)) {
+				if (const auto error = reader->streamingError()) {
+					result.error = error;
+					return result;
+				}
+				waited = true;
+				semaphore.acquire();
+			}
+			const auto now = crl::now();
+			if (header) {
+				result.startup = now - started;
+			} else if (waited) {
+				++result.stalls;
+				result.stalled += now - requested;
+			}
+			const auto expected = ExpectedBytes(offset, size);
+			if (bytes::compare(span, bytes::make_span(expected)) != 0) {
+				result.valid = false;
+			}
+			for (auto part = offset / kPartSize
+				; part * kPartSize < offset + size
+				; ++part) {
+				result.read.emplace(part * kPartSize);
+			}
+			offset += size;
+
+			if (header && offset >= kHeaderSize) {
+				header = false;
+				reader->setBitrate(bitrate);
+				reader->headerDone();
+			}
+
+			// The playback can't run ahead of the time, a stall delays it.
+			position = std::max(position + size * 1000 / bitrate, now);
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(position - now));
+		}
+	}
+	result.duration = crl::now() - started;
+	return result;
+}
+
+void OnMain(FnMut<void()> callback) {
+	auto semaphore = crl::semaphore();
+	crl::on_main([&] {
+		callback();
+		semaphore.release();
+	});
+	semaphore.acquire();
+}
+
+void Report(
+		const char *name,
+		const PassResult &result,
+		const LoaderStats &stats) {
+	const auto overfetched = ranges::count_if(stats.delivered, [&](
+			int offset) {
+		return !result.read.contains(offset);
+	});
+	const auto fromNetwork = ranges::count_if(result.read, [&](
+			int offset) {
+		return stats.requested.contains(offset);
+	});
+	const auto read = int(result.read.size());
+	const auto hits = read
+		? (double(read - fromNetwork) * 100. / read)
+		: 0.;
+	std::printf(
+		"%-12s startup %6d ms, %3d stalls %7d ms, duration %7d ms\n",
+		name,
+		int(result.startup),
+		result.stalls,
+		int(result.stalled),
+		int(result.duration));
+	std::printf(
+		"%-12s %5d parts read, %5d requested, %4d cancelled, "
+		"%5d over-fetched, %5.1f%% cache hits\n",
+		"",
+		read,
+		stats.requests,
+		stats.cancels,
+		int(overfetched),
+		hits);
+}
+
+void Open(Database &db) {
+	auto semaphore = crl::semaphore();
+	db.open(base::duplicate(kKey), [&](Storage::Cache::Error error) {
+		if (error.type != Storage::Cache::Error::Type::None) {
+			std::printf("Could not open '%s'.\n", kName.toUtf8().data());
+			std::exit(1);
+		}
+		semaphore.release();
+	});
+	semaphore.acquire();
+}
+
+void Clear(Database &db) {
+	auto semaphore = crl::semaphore();
+	db.clear([&](Storage::Cache::Error) { semaphore.release(); });
+	semaphore.acquire();
+}
+
+void Close(Database &db) {
+	auto semaphore = crl::semaphore();
+	db.close([&] { semaphore.release(); });
+	semaphore.acquire();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	QCoreApplication application(argc, argv);
+	Ui::MainQueueProcessor processor;
+
+	const auto options = ParseOptions(argc, argv);
+	std::printf(
+		"size: %d MB, latency: %d ms, bandwidth: %d KB/s, "
+		"jitter: %d ms, bitrate: %d KB/s\n",
+		options.sizeMegabytes,
+		options.latency,
+		options.bandwidth,
+		options.jitter,
+		options.bitrate);
+
+	const auto size = options.sizeMegabytes * 1024 * 1024;
+	const auto script = Script(size);
+	const auto bitrate = int64(options.bitrate) * 1024;
+
+	Database db(kName, Database::Settings());
+	Clear(db);
+	Open(db);
+
+	auto valid = true;
+	auto worker = std::thread([&] {
+		for (const auto name : { "first pass", "second pass" }) {
+			auto stats = LoaderStats();
+			auto reader = std::unique_ptr<Reader>();
+			OnMain([&] {
+				reader = std::make_unique<Reader>(
+					&db,
+					std::make_unique<SimulatedLoader>(size, options, &stats));
+				reader->startStreaming();
+			});
+			const auto result = Play(reader.get(), script, bitrate);
+			OnMain([&] {
+				reader->stopStreaming();
+				reader = nullptr;
+				Report(name, result, stats);
+			});
+			if (result.error) {
+				std::printf("Streaming failed.\n");
+				valid = false;
+				break;
+			} else if (!result.valid) {
+				std::printf("Read data mismatch.\n");
+				valid = false;
+				break;
+			}
+		}
+		crl::on_main([] { QCoreApplication::quit(); });
+	});
+	application.exec();
+	worker.join();
+
+	Close(db);
+	return valid ? 0 : 1;
+}
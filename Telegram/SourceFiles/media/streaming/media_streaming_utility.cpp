@@ -17,6 +17,42 @@ namespace {
 
 constexpr auto kSkipInvalidDataPackets = 10;
 
+[[nodiscard]] AVFrame *TransferHwFrame(
+		Stream &stream,
+		not_null<AVFrame*> frame) {
+	// Download the decoded surface, it will be converted by swscale
+	// straight from the hardware format (usually NV12) to the storage.
+	if (!stream.transferredFrame) {
+		stream.transferredFrame = FFmpeg::MakeFramePointer();
+	}
+	const auto result = stream.transferredFrame.get();
+	const auto error = FFmpeg::AvErrorWrap(
+		av_hwframe_transfer_data(result, frame, 0));
+	FFmpeg::ClearFrameMemory(frame);
+	if (error) {
+		FFmpeg::LogError(qstr("av_hwframe_transfer_data"), error);
+		FFmpeg::ClearFrameMemory(result);
+		return nullptr;
+	}
+	return result;
+}
+
+[[nodiscard]] const QImage &EllipseMask(QSize size) {
+	// Each video track prepares its frames on its own thread.
+	static thread_local auto result = QImage();
+	if (result.size() != size) {
+		result = QImage(size, QImage::Format_ARGB32_Premultiplied);
+		result.fill(Qt::transparent);
+
+		auto p = QPainter(&result);
+		p.setRenderHint(QPainter::Antialiasing);
+		p.setPen(Qt::NoPen);
+		p.setBrush(Qt::white);
+		p.drawEllipse(QRect(QPoint(), size));
+	}
+	return result;
+}
+
 } // namespace
 
 crl::time FramePosition(const Stream &stream) {
@@ -108,6 +144,12 @@ QImage ConvertFrame(
 		QImage storage) {
 	Expects(frame != nullptr);
 
+	if (frame->hw_frames_ctx) {
+		frame = TransferHwFrame(stream, frame);
+		if (!frame) {
+			return QImage();
+		}
+	}
 	const auto frameSize = QSize(frame->width, frame->height);
 	if (frameSize.isEmpty()) {
 		LOG(("Streaming Error: Bad frame size %1,%2"
@@ -261,6 +303,16 @@ void ApplyFrameRounding(QImage &storage, const FrameRequest &request) {
 	if (!(request.corners & RectPart::AllCorners)
 		|| (request.radius == ImageRoundRadius::None)) {
 		return;
+	} else if (request.radius == ImageRoundRadius::Ellipse
+		&& (request.corners & RectPart::AllCorners) == RectPart::AllCorners) {
+		// Blending a ready mask is much cheaper than rasterizing
+		// the antialiased ellipse again for each round video frame.
+		auto p = QPainter(&storage);
+		p.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+		p.drawImage(
+			QRect(QPoint(), storage.size() / storage.devicePixelRatio()),
+			EllipseMask(storage.size()));
+		return;
 	}
 	Images::prepareRound(storage, request.radius, request.corners);
 }
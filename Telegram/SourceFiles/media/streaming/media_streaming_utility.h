@@ -41,6 +41,7 @@ struct Stream {
 	int rotation = 0;
 	AVRational aspect = FFmpeg::kNormalAspect;
 	FFmpeg::SwscalePointer swscale;
+	FFmpeg::FramePointer transferredFrame;
 };
 
 [[nodiscard]] crl::time FramePosition(const Stream &stream);
@@ -58,6 +59,7 @@ struct Stream {
 	AVFrame *frame,
 	QSize resize,
 	QImage storage);
+void ApplyFrameRounding(QImage &storage, const FrameRequest &request);
 [[nodiscard]] QImage PrepareByRequest(
 	const QImage &original,
 	int rotation,
@@ -1021,6 +1021,9 @@ void VideoTrack::PrepareFrameByRequests(
 		int rotation) {
 	Expects(!frame->original.isNull());
 
+	if (PrepareFrameByCopy(frame, rotation)) {
+		return;
+	}
 	const auto begin = frame->prepared.begin();
 	const auto end = frame->prepared.end();
 	for (auto i = begin; i != end; ++i) {
@@ -1044,6 +1047,45 @@ void VideoTrack::PrepareFrameByRequests(
 	}
 }
 
+bool VideoTrack::PrepareFrameByCopy(
+		not_null<Frame*> frame,
+		int rotation) {
+	// The original was converted right to the requested size, so if
+	// it only needs rounding we copy it instead of painting it again.
+	// The original itself is left untouched for other requests.
+	if (frame->prepared.size() != 1 || rotation != 0) {
+		return false;
+	}
+	auto &prepared = frame->prepared.begin()->second;
+	const auto &request = prepared.request;
+	if (request.resize != request.outer
+		|| request.outer != frame->original.size()
+		|| GoodForRequest(frame->original, rotation, request)) {
+		return false;
+	}
+	const auto &original = frame->original;
+	auto &storage = prepared.image;
+	if (!FFmpeg::GoodStorageForFrame(storage, original.size())) {
+		storage = FFmpeg::CreateFrameStorage(original.size());
+	}
+	const auto fromPerLine = original.bytesPerLine();
+	const auto toPerLine = storage.bytesPerLine();
+	const auto lineSize = original.width() * 4;
+	auto from = original.bits();
+	auto to = storage.bits();
+	if (fromPerLine == toPerLine) {
+		memcpy(to, from, fromPerLine * original.height());
+	} else {
+		for (auto y = 0, height = original.height(); y != height; ++y) {
+			memcpy(to, from, lineSize);
+			from += fromPerLine;
+			to += toPerLine;
+		}
+	}
+	ApplyFrameRounding(storage, request);
+	return true;
+}
+
 bool VideoTrack::IsDecoded(not_null<const Frame*> frame) {
 	return (frame->position != kTimeUnknown)
 		&& (frame->displayed == kTimeUnknown);
@@ -141,6 +141,9 @@ private:
 	};
 
 	static void PrepareFrameByRequests(not_null<Frame*> frame, int rotation);
+	[[nodiscard]] static bool PrepareFrameByCopy(
+		not_null<Frame*> frame,
+		int rotation);
 	[[nodiscard]] static bool IsDecoded(not_null<const Frame*> frame);
 	[[nodiscard]] static bool IsRasterized(not_null<const Frame*> frame);
 	[[nodiscard]] static bool IsStale(
@@ -49,6 +49,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 #include "layout.h"
 #include "storage/file_download.h"
+#include "storage/cache/storage_cache_database.h"
 #include "calls/calls_instance.h"
 #include "facades.h"
 #include "app.h"
@@ -2334,6 +2335,7 @@ void OverlayWidget::restartAtSeekPosition(crl::time position) {
 	auto options = Streaming::PlaybackOptions();
 	options.position = position;
 	options.audioId = AudioMsgId(_doc, _msgid);
+	options.hwAllowed = Core::App().settings().hardwareAcceleratedVideo();
 	if (!_streamed->withSound) {
 		options.mode = Streaming::Mode::Video;
 		options.loop = true;
@@ -3180,13 +3182,25 @@ bool OverlayWidget::moveToNext(int delta) {
 		return false;
 	}
 	auto newIndex = *_index + delta;
-	return moveToEntity(entityByIndex(newIndex));
+	const auto direction = (delta > 0) ? 1 : -1;
+	_navigationStreak = (direction == _navigationDirection)
+		? (_navigationStreak + 1)
+		: 1;
+	_navigationDirection = direction;
+	if (!moveToEntity(entityByIndex(newIndex), direction)) {
+		_navigationDirection = _navigationStreak = 0;
+		return false;
+	}
+	return true;
 }
 
 bool OverlayWidget::moveToEntity(const Entity &entity, int preloadDelta) {
 	if (!entity.data && !entity.item) {
 		return false;
 	}
+	if (!preloadDelta) {
+		_navigationDirection = _navigationStreak = 0;
+	}
 	if (const auto item = entity.item) {
 		setContext(item);
 	} else if (_peer) {
@@ -3211,9 +3225,21 @@ void OverlayWidget::preloadData(int delta) {
 	if (!_index) {
 		return;
 	}
-	auto from = *_index + (delta ? delta : -1);
-	auto till = *_index + (delta ? delta * kPreloadCount : 1);
-	if (from > till) std::swap(from, till);
+
+	// Without a direction we preload one entity on each side, while
+	// each move in the same direction looks one entity further ahead.
+	const auto ahead = delta
+		? std::min(_navigationStreak + 1, kPreloadCount)
+		: 1;
+	auto indices = std::vector<int>();
+	if (delta != 0) {
+		for (auto i = 1; i <= ahead; ++i) {
+			indices.push_back(*_index + delta * i);
+		}
+	} else {
+		indices.push_back(*_index - 1);
+		indices.push_back(*_index + 1);
+	}
 
 	if (delta != 0) {
 		auto forgetIndex = *_index - delta * 2;
@@ -3225,7 +3251,13 @@ void OverlayWidget::preloadData(int delta) {
 		}
 	}
 
-	for (auto index = from; index != till; ++index) {
+	if (delta != 0) {
+		prefetchCache(
+			delta,
+			(delta > 0) ? (*_index + ahead + 1) : (*_index - ahead));
+	}
+
+	for (const auto index : indices) {
 		auto entity = entityByIndex(index);
 		if (auto photo = base::get_if<not_null<PhotoData*>>(&entity.data)) {
 			(*photo)->download(fileOrigin());
@@ -3242,6 +3274,32 @@ void OverlayWidget::preloadData(int delta) {
 	}
 }
 
+void OverlayWidget::prefetchCache(int delta, int edge) {
+	// Warm up the cache for the entities just after the preloaded ones.
+	auto keys = std::vector<Storage::Cache::Key>();
+	auto owner = (Data::Session*)nullptr;
+	const auto add = [&](Image *image) {
+		if (image && !image->loaded()) {
+			if (const auto key = image->cacheKey()) {
+				keys.push_back(*key);
+			}
+		}
+	};
+	for (auto i = 0; i != kPreloadCount; ++i) {
+		const auto entity = entityByIndex(edge + (delta > 0 ? i : -1 - i));
+		if (auto photo = base::get_if<not_null<PhotoData*>>(&entity.data)) {
+			add((*photo)->large());
+			owner = &(*photo)->owner();
+		} else if (auto document = base::get_if<not_null<DocumentData*>>(&entity.data)) {
+			add((*document)->thumbnail());
+			owner = &(*document)->owner();
+		}
+	}
+	if (owner && !keys.empty()) {
+		owner->cache().prefetch(std::move(keys));
+	}
+}
+
 void OverlayWidget::mousePressEvent(QMouseEvent *e) {
 	updateOver(e->pos());
 	if (_menu || !_receiveMouse) return;
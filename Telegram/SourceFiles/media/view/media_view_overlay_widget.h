@@ -183,6 +183,7 @@ private:
 	void moveToScreen(bool force = false);
 	bool moveToNext(int delta);
 	void preloadData(int delta);
+	void prefetchCache(int delta, int edge);
 
 	Entity entityForUserPhotos(int index) const;
 	Entity entityForSharedMedia(int index) const;
@@ -413,6 +414,10 @@ private:
 
 	mtpRequestId _loadRequest = 0;
 
+	// Recent moves in the same direction preload more entities ahead.
+	int _navigationDirection = 0;
+	int _navigationStreak = 0;
+
 	OverState _over = OverNone;
 	OverState _down = OverNone;
 	QPoint _lastAction, _lastMouseMovePos;
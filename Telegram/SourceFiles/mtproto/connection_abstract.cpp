@@ -79,9 +79,7 @@ ConnectionPointer::~ConnectionPointer() {
 
 mtpBuffer AbstractConnection::prepareSecurePacket(
 		uint64 keyId,
-		MTPint128 msgKey,
-		uint32 size) const {
-	auto result = mtpBuffer();
+		uint32 size) {
 	constexpr auto kTcpPrefixInts = 2;
 	constexpr auto kAuthKeyIdPosition = kTcpPrefixInts;
 	constexpr auto kAuthKeyIdInts = 2;
@@ -92,13 +90,31 @@ mtpBuffer AbstractConnection::prepareSecurePacket(
 		+ kAuthKeyIdInts
 		+ kMessageKeyInts;
 	constexpr auto kTcpPostfixInts = 4;
+	static_assert(kMessageKeyPosition == kSecurePacketKeyPosition);
+	static_assert(kPrefixInts == kSecurePacketDataPosition);
+
+	auto result = base::take(_recycledPacket);
 	result.reserve(kPrefixInts + size + kTcpPostfixInts);
-	result.resize(kPrefixInts);
+	result.resize(kPrefixInts + size);
 	*reinterpret_cast<uint64*>(&result[kAuthKeyIdPosition]) = keyId;
-	*reinterpret_cast<MTPint128*>(&result[kMessageKeyPosition]) = msgKey;
 	return result;
 }
 
+void AbstractConnection::SetSecurePacketKey(
+		mtpBuffer &packet,
+		MTPint128 msgKey) {
+	Expects(packet.size() > kSecurePacketDataPosition);
+
+	*reinterpret_cast<MTPint128*>(&packet[kSecurePacketKeyPosition]) = msgKey;
+}
+
+void AbstractConnection::recyclePacket(mtpBuffer &&packet) {
+	if (packet.capacity() > _recycledPacket.capacity()) {
+		_recycledPacket = std::move(packet);
+		_recycledPacket.resize(0);
+	}
+}
+
 gsl::span<const mtpPrime> AbstractConnection::parseNotSecureResponse(
 		const mtpBuffer &buffer) const {
 	const auto answer = buffer.data();
@@ -116,10 +116,15 @@ public:
 	[[nodiscard]] mtpBuffer prepareNotSecurePacket(
 		const Request &request,
 		mtpMsgId newId) const;
-	[[nodiscard]] mtpBuffer prepareSecurePacket(
+
+	// The packet has the prefix and size ints for the data, that should
+	// be filled and encrypted in place, and capacity for the postfix.
+	static constexpr auto kSecurePacketKeyPosition = 4;
+	static constexpr auto kSecurePacketDataPosition = 8;
+	[[nodiscard]] virtual mtpBuffer prepareSecurePacket(
 		uint64 keyId,
-		MTPint128 msgKey,
-		uint32 size) const;
+		uint32 size);
+	static void SetSecurePacketKey(mtpBuffer &packet, MTPint128 msgKey);
 
 	[[nodiscard]] gsl::span<const mtpPrime> parseNotSecureResponse(
 		const mtpBuffer &buffer) const;
@@ -149,10 +154,14 @@ protected:
 	[[nodiscard]] std::optional<MTPResPQ> readPQFakeReply(
 		const mtpBuffer &buffer) const;
 
+	// Keeps the memory of a sent packet for the next secure packet.
+	void recyclePacket(mtpBuffer &&packet);
+
 private:
 	[[nodiscard]] uint32 extendedNotSecurePadding() const;
 
 	uint64 _sentEncryptedWithKeyId = 0;
+	mtpBuffer _recycledPacket;
 
 };
 
@@ -197,6 +197,14 @@ void ResolvingConnection::sendData(mtpBuffer &&buffer) {
 	_child->sendData(std::move(buffer));
 }
 
+mtpBuffer ResolvingConnection::prepareSecurePacket(
+		uint64 keyId,
+		uint32 size) {
+	Expects(_child != nullptr);
+
+	return _child->prepareSecurePacket(keyId, size);
+}
+
 bool ResolvingConnection::requiresExtendedPadding() const {
 	Expects(_child != nullptr);
 
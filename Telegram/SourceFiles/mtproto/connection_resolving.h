@@ -27,6 +27,7 @@ public:
 	crl::time pingTime() const override;
 	crl::time fullConnectTimeout() const override;
 	void sendData(mtpBuffer &&buffer) override;
+	mtpBuffer prepareSecurePacket(uint64 keyId, uint32 size) override;
 	void disconnectFromServer() override;
 	void connectToServer(
 		const QString &address,
@@ -8,6 +8,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/connection_tcp.h"
 
 #include "mtproto/details/mtproto_abstract_socket.h"
+#include "mtproto/details/mtproto_buffer_pool.h"
+#include "mtproto/mtp_instance.h"
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
@@ -244,6 +246,7 @@ TcpConnection::TcpConnection(
 	const ProxyData &proxy)
 : AbstractConnection(thread, proxy)
 , _instance(instance)
+, _buffers(instance->bufferPool())
 , _checkNonce(rand_value<MTPint128>()) {
 }
 
@@ -251,28 +254,41 @@ ConnectionPointer TcpConnection::clone(const ProxyData &proxy) {
 	return ConnectionPointer::New<TcpConnection>(_instance, thread(), proxy);
 }
 
+bytes::span TcpConnection::currentBuffer() {
+	return _usingLargeBuffer
+		? bytes::make_span(_largeBuffer)
+		: bytes::make_span(_smallBuffer);
+}
+
+void TcpConnection::releaseLargeBuffer() {
+	if (!_largeBuffer.isEmpty()) {
+		_buffers->release(base::take(_largeBuffer));
+	}
+}
+
 void TcpConnection::ensureAvailableInBuffer(int amount) {
-	auto &buffer = _usingLargeBuffer ? _largeBuffer : _smallBuffer;
-	const auto full = bytes::make_span(buffer).subspan(
-		_offsetBytes);
+	const auto full = currentBuffer().subspan(_offsetBytes);
 	if (full.size() >= amount) {
 		return;
 	}
 	const auto read = full.subspan(0, _readBytes);
-	if (amount <= _smallBuffer.size()) {
+	if (amount <= int(_smallBuffer.size())) {
 		if (_usingLargeBuffer) {
 			bytes::copy(_smallBuffer, read);
 			_usingLargeBuffer = false;
-			_largeBuffer.clear();
+			releaseLargeBuffer();
 		} else {
 			bytes::move(_smallBuffer, read);
 		}
-	} else if (amount <= _largeBuffer.size()) {
+	} else if (amount <= int(_largeBuffer.size() * sizeof(mtpPrime))) {
 		Assert(_usingLargeBuffer);
-		bytes::move(_largeBuffer, read);
+		bytes::move(bytes::make_span(_largeBuffer), read);
 	} else {
-		auto enough = bytes::vector(amount);
-		bytes::copy(enough, read);
+		const auto ints = (amount + int(sizeof(mtpPrime)) - 1)
+			/ int(sizeof(mtpPrime));
+		auto enough = _buffers->acquire(ints);
+		bytes::copy(bytes::make_span(enough), read);
+		releaseLargeBuffer();
 		_largeBuffer = std::move(enough);
 		_usingLargeBuffer = true;
 	}
@@ -297,8 +313,7 @@ void TcpConnection::socketRead() {
 			: (kSmallBufferSize - _offsetBytes - _readBytes);
 		Assert(readLimit > 0);
 
-		auto &buffer = _usingLargeBuffer ? _largeBuffer : _smallBuffer;
-		const auto full = bytes::make_span(buffer).subspan(_offsetBytes);
+		const auto full = currentBuffer().subspan(_offsetBytes);
 		const auto free = full.subspan(_readBytes);
 		const auto readCount = _socket->read(free.subspan(0, readLimit));
 		if (readCount > 0) {
@@ -317,7 +332,7 @@ void TcpConnection::socketRead() {
 					}
 
 					_usingLargeBuffer = false;
-					_largeBuffer.clear();
+					releaseLargeBuffer();
 					_offsetBytes = _readBytes = 0;
 				} else {
 					TCP_LOG(("TCP Info: not enough %1 for packet! read %2"
@@ -400,7 +415,27 @@ mtpBuffer TcpConnection::parsePacket(bytes::const_span bytes) {
 		}
 		return mtpBuffer(1, ints[0]);
 	}
-	auto result = mtpBuffer(ints.size());
+	const auto large = bytes::make_span(_largeBuffer);
+	const auto inLargeBuffer = _usingLargeBuffer
+		&& (packet.data() >= large.data())
+		&& (packet.data() + packet.size() <= large.data() + large.size());
+	if (inLargeBuffer) {
+		// The large buffer holds only this packet, hand it over as it is.
+		const auto offset = packet.data() - large.data();
+		const auto size = ints.size();
+		auto result = base::take(_largeBuffer);
+		if (offset > 0) {
+			memmove(
+				result.data(),
+				reinterpret_cast<const char*>(result.constData()) + offset,
+				size * sizeof(mtpPrime));
+		}
+		result.resize(size);
+		return result;
+	}
+	auto result = (packet.size() >= BufferPool::kMinPooledSize)
+		? _buffers->acquire(ints.size())
+		: mtpBuffer(ints.size());
 	memcpy(result.data(), ints.data(), ints.size() * sizeof(mtpPrime));
 	return result;
 }
@@ -446,6 +481,8 @@ void TcpConnection::sendData(mtpBuffer &&buffer) {
 	TCP_LOG(("TCP Info: write packet %1 bytes").arg(bytes.size()));
 	aesCtrEncrypt(bytes, _sendKey, &_sendState);
 	_socket->write(connectionStartPrefix, bytes);
+
+	recyclePacket(std::move(buffer));
 }
 
 bytes::const_span TcpConnection::prepareConnectionStartPrefix(
@@ -586,7 +623,7 @@ void TcpConnection::socketPacket(bytes::const_span bytes) {
 	Expects(_socket != nullptr);
 
 	// old quickack?..
-	const auto data = parsePacket(bytes);
+	auto data = parsePacket(bytes);
 	if (data.size() == 1) {
 		if (data[0] != 0) {
 			emit error(data[0]);
@@ -596,7 +633,7 @@ void TcpConnection::socketPacket(bytes::const_span bytes) {
 	//} else if (data.size() == 2) {
 		// new quickack?..
 	} else if (_status == Status::Ready) {
-		_receivedQueue.push_back(data);
+		_receivedQueue.push_back(std::move(data));
 		emit receivedData();
 	} else if (_status == Status::Waiting) {
 		if (const auto res_pq = readPQFakeReply(data)) {
@@ -14,6 +14,7 @@ namespace MTP {
 namespace details {
 
 class AbstractSocket;
+class BufferPool;
 
 class TcpConnection : public AbstractConnection {
 public:
@@ -62,12 +63,15 @@ private:
 
 	mtpBuffer parsePacket(bytes::const_span bytes);
 	void ensureAvailableInBuffer(int amount);
+	[[nodiscard]] bytes::span currentBuffer();
+	void releaseLargeBuffer();
 	static uint32 fourCharsToUInt(char ch1, char ch2, char ch3, char ch4) {
 		char ch[4] = { ch1, ch2, ch3, ch4 };
 		return *reinterpret_cast<uint32*>(ch);
 	}
 
 	const not_null<Instance*> _instance;
+	const std::shared_ptr<BufferPool> _buffers;
 	std::unique_ptr<AbstractSocket> _socket;
 	bool _connectionStarted = false;
 
@@ -75,7 +79,7 @@ private:
 	int _readBytes = 0;
 	int _leftBytes = 0;
 	bytes::vector _smallBuffer;
-	bytes::vector _largeBuffer;
+	mtpBuffer _largeBuffer; // Taken from _buffers, holds a single packet.
 	bool _usingLargeBuffer = false;
 
 	uchar _sendKey[CTRState::KeySize];
@@ -73,16 +73,21 @@ public:
 	}
 
 	void unlock() {
-		_lock.unlock();
+		if (!_unlocked) {
+			_unlocked = true;
+			_that->publishSnapshot();
+			_lock.unlock();
+		}
 	}
 
 	~WriteLocker() {
-		_that->computeCdnDcIds();
+		unlock();
 	}
 
 private:
 	not_null<DcOptions*> _that;
 	QWriteLocker _lock;
+	bool _unlocked = false;
 
 };
 
@@ -101,7 +106,8 @@ private:
 
 };
 
-DcOptions::DcOptions() {
+DcOptions::DcOptions()
+: _snapshot(std::make_shared<Snapshot>()) {
 	constructFromBuiltIn();
 }
 
@@ -396,6 +402,17 @@ QByteArray DcOptions::serialize() const {
 		}
 	}
 
+	// Preferred endpoints.
+	size += sizeof(qint32);
+	for (const auto &[dcId, list] : _preferred) {
+		for (const auto &endpoint : list) {
+			// dcId + protocol + port
+			size += sizeof(qint32) + sizeof(qint32) + sizeof(qint32);
+			size += Serialize::stringSize(endpoint.network);
+			size += sizeof(qint32) + endpoint.ip.size();
+		}
+	}
+
 	constexpr auto kVersion = 1;
 
 	auto result = QByteArray();
@@ -431,6 +448,23 @@ QByteArray DcOptions::serialize() const {
 				<< Serialize::bytes(key.n)
 				<< Serialize::bytes(key.e);
 		}
+
+		// Preferred endpoints.
+		auto preferredCount = 0;
+		for (const auto &[dcId, list] : _preferred) {
+			preferredCount += list.size();
+		}
+		stream << qint32(preferredCount);
+		for (const auto &[dcId, list] : _preferred) {
+			for (const auto &endpoint : list) {
+				stream << qint32(dcId)
+					<< endpoint.network
+					<< qint32(endpoint.protocol)
+					<< qint32(endpoint.port)
+					<< qint32(endpoint.ip.size());
+				stream.writeRawData(endpoint.ip.data(), endpoint.ip.size());
+			}
+		}
 	}
 	return result;
 }
@@ -525,6 +559,39 @@ void DcOptions::constructFromSerialized(const QByteArray &serialized) {
 			}
 		}
 	}
+
+	// Read preferred endpoints
+	_preferred.clear();
+	if (!stream.atEnd()) {
+		auto count = qint32(0);
+		stream >> count;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("MTP Error: Bad data for preferred endpoints in DcOptions::constructFromSerialized()"));
+			return;
+		}
+
+		for (auto i = 0; i != count; ++i) {
+			auto endpoint = PreferredEndpoint();
+			qint32 dcId = 0, protocol = 0, port = 0, ipSize = 0;
+			stream >> dcId >> endpoint.network >> protocol >> port >> ipSize;
+
+			constexpr auto kMaxIpSize = 45;
+			if (stream.status() != QDataStream::Ok
+				|| ipSize <= 0
+				|| ipSize > kMaxIpSize
+				|| protocol < 0
+				|| protocol >= Variants::ProtocolCount) {
+				LOG(("MTP Error: Bad data for preferred endpoint inside DcOptions::constructFromSerialized()"));
+				_preferred.clear();
+				return;
+			}
+			endpoint.ip = std::string(ipSize, ' ');
+			stream.readRawData(endpoint.ip.data(), ipSize);
+			endpoint.protocol = static_cast<Variants::Protocol>(protocol);
+			endpoint.port = port;
+			_preferred[dcId].push_back(std::move(endpoint));
+		}
+	}
 }
 
 rpl::producer<DcId> DcOptions::changed() const {
@@ -536,17 +603,15 @@ rpl::producer<> DcOptions::cdnConfigChanged() const {
 }
 
 std::vector<DcId> DcOptions::configEnumDcIds() const {
+	const auto current = snapshot();
 	auto result = std::vector<DcId>();
-	{
-		ReadLocker lock(this);
-		result.reserve(_data.size());
-		for (auto &item : _data) {
-			const auto dcId = item.first;
-			Assert(!item.second.empty());
-			if (!isCdnDc(item.second.front().flags)
-				&& !isTemporaryDcId(dcId)) {
-				result.push_back(dcId);
-			}
+	result.reserve(current->data.size());
+	for (auto &item : current->data) {
+		const auto dcId = item.first;
+		Assert(!item.second.empty());
+		if (!isCdnDc(item.second.front().flags)
+			&& !isTemporaryDcId(dcId)) {
+			result.push_back(dcId);
 		}
 	}
 	ranges::sort(result);
@@ -557,12 +622,13 @@ DcType DcOptions::dcType(ShiftedDcId shiftedDcId) const {
 	if (isTemporaryDcId(shiftedDcId)) {
 		return DcType::Temporary;
 	}
-	ReadLocker lock(this);
-	if (_cdnDcIds.find(BareDcId(shiftedDcId)) != _cdnDcIds.cend()) {
+	const auto current = snapshot();
+	const auto dcId = BareDcId(shiftedDcId);
+	if (current->cdnDcIds.find(dcId) != current->cdnDcIds.cend()) {
 		return DcType::Cdn;
 	}
-	const auto dcId = BareDcId(shiftedDcId);
-	if (isDownloadDcId(shiftedDcId) && hasMediaOnlyOptionsFor(dcId)) {
+	if (isDownloadDcId(shiftedDcId)
+		&& HasMediaOnlyOptionsFor(*current, dcId)) {
 		return DcType::MediaCluster;
 	}
 	return DcType::Regular;
@@ -590,6 +656,54 @@ void DcOptions::setCDNConfig(const MTPDcdnConfig &config) {
 	_cdnConfigChanged.fire({});
 }
 
+auto DcOptions::lookupPreferred(
+		DcId dcId,
+		const QString &network) const -> std::optional<PreferredEndpoint> {
+	ReadLocker lock(this);
+	const auto i = _preferred.find(dcId);
+	if (i == end(_preferred)) {
+		return std::nullopt;
+	}
+	const auto j = ranges::find(
+		i->second,
+		network,
+		&PreferredEndpoint::network);
+	if (j == end(i->second)) {
+		return std::nullopt;
+	}
+	return *j;
+}
+
+void DcOptions::setPreferred(DcId dcId, PreferredEndpoint &&endpoint) {
+	// Remember a few recently used networks for each dc.
+	constexpr auto kMaxNetworks = 8;
+
+	WriteLocker lock(this);
+	auto &list = _preferred[dcId];
+	const auto i = ranges::find(
+		list,
+		endpoint.network,
+		&PreferredEndpoint::network);
+	if (i != end(list)) {
+		if (i->protocol == endpoint.protocol
+			&& i->ip == endpoint.ip
+			&& i->port == endpoint.port) {
+			return;
+		}
+		list.erase(i);
+	} else if (list.size() >= kMaxNetworks) {
+		list.pop_back();
+	}
+	list.insert(begin(list), std::move(endpoint));
+	lock.unlock();
+
+	_preferredChanged.fire({});
+}
+
+rpl::producer<> DcOptions::preferredChanged() const {
+	return _preferredChanged.events();
+}
+
 bool DcOptions::hasCDNKeysForDc(DcId dcId) const {
 	ReadLocker lock(this);
 	return _cdnPublicKeys.find(dcId) != _cdnPublicKeys.cend();
@@ -624,9 +738,9 @@ auto DcOptions::lookup(
 	using Flag = Flag;
 	auto result = Variants();
 
-	ReadLocker lock(this);
-	const auto i = _data.find(dcId);
-	if (i == end(_data)) {
+	const auto current = snapshot();
+	const auto i = current->data.find(dcId);
+	if (i == end(current->data)) {
 		return result;
 	}
 	for (const auto &endpoint : i->second) {
@@ -656,10 +770,11 @@ auto DcOptions::lookup(
 	return result;
 }
 
-bool DcOptions::hasMediaOnlyOptionsFor(DcId dcId) const {
-	ReadLocker lock(this);
-	const auto i = _data.find(dcId);
-	if (i == end(_data)) {
+bool DcOptions::HasMediaOnlyOptionsFor(
+		const Snapshot &snapshot,
+		DcId dcId) {
+	const auto i = snapshot.data.find(dcId);
+	if (i == end(snapshot.data)) {
 		return false;
 	}
 	for (const auto &endpoint : i->second) {
@@ -691,14 +806,22 @@ void DcOptions::FilterIfHasWithFlag(Variants &variants, Flag flag) {
 	}
 }
 
-void DcOptions::computeCdnDcIds() {
-	_cdnDcIds.clear();
+auto DcOptions::snapshot() const -> std::shared_ptr<const Snapshot> {
+	return std::atomic_load(&_snapshot);
+}
+
+void DcOptions::publishSnapshot() {
+	auto result = std::make_shared<Snapshot>();
+	result->data = _data;
 	for (auto &item : _data) {
 		Assert(!item.second.empty());
 		if (item.second.front().flags & Flag::f_cdn) {
-			_cdnDcIds.insert(BareDcId(item.first));
+			result->cdnDcIds.insert(BareDcId(item.first));
 		}
 	}
+	std::atomic_store(
+		&_snapshot,
+		std::shared_ptr<const Snapshot>(std::move(result)));
 }
 
 bool DcOptions::loadFromFile(const QString &path) {
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <set>
 
 namespace MTP {
@@ -96,6 +97,21 @@ public:
 		bool throughProxy) const;
 	[[nodiscard]] DcType dcType(ShiftedDcId shiftedDcId) const;
 
+	// The endpoint that was chosen last time for a dc on some network.
+	struct PreferredEndpoint {
+		QString network;
+		Variants::Protocol protocol = Variants::Tcp;
+		std::string ip;
+		int port = 0;
+	};
+	[[nodiscard]] std::optional<PreferredEndpoint> lookupPreferred(
+		DcId dcId,
+		const QString &network) const;
+
+	// Main thread.
+	void setPreferred(DcId dcId, PreferredEndpoint &&endpoint);
+	[[nodiscard]] rpl::producer<> preferredChanged() const;
+
 	void setCDNConfig(const MTPDcdnConfig &config);
 	[[nodiscard]] bool hasCDNKeysForDc(DcId dcId) const;
 	[[nodiscard]] details::RSAPublicKey getDcRSAKey(
@@ -125,10 +141,18 @@ private:
 		const std::map<DcId, std::vector<Endpoint>> &b);
 	static void FilterIfHasWithFlag(Variants &variants, Flag flag);
 
-	[[nodiscard]] bool hasMediaOnlyOptionsFor(DcId dcId) const;
-
 	void processFromList(const QVector<MTPDcOption> &options, bool overwrite);
-	void computeCdnDcIds();
+
+	// Immutable copy of the options, readers never wait for the writers.
+	struct Snapshot {
+		std::map<DcId, std::vector<Endpoint>> data;
+		std::set<DcId> cdnDcIds;
+	};
+	[[nodiscard]] std::shared_ptr<const Snapshot> snapshot() const;
+	void publishSnapshot();
+	[[nodiscard]] static bool HasMediaOnlyOptionsFor(
+		const Snapshot &snapshot,
+		DcId dcId);
 
 	void readBuiltInPublicKeys();
 
@@ -138,14 +162,17 @@ private:
 	class ReadLocker;
 	friend class ReadLocker;
 
+	// Written only with the write lock held, then published as a snapshot.
 	std::map<DcId, std::vector<Endpoint>> _data;
-	std::set<DcId> _cdnDcIds;
+	std::shared_ptr<const Snapshot> _snapshot;
 	std::map<uint64, details::RSAPublicKey> _publicKeys;
 	std::map<DcId, std::map<uint64, details::RSAPublicKey>> _cdnPublicKeys;
+	std::map<DcId, std::vector<PreferredEndpoint>> _preferred;
 	mutable QReadWriteLock _useThroughLockers;
 
 	rpl::event_stream<DcId> _changed;
 	rpl::event_stream<> _cdnConfigChanged;
+	rpl::event_stream<> _preferredChanged;
 
 	// True when we have overriden options from a .tdesktop-endpoints file.
 	bool _immutable = false;
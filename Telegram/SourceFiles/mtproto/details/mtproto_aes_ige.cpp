@@ -0,0 +1,264 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_aes_ige.h"
+
+#include <openssl/aes.h>
+#include <cstring>
+
+#if defined _M_IX86 || defined _M_X64 || defined __i386__ || defined __x86_64__
+#define MTP_AES_IGE_HARDWARE
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MTP_AES_NI_TARGET
+#else // _MSC_VER
+#include <cpuid.h>
+#define MTP_AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif // _MSC_VER
+#endif // _M_IX86 || _M_X64 || __i386__ || __x86_64__
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kBlockSize = 16;
+
+#ifdef MTP_AES_IGE_HARDWARE
+
+constexpr auto kRounds = 14;
+
+struct Schedule {
+	__m128i keys[kRounds + 1];
+};
+
+bool DetectAesNi() {
+	constexpr auto kSse2Bit = (1U << 26); // edx
+	constexpr auto kAesBit = (1U << 25); // ecx
+#ifdef _MSC_VER
+	int info[4] = { 0 };
+	__cpuid(info, 1);
+	const auto ecx = uint32(info[2]);
+	const auto edx = uint32(info[3]);
+#else // _MSC_VER
+	auto eax = 0U, ebx = 0U, ecx = 0U, edx = 0U;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+#endif // _MSC_VER
+	return (ecx & kAesBit) && (edx & kSse2Bit);
+}
+
+MTP_AES_NI_TARGET inline __m128i ShiftXor(__m128i value) {
+	auto shifted = _mm_slli_si128(value, 4);
+	value = _mm_xor_si128(value, shifted);
+	shifted = _mm_slli_si128(shifted, 4);
+	value = _mm_xor_si128(value, shifted);
+	shifted = _mm_slli_si128(shifted, 4);
+	return _mm_xor_si128(value, shifted);
+}
+
+MTP_AES_NI_TARGET inline __m128i ExpandFirst(__m128i key, __m128i assist) {
+	return _mm_xor_si128(ShiftXor(key), _mm_shuffle_epi32(assist, 0xFF));
+}
+
+MTP_AES_NI_TARGET inline __m128i ExpandSecond(__m128i key, __m128i from) {
+	const auto assist = _mm_aeskeygenassist_si128(from, 0x00);
+	return _mm_xor_si128(ShiftXor(key), _mm_shuffle_epi32(assist, 0xAA));
+}
+
+MTP_AES_NI_TARGET void ExpandEncryptKey(const void *key, Schedule &result) {
+	const auto bytes = static_cast<const uchar*>(key);
+	auto first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+	auto second = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(bytes + kBlockSize));
+	result.keys[0] = first;
+	result.keys[1] = second;
+
+	// The round constant is an immediate, so the steps are unrolled.
+#define MTP_AES_EXPAND_STEP(index, rcon) \
+	first = ExpandFirst(first, _mm_aeskeygenassist_si128(second, rcon)); \
+	result.keys[index] = first; \
+	if (index + 1 <= kRounds) { \
+		second = ExpandSecond(second, first); \
+		result.keys[index + 1] = second; \
+	}
+
+	MTP_AES_EXPAND_STEP(2, 0x01);
+	MTP_AES_EXPAND_STEP(4, 0x02);
+	MTP_AES_EXPAND_STEP(6, 0x04);
+	MTP_AES_EXPAND_STEP(8, 0x08);
+	MTP_AES_EXPAND_STEP(10, 0x10);
+	MTP_AES_EXPAND_STEP(12, 0x20);
+	MTP_AES_EXPAND_STEP(14, 0x40);
+
+#undef MTP_AES_EXPAND_STEP
+}
+
+MTP_AES_NI_TARGET void ExpandDecryptKey(const void *key, Schedule &result) {
+	auto encrypt = Schedule();
+	ExpandEncryptKey(key, encrypt);
+	result.keys[0] = encrypt.keys[kRounds];
+	for (auto i = 1; i != kRounds; ++i) {
+		result.keys[i] = _mm_aesimc_si128(encrypt.keys[kRounds - i]);
+	}
+	result.keys[kRounds] = encrypt.keys[0];
+}
+
+MTP_AES_NI_TARGET inline __m128i EncryptBlock(
+		__m128i block,
+		const Schedule &schedule) {
+	block = _mm_xor_si128(block, schedule.keys[0]);
+	for (auto i = 1; i != kRounds; ++i) {
+		block = _mm_aesenc_si128(block, schedule.keys[i]);
+	}
+	return _mm_aesenclast_si128(block, schedule.keys[kRounds]);
+}
+
+MTP_AES_NI_TARGET inline __m128i DecryptBlock(
+		__m128i block,
+		const Schedule &schedule) {
+	block = _mm_xor_si128(block, schedule.keys[0]);
+	for (auto i = 1; i != kRounds; ++i) {
+		block = _mm_aesdec_si128(block, schedule.keys[i]);
+	}
+	return _mm_aesdeclast_si128(block, schedule.keys[kRounds]);
+}
+
+// IGE chains every block on the previous one, so the blocks can't be
+// pipelined, but a single AES-NI block is still several times faster
+// than the table based AES_encrypt() used by OpenSSL AES_ige_encrypt().
+MTP_AES_NI_TARGET void EncryptHardware(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+	auto schedule = Schedule();
+	ExpandEncryptKey(key, schedule);
+
+	const auto ivBytes = static_cast<const uchar*>(iv);
+	auto previousEncrypted = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(ivBytes));
+	auto previousPlain = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(ivBytes + kBlockSize));
+
+	auto from = static_cast<const __m128i*>(src);
+	auto to = static_cast<__m128i*>(dst);
+	for (auto left = len / kBlockSize; left != 0; --left) {
+		const auto plain = _mm_loadu_si128(from++);
+		const auto encrypted = _mm_xor_si128(
+			EncryptBlock(_mm_xor_si128(plain, previousEncrypted), schedule),
+			previousPlain);
+		_mm_storeu_si128(to++, encrypted);
+		previousEncrypted = encrypted;
+		previousPlain = plain;
+	}
+}
+
+MTP_AES_NI_TARGET void DecryptHardware(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+	auto schedule = Schedule();
+	ExpandDecryptKey(key, schedule);
+
+	const auto ivBytes = static_cast<const uchar*>(iv);
+	auto previousEncrypted = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(ivBytes));
+	auto previousPlain = _mm_loadu_si128(
+		reinterpret_cast<const __m128i*>(ivBytes + kBlockSize));
+
+	auto from = static_cast<const __m128i*>(src);
+	auto to = static_cast<__m128i*>(dst);
+	for (auto left = len / kBlockSize; left != 0; --left) {
+		const auto encrypted = _mm_loadu_si128(from++);
+		const auto plain = _mm_xor_si128(
+			DecryptBlock(_mm_xor_si128(encrypted, previousPlain), schedule),
+			previousEncrypted);
+		_mm_storeu_si128(to++, plain);
+		previousEncrypted = encrypted;
+		previousPlain = plain;
+	}
+}
+
+#endif // MTP_AES_IGE_HARDWARE
+
+} // namespace
+
+bool AesIgeHardwareSupported() {
+#ifdef MTP_AES_IGE_HARDWARE
+	static const auto result = DetectAesNi();
+	return result;
+#else // MTP_AES_IGE_HARDWARE
+	return false;
+#endif // MTP_AES_IGE_HARDWARE
+}
+
+void AesIgeEncrypt(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+#ifdef MTP_AES_IGE_HARDWARE
+	if (AesIgeHardwareSupported()) {
+		EncryptHardware(src, dst, len, key, iv);
+		return;
+	}
+#endif // MTP_AES_IGE_HARDWARE
+	AesIgeEncryptGeneric(src, dst, len, key, iv);
+}
+
+void AesIgeDecrypt(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+#ifdef MTP_AES_IGE_HARDWARE
+	if (AesIgeHardwareSupported()) {
+		DecryptHardware(src, dst, len, key, iv);
+		return;
+	}
+#endif // MTP_AES_IGE_HARDWARE
+	AesIgeDecryptGeneric(src, dst, len, key, iv);
+}
+
+void AesIgeEncryptGeneric(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+	uchar aes_key[32], aes_iv[32];
+	memcpy(aes_key, key, 32);
+	memcpy(aes_iv, iv, 32);
+
+	AES_KEY aes;
+	AES_set_encrypt_key(aes_key, 256, &aes);
+	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_ENCRYPT);
+}
+
+void AesIgeDecryptGeneric(
+		const void *src,
+		void *dst,
+		uint32 len,
+		const void *key,
+		const void *iv) {
+	uchar aes_key[32], aes_iv[32];
+	memcpy(aes_key, key, 32);
+	memcpy(aes_iv, iv, 32);
+
+	AES_KEY aes;
+	AES_set_decrypt_key(aes_key, 256, &aes);
+	AES_ige_encrypt(static_cast<const uchar*>(src), static_cast<uchar*>(dst), len, &aes, aes_iv, AES_DECRYPT);
+}
+
+} // namespace MTP::details
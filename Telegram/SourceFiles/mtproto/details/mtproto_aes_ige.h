@@ -0,0 +1,48 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+namespace MTP::details {
+
+// AES-256 in IGE mode with 32 byte key and 32 byte iv, the iv layout is
+// the same that OpenSSL AES_ige_encrypt() uses. The length should be
+// a multiple of 16, src and dst may point to the same memory.
+//
+// Uses AES-NI instructions if the CPU supports them, OpenSSL otherwise.
+void AesIgeEncrypt(
+	const void *src,
+	void *dst,
+	uint32 len,
+	const void *key,
+	const void *iv);
+void AesIgeDecrypt(
+	const void *src,
+	void *dst,
+	uint32 len,
+	const void *key,
+	const void *iv);
+
+// Plain OpenSSL implementation, used as a fallback and in benchmarks.
+void AesIgeEncryptGeneric(
+	const void *src,
+	void *dst,
+	uint32 len,
+	const void *key,
+	const void *iv);
+void AesIgeDecryptGeneric(
+	const void *src,
+	void *dst,
+	uint32 len,
+	const void *key,
+	const void *iv);
+
+[[nodiscard]] bool AesIgeHardwareSupported();
+
+} // namespace MTP::details
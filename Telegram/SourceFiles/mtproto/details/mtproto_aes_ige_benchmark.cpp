@@ -0,0 +1,117 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_aes_ige.h"
+
+#include <QtCore/QString>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Usage: benchmark_mtproto_aes [parts]
+//
+// Encrypts and decrypts 512 KB file parts with the OpenSSL IGE and with
+// the implementation selected at runtime and checks that results match.
+
+namespace {
+
+using namespace MTP::details;
+using Clock = std::chrono::steady_clock;
+using Method = void(*)(const void*, void*, uint32, const void*, const void*);
+
+constexpr auto kPartSize = 512 * 1024;
+constexpr auto kDefaultParts = 256;
+
+std::vector<uchar> RandomBytes(int size, uint32 seed) {
+	auto result = std::vector<uchar>(size);
+	auto generator = std::mt19937(seed);
+	for (auto &ch : result) {
+		ch = uchar(generator() & 0xFF);
+	}
+	return result;
+}
+
+double SecondsSince(Clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(Clock::now() - started).count();
+}
+
+void Report(const char *name, int parts, double seconds) {
+	const auto megabytes = double(parts) * kPartSize / (1024. * 1024.);
+	std::printf(
+		"%-20s %8d parts %10.3f s %10.1f MB/s\n",
+		name,
+		parts,
+		seconds,
+		(seconds > 0.) ? (megabytes / seconds) : 0.);
+}
+
+double Measure(
+		Method method,
+		const std::vector<uchar> &from,
+		std::vector<uchar> &to,
+		const std::vector<uchar> &key,
+		const std::vector<uchar> &iv,
+		int parts) {
+	const auto started = Clock::now();
+	for (auto i = 0; i != parts; ++i) {
+		method(from.data(), to.data(), kPartSize, key.data(), iv.data());
+	}
+	return SecondsSince(started);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const auto parts = [&] {
+		const auto value = (argc > 1)
+			? QString::fromLatin1(argv[1]).toInt()
+			: 0;
+		return (value > 0) ? value : kDefaultParts;
+	}();
+	std::printf(
+		"part size: %d, parts: %d, hardware: %s\n",
+		kPartSize,
+		parts,
+		AesIgeHardwareSupported() ? "yes" : "no");
+
+	const auto key = RandomBytes(32, 1);
+	const auto iv = RandomBytes(32, 2);
+	const auto plain = RandomBytes(kPartSize, 3);
+	auto generic = std::vector<uchar>(kPartSize);
+	auto optimized = std::vector<uchar>(kPartSize);
+
+	Report(
+		"encrypt (openssl)",
+		parts,
+		Measure(AesIgeEncryptGeneric, plain, generic, key, iv, parts));
+	Report(
+		"encrypt (selected)",
+		parts,
+		Measure(AesIgeEncrypt, plain, optimized, key, iv, parts));
+	if (generic != optimized) {
+		std::printf("Encrypted data mismatch.\n");
+		return 1;
+	}
+
+	const auto encrypted = generic;
+	Report(
+		"decrypt (openssl)",
+		parts,
+		Measure(AesIgeDecryptGeneric, encrypted, generic, key, iv, parts));
+	Report(
+		"decrypt (selected)",
+		parts,
+		Measure(AesIgeDecrypt, encrypted, optimized, key, iv, parts));
+	if (generic != optimized || generic != plain) {
+		std::printf("Decrypted data mismatch.\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_buffer_pool.h"
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kIntSize = int(sizeof(mtpPrime));
+
+} // namespace
+
+mtpBuffer BufferPool::acquire(int ints) {
+	auto result = mtpBuffer();
+	if (ints * kIntSize <= kMaxPooledSize) {
+		QMutexLocker lock(&_mutex);
+		const auto i = ranges::find_if(_free, [&](const mtpBuffer &buffer) {
+			return (buffer.capacity() >= ints);
+		});
+		if (i != end(_free)) {
+			result = std::move(*i);
+			_free.erase(i);
+		}
+	}
+	if (result.capacity() < ints) {
+		result.reserve(std::max(ints, kDefaultSize / kIntSize));
+	}
+	result.resize(ints);
+	return result;
+}
+
+void BufferPool::release(mtpBuffer &&buffer) {
+	const auto size = buffer.capacity() * kIntSize;
+	if (size < kMinPooledSize
+		|| size > kMaxPooledSize
+		|| !buffer.isDetached()) {
+		return;
+	}
+	buffer.reserve(buffer.capacity()); // Keep the capacity on resize.
+	buffer.resize(0);
+
+	QMutexLocker lock(&_mutex);
+	if (_free.size() < kMaxPooledCount) {
+		_free.push_back(std::move(buffer));
+	}
+}
+
+int64 BufferPool::pooledBytes() const {
+	auto result = int64(0);
+	QMutexLocker lock(&_mutex);
+	for (const auto &buffer : _free) {
+		result += int64(buffer.capacity()) * kIntSize;
+	}
+	return result;
+}
+
+} // namespace MTP::details
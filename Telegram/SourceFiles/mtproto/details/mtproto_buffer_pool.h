@@ -0,0 +1,38 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+#include <QtCore/QMutex>
+
+namespace MTP::details {
+
+// Large receive buffers shared by all connections of an Instance.
+// Sized for the upload.file responses with 512 KB parts.
+class BufferPool final {
+public:
+	static constexpr auto kMinPooledSize = 64 * 1024;
+	static constexpr auto kDefaultSize = 512 * 1024 + 1024;
+	static constexpr auto kMaxPooledSize = 1024 * 1024 + 1024;
+	static constexpr auto kMaxPooledCount = 8;
+
+	// Thread-safe.
+	[[nodiscard]] mtpBuffer acquire(int ints);
+	void release(mtpBuffer &&buffer);
+
+	// Thread-safe, bytes kept in the free buffers.
+	[[nodiscard]] int64 pooledBytes() const;
+
+private:
+	mutable QMutex _mutex;
+	std::vector<mtpBuffer> _free;
+
+};
+
+} // namespace MTP::details
@@ -255,6 +255,9 @@ void DomainResolver::sendNextRequest(const AttemptKey &key) {
 	}
 	auto &attempts = i->second;
 	auto &list = attempts.list;
+	if (list.empty()) {
+		return;
+	}
 	const auto attempt = list.back();
 	list.pop_back();
 
@@ -315,6 +318,9 @@ void DomainResolver::requestFinished(
 	const auto result = finalizeRequest(key, reply);
 	const auto response = ParseDnsResponse(result);
 	if (response.empty()) {
+		// Blocked or failed provider, don't wait for the timeout
+		// to try the next one.
+		sendNextRequest(key);
 		return;
 	}
 	_requests.erase(key);
@@ -0,0 +1,136 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/core_types.h"
+#include "mtproto/details/mtproto_received_ids_manager.h"
+#include "logs.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Usage: benchmark_mtproto_received_ids [messages] [rate]
+//
+// Registers the msg_ids of a session receiving [rate] messages a second
+// (10000 by default) in the ReceivedIdsManager, the way the session
+// thread does it for each received message, and looks up the ids of
+// the replies. A few ids come out of order and a few are duplicated,
+// like resent messages are.
+//
+// Fixed random seeds are used, so the numbers of different builds are
+// comparable.
+
+namespace Logs {
+
+// The application logs are not started in the benchmark.
+bool DebugEnabled() {
+	return false;
+}
+
+bool started() {
+	return true;
+}
+
+void writeMtp(int32 dc, const QString &v) {
+}
+
+} // namespace Logs
+
+namespace {
+
+using namespace MTP::details;
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kDefaultMessages = 10'000'000;
+constexpr auto kDefaultRate = 10'000;
+constexpr auto kReorderedPercent = 2;
+constexpr auto kDuplicatedPercent = 1;
+
+// Server msg_ids are unixtime in the high part and a counter in the low.
+std::vector<mtpMsgId> GenerateIds(int count, int rate) {
+	auto generator = std::mt19937(1);
+	auto result = std::vector<mtpMsgId>();
+	result.reserve(count);
+	const auto start = mtpMsgId(1'500'000'000) << 32;
+	const auto step = (mtpMsgId(1) << 32) / rate;
+	for (auto i = 0; i != count; ++i) {
+		result.push_back(start + (mtpMsgId(i) * step) / 4 * 4 + 1);
+	}
+	for (auto i = 1; i != count; ++i) {
+		const auto roll = int(generator() % 100);
+		if (roll < kReorderedPercent) {
+			const auto from = std::max(i - 8, 0);
+			std::swap(result[i], result[from + (generator() % (i - from))]);
+		} else if (roll < kReorderedPercent + kDuplicatedPercent) {
+			result[i] = result[i - 1 - (generator() % std::min(i, 64))];
+		}
+	}
+	return result;
+}
+
+double SecondsSince(Clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(Clock::now() - started).count();
+}
+
+void Report(const char *name, int count, double seconds) {
+	std::printf(
+		"%-20s %10d ops %10.3f s %10.1f ns/op\n",
+		name,
+		count,
+		seconds,
+		count ? (seconds * 1e9 / count) : 0.);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	const auto value = [&](int index, int fallback) {
+		const auto result = (argc > index)
+			? QString::fromLatin1(argv[index]).toInt()
+			: 0;
+		return (result > 0) ? result : fallback;
+	};
+	const auto messages = value(1, kDefaultMessages);
+	const auto rate = value(2, kDefaultRate);
+	std::printf("messages: %d, rate: %d per second\n", messages, rate);
+
+	const auto ids = GenerateIds(messages, rate);
+	auto manager = ReceivedIdsManager();
+
+	auto handled = 0;
+	auto started = Clock::now();
+	for (auto i = 0; i != messages; ++i) {
+		if (manager.registerMsgId(ids[i], (i % 3) != 0)) {
+			++handled;
+		}
+	}
+	const auto registered = SecondsSince(started);
+	Report("register", messages, registered);
+
+	auto found = 0;
+	started = Clock::now();
+	for (auto i = 0; i != messages; ++i) {
+		const auto id = ids[messages - 1 - (i % kIdsBufferSize)];
+		if (manager.lookup(id) != ReceivedIdsManager::State::NotFound) {
+			++found;
+		}
+	}
+	Report("lookup", messages, SecondsSince(started));
+
+	std::printf(
+		"handled: %d, skipped: %d, found: %d\n",
+		handled,
+		messages - handled,
+		found);
+	std::printf(
+		"session thread load at %d messages a second: %.4f%%\n",
+		rate,
+		registered * rate * 100. / messages);
+	return (manager.max() == 0) ? 1 : 0;
+}
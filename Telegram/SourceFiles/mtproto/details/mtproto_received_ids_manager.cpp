@@ -10,45 +10,80 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace MTP::details {
 
 bool ReceivedIdsManager::registerMsgId(mtpMsgId msgId, bool needAck) {
-	const auto i = _idsNeedAck.find(msgId);
-	if (i == _idsNeedAck.end()) {
-		if (_idsNeedAck.size() < kIdsBufferSize || msgId > min()) {
-			_idsNeedAck.emplace(msgId, needAck);
-			return true;
-		}
+	// Server msg_ids almost always increase, so usually we just append.
+	if (!_count || msgId > max()) {
+		insert(_count, { msgId, needAck });
+		return true;
+	}
+	const auto index = lowerBound(msgId);
+	if (index < _count && entry(index).msgId == msgId) {
+		MTP_LOG(-1, ("No need to handle - %1 already is in map").arg(msgId));
+	} else if (_count == kIdsBufferSize && !index) {
 		MTP_LOG(-1, ("No need to handle - %1 < min = %2").arg(msgId).arg(min()));
 	} else {
-		MTP_LOG(-1, ("No need to handle - %1 already is in map").arg(msgId));
+		insert(index, { msgId, needAck });
+		return true;
 	}
 	return false;
 }
 
 mtpMsgId ReceivedIdsManager::min() const {
-	return _idsNeedAck.empty() ? 0 : _idsNeedAck.begin()->first;
+	return _count ? entry(0).msgId : 0;
 }
 
 mtpMsgId ReceivedIdsManager::max() const {
-	auto end = _idsNeedAck.end();
-	return _idsNeedAck.empty() ? 0 : (--end)->first;
+	return _count ? entry(_count - 1).msgId : 0;
 }
 
 ReceivedIdsManager::State ReceivedIdsManager::lookup(mtpMsgId msgId) const {
-	auto i = _idsNeedAck.find(msgId);
-	if (i == _idsNeedAck.end()) {
+	const auto index = lowerBound(msgId);
+	if (index == _count || entry(index).msgId != msgId) {
 		return State::NotFound;
 	}
-	return i->second ? State::NeedsAck : State::NoAckNeeded;
+	return entry(index).needAck ? State::NeedsAck : State::NoAckNeeded;
+}
+
+void ReceivedIdsManager::clear() {
+	_first = _count = 0;
+}
+
+auto ReceivedIdsManager::entry(int index) -> Entry & {
+	return _entries[(_first + index) % kIdsBufferSize];
+}
+
+auto ReceivedIdsManager::entry(int index) const -> const Entry & {
+	return _entries[(_first + index) % kIdsBufferSize];
 }
 
-void ReceivedIdsManager::shrink() {
-	auto size = _idsNeedAck.size();
-	while (size-- > kIdsBufferSize) {
-		_idsNeedAck.erase(_idsNeedAck.begin());
+int ReceivedIdsManager::lowerBound(mtpMsgId msgId) const {
+	auto from = 0;
+	auto till = _count;
+	while (from != till) {
+		const auto middle = from + (till - from) / 2;
+		if (entry(middle).msgId < msgId) {
+			from = middle + 1;
+		} else {
+			till = middle;
+		}
 	}
+	return from;
 }
 
-void ReceivedIdsManager::clear() {
-	_idsNeedAck.clear();
+void ReceivedIdsManager::insert(int index, Entry value) {
+	Expects(index >= 0 && index <= _count);
+
+	if (_count == kIdsBufferSize) {
+		// Forget the oldest id to make room for the new one.
+		Assert(index > 0);
+		_first = (_first + 1) % kIdsBufferSize;
+		--_count;
+		--index;
+	}
+	for (auto i = _count; i != index; --i) {
+		entry(i) = entry(i - 1);
+	}
+	entry(index) = value;
+	++_count;
 }
 
 } // namespace MTP::details
@@ -7,7 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
-#include "base/flat_map.h"
+#include <array>
 
 namespace MTP::details {
 
@@ -27,11 +27,24 @@ public:
 	[[nodiscard]] mtpMsgId max() const;
 	[[nodiscard]] State lookup(mtpMsgId msgId) const;
 
-	void shrink();
 	void clear();
 
 private:
-	base::flat_map<mtpMsgId, bool> _idsNeedAck;
+	struct Entry {
+		mtpMsgId msgId = 0;
+		bool needAck = false;
+	};
+
+	// Indices are counted from the oldest entry in the ring.
+	[[nodiscard]] Entry &entry(int index);
+	[[nodiscard]] const Entry &entry(int index) const;
+	[[nodiscard]] int lowerBound(mtpMsgId msgId) const;
+	void insert(int index, Entry value);
+
+	// The last kIdsBufferSize received ids sorted by msgId.
+	std::array<Entry, kIdsBufferSize> _entries;
+	int _first = 0;
+	int _count = 0;
 
 };
 
@@ -12,6 +12,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace MTP::details {
 namespace {
 
+// Up to three ints to align, four more for at least 12 bytes and
+// up to sixty more of the extended random padding.
+constexpr auto kMaxPaddingPrimesCount = uint32(3 + 4 + (0x0F << 2));
+
 uint32 CountPaddingPrimesCount(uint32 requestSize, bool extended, bool old) {
 	if (old) {
 		return ((8 + requestSize) & 0x03)
@@ -48,8 +52,10 @@ SerializedRequest SerializedRequest::Prepare(
 
 	const auto finalSize = std::max(size, reserveSize);
 
+	// Reserve the padding as well, so that addPadding() doesn't reallocate
+	// and copy the whole request, like a 512 KB upload.saveFilePart.
 	auto result = SerializedRequest(RequestConstructHider::Tag{});
-	result->reserve(kMessageBodyPosition + finalSize);
+	result->reserve(kMessageBodyPosition + finalSize + kMaxPaddingPrimesCount);
 	result->resize(kMessageBodyPosition);
 	result->back() = (size << 2);
 	result->lastSentTime = crl::now();
@@ -105,7 +111,7 @@ void SerializedRequest::addPadding(bool extended, bool old) {
 	Expects(_data->size() > kMessageBodyPosition);
 
 	const auto requestSize = (tl::count_length(*this) >> 2);
-	const auto padding = CountPaddingPrimesCount(requestSize, extended, old);
+	const auto padding = countPadding(extended, old);
 	const auto fullSize = kMessageBodyPosition + requestSize + padding;
 	if (uint32(_data->size()) != fullSize) {
 		_data->resize(fullSize);
@@ -116,6 +122,14 @@ void SerializedRequest::addPadding(bool extended, bool old) {
 	}
 }
 
+uint32 SerializedRequest::countPadding(bool extended, bool old) const {
+	Expects(_data != nullptr);
+	Expects(_data->size() > kMessageBodyPosition);
+
+	const auto requestSize = (tl::count_length(*this) >> 2);
+	return CountPaddingPrimesCount(requestSize, extended, old);
+}
+
 uint32 SerializedRequest::messageSize() const {
 	Expects(_data != nullptr);
 	Expects(_data->size() > kMessageBodyPosition);
@@ -66,6 +66,7 @@ public:
 	[[nodiscard]] uint32 getSeqNo() const;
 
 	void addPadding(bool extended, bool old);
+	[[nodiscard]] uint32 countPadding(bool extended, bool old) const;
 	[[nodiscard]] uint32 messageSize() const;
 
 	[[nodiscard]] bool needAck() const;
@@ -0,0 +1,153 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/details/mtproto_traffic_recorder.h"
+
+#ifdef _DEBUG
+
+#include <QtCore/QFile>
+
+namespace MTP::details {
+namespace {
+
+constexpr auto kMagic = quint32(0x524D4454); // 'TDMR'
+constexpr auto kVersion = qint32(1);
+constexpr auto kMaxRecordInts = 16 * 1024 * 1024 / int(sizeof(mtpPrime));
+
+struct FileHeader {
+	quint32 magic = kMagic;
+	qint32 version = kVersion;
+};
+
+struct RecordHeader {
+	qint64 time = 0;
+	qint32 shiftedDcId = 0;
+	qint32 requestId = 0;
+	qint32 size = 0; // In mtpPrime-s.
+	qint32 reserved = 0;
+};
+
+template <typename Data>
+[[nodiscard]] bool ReadRaw(QFile &file, Data &data) {
+	const auto size = qint64(sizeof(Data));
+	return (file.read(reinterpret_cast<char*>(&data), size) == size);
+}
+
+template <typename Data>
+[[nodiscard]] bool WriteRaw(QFile &file, const Data &data) {
+	const auto size = qint64(sizeof(Data));
+	return (file.write(reinterpret_cast<const char*>(&data), size) == size);
+}
+
+} // namespace
+
+class TrafficRecorder::Writer final {
+public:
+	explicit Writer(const QString &path);
+
+	void write(const RecordHeader &header, const mtpBuffer &data);
+
+private:
+	QFile _file;
+	bool _valid = false;
+
+};
+
+TrafficRecorder::Writer::Writer(const QString &path) : _file(path) {
+	if (!_file.open(QIODevice::WriteOnly)) {
+		LOG(("MTP Error: Could not open '%1' for traffic recording."
+			).arg(path));
+		return;
+	}
+	_valid = WriteRaw(_file, FileHeader());
+	if (_valid) {
+		LOG(("MTP Info: Recording traffic to '%1'.").arg(path));
+	}
+}
+
+void TrafficRecorder::Writer::write(
+		const RecordHeader &header,
+		const mtpBuffer &data) {
+	if (!_valid) {
+		return;
+	}
+	const auto bytes = qint64(data.size() * sizeof(mtpPrime));
+	if (!WriteRaw(_file, header)
+		|| _file.write(
+			reinterpret_cast<const char*>(data.constData()),
+			bytes) != bytes) {
+		LOG(("MTP Error: Could not write traffic record, stopping."));
+		_valid = false;
+		_file.close();
+	}
+}
+
+TrafficRecorder::TrafficRecorder(const QString &path)
+: _writer(path)
+, _started(crl::now()) {
+}
+
+TrafficRecorder::~TrafficRecorder() = default;
+
+void TrafficRecorder::write(
+		ShiftedDcId shiftedDcId,
+		mtpRequestId requestId,
+		const mtpBuffer &data) {
+	auto header = RecordHeader();
+	header.time = crl::now() - _started;
+	header.shiftedDcId = shiftedDcId;
+	header.requestId = requestId;
+	header.size = data.size();
+	_writer.with([=](Writer &writer) {
+		writer.write(header, data);
+	});
+}
+
+std::optional<std::vector<TrafficRecord>> ReadTrafficRecords(
+		const QString &path) {
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)) {
+		LOG(("MTP Error: Could not open '%1' for traffic replay."
+			).arg(path));
+		return std::nullopt;
+	}
+	auto header = FileHeader();
+	if (!ReadRaw(file, header)
+		|| header.magic != kMagic
+		|| header.version != kVersion) {
+		LOG(("MTP Error: Bad traffic file header in '%1'.").arg(path));
+		return std::nullopt;
+	}
+	auto result = std::vector<TrafficRecord>();
+	while (!file.atEnd()) {
+		auto record = RecordHeader();
+		if (!ReadRaw(file, record)
+			|| record.size <= 0
+			|| record.size > kMaxRecordInts) {
+			LOG(("MTP Error: Bad traffic record in '%1'.").arg(path));
+			return std::nullopt;
+		}
+		auto data = mtpBuffer(record.size);
+		const auto bytes = qint64(data.size() * sizeof(mtpPrime));
+		if (file.read(reinterpret_cast<char*>(data.data()), bytes) != bytes) {
+			// The last record may be incomplete if we were killed.
+			LOG(("MTP Error: Unexpected end of '%1'.").arg(path));
+			break;
+		}
+		result.push_back({
+			record.time,
+			record.shiftedDcId,
+			record.requestId,
+			std::move(data)
+		});
+	}
+	return result;
+}
+
+} // namespace MTP::details
+
+#endif // _DEBUG
@@ -0,0 +1,52 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+#include <crl/crl_object_on_queue.h>
+
+#ifdef _DEBUG
+
+namespace MTP::details {
+
+// Decrypted responses and updates as they were passed to Instance.
+struct TrafficRecord {
+	crl::time time = 0; // Since the recording started.
+	ShiftedDcId shiftedDcId = 0;
+	mtpRequestId requestId = 0; // Zero for updates.
+	mtpBuffer data;
+};
+
+// Main thread, the file is written on a background queue.
+// Only debug builds record, the file has all the traffic in plain text.
+class TrafficRecorder final {
+public:
+	explicit TrafficRecorder(const QString &path);
+	~TrafficRecorder();
+
+	void write(
+		ShiftedDcId shiftedDcId,
+		mtpRequestId requestId,
+		const mtpBuffer &data);
+
+private:
+	class Writer;
+
+	crl::object_on_queue<Writer> _writer;
+	crl::time _started = 0;
+
+};
+
+// Returns nullopt if the file could not be read.
+[[nodiscard]] std::optional<std::vector<TrafficRecord>> ReadTrafficRecords(
+	const QString &path);
+
+} // namespace MTP::details
+
+#endif // _DEBUG
@@ -34,7 +34,7 @@ constexpr ShiftedDcId updaterDcId(DcId dcId) {
 	return ShiftDcId(dcId, kUpdaterDcShift);
 }
 
-constexpr auto kUploadSessionsCount = 2;
+constexpr auto kUploadSessionsCount = 4;
 
 namespace details {
 
@@ -7,8 +7,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "mtproto/mtp_instance.h"
 
+#include "mtproto/details/mtproto_buffer_pool.h"
 #include "mtproto/details/mtproto_dcenter.h"
 #include "mtproto/details/mtproto_rsa_public_key.h"
+#include "mtproto/details/mtproto_traffic_recorder.h"
 #include "mtproto/special_config_request.h"
 #include "mtproto/session.h"
 #include "mtproto/dc_options.h"
@@ -72,6 +74,7 @@ public:
 	[[nodiscard]] rpl::producer<> allKeysDestroyed() const;
 
 	[[nodiscard]] not_null<DcOptions*> dcOptions();
+	[[nodiscard]] const std::shared_ptr<BufferPool> &bufferPool() const;
 
 	// Thread safe.
 	[[nodiscard]] QString deviceModel() const;
@@ -88,6 +91,15 @@ public:
 	void restartedByTimeout(ShiftedDcId shiftedDcId);
 	[[nodiscard]] rpl::producer<ShiftedDcId> restartsByTimeout() const;
 
+	[[nodiscard]] std::vector<SessionMetrics> collectMetrics() const;
+	[[nodiscard]] rpl::producer<std::vector<SessionMetrics>> metrics(
+		crl::time period) const;
+
+#ifdef _DEBUG
+	void startTrafficRecording(const QString &path);
+	[[nodiscard]] TrafficRecorder *trafficRecorder() const;
+#endif // _DEBUG
+
 	void restart();
 	void restart(ShiftedDcId shiftedDcId);
 	[[nodiscard]] int32 dcstate(ShiftedDcId shiftedDcId = 0);
@@ -194,6 +206,10 @@ private:
 	const not_null<Instance*> _instance;
 	const not_null<DcOptions*> _dcOptions;
 	const Instance::Mode _mode = Instance::Mode::Normal;
+	const std::shared_ptr<BufferPool> _bufferPool;
+#ifdef _DEBUG
+	std::unique_ptr<TrafficRecorder> _trafficRecorder;
+#endif // _DEBUG
 
 	std::unique_ptr<QThread> _mainSessionThread;
 	std::unique_ptr<QThread> _otherSessionsThread;
@@ -262,7 +278,8 @@ Instance::Private::Private(
 : Sender(instance)
 , _instance(instance)
 , _dcOptions(options)
-, _mode(mode) {
+, _mode(mode)
+, _bufferPool(std::make_shared<BufferPool>()) {
 	const auto idealThreadPoolSize = QThread::idealThreadCount();
 	_fileSessionThreads.resize(2 * std::max(idealThreadPoolSize / 2, 1));
 }
@@ -458,6 +475,40 @@ rpl::producer<ShiftedDcId> Instance::Private::restartsByTimeout() const {
 	return _restartsByTimeout.events();
 }
 
+std::vector<SessionMetrics> Instance::Private::collectMetrics() const {
+	auto result = std::vector<SessionMetrics>();
+	result.reserve(_sessions.size());
+	for (const auto &[shiftedDcId, session] : _sessions) {
+		result.push_back({ shiftedDcId, session->stats() });
+	}
+	return result;
+}
+
+#ifdef _DEBUG
+void Instance::Private::startTrafficRecording(const QString &path) {
+	_trafficRecorder = std::make_unique<TrafficRecorder>(path);
+}
+
+TrafficRecorder *Instance::Private::trafficRecorder() const {
+	return _trafficRecorder.get();
+}
+#endif // _DEBUG
+
+rpl::producer<std::vector<SessionMetrics>> Instance::Private::metrics(
+		crl::time period) const {
+	Expects(period > 0);
+
+	return [=](auto consumer) {
+		auto lifetime = rpl::lifetime();
+		const auto timer = lifetime.make_state<base::Timer>([=] {
+			consumer.put_next(collectMetrics());
+		});
+		consumer.put_next(collectMetrics());
+		timer->callEach(period);
+		return lifetime;
+	};
+}
+
 void Instance::Private::requestConfigIfOld() {
 	const auto timeout = Global::BlockedMode()
 		? kConfigBecomesOldForBlockedIn
@@ -773,6 +824,11 @@ not_null<DcOptions*> Instance::Private::dcOptions() {
 	return _dcOptions;
 }
 
+auto Instance::Private::bufferPool() const
+-> const std::shared_ptr<BufferPool> & {
+	return _bufferPool;
+}
+
 QString Instance::Private::deviceModel() const {
 	return _deviceModel;
 }
@@ -1694,6 +1750,25 @@ rpl::producer<ShiftedDcId> Instance::restartsByTimeout() const {
 	return _private->restartsByTimeout();
 }
 
+std::vector<SessionMetrics> Instance::metrics() const {
+	return _private->collectMetrics();
+}
+
+rpl::producer<std::vector<SessionMetrics>> Instance::metrics(
+		crl::time period) const {
+	return _private->metrics(period);
+}
+
+#ifdef _DEBUG
+void Instance::startTrafficRecording(const QString &path) {
+	_private->startTrafficRecording(path);
+}
+
+details::TrafficRecorder *Instance::trafficRecorder() const {
+	return _private->trafficRecorder();
+}
+#endif // _DEBUG
+
 void Instance::requestConfigIfOld() {
 	_private->requestConfigIfOld();
 }
@@ -1772,6 +1847,11 @@ not_null<DcOptions*> Instance::dcOptions() {
 	return _private->dcOptions();
 }
 
+auto Instance::bufferPool() const
+-> const std::shared_ptr<details::BufferPool> & {
+	return _private->bufferPool();
+}
+
 QString Instance::deviceModel() const {
 	return _private->deviceModel();
 }
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "mtproto/mtproto_rpc_sender.h"
+#include "mtproto/mtproto_session_stats.h"
 #include "mtproto/details/mtproto_serialized_request.h"
 
 namespace MTP {
@@ -15,6 +16,8 @@ namespace details {
 
 class Dcenter;
 class Session;
+class BufferPool;
+class TrafficRecorder;
 
 [[nodiscard]] int GetNextRequestId();
 
@@ -75,6 +78,9 @@ public:
 
 	[[nodiscard]] not_null<DcOptions*> dcOptions();
 
+	// Thread-safe.
+	[[nodiscard]] const std::shared_ptr<details::BufferPool> &bufferPool() const;
+
 	void restart();
 	void restart(ShiftedDcId shiftedDcId);
 	int32 dcstate(ShiftedDcId shiftedDcId = 0);
@@ -123,6 +129,18 @@ public:
 	void restartedByTimeout(ShiftedDcId shiftedDcId);
 	[[nodiscard]] rpl::producer<ShiftedDcId> restartsByTimeout() const;
 
+	// Main thread. Counters of all the sessions since they were created,
+	// the producer sends them right away and after that once a period.
+	[[nodiscard]] std::vector<SessionMetrics> metrics() const;
+	[[nodiscard]] rpl::producer<std::vector<SessionMetrics>> metrics(
+		crl::time period) const;
+
+#ifdef _DEBUG
+	// Main thread. Writes all received responses and updates to a file.
+	void startTrafficRecording(const QString &path);
+	[[nodiscard]] details::TrafficRecorder *trafficRecorder() const;
+#endif // _DEBUG
+
 	void syncHttpUnixtime();
 
 	void sendAnything(ShiftedDcId shiftedDcId = 0, crl::time msCanWait = 0);
@@ -7,10 +7,43 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "mtproto/mtproto_dh_utils.h"
 
+#include <QtCore/QMutex>
+
 namespace MTP {
 namespace {
 
 constexpr auto kMaxModExpSize = 256;
+constexpr auto kMaxCheckedPrimes = 16;
+
+// Primality checks are expensive, remember the primes (with their
+// generators) that passed them for all the key creators in the app.
+struct CheckedPrimes {
+	QMutex mutex;
+	std::vector<std::pair<bytes::vector, int>> list;
+};
+
+CheckedPrimes &GoodPrimes() {
+	static auto result = CheckedPrimes();
+	return result;
+}
+
+bool IsCheckedPrime(bytes::const_span primeBytes, int g) {
+	auto &primes = GoodPrimes();
+	QMutexLocker lock(&primes.mutex);
+	return ranges::find_if(primes.list, [&](const auto &pair) {
+		return (pair.second == g)
+			&& !bytes::compare(bytes::make_span(pair.first), primeBytes);
+	}) != end(primes.list);
+}
+
+void RememberCheckedPrime(bytes::const_span primeBytes, int g) {
+	auto &primes = GoodPrimes();
+	QMutexLocker lock(&primes.mutex);
+	if (primes.list.size() >= kMaxCheckedPrimes) {
+		primes.list.erase(begin(primes.list));
+	}
+	primes.list.emplace_back(bytes::make_vector(primeBytes), g);
+}
 
 bool IsPrimeAndGoodCheck(const openssl::BigNum &prime, int g) {
 	constexpr auto kGoodPrimeBitsCount = 2048;
@@ -125,7 +158,13 @@ bool IsPrimeAndGood(bytes::const_span primeBytes, int g) {
 		}
 	}
 
-	return IsPrimeAndGoodCheck(openssl::BigNum(primeBytes), g);
+	if (IsCheckedPrime(primeBytes, g)) {
+		return true;
+	} else if (!IsPrimeAndGoodCheck(openssl::BigNum(primeBytes), g)) {
+		return false;
+	}
+	RememberCheckedPrime(primeBytes, g);
+	return true;
 }
 
 ModExpFirst CreateModExp(
@@ -0,0 +1,91 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "mtproto/core_types.h"
+
+#include <array>
+
+namespace MTP {
+
+struct SessionStats {
+	// Upper bounds of the round trip histogram buckets in ms,
+	// the last bucket counts everything slower than that.
+	static constexpr auto kRoundTripBounds = std::array<crl::time, 7>{ {
+		50,
+		100,
+		200,
+		500,
+		1000,
+		2000,
+		5000,
+	} };
+	static constexpr auto kRoundTripBuckets = int(kRoundTripBounds.size()) + 1;
+
+	[[nodiscard]] static int RoundTripBucket(crl::time roundTrip) {
+		auto result = 0;
+		while (result != int(kRoundTripBounds.size())
+			&& roundTrip > kRoundTripBounds[result]) {
+			++result;
+		}
+		return result;
+	}
+
+	int64 compressedRequests = 0;
+	int64 compressedBytesSaved = 0;
+
+	// Sent packets with all the MTProto headers, padding and prefixes.
+	int64 sentPackets = 0;
+	int64 sentBytes = 0;
+
+	// Only the message bodies, the rest of sentBytes is the overhead.
+	int64 sentPayloadBytes = 0;
+
+	int64 sentContainers = 0;
+	int64 sentContainerMessages = 0;
+
+	// Background requests sent before their delay because of the size.
+	int64 earlyFlushes = 0;
+
+	int64 receivedPackets = 0;
+	int64 receivedBytes = 0;
+	int64 decryptMicroseconds = 0;
+
+	int64 resentRequests = 0;
+	int64 connectionChanges = 0;
+
+	// Time from a sent packet till the first received one.
+	std::array<int64, kRoundTripBuckets> roundTrips = { { 0 } };
+	crl::time roundTrip = 0; // Smoothed, zero if not measured yet.
+
+	int waitingToSend = 0;
+	int waitingForResponse = 0;
+
+	[[nodiscard]] float64 messagesPerContainer() const {
+		return sentContainers
+			? (sentContainerMessages / float64(sentContainers))
+			: 0.;
+	}
+	[[nodiscard]] float64 overheadPerPacket() const {
+		return sentPackets
+			? ((sentBytes - sentPayloadBytes) / float64(sentPackets))
+			: 0.;
+	}
+	[[nodiscard]] float64 decryptMicrosecondsPerPacket() const {
+		return receivedPackets
+			? (decryptMicroseconds / float64(receivedPackets))
+			: 0.;
+	}
+};
+
+struct SessionMetrics {
+	ShiftedDcId shiftedDcId = 0;
+	SessionStats stats;
+};
+
+} // namespace MTP
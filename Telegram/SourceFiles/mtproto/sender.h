@@ -12,6 +12,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/mtp_instance.h"
 #include "mtproto/facade.h"
 
+#include <crl/crl_queue.h>
+
 namespace MTP {
 
 class Sender {
@@ -44,17 +46,32 @@ class Sender {
 				handler(result, requestId);
 			}
 
+		};
+		class DoneHandlerBase : public RPCAbstractDoneHandler {
+		public:
+			// Responses read in background report read errors here.
+			void setFailHandler(RPCFailHandlerPtr handler) {
+				_fail = std::move(handler);
+			}
+
+		protected:
+			RPCFailHandlerPtr _fail;
+
 		};
 		template <typename Response, template <typename> typename PolicyTemplate>
-		class DoneHandler : public RPCAbstractDoneHandler {
+		class DoneHandler : public DoneHandlerBase {
 			using Policy = PolicyTemplate<Response>;
 			using Callback = typename Policy::Callback;
 
 		public:
-			DoneHandler(not_null<Sender*> sender, Callback handler) : _sender(sender), _handler(std::move(handler)) {
+			DoneHandler(not_null<Sender*> sender, Callback handler, bool parseInBackground) : _sender(sender), _handler(std::move(handler)), _parseInBackground(parseInBackground) {
 			}
 
 			bool operator()(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) override {
+				if (_parseInBackground) {
+					parseInBackground(requestId, from, end);
+					return true;
+				}
 				auto handler = std::move(_handler);
 				_sender->senderRequestHandled(requestId);
 
@@ -69,8 +86,49 @@ class Sender {
 			}
 
 		private:
+			// The response is copied and read on a worker thread, the
+			// handler is called on the main thread after that, unless
+			// the sender was destroyed or the request was cancelled.
+			// All the responses are read on one serial queue, so they
+			// reach their handlers in the order they were received.
+			void parseInBackground(mtpRequestId requestId, const mtpPrime *from, const mtpPrime *end) {
+				BackgroundParseQueue().async([
+					=,
+					buffer = std::vector<mtpPrime>(from, end),
+					handler = std::move(_handler),
+					fail = std::move(_fail),
+					sender = _sender,
+					alive = _sender->senderAliveToken()
+				]() mutable {
+					auto result = Response();
+					const mtpPrime *from = buffer.data();
+					const auto parsed = result.read(from, from + buffer.size());
+					crl::on_main([
+						=,
+						handler = std::move(handler),
+						result = std::move(result)
+					]() mutable {
+						if (!alive.lock()
+							|| !sender->senderRequestHandled(requestId)) {
+							return;
+						} else if (!parsed) {
+							LOG(("API Error: could not read response "
+								"for request %1.").arg(requestId));
+							if (fail) {
+								(*fail)(requestId, RPCError::Local(
+									"RESPONSE_PARSE_FAILED",
+									"Response parse failed."));
+							}
+						} else if (handler) {
+							Policy::handle(std::move(handler), requestId, std::move(result));
+						}
+					});
+				});
+			}
+
 			not_null<Sender*> _sender;
 			Callback _handler;
+			bool _parseInBackground = false;
 
 		};
 
@@ -136,9 +194,17 @@ class Sender {
 		void setCanWait(crl::time ms) noexcept {
 			_canWait = ms;
 		}
-		void setDoneHandler(RPCDoneHandlerPtr &&handler) noexcept {
+		void setDoneHandler(std::shared_ptr<DoneHandlerBase> &&handler) noexcept {
 			_done = std::move(handler);
 		}
+		void setParseInBackground() noexcept {
+			Expects(_done == nullptr);
+
+			_parseInBackground = true;
+		}
+		bool takeParseInBackground() const noexcept {
+			return _parseInBackground;
+		}
 		void setFailHandler(FailPlainHandler &&handler) noexcept {
 			_fail = std::move(handler);
 		}
@@ -158,7 +224,10 @@ class Sender {
 		crl::time takeCanWait() const noexcept {
 			return _canWait;
 		}
-		RPCDoneHandlerPtr takeOnDone() noexcept {
+		RPCDoneHandlerPtr takeOnDone(const RPCFailHandlerPtr &onFail) {
+			if (_done && _parseInBackground) {
+				_done->setFailHandler(onFail);
+			}
 			return std::move(_done);
 		}
 		RPCFailHandlerPtr takeOnFail() {
@@ -184,7 +253,8 @@ class Sender {
 		not_null<Sender*> _sender;
 		ShiftedDcId _dcId = 0;
 		crl::time _canWait = 0;
-		RPCDoneHandlerPtr _done;
+		std::shared_ptr<DoneHandlerBase> _done;
+		bool _parseInBackground = false;
 		base::variant<FailPlainHandler, FailRequestIdHandler> _fail;
 		FailSkipPolicy _failSkipPolicy = FailSkipPolicy::Simple;
 		mtpRequestId _afterRequestId = 0;
@@ -217,12 +287,18 @@ public:
 			setCanWait(ms);
 			return *this;
 		}
+		// Must be called before done() for large responses that are
+		// read from the buffer for too long on the main thread.
+		[[nodiscard]] SpecificRequestBuilder &parseInBackground() noexcept {
+			setParseInBackground();
+			return *this;
+		}
 		[[nodiscard]] SpecificRequestBuilder &done(FnMut<void(const typename Request::ResponseType &result)> callback) {
-			setDoneHandler(std::make_shared<DoneHandler<typename Request::ResponseType, DonePlainPolicy>>(sender(), std::move(callback)));
+			setDoneHandler(std::make_shared<DoneHandler<typename Request::ResponseType, DonePlainPolicy>>(sender(), std::move(callback), takeParseInBackground()));
 			return *this;
 		}
 		[[nodiscard]] SpecificRequestBuilder &done(FnMut<void(const typename Request::ResponseType &result, mtpRequestId requestId)> callback) {
-			setDoneHandler(std::make_shared<DoneHandler<typename Request::ResponseType, DoneRequestIdPolicy>>(sender(), std::move(callback)));
+			setDoneHandler(std::make_shared<DoneHandler<typename Request::ResponseType, DoneRequestIdPolicy>>(sender(), std::move(callback), takeParseInBackground()));
 			return *this;
 		}
 		[[nodiscard]] SpecificRequestBuilder &fail(FnMut<void(const RPCError &error)> callback) noexcept {
@@ -247,10 +323,12 @@ public:
 		}
 
 		mtpRequestId send() {
+			auto onFail = takeOnFail();
+			auto onDone = takeOnDone(onFail);
 			const auto id = sender()->instance()->send(
 				_request,
-				takeOnDone(),
-				takeOnFail(),
+				std::move(onDone),
+				std::move(onFail),
 				takeDcId(),
 				takeCanWait(),
 				takeAfter());
@@ -377,12 +455,21 @@ private:
 	void senderRequestRegister(mtpRequestId requestId) {
 		_requests.emplace(MainInstance(), requestId);
 	}
-	void senderRequestHandled(mtpRequestId requestId) {
+	bool senderRequestHandled(mtpRequestId requestId) {
 		auto it = _requests.find(requestId);
 		if (it != _requests.cend()) {
 			it->handled();
 			_requests.erase(it);
+			return true;
 		}
+		return false;
+	}
+	std::weak_ptr<bool> senderAliveToken() const {
+		return _alive;
+	}
+	static crl::queue &BackgroundParseQueue() {
+		static auto result = crl::queue();
+		return result;
 	}
 	void senderRequestCancel(mtpRequestId requestId) {
 		auto it = _requests.find(requestId);
@@ -393,6 +480,7 @@ private:
 
 	const not_null<Instance*> _instance;
 	base::flat_set<RequestWrap, RequestWrapComparator> _requests;
+	const std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
 
 };
 
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/session.h"
 
 #include "mtproto/details/mtproto_dcenter.h"
+#include "mtproto/details/mtproto_traffic_recorder.h"
 #include "mtproto/session_private.h"
 #include "mtproto/mtproto_auth_key.h"
 #include "base/unixtime.h"
@@ -16,6 +17,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace MTP {
 namespace details {
+namespace {
+
+// Requests that can wait are sent right away when they grow that large.
+constexpr auto kFlushWaitingBytes = 16 * 1024;
+
+} // namespace
 
 SessionOptions::SessionOptions(
 	const QString &systemLangCode,
@@ -146,6 +153,169 @@ void SessionData::destroyTemporaryKey(uint64 keyId) {
 	}
 }
 
+void SessionData::queueRequest(const SerializedRequest &request) {
+	QMutexLocker lock(&_queuedMutex);
+	_queued.push_back({ request });
+	_sendingIds.emplace(request->requestId);
+}
+
+void SessionData::queueCancel(mtpRequestId requestId, mtpMsgId msgId) {
+	QMutexLocker lock(&_queuedMutex);
+	_queued.push_back({ SerializedRequest(), requestId, msgId });
+	if (requestId) {
+		_sendingIds.remove(requestId);
+	}
+}
+
+int SessionData::queueWaitingBytes(int bytes) {
+	QMutexLocker lock(&_queuedMutex);
+	return (_waitingBytes += bytes);
+}
+
+bool SessionData::isSending(mtpRequestId requestId) const {
+	QMutexLocker lock(&_queuedMutex);
+	return _sendingIds.contains(requestId);
+}
+
+void SessionData::applyQueued() {
+	auto lock = QMutexLocker(&_queuedMutex);
+	const auto queued = base::take(_queued);
+	lock.unlock();
+
+	for (const auto &entry : queued) {
+		if (const auto &request = entry.request) {
+			_toSend.emplace(request->requestId, request);
+			continue;
+		}
+		if (const auto requestId = entry.cancelRequestId) {
+			_toSend.remove(requestId);
+		}
+		if (const auto msgId = entry.cancelMsgId) {
+			_haveSent.remove(msgId);
+		}
+	}
+}
+
+void SessionData::notifySent(
+		const base::flat_map<mtpRequestId, SerializedRequest> &requests) {
+	if (requests.empty()) {
+		return;
+	}
+	QMutexLocker lock(&_queuedMutex);
+
+	// The whole queue is flushed, start counting the waiting bytes anew.
+	_waitingBytes = 0;
+	for (const auto &[requestId, request] : requests) {
+		_sendingIds.remove(requestId);
+	}
+}
+
+void SessionData::notifyResending(mtpRequestId requestId) {
+	QMutexLocker lock(&_queuedMutex);
+	_sendingIds.emplace(requestId);
+}
+
+void SessionData::notifyResendingAcked(mtpRequestId requestId) {
+	QMutexLocker lock(&_queuedMutex);
+	_sendingIds.remove(requestId);
+}
+
+void SessionData::addReceivedResponse(
+		mtpRequestId requestId,
+		mtpBuffer &&response) {
+	QMutexLocker lock(&_receivedMutex);
+	_received.responses.emplace_back(requestId, std::move(response));
+}
+
+void SessionData::addReceivedUpdate(mtpBuffer &&update) {
+	QMutexLocker lock(&_receivedMutex);
+	_received.updates.push_back(std::move(update));
+}
+
+bool SessionData::hasReceived() const {
+	QMutexLocker lock(&_receivedMutex);
+	return !_received.responses.empty() || !_received.updates.empty();
+}
+
+auto SessionData::takeReceived() -> Received {
+	QMutexLocker lock(&_receivedMutex);
+	return base::take(_received);
+}
+
+void SessionData::notifyRequestCompressed(int64 bytesSaved) {
+	++_compressedRequests;
+	_compressedBytesSaved += bytesSaved;
+}
+
+void SessionData::notifyPacketSent(
+		int64 bytes,
+		int64 payload,
+		int containerMessages) {
+	++_sentPackets;
+	_sentBytes += bytes;
+	_sentPayloadBytes += payload;
+	if (containerMessages > 0) {
+		++_sentContainers;
+		_sentContainerMessages += containerMessages;
+	}
+}
+
+void SessionData::notifyEarlyFlush() {
+	++_earlyFlushes;
+}
+
+void SessionData::notifyPacketReceived(
+		int64 bytes,
+		int64 decryptMicroseconds) {
+	++_receivedPackets;
+	_receivedBytes += bytes;
+	_decryptMicroseconds += decryptMicroseconds;
+}
+
+void SessionData::notifyRoundTrip(crl::time sample, crl::time smoothed) {
+	++_roundTrips[SessionStats::RoundTripBucket(sample)];
+	_roundTrip = smoothed;
+}
+
+void SessionData::notifyResent() {
+	++_resentRequests;
+}
+
+void SessionData::notifyConnectionChanged() {
+	++_connectionChanges;
+}
+
+void SessionData::notifyWaitingForResponse(int count) {
+	_waitingForResponse = count;
+}
+
+SessionStats SessionData::stats() const {
+	auto result = SessionStats();
+	result.compressedRequests = _compressedRequests;
+	result.compressedBytesSaved = _compressedBytesSaved;
+	result.sentPackets = _sentPackets;
+	result.sentBytes = _sentBytes;
+	result.sentPayloadBytes = _sentPayloadBytes;
+	result.sentContainers = _sentContainers;
+	result.sentContainerMessages = _sentContainerMessages;
+	result.earlyFlushes = _earlyFlushes;
+	result.receivedPackets = _receivedPackets;
+	result.receivedBytes = _receivedBytes;
+	result.decryptMicroseconds = _decryptMicroseconds;
+	result.resentRequests = _resentRequests;
+	result.connectionChanges = _connectionChanges;
+	for (auto i = 0; i != SessionStats::kRoundTripBuckets; ++i) {
+		result.roundTrips[i] = _roundTrips[i];
+	}
+	result.roundTrip = _roundTrip;
+	result.waitingForResponse = _waitingForResponse;
+	{
+		QMutexLocker lock(&_queuedMutex);
+		result.waitingToSend = int(_sendingIds.size());
+	}
+	return result;
+}
+
 void SessionData::detach() {
 	QMutexLocker lock(&_ownerMutex);
 	_owner = nullptr;
@@ -357,13 +527,8 @@ void Session::resetDone() {
 }
 
 void Session::cancel(mtpRequestId requestId, mtpMsgId msgId) {
-	if (requestId) {
-		QWriteLocker locker(_data->toSendMutex());
-		_data->toSendMap().remove(requestId);
-	}
-	if (msgId) {
-		QWriteLocker locker(_data->haveSentMutex());
-		_data->haveSentMap().remove(msgId);
+	if (requestId || msgId) {
+		_data->queueCancel(requestId, msgId);
 	}
 }
 
@@ -396,8 +561,7 @@ int32 Session::requestState(mtpRequestId requestId) const {
 		return MTP::RequestSent;
 	}
 
-	QWriteLocker locker(_data->toSendMutex());
-	return _data->toSendMap().contains(requestId)
+	return _data->isSending(requestId)
 		? MTP::RequestSending
 		: MTP::RequestSent;
 }
@@ -434,14 +598,23 @@ void Session::sendPrepared(
 		crl::time msCanWait) {
 	DEBUG_LOG(("MTP Info: adding request to toSendMap, msCanWait %1"
 		).arg(msCanWait));
-	{
-		QWriteLocker locker(_data->toSendMutex());
-		_data->toSendMap().emplace(request->requestId, request);
-		*(mtpMsgId*)(request->data() + 4) = 0;
-		*(request->data() + 6) = 0;
-	}
+	*(mtpMsgId*)(request->data() + 4) = 0;
+	*(request->data() + 6) = 0;
+	_data->queueRequest(request);
 
 	DEBUG_LOG(("MTP Info: added, requestId %1").arg(request->requestId));
+	if (msCanWait > 0) {
+		// Small background requests are coalesced into one container,
+		// but there is no reason to hold a full container any longer.
+		const auto waiting = _data->queueWaitingBytes(
+			tl::count_length(request));
+		if (waiting >= kFlushWaitingBytes) {
+			DEBUG_LOG(("MTP Info: flushing %1 waiting bytes"
+				).arg(waiting));
+			_data->notifyEarlyFlush();
+			msCanWait = 0;
+		}
+	}
 	if (msCanWait >= 0) {
 		InvokeQueued(this, [=] {
 			sendAnything(msCanWait);
@@ -549,6 +722,10 @@ bool Session::connectionInited() const {
 	return _dc->connectionInited();
 }
 
+SessionStats Session::stats() const {
+	return _data->stats();
+}
+
 void Session::tryToReceive() {
 	if (_killed) {
 		DEBUG_LOG(("Session Error: can't receive in a killed session"));
@@ -559,14 +736,19 @@ void Session::tryToReceive() {
 		return;
 	}
 	while (true) {
-		auto lock = QWriteLocker(_data->haveReceivedMutex());
-		const auto responses = base::take(_data->haveReceivedResponses());
-		const auto updates = base::take(_data->haveReceivedUpdates());
-		lock.unlock();
+		const auto [responses, updates] = _data->takeReceived();
 		if (responses.empty() && updates.empty()) {
 			break;
 		}
+#ifdef _DEBUG
+		const auto recorder = _instance->trafficRecorder();
+#endif // _DEBUG
 		for (const auto &[requestId, response] : responses) {
+#ifdef _DEBUG
+			if (recorder) {
+				recorder->write(_shiftedDcId, requestId, response);
+			}
+#endif // _DEBUG
 			_instance->execCallback(
 				requestId,
 				response.constData(),
@@ -576,6 +758,11 @@ void Session::tryToReceive() {
 		// Call globalCallback only in main session.
 		if (_shiftedDcId == BareDcId(_shiftedDcId)) {
 			for (const auto &update : updates) {
+#ifdef _DEBUG
+				if (recorder) {
+					recorder->write(_shiftedDcId, 0, update);
+				}
+#endif // _DEBUG
 				_instance->globalCallback(
 					update.constData(),
 					update.constData() + update.size());
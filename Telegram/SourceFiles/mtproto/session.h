@@ -10,9 +10,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "mtproto/mtproto_rpc_sender.h"
 #include "mtproto/mtproto_proxy_data.h"
+#include "mtproto/mtproto_session_stats.h"
 #include "mtproto/details/mtproto_serialized_request.h"
 
 #include <QtCore/QTimer>
+#include <atomic>
 
 namespace MTP {
 
@@ -68,28 +70,33 @@ public:
 		return _options;
 	}
 
-	not_null<QReadWriteLock*> toSendMutex() {
-		return &_toSendLock;
-	}
-	not_null<QReadWriteLock*> haveSentMutex() {
-		return &_haveSentLock;
-	}
-	not_null<QReadWriteLock*> haveReceivedMutex() {
-		return &_haveReceivedLock;
-	}
-
+	struct Received {
+		std::vector<std::pair<mtpRequestId, mtpBuffer>> responses;
+		std::vector<mtpBuffer> updates;
+	};
+
+	// Session -> SessionPrivate interface, never waits for SessionPrivate.
+	void queueRequest(const SerializedRequest &request);
+	void queueCancel(mtpRequestId requestId, mtpMsgId msgId);
+	[[nodiscard]] int queueWaitingBytes(int bytes);
+	[[nodiscard]] bool isSending(mtpRequestId requestId) const;
+	[[nodiscard]] Received takeReceived();
+
+	// SessionPrivate thread only, these maps are not guarded.
+	void applyQueued();
+	void notifySent(
+		const base::flat_map<mtpRequestId, SerializedRequest> &requests);
+	void notifyResending(mtpRequestId requestId);
+	void notifyResendingAcked(mtpRequestId requestId);
 	base::flat_map<mtpRequestId, SerializedRequest> &toSendMap() {
 		return _toSend;
 	}
 	base::flat_map<mtpMsgId, SerializedRequest> &haveSentMap() {
 		return _haveSent;
 	}
-	base::flat_map<mtpRequestId, mtpBuffer> &haveReceivedResponses() {
-		return _receivedResponses;
-	}
-	std::vector<mtpBuffer> &haveReceivedUpdates() {
-		return _receivedUpdates;
-	}
+	void addReceivedResponse(mtpRequestId requestId, mtpBuffer &&response);
+	void addReceivedUpdate(mtpBuffer &&update);
+	[[nodiscard]] bool hasReceived() const;
 
 	// SessionPrivate -> Session interface.
 	void queueTryToReceive();
@@ -110,9 +117,26 @@ public:
 	void releaseKeyCreationOnFail();
 	void destroyTemporaryKey(uint64 keyId);
 
+	void notifyRequestCompressed(int64 bytesSaved);
+	void notifyPacketSent(int64 bytes, int64 payload, int containerMessages);
+	void notifyEarlyFlush();
+	void notifyPacketReceived(int64 bytes, int64 decryptMicroseconds);
+	void notifyRoundTrip(crl::time sample, crl::time smoothed);
+	void notifyResent();
+	void notifyConnectionChanged();
+	void notifyWaitingForResponse(int count);
+	[[nodiscard]] SessionStats stats() const;
+
 	void detach();
 
 private:
+	// Either a new request to send or a request to cancel.
+	struct Queued {
+		SerializedRequest request;
+		mtpRequestId cancelRequestId = 0;
+		mtpMsgId cancelMsgId = 0;
+	};
+
 	template <typename Callback>
 	void withSession(Callback &&callback);
 
@@ -122,15 +146,36 @@ private:
 	SessionOptions _options;
 	mutable QReadWriteLock _optionsLock;
 
-	base::flat_map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
-	QReadWriteLock _toSendLock;
+	// The lock is held only to push to or to swap the queue.
+	std::vector<Queued> _queued;
+	base::flat_set<mtpRequestId> _sendingIds; // queued or in _toSend
+	int _waitingBytes = 0; // queued requests that can wait, till sent
+	mutable QMutex _queuedMutex;
 
+	base::flat_map<mtpRequestId, SerializedRequest> _toSend; // map of request_id -> request, that is waiting to be sent
 	base::flat_map<mtpMsgId, SerializedRequest> _haveSent; // map of msg_id -> request, that was sent
-	QReadWriteLock _haveSentLock;
 
-	base::flat_map<mtpRequestId, mtpBuffer> _receivedResponses; // map of request_id -> response that should be processed in the main thread
-	std::vector<mtpBuffer> _receivedUpdates; // list of updates that should be processed in the main thread
-	QReadWriteLock _haveReceivedLock;
+	Received _received; // responses and updates that should be processed in the main thread
+	mutable QMutex _receivedMutex;
+
+	std::atomic<int64> _compressedRequests = 0;
+	std::atomic<int64> _compressedBytesSaved = 0;
+	std::atomic<int64> _sentPackets = 0;
+	std::atomic<int64> _sentBytes = 0;
+	std::atomic<int64> _sentPayloadBytes = 0;
+	std::atomic<int64> _sentContainers = 0;
+	std::atomic<int64> _sentContainerMessages = 0;
+	std::atomic<int64> _earlyFlushes = 0;
+	std::atomic<int64> _receivedPackets = 0;
+	std::atomic<int64> _receivedBytes = 0;
+	std::atomic<int64> _decryptMicroseconds = 0;
+	std::atomic<int64> _resentRequests = 0;
+	std::atomic<int64> _connectionChanges = 0;
+	std::array<
+		std::atomic<int64>,
+		SessionStats::kRoundTripBuckets> _roundTrips = {};
+	std::atomic<crl::time> _roundTrip = 0;
+	std::atomic<int> _waitingForResponse = 0;
 
 };
 
@@ -159,6 +204,7 @@ public:
 	[[nodiscard]] AuthKeyPtr getPersistentKey() const;
 	[[nodiscard]] AuthKeyPtr getTemporaryKey(TemporaryKeyType type) const;
 	[[nodiscard]] bool connectionInited() const;
+	[[nodiscard]] SessionStats stats() const;
 	void sendPrepared(
 		const SerializedRequest &request,
 		crl::time msCanWait = 0);
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/session_private.h"
 
 #include "mtproto/details/mtproto_bound_key_creator.h"
+#include "mtproto/details/mtproto_buffer_pool.h"
 #include "mtproto/details/mtproto_dcenter.h"
 #include "mtproto/details/mtproto_dump_to_text.h"
 #include "mtproto/details/mtproto_rsa_public_key.h"
@@ -20,12 +21,20 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/unixtime.h"
 #include "zlib.h"
 
+#include <QtNetwork/QNetworkInterface>
+
+#include <chrono>
+
 namespace MTP {
 namespace details {
 namespace {
 
 constexpr auto kIntSize = static_cast<int>(sizeof(mtpPrime));
 constexpr auto kWaitForBetterTimeout = crl::time(2000);
+constexpr auto kStartTestConnectionDelay = crl::time(250);
+
+// The endpoint that won on this network last time is tried alone first.
+constexpr auto kPreferredHeadStart = crl::time(1000);
 constexpr auto kMinConnectedTimeout = crl::time(1000);
 constexpr auto kMaxConnectedTimeout = crl::time(8000);
 constexpr auto kMinReceiveTimeout = crl::time(4000);
@@ -38,6 +47,7 @@ constexpr auto kTemporaryExpiresIn = TimeId(86400);
 constexpr auto kBindKeyAdditionalExpiresTimeout = TimeId(30);
 constexpr auto kTestModeDcIdShift = 10000;
 constexpr auto kCheckSentRequestsEach = 1 * crl::time(1000);
+constexpr auto kCheckSentRequestsIdleEach = 10 * crl::time(1000);
 constexpr auto kKeyOldEnoughForDestroy = 60 * crl::time(1000);
 constexpr auto kSentContainerLives = 600 * crl::time(1000);
 
@@ -57,6 +67,26 @@ constexpr auto kSendStateRequestWaiting = crl::time(1000);
 // How much time to wait for some more requests, when sending msg acks.
 constexpr auto kAckSendWaiting = 10 * crl::time(1000);
 
+// Send acks right away when there are that many of them.
+constexpr auto kAckFlushCount = 256;
+
+// Service requests wait for this many round trips to be batched together,
+// the waiting constants above are scaled by the measured round trip.
+constexpr auto kBatchRoundTrips = 2;
+
+// Don't ask for request state earlier than this many round trips.
+constexpr auto kCheckSentRoundTrips = 4;
+
+// Request bodies smaller than this are sent without gzip_packed.
+constexpr auto kCompressMinSize = 2048;
+
+// Larger bodies are compressed only if their beginning compresses well.
+constexpr auto kCompressSampleSize = 4096;
+
+// Received packets up to this size are decrypted right on this thread,
+// larger ones are handed to the background workers.
+constexpr auto kDecryptInPlaceMaxSize = 16 * 1024;
+
 using namespace details;
 
 [[nodiscard]] QString LogIdsVector(const QVector<MTPlong> &ids) {
@@ -104,8 +134,336 @@ void WrapInvokeAfter(
 	}
 }
 
+[[nodiscard]] QByteArray Gzip(const char *data, int size) {
+	z_stream stream;
+	stream.zalloc = 0;
+	stream.zfree = 0;
+	stream.opaque = 0;
+	const auto res = deflateInit2(
+		&stream,
+		Z_DEFAULT_COMPRESSION,
+		Z_DEFLATED,
+		16 + MAX_WBITS,
+		8,
+		Z_DEFAULT_STRATEGY);
+	if (res != Z_OK) {
+		LOG(("RPC Error: could not init zlib stream, code: %1").arg(res));
+		return QByteArray();
+	}
+	auto result = QByteArray(
+		int(deflateBound(&stream, size)),
+		Qt::Uninitialized);
+	stream.avail_in = size;
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+	stream.avail_out = result.size();
+	stream.next_out = reinterpret_cast<Bytef*>(result.data());
+	const auto finished = (deflate(&stream, Z_FINISH) == Z_STREAM_END);
+	const auto written = result.size() - int(stream.avail_out);
+	deflateEnd(&stream);
+	if (!finished) {
+		return QByteArray();
+	}
+	result.resize(written);
+	return result;
+}
+
+// Finds the bytes of a serialized TL string without copying them.
+[[nodiscard]] bytes::const_span ReadBytesInPlace(
+		const mtpPrime *from,
+		const mtpPrime *end) {
+	if (from >= end) {
+		return {};
+	}
+	const auto data = reinterpret_cast<const uchar*>(from);
+	const auto available = uint32(end - from) * sizeof(mtpPrime);
+	auto length = uint32(data[0]);
+	auto offset = uint32(1);
+	if (length == 254) {
+		length = uint32(data[1])
+			| (uint32(data[2]) << 8)
+			| (uint32(data[3]) << 16);
+		offset = 4;
+	} else if (length > 254) {
+		return {};
+	}
+	if (offset + length > available) {
+		return {};
+	}
+	return bytes::const_span(
+		reinterpret_cast<const bytes::type*>(data + offset),
+		length);
+}
+
+[[nodiscard]] bool CompressionPaysOff(const char *data, int size) {
+	if (size < kCompressMinSize) {
+		return false;
+	} else if (size <= kCompressSampleSize) {
+		return true;
+	}
+	const auto sample = Gzip(data, kCompressSampleSize);
+	return !sample.isEmpty()
+		&& (sample.size() * 8 < kCompressSampleSize * 7);
+}
+
+// Returns an empty request if the compressed body is not smaller.
+[[nodiscard]] SerializedRequest CompressRequest(
+		const SerializedRequest &request) {
+	const auto body = request->constData()
+		+ SerializedRequest::kMessageBodyPosition;
+	const auto size = int(tl::count_length(request));
+	switch (mtpTypeId(*body)) {
+	case mtpc_upload_saveFilePart:
+	case mtpc_upload_saveBigFilePart:
+		return SerializedRequest(); // File parts are compressed already.
+	}
+	const auto data = reinterpret_cast<const char*>(body);
+	if (!CompressionPaysOff(data, size)) {
+		return SerializedRequest();
+	}
+	const auto compressed = Gzip(data, size);
+	if (compressed.isEmpty()) {
+		return SerializedRequest();
+	}
+	const auto packed = MTP_bytes(compressed);
+	const auto packedSize = uint32(1 + (tl::count_length(packed) >> 2));
+	if (int(packedSize) * kIntSize >= size) {
+		return SerializedRequest();
+	}
+	auto result = SerializedRequest::Prepare(packedSize);
+	memcpy(
+		result->data(),
+		request->constData(),
+		SerializedRequest::kMessageLengthPosition * sizeof(mtpPrime));
+	result->push_back(mtpc_gzip_packed);
+	packed.write<mtpBuffer>(*result);
+	result->after = request->after;
+	result->lastSentTime = request->lastSentTime;
+	result->requestId = request->requestId;
+	result->needsLayer = request->needsLayer;
+	result->forceSendInContainer = request->forceSendInContainer;
+	return result;
+}
+
+// Decrypts and checks the received packet, may be called from any thread.
+// Returns an empty buffer if the packet is bad and we should restart.
+[[nodiscard]] QByteArray DecryptReceived(
+		const mtpBuffer &intsBuffer,
+		const AuthKeyPtr &key,
+		uint64 keyId) {
+	constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
+	constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
+	constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
+	constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
+	auto intsCount = uint32(intsBuffer.size());
+	auto ints = intsBuffer.constData();
+	if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
+		LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+
+		return QByteArray();
+	}
+	if (keyId != *(uint64*)ints) {
+		LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(keyId).arg(*(uint64*)ints));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+
+		return QByteArray();
+	}
+
+	auto encryptedInts = ints + kExternalHeaderIntsCount;
+	auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
+	auto encryptedBytesCount = encryptedIntsCount * kIntSize;
+	auto result = QByteArray(encryptedBytesCount, Qt::Uninitialized);
+	auto msgKey = *(MTPint128*)(ints + 2);
+
+#ifdef TDESKTOP_MTPROTO_OLD
+	aesIgeDecrypt_oldmtp(encryptedInts, result.data(), encryptedBytesCount, key, msgKey);
+#else // TDESKTOP_MTPROTO_OLD
+	aesIgeDecrypt(encryptedInts, result.data(), encryptedBytesCount, key, msgKey);
+#endif // TDESKTOP_MTPROTO_OLD
+
+	auto decryptedInts = reinterpret_cast<const mtpPrime*>(result.constData());
+	auto messageLength = *(uint32*)&decryptedInts[7];
+	if (messageLength > kMaxMessageLength) {
+		LOG(("TCP Error: bad messageLength %1").arg(messageLength));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
+
+		return QByteArray();
+	}
+	auto fullDataLength = kEncryptedHeaderIntsCount * kIntSize + messageLength; // Without padding.
+
+	// Can underflow, but it is an unsigned type, so we just check the range later.
+	auto paddingSize = static_cast<uint32>(encryptedBytesCount) - static_cast<uint32>(fullDataLength);
+
+#ifdef TDESKTOP_MTPROTO_OLD
+	constexpr auto kMinPaddingSize_oldmtp = 0U;
+	constexpr auto kMaxPaddingSize_oldmtp = 15U;
+	auto badMessageLength = (/*paddingSize < kMinPaddingSize_oldmtp || */paddingSize > kMaxPaddingSize_oldmtp);
+
+	auto hashedDataLength = badMessageLength ? encryptedBytesCount : fullDataLength;
+	auto sha1ForMsgKeyCheck = hashSha1(decryptedInts, hashedDataLength);
+
+	constexpr auto kMsgKeyShift_oldmtp = 4U;
+	if (memcmp(&msgKey, sha1ForMsgKeyCheck.data() + kMsgKeyShift_oldmtp, sizeof(msgKey)) != 0) {
+		LOG(("TCP Error: bad SHA1 hash after aesDecrypt in message."));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+
+		return QByteArray();
+	}
+#else // TDESKTOP_MTPROTO_OLD
+	constexpr auto kMinPaddingSize = 12U;
+	constexpr auto kMaxPaddingSize = 1024U;
+	auto badMessageLength = (paddingSize < kMinPaddingSize || paddingSize > kMaxPaddingSize);
+
+	std::array<uchar, 32> sha256Buffer = { { 0 } };
+
+	SHA256_CTX msgKeyLargeContext;
+	SHA256_Init(&msgKeyLargeContext);
+	SHA256_Update(&msgKeyLargeContext, key->partForMsgKey(false), 32);
+	SHA256_Update(&msgKeyLargeContext, decryptedInts, encryptedBytesCount);
+	SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
+
+	constexpr auto kMsgKeyShift = 8U;
+	if (memcmp(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey)) != 0) {
+		LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+
+		return QByteArray();
+	}
+#endif // TDESKTOP_MTPROTO_OLD
+
+	if (badMessageLength || (messageLength & 0x03)) {
+		LOG(("TCP Error: bad msg_len received %1, data size: %2").arg(messageLength).arg(encryptedBytesCount));
+		TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+
+		return QByteArray();
+	}
+	return result;
+}
+
+// Decrypts the packet and counts it with its decryption time in stats.
+[[nodiscard]] QByteArray DecryptAndCount(
+		const mtpBuffer &intsBuffer,
+		const AuthKeyPtr &key,
+		uint64 keyId,
+		const std::shared_ptr<SessionData> &data) {
+	using Clock = std::chrono::steady_clock;
+	const auto started = Clock::now();
+	auto result = DecryptReceived(intsBuffer, key, keyId);
+	const auto duration = Clock::now() - started;
+	data->notifyPacketReceived(
+		intsBuffer.size() * kIntSize,
+		std::chrono::duration_cast<std::chrono::microseconds>(
+			duration).count());
+	return result;
+}
+
+// Identifies the network we're on by the proxy and local subnets,
+// so that the best endpoint for it could be remembered.
+[[nodiscard]] QString ComputeNetworkKey(
+		const ProxyData &proxy,
+		DcType type) {
+	auto parts = QStringList();
+	for (const auto &address : QNetworkInterface::allAddresses()) {
+		if (address.isLoopback() || address.isLinkLocal()) {
+			continue;
+		} else if (address.protocol() == QAbstractSocket::IPv4Protocol) {
+			const auto subnet = address.toIPv4Address() & 0xFFFFFF00U;
+			parts.push_back(QString::number(subnet, 16));
+		} else if (address.protocol() == QAbstractSocket::IPv6Protocol) {
+			const auto ipv6 = address.toIPv6Address();
+			const auto subnet = QByteArray(
+				reinterpret_cast<const char*>(&ipv6[0]),
+				8);
+			parts.push_back(QString::fromLatin1(subnet.toHex()));
+		}
+	}
+	std::sort(begin(parts), end(parts));
+	parts.push_back(QString::number(int(proxy.type)));
+	parts.push_back(proxy.host);
+	parts.push_back(QString::number(proxy.port));
+	parts.push_back(QString::number(int(type)));
+
+	const auto utf8 = parts.join(' ').toUtf8();
+	const auto hash = openssl::Sha1(bytes::make_span(utf8));
+	return QString::fromLatin1(QByteArray(
+		reinterpret_cast<const char*>(hash.data()),
+		8).toHex());
+}
+
 } // namespace
 
+class SessionPrivate::DecryptQueue final {
+public:
+	explicit DecryptQueue(not_null<SessionPrivate*> owner);
+
+	[[nodiscard]] uint64 generation() const;
+
+	// Drops all the results and forgets the packets being decrypted now.
+	void invalidate();
+	void detach();
+
+	void push(uint64 generation, uint64 index, QByteArray &&decrypted);
+	[[nodiscard]] std::optional<QByteArray> take(uint64 index);
+
+private:
+	mutable QMutex _mutex;
+	SessionPrivate *_owner = nullptr;
+	uint64 _generation = 0;
+	base::flat_map<uint64, QByteArray> _ready;
+
+};
+
+SessionPrivate::DecryptQueue::DecryptQueue(not_null<SessionPrivate*> owner)
+: _owner(owner) {
+}
+
+uint64 SessionPrivate::DecryptQueue::generation() const {
+	QMutexLocker lock(&_mutex);
+	return _generation;
+}
+
+void SessionPrivate::DecryptQueue::invalidate() {
+	QMutexLocker lock(&_mutex);
+	++_generation;
+	_ready.clear();
+}
+
+void SessionPrivate::DecryptQueue::detach() {
+	QMutexLocker lock(&_mutex);
+	++_generation;
+	_ready.clear();
+	_owner = nullptr;
+}
+
+void SessionPrivate::DecryptQueue::push(
+		uint64 generation,
+		uint64 index,
+		QByteArray &&decrypted) {
+	QMutexLocker lock(&_mutex);
+	if (!_owner || _generation != generation) {
+		return;
+	}
+	_ready.emplace(index, std::move(decrypted));
+
+	// Posted events are removed with the receiver, and the receiver
+	// can't be destroyed while we hold the mutex, see detach().
+	InvokeQueued(_owner, [owner = _owner] {
+		owner->handleDecryptedQueue();
+	});
+}
+
+std::optional<QByteArray> SessionPrivate::DecryptQueue::take(
+		uint64 index) {
+	QMutexLocker lock(&_mutex);
+	const auto i = _ready.find(index);
+	if (i == end(_ready)) {
+		return std::nullopt;
+	}
+	auto result = std::move(i->second);
+	_ready.erase(i);
+	return result;
+}
+
 SessionPrivate::SessionPrivate(
 	not_null<Instance*> instance,
 	not_null<QThread*> thread,
@@ -122,11 +480,13 @@ SessionPrivate::SessionPrivate(
 , _waitForConnectedTimer(thread, [=] { waitConnectedFailed(); })
 , _waitForReceivedTimer(thread, [=] { waitReceivedFailed(); })
 , _waitForBetterTimer(thread, [=] { waitBetterFailed(); })
+, _startTestConnectionTimer(thread, [=] { startNextTestConnection(); })
 , _waitForReceived(kMinReceiveTimeout)
 , _waitForConnected(kMinConnectedTimeout)
 , _pingSender(thread, [=] { sendPingByTimer(); })
 , _checkSentRequestsTimer(thread, [=] { checkSentRequests(); })
-, _sessionData(std::move(data)) {
+, _sessionData(std::move(data))
+, _decryptQueue(std::make_shared<DecryptQueue>(this)) {
 	Expects(_shiftedDcId != 0);
 
 	moveToThread(thread);
@@ -141,6 +501,8 @@ SessionPrivate::~SessionPrivate() {
 	releaseKeyCreationOnFail();
 	doDisconnect();
 
+	_decryptQueue->detach();
+
 	Expects(!_connection);
 	Expects(_testConnections.empty());
 }
@@ -149,7 +511,8 @@ void SessionPrivate::appendTestConnection(
 		DcOptions::Variants::Protocol protocol,
 		const QString &ip,
 		int port,
-		const bytes::vector &protocolSecret) {
+		const bytes::vector &protocolSecret,
+		bool preferred) {
 	QWriteLocker lock(&_stateMutex);
 
 	const auto priority = (qthelp::is_ipv6(ip) ? 0 : 1)
@@ -162,7 +525,12 @@ void SessionPrivate::appendTestConnection(
 			thread(),
 			protocolSecret,
 			_options->proxy),
-		priority
+		priority,
+		protocol,
+		ip,
+		port,
+		protocolSecret,
+		preferred
 	});
 	const auto weak = _testConnections.back().data.get();
 	connect(weak, &AbstractConnection::error, [=](int errorCode) {
@@ -189,9 +557,32 @@ void SessionPrivate::appendTestConnection(
 		});
 	});
 
-	InvokeQueued(_testConnections.back().data, [=] {
+}
+
+void SessionPrivate::startNextTestConnection() {
+	const auto i = ranges::find(
+		_testConnections,
+		false,
+		&TestConnection::started);
+	if (i == end(_testConnections)) {
+		return;
+	}
+	i->started = true;
+
+	const auto weak = i->data.get();
+	const auto ip = i->ip;
+	const auto port = i->port;
+	const auto protocolSecret = i->protocolSecret;
+	InvokeQueued(weak, [=] {
 		weak->connectToServer(ip, port, protocolSecret, getProtocolDcId());
 	});
+
+	// Test connections are started in order, all the rest are waiting.
+	if (i + 1 != end(_testConnections)) {
+		_startTestConnectionTimer.callOnce(i->preferred
+			? kPreferredHeadStart
+			: kStartTestConnectionDelay);
+	}
 }
 
 int16 SessionPrivate::getProtocolDcId() const {
@@ -217,27 +608,65 @@ void SessionPrivate::checkSentRequests() {
 		restart();
 		return;
 	}
+	_sessionData->applyQueued();
+
 	auto requesting = false;
-	{
-		QReadLocker locker(_sessionData->haveSentMutex());
-		auto &haveSent = _sessionData->haveSentMap();
-		const auto haveSentCount = haveSent.size();
-		const auto checkAfter = kCheckSentRequestTimeout;
-		for (const auto &[msgId, request] : haveSent) {
-			if (request->lastSentTime + checkAfter < now) {
-				// Need to check state.
-				request->lastSentTime = now;
-				if (_stateRequestData.emplace(msgId).second) {
-					requesting = true;
-				}
+	const auto &haveSent = _sessionData->haveSentMap();
+	const auto checkAfter = std::max(
+		kCheckSentRequestTimeout,
+		_roundTrip * kCheckSentRoundTrips);
+	for (const auto &[msgId, request] : haveSent) {
+		if (request->lastSentTime + checkAfter < now) {
+			// Need to check state.
+			request->lastSentTime = now;
+			if (_stateRequestData.emplace(msgId).second) {
+				requesting = true;
 			}
 		}
 	}
 	if (requesting) {
-		_sessionData->queueSendAnything(kSendStateRequestWaiting);
+		_sessionData->queueSendAnything(
+			batchWaiting(kSendStateRequestWaiting));
+	}
+	_sessionData->notifyWaitingForResponse(int(haveSent.size()));
+
+	// Nothing to check until something is sent, don't wake up each second.
+	const auto idle = haveSent.empty() && !_bindMsgId;
+	if (_checkSentRequestsIdle != idle) {
+		_checkSentRequestsIdle = idle;
+		_checkSentRequestsTimer.callEach(idle
+			? kCheckSentRequestsIdleEach
+			: kCheckSentRequestsEach);
 	}
 }
 
+void SessionPrivate::notifyPacketSent(
+		const SerializedRequest &request,
+		int64 bytes) {
+	if (base::take(_checkSentRequestsIdle)) {
+		_checkSentRequestsTimer.callEach(kCheckSentRequestsEach);
+	}
+	const auto body = request->constData()
+		+ SerializedRequest::kMessageBodyPosition;
+	const auto bodyBytes = int64(tl::count_length(request));
+	if (mtpTypeId(body[0]) != mtpc_msg_container) {
+		_sessionData->notifyPacketSent(bytes, bodyBytes, 0);
+		return;
+	}
+	// Container has a cons and a count, each message has 4 ints header.
+	const auto messages = int(body[1]);
+	const auto headers = (2 + 4 * int64(messages)) * kIntSize;
+	_sessionData->notifyPacketSent(bytes, bodyBytes - headers, messages);
+}
+
+crl::time SessionPrivate::batchWaiting(crl::time limit) const {
+	// Without measurements keep the old fixed timeouts.
+	if (!_roundTrip) {
+		return limit;
+	}
+	return std::clamp(_roundTrip * kBatchRoundTrips, limit / 4, limit);
+}
+
 void SessionPrivate::clearOldContainers() {
 	auto resent = false;
 	const auto now = crl::now();
@@ -269,10 +698,14 @@ void SessionPrivate::clearOldContainers() {
 void SessionPrivate::destroyAllConnections() {
 	clearUnboundKeyCreator();
 	_waitForBetterTimer.cancel();
+	_startTestConnectionTimer.cancel();
 	_waitForReceivedTimer.cancel();
 	_waitForConnectedTimer.cancel();
 	_testConnections.clear();
 	_connection = nullptr;
+
+	_decryptQueue->invalidate();
+	_decryptNextIndex = _decryptConsumeIndex = 0;
 }
 
 void SessionPrivate::cdnConfigChanged() {
@@ -418,8 +851,7 @@ mtpMsgId SessionPrivate::replaceMsgId(SerializedRequest &request, mtpMsgId newId
 	if (oldMsgId == newId) {
 		return newId;
 	}
-	// haveSentMutex() was locked in tryToSend()
-	auto &haveSent = _sessionData->haveSentMap();
+	const auto &haveSent = _sessionData->haveSentMap();
 
 	while (_resendingIds.contains(newId)
 		|| _ackedIds.contains(newId)
@@ -563,7 +995,9 @@ void SessionPrivate::tryToSend() {
 			stateRequest = SerializedRequest::Serialize(MTPMsgsStateReq(
 				MTP_msgs_state_req(MTP_vector<MTPlong>(ids))));
 		}
-		if (_connection->usingHttpWait()) {
+		// Only one http_wait is held by the server at a time, other sends
+		// are answered right away and don't take the pooled connections.
+		if (_connection->usingHttpWait() && _connection->needHttpWait()) {
 			httpWaitRequest = SerializedRequest::Serialize(MTPHttpWait(
 				MTP_http_wait(MTP_int(100), MTP_int(30), MTP_int(25000))));
 		}
@@ -628,15 +1062,14 @@ void SessionPrivate::tryToSend() {
 	bool needAnyResponse = false;
 	SerializedRequest toSendRequest;
 	{
-		QWriteLocker locker1(_sessionData->toSendMutex());
+		if (sendAll) {
+			_sessionData->applyQueued();
+		}
 
 		auto toSendDummy = base::flat_map<mtpRequestId, SerializedRequest>();
 		auto &toSend = sendAll
 			? _sessionData->toSendMap()
 			: toSendDummy;
-		if (!sendAll) {
-			locker1.unlock();
-		}
 
 		uint32 toSendCount = toSend.size();
 		if (pingRequest) ++toSendCount;
@@ -665,10 +1098,8 @@ void SessionPrivate::tryToSend() {
 			: toSend.begin()->second;
 		if (toSendCount == 1 && !first->forceSendInContainer) {
 			toSendRequest = first;
-			if (sendAll) {
-				toSend.clear();
-				locker1.unlock();
-			}
+			_sessionData->notifySent(toSend);
+			toSend.clear();
 
 			const auto msgId = prepareToSend(
 				toSendRequest,
@@ -692,7 +1123,6 @@ void SessionPrivate::tryToSend() {
 				if (toSendRequest.needAck()) {
 					toSendRequest->lastSentTime = crl::now();
 
-					QWriteLocker locker2(_sessionData->haveSentMutex());
 					auto &haveSent = _sessionData->haveSentMap();
 					haveSent.emplace(msgId, toSendRequest);
 
@@ -720,6 +1150,11 @@ void SessionPrivate::tryToSend() {
 						toSendRequest = std::move(wrappedRequest);
 					}
 
+					// Only the outermost body, the wrappers are packed with it.
+					if (auto compressed = compressRequest(toSendRequest)) {
+						toSendRequest = std::move(compressed);
+					}
+
 					needAnyResponse = true;
 				} else {
 					_ackedIds.emplace(msgId, toSendRequest->requestId);
@@ -758,8 +1193,6 @@ void SessionPrivate::tryToSend() {
 			// check for a valid container
 			auto bigMsgId = base::unixtime::mtproto_msg_id();
 
-			// the fact of this lock is used in replaceMsgId()
-			QWriteLocker locker2(_sessionData->haveSentMutex());
 			auto &haveSent = _sessionData->haveSentMap();
 
 			// prepare sent container
@@ -767,6 +1200,8 @@ void SessionPrivate::tryToSend() {
 			sentIdsWrap.sent = crl::now();
 			sentIdsWrap.messages.reserve(toSendCount);
 
+			auto containerCompressed = false;
+
 			if (bindDcKeyRequest) {
 				_bindMsgId = placeToContainer(
 					toSendRequest,
@@ -794,22 +1229,32 @@ void SessionPrivate::tryToSend() {
 					bigMsgId = base::unixtime::mtproto_msg_id();
 				}
 				bool added = false;
+				auto sending = request;
 				if (request->requestId) {
 					if (request.needAck()) {
 						request->lastSentTime = crl::now();
 						int32 reqNeedsLayer = (needsLayer && request->needsLayer) ? toSendRequest->size() : 0;
+
+						// The wrappers are written right into the container,
+						// so only the requests sent as they are get packed.
+						if (!request->after && !reqNeedsLayer) {
+							if (auto compressed = compressRequest(request)) {
+								sending = std::move(compressed);
+								containerCompressed = true;
+							}
+						}
 						if (request->after) {
-							WrapInvokeAfter(toSendRequest, request, haveSent, reqNeedsLayer ? initSizeInInts : 0);
+							WrapInvokeAfter(toSendRequest, sending, haveSent, reqNeedsLayer ? initSizeInInts : 0);
 							if (reqNeedsLayer) {
 								memcpy(toSendRequest->data() + reqNeedsLayer + 4, initSerialized.constData(), initSize);
 								*(toSendRequest->data() + reqNeedsLayer + 3) += initSize;
 							}
 							added = true;
 						} else if (reqNeedsLayer) {
-							toSendRequest->resize(reqNeedsLayer + initSizeInInts + request.messageSize());
-							memcpy(toSendRequest->data() + reqNeedsLayer, request->constData() + 4, 4 * sizeof(mtpPrime));
+							toSendRequest->resize(reqNeedsLayer + initSizeInInts + sending.messageSize());
+							memcpy(toSendRequest->data() + reqNeedsLayer, sending->constData() + 4, 4 * sizeof(mtpPrime));
 							memcpy(toSendRequest->data() + reqNeedsLayer + 4, initSerialized.constData(), initSize);
-							memcpy(toSendRequest->data() + reqNeedsLayer + 4 + initSizeInInts, request->constData() + 8, tl::count_length(request));
+							memcpy(toSendRequest->data() + reqNeedsLayer + 4 + initSizeInInts, sending->constData() + 8, tl::count_length(sending));
 							*(toSendRequest->data() + reqNeedsLayer + 3) += initSize;
 							added = true;
 						}
@@ -824,11 +1269,12 @@ void SessionPrivate::tryToSend() {
 					}
 				}
 				if (!added) {
-					uint32 from = toSendRequest->size(), len = request.messageSize();
+					uint32 from = toSendRequest->size(), len = sending.messageSize();
 					toSendRequest->resize(from + len);
-					memcpy(toSendRequest->data() + from, request->constData() + 4, len * sizeof(mtpPrime));
+					memcpy(toSendRequest->data() + from, sending->constData() + 4, len * sizeof(mtpPrime));
 				}
 			}
+			_sessionData->notifySent(toSend);
 			toSend.clear();
 
 			if (stateRequest) {
@@ -864,6 +1310,13 @@ void SessionPrivate::tryToSend() {
 					httpWaitRequest);
 			}
 
+			if (containerCompressed) {
+				// Container size was counted for the uncompressed messages.
+				const auto body = SerializedRequest::kMessageBodyPosition;
+				(*toSendRequest)[SerializedRequest::kMessageLengthPosition]
+					= (toSendRequest->size() - body) * kIntSize;
+			}
+
 			const auto containerMsgId = prepareToSend(
 				toSendRequest,
 				bigMsgId,
@@ -872,6 +1325,8 @@ void SessionPrivate::tryToSend() {
 		}
 	}
 	sendSecureRequest(std::move(toSendRequest), needAnyResponse);
+	_sessionData->notifyWaitingForResponse(
+		int(_sessionData->haveSentMap().size()));
 }
 
 void SessionPrivate::retryByTimer() {
@@ -914,6 +1369,7 @@ void SessionPrivate::connectToServer(bool afterConfig) {
 			return;
 		}
 	}
+	_networkKey = QString();
 	if (_options->proxy.type == ProxyData::Type::Mtproto) {
 		// host, port, secret for mtproto proxy are taken from proxy.
 		appendTestConnection(DcOptions::Variants::Tcp, {}, 0, {});
@@ -924,6 +1380,12 @@ void SessionPrivate::connectToServer(bool afterConfig) {
 			bareDc,
 			_currentDcType,
 			_options->proxy.type != ProxyData::Type::None);
+		if (!special) {
+			_networkKey = ComputeNetworkKey(_options->proxy, _currentDcType);
+		}
+		const auto preferred = _networkKey.isEmpty()
+			? std::nullopt
+			: _instance->dcOptions()->lookupPreferred(bareDc, _networkKey);
 		const auto useIPv4 = special ? true : _options->useIPv4;
 		const auto useIPv6 = special ? false : _options->useIPv6;
 		const auto useTcp = special ? true : _options->useTcp;
@@ -947,11 +1409,16 @@ void SessionPrivate::connectToServer(bool afterConfig) {
 					continue;
 				}
 				for (const auto &endpoint : variants.data[address][protocol]) {
+					const auto isPreferred = preferred
+						&& (preferred->protocol == protocol)
+						&& (preferred->ip == endpoint.ip)
+						&& (preferred->port == endpoint.port);
 					appendTestConnection(
 						static_cast<Variants::Protocol>(protocol),
 						QString::fromStdString(endpoint.ip),
 						endpoint.port,
-						endpoint.secret);
+						endpoint.secret,
+						isPreferred);
 				}
 			}
 		}
@@ -993,6 +1460,16 @@ void SessionPrivate::connectToServer(bool afterConfig) {
 	_pingSender.cancel();
 
 	_waitForConnectedTimer.callOnce(_waitForConnected);
+
+	// The preferred endpoint goes first, then the best by priority.
+	std::stable_sort(
+		begin(_testConnections),
+		end(_testConnections),
+		[](const TestConnection &a, const TestConnection &b) {
+			return std::make_pair(a.preferred, a.priority)
+				> std::make_pair(b.preferred, b.priority);
+		});
+	startNextTestConnection();
 }
 
 void SessionPrivate::restart() {
@@ -1052,6 +1529,10 @@ void SessionPrivate::onReceivedSome() {
 		if (ms > 0 && ms * 2 < _waitForReceived) {
 			_waitForReceived = qMax(ms * 2, kMinReceiveTimeout);
 		}
+		if (ms > 0) {
+			_roundTrip = _roundTrip ? ((_roundTrip * 7 + ms) / 8) : ms;
+			_sessionData->notifyRoundTrip(ms, _roundTrip);
+		}
 		_firstSentAt = -1;
 	}
 }
@@ -1154,201 +1635,172 @@ void SessionPrivate::requestCDNConfig() {
 void SessionPrivate::handleReceived() {
 	Expects(_encryptionKey != nullptr);
 
+	const auto span = Logs::TraceSpan("mtp", "handleReceived");
+
 	onReceivedSome();
 
 	while (!_connection->received().empty()) {
 		auto intsBuffer = std::move(_connection->received().front());
 		_connection->received().pop_front();
 
-		constexpr auto kExternalHeaderIntsCount = 6U; // 2 auth_key_id, 4 msg_key
-		constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
-		constexpr auto kMinimalEncryptedIntsCount = kEncryptedHeaderIntsCount + 4U; // + 1 data + 3 padding
-		constexpr auto kMinimalIntsCount = kExternalHeaderIntsCount + kMinimalEncryptedIntsCount;
-		auto intsCount = uint32(intsBuffer.size());
-		auto ints = intsBuffer.constData();
-		if ((intsCount < kMinimalIntsCount) || (intsCount > kMaxMessageLength / kIntSize)) {
-			LOG(("TCP Error: bad message received, len %1").arg(intsCount * kIntSize));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
-
-			return restart();
-		}
-		if (_keyId != *(uint64*)ints) {
-			LOG(("TCP Error: bad auth_key_id %1 instead of %2 received").arg(_keyId).arg(*(uint64*)ints));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
-
-			return restart();
-		}
-
-		auto encryptedInts = ints + kExternalHeaderIntsCount;
-		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
-		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
-		auto msgKey = *(MTPint128*)(ints + 2);
-
-#ifdef TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt_oldmtp(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, _encryptionKey, msgKey);
-#else // TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, _encryptionKey, msgKey);
-#endif // TDESKTOP_MTPROTO_OLD
-
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
-		auto serverSalt = *(uint64*)&decryptedInts[0];
-		auto session = *(uint64*)&decryptedInts[2];
-		auto msgId = *(uint64*)&decryptedInts[4];
-		auto seqNo = *(uint32*)&decryptedInts[6];
-		auto needAck = ((seqNo & 0x01) != 0);
-
-		auto messageLength = *(uint32*)&decryptedInts[7];
-		if (messageLength > kMaxMessageLength) {
-			LOG(("TCP Error: bad messageLength %1").arg(messageLength));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(ints, intsCount * kIntSize).str()));
-
-			return restart();
-
+		const auto index = _decryptNextIndex++;
+		const auto size = intsBuffer.size() * kIntSize;
+		if (index == _decryptConsumeIndex && size <= kDecryptInPlaceMaxSize) {
+			++_decryptConsumeIndex;
+			auto decrypted = DecryptAndCount(
+				intsBuffer,
+				_encryptionKey,
+				_keyId,
+				_sessionData);
+			_instance->bufferPool()->release(std::move(intsBuffer));
+			if (!handleDecrypted(std::move(decrypted))) {
+				return;
+			}
+		} else {
+			crl::async([
+				queue = _decryptQueue,
+				generation = _decryptQueue->generation(),
+				index,
+				buffer = std::move(intsBuffer),
+				key = _encryptionKey,
+				keyId = _keyId,
+				data = _sessionData,
+				pool = _instance->bufferPool()
+			]() mutable {
+				auto decrypted = DecryptAndCount(buffer, key, keyId, data);
+				pool->release(std::move(buffer));
+				queue->push(generation, index, std::move(decrypted));
+			});
 		}
-		auto fullDataLength = kEncryptedHeaderIntsCount * kIntSize + messageLength; // Without padding.
-
-		// Can underflow, but it is an unsigned type, so we just check the range later.
-		auto paddingSize = static_cast<uint32>(encryptedBytesCount) - static_cast<uint32>(fullDataLength);
-
-#ifdef TDESKTOP_MTPROTO_OLD
-		constexpr auto kMinPaddingSize_oldmtp = 0U;
-		constexpr auto kMaxPaddingSize_oldmtp = 15U;
-		auto badMessageLength = (/*paddingSize < kMinPaddingSize_oldmtp || */paddingSize > kMaxPaddingSize_oldmtp);
-
-		auto hashedDataLength = badMessageLength ? encryptedBytesCount : fullDataLength;
-		auto sha1ForMsgKeyCheck = hashSha1(decryptedInts, hashedDataLength);
-
-		constexpr auto kMsgKeyShift_oldmtp = 4U;
-		if (memcmp(&msgKey, sha1ForMsgKeyCheck.data() + kMsgKeyShift_oldmtp, sizeof(msgKey)) != 0) {
-			LOG(("TCP Error: bad SHA1 hash after aesDecrypt in message."));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+	}
+	if (_connection->needHttpWait()) {
+		_sessionData->queueSendAnything();
+	}
+}
 
-			return restart();
+void SessionPrivate::handleDecryptedQueue() {
+	if (!_connection || !_encryptionKey) {
+		return;
+	}
+	while (_decryptConsumeIndex != _decryptNextIndex) {
+		auto decrypted = _decryptQueue->take(_decryptConsumeIndex);
+		if (!decrypted) {
+			return;
 		}
-#else // TDESKTOP_MTPROTO_OLD
-		constexpr auto kMinPaddingSize = 12U;
-		constexpr auto kMaxPaddingSize = 1024U;
-		auto badMessageLength = (paddingSize < kMinPaddingSize || paddingSize > kMaxPaddingSize);
-
-		std::array<uchar, 32> sha256Buffer = { { 0 } };
-
-		SHA256_CTX msgKeyLargeContext;
-		SHA256_Init(&msgKeyLargeContext);
-		SHA256_Update(&msgKeyLargeContext, _encryptionKey->partForMsgKey(false), 32);
-		SHA256_Update(&msgKeyLargeContext, decryptedInts, encryptedBytesCount);
-		SHA256_Final(sha256Buffer.data(), &msgKeyLargeContext);
-
-		constexpr auto kMsgKeyShift = 8U;
-		if (memcmp(&msgKey, sha256Buffer.data() + kMsgKeyShift, sizeof(msgKey)) != 0) {
-			LOG(("TCP Error: bad SHA256 hash after aesDecrypt in message"));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
-
-			return restart();
+		++_decryptConsumeIndex;
+		if (!handleDecrypted(std::move(*decrypted))) {
+			return;
 		}
-#endif // TDESKTOP_MTPROTO_OLD
+	}
+}
 
-		if (badMessageLength || (messageLength & 0x03)) {
-			LOG(("TCP Error: bad msg_len received %1, data size: %2").arg(messageLength).arg(encryptedBytesCount));
-			TCP_LOG(("TCP Error: bad message %1").arg(Logs::mb(encryptedInts, encryptedBytesCount).str()));
+bool SessionPrivate::handleDecrypted(QByteArray &&decrypted) {
+	Expects(_encryptionKey != nullptr);
 
-			return restart();
-		}
+	if (decrypted.isEmpty()) {
+		restart();
+		return false;
+	}
+	constexpr auto kEncryptedHeaderIntsCount = 8U; // 2 salt, 2 session, 2 msg_id, 1 seq_no, 1 length
+	auto decryptedInts = reinterpret_cast<const mtpPrime*>(decrypted.constData());
+	auto serverSalt = *(uint64*)&decryptedInts[0];
+	auto session = *(uint64*)&decryptedInts[2];
+	auto msgId = *(uint64*)&decryptedInts[4];
+	auto seqNo = *(uint32*)&decryptedInts[6];
+	auto needAck = ((seqNo & 0x01) != 0);
+	auto messageLength = *(uint32*)&decryptedInts[7];
+	auto fullDataLength = kEncryptedHeaderIntsCount * kIntSize + messageLength; // Without padding.
 
-		TCP_LOG(("TCP Info: decrypted message %1,%2,%3 is %4 len").arg(msgId).arg(seqNo).arg(Logs::b(needAck)).arg(fullDataLength));
+	TCP_LOG(("TCP Info: decrypted message %1,%2,%3 is %4 len").arg(msgId).arg(seqNo).arg(Logs::b(needAck)).arg(fullDataLength));
 
-		if (session != _sessionId) {
-			LOG(("MTP Error: bad server session received"));
-			TCP_LOG(("MTP Error: bad server session %1 instead of %2 in message received").arg(session).arg(_sessionId));
+	if (session != _sessionId) {
+		LOG(("MTP Error: bad server session received"));
+		TCP_LOG(("MTP Error: bad server session %1 instead of %2 in message received").arg(session).arg(_sessionId));
 
-			return restart();
-		}
+		restart();
+		return false;
+	}
 
-		const auto serverTime = int32(msgId >> 32);
-		const auto isReply = ((msgId & 0x03) == 1);
-		if (!isReply && ((msgId & 0x03) != 3)) {
-			LOG(("MTP Error: bad msg_id %1 in message received").arg(msgId));
+	const auto serverTime = int32(msgId >> 32);
+	const auto isReply = ((msgId & 0x03) == 1);
+	if (!isReply && ((msgId & 0x03) != 3)) {
+		LOG(("MTP Error: bad msg_id %1 in message received").arg(msgId));
 
-			return restart();
-		}
+		restart();
+		return false;
+	}
 
-		const auto clientTime = base::unixtime::now();
-		const auto badTime = (serverTime > clientTime + 60)
-			|| (serverTime + 300 < clientTime);
-		if (badTime) {
-			DEBUG_LOG(("MTP Info: bad server time from msg_id: %1, my time: %2").arg(serverTime).arg(clientTime));
-		}
+	const auto clientTime = base::unixtime::now();
+	const auto badTime = (serverTime > clientTime + 60)
+		|| (serverTime + 300 < clientTime);
+	if (badTime) {
+		DEBUG_LOG(("MTP Info: bad server time from msg_id: %1, my time: %2").arg(serverTime).arg(clientTime));
+	}
 
-		bool wasConnected = (getState() == ConnectedState);
-		if (serverSalt != _sessionSalt) {
-			if (!badTime) {
-				DEBUG_LOG(("MTP Info: other salt received... received: %1, my salt: %2, updating...").arg(serverSalt).arg(_sessionSalt));
-				_sessionSalt = serverSalt;
+	bool wasConnected = (getState() == ConnectedState);
+	if (serverSalt != _sessionSalt) {
+		if (!badTime) {
+			DEBUG_LOG(("MTP Info: other salt received... received: %1, my salt: %2, updating...").arg(serverSalt).arg(_sessionSalt));
+			_sessionSalt = serverSalt;
 
-				if (setState(ConnectedState, ConnectingState)) {
-					resendAll();
-				}
-			} else {
-				DEBUG_LOG(("MTP Info: other salt received... received: %1, my salt: %2").arg(serverSalt).arg(_sessionSalt));
+			if (setState(ConnectedState, ConnectingState)) {
+				resendAll();
 			}
 		} else {
-			serverSalt = 0; // dont pass to handle method, so not to lock in setSalt()
+			DEBUG_LOG(("MTP Info: other salt received... received: %1, my salt: %2").arg(serverSalt).arg(_sessionSalt));
 		}
+	} else {
+		serverSalt = 0; // dont pass to handle method, so not to lock in setSalt()
+	}
 
-		if (needAck) _ackRequestData.push_back(MTP_long(msgId));
-
-		auto res = HandleResult::Success; // if no need to handle, then succeed
-		auto from = decryptedInts + kEncryptedHeaderIntsCount;
-		auto end = from + (messageLength / kIntSize);
-		auto sfrom = decryptedInts + 4U; // msg_id + seq_no + length + message
-		MTP_LOG(_shiftedDcId, ("Recv: ")
-			+ DumpToText(sfrom, end)
-			+ QString(" (protocolDcId:%1,key:%2)"
-			).arg(getProtocolDcId()
-			).arg(_encryptionKey->keyId()));
+	if (needAck) _ackRequestData.push_back(MTP_long(msgId));
 
-		if (_receivedMessageIds.registerMsgId(msgId, needAck)) {
-			res = handleOneReceived(from, end, msgId, serverTime, serverSalt, badTime);
-		}
-		_receivedMessageIds.shrink();
+	auto res = HandleResult::Success; // if no need to handle, then succeed
+	auto from = decryptedInts + kEncryptedHeaderIntsCount;
+	auto end = from + (messageLength / kIntSize);
+	auto sfrom = decryptedInts + 4U; // msg_id + seq_no + length + message
+	MTP_LOG(_shiftedDcId, ("Recv: ")
+		+ DumpToText(sfrom, end)
+		+ QString(" (protocolDcId:%1,key:%2)"
+		).arg(getProtocolDcId()
+		).arg(_encryptionKey->keyId()));
 
-		// send acks
-		if (const auto toAckSize = _ackRequestData.size()) {
-			DEBUG_LOG(("MTP Info: will send %1 acks, ids: %2").arg(toAckSize).arg(LogIdsVector(_ackRequestData)));
-			_sessionData->queueSendAnything(kAckSendWaiting);
-		}
+	if (_receivedMessageIds.registerMsgId(msgId, needAck)) {
+		res = handleOneReceived(from, end, msgId, serverTime, serverSalt, badTime);
+	}
 
-		auto lock = QReadLocker(_sessionData->haveReceivedMutex());
-		const auto tryToReceive = !_sessionData->haveReceivedResponses().empty()
-			|| !_sessionData->haveReceivedUpdates().empty();
-		lock.unlock();
+	// send acks
+	if (const auto toAckSize = _ackRequestData.size()) {
+		DEBUG_LOG(("MTP Info: will send %1 acks, ids: %2").arg(toAckSize).arg(LogIdsVector(_ackRequestData)));
+		_sessionData->queueSendAnything((toAckSize >= kAckFlushCount)
+			? 0
+			: batchWaiting(kAckSendWaiting));
+	}
 
-		if (tryToReceive) {
-			DEBUG_LOG(("MTP Info: queueTryToReceive() - need to parse in another thread, %1 responses, %2 updates.").arg(_sessionData->haveReceivedResponses().size()).arg(_sessionData->haveReceivedUpdates().size()));
-			_sessionData->queueTryToReceive();
-		}
+	if (_sessionData->hasReceived()) {
+		DEBUG_LOG(("MTP Info: queueTryToReceive() - need to parse in another thread."));
+		_sessionData->queueTryToReceive();
+	}
 
-		if (res != HandleResult::Success && res != HandleResult::Ignored) {
-			if (res == HandleResult::DestroyTemporaryKey) {
-				destroyTemporaryKey();
-			} else if (res == HandleResult::ResetSession) {
-				_needSessionReset = true;
-			}
-			return restart();
+	if (res != HandleResult::Success && res != HandleResult::Ignored) {
+		if (res == HandleResult::DestroyTemporaryKey) {
+			destroyTemporaryKey();
+		} else if (res == HandleResult::ResetSession) {
+			_needSessionReset = true;
 		}
-		_retryTimeout = 1; // reset restart() timer
+		restart();
+		return false;
+	}
+	_retryTimeout = 1; // reset restart() timer
 
-		_startedConnectingAt = crl::time(0);
+	_startedConnectingAt = crl::time(0);
 
-		if (!wasConnected) {
-			if (getState() == ConnectedState) {
-				_sessionData->queueNeedToResumeAndSend();
-			}
+	if (!wasConnected) {
+		if (getState() == ConnectedState) {
+			_sessionData->queueNeedToResumeAndSend();
 		}
 	}
-	if (_connection->needHttpWait()) {
-		_sessionData->queueSendAnything();
-	}
+	return true;
 }
 
 SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
@@ -1529,8 +1981,9 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 				)).write(response);
 
 				// Save rpc_error for processing in the main thread.
-				QWriteLocker locker(_sessionData->haveReceivedMutex());
-				_sessionData->haveReceivedResponses().emplace(requestId, response);
+				_sessionData->addReceivedResponse(
+					requestId,
+					std::move(response));
 			} else {
 				DEBUG_LOG(("Message Error: "
 					"such message was not sent recently %1").arg(badMsgId));
@@ -1743,8 +2196,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		const auto requestId = wasSent(requestMsgId);
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
 			// Save rpc_result for processing in the main thread.
-			QWriteLocker locker(_sessionData->haveReceivedMutex());
-			_sessionData->haveReceivedResponses().emplace(requestId, response);
+			_sessionData->addReceivedResponse(requestId, std::move(response));
 		} else {
 			DEBUG_LOG(("RPC Info: requestId not found for msgId %1").arg(requestMsgId));
 		}
@@ -1772,16 +2224,13 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 
 		mtpMsgId firstMsgId = data.vfirst_msg_id().v;
 		QVector<quint64> toResend;
-		{
-			QReadLocker locker(_sessionData->haveSentMutex());
-			const auto &haveSent = _sessionData->haveSentMap();
-			toResend.reserve(haveSent.size());
-			for (const auto &[msgId, request] : haveSent) {
-				if (msgId >= firstMsgId) {
-					break;
-				} else if (request->requestId) {
-					toResend.push_back(msgId);
-				}
+		const auto &haveSent = _sessionData->haveSentMap();
+		toResend.reserve(haveSent.size());
+		for (const auto &[msgId, request] : haveSent) {
+			if (msgId >= firstMsgId) {
+				break;
+			} else if (request->requestId) {
+				toResend.push_back(msgId);
 			}
 		}
 		for (const auto msgId : toResend) {
@@ -1792,8 +2241,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		if (from > start) memcpy(update.data(), start, (from - start) * sizeof(mtpPrime));
 
 		// Notify main process about new session - need to get difference.
-		QWriteLocker locker(_sessionData->haveReceivedMutex());
-		_sessionData->haveReceivedUpdates().push_back(mtpBuffer(update));
+		_sessionData->addReceivedUpdate(std::move(update));
 	} return HandleResult::Success;
 
 	case mtpc_pong: {
@@ -1839,8 +2287,7 @@ SessionPrivate::HandleResult SessionPrivate::handleOneReceived(
 		}
 
 		// Notify main process about the new updates.
-		QWriteLocker locker(_sessionData->haveReceivedMutex());
-		_sessionData->haveReceivedUpdates().push_back(mtpBuffer(update));
+		_sessionData->addReceivedUpdate(std::move(update));
 	} else {
 		LOG(("Message Error: unexpected updates in dcType: %1"
 			).arg(static_cast<int>(_currentDcType)));
@@ -1879,16 +2326,32 @@ SessionPrivate::HandleResult SessionPrivate::handleBindResponse(
 	Unexpected("Result of BoundKeyCreator::handleBindResponse.");
 }
 
+SerializedRequest SessionPrivate::compressRequest(
+		const SerializedRequest &request) {
+	auto result = CompressRequest(request);
+	if (result) {
+		const auto saved = int64(tl::count_length(request))
+			- int64(tl::count_length(result));
+		_sessionData->notifyRequestCompressed(saved);
+		DEBUG_LOG(("MTP Info: request %1 compressed, %2 bytes saved."
+			).arg(request->requestId
+			).arg(saved));
+	}
+	return result;
+}
+
 mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) const {
 	mtpBuffer result; // * 4 because of mtpPrime type
 	result.resize(0);
 
-	MTPstring packed;
-	if (!packed.read(from, end)) { // read packed string as serialized mtp string type
+	// Inflate right from the received buffer, without copying the packed
+	// string, and grow the result geometrically to avoid reallocations.
+	const auto packed = ReadBytesInPlace(from, end);
+	if (packed.empty()) {
 		LOG(("RPC Error: could not read gziped bytes."));
 		return result;
 	}
-	uint32 packedLen = packed.v.size(), unpackedChunk = packedLen, unpackedLen = 0;
+	uint32 packedLen = packed.size(), unpackedChunk = packedLen;
 
 	z_stream stream;
 	stream.zalloc = 0;
@@ -1902,7 +2365,8 @@ mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) cons
 		return result;
 	}
 	stream.avail_in = packedLen;
-	stream.next_in = reinterpret_cast<Bytef*>(packed.v.data());
+	stream.next_in = reinterpret_cast<Bytef*>(
+		const_cast<bytes::type*>(packed.data()));
 
 	stream.avail_out = 0;
 	while (!stream.avail_out) {
@@ -1913,9 +2377,10 @@ mtpBuffer SessionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) cons
 		if (res != Z_OK && res != Z_STREAM_END) {
 			inflateEnd(&stream);
 			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(res));
-			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.v.constData(), packedLen).str()));
+			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.data(), packedLen).str()));
 			return mtpBuffer();
 		}
+		unpackedChunk = result.size();
 	}
 	if (stream.avail_out & 0x03) {
 		uint32 badSize = result.size() * sizeof(mtpPrime) - stream.avail_out;
@@ -1953,7 +2418,6 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 
 	QVector<MTPlong> toAckMore;
 	{
-		QWriteLocker locker2(_sessionData->haveSentMutex());
 		auto &haveSent = _sessionData->haveSentMap();
 
 		for (const auto &wrappedMsgId : ids) {
@@ -1994,7 +2458,6 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 				}
 				_resendingIds.erase(i);
 
-				QWriteLocker locker4(_sessionData->toSendMutex());
 				auto &toSend = _sessionData->toSendMap();
 				const auto j = toSend.find(requestId);
 				if (j == end(toSend)) {
@@ -2007,8 +2470,9 @@ void SessionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byResponse)
 					DEBUG_LOG(("Message Info: acked msgId %1 that was prepared to resend, requestId %2").arg(msgId).arg(requestId));
 				}
 				toSend.erase(j);
+				_sessionData->notifyResendingAcked(requestId);
 
-				_ackedIds.emplace(msgId, j->second->requestId);
+				_ackedIds.emplace(msgId, requestId);
 				continue;
 			}
 			DEBUG_LOG(("Message Info: msgId %1 was not found in recent resent either").arg(msgId));
@@ -2045,7 +2509,6 @@ void SessionPrivate::handleMsgsStates(const QVector<MTPlong> &ids, const QByteAr
 		const auto state = states[i];
 		const auto requestMsgId = ids[i].v;
 		{
-			QReadLocker locker(_sessionData->haveSentMutex());
 			if (!_sessionData->haveSentMap().contains(requestMsgId)) {
 				DEBUG_LOG(("Message Info: state was received for msgId %1, but request is not found, looking in resent requests...").arg(requestMsgId));
 				const auto reqIt = _resendingIds.find(requestMsgId);
@@ -2103,7 +2566,6 @@ void SessionPrivate::resend(
 		}
 		return;
 	}
-	auto lock = QWriteLocker(_sessionData->haveSentMutex());
 	auto &haveSent = _sessionData->haveSentMap();
 	auto i = haveSent.find(msgId);
 	if (i == haveSent.end()) {
@@ -2111,32 +2573,27 @@ void SessionPrivate::resend(
 	}
 	auto request = i->second;
 	haveSent.erase(i);
-	lock.unlock();
 
 	request->lastSentTime = crl::now();
 	request->forceSendInContainer = forceContainer;
 	_resendingIds.emplace(msgId, request->requestId);
-	{
-		QWriteLocker locker(_sessionData->toSendMutex());
-		_sessionData->toSendMap().emplace(request->requestId, request);
-	}
+	_sessionData->toSendMap().emplace(request->requestId, request);
+	_sessionData->notifyResending(request->requestId);
+	_sessionData->notifyResent();
 }
 
 void SessionPrivate::resendAll() {
-	auto lock = QWriteLocker(_sessionData->haveSentMutex());
 	auto haveSent = base::take(_sessionData->haveSentMap());
-	lock.unlock();
-	{
-		auto lock = QWriteLocker(_sessionData->toSendMutex());
-		auto &toSend = _sessionData->toSendMap();
-		const auto now = crl::now();
-		for (auto &[msgId, request] : haveSent) {
-			const auto requestId = request->requestId;
-			request->lastSentTime = now;
-			request->forceSendInContainer = true;
-			_resendingIds.emplace(msgId, requestId);
-			toSend.emplace(requestId, std::move(request));
-		}
+	auto &toSend = _sessionData->toSendMap();
+	const auto now = crl::now();
+	for (auto &[msgId, request] : haveSent) {
+		const auto requestId = request->requestId;
+		request->lastSentTime = now;
+		request->forceSendInContainer = true;
+		_resendingIds.emplace(msgId, requestId);
+		toSend.emplace(requestId, std::move(request));
+		_sessionData->notifyResending(requestId);
+		_sessionData->notifyResent();
 	}
 
 	_sessionData->queueSendAnything();
@@ -2160,18 +2617,19 @@ void SessionPrivate::onConnected(
 		[](const TestConnection &test) { return test.data.get(); });
 	Assert(i != end(_testConnections));
 	const auto my = i->priority;
-	const auto j = ranges::find_if(
-		_testConnections,
-		[&](const TestConnection &test) { return test.priority > my; });
+	const auto j = i->preferred
+		? end(_testConnections)
+		: ranges::find_if(
+			_testConnections,
+			[&](const TestConnection &test) { return test.priority > my; });
 	if (j != end(_testConnections)) {
 		DEBUG_LOG(("MTP Info: connection %1 succeed, "
 			"waiting for %2.").arg(i->data->tag()).arg(j->data->tag()));
 		_waitForBetterTimer.callOnce(kWaitForBetterTimeout);
 	} else {
-		DEBUG_LOG(("MTP Info: connection through IPv4 succeed."));
-		_waitForBetterTimer.cancel();
-		_connection = std::move(i->data);
-		_testConnections.clear();
+		DEBUG_LOG(("MTP Info: connection %1 succeed, using it."
+			).arg(i->data->tag()));
+		useTestConnection(*i);
 		checkAuthKey();
 	}
 }
@@ -2185,6 +2643,12 @@ void SessionPrivate::onDisconnected(
 		restart();
 	} else {
 		confirmBestConnection();
+
+		// Don't wait for the delay if one of the attempts failed.
+		if (_startTestConnectionTimer.isActive()) {
+			_startTestConnectionTimer.cancel();
+			startNextTestConnection();
+		}
 	}
 }
 
@@ -2206,12 +2670,33 @@ void SessionPrivate::confirmBestConnection() {
 	DEBUG_LOG(("MTP Info: can't connect through better, using %1."
 		).arg(i->data->tag()));
 
-	_connection = std::move(i->data);
-	_testConnections.clear();
-
+	useTestConnection(*i);
 	checkAuthKey();
 }
 
+void SessionPrivate::useTestConnection(TestConnection &test) {
+	_waitForBetterTimer.cancel();
+	_startTestConnectionTimer.cancel();
+	_connection = std::move(test.data);
+
+	// Remember the winner so that next time it is tried first.
+	if (!test.preferred && !test.ip.isEmpty() && !_networkKey.isEmpty()) {
+		const auto dcId = BareDcId(_shiftedDcId);
+		const auto endpoint = DcOptions::PreferredEndpoint{
+			_networkKey,
+			test.protocol,
+			test.ip.toStdString(),
+			test.port,
+		};
+		InvokeQueued(_instance, [=, instance = _instance] {
+			auto copy = endpoint;
+			instance->dcOptions()->setPreferred(dcId, std::move(copy));
+		});
+	}
+	_testConnections.clear();
+	_sessionData->notifyConnectionChanged();
+}
+
 void SessionPrivate::removeTestConnection(
 		not_null<AbstractConnection*> connection) {
 	_testConnections.erase(
@@ -2488,17 +2973,15 @@ bool SessionPrivate::sendSecureRequest(
 #else // TDESKTOP_MTPROTO_OLD
 	const auto oldPadding = false;
 #endif // TDESKTOP_MTPROTO_OLD
-	request.addPadding(_connection->requiresExtendedPadding(), oldPadding);
-
-	uint32 fullSize = request->size();
-	if (fullSize < 9) {
-		return false;
-	}
-
-	auto messageSize = request.messageSize();
-	if (messageSize < 5 || fullSize < messageSize + 4) {
+	const auto messageSize = request.messageSize();
+	const auto dataSize = SerializedRequest::kMessageIdPosition + messageSize;
+	if (messageSize < 5 || uint32(request->size()) < dataSize) {
 		return false;
 	}
+	const auto padding = request.countPadding(
+		_connection->requiresExtendedPadding(),
+		oldPadding);
+	const auto fullSize = dataSize + padding;
 
 	memcpy(request->data() + 0, &_sessionSalt, 2 * sizeof(mtpPrime));
 	memcpy(request->data() + 2, &_sessionId, 2 * sizeof(mtpPrime));
@@ -2510,23 +2993,26 @@ bool SessionPrivate::sendSecureRequest(
 		).arg(getProtocolDcId()
 		).arg(_encryptionKey->keyId()));
 
-#ifdef TDESKTOP_MTPROTO_OLD
-	uint32 padding = fullSize - 4 - messageSize;
+	// The request is copied to the connection buffer once, padded and
+	// encrypted there in place, the request itself is left unchanged.
+	auto packet = _connection->prepareSecurePacket(_keyId, fullSize);
+	const auto prefix = AbstractConnection::kSecurePacketDataPosition;
+	const auto data = &packet[prefix];
+	memcpy(data, request->constData(), dataSize * sizeof(mtpPrime));
+	if (padding > 0) {
+		bytes::set_random(bytes::make_span(packet).subspan(
+			(prefix + dataSize) * sizeof(mtpPrime)));
+	}
 
+#ifdef TDESKTOP_MTPROTO_OLD
 	uchar encryptedSHA[20];
 	MTPint128 &msgKey(*(MTPint128*)(encryptedSHA + 4));
-	hashSha1(
-		request->constData(),
-		(fullSize - padding) * sizeof(mtpPrime),
-		encryptedSHA);
-
-	auto packet = _connection->prepareSecurePacket(_keyId, msgKey, fullSize);
-	const auto prefix = packet.size();
-	packet.resize(prefix + fullSize);
+	hashSha1(data, dataSize * sizeof(mtpPrime), encryptedSHA);
 
+	AbstractConnection::SetSecurePacketKey(packet, msgKey);
 	aesIgeEncrypt_oldmtp(
-		request->constData(),
-		&packet[prefix],
+		data,
+		data,
 		fullSize * sizeof(mtpPrime),
 		_encryptionKey,
 		msgKey);
@@ -2537,16 +3023,13 @@ bool SessionPrivate::sendSecureRequest(
 	SHA256_CTX msgKeyLargeContext;
 	SHA256_Init(&msgKeyLargeContext);
 	SHA256_Update(&msgKeyLargeContext, _encryptionKey->partForMsgKey(true), 32);
-	SHA256_Update(&msgKeyLargeContext, request->constData(), fullSize * sizeof(mtpPrime));
+	SHA256_Update(&msgKeyLargeContext, data, fullSize * sizeof(mtpPrime));
 	SHA256_Final(encryptedSHA256, &msgKeyLargeContext);
 
-	auto packet = _connection->prepareSecurePacket(_keyId, msgKey, fullSize);
-	const auto prefix = packet.size();
-	packet.resize(prefix + fullSize);
-
+	AbstractConnection::SetSecurePacketKey(packet, msgKey);
 	aesIgeEncrypt(
-		request->constData(),
-		&packet[prefix],
+		data,
+		data,
 		fullSize * sizeof(mtpPrime),
 		_encryptionKey,
 		msgKey);
@@ -2560,6 +3043,7 @@ bool SessionPrivate::sendSecureRequest(
 	if (needAnyResponse) {
 		onSentSome((prefix + fullSize) * sizeof(mtpPrime));
 	}
+	notifyPacketSent(request, (prefix + fullSize) * sizeof(mtpPrime));
 
 	return true;
 }
@@ -2578,15 +3062,12 @@ mtpRequestId SessionPrivate::wasSent(mtpMsgId msgId) const {
 		return mtpRequestId(0xFFFFFFFF);
 	}
 
-	{
-		QReadLocker locker(_sessionData->haveSentMutex());
-		const auto &haveSent = _sessionData->haveSentMap();
-		const auto i = haveSent.find(msgId);
-		if (i != haveSent.end()) {
-			return i->second->requestId
-				? i->second->requestId
-				: mtpRequestId(0xFFFFFFFF);
-		}
+	const auto &haveSent = _sessionData->haveSentMap();
+	const auto i = haveSent.find(msgId);
+	if (i != haveSent.end()) {
+		return i->second->requestId
+			? i->second->requestId
+			: mtpRequestId(0xFFFFFFFF);
 	}
 	return 0;
 }
@@ -54,9 +54,17 @@ public:
 private:
 	static constexpr auto kUpdateStateAlways = 666;
 
+	class DecryptQueue;
+
 	struct TestConnection {
 		ConnectionPointer data;
 		int priority = 0;
+		DcOptions::Variants::Protocol protocol = DcOptions::Variants::Tcp;
+		QString ip;
+		int port = 0;
+		bytes::vector protocolSecret;
+		bool preferred = false;
+		bool started = false;
 	};
 	struct SentContainer {
 		crl::time sent = 0;
@@ -84,8 +92,14 @@ private:
 	void onDisconnected(not_null<AbstractConnection*> connection);
 	void onSentSome(uint64 size);
 	void onReceivedSome();
+	void notifyPacketSent(const SerializedRequest &request, int64 bytes);
+
+	// How long can service requests wait to be sent in one container.
+	[[nodiscard]] crl::time batchWaiting(crl::time limit) const;
 
 	void handleReceived();
+	void handleDecryptedQueue();
+	[[nodiscard]] bool handleDecrypted(QByteArray &&decrypted);
 
 	void retryByTimer();
 	void waitConnectedFailed();
@@ -96,6 +110,8 @@ private:
 	void destroyAllConnections();
 
 	void confirmBestConnection();
+	void useTestConnection(TestConnection &test);
+	void startNextTestConnection();
 	void removeTestConnection(not_null<AbstractConnection*> connection);
 	[[nodiscard]] int16 getProtocolDcId() const;
 
@@ -125,6 +141,10 @@ private:
 		mtpMsgId requestMsgId,
 		const mtpBuffer &response);
 	mtpBuffer ungzip(const mtpPrime *from, const mtpPrime *end) const;
+
+	// Wraps large compressible request bodies in gzip_packed.
+	[[nodiscard]] SerializedRequest compressRequest(
+		const SerializedRequest &request);
 	void handleMsgsStates(const QVector<MTPlong> &ids, const QByteArray &states);
 
 	// _sessionDataMutex must be locked for read.
@@ -134,7 +154,8 @@ private:
 		DcOptions::Variants::Protocol protocol,
 		const QString &ip,
 		int port,
-		const bytes::vector &protocolSecret);
+		const bytes::vector &protocolSecret,
+		bool preferred = false);
 
 	// if badTime received - search for ids in sessionData->haveSent and sessionData->wereAcked and sync time/salt, return true if found
 	bool requestsFixTimeSalt(const QVector<MTPlong> &ids, int32 serverTime, uint64 serverSalt);
@@ -191,9 +212,12 @@ private:
 	base::Timer _waitForConnectedTimer;
 	base::Timer _waitForReceivedTimer;
 	base::Timer _waitForBetterTimer;
+	base::Timer _startTestConnectionTimer;
+	QString _networkKey;
 	crl::time _waitForReceived = 0;
 	crl::time _waitForConnected = 0;
 	crl::time _firstSentAt = -1;
+	crl::time _roundTrip = 0; // Smoothed time till the first response.
 
 	mtpPingId _pingId = 0;
 	mtpPingId _pingIdToSend = 0;
@@ -201,6 +225,7 @@ private:
 	mtpMsgId _pingMsgId = 0;
 	base::Timer _pingSender;
 	base::Timer _checkSentRequestsTimer;
+	bool _checkSentRequestsIdle = false;
 
 	std::shared_ptr<SessionData> _sessionData;
 	std::unique_ptr<SessionOptions> _options;
@@ -215,6 +240,12 @@ private:
 	QVector<MTPlong> _resendRequestData;
 	base::flat_set<mtpMsgId> _stateRequestData;
 	ReceivedIdsManager _receivedMessageIds;
+
+	// Received packets are decrypted in workers and handled in order.
+	const std::shared_ptr<DecryptQueue> _decryptQueue;
+	uint64 _decryptNextIndex = 0;
+	uint64 _decryptConsumeIndex = 0;
+
 	base::flat_map<mtpMsgId, mtpRequestId> _resendingIds;
 	base::flat_map<mtpMsgId, mtpRequestId> _ackedIds;
 	base::flat_map<mtpMsgId, SerializedRequest> _stateAndResendRequests;
@@ -260,8 +260,9 @@ SpecialConfigRequest::SpecialConfigRequest(Fn<void()> timeDoneCallback)
 }
 
 void SpecialConfigRequest::sendNextRequest() {
-	Expects(!_attempts.empty());
-
+	if (_attempts.empty()) {
+		return;
+	}
 	const auto attempt = _attempts.back();
 	_attempts.pop_back();
 	if (!_attempts.empty()) {
@@ -370,7 +371,13 @@ void SpecialConfigRequest::requestFinished(
 		Type type,
 		not_null<QNetworkReply*> reply) {
 	handleHeaderUnixtime(reply);
+	const auto failed = (reply->error() != QNetworkReply::NoError);
 	const auto result = finalizeRequest(reply);
+	if (failed) {
+		// Blocked or failed endpoint, don't wait for the timeout
+		// to try the next one.
+		sendNextRequest();
+	}
 	if (!_callback) {
 		return;
 	}
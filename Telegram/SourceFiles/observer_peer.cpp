@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "observer_peer.h"
 
 #include "base/observer.h"
+#include <rpl/event_stream.h>
 #include "facades.h"
 
 namespace Notify {
@@ -29,6 +30,77 @@ void FinishCallback() {
 
 base::Observable<PeerUpdate, PeerUpdatedHandler> PeerUpdatedObservable;
 
+// Most viewers are interested in a single peer, so instead of checking
+// every update in every one of them we dispatch the updates by peer.
+struct PeerViewers {
+	rpl::event_stream<PeerUpdate> updates;
+	int count = 0;
+};
+using PeerViewersMap = std::map<
+	not_null<PeerData*>,
+	std::unique_ptr<PeerViewers>>;
+NeverFreedPointer<PeerViewersMap> PeerViewersByPeer;
+NeverFreedPointer<base::Subscription> PeerViewersSubscription;
+bool PeerViewersDispatching = false;
+bool PeerViewersCleanupNeeded = false;
+
+void CleanupPeerViewers() {
+	if (!base::take(PeerViewersCleanupNeeded)) {
+		return;
+	}
+	for (auto i = PeerViewersByPeer->begin(); i != PeerViewersByPeer->end();) {
+		if (!i->second->count) {
+			i = PeerViewersByPeer->erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void DispatchPeerViewers(const PeerUpdate &update) {
+	if (!update.peer) {
+		return;
+	}
+	const auto i = PeerViewersByPeer->find(update.peer);
+	if (i == PeerViewersByPeer->end()) {
+		return;
+	}
+	const auto viewers = i->second.get();
+	const auto wasDispatching = std::exchange(PeerViewersDispatching, true);
+	viewers->updates.fire_copy(update);
+	PeerViewersDispatching = wasDispatching;
+	if (!PeerViewersDispatching) {
+		CleanupPeerViewers();
+	}
+}
+
+not_null<PeerViewers*> RegisterPeerViewer(not_null<PeerData*> peer) {
+	PeerViewersByPeer.createIfNull();
+	if (!PeerViewersSubscription) {
+		PeerViewersSubscription.createIfNull(PeerUpdated().add_subscription({
+			PeerUpdate::Flags::from_raw(~uint32(0)),
+			[](const PeerUpdate &update) { DispatchPeerViewers(update); } }));
+	}
+	auto &viewers = (*PeerViewersByPeer)[peer];
+	if (!viewers) {
+		viewers = std::make_unique<PeerViewers>();
+	}
+	++viewers->count;
+	return viewers.get();
+}
+
+void UnregisterPeerViewer(not_null<PeerData*> peer) {
+	const auto i = PeerViewersByPeer->find(peer);
+	Assert(i != PeerViewersByPeer->end());
+
+	if (!--i->second->count) {
+		PeerViewersCleanupNeeded = true;
+		if (!PeerViewersDispatching) {
+			CleanupPeerViewers();
+		}
+	}
+}
+
 } // namespace
 
 void mergePeerUpdate(PeerUpdate &mergeTo, const PeerUpdate &mergeFrom) {
@@ -109,11 +181,19 @@ rpl::producer<PeerUpdate> PeerUpdateViewer(
 rpl::producer<PeerUpdate> PeerUpdateViewer(
 		not_null<PeerData*> peer,
 		PeerUpdate::Flags flags) {
-	return PeerUpdateViewer(
-		flags
-	) | rpl::filter([=](const PeerUpdate &update) {
-		return (update.peer == peer);
-	});
+	return [=](const auto &consumer) {
+		auto lifetime = rpl::lifetime();
+		RegisterPeerViewer(peer)->updates.events(
+		) | rpl::filter([=](const PeerUpdate &update) {
+			return (update.flags & flags);
+		}) | rpl::start_with_next([=](const PeerUpdate &update) {
+			consumer.put_next_copy(update);
+		}, lifetime);
+		lifetime.add([=] {
+			UnregisterPeerViewer(peer);
+		});
+		return lifetime;
+	};
 }
 
 rpl::producer<PeerUpdate> PeerUpdateValue(
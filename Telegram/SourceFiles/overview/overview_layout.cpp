@@ -30,6 +30,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_item_components.h"
 #include "history/view/history_view_cursor_state.h"
 #include "base/unixtime.h"
+#include "base/flat_map.h"
 #include "ui/effects/round_checkbox.h"
 #include "ui/image/image.h"
 #include "ui/text_options.h"
@@ -395,6 +396,10 @@ TextState Photo::getState(
 	return {};
 }
 
+void Photo::unloadHeavyPart() {
+	_pix = QPixmap();
+}
+
 Video::Video(
 	not_null<HistoryItem*> parent,
 	not_null<DocumentData*> video)
@@ -559,6 +564,10 @@ TextState Video::getState(
 	return {};
 }
 
+void Video::unloadHeavyPart() {
+	_pix = QPixmap();
+}
+
 void Video::updateStatusText() {
 	bool showPause = false;
 	int statusSize = 0;
@@ -1257,6 +1266,10 @@ const style::RoundCheckbox &Document::checkboxStyle() const {
 	return st::overviewSmallCheck;
 }
 
+void Document::unloadHeavyPart() {
+	_thumb = QPixmap();
+}
+
 float64 Document::dataProgress() const {
 	return _data->progress();
 }
@@ -1316,57 +1329,30 @@ bool Document::updateStatusText() {
 	return showPause;
 }
 
+struct Link::Parsed {
+	TextWithEntities original;
+	WebPageData *page = nullptr;
+	int pageVersion = 0;
+
+	QString mainUrl;
+	QString title, letter;
+	int titlew = 0;
+	Ui::Text::String text = { st::msgMinWidth };
+	std::vector<std::pair<QString, QString>> links; // url, text
+};
+
 Link::Link(
 	not_null<HistoryItem*> parent,
 	Data::Media *media)
-: ItemBase(parent) {
+: ItemBase(parent)
+, _parsed(LookupParsed(parent, media ? media->webpage() : nullptr))
+, _page(_parsed->page) {
 	AddComponents(Info::Bit());
 
-	auto textWithEntities = parent->originalText();
-	QString mainUrl;
-
-	auto text = textWithEntities.text;
-	const auto &entities = textWithEntities.entities;
-	int32 from = 0, till = text.size(), lnk = entities.size();
-	for (const auto &entity : entities) {
-		auto type = entity.type();
-		if (type != EntityType::Url && type != EntityType::CustomUrl && type != EntityType::Email) {
-			continue;
-		}
-		const auto customUrl = entity.data();
-		const auto entityText = text.mid(entity.offset(), entity.length());
-		const auto url = customUrl.isEmpty() ? entityText : customUrl;
-		if (_links.isEmpty()) {
-			mainUrl = url;
-		}
-		_links.push_back(LinkEntry(url, entityText));
+	for (const auto &[url, text] : _parsed->links) {
+		_links.push_back(LinkEntry(url, text));
 	}
-	while (lnk > 0 && till > from) {
-		--lnk;
-		auto &entity = entities.at(lnk);
-		auto type = entity.type();
-		if (type != EntityType::Url && type != EntityType::CustomUrl && type != EntityType::Email) {
-			++lnk;
-			break;
-		}
-		int32 afterLinkStart = entity.offset() + entity.length();
-		if (till > afterLinkStart) {
-			if (!QRegularExpression(qsl("^[,.\\s_=+\\-;:`'\"\\(\\)\\[\\]\\{\\}<>*&^%\\$#@!\\\\/]+$")).match(text.mid(afterLinkStart, till - afterLinkStart)).hasMatch()) {
-				++lnk;
-				break;
-			}
-		}
-		till = entity.offset();
-	}
-	if (!lnk) {
-		if (QRegularExpression(qsl("^[,.\\s\\-;:`'\"\\(\\)\\[\\]\\{\\}<>*&^%\\$#@!\\\\/]+$")).match(text.mid(from, till - from)).hasMatch()) {
-			till = from;
-		}
-	}
-
-	_page = media ? media->webpage() : nullptr;
 	if (_page) {
-		mainUrl = _page->url;
 		if (_page->document) {
 			_photol = std::make_shared<DocumentOpenClickHandler>(
 				_page->document,
@@ -1386,17 +1372,8 @@ Link::Link(
 		} else {
 			_photol = std::make_shared<UrlClickHandler>(_page->url);
 		}
-	} else if (!mainUrl.isEmpty()) {
-		_photol = std::make_shared<UrlClickHandler>(mainUrl);
-	}
-	if (from >= till && _page) {
-		text = _page->description.text;
-		from = 0;
-		till = text.size();
-	}
-	if (till > from) {
-		TextParseOptions opts = { TextParseMultiline, int32(st::linksMaxWidth), 3 * st::normalFont->height, Qt::LayoutDirectionAuto };
-		_text.setText(st::defaultTextStyle, text.mid(from, till - from), opts);
+	} else if (!_parsed->mainUrl.isEmpty()) {
+		_photol = std::make_shared<UrlClickHandler>(_parsed->mainUrl);
 	}
 	int32 tw = 0, th = 0;
 	if (_page && _page->photo) {
@@ -1425,9 +1402,132 @@ Link::Link(
 	}
 	_pixw = qMax(tw, 1);
 	_pixh = qMax(th, 1);
+}
 
-	if (_page) {
-		_title = _page->title;
+auto Link::LookupParsed(
+		not_null<HistoryItem*> item,
+		WebPageData *page) -> std::shared_ptr<const Parsed> {
+	// Enough for a few screens of each of the shown lists.
+	constexpr auto kCacheSize = 1024;
+
+	struct Entry {
+		std::shared_ptr<const Parsed> parsed;
+		uint64 lastUsed = 0;
+	};
+	static auto Cache = base::flat_map<FullMsgId, Entry>();
+	static auto Counter = uint64(0);
+
+	const auto same = [](
+			const TextWithEntities &a,
+			const TextWithEntities &b) {
+		if (a.text != b.text || a.entities.size() != b.entities.size()) {
+			return false;
+		}
+		for (auto i = 0, count = int(a.entities.size()); i != count; ++i) {
+			const auto &entity = a.entities[i];
+			const auto &other = b.entities[i];
+			if (entity.type() != other.type()
+				|| entity.offset() != other.offset()
+				|| entity.length() != other.length()
+				|| entity.data() != other.data()) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// The item text may be edited and the webpage may be updated,
+	// the cached texts are used only while they are parsed from the same.
+	auto original = item->originalText();
+	auto &entry = Cache[item->fullId()];
+	entry.lastUsed = ++Counter;
+	if (!entry.parsed
+		|| entry.parsed->page != page
+		|| (page && entry.parsed->pageVersion != page->version)
+		|| !same(entry.parsed->original, original)) {
+		entry.parsed = ComputeParsed(std::move(original), page);
+	}
+	auto result = entry.parsed;
+
+	if (Cache.size() > 2 * kCacheSize) {
+		// Forget the least recently used half.
+		const auto till = Counter - kCacheSize;
+		for (auto i = Cache.begin(); i != Cache.end();) {
+			if (i->second.lastUsed <= till) {
+				i = Cache.erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
+	return result;
+}
+
+auto Link::ComputeParsed(
+		TextWithEntities &&original,
+		WebPageData *page) -> std::shared_ptr<const Parsed> {
+	auto result = std::make_shared<Parsed>();
+	result->original = std::move(original);
+	result->page = page;
+	result->pageVersion = page ? page->version : 0;
+
+	auto &mainUrl = result->mainUrl;
+	auto text = result->original.text;
+	const auto &entities = result->original.entities;
+	int32 from = 0, till = text.size(), lnk = entities.size();
+	for (const auto &entity : entities) {
+		auto type = entity.type();
+		if (type != EntityType::Url && type != EntityType::CustomUrl && type != EntityType::Email) {
+			continue;
+		}
+		const auto customUrl = entity.data();
+		const auto entityText = text.mid(entity.offset(), entity.length());
+		const auto url = customUrl.isEmpty() ? entityText : customUrl;
+		if (result->links.empty()) {
+			mainUrl = url;
+		}
+		result->links.emplace_back(url, entityText);
+	}
+	while (lnk > 0 && till > from) {
+		--lnk;
+		auto &entity = entities.at(lnk);
+		auto type = entity.type();
+		if (type != EntityType::Url && type != EntityType::CustomUrl && type != EntityType::Email) {
+			++lnk;
+			break;
+		}
+		int32 afterLinkStart = entity.offset() + entity.length();
+		if (till > afterLinkStart) {
+			if (!QRegularExpression(qsl("^[,.\\s_=+\\-;:`'\"\\(\\)\\[\\]\\{\\}<>*&^%\\$#@!\\\\/]+$")).match(text.mid(afterLinkStart, till - afterLinkStart)).hasMatch()) {
+				++lnk;
+				break;
+			}
+		}
+		till = entity.offset();
+	}
+	if (!lnk) {
+		if (QRegularExpression(qsl("^[,.\\s\\-;:`'\"\\(\\)\\[\\]\\{\\}<>*&^%\\$#@!\\\\/]+$")).match(text.mid(from, till - from)).hasMatch()) {
+			till = from;
+		}
+	}
+
+	if (page) {
+		mainUrl = page->url;
+	}
+	if (from >= till && page) {
+		text = page->description.text;
+		from = 0;
+		till = text.size();
+	}
+	if (till > from) {
+		TextParseOptions opts = { TextParseMultiline, int32(st::linksMaxWidth), 3 * st::normalFont->height, Qt::LayoutDirectionAuto };
+		result->text.setText(st::defaultTextStyle, text.mid(from, till - from), opts);
+	}
+
+	auto &title = result->title;
+	auto &letter = result->letter;
+	if (page) {
+		title = page->title;
 	}
 
 #ifndef OS_MAC_OLD
@@ -1443,24 +1543,25 @@ Link::Link(
 
 		parts = domain.split('@').back().split('.', QString::SkipEmptyParts);
 		if (parts.size() > 1) {
-			_letter = parts.at(parts.size() - 2).at(0).toUpper();
-			if (_title.isEmpty()) {
-				_title.reserve(parts.at(parts.size() - 2).size());
-				_title.append(_letter).append(parts.at(parts.size() - 2).mid(1));
+			letter = parts.at(parts.size() - 2).at(0).toUpper();
+			if (title.isEmpty()) {
+				title.reserve(parts.at(parts.size() - 2).size());
+				title.append(letter).append(parts.at(parts.size() - 2).mid(1));
 			}
 		}
 	}
-	_titlew = st::semiboldFont->width(_title);
+	result->titlew = st::semiboldFont->width(title);
+	return result;
 }
 
 void Link::initDimensions() {
 	_maxw = st::linksMaxWidth;
 	_minh = 0;
-	if (!_title.isEmpty()) {
+	if (!_parsed->title.isEmpty()) {
 		_minh += st::semiboldFont->height;
 	}
-	if (!_text.isEmpty()) {
-		_minh += qMin(3 * st::normalFont->height, _text.countHeight(_maxw - st::linksPhotoSize - st::linksPhotoPadding));
+	if (!_parsed->text.isEmpty()) {
+		_minh += qMin(3 * st::normalFont->height, _parsed->text.countHeight(_maxw - st::linksPhotoSize - st::linksPhotoPadding));
 	}
 	_minh += _links.size() * st::normalFont->height;
 	_minh = qMax(_minh, int32(st::linksPhotoSize)) + st::linksMargin.top() + st::linksMargin.bottom() + st::linksBorder;
@@ -1474,11 +1575,11 @@ int32 Link::resizeGetHeight(int32 width) {
 	}
 
 	_height = 0;
-	if (!_title.isEmpty()) {
+	if (!_parsed->title.isEmpty()) {
 		_height += st::semiboldFont->height;
 	}
-	if (!_text.isEmpty()) {
-		_height += qMin(3 * st::normalFont->height, _text.countHeight(_width - st::linksPhotoSize - st::linksPhotoPadding));
+	if (!_parsed->text.isEmpty()) {
+		_height += qMin(3 * st::normalFont->height, _parsed->text.countHeight(_width - st::linksPhotoSize - st::linksPhotoPadding));
 	}
 	_height += _links.size() * st::normalFont->height;
 	_height = qMax(_height, int32(st::linksPhotoSize)) + st::linksMargin.top() + st::linksMargin.bottom() + st::linksBorder;
@@ -1509,9 +1610,9 @@ void Link::paint(Painter &p, const QRect &clip, TextSelection selection, const P
 				: ImageRoundRadius::Small;
 			p.drawPixmapLeft(pixLeft, pixTop, _width, _page->document->thumbnail()->pixSingle(parent()->fullId(), _pixw, _pixh, st::linksPhotoSize, st::linksPhotoSize, roundRadius));
 		} else {
-			const auto index = _letter.isEmpty()
+			const auto index = _parsed->letter.isEmpty()
 				? 0
-				: (_letter[0].unicode() % 4);
+				: (_parsed->letter[0].unicode() % 4);
 			const auto fill = [&](style::color color, RoundCorners corners) {
 				auto pixRect = style::rtlrect(
 					pixLeft,
@@ -1528,10 +1629,10 @@ void Link::paint(Painter &p, const QRect &clip, TextSelection selection, const P
 			case 3: fill(st::msgFile4Bg, Doc4Corners); break;
 			}
 
-			if (!_letter.isEmpty()) {
+			if (!_parsed->letter.isEmpty()) {
 				p.setFont(st::linksLetterFont);
 				p.setPen(st::linksLetterFg);
-				p.drawText(style::rtlrect(pixLeft, pixTop, st::linksPhotoSize, st::linksPhotoSize, _width), _letter, style::al_center);
+				p.drawText(style::rtlrect(pixLeft, pixTop, st::linksPhotoSize, st::linksPhotoSize, _width), _parsed->letter, style::al_center);
 			}
 		}
 	}
@@ -1539,7 +1640,7 @@ void Link::paint(Painter &p, const QRect &clip, TextSelection selection, const P
 	const auto left = st::linksPhotoSize + st::linksPhotoPadding;
 	const auto w = _width - left;
 	auto top = [&] {
-		if (!_title.isEmpty() && _text.isEmpty() && _links.size() == 1) {
+		if (!_parsed->title.isEmpty() && _parsed->text.isEmpty() && _links.size() == 1) {
 			return pixTop + (st::linksPhotoSize - st::semiboldFont->height - st::normalFont->height) / 2;
 		}
 		return st::linksTextTop;
@@ -1547,17 +1648,17 @@ void Link::paint(Painter &p, const QRect &clip, TextSelection selection, const P
 
 	p.setPen(st::linksTextFg);
 	p.setFont(st::semiboldFont);
-	if (!_title.isEmpty()) {
-		if (clip.intersects(style::rtlrect(left, top, qMin(w, _titlew), st::semiboldFont->height, _width))) {
-			p.drawTextLeft(left, top, _width, (w < _titlew) ? st::semiboldFont->elided(_title, w) : _title);
+	if (!_parsed->title.isEmpty()) {
+		if (clip.intersects(style::rtlrect(left, top, qMin(w, _parsed->titlew), st::semiboldFont->height, _width))) {
+			p.drawTextLeft(left, top, _width, (w < _parsed->titlew) ? st::semiboldFont->elided(_parsed->title, w) : _parsed->title);
 		}
 		top += st::semiboldFont->height;
 	}
 	p.setFont(st::msgFont);
-	if (!_text.isEmpty()) {
-		int32 h = qMin(st::normalFont->height * 3, _text.countHeight(w));
+	if (!_parsed->text.isEmpty()) {
+		int32 h = qMin(st::normalFont->height * 3, _parsed->text.countHeight(w));
 		if (clip.intersects(style::rtlrect(left, top, w, h, _width))) {
-			_text.drawLeftElided(p, left, top, w, _width, 3);
+			_parsed->text.drawLeftElided(p, left, top, w, _width, 3);
 		}
 		top += h;
 	}
@@ -1591,17 +1692,17 @@ TextState Link::getState(
 		return { parent(), _photol };
 	}
 
-	if (!_title.isEmpty() && _text.isEmpty() && _links.size() == 1) {
+	if (!_parsed->title.isEmpty() && _parsed->text.isEmpty() && _links.size() == 1) {
 		top += (st::linksPhotoSize - st::semiboldFont->height - st::normalFont->height) / 2;
 	}
-	if (!_title.isEmpty()) {
-		if (style::rtlrect(left, top, qMin(w, _titlew), st::semiboldFont->height, _width).contains(point)) {
+	if (!_parsed->title.isEmpty()) {
+		if (style::rtlrect(left, top, qMin(w, _parsed->titlew), st::semiboldFont->height, _width).contains(point)) {
 			return { parent(), _photol };
 		}
 		top += st::webPageTitleFont->height;
 	}
-	if (!_text.isEmpty()) {
-		top += qMin(st::normalFont->height * 3, _text.countHeight(w));
+	if (!_parsed->text.isEmpty()) {
+		top += qMin(st::normalFont->height * 3, _parsed->text.countHeight(w));
 	}
 	for (const auto &link : _links) {
 		if (style::rtlrect(left, top, qMin(w, link.width), st::normalFont->height, _width).contains(point)) {
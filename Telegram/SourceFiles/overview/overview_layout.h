@@ -56,6 +56,8 @@ public:
 
 	virtual void invalidateCache() {
 	}
+	virtual void unloadHeavyPart() {
+	}
 
 };
 
@@ -208,6 +210,7 @@ public:
 	TextState getState(
 		QPoint point,
 		StateRequest request) const override;
+	void unloadHeavyPart() override;
 
 private:
 	void setPixFrom(not_null<Image*> image);
@@ -232,6 +235,7 @@ public:
 	TextState getState(
 		QPoint point,
 		StateRequest request) const override;
+	void unloadHeavyPart() override;
 
 protected:
 	float64 dataProgress() const override;
@@ -304,6 +308,7 @@ public:
 	virtual DocumentData *getDocument() const override {
 		return _data;
 	}
+	void unloadHeavyPart() override;
 
 protected:
 	float64 dataProgress() const override;
@@ -355,14 +360,22 @@ protected:
 	const style::RoundCheckbox &checkboxStyle() const override;
 
 private:
+	// Texts parsed from the item and its webpage. They are shared between
+	// the layouts of the same item in different lists.
+	struct Parsed;
+	[[nodiscard]] static std::shared_ptr<const Parsed> LookupParsed(
+		not_null<HistoryItem*> item,
+		WebPageData *page);
+	[[nodiscard]] static std::shared_ptr<const Parsed> ComputeParsed(
+		TextWithEntities &&original,
+		WebPageData *page);
+
 	ClickHandlerPtr _photol;
 
-	QString _title, _letter;
-	int _titlew = 0;
+	std::shared_ptr<const Parsed> _parsed;
 	WebPageData *_page = nullptr;
 	int _pixw = 0;
 	int _pixh = 0;
-	Ui::Text::String _text = { st::msgMinWidth };
 
 	struct LinkEntry {
 		LinkEntry() : width(0) {
@@ -1752,24 +1752,45 @@ void FormController::loadFile(File &file) {
 }
 
 void FormController::fileLoadDone(FileKey key, const QByteArray &bytes) {
-	if (const auto [value, file] = findFile(key); file != nullptr) {
+	const auto [value, file] = findFile(key);
+	if (!file) {
+		return;
+	}
+
+	// Decrypting and decoding a large scan takes a while.
+	crl::async([=, hash = file->hash, secret = file->secret] {
 		const auto decrypted = DecryptData(
 			bytes::make_span(bytes),
-			file->hash,
-			file->secret);
-		if (decrypted.empty()) {
-			fileLoadFail(key);
-			return;
-		}
-		file->downloadOffset = file->size;
-		file->image = App::readImage(QByteArray::fromRawData(
-			reinterpret_cast<const char*>(decrypted.data()),
-			decrypted.size()));
-		if (const auto fileInEdit = findEditFile(key)) {
-			fileInEdit->fields.image = file->image;
-			fileInEdit->fields.downloadOffset = file->downloadOffset;
-			_scanUpdated.fire(fileInEdit);
-		}
+			hash,
+			secret);
+		const auto failed = decrypted.empty();
+		auto image = failed
+			? QImage()
+			: ReadImage(bytes::make_span(decrypted));
+		crl::on_main(this, [=, image = std::move(image)]() mutable {
+			fileDecryptDone(key, hash, failed, std::move(image));
+		});
+	});
+}
+
+void FormController::fileDecryptDone(
+		FileKey key,
+		const bytes::vector &hash,
+		bool failed,
+		QImage &&image) {
+	const auto [value, file] = findFile(key);
+	if (!file || file->hash != hash) {
+		return;
+	} else if (failed) {
+		fileLoadFail(key);
+		return;
+	}
+	file->downloadOffset = file->size;
+	file->image = std::move(image);
+	if (const auto fileInEdit = findEditFile(key)) {
+		fileInEdit->fields.image = file->image;
+		fileInEdit->fields.downloadOffset = file->downloadOffset;
+		_scanUpdated.fire(fileInEdit);
 	}
 }
 
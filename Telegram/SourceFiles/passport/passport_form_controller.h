@@ -452,6 +452,11 @@ private:
 
 	void loadFile(File &file);
 	void fileLoadDone(FileKey key, const QByteArray &bytes);
+	void fileDecryptDone(
+		FileKey key,
+		const bytes::vector &hash,
+		bool failed,
+		QImage &&image);
 	void fileLoadProgress(FileKey key, int offset);
 	void fileLoadFail(FileKey key);
 	void generateSecret(bytes::const_span password);
@@ -14,6 +14,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QBuffer>
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusReply>
+#include <QtDBus/QDBusPendingCallWatcher>
+#include <QtDBus/QDBusPendingReply>
 #include <QtDBus/QDBusMetaType>
 
 namespace Platform {
@@ -79,11 +81,54 @@ QVersionNumber ParseSpecificationVersion(
 	return QVersionNumber();
 }
 
+QString ImageKey(const QVersionNumber &specificationVersion) {
+	if (specificationVersion.isNull()) {
+		LOG(("Native notification error: specification version is null"));
+		return QString();
+	}
+
+	const auto majorVersion = specificationVersion.majorVersion();
+	const auto minorVersion = specificationVersion.minorVersion();
+
+	if ((majorVersion == 1 && minorVersion >= 2) || majorVersion > 1) {
+		return qsl("image-data");
+	} else if (majorVersion == 1 && minorVersion) {
+		return qsl("image_data");
+	} else if ((majorVersion == 1 && minorVersion < 1)
+								|| majorVersion < 1) {
+		return qsl("icon_data");
+	}
+	LOG(("Native notification error: unknown specification version"));
+	return QString();
+}
+
+void CloseNotificationAsync(
+		not_null<QDBusInterface*> notificationInterface,
+		uint notificationId) {
+	const auto watcher = new QDBusPendingCallWatcher(
+		notificationInterface->asyncCall(
+			"CloseNotification",
+			notificationId),
+		notificationInterface);
+	QObject::connect(
+		watcher,
+		&QDBusPendingCallWatcher::finished,
+		[=](QDBusPendingCallWatcher *call) {
+			const auto reply = QDBusPendingReply<>(*call);
+			if (reply.isError()) {
+				LOG(("Native notification error: %1")
+					.arg(reply.error().message()));
+			}
+			call->deleteLater();
+		});
+}
+
 }
 
 NotificationData::NotificationData(
 		const std::shared_ptr<QDBusInterface> &notificationInterface,
 		const base::weak_ptr<Manager> &manager,
+		const std::vector<QString> &capabilities,
 		const QString &title, const QString &subtitle,
 		const QString &msg, PeerId peerId, MsgId msgId)
 : _notificationInterface(notificationInterface)
@@ -91,8 +136,7 @@ NotificationData::NotificationData(
 , _title(title)
 , _peerId(peerId)
 , _msgId(msgId) {
-	auto capabilities = GetCapabilities(_notificationInterface);
-	auto capabilitiesEnd = capabilities.end();
+	const auto capabilitiesEnd = capabilities.end();
 
 	if (ranges::find(capabilities, qsl("body-markup")) != capabilitiesEnd) {
 		_body = subtitle.isEmpty()
@@ -142,56 +186,58 @@ NotificationData::NotificationData(
 			this, SLOT(notificationClosed(uint)));
 }
 
-bool NotificationData::show() {
-	QDBusReply<uint> notifyReply = _notificationInterface->call("Notify",
-		str_const_toString(AppName), uint(0), "telegram", _title, _body,
-		_actions, _hints, -1);
-
-	if (notifyReply.isValid()) {
-		_notificationId = notifyReply.value();
-	} else {
-		LOG(("Native notification error: %1")
-			.arg(notifyReply.error().message()));
-	}
-
-	return notifyReply.isValid();
+void NotificationData::show() {
+	const auto watcher = new QDBusPendingCallWatcher(
+		_notificationInterface->asyncCall("Notify",
+			str_const_toString(AppName), uint(0), "telegram", _title, _body,
+			_actions, _hints, -1),
+		_notificationInterface.get());
+
+	const auto weak = QPointer<NotificationData>(this);
+	const auto notificationInterface = _notificationInterface.get();
+	const auto manager = _manager;
+	const auto peerId = _peerId;
+	const auto msgId = _msgId;
+	connect(watcher, &QDBusPendingCallWatcher::finished, [=](
+			QDBusPendingCallWatcher *call) {
+		call->deleteLater();
+
+		const auto reply = QDBusPendingReply<uint>(*call);
+		if (reply.isError()) {
+			LOG(("Native notification error: %1")
+				.arg(reply.error().message()));
+			if (weak) {
+				crl::on_main(manager, [=] {
+					manager->clearNotification(peerId, msgId);
+				});
+			}
+			return;
+		}
+		const auto notificationId = reply.value();
+		if (!weak) {
+			// Closed and dropped before the daemon replied.
+			CloseNotificationAsync(notificationInterface, notificationId);
+			return;
+		}
+		weak->_notificationId = notificationId;
+		if (weak->_closeRequested) {
+			weak->close();
+		}
+	});
 }
 
-bool NotificationData::close() {
-	QDBusReply<void> closeReply = _notificationInterface
-		->call("CloseNotification", _notificationId);
-
-	if (!closeReply.isValid()) {
-		LOG(("Native notification error: %1")
-			.arg(closeReply.error().message()));
+void NotificationData::close() {
+	if (!_notificationId) {
+		_closeRequested = true;
+		return;
 	}
-
-	return closeReply.isValid();
+	CloseNotificationAsync(_notificationInterface.get(), _notificationId);
 }
 
-void NotificationData::setImage(const QString &imagePath) {
-	auto specificationVersion = ParseSpecificationVersion(
-		GetServerInformation(_notificationInterface));
-
-	QString imageKey;
-
-	if (!specificationVersion.isNull()) {
-		const auto majorVersion = specificationVersion.majorVersion();
-		const auto minorVersion = specificationVersion.minorVersion();
-
-		if ((majorVersion == 1 && minorVersion >= 2) || majorVersion > 1) {
-			imageKey = "image-data";
-		} else if (majorVersion == 1 && minorVersion) {
-			imageKey = "image_data";
-		} else if ((majorVersion == 1 && minorVersion < 1)
-									|| majorVersion < 1) {
-			imageKey = "icon_data";
-		} else {
-			LOG(("Native notification error: unknown specification version"));
-			return;
-		}
-	} else {
-		LOG(("Native notification error: specification version is null"));
+void NotificationData::setImage(
+		const QString &imageKey,
+		const QString &imagePath) {
+	if (imageKey.isEmpty()) {
 		return;
 	}
 
@@ -292,17 +338,18 @@ Manager::Private::Private(Manager *manager, Type type)
 	auto specificationVersion = ParseSpecificationVersion(
 		GetServerInformation(_notificationInterface));
 
-	auto capabilities = GetCapabilities(_notificationInterface);
+	_capabilities = GetCapabilities(_notificationInterface);
+	_imageKey = ImageKey(specificationVersion);
 
 	if (!specificationVersion.isNull()) {
 		LOG(("Notification daemon specification version: %1")
 			.arg(specificationVersion.toString()));
 	}
 
-	if (!capabilities.empty()) {
+	if (!_capabilities.empty()) {
 		const auto capabilitiesString = std::accumulate(
-			capabilities.begin(),
-			capabilities.end(),
+			_capabilities.begin(),
+			_capabilities.end(),
 			QString{},
 			[](auto &s, auto &p) {
 				return s + (p + qstr(", "));
@@ -323,6 +370,7 @@ void Manager::Private::showNotification(
 	auto notification = std::make_shared<NotificationData>(
 		_notificationInterface,
 		_manager,
+		_capabilities,
 		title,
 		subtitle,
 		msg,
@@ -332,7 +380,7 @@ void Manager::Private::showNotification(
 	const auto key = hideNameAndPhoto
 		? InMemoryKey()
 		:peer->userpicUniqueKey();
-	notification->setImage(_cachedUserpics.get(key, peer));
+	notification->setImage(_imageKey, _cachedUserpics.get(key, peer));
 
 	auto i = _notifications.find(peer->id);
 	if (i != _notifications.cend()) {
@@ -348,13 +396,7 @@ void Manager::Private::showNotification(
 		i = _notifications.insert(peer->id, QMap<MsgId, Notification>());
 	}
 	_notifications[peer->id].insert(msgId, notification);
-	if (!notification->show()) {
-		i = _notifications.find(peer->id);
-		if (i != _notifications.cend()) {
-			i->remove(msgId);
-			if (i->isEmpty()) _notifications.erase(i);
-		}
-	}
+	notification->show();
 }
 
 void Manager::Private::clearAll() {
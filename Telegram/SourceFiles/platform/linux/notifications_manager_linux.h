@@ -35,6 +35,7 @@ public:
 	NotificationData(
 		const std::shared_ptr<QDBusInterface> &notificationInterface,
 		const base::weak_ptr<Manager> &manager,
+		const std::vector<QString> &capabilities,
 		const QString &title, const QString &subtitle,
 		const QString &msg, PeerId peerId, MsgId msgId);
 
@@ -43,9 +44,10 @@ public:
 	NotificationData(NotificationData &&other) = delete;
 	NotificationData &operator=(NotificationData &&other) = delete;
 
-	bool show();
-	bool close();
-	void setImage(const QString &imagePath);
+	// Both are asynchronous, a failed show() clears the notification.
+	void show();
+	void close();
+	void setImage(const QString &imageKey, const QString &imagePath);
 
 	struct ImageData {
 		int width, height, rowStride;
@@ -63,7 +65,8 @@ private:
 	QStringList _actions;
 	QVariantMap _hints;
 
-	uint _notificationId;
+	uint _notificationId = 0;
+	bool _closeRequested = false;
 	PeerId _peerId;
 	MsgId _msgId;
 
@@ -132,6 +135,8 @@ private:
 	Window::Notifications::CachedUserpics _cachedUserpics;
 	base::weak_ptr<Manager> _manager;
 	std::shared_ptr<QDBusInterface> _notificationInterface;
+	std::vector<QString> _capabilities;
+	QString _imageKey;
 };
 
 } // namespace Notifications
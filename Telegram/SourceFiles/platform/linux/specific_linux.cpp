@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/localstorage.h"
 #include "core/crash_reports.h"
 #include "core/update_checker.h"
+#include "base/timer.h"
 
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QDesktopWidget>
@@ -229,6 +230,72 @@ void start() {
 }
 
 void finish() {
+	SetMemoryPressureCallback(nullptr);
+}
+
+namespace {
+
+constexpr auto kMemoryPressureCheckTimeout = 10 * crl::time(1000);
+
+// Percent of time some tasks were stalled on memory in last 10 seconds.
+constexpr auto kMemoryPressureStart = 10.;
+constexpr auto kMemoryPressureFinish = 2.;
+
+Fn<void()> MemoryPressureCallback;
+std::unique_ptr<base::Timer> MemoryPressureTimer;
+bool MemoryPressureReported = false;
+
+[[nodiscard]] std::optional<float64> ReadMemoryPressure() {
+	// The cgroup pressure goes first, it is what limits us in containers.
+	const auto paths = {
+		"/sys/fs/cgroup/memory.pressure",
+		"/proc/pressure/memory",
+	};
+	for (const auto path : paths) {
+		auto f = QFile(path);
+		if (!f.open(QIODevice::ReadOnly)) {
+			continue;
+		}
+
+		// some avg10=0.00 avg60=0.00 avg300=0.00 total=0
+		const auto line = QString::fromLatin1(f.readLine());
+		const auto match = QRegularExpression(
+			"^some avg10=([\\d\\.]+)").match(line);
+		if (match.hasMatch()) {
+			return match.captured(1).toDouble();
+		}
+	}
+	return std::nullopt;
+}
+
+void CheckMemoryPressure() {
+	const auto pressure = ReadMemoryPressure();
+	if (!pressure) {
+		// No PSI support in the kernel.
+		MemoryPressureTimer->cancel();
+		return;
+	} else if (*pressure >= kMemoryPressureStart) {
+		if (!MemoryPressureReported) {
+			MemoryPressureReported = true;
+			MemoryPressureCallback();
+		}
+	} else if (*pressure < kMemoryPressureFinish) {
+		MemoryPressureReported = false;
+	}
+}
+
+} // namespace
+
+void SetMemoryPressureCallback(Fn<void()> callback) {
+	MemoryPressureCallback = std::move(callback);
+	MemoryPressureReported = false;
+	if (!MemoryPressureCallback) {
+		MemoryPressureTimer = nullptr;
+		return;
+	}
+	MemoryPressureTimer = std::make_unique<base::Timer>(CheckMemoryPressure);
+	MemoryPressureTimer->callEach(kMemoryPressureCheckTimeout);
+	CheckMemoryPressure();
 }
 
 void RegisterCustomScheme() {
@@ -113,6 +113,7 @@ void start() {
 }
 
 void finish() {
+	SetMemoryPressureCallback(nullptr);
 	objc_finish();
 }
 
@@ -254,6 +255,39 @@ void IgnoreApplicationActivationRightNow() {
 	objc_ignoreApplicationActivationRightNow();
 }
 
+#ifndef OS_MAC_OLD
+namespace {
+
+dispatch_source_t MemoryPressureSource = nullptr;
+
+} // namespace
+#endif // OS_MAC_OLD
+
+void SetMemoryPressureCallback(Fn<void()> callback) {
+#ifndef OS_MAC_OLD
+	if (MemoryPressureSource) {
+		dispatch_source_cancel(MemoryPressureSource);
+		dispatch_release(MemoryPressureSource);
+		MemoryPressureSource = nullptr;
+	}
+	if (!callback) {
+		return;
+	}
+	MemoryPressureSource = dispatch_source_create(
+		DISPATCH_SOURCE_TYPE_MEMORYPRESSURE,
+		0,
+		DISPATCH_MEMORYPRESSURE_WARN | DISPATCH_MEMORYPRESSURE_CRITICAL,
+		dispatch_get_main_queue());
+	if (!MemoryPressureSource) {
+		return;
+	}
+	dispatch_source_set_event_handler(MemoryPressureSource, ^{
+		callback();
+	});
+	dispatch_resume(MemoryPressureSource);
+#endif // OS_MAC_OLD
+}
+
 } // namespace Platform
 
 void psNewVersion() {
@@ -41,6 +41,10 @@ bool OpenSystemSettings(SystemSettingsType type);
 
 void IgnoreApplicationActivationRightNow();
 
+// The callback is called on the main thread when the system reports that
+// it is low on memory. Pass nullptr to stop watching.
+void SetMemoryPressureCallback(Fn<void()> callback);
+
 namespace ThirdParty {
 
 void start();
@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history_location_manager.h"
 #include "storage/localstorage.h"
 #include "core/crash_reports.h"
+#include "base/timer.h"
 
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QDesktopWidget>
@@ -301,6 +302,7 @@ void start() {
 }
 
 void finish() {
+	SetMemoryPressureCallback(nullptr);
 }
 
 void SetApplicationIcon(const QIcon &icon) {
@@ -333,6 +335,52 @@ std::optional<crl::time> LastUserInputTime() {
 		: std::nullopt;
 }
 
+namespace {
+
+constexpr auto kMemoryPressureCheckTimeout = 10 * crl::time(1000);
+
+Fn<void()> MemoryPressureCallback;
+std::unique_ptr<base::Timer> MemoryPressureTimer;
+HANDLE MemoryPressureNotification = nullptr;
+bool MemoryPressureReported = false;
+
+void CheckMemoryPressure() {
+	auto low = BOOL(FALSE);
+	if (!QueryMemoryResourceNotification(MemoryPressureNotification, &low)) {
+		return;
+	} else if (!low) {
+		MemoryPressureReported = false;
+	} else if (!MemoryPressureReported) {
+		MemoryPressureReported = true;
+		MemoryPressureCallback();
+	}
+}
+
+} // namespace
+
+void SetMemoryPressureCallback(Fn<void()> callback) {
+	MemoryPressureCallback = std::move(callback);
+	MemoryPressureReported = false;
+	if (!MemoryPressureCallback) {
+		MemoryPressureTimer = nullptr;
+		if (MemoryPressureNotification) {
+			CloseHandle(MemoryPressureNotification);
+			MemoryPressureNotification = nullptr;
+		}
+		return;
+	} else if (!MemoryPressureNotification) {
+		MemoryPressureNotification = CreateMemoryResourceNotification(
+			LowMemoryResourceNotification);
+		if (!MemoryPressureNotification) {
+			LOG(("System Error: "
+				"Could not create memory resource notification."));
+			return;
+		}
+	}
+	MemoryPressureTimer = std::make_unique<base::Timer>(CheckMemoryPressure);
+	MemoryPressureTimer->callEach(kMemoryPressureCheckTimeout);
+}
+
 } // namespace Platform
 
 namespace {
@@ -31,6 +31,8 @@ QString gWorkingDir, gExeDir, gExeName;
 
 QStringList gSendPaths;
 QString gStartUrl;
+QString gMtpRecordPath;
+QString gMtpReplayPath;
 
 QString gDialogLastPath, gDialogHelperPath; // optimize QFileDialog
 
@@ -129,6 +129,8 @@ DeclareSetting(crl::time, PasscodeLastTry);
 
 DeclareSetting(QStringList, SendPaths);
 DeclareSetting(QString, StartUrl);
+DeclareSetting(QString, MtpRecordPath);
+DeclareSetting(QString, MtpReplayPath);
 
 DeclareSetting(int, OtherOnline);
 
@@ -11,11 +11,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/toast/toast.h"
 #include "mainwidget.h"
 #include "data/data_session.h"
+#include "data/data_auto_download.h"
+#include "main/main_session.h"
 #include "storage/localstorage.h"
+#include "storage/cache/storage_cache_database.h"
 #include "boxes/confirm_box.h"
 #include "lang/lang_cloud_manager.h"
 #include "lang/lang_instance.h"
 #include "core/application.h"
+#include "core/memory_usage.h"
 #include "mtproto/mtp_instance.h"
 #include "mtproto/dc_options.h"
 #include "core/file_utilities.h"
@@ -26,6 +30,48 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "facades.h"
 
 namespace Settings {
+namespace {
+
+void LogCacheStats(
+		const QString &name,
+		const Storage::Cache::Database::Stats &stats) {
+	using Usage = Storage::Cache::Database::TaggedUsage;
+	const auto usage = [](const Usage &value) {
+		return QString("hits: %1, misses: %2, puts: %3, "
+			"read: %4, written: %5"
+		).arg(value.hits
+		).arg(value.misses
+		).arg(value.puts
+		).arg(value.bytesRead
+		).arg(value.bytesWritten);
+	};
+	const auto latency = [](const auto &histogram) {
+		return QString("count: %1, p50: %2us, p90: %3us, p99: %4us"
+		).arg(histogram.count()
+		).arg(histogram.percentile(50)
+		).arg(histogram.percentile(90)
+		).arg(histogram.percentile(99));
+	};
+	LOG(("Cache Stats (%1): %2 entries, %3 bytes, %4."
+		).arg(name
+		).arg(stats.full.count
+		).arg(stats.full.totalSize
+		).arg(usage(stats.fullUsage)));
+	for (const auto &[tag, tagged] : stats.taggedUsage) {
+		LOG(("Cache Stats (%1): tag %2, %3."
+			).arg(name
+			).arg(int(tag)
+			).arg(usage(tagged)));
+	}
+	LOG(("Cache Stats (%1): get latency, %2."
+		).arg(name
+		).arg(latency(stats.getLatency)));
+	LOG(("Cache Stats (%1): put latency, %2."
+		).arg(name
+		).arg(latency(stats.putLatency)));
+}
+
+} // namespace
 
 auto GenerateCodes() {
 	auto codes = std::map<QString, Fn<void(::Main::Session*)>>();
@@ -119,6 +165,44 @@ auto GenerateCodes() {
 	codes.emplace(qsl("export"), [](::Main::Session *session) {
 		session->data().startExport();
 	});
+	codes.emplace(qsl("cachestats"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		using Stats = Storage::Cache::Database::Stats;
+		rpl::combine(
+			session->data().cache().statsOnMain(),
+			session->data().cacheBigFile().statsOnMain()
+		) | rpl::take(
+			1
+		) | rpl::start_with_next([](Stats &&stats, Stats &&statsBig) {
+			LogCacheStats(qsl("main"), stats);
+			LogCacheStats(qsl("big files"), statsBig);
+			Ui::Toast::Show("Cache stats written to the log.");
+		}, session->lifetime());
+	});
+
+	codes.emplace(qsl("memoryusage"), [](::Main::Session *session) {
+		Core::LogMemoryUsage();
+		Ui::Toast::Show("Memory usage written to the log.");
+	});
+	codes.emplace(qsl("autodownloadbudget"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		constexpr auto kBudget = int64(100 * 1024 * 1024);
+		auto &settings = session->settings().autoDownload();
+		const auto enable = !settings.budgetBytesLimit();
+		settings.setBudgetBytesLimit(enable ? kBudget : 0);
+		Local::writeUserSettings();
+		if (!enable) {
+			session->data().photoLoadSettingsChanged();
+			session->data().documentLoadSettingsChanged();
+		}
+		Ui::Toast::Show(enable
+			? "Automatic downloads are limited to 100 MB an hour."
+			: "Automatic downloads are not limited.");
+	});
 
 	auto audioFilters = qsl("Audio files (*.wav *.mp3);;") + FileDialog::AllFilesFilter();
 	auto audioKeys = {
@@ -30,6 +30,10 @@ bool BinlogWrapper::failed() const {
 	return _failed;
 }
 
+int64 BinlogWrapper::offset() const {
+	return _binlog.offset() - _part.size();
+}
+
 std::optional<BasicHeader> BinlogWrapper::ReadHeader(
 		File &binlog,
 		const Settings &settings) {
@@ -38,7 +42,8 @@ std::optional<BasicHeader> BinlogWrapper::ReadHeader(
 		return {};
 	} else if (binlog.read(bytes::object_as_span(&result)) != sizeof(result)) {
 		return {};
-	} else if (result.getFormat() != Format::Format_0) {
+	} else if (result.getFormat() != Format::Format_0
+		&& result.getFormat() != Format::Format_1) {
 		return {};
 	} else if (settings.trackEstimatedTime
 		!= !!(result.flags & result.kTrackEstimatedTime)) {
@@ -104,6 +109,7 @@ void BinlogWrapper::finish(size_type rollback) {
 	}
 	rollback += _part.size();
 	_binlog.seek(_binlog.offset() - rollback);
+	_part = bytes::span();
 }
 
 } // namespace details
@@ -26,6 +26,9 @@ public:
 	bool finished() const;
 	bool failed() const;
 
+	// Offset of the first record that was not parsed yet.
+	int64 offset() const;
+
 	static std::optional<BasicHeader> ReadHeader(
 		File &binlog,
 		const Settings &settings);
@@ -9,11 +9,31 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "storage/cache/storage_cache_database_object.h"
 #include "storage/cache/storage_cache_binlog_reader.h"
+#include <unordered_map>
 #include <unordered_set>
 
 namespace Storage {
 namespace Cache {
 namespace details {
+namespace {
+
+// Saved after each written chunk, so that an interrupted compaction
+// could continue from the same binlog offset in the next attempt.
+struct CompactProgress {
+	BasicHeader header;
+	int64 readTill = 0;
+	int64 compactSize = 0;
+};
+
+static_assert(GoodForEncryption<CompactProgress>);
+
+bool SameHeader(const BasicHeader &a, const BasicHeader &b) {
+	return (a.format == b.format)
+		&& (a.flags == b.flags)
+		&& (a.systemTime == b.systemTime);
+}
+
+} // namespace
 
 class CompactorObject {
 public:
@@ -32,11 +52,17 @@ private:
 	using Entry = DatabaseObject::Entry;
 	using Raw = DatabaseObject::Raw;
 	using RawSpan = gsl::span<const Raw>;
+	struct Chunk {
+		std::vector<Key> keys;
+		int64 till = 0;
+	};
 	static QString CompactFilename();
+	static QString ProgressFilename();
 
 	void start();
 	QString binlogPath() const;
 	QString compactPath() const;
+	QString progressPath() const;
 	bool openBinlog();
 	bool readHeader();
 	bool openCompact();
@@ -46,9 +72,27 @@ private:
 	void finish();
 	void finalize();
 
-	std::vector<Key> readChunk();
+	bool resume();
+	std::optional<CompactProgress> readProgress() const;
+	bool readCompacted(const CompactProgress &progress);
+	template <typename StoreRecord, typename MultiStoreRecord>
+	bool readCompactedRecords(
+		BinlogWrapper &wrapper,
+		std::unordered_map<Key, Entry> &result) const;
+	void revalidate();
+	void processRevalidated(
+		const std::vector<Raw> &values,
+		size_type from,
+		size_type till);
+	bool sameEntry(const Entry &a, const Entry &b) const;
+	void writeProgress(int64 readTill);
+
+	Chunk readChunk();
 	bool readBlock(std::vector<Key> &result);
-	void processValues(const std::vector<Raw> &values);
+	void requestChunk(Chunk &&chunk);
+	void processValues(const std::vector<Raw> &values, int64 till);
+	bool writeValues(RawSpan values);
+	bool writeRemoved(const std::vector<Key> &keys);
 
 	template <typename MultiRecord>
 	void initList();
@@ -76,6 +120,11 @@ private:
 	BinlogWrapper _wrapper;
 	size_type _partSize = 0;
 	std::unordered_set<Key> _written;
+	Chunk _next;
+	std::vector<Raw> _resumed;
+	size_type _revalidated = 0;
+	int64 _resumedTill = 0;
+	bool _failed = false;
 	base::variant<
 		std::vector<MultiStore::Part>,
 		std::vector<MultiStoreWithTime::Part>> _list;
@@ -114,21 +163,32 @@ void CompactorObject::initList() {
 }
 
 void CompactorObject::start() {
-	if (!openBinlog() || !readHeader() || !openCompact()) {
+	if (!openBinlog() || !readHeader()) {
 		fail();
+		return;
 	}
 	if (_settings.trackEstimatedTime) {
 		initList<MultiStoreWithTime>();
 	} else {
 		initList<MultiStore>();
 	}
-	parseChunk();
+	if (resume()) {
+		revalidate();
+	} else if (!openCompact()) {
+		fail();
+	} else {
+		parseChunk();
+	}
 }
 
 QString CompactorObject::CompactFilename() {
 	return QStringLiteral("binlog-temp");
 }
 
+QString CompactorObject::ProgressFilename() {
+	return QStringLiteral("binlog-temp-progress");
+}
+
 QString CompactorObject::binlogPath() const {
 	return _base + DatabaseObject::BinlogFilename();
 }
@@ -137,6 +197,10 @@ QString CompactorObject::compactPath() const {
 	return _base + CompactFilename();
 }
 
+QString CompactorObject::progressPath() const {
+	return _base + ProgressFilename();
+}
+
 bool CompactorObject::openBinlog() {
 	const auto path = binlogPath();
 	const auto result = _binlog.open(path, File::Mode::Read, _key);
@@ -164,9 +228,213 @@ bool CompactorObject::openCompact() {
 	return true;
 }
 
+bool CompactorObject::resume() {
+	const auto progress = readProgress();
+	if (!progress) {
+		return false;
+	} else if (!readCompacted(*progress)) {
+		_resumed.clear();
+		return false;
+	}
+	const auto path = compactPath();
+	const auto result = _compact.open(path, File::Mode::ReadAppend, _key);
+	if (result != File::Result::Success
+		|| !_compact.seek(_compact.size())
+		|| !_binlog.seek(progress->readTill)) {
+		_compact.close();
+		_resumed.clear();
+		return false;
+	}
+	_resumedTill = progress->readTill;
+	return true;
+}
+
+std::optional<CompactProgress> CompactorObject::readProgress() const {
+	File file;
+	const auto result = file.open(progressPath(), File::Mode::Read, _key);
+	if (result != File::Result::Success) {
+		return std::nullopt;
+	}
+	auto progress = CompactProgress();
+	if (file.read(bytes::object_as_span(&progress)) != sizeof(progress)) {
+		return std::nullopt;
+	} else if (!SameHeader(progress.header, _header)
+		|| progress.readTill < int64(sizeof(BasicHeader))
+		|| progress.readTill > _info.till
+		|| progress.compactSize < int64(sizeof(BasicHeader))) {
+		return std::nullopt;
+	}
+	return progress;
+}
+
+bool CompactorObject::readCompacted(const CompactProgress &progress) {
+	File compact;
+	const auto result = compact.open(compactPath(), File::Mode::Read, _key);
+	if (result != File::Result::Success
+		|| compact.size() != progress.compactSize) {
+		return false;
+	}
+	const auto header = BinlogWrapper::ReadHeader(compact, _settings);
+	if (!header || !SameHeader(*header, _header)) {
+		return false;
+	}
+	auto entries = std::unordered_map<Key, Entry>();
+	BinlogWrapper wrapper(compact, _settings);
+	const auto read = _settings.trackEstimatedTime
+		? readCompactedRecords<StoreWithTime, MultiStoreWithTime>(
+			wrapper,
+			entries)
+		: readCompactedRecords<Store, MultiStore>(wrapper, entries);
+	if (!read
+		|| wrapper.failed()
+		|| wrapper.offset() != progress.compactSize) {
+		return false;
+	}
+	_resumed = std::vector<Raw>(
+		std::make_move_iterator(begin(entries)),
+		std::make_move_iterator(end(entries)));
+	return true;
+}
+
+template <typename StoreRecord, typename MultiStoreRecord>
+bool CompactorObject::readCompactedRecords(
+		BinlogWrapper &wrapper,
+		std::unordered_map<Key, Entry> &result) const {
+	const auto store = [&](const StoreRecord &record) {
+		const auto size = record.getSize();
+		if (size <= 0 || size > _settings.maxDataSize) {
+			return false;
+		}
+		auto entry = Entry(record.place, record.tag, record.checksum, size, 0);
+		if constexpr (std::is_same_v<StoreRecord, StoreWithTime>) {
+			entry.useTime = record.time.getRelative();
+			entry.rawSize = record.getCompressedRawSize();
+		}
+		result[record.key] = entry;
+		return true;
+	};
+	BinlogReader<MultiStoreRecord, MultiRemove> reader(wrapper);
+	while (true) {
+		const auto done = reader.readTillEnd([&](
+				const MultiStoreRecord &header,
+				const auto &element) {
+			while (const auto record = element()) {
+				if (!store(*record)) {
+					return false;
+				}
+			}
+			return true;
+		}, [&](const MultiRemove &header, const auto &element) {
+			while (const auto key = element()) {
+				result.erase(*key);
+			}
+			return true;
+		});
+		if (done) {
+			return true;
+		}
+	}
+}
+
+// Entries of the resumed part could change or be removed while this
+// compaction was interrupted, so they're checked against the database.
+void CompactorObject::revalidate() {
+	if (_failed) {
+		return;
+	}
+	const auto from = _revalidated;
+	const auto till = std::min(
+		from + size_type(_settings.compactChunkSize),
+		size_type(_resumed.size()));
+	if (from == till) {
+		_resumed = std::vector<Raw>();
+		_revalidated = 0;
+		parseChunk();
+		return;
+	}
+	_revalidated = till;
+	auto keys = std::vector<Key>();
+	keys.reserve(till - from);
+	for (auto i = from; i != till; ++i) {
+		keys.push_back(_resumed[i].first);
+	}
+	_database.with([
+		weak = _weak,
+		keys = std::move(keys),
+		from,
+		till
+	](DatabaseObject &database) {
+		auto result = database.getManyRaw(keys);
+		weak.with([
+			result = std::move(result),
+			from,
+			till
+		](CompactorObject &that) {
+			that.processRevalidated(result, from, till);
+		});
+	});
+}
+
+void CompactorObject::processRevalidated(
+		const std::vector<Raw> &values,
+		size_type from,
+		size_type till) {
+	if (_failed) {
+		return;
+	}
+	auto removed = std::vector<Key>();
+	auto changed = std::vector<Raw>();
+	auto value = begin(values);
+	for (auto i = from; i != till; ++i) {
+		const auto &[key, entry] = _resumed[i];
+		if (value == end(values) || value->first != key) {
+			removed.push_back(key);
+			continue;
+		} else if (sameEntry(value->second, entry)) {
+			_written.emplace(key);
+		} else {
+			changed.push_back(*value);
+		}
+		++value;
+	}
+	if (!writeRemoved(removed) || !writeValues(changed)) {
+		fail();
+		return;
+	}
+	writeProgress(_resumedTill);
+	revalidate();
+}
+
+bool CompactorObject::sameEntry(const Entry &a, const Entry &b) const {
+	return (a.place == b.place)
+		&& (a.tag == b.tag)
+		&& (a.checksum == b.checksum)
+		&& (a.size == b.size)
+		&& (a.rawSize == b.rawSize)
+		&& (!_settings.trackEstimatedTime || a.useTime == b.useTime);
+}
+
+void CompactorObject::writeProgress(int64 readTill) {
+	auto progress = CompactProgress();
+	progress.header = _header;
+	progress.readTill = readTill;
+	progress.compactSize = _compact.size();
+
+	// Without the progress marker the next attempt just starts over.
+	File file;
+	const auto result = file.open(progressPath(), File::Mode::Write, _key);
+	if (result != File::Result::Success
+		|| !file.write(bytes::object_as_span(&progress))) {
+		file.close();
+		QFile(progressPath()).remove();
+	}
+}
+
 void CompactorObject::fail() {
+	_failed = true;
 	_compact.close();
 	QFile(compactPath()).remove();
+	QFile(progressPath()).remove();
 	_database.with([](DatabaseObject &database) {
 		database.compactorFail();
 	});
@@ -192,6 +460,7 @@ void CompactorObject::finish() {
 void CompactorObject::finalize() {
 	_binlog.close();
 	_compact.close();
+	QFile(progressPath()).remove();
 
 	auto lastCatchUp = 0;
 	auto from = _info.till;
@@ -244,14 +513,15 @@ bool CompactorObject::writeMultiStore() {
 	return false;
 }
 
-std::vector<Key> CompactorObject::readChunk() {
+auto CompactorObject::readChunk() -> Chunk {
 	const auto limit = _settings.compactChunkSize;
-	auto result = std::vector<Key>();
-	while (result.size() < limit) {
-		if (!readBlock(result)) {
+	auto result = Chunk();
+	while (result.keys.size() < limit) {
+		if (!readBlock(result.keys)) {
 			break;
 		}
 	}
+	result.till = _wrapper.offset();
 	return result;
 }
 
@@ -296,39 +566,88 @@ bool CompactorObject::readBlock(std::vector<Key> &result) {
 	}
 }
 
+// While the database thread looks up the values of one chunk the next
+// chunk is read and parsed here, values are written in the binlog order.
 void CompactorObject::parseChunk() {
-	auto keys = readChunk();
+	auto chunk = readChunk();
 	if (_wrapper.failed()) {
 		fail();
 		return;
-	} else if (keys.empty()) {
+	} else if (chunk.keys.empty()) {
 		finish();
 		return;
 	}
+	requestChunk(std::move(chunk));
+	_next = readChunk();
+}
+
+void CompactorObject::requestChunk(Chunk &&chunk) {
 	_database.with([
 		weak = _weak,
-		keys = std::move(keys)
+		keys = std::move(chunk.keys),
+		till = chunk.till
 	](DatabaseObject &database) {
 		auto result = database.getManyRaw(keys);
-		weak.with([result = std::move(result)](CompactorObject &that) {
-			that.processValues(result);
+		weak.with([result = std::move(result), till](CompactorObject &that) {
+			that.processValues(result, till);
 		});
 	});
 }
 
 void CompactorObject::processValues(
-		const std::vector<std::pair<Key, Entry>> &values) {
-	auto left = gsl::make_span(values);
+		const std::vector<Raw> &values,
+		int64 till) {
+	if (_failed) {
+		return;
+	}
+	auto next = base::take(_next);
+	const auto last = next.keys.empty();
+	if (!last) {
+		requestChunk(std::move(next));
+	}
+	if (!writeValues(values)) {
+		fail();
+		return;
+	}
+	writeProgress(till);
+	if (!last) {
+		_next = readChunk();
+	} else if (_wrapper.failed()) {
+		fail();
+	} else {
+		finish();
+	}
+}
+
+bool CompactorObject::writeValues(RawSpan values) {
 	while (true) {
-		left = fillList(left);
-		if (left.empty()) {
-			break;
-		} else if (!writeList()) {
-			fail();
-			return;
+		values = fillList(values);
+		if (!writeList()) {
+			return false;
+		} else if (values.empty()) {
+			return true;
+		}
+	}
+}
+
+bool CompactorObject::writeRemoved(const std::vector<Key> &keys) {
+	auto left = gsl::make_span(keys);
+	while (!left.empty()) {
+		const auto size = std::min(
+			size_type(left.size()),
+			_settings.maxBundledRecords);
+		auto header = MultiRemove(size);
+		auto list = std::vector<MultiRemove::Part>(
+			left.begin(),
+			left.begin() + size);
+		if (!_compact.write(bytes::object_as_span(&header))
+			|| !_compact.write(bytes::make_span(list))) {
+			return false;
 		}
+		left = left.subspan(size);
 	}
-	parseChunk();
+	_compact.flush();
+	return true;
 }
 
 auto CompactorObject::fillList(RawSpan values) -> RawSpan {
@@ -367,6 +686,7 @@ void CompactorObject::addListRecord(
 	if constexpr (std::is_same_v<RecordStore, StoreWithTime>) {
 		record.time.setRelative(raw.second.useTime);
 		record.time.system = _info.systemTime;
+		record.setCompressedRawSize(raw.second.rawSize);
 	}
 	list.push_back(record);
 }
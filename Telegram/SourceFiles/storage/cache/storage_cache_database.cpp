@@ -8,49 +8,327 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/cache/storage_cache_database.h"
 
 #include "storage/cache/storage_cache_database_object.h"
+#include "storage/storage_encryption.h"
+#include "base/flat_map.h"
+#include <mutex>
 
 namespace Storage {
 namespace Cache {
+namespace {
+
+QString ShardPath(const QString &base, size_type index) {
+	return base + QStringLiteral("shard") + QString::number(index);
+}
+
+[[nodiscard]] auto JoinErrors(size_type count, FnMut<void(Error)> &&done) {
+	struct State {
+		std::mutex mutex;
+		size_type left = 0;
+		Error error;
+		FnMut<void(Error)> done;
+	};
+	const auto state = std::make_shared<State>();
+	state->left = count;
+	state->done = std::move(done);
+	return [=](Error error) {
+		auto lock = std::unique_lock<std::mutex>(state->mutex);
+		if (error.type != Error::Type::None
+			&& state->error.type == Error::Type::None) {
+			state->error = error;
+		}
+		if (--state->left > 0) {
+			return;
+		}
+		auto callback = base::take(state->done);
+		const auto result = state->error;
+		lock.unlock();
+		if (callback) {
+			callback(result);
+		}
+	};
+}
+
+[[nodiscard]] auto JoinDone(size_type count, FnMut<void()> &&done) {
+	auto joined = JoinErrors(count, [done = std::move(done)](
+			Error) mutable {
+		if (done) {
+			done();
+		}
+	});
+	return [=] { joined(Error::NoError()); };
+}
+
+details::Stats SumStats(
+		const std::vector<std::optional<details::Stats>> &list) {
+	auto result = details::Stats();
+	for (const auto &stats : list) {
+		result.full.count += stats->full.count;
+		result.full.totalSize += stats->full.totalSize;
+		for (const auto &[tag, summary] : stats->tagged) {
+			auto &sum = result.tagged[tag];
+			sum.count += summary.count;
+			sum.totalSize += summary.totalSize;
+		}
+		result.fullUsage.merge(stats->fullUsage);
+		for (const auto &[tag, usage] : stats->taggedUsage) {
+			result.taggedUsage[tag].merge(usage);
+		}
+		result.getLatency.merge(stats->getLatency);
+		result.putLatency.merge(stats->putLatency);
+		result.clearing = result.clearing || stats->clearing;
+	}
+	return result;
+}
+
+} // namespace
+
+struct Database::Batch {
+	std::mutex mutex;
+	std::vector<Key> keys;
+	std::vector<FnMut<void(QByteArray&&)>> callbacks;
+};
+
+// Copying or moving a value between shards is done in several steps on
+// two shard queues. While it is in progress both keys are locked, and
+// other requests for them wait in the order they were made.
+class Database::KeyLocks final {
+public:
+	void run(const Key &key, FnMut<void()> &&task);
+	void lockAndRun(
+		const Key &first,
+		const Key &second,
+		FnMut<void()> &&task);
+	void unlock(const Key &first, const Key &second);
+
+private:
+	void unlock(const Key &key);
+
+	std::mutex _mutex;
+	base::flat_map<Key, std::vector<FnMut<void()>>> _waiting;
+
+};
+
+void Database::KeyLocks::run(const Key &key, FnMut<void()> &&task) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const auto i = _waiting.find(key);
+		if (i != end(_waiting)) {
+			i->second.push_back(std::move(task));
+			return;
+		}
+	}
+	task();
+}
+
+void Database::KeyLocks::lockAndRun(
+		const Key &first,
+		const Key &second,
+		FnMut<void()> &&task) {
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto i = _waiting.find(first);
+		if (i == end(_waiting)) {
+			i = _waiting.find(second);
+		}
+		if (i != end(_waiting)) {
+			i->second.push_back([=, task = std::move(task)]() mutable {
+				lockAndRun(first, second, std::move(task));
+			});
+			return;
+		}
+		_waiting.emplace(first, std::vector<FnMut<void()>>());
+		_waiting.emplace(second, std::vector<FnMut<void()>>());
+	}
+	task();
+}
+
+void Database::KeyLocks::unlock(const Key &first, const Key &second) {
+	unlock(first);
+	if (second != first) {
+		unlock(second);
+	}
+}
+
+void Database::KeyLocks::unlock(const Key &key) {
+	auto tasks = std::vector<FnMut<void()>>();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		const auto i = _waiting.find(key);
+		Assert(i != end(_waiting));
+		tasks = std::move(i->second);
+		_waiting.erase(i);
+	}
+	for (auto i = begin(tasks); i != end(tasks); ++i) {
+		{
+			// If one of the tasks locked the key again, the rest wait.
+			std::lock_guard<std::mutex> lock(_mutex);
+			const auto j = _waiting.find(key);
+			if (j != end(_waiting)) {
+				j->second.insert(
+					begin(j->second),
+					std::make_move_iterator(i),
+					std::make_move_iterator(end(tasks)));
+				return;
+			}
+		}
+		(*i)();
+	}
+}
 
 Database::Database(const QString &path, const Settings &settings)
-: _wrapped(path, settings) {
+: _keyLocks(std::make_shared<KeyLocks>()) {
+	Expects(settings.shardsCount > 0);
+
+	_batches.reserve(settings.shardsCount);
+	for (auto i = size_type(); i != settings.shardsCount; ++i) {
+		_batches.push_back(std::make_shared<Batch>());
+	}
+	if (settings.shardsCount == 1) {
+		_shards.push_back(std::make_shared<Wrapped>(path, settings));
+		return;
+	}
+	const auto base = details::ComputeBasePath(path);
+	const auto budget = std::make_shared<details::SharedBudget>(
+		settings.shardsCount);
+	_shards.reserve(settings.shardsCount);
+	for (auto i = size_type(); i != settings.shardsCount; ++i) {
+		_shards.push_back(std::make_shared<Wrapped>(
+			ShardPath(base, i),
+			settings,
+			budget,
+			i));
+	}
+}
+
+size_type Database::shardIndex(const Key &key) const {
+	const auto count = size_type(_shards.size());
+	if (count == 1) {
+		return 0;
+	}
+
+	// Keys differing only in the lowest 16 bits of 'low' share a shard.
+	// Keys counted as a base key plus an offset (slices of one big file)
+	// can still cross into the next shard when the addition carries, so
+	// the operations on several keys split them by shard.
+	const auto mixed = key.high
+		^ ((key.low >> 16) * 0x9E3779B97F4A7C15ULL);
+	return size_type((mixed ^ (mixed >> 29)) % uint64(count));
+}
+
+auto Database::shard(const Key &key) const
+-> const std::shared_ptr<Wrapped> & {
+	return _shards[shardIndex(key)];
 }
 
 void Database::reconfigure(const Settings &settings) {
-	_wrapped.with([settings](Implementation &unwrapped) mutable {
-		unwrapped.reconfigure(settings);
-	});
+	Expects(settings.shardsCount == _shards.size());
+
+	for (const auto &shard : _shards) {
+		shard->with([settings](Implementation &unwrapped) mutable {
+			unwrapped.reconfigure(settings);
+		});
+	}
 }
 
 void Database::updateSettings(const SettingsUpdate &update) {
-	_wrapped.with([update](Implementation &unwrapped) mutable {
-		unwrapped.updateSettings(update);
+	for (const auto &shard : _shards) {
+		shard->with([update](Implementation &unwrapped) mutable {
+			unwrapped.updateSettings(update);
+		});
+	}
+}
+
+template <typename Callback>
+void Database::withKey(const Key &key, Callback &&callback) {
+	const auto &wrapped = shard(key);
+	if (_shards.size() == 1) {
+		wrapped->with(std::forward<Callback>(callback));
+		return;
+	}
+	_keyLocks->run(key, [
+		weak = std::weak_ptr<Wrapped>(wrapped),
+		callback = std::forward<Callback>(callback)
+	]() mutable {
+		if (const auto strong = weak.lock()) {
+			strong->with(std::move(callback));
+		}
 	});
 }
 
-void Database::open(EncryptionKey &&key, FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		key = std::move(key),
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.open(std::move(key), std::move(done));
+template <typename Callback>
+void Database::withKeys(
+		const Key &first,
+		const Key &second,
+		Callback &&callback) {
+	Expects(shardIndex(first) == shardIndex(second));
+
+	// The shard queue keeps the order once the task is posted there.
+	const auto locks = _keyLocks;
+	locks->lockAndRun(first, second, [
+		=,
+		weak = std::weak_ptr<Wrapped>(shard(first)),
+		callback = std::forward<Callback>(callback)
+	]() mutable {
+		if (const auto strong = weak.lock()) {
+			strong->with(std::move(callback));
+		}
+		locks->unlock(first, second);
 	});
 }
 
+void Database::open(EncryptionKey &&key, FnMut<void(Error)> &&done) {
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			key = std::move(key),
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.open(std::move(key), std::move(done));
+		});
+		return;
+	}
+	const auto joined = JoinErrors(_shards.size(), std::move(done));
+	for (const auto &shard : _shards) {
+		shard->with([
+			key = base::duplicate(key),
+			done = joined
+		](Implementation &unwrapped) mutable {
+			unwrapped.open(std::move(key), done);
+		});
+	}
+}
+
 void Database::close(FnMut<void()> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.close(std::move(done));
-	});
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.close(std::move(done));
+		});
+		return;
+	}
+	const auto joined = JoinDone(_shards.size(), std::move(done));
+	for (const auto &shard : _shards) {
+		shard->with([done = joined](Implementation &unwrapped) mutable {
+			unwrapped.close(done);
+		});
+	}
 }
 
 void Database::waitForCleaner(FnMut<void()> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.waitForCleaner(std::move(done));
-	});
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.waitForCleaner(std::move(done));
+		});
+		return;
+	}
+	const auto joined = JoinDone(_shards.size(), std::move(done));
+	for (const auto &shard : _shards) {
+		shard->with([done = joined](Implementation &unwrapped) mutable {
+			unwrapped.waitForCleaner(done);
+		});
+	}
 }
 
 void Database::put(
@@ -72,7 +350,7 @@ void Database::get(const Key &key, FnMut<void(QByteArray&&)> &&done) {
 }
 
 void Database::remove(const Key &key, FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	withKey(key, [
 		key,
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
@@ -94,12 +372,73 @@ void Database::copyIfEmpty(
 		const Key &from,
 		const Key &to,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	const auto &source = shard(from);
+	const auto &target = shard(to);
+	if (_shards.size() == 1) {
+		source->with([
+			from,
+			to,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.copyIfEmpty(from, to, std::move(done));
+		});
+		return;
+	} else if (source == target) {
+		withKeys(from, to, [
+			from,
+			to,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.copyIfEmpty(from, to, std::move(done));
+		});
+		return;
+	}
+
+	// Between shards the keys stay locked until the value is copied,
+	// so that other changes of them are not mixed with our steps.
+	const auto locks = _keyLocks;
+	auto finish = [=, done = std::move(done)](Error error) mutable {
+		locks->unlock(from, to);
+		if (done) {
+			done(error);
+		}
+	};
+	locks->lockAndRun(from, to, [
 		from,
 		to,
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.copyIfEmpty(from, to, std::move(done));
+		source = std::weak_ptr<Wrapped>(source),
+		target = std::weak_ptr<Wrapped>(target),
+		done = std::move(finish)
+	]() mutable {
+		const auto strong = source.lock();
+		if (!strong) {
+			done(Error::NoError());
+			return;
+		}
+		strong->with([
+			from,
+			to,
+			target,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.get(from, [&](TaggedValue &&value) {
+				const auto strong = target.lock();
+				if (value.bytes.isEmpty() || !strong) {
+					done(Error::NoError());
+					return;
+				}
+				strong->with([
+					to,
+					value = std::move(value),
+					done = std::move(done)
+				](Implementation &unwrapped) mutable {
+					unwrapped.putIfEmpty(
+						to,
+						std::move(value),
+						std::move(done));
+				});
+			});
+		});
 	});
 }
 
@@ -107,12 +446,94 @@ void Database::moveIfEmpty(
 		const Key &from,
 		const Key &to,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	const auto &source = shard(from);
+	const auto &target = shard(to);
+	if (_shards.size() == 1) {
+		source->with([
+			from,
+			to,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.moveIfEmpty(from, to, std::move(done));
+		});
+		return;
+	} else if (source == target) {
+		withKeys(from, to, [
+			from,
+			to,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.moveIfEmpty(from, to, std::move(done));
+		});
+		return;
+	}
+
+	// Between shards the value is copied and then removed from the source,
+	// unless the target key is already taken and nothing was copied. The
+	// keys stay locked until it is finished.
+	const auto locks = _keyLocks;
+	auto finish = [=, done = std::move(done)](Error error) mutable {
+		locks->unlock(from, to);
+		if (done) {
+			done(error);
+		}
+	};
+	locks->lockAndRun(from, to, [
 		from,
 		to,
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.moveIfEmpty(from, to, std::move(done));
+		source = std::weak_ptr<Wrapped>(source),
+		target = std::weak_ptr<Wrapped>(target),
+		done = std::move(finish)
+	]() mutable {
+		const auto strong = source.lock();
+		if (!strong) {
+			done(Error::NoError());
+			return;
+		}
+		strong->with([
+			from,
+			to,
+			source,
+			target,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.get(from, [&](TaggedValue &&value) {
+				const auto strong = target.lock();
+				if (value.bytes.isEmpty() || !strong) {
+					done(Error::NoError());
+					return;
+				}
+				strong->with([
+					from,
+					to,
+					source,
+					value = std::move(value),
+					done = std::move(done)
+				](Implementation &unwrapped) mutable {
+					if (unwrapped.contains(to)) {
+						done(Error::NoError());
+						return;
+					}
+					unwrapped.put(to, std::move(value), [
+						from,
+						source,
+						done = std::move(done)
+					](Error error) mutable {
+						const auto strong = source.lock();
+						if (error.type != Error::Type::None || !strong) {
+							done(error);
+							return;
+						}
+						strong->with([
+							from,
+							done = std::move(done)
+						](Implementation &unwrapped) mutable {
+							unwrapped.remove(from, std::move(done));
+						});
+					});
+				});
+			});
+		});
 	});
 }
 
@@ -120,7 +541,7 @@ void Database::put(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	withKey(key, [
 		key,
 		value = std::move(value),
 		done = std::move(done)
@@ -133,7 +554,7 @@ void Database::putIfEmpty(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	withKey(key, [
 		key,
 		value = std::move(value),
 		done = std::move(done)
@@ -145,7 +566,7 @@ void Database::putIfEmpty(
 void Database::getWithTag(
 		const Key &key,
 		FnMut<void(TaggedValue&&)> &&done) {
-	_wrapped.with([
+	withKey(key, [
 		key,
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
@@ -153,48 +574,307 @@ void Database::getWithTag(
 	});
 }
 
+void Database::getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done) {
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			keys = std::move(keys),
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.getMany(keys, std::move(done));
+		});
+		return;
+	}
+	struct State {
+		std::mutex mutex;
+		size_type left = 0;
+		std::vector<TaggedValue> values;
+		FnMut<void(std::vector<TaggedValue>&&)> done;
+	};
+	const auto state = std::make_shared<State>();
+	state->values.resize(keys.size());
+	state->done = std::move(done);
+
+	auto indices = std::vector<std::vector<size_type>>(_shards.size());
+	for (auto i = size_type(), count = size_type(keys.size())
+		; i != count
+		; ++i) {
+		indices[shardIndex(keys[i])].push_back(i);
+	}
+	state->left = ranges::count_if(indices, [](const auto &list) {
+		return !list.empty();
+	});
+	if (!state->left) {
+		if (state->done) {
+			state->done(std::move(state->values));
+		}
+		return;
+	}
+	for (auto i = 0; i != _shards.size(); ++i) {
+		if (indices[i].empty()) {
+			continue;
+		}
+		auto part = ranges::view::all(
+			indices[i]
+		) | ranges::view::transform([&](size_type index) {
+			return keys[index];
+		}) | ranges::to_vector;
+		_shards[i]->with([
+			state,
+			keys = std::move(part),
+			indices = std::move(indices[i])
+		](Implementation &unwrapped) mutable {
+			unwrapped.getMany(keys, [&](std::vector<TaggedValue> &&values) {
+				auto lock = std::unique_lock<std::mutex>(state->mutex);
+				for (auto j = 0; j != values.size(); ++j) {
+					state->values[indices[j]] = std::move(values[j]);
+				}
+				if (--state->left > 0) {
+					return;
+				}
+				auto callback = base::take(state->done);
+				lock.unlock();
+				if (callback) {
+					callback(std::move(state->values));
+				}
+			});
+		});
+	}
+}
+
+void Database::getBatched(
+		const Key &key,
+		FnMut<void(QByteArray&&)> &&done) {
+	const auto index = shardIndex(key);
+	const auto &batch = _batches[index];
+	{
+		std::lock_guard<std::mutex> lock(batch->mutex);
+		batch->keys.push_back(key);
+		batch->callbacks.push_back(std::move(done));
+		if (batch->keys.size() > 1) {
+			return;
+		}
+	}
+	_shards[index]->with([batch](Implementation &unwrapped) {
+		auto keys = std::vector<Key>();
+		auto callbacks = std::vector<FnMut<void(QByteArray&&)>>();
+		{
+			std::lock_guard<std::mutex> lock(batch->mutex);
+			keys = base::take(batch->keys);
+			callbacks = base::take(batch->callbacks);
+		}
+		unwrapped.getMany(keys, [&](std::vector<TaggedValue> &&values) {
+			for (auto i = 0; i != values.size(); ++i) {
+				if (auto &callback = callbacks[i]) {
+					callback(std::move(values[i].bytes));
+				}
+			}
+		});
+	});
+}
+
+void Database::prefetch(std::vector<Key> &&keys) {
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			keys = std::move(keys)
+		](Implementation &unwrapped) {
+			unwrapped.prefetch(keys);
+		});
+		return;
+	}
+	auto parts = std::vector<std::vector<Key>>(_shards.size());
+	for (const auto &key : keys) {
+		parts[shardIndex(key)].push_back(key);
+	}
+	for (auto i = 0; i != _shards.size(); ++i) {
+		if (parts[i].empty()) {
+			continue;
+		}
+		_shards[i]->with([
+			keys = std::move(parts[i])
+		](Implementation &unwrapped) {
+			unwrapped.prefetch(keys);
+		});
+	}
+}
+
 void Database::getWithSizes(
 		const Key &key,
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done) {
-	_wrapped.with([
-		key,
-		keys = std::move(keys),
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.getWithSizes(key, std::move(keys), std::move(done));
+	const auto index = shardIndex(key);
+	const auto sameShard = ranges::all_of(keys, [&](const Key &sizeKey) {
+		return (shardIndex(sizeKey) == index);
 	});
+	if (sameShard) {
+		_shards[index]->with([
+			key,
+			keys = std::move(keys),
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.getWithSizes(key, std::move(keys), std::move(done));
+		});
+		return;
+	}
+
+	// Slices of a big file can cross into another shard, so the sizes
+	// are collected from each shard and merged with the value.
+	struct State {
+		std::mutex mutex;
+		size_type left = 0;
+		QByteArray value;
+		std::vector<int> sizes;
+		FnMut<void(QByteArray&&, std::vector<int>&&)> done;
+	};
+	const auto state = std::make_shared<State>();
+	state->sizes.resize(keys.size());
+	state->done = std::move(done);
+
+	auto indices = std::vector<std::vector<size_type>>(_shards.size());
+	for (auto i = size_type(), count = size_type(keys.size())
+		; i != count
+		; ++i) {
+		indices[shardIndex(keys[i])].push_back(i);
+	}
+	state->left = ranges::count_if(indices, [](const auto &list) {
+		return !list.empty();
+	}) + (indices[index].empty() ? 1 : 0);
+
+	const auto merge = [=](
+			const std::vector<size_type> &indices,
+			std::vector<int> &&sizes,
+			std::optional<QByteArray> value) {
+		auto lock = std::unique_lock<std::mutex>(state->mutex);
+		for (auto j = 0; j != sizes.size(); ++j) {
+			state->sizes[indices[j]] = sizes[j];
+		}
+		if (value) {
+			state->value = std::move(*value);
+		}
+		if (--state->left > 0) {
+			return;
+		}
+		auto callback = base::take(state->done);
+		auto result = std::move(state->value);
+		auto sizes = result.isEmpty()
+			? std::vector<int>()
+			: std::move(state->sizes);
+		lock.unlock();
+		if (callback) {
+			callback(std::move(result), std::move(sizes));
+		}
+	};
+	for (auto i = 0; i != _shards.size(); ++i) {
+		if (indices[i].empty() && i != index) {
+			continue;
+		}
+		auto part = ranges::view::all(
+			indices[i]
+		) | ranges::view::transform([&](size_type keyIndex) {
+			return keys[keyIndex];
+		}) | ranges::to_vector;
+		if (i != index) {
+			_shards[i]->with([
+				merge,
+				keys = std::move(part),
+				indices = std::move(indices[i])
+			](Implementation &unwrapped) {
+				merge(indices, unwrapped.getSizes(keys), std::nullopt);
+			});
+			continue;
+		}
+		_shards[i]->with([
+			key,
+			merge,
+			keys = std::move(part),
+			indices = std::move(indices[i])
+		](Implementation &unwrapped) mutable {
+			unwrapped.getWithSizes(key, std::move(keys), [&](
+					QByteArray &&value,
+					std::vector<int> &&sizes) {
+				if (sizes.empty()) {
+					// The value is absent, sizes are not needed anyway.
+					sizes.resize(indices.size());
+				}
+				merge(indices, std::move(sizes), std::move(value));
+			});
+		});
+	}
 }
 
 auto Database::statsOnMain() const -> rpl::producer<Stats> {
-	return _wrapped.producer_on_main([](const Implementation &unwrapped) {
-		return unwrapped.stats();
-	});
+	const auto onMain = [](const std::shared_ptr<Wrapped> &shard) {
+		return shard->producer_on_main([](const Implementation &unwrapped) {
+			return unwrapped.stats();
+		});
+	};
+	if (_shards.size() == 1) {
+		return onMain(_shards.front());
+	}
+	const auto weak = ranges::view::all(
+		_shards
+	) | ranges::view::transform([](const std::shared_ptr<Wrapped> &shard) {
+		return std::weak_ptr<Wrapped>(shard);
+	}) | ranges::to_vector;
+	return [=](auto consumer) {
+		auto lifetime = rpl::lifetime();
+		const auto state = lifetime.make_state<
+			std::vector<std::optional<Stats>>>(weak.size());
+		for (auto i = 0; i != weak.size(); ++i) {
+			const auto strong = weak[i].lock();
+			if (!strong) {
+				continue;
+			}
+			onMain(strong) | rpl::start_with_next([=](Stats &&stats) {
+				(*state)[i] = std::move(stats);
+				const auto ready = ranges::all_of(*state, [](
+						const std::optional<Stats> &value) {
+					return value.has_value();
+				});
+				if (ready) {
+					consumer.put_next(SumStats(*state));
+				}
+			}, lifetime);
+		}
+		return lifetime;
+	};
 }
 
 void Database::clear(FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.clear(std::move(done));
-	});
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.clear(std::move(done));
+		});
+		return;
+	}
+	const auto joined = JoinErrors(_shards.size(), std::move(done));
+	for (const auto &shard : _shards) {
+		shard->with([done = joined](Implementation &unwrapped) mutable {
+			unwrapped.clear(done);
+		});
+	}
 }
 
 void Database::clearByTag(uint8 tag, FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		tag,
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.clearByTag(tag, std::move(done));
-	});
+	const auto joined = JoinErrors(_shards.size(), std::move(done));
+	for (const auto &shard : _shards) {
+		shard->with([tag, done = joined](Implementation &unwrapped) mutable {
+			unwrapped.clearByTag(tag, done);
+		});
+	}
 }
 
 void Database::sync() {
 	auto semaphore = crl::semaphore();
-	_wrapped.with([&](Implementation &) {
-		semaphore.release();
-	});
-	semaphore.acquire();
+	for (const auto &shard : _shards) {
+		shard->with([&](Implementation &) {
+			semaphore.release();
+		});
+		semaphore.acquire();
+	}
 }
 
 Database::~Database() = default;
@@ -64,6 +64,18 @@ public:
 		FnMut<void(Error)> &&done = nullptr);
 	void getWithTag(const Key &key, FnMut<void(TaggedValue&&)> &&done);
 
+	// Values are returned in the order of keys, empty if not found.
+	void getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done);
+
+	// Requests made before the queue gets to them are read by one getMany.
+	void getBatched(const Key &key, FnMut<void(QByteArray&&)> &&done);
+
+	// Values are read in the background and kept in memory for a while,
+	// so that the following get of them doesn't wait for the disk.
+	void prefetch(std::vector<Key> &&keys);
+
 	void getWithSizes(
 		const Key &key,
 		std::vector<Key> &&keys,
@@ -71,6 +83,7 @@ public:
 
 	using Stats = details::Stats;
 	using TaggedSummary = details::TaggedSummary;
+	using TaggedUsage = details::TaggedUsage;
 	rpl::producer<Stats> statsOnMain() const;
 
 	void clear(FnMut<void(Error)> &&done = nullptr);
@@ -83,7 +96,25 @@ public:
 
 private:
 	using Implementation = details::DatabaseObject;
-	crl::object_on_queue<Implementation> _wrapped;
+	using Wrapped = crl::object_on_queue<Implementation>;
+	struct Batch;
+	class KeyLocks;
+
+	[[nodiscard]] size_type shardIndex(const Key &key) const;
+	[[nodiscard]] const std::shared_ptr<Wrapped> &shard(
+		const Key &key) const;
+
+	template <typename Callback>
+	void withKey(const Key &key, Callback &&callback);
+	template <typename Callback>
+	void withKeys(
+		const Key &first,
+		const Key &second,
+		Callback &&callback);
+
+	std::vector<std::shared_ptr<Wrapped>> _shards;
+	std::vector<std::shared_ptr<Batch>> _batches;
+	std::shared_ptr<KeyLocks> _keyLocks;
 
 };
 
@@ -0,0 +1,360 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/cache/storage_cache_database.h"
+#include "storage/storage_encryption.h"
+#include <crl/crl.h>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+// Usage: benchmark_storage [entries] [value_size] [gets] [readers] [shards]
+//
+// Every run starts from an empty database in "benchmark.db" and uses
+// fixed random seeds, so the numbers of different builds are comparable.
+
+namespace {
+
+using namespace Storage::Cache;
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kCompactionTimeout = std::chrono::minutes(10);
+
+const auto kName = QString("benchmark.db");
+
+const auto kKey = Storage::EncryptionKey(bytes::make_vector(
+	bytes::make_span("\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+").subspan(0, Storage::EncryptionKey::kSize)));
+
+struct Options {
+	int entries = 1000000;
+	int valueSize = 64;
+	int gets = 100000;
+	int readers = 4;
+	int shards = 1;
+};
+
+Options ParseOptions(int argc, char *argv[]) {
+	auto result = Options();
+	const auto fields = {
+		&result.entries,
+		&result.valueSize,
+		&result.gets,
+		&result.readers,
+		&result.shards,
+	};
+	auto index = 1;
+	for (const auto field : fields) {
+		if (index < argc) {
+			const auto value = QString::fromLatin1(argv[index++]).toInt();
+			if (value > 0) {
+				*field = value;
+			}
+		}
+	}
+	return result;
+}
+
+Database::Settings BenchmarkSettings(const Options &options) {
+	auto result = Database::Settings();
+	result.totalSizeLimit = 0;
+	result.totalTimeLimit = 0;
+	result.compactAfterExcess = 1024 * 1024;
+	result.shardsCount = options.shards;
+	return result;
+}
+
+Key MakeKey(int index) {
+	return Key{ uint64(index) * 0x9E3779B97F4A7C15ULL, uint64(index) };
+}
+
+// Each generation differs, so that overwrites really write new records.
+QByteArray MakeValue(int index, int generation, int size) {
+	auto result = QByteArray(size, Qt::Uninitialized);
+	auto generator = std::mt19937(uint32(index) * 31U + uint32(generation));
+	for (auto &ch : result) {
+		ch = char(generator() & 0xFF);
+	}
+	return result;
+}
+
+double SecondsSince(Clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(Clock::now() - started).count();
+}
+
+void Report(const char *name, int count, double seconds) {
+	std::printf(
+		"%-28s %10d ops %10.3f s %12.0f ops/s\n",
+		name,
+		count,
+		seconds,
+		(seconds > 0.) ? (count / seconds) : 0.);
+}
+
+void ReportLatency(const char *name, double average, double maximal) {
+	std::printf(
+		"%-28s avg %10.3f ms max %10.3f ms\n",
+		name,
+		average * 1000.,
+		maximal * 1000.);
+}
+
+// Waits for the given count of asynchronous operations to finish.
+class Waiter {
+public:
+	explicit Waiter(int count) : _left(count) {
+		if (!count) {
+			_semaphore.release();
+		}
+	}
+
+	void done() {
+		if (--_left == 0) {
+			_semaphore.release();
+		}
+	}
+	void wait() {
+		_semaphore.acquire();
+	}
+
+private:
+	std::atomic<int> _left = 0;
+	crl::semaphore _semaphore;
+
+};
+
+void Open(Database &db) {
+	auto waiter = Waiter(1);
+	db.open(base::duplicate(kKey), [&](Error error) {
+		if (error.type != Error::Type::None) {
+			std::printf("Could not open '%s'.\n", kName.toUtf8().data());
+			std::exit(1);
+		}
+		waiter.done();
+	});
+	waiter.wait();
+}
+
+void Close(Database &db) {
+	auto waiter = Waiter(1);
+	db.close([&] { waiter.done(); });
+	waiter.wait();
+}
+
+void Clear(Database &db) {
+	auto waiter = Waiter(1);
+	db.clear([&](Error) { waiter.done(); });
+	waiter.wait();
+}
+
+void WaitForCleaner(Database &db) {
+	auto waiter = Waiter(1);
+	db.waitForCleaner([&] { waiter.done(); });
+	waiter.wait();
+}
+
+void PutMany(
+		Database &db,
+		int from,
+		int till,
+		int generation,
+		int valueSize) {
+	auto waiter = Waiter(till - from);
+	for (auto i = from; i != till; ++i) {
+		auto value = MakeValue(i, generation, valueSize);
+		db.put(MakeKey(i), std::move(value), [&](Error) {
+			waiter.done();
+		});
+	}
+	waiter.wait();
+}
+
+int64 BinlogsSize(const Options &options) {
+	const auto binlogSize = [](const QString &base) {
+		QFile version(base + "/version");
+		if (!version.open(QIODevice::ReadOnly)) {
+			return int64();
+		}
+		const auto bytes = version.readAll();
+		if (bytes.size() != 4) {
+			return int64();
+		}
+		const auto value = *reinterpret_cast<const int32*>(bytes.data());
+		return QFile(base + '/' + QString::number(value) + "/binlog").size();
+	};
+	if (options.shards == 1) {
+		return binlogSize(kName);
+	}
+	auto result = int64();
+	for (auto i = 0; i != options.shards; ++i) {
+		result += binlogSize(kName + "/shard" + QString::number(i));
+	}
+	return result;
+}
+
+void BenchmarkFill(Database &db, const Options &options) {
+	Clear(db);
+	Open(db);
+	const auto started = Clock::now();
+	PutMany(db, 0, options.entries, 0, options.valueSize);
+	Report("put (empty db)", options.entries, SecondsSince(started));
+
+	const auto closing = Clock::now();
+	Close(db);
+	Report("close", 1, SecondsSince(closing));
+}
+
+void BenchmarkOpen(Database &db) {
+	const auto started = Clock::now();
+	Open(db);
+	Report("open", 1, SecondsSince(started));
+}
+
+void BenchmarkGet(Database &db, const Options &options) {
+	auto generator = std::mt19937(0);
+	auto distribution = std::uniform_int_distribution<int>(
+		0,
+		options.entries - 1);
+	auto waiter = Waiter(options.gets);
+	auto missing = std::atomic<int>(0);
+	const auto started = Clock::now();
+	for (auto i = 0; i != options.gets; ++i) {
+		db.get(MakeKey(distribution(generator)), [&](QByteArray &&value) {
+			if (value.isEmpty()) {
+				++missing;
+			}
+			waiter.done();
+		});
+	}
+	waiter.wait();
+	Report("random get", options.gets, SecondsSince(started));
+	if (missing) {
+		std::printf("Missing values: %d.\n", missing.load());
+	}
+}
+
+void BenchmarkPutWithReaders(Database &db, const Options &options) {
+	auto stop = std::atomic<bool>(false);
+	auto reads = std::atomic<int>(0);
+	auto readers = std::vector<std::thread>();
+	for (auto i = 0; i != options.readers; ++i) {
+		readers.emplace_back([&, seed = i + 1] {
+			auto generator = std::mt19937(seed);
+			auto distribution = std::uniform_int_distribution<int>(
+				0,
+				options.entries - 1);
+			while (!stop) {
+				auto waiter = Waiter(1);
+				db.get(MakeKey(distribution(generator)), [&](QByteArray&&) {
+					waiter.done();
+				});
+				waiter.wait();
+				++reads;
+			}
+		});
+	}
+	const auto count = std::max(options.entries / 10, 1);
+	const auto started = Clock::now();
+	PutMany(db, 0, count, 1, options.valueSize);
+	const auto seconds = SecondsSince(started);
+	stop = true;
+	for (auto &reader : readers) {
+		reader.join();
+	}
+	Report("put (with readers)", count, seconds);
+	Report("get (concurrent)", reads, seconds);
+}
+
+void BenchmarkCompaction(Database &db, const Options &options) {
+	// Overwriting entries leaves their old records as the binlog excess,
+	// the compactor should rewrite the binlog in the background.
+	const auto before = BinlogsSize(options);
+	const auto started = Clock::now();
+	PutMany(db, 0, options.entries, 2, options.valueSize);
+	const auto written = BinlogsSize(options);
+	const auto timeout = Clock::now() + kCompactionTimeout;
+	while (BinlogsSize(options) >= written && Clock::now() < timeout) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	const auto after = BinlogsSize(options);
+	if (after >= written) {
+		std::printf("Compaction did not finish in time.\n");
+		return;
+	}
+	Report("overwrite and compact", options.entries, SecondsSince(started));
+	std::printf(
+		"binlog size: %lld -> %lld -> %lld bytes\n",
+		static_cast<long long>(before),
+		static_cast<long long>(written),
+		static_cast<long long>(after));
+}
+
+void BenchmarkCleaner(Database &db, const Options &options) {
+	const auto started = Clock::now();
+	Clear(db);
+	Report("clear", 1, SecondsSince(started));
+
+	// Measure how long the requests wait while the old files are removed.
+	auto cleaned = std::atomic<bool>(false);
+	auto cleaner = std::thread([&] {
+		WaitForCleaner(db);
+		cleaned = true;
+	});
+	auto count = 0;
+	auto total = 0.;
+	auto maximal = 0.;
+	while (!cleaned) {
+		auto waiter = Waiter(1);
+		const auto requested = Clock::now();
+		db.get(MakeKey(count), [&](QByteArray&&) { waiter.done(); });
+		waiter.wait();
+		const auto seconds = SecondsSince(requested);
+		total += seconds;
+		maximal = std::max(maximal, seconds);
+		++count;
+	}
+	cleaner.join();
+	Report("cleaner", 1, SecondsSince(started));
+	ReportLatency(
+		"get (while cleaning)",
+		count ? (total / count) : 0.,
+		maximal);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	QCoreApplication application(argc, argv);
+
+	const auto options = ParseOptions(argc, argv);
+	std::printf(
+		"entries: %d, value size: %d, gets: %d, readers: %d, shards: %d\n",
+		options.entries,
+		options.valueSize,
+		options.gets,
+		options.readers,
+		options.shards);
+
+	Database db(kName, BenchmarkSettings(options));
+	BenchmarkFill(db, options);
+	BenchmarkOpen(db);
+	BenchmarkGet(db, options);
+	BenchmarkPutWithReaders(db, options);
+	BenchmarkCompaction(db, options);
+	BenchmarkCleaner(db, options);
+	Close(db);
+	return 0;
+}
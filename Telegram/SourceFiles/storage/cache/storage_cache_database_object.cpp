@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/algorithm.h"
 #include <crl/crl.h>
 #include <xxhash.h>
+#include <lz4.h>
 #include <QtCore/QDir>
 #include <unordered_map>
 #include <set>
@@ -26,6 +27,9 @@ namespace details {
 namespace {
 
 constexpr auto kMaxDelayAfterFailure = 24 * 60 * 60 * crl::time(1000);
+constexpr auto kFrequencyWindowPercent = 1;
+constexpr auto kFrequencyAverageEntrySize = int64(16 * 1024);
+constexpr auto kCompressedHeaderSize = int(sizeof(int32));
 
 uint32 CountChecksum(bytes::const_span data) {
 	const auto seed = uint32(0);
@@ -54,35 +58,139 @@ QString PlaceFromId(PlaceId place) {
 	return result;
 }
 
+int64 MicrosecondsSince(std::chrono::steady_clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now() - started).count();
+}
+
+size_type CompressedRawSize(const Store &) {
+	return 0;
+}
+
+size_type CompressedRawSize(const StoreWithTime &record) {
+	return record.getCompressedRawSize();
+}
+
+// Compressed value is the original size followed by one LZ4 block.
+QByteArray Compress(const QByteArray &bytes) {
+	const auto original = int32(bytes.size());
+	const auto bound = LZ4_compressBound(original);
+	if (bound <= 0) {
+		return QByteArray();
+	}
+	auto result = QByteArray(
+		kCompressedHeaderSize + bound,
+		Qt::Uninitialized);
+	memcpy(result.data(), &original, kCompressedHeaderSize);
+	const auto size = LZ4_compress_default(
+		bytes.constData(),
+		result.data() + kCompressedHeaderSize,
+		original,
+		bound);
+
+	// Keep the original if we don't save at least one eighth of it.
+	const auto full = kCompressedHeaderSize + size;
+	if (size <= 0 || full > original - (original / 8)) {
+		return QByteArray();
+	}
+	result.resize(full);
+	return result;
+}
+
+QByteArray Decompress(const QByteArray &bytes, size_type maxSize) {
+	if (bytes.size() <= kCompressedHeaderSize) {
+		return QByteArray();
+	}
+	auto original = int32();
+	memcpy(&original, bytes.constData(), kCompressedHeaderSize);
+	if (original <= 0 || original > maxSize) {
+		return QByteArray();
+	}
+	auto result = QByteArray(original, Qt::Uninitialized);
+	const auto size = LZ4_decompress_safe(
+		bytes.constData() + kCompressedHeaderSize,
+		result.data(),
+		bytes.size() - kCompressedHeaderSize,
+		original);
+	return (size == original) ? result : QByteArray();
+}
+
 int32 GetUnixtime() {
 	return std::max(int32(time(nullptr)), 1);
 }
 
 } // namespace
 
+SharedBudget::SharedBudget(size_type shardsCount)
+: _shards(shardsCount) {
+}
+
+void SharedBudget::registerShard(
+		size_type index,
+		crl::weak_on_queue<DatabaseObject> weak) {
+	Expects(index >= 0 && index < _shards.size());
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_shards[index] = std::move(weak);
+}
+
+void SharedBudget::add(int64 delta) {
+	_totalSize += delta;
+}
+
+int64 SharedBudget::totalSize() const {
+	return _totalSize.load();
+}
+
+void SharedBudget::requestPrune(size_type initiator) {
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto i = size_type(), count = size_type(_shards.size())
+		; i != count
+		; ++i) {
+		if (i != initiator) {
+			_shards[i].with([](DatabaseObject &that) {
+				that.checkSharedBudget();
+			});
+		}
+	}
+}
+
 DatabaseObject::Entry::Entry(
 	PlaceId place,
 	uint8 tag,
 	uint32 checksum,
 	size_type size,
-	uint64 useTime)
+	uint64 useTime,
+	size_type rawSize)
 : useTime(useTime)
 , size(size)
 , checksum(checksum)
 , place(place)
-, tag(tag) {
+, tag(tag)
+, rawSize(rawSize) {
 }
 
 DatabaseObject::DatabaseObject(
 	crl::weak_on_queue<DatabaseObject> weak,
 	const QString &path,
-	const Settings &settings)
+	const Settings &settings,
+	std::shared_ptr<SharedBudget> budget,
+	size_type shardIndex)
 : _weak(std::move(weak))
 , _base(ComputeBasePath(path))
 , _settings(settings)
-, _writeBundlesTimer(_weak, [=] { writeBundles(); checkCompactor(); })
+, _budget(std::move(budget))
+, _shardIndex(shardIndex)
+, _writeBundlesTimer(_weak, [=] {
+	writeBundles();
+	checkCompactor();
+	checkSnapshot();
+})
 , _pruneTimer(_weak, [=] { prune(); }) {
 	checkSettings();
+	if (_budget) {
+		_budget->registerShard(_shardIndex, _weak);
+	}
 }
 
 void DatabaseObject::reconfigure(const Settings &settings) {
@@ -175,6 +283,10 @@ QString DatabaseObject::CompactReadyFilename() {
 	return QStringLiteral("binlog-ready");
 }
 
+QString DatabaseObject::SnapshotFilename() {
+	return QStringLiteral("binlog-snapshot");
+}
+
 QString DatabaseObject::binlogPath(Version version) const {
 	return computePath(version) + BinlogFilename();
 }
@@ -191,14 +303,26 @@ QString DatabaseObject::compactReadyPath() const {
 	return _path + CompactReadyFilename();
 }
 
+QString DatabaseObject::snapshotPath(Version version) const {
+	return computePath(version) + SnapshotFilename();
+}
+
+QString DatabaseObject::snapshotPath() const {
+	return _path + SnapshotFilename();
+}
+
 File::Result DatabaseObject::openBinlog(
 		Version version,
 		File::Mode mode,
 		EncryptionKey &key) {
 	const auto ready = compactReadyPath(version);
 	const auto path = binlogPath(version);
-	if (QFile(ready).exists() && !File::Move(ready, path)) {
-		return File::Result::Failed;
+	if (QFile(ready).exists()) {
+		// Snapshot offsets belong to the binlog that is being replaced.
+		QFile(snapshotPath(version)).remove();
+		if (!File::Move(ready, path)) {
+			return File::Result::Failed;
+		}
 	}
 	const auto result = _binlog.open(path, mode, key);
 	if (result != File::Result::Success) {
@@ -213,6 +337,12 @@ File::Result DatabaseObject::openBinlog(
 	_path = computePath(version);
 	_key = std::move(key);
 	createCleaner();
+	if (countingFrequency()) {
+		// Sized once, old counts fade away by the periodic halving.
+		_frequency.resize(size_type(std::min(
+			_settings.totalSizeLimit / kFrequencyAverageEntrySize,
+			int64(std::numeric_limits<size_type>::max()))));
+	}
 	readBinlog();
 	return File::Result::Success;
 }
@@ -220,6 +350,7 @@ File::Result DatabaseObject::openBinlog(
 bool DatabaseObject::readHeader() {
 	if (const auto header = BinlogWrapper::ReadHeader(_binlog, _settings)) {
 		_time.setRelative((_time.system = header->systemTime));
+		_format = header->getFormat();
 		return true;
 	}
 	return false;
@@ -232,6 +363,14 @@ bool DatabaseObject::writeHeader() {
 	if (_settings.trackEstimatedTime) {
 		header.flags |= header.kTrackEstimatedTime;
 	}
+
+	// Older clients refuse to open a new format binlog and recreate it,
+	// instead of reading the compressed values as raw ones.
+	_format = (_settings.trackEstimatedTime
+		&& !_settings.compressedTags.empty())
+		? Format::Format_1
+		: Format::Format_0;
+	header.setFormat(_format);
 	return _binlog.write(bytes::object_as_span(&header));
 }
 
@@ -249,6 +388,9 @@ void DatabaseObject::readBinlogHelper(
 }
 
 void DatabaseObject::readBinlog() {
+	if (!readSnapshot()) {
+		_snapshotOffset = 0;
+	}
 	BinlogWrapper wrapper(_binlog, _settings);
 	if (_settings.trackEstimatedTime) {
 		BinlogReader<
@@ -284,6 +426,121 @@ void DatabaseObject::readBinlog() {
 	optimize();
 }
 
+bool DatabaseObject::readSnapshot() {
+	static_assert(GoodForEncryption<SnapshotHeader>);
+	static_assert(GoodForEncryption<SnapshotHeader::Part>);
+
+	if (!_settings.snapshotAfterTail) {
+		return false;
+	}
+	File snapshot;
+	const auto result = snapshot.open(snapshotPath(), File::Mode::Read, _key);
+	if (result != File::Result::Success) {
+		return false;
+	}
+	auto header = SnapshotHeader();
+	if (snapshot.read(bytes::object_as_span(&header)) != sizeof(header)) {
+		return false;
+	}
+	using Part = SnapshotHeader::Part;
+	const auto trackEstimatedTime = (header.flags
+		& SnapshotHeader::kTrackEstimatedTime) != 0;
+	const auto dataSize = int64(header.count) * sizeof(Part);
+	if (header.format != 0
+		|| trackEstimatedTime != _settings.trackEstimatedTime
+		|| header.binlogOffset < _binlog.offset()
+		|| header.binlogOffset > _binlog.size()
+		|| header.binlogExcessLength < 0
+		|| snapshot.size() != sizeof(header) + dataSize) {
+		return false;
+	}
+	auto list = std::vector<Part>(header.count);
+	if (snapshot.read(bytes::make_span(list)) != dataSize) {
+		return false;
+	} else if (!_binlog.seek(header.binlogOffset)) {
+		return false;
+	}
+	for (const auto &record : list) {
+		const auto size = record.getSize();
+		if (size <= 0 || size > _settings.maxDataSize) {
+			continue;
+		}
+		setMapEntry(record.key, Entry(
+			record.place,
+			record.tag,
+			record.checksum,
+			size,
+			record.time.getRelative(),
+			CompressedRawSize(record)));
+	}
+	_time = header.time;
+	_binlogExcessLength = header.binlogExcessLength;
+	_snapshotOffset = header.binlogOffset;
+	return true;
+}
+
+void DatabaseObject::checkSnapshot() {
+	if (_settings.snapshotAfterTail > 0
+		&& _binlog.isOpen()
+		&& !_compactor.object
+		&& (_binlog.size() - _snapshotOffset
+			>= _settings.snapshotAfterTail)) {
+		writeSnapshot();
+	}
+}
+
+bool DatabaseObject::writeSnapshot() {
+	Expects(_binlog.isOpen());
+
+	using Part = SnapshotHeader::Part;
+	auto list = std::vector<Part>();
+	list.reserve(_map.size());
+	for (const auto &[key, entry] : _map) {
+		auto record = Part();
+		record.key = key;
+		record.tag = entry.tag;
+		record.setSize(entry.size);
+		record.checksum = entry.checksum;
+		record.place = entry.place;
+		record.time.setRelative(entry.useTime);
+		record.time.system = _time.system;
+		record.setCompressedRawSize(entry.rawSize);
+		list.push_back(record);
+	}
+	ranges::sort(list, std::less<>(), &Part::key);
+
+	auto header = SnapshotHeader();
+	header.count = list.size();
+	header.binlogOffset = _binlog.size();
+	header.binlogExcessLength = _binlogExcessLength;
+	header.time = _time;
+	if (_settings.trackEstimatedTime) {
+		header.flags |= SnapshotHeader::kTrackEstimatedTime;
+	}
+
+	const auto path = snapshotPath();
+	const auto temp = path + QStringLiteral("-temp");
+	{
+		File snapshot;
+		const auto result = snapshot.open(temp, File::Mode::Write, _key);
+		if (result != File::Result::Success) {
+			return false;
+		} else if (!snapshot.write(bytes::object_as_span(&header))
+			|| (!list.empty() && !snapshot.write(bytes::make_span(list)))
+			|| !snapshot.flush()) {
+			snapshot.close();
+			QFile(temp).remove();
+			return false;
+		}
+	}
+	if (!File::Move(temp, path)) {
+		QFile(temp).remove();
+		return false;
+	}
+	_snapshotOffset = header.binlogOffset;
+	return true;
+}
+
 uint64 DatabaseObject::countRelativeTime() const {
 	const auto now = GetUnixtime();
 	const auto delta = std::max(int64(now) - int64(_time.system), 0LL);
@@ -309,8 +566,7 @@ bool DatabaseObject::startDelayedPruning() {
 	}
 	const auto before = pruneBeforeTime();
 	const auto pruning = [&] {
-		if (_settings.totalSizeLimit > 0
-			&& _totalSize > _settings.totalSizeLimit) {
+		if (countSizeExcess(0) > 0) {
 			return true;
 		} else if ((!_minimalEntryTime && !_map.empty())
 			|| _minimalEntryTime <= before) {
@@ -319,10 +575,15 @@ bool DatabaseObject::startDelayedPruning() {
 		return false;
 	}();
 	if (pruning) {
-		if (!_pruneTimer.isActive()
+		const auto wasActive = _pruneTimer.isActive();
+		if (!wasActive
 			|| _pruneTimer.remainingTime() > _settings.pruneTimeout) {
 			_pruneTimer.callOnce(_settings.pruneTimeout);
 		}
+		if (!wasActive && _budget && countSizeExcess(0) > 0) {
+			// Other shards should free their parts of the shared excess.
+			_budget->requestPrune(_shardIndex);
+		}
 		return true;
 	} else if (_minimalEntryTime != 0) {
 		Assert(_minimalEntryTime > before);
@@ -336,6 +597,28 @@ bool DatabaseObject::startDelayedPruning() {
 	return false;
 }
 
+int64 DatabaseObject::countSizeExcess(int64 staleTotalSize) const {
+	if (_settings.totalSizeLimit <= 0) {
+		return 0;
+	} else if (!_budget) {
+		return _totalSize - staleTotalSize - _settings.totalSizeLimit;
+	}
+	const auto total = _budget->totalSize();
+	const auto excess = total - _settings.totalSizeLimit;
+	if (excess <= 0 || total <= 0 || _totalSize <= 0) {
+		return 0;
+	}
+
+	// Each shard frees the part of the excess proportional to its size.
+	const auto part = int64(
+		(static_cast<long double>(excess) * _totalSize) / total) + 1;
+	return std::min(part, _totalSize) - staleTotalSize;
+}
+
+void DatabaseObject::checkSharedBudget() {
+	optimize();
+}
+
 void DatabaseObject::prune() {
 	if (!_stale.empty()) {
 		return;
@@ -436,11 +719,12 @@ void DatabaseObject::collectTimeStale(
 void DatabaseObject::collectSizeStale(
 		base::flat_set<Key> &stale,
 		int64 &staleTotalSize) {
-	const auto removeSize = (_settings.totalSizeLimit > 0)
-		? (_totalSize - staleTotalSize - _settings.totalSizeLimit)
-		: 0;
+	const auto removeSize = countSizeExcess(staleTotalSize);
 	if (removeSize <= 0) {
 		return;
+	} else if (countingFrequency()) {
+		collectSizeStaleByFrequency(stale, staleTotalSize, removeSize);
+		return;
 	}
 
 	using Bucket = std::pair<const Key, Entry>;
@@ -482,6 +766,82 @@ void DatabaseObject::collectSizeStale(
 	staleTotalSize += oldestTotalSize;
 }
 
+void DatabaseObject::collectSizeStaleByFrequency(
+		base::flat_set<Key> &stale,
+		int64 &staleTotalSize,
+		int64 removeSize) {
+	using Bucket = std::pair<const Key, Entry>;
+	auto candidates = std::vector<const Bucket*>();
+	candidates.reserve(_map.size());
+	for (const auto &bucket : _map) {
+		if (!stale.contains(bucket.first)) {
+			candidates.push_back(&bucket);
+		}
+	}
+
+	// The most recently used entries form an admission window, they
+	// are not evicted until they had a chance to gather some accesses.
+	ranges::sort(candidates, std::greater<>(), [](const Bucket *bucket) {
+		return bucket->second.useTime;
+	});
+	const auto windowSizeLimit = (_totalSize * kFrequencyWindowPercent)
+		/ 100;
+	auto windowSize = int64();
+	auto windowEnd = begin(candidates);
+	while (windowEnd != end(candidates)
+		&& windowSize + (*windowEnd)->second.size <= windowSizeLimit) {
+		windowSize += (*windowEnd)->second.size;
+		++windowEnd;
+	}
+
+	// Outside of the window the rarely used entries go first, so that
+	// a lot of values read only once can't push out the popular ones.
+	auto ranked = std::vector<std::pair<
+		std::pair<int, uint64>,
+		const Bucket*>>();
+	ranked.reserve(end(candidates) - windowEnd);
+	for (auto i = windowEnd; i != end(candidates); ++i) {
+		const auto bucket = *i;
+		const auto rank = std::make_pair(
+			_frequency.frequency(bucket->first),
+			bucket->second.useTime);
+		ranked.emplace_back(rank, bucket);
+	}
+	ranges::sort(ranked, std::less<>(), [](const auto &pair) {
+		return pair.first;
+	});
+
+	auto removed = int64();
+	const auto removeBucket = [&](const Bucket *bucket) {
+		stale.emplace(bucket->first);
+		removed += bucket->second.size;
+	};
+	for (const auto &[rank, bucket] : ranked) {
+		if (removed >= removeSize) {
+			break;
+		}
+		removeBucket(bucket);
+	}
+	for (auto i = windowEnd; i != begin(candidates);) {
+		if (removed >= removeSize) {
+			break;
+		}
+		removeBucket(*--i);
+	}
+	staleTotalSize += removed;
+}
+
+bool DatabaseObject::countingFrequency() const {
+	return _settings.evictByFrequency && _settings.trackEstimatedTime;
+}
+
+void DatabaseObject::countAccess(const Key &key) {
+	if (!countingFrequency()) {
+		return;
+	}
+	_frequency.increment(key);
+}
+
 void DatabaseObject::adjustRelativeTime() {
 	if (!_settings.trackEstimatedTime) {
 		return;
@@ -528,6 +888,8 @@ bool DatabaseObject::processRecordStore(
 			not_null<const StoreWithTime*> record) {
 		applyTimePoint(record->time);
 		entry.useTime = record->time.getRelative();
+		entry.rawSize = CompressedRawSize(*record);
+		countAccess(record->key);
 		return true;
 	};
 	return processRecordStoreGeneric(record, postprocess);
@@ -575,12 +937,14 @@ bool DatabaseObject::processRecordMultiAccess(
 		_binlogExcessLength += sizeof(*entry);
 		if (const auto i = _map.find(*entry); i != end(_map)) {
 			i->second.useTime = relative;
+			countAccess(*entry);
 		}
 	}
 	return true;
 }
 
 void DatabaseObject::setMapEntry(const Key &key, Entry &&entry) {
+	forgetPrefetched(key);
 	auto &already = _map[key];
 	updateStats(already, entry);
 	if (already.size != 0) {
@@ -608,6 +972,9 @@ void DatabaseObject::setMapEntry(const Key &key, Entry &&entry) {
 
 void DatabaseObject::updateStats(const Entry &was, const Entry &now) {
 	_totalSize += now.size - was.size;
+	if (_budget) {
+		_budget->add(now.size - was.size);
+	}
 	if (now.tag == was.tag) {
 		if (now.tag) {
 			auto &summary = _taggedStats[now.tag];
@@ -649,6 +1016,7 @@ void DatabaseObject::pushStats() {
 
 void DatabaseObject::eraseMapEntry(const Map::const_iterator &i) {
 	if (i != end(_map)) {
+		forgetPrefetched(i->first);
 		const auto &entry = i->second;
 		updateStats(entry, Entry());
 		if (_minimalEntryTime != 0 && entry.useTime == _minimalEntryTime) {
@@ -704,6 +1072,8 @@ void DatabaseObject::compactorDone(
 		_compactor = CompactorWrap();
 	});
 	_binlog.close();
+	QFile(snapshotPath()).remove();
+	_snapshotOffset = 0;
 	if (!File::Move(ready, binlog)) {
 		compactorFail();
 		return;
@@ -719,6 +1089,12 @@ void DatabaseObject::compactorDone(
 	}
 	_binlogExcessLength -= _compactor.excessLength;
 	Assert(_binlogExcessLength >= 0);
+
+	// The compacted binlog matches _map, so save it as a snapshot.
+	if (_settings.snapshotAfterTail > 0) {
+		writeBundles();
+		writeSnapshot();
+	}
 }
 
 void DatabaseObject::compactorFail() {
@@ -734,6 +1110,7 @@ void DatabaseObject::compactorFail() {
 void DatabaseObject::close(FnMut<void()> &&done) {
 	if (_binlog.isOpen()) {
 		writeBundles();
+		checkSnapshot();
 		_binlog.close();
 	}
 	invokeCallback(done);
@@ -747,12 +1124,25 @@ void DatabaseObject::clearState() {
 	_removing = {};
 	_accessed = {};
 	_stale = {};
+	_frequency.clear();
+	_prefetchQueue = {};
+	_prefetched = {};
+	_prefetchedSize = 0;
+	_prefetching = false;
 	_time = {};
 	_binlogExcessLength = 0;
+	_snapshotOffset = 0;
+	if (_budget) {
+		_budget->add(-_totalSize);
+	}
 	_totalSize = 0;
 	_minimalEntryTime = 0;
 	_entriesWithMinimalTimeCount = 0;
 	_taggedStats = {};
+	_fullUsage = {};
+	_taggedUsage = {};
+	_getLatency = {};
+	_putLatency = {};
 	_pushingStats = false;
 	_writeBundlesTimer.cancel();
 	_pruneTimer.cancel();
@@ -767,16 +1157,24 @@ void DatabaseObject::put(
 		remove(key, std::move(done));
 		return;
 	}
+	const auto started = std::chrono::steady_clock::now();
 	_removing.erase(key);
 	_stale.erase(ranges::remove(_stale, key), end(_stale));
 
+	const auto rawSize = size_type(value.bytes.size());
+	const auto compressed = compressValue(value);
 	const auto checksum = CountChecksum(bytes::make_span(value.bytes));
-	const auto maybepath = writeKeyPlace(key, value, checksum);
+	const auto maybepath = writeKeyPlace(
+		key,
+		value,
+		checksum,
+		compressed ? rawSize : 0);
 	if (!maybepath) {
 		invokeCallback(done, ioError(binlogPath()));
 		return;
 	} else if (maybepath->isEmpty()) {
 		// Nothing changed.
+		recordPut(value.tag, 0, started);
 		invokeCallback(done, Error::NoError());
 		recordEntryAccess(key);
 		return;
@@ -804,6 +1202,7 @@ void DatabaseObject::put(
 			invokeCallback(done, ioError(path));
 		} else {
 			data.flush();
+			recordPut(value.tag, rawSize, started);
 			invokeCallback(done, Error::NoError());
 			optimize();
 		}
@@ -831,6 +1230,7 @@ std::optional<QString> DatabaseObject::writeKeyPlaceGeneric(
 		if (already.tag == record.tag
 			&& already.size == size
 			&& already.checksum == checksum
+			&& already.rawSize == CompressedRawSize(record)
 			&& readValueData(already.place, size) == value.bytes) {
 			return QString();
 		}
@@ -859,11 +1259,14 @@ std::optional<QString> DatabaseObject::writeKeyPlaceGeneric(
 std::optional<QString> DatabaseObject::writeKeyPlace(
 		const Key &key,
 		const TaggedValue &data,
-		uint32 checksum) {
+		uint32 checksum,
+		size_type compressedRawSize) {
 	if (!_settings.trackEstimatedTime) {
+		Assert(!compressedRawSize);
 		return writeKeyPlaceGeneric(Store(), key, data, checksum);
 	}
 	auto record = StoreWithTime();
+	record.setCompressedRawSize(compressedRawSize);
 	record.time = countTimePoint();
 	const auto writing = record.time.getRelative();
 	const auto current = _time.getRelative();
@@ -891,6 +1294,7 @@ Error DatabaseObject::writeExistingPlaceGeneric(
 		if (already.tag == record.tag
 			&& already.size == entry.size
 			&& already.checksum == entry.checksum
+			&& already.rawSize == entry.rawSize
 			&& (readValueData(already.place, already.size)
 				== readValueData(entry.place, entry.size))) {
 			return Error::NoError();
@@ -919,6 +1323,7 @@ Error DatabaseObject::writeExistingPlace(
 		return writeExistingPlaceGeneric(Store(), key, entry);
 	}
 	auto record = StoreWithTime();
+	record.setCompressedRawSize(entry.rawSize);
 	record.time = countTimePoint();
 	const auto writing = record.time.getRelative();
 	const auto current = _time.getRelative();
@@ -935,24 +1340,191 @@ Error DatabaseObject::writeExistingPlace(
 void DatabaseObject::get(
 		const Key &key,
 		FnMut<void(TaggedValue&&)> &&done) {
+	const auto span = Logs::TraceSpan("cache", "get");
+	const auto started = std::chrono::steady_clock::now();
 	const auto i = _map.find(key);
 	if (i == _map.end()) {
+		recordGet(TaggedValue(), 0);
+		recordGetLatency(started);
 		invokeCallback(done, TaggedValue());
 		return;
 	}
-	const auto &entry = i->second;
+	const auto tag = i->second.tag;
+	auto value = readEntryValue(i);
+	const auto found = !value.bytes.isEmpty();
+	recordGet(value, tag);
+	recordGetLatency(started);
+	invokeCallback(done, std::move(value));
+	if (found) {
+		recordEntryAccess(key);
+	}
+}
+
+void DatabaseObject::getMany(
+		const std::vector<Key> &keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done) {
+	const auto started = std::chrono::steady_clock::now();
+	auto result = std::vector<TaggedValue>(keys.size());
+	auto tags = std::vector<uint8>(keys.size(), uint8(0));
 
+	// Read the values ordered by place, so that entries from one
+	// data folder are read one after another.
+	auto order = std::vector<std::pair<PlaceId, size_type>>();
+	order.reserve(keys.size());
+	for (auto index = size_type(), count = size_type(keys.size())
+		; index != count
+		; ++index) {
+		if (const auto i = _map.find(keys[index]); i != end(_map)) {
+			order.emplace_back(i->second.place, index);
+		}
+	}
+	ranges::sort(order);
+
+	for (const auto &[place, index] : order) {
+		if (const auto i = _map.find(keys[index]); i != end(_map)) {
+			tags[index] = i->second.tag;
+			result[index] = readEntryValue(i);
+		}
+	}
+	const auto found = ranges::view::all(
+		order
+	) | ranges::view::filter([&](const auto &pair) {
+		return !result[pair.second].bytes.isEmpty();
+	}) | ranges::view::transform([&](const auto &pair) {
+		return keys[pair.second];
+	}) | ranges::to_vector;
+
+	for (auto index = size_type(), count = size_type(keys.size())
+		; index != count
+		; ++index) {
+		recordGet(result[index], tags[index]);
+	}
+	recordGetLatency(started);
+	invokeCallback(done, std::move(result));
+	for (const auto &key : found) {
+		recordEntryAccess(key);
+	}
+}
+
+TaggedValue DatabaseObject::readEntryValue(const Map::const_iterator &i) {
+	if (auto prefetched = takePrefetched(i->first)) {
+		return std::move(*prefetched);
+	} else if (!_prefetchQueue.empty()) {
+		// The value is requested before we got to prefetch it.
+		_prefetchQueue.erase(
+			ranges::remove(_prefetchQueue, i->first),
+			end(_prefetchQueue));
+	}
+	const auto &entry = i->second;
 	auto bytes = readValueData(entry.place, entry.size);
-	if (bytes.isEmpty()) {
+	if (bytes.isEmpty()
+		|| CountChecksum(bytes::make_span(bytes)) != entry.checksum) {
+		const auto key = i->first;
 		remove(key, nullptr);
-		invokeCallback(done, TaggedValue());
-	} else if (CountChecksum(bytes::make_span(bytes)) != entry.checksum) {
-		remove(key, nullptr);
-		invokeCallback(done, TaggedValue());
-	} else {
-		invokeCallback(done, TaggedValue(std::move(bytes), entry.tag));
-		recordEntryAccess(key);
+		return TaggedValue();
+	} else if (entry.rawSize) {
+		bytes = Decompress(bytes, _settings.maxDataSize);
+		if (bytes.isEmpty()) {
+			const auto key = i->first;
+			remove(key, nullptr);
+			return TaggedValue();
+		}
 	}
+	return TaggedValue(std::move(bytes), entry.tag);
+}
+
+void DatabaseObject::prefetch(const std::vector<Key> &keys) {
+	if (!_settings.prefetchedSizeLimit) {
+		return;
+	}
+	const auto queued = [&](const Key &key) {
+		return (ranges::find(_prefetchQueue, key) != end(_prefetchQueue))
+			|| (ranges::find(
+				_prefetched,
+				key,
+				&std::pair<Key, TaggedValue>::first) != end(_prefetched));
+	};
+	for (const auto &key : keys) {
+		if (_map.find(key) != end(_map) && !queued(key)) {
+			_prefetchQueue.push_back(key);
+		}
+	}
+	prefetchNextDelayed();
+}
+
+void DatabaseObject::prefetchNextDelayed() {
+	if (_prefetching || _prefetchQueue.empty()) {
+		return;
+	}
+	_prefetching = true;
+
+	// Read one value at a time, so that the real requests that were
+	// queued after the prefetch hint don't wait for all of it.
+	_weak.with([](DatabaseObject &that) {
+		if (base::take(that._prefetching)) {
+			that.prefetchNext();
+		}
+	});
+}
+
+void DatabaseObject::prefetchNext() {
+	if (_prefetchQueue.empty()) {
+		return;
+	}
+	const auto key = _prefetchQueue.front();
+	_prefetchQueue.erase(begin(_prefetchQueue));
+	prefetchNextDelayed();
+
+	const auto i = _map.find(key);
+	if (i == end(_map)) {
+		return;
+	}
+	auto value = readEntryValue(i);
+	if (value.bytes.isEmpty()
+		|| value.bytes.size() > _settings.prefetchedSizeLimit) {
+		return;
+	}
+	_prefetchedSize += value.bytes.size();
+	_prefetched.emplace_back(key, std::move(value));
+	while (_prefetchedSize > _settings.prefetchedSizeLimit) {
+		_prefetchedSize -= _prefetched.front().second.bytes.size();
+		_prefetched.erase(begin(_prefetched));
+	}
+}
+
+std::optional<TaggedValue> DatabaseObject::takePrefetched(const Key &key) {
+	const auto i = ranges::find(
+		_prefetched,
+		key,
+		&std::pair<Key, TaggedValue>::first);
+	if (i == end(_prefetched)) {
+		return std::nullopt;
+	}
+	auto result = std::move(i->second);
+	_prefetchedSize -= result.bytes.size();
+	_prefetched.erase(i);
+	return result;
+}
+
+void DatabaseObject::forgetPrefetched(const Key &key) {
+	if (!_prefetched.empty()) {
+		takePrefetched(key);
+	}
+}
+
+bool DatabaseObject::compressValue(TaggedValue &value) const {
+	if (!_settings.trackEstimatedTime
+		|| _format != Format::Format_1
+		|| value.bytes.size() < _settings.compressMinSize
+		|| !_settings.compressedTags.contains(value.tag)) {
+		return false;
+	}
+	auto compressed = Compress(value.bytes);
+	if (compressed.isEmpty()) {
+		return false;
+	}
+	value.bytes = std::move(compressed);
+	return true;
 }
 
 void DatabaseObject::getWithSizes(
@@ -965,15 +1537,22 @@ void DatabaseObject::getWithSizes(
 			return;
 		}
 
-		auto sizes = keys | ranges::view::transform([&](const Key &sizeKey) {
-			const auto i = _map.find(sizeKey);
-			return (i != end(_map)) ? int(i->second.size) : 0;
-		}) | ranges::to_vector;
-
-		invokeCallback(done, std::move(value.bytes), std::move(sizes));
+		invokeCallback(done, std::move(value.bytes), getSizes(keys));
 	});
 }
 
+std::vector<int> DatabaseObject::getSizes(
+		const std::vector<Key> &keys) const {
+	return keys | ranges::view::transform([&](const Key &sizeKey) {
+		const auto i = _map.find(sizeKey);
+		if (i == end(_map)) {
+			return 0;
+		}
+		const auto &entry = i->second;
+		return int(entry.rawSize ? entry.rawSize : entry.size);
+	}) | ranges::to_vector;
+}
+
 QByteArray DatabaseObject::readValueData(
 		PlaceId place,
 		size_type size) const {
@@ -986,7 +1565,11 @@ QByteArray DatabaseObject::readValueData(
 	case File::Result::Success: {
 		auto result = QByteArray(size, Qt::Uninitialized);
 		const auto bytes = bytes::make_detached_span(result);
-		const auto read = data.readWithPadding(bytes);
+		const auto mapped = (_settings.mappedReadMinSize > 0)
+			&& (size >= _settings.mappedReadMinSize);
+		const auto read = mapped
+			? data.readWithPaddingMapped(bytes)
+			: data.readWithPadding(bytes);
 		if (read != size) {
 			return QByteArray();
 		}
@@ -996,6 +1579,48 @@ QByteArray DatabaseObject::readValueData(
 	Unexpected("Result in DatabaseObject::get.");
 }
 
+// The tag of a missing key is unknown, so such misses are counted only
+// in the full usage and per tag only the entries that failed to read.
+void DatabaseObject::recordGet(const TaggedValue &value, uint8 tag) {
+	const auto record = [&](TaggedUsage &usage) {
+		if (value.bytes.isEmpty()) {
+			++usage.misses;
+		} else {
+			++usage.hits;
+			usage.bytesRead += int64(value.bytes.size());
+		}
+	};
+	record(_fullUsage);
+	if (tag) {
+		record(_taggedUsage[tag]);
+	}
+}
+
+void DatabaseObject::recordGetLatency(
+		std::chrono::steady_clock::time_point started) {
+	_getLatency.add(MicrosecondsSince(started));
+	if (_stats.has_consumers()) {
+		pushStatsDelayed();
+	}
+}
+
+void DatabaseObject::recordPut(
+		uint8 tag,
+		int64 size,
+		std::chrono::steady_clock::time_point started) {
+	++_fullUsage.puts;
+	_fullUsage.bytesWritten += size;
+	if (tag) {
+		auto &usage = _taggedUsage[tag];
+		++usage.puts;
+		usage.bytesWritten += size;
+	}
+	_putLatency.add(MicrosecondsSince(started));
+	if (_stats.has_consumers()) {
+		pushStatsDelayed();
+	}
+}
+
 void DatabaseObject::recordEntryAccess(const Key &key) {
 	if (!_settings.trackEstimatedTime) {
 		return;
@@ -1023,6 +1648,10 @@ void DatabaseObject::remove(const Key &key, FnMut<void(Error)> &&done) {
 	}
 }
 
+bool DatabaseObject::contains(const Key &key) const {
+	return (_map.find(key) != end(_map));
+}
+
 void DatabaseObject::putIfEmpty(
 		const Key &key,
 		TaggedValue &&value,
@@ -1084,6 +1713,10 @@ Stats DatabaseObject::collectStats() const {
 	result.tagged = _taggedStats;
 	result.full.count = _map.size();
 	result.full.totalSize = _totalSize;
+	result.fullUsage = _fullUsage;
+	result.taggedUsage = _taggedUsage;
+	result.getLatency = _getLatency;
+	result.putLatency = _putLatency;
 	result.clearing = (_cleaner.object != nullptr) || !_stale.empty();
 	return result;
 }
@@ -1159,6 +1792,7 @@ Error DatabaseObject::writeMultiAccessBlock() {
 	for (const auto &entry : list) {
 		if (const auto i = _map.find(entry); i != end(_map)) {
 			i->second.useTime = _time.getRelative();
+			countAccess(entry);
 		}
 	}
 
@@ -8,12 +8,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "storage/cache/storage_cache_database.h"
+#include "storage/cache/storage_cache_frequency_sketch.h"
 #include "storage/storage_encrypted_file.h"
 #include "base/binary_guard.h"
 #include "base/concurrent_timer.h"
 #include "base/bytes.h"
 #include "base/flat_set.h"
 #include <set>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 #include <rpl/event_stream.h>
 
 namespace Storage {
@@ -22,6 +26,26 @@ namespace details {
 
 class Cleaner;
 class Compactor;
+class DatabaseObject;
+
+class SharedBudget {
+public:
+	explicit SharedBudget(size_type shardsCount);
+
+	void registerShard(
+		size_type index,
+		crl::weak_on_queue<DatabaseObject> weak);
+	void add(int64 delta);
+	[[nodiscard]] int64 totalSize() const;
+
+	void requestPrune(size_type initiator);
+
+private:
+	std::atomic<int64> _totalSize = 0;
+	std::mutex _mutex;
+	std::vector<crl::weak_on_queue<DatabaseObject>> _shards;
+
+};
 
 class DatabaseObject {
 public:
@@ -29,7 +53,9 @@ public:
 	DatabaseObject(
 		crl::weak_on_queue<DatabaseObject> weak,
 		const QString &path,
-		const Settings &settings);
+		const Settings &settings,
+		std::shared_ptr<SharedBudget> budget = nullptr,
+		size_type shardIndex = 0);
 	void reconfigure(const Settings &settings);
 	void updateSettings(const SettingsUpdate &update);
 
@@ -41,7 +67,12 @@ public:
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done);
 	void get(const Key &key, FnMut<void(TaggedValue&&)> &&done);
+	void getMany(
+		const std::vector<Key> &keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done);
+	void prefetch(const std::vector<Key> &keys);
 	void remove(const Key &key, FnMut<void(Error)> &&done);
+	[[nodiscard]] bool contains(const Key &key) const;
 
 	void putIfEmpty(
 		const Key &key,
@@ -60,6 +91,8 @@ public:
 		const Key &key,
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done);
+	[[nodiscard]] std::vector<int> getSizes(
+		const std::vector<Key> &keys) const;
 
 	rpl::producer<Stats> stats() const;
 
@@ -69,10 +102,13 @@ public:
 
 	static QString BinlogFilename();
 	static QString CompactReadyFilename();
+	static QString SnapshotFilename();
 
 	void compactorDone(const QString &path, int64 originalReadTill);
 	void compactorFail();
 
+	void checkSharedBudget();
+
 	struct Entry {
 		Entry() = default;
 		Entry(
@@ -80,13 +116,15 @@ public:
 			uint8 tag,
 			uint32 checksum,
 			size_type size,
-			uint64 useTime);
+			uint64 useTime,
+			size_type rawSize = 0);
 
 		uint64 useTime = 0;
 		size_type size = 0;
 		uint32 checksum = 0;
 		PlaceId place = { { 0 } };
 		uint8 tag = 0;
+		size_type rawSize = 0; // Non-zero only for compressed values.
 	};
 	using Raw = std::pair<Key, Entry>;
 	std::vector<Raw> getManyRaw(const std::vector<Key> &keys) const;
@@ -119,6 +157,8 @@ private:
 	QString binlogPath() const;
 	QString compactReadyPath(Version version) const;
 	QString compactReadyPath() const;
+	QString snapshotPath(Version version) const;
+	QString snapshotPath() const;
 	Error openSomeBinlog(EncryptionKey &&key);
 	Error openNewBinlog(EncryptionKey &key);
 	File::Result openBinlog(
@@ -129,6 +169,9 @@ private:
 	bool writeHeader();
 
 	void readBinlog();
+	bool readSnapshot();
+	void checkSnapshot();
+	bool writeSnapshot();
 	template <typename Reader, typename ...Handlers>
 	void readBinlogHelper(Reader &reader, Handlers &&...handlers);
 	template <typename Record, typename Postprocess>
@@ -161,6 +204,7 @@ private:
 	void applyTimePoint(EstimatedTimePoint time);
 
 	uint64 pruneBeforeTime() const;
+	int64 countSizeExcess(int64 staleTotalSize) const;
 	void prune();
 	void collectTimeStale(
 		base::flat_set<Key> &stale,
@@ -168,6 +212,12 @@ private:
 	void collectSizeStale(
 		base::flat_set<Key> &stale,
 		int64 &staleTotalSize);
+	void collectSizeStaleByFrequency(
+		base::flat_set<Key> &stale,
+		int64 &staleTotalSize,
+		int64 removeSize);
+	[[nodiscard]] bool countingFrequency() const;
+	void countAccess(const Key &key);
 	void startStaleClear();
 	void clearStaleNow(const base::flat_set<Key> &stale);
 	void clearStaleChunkDelayed();
@@ -181,6 +231,17 @@ private:
 	void setMapEntry(const Key &key, Entry &&entry);
 	void eraseMapEntry(const Map::const_iterator &i);
 	void recordEntryAccess(const Key &key);
+	void recordGet(const TaggedValue &value, uint8 tag);
+	void recordGetLatency(std::chrono::steady_clock::time_point started);
+	void recordPut(
+		uint8 tag,
+		int64 size,
+		std::chrono::steady_clock::time_point started);
+	TaggedValue readEntryValue(const Map::const_iterator &i);
+	std::optional<TaggedValue> takePrefetched(const Key &key);
+	void forgetPrefetched(const Key &key);
+	void prefetchNextDelayed();
+	void prefetchNext();
 	QByteArray readValueData(PlaceId place, size_type size) const;
 
 	Version findAvailableVersion() const;
@@ -200,7 +261,9 @@ private:
 	std::optional<QString> writeKeyPlace(
 		const Key &key,
 		const TaggedValue &value,
-		uint32 checksum);
+		uint32 checksum,
+		size_type compressedRawSize);
+	bool compressValue(TaggedValue &value) const;
 	template <typename StoreRecord>
 	Error writeExistingPlaceGeneric(
 		StoreRecord &&record,
@@ -224,21 +287,34 @@ private:
 	crl::weak_on_queue<DatabaseObject> _weak;
 	QString _base, _path;
 	Settings _settings;
+	const std::shared_ptr<SharedBudget> _budget;
+	const size_type _shardIndex = 0;
 	EncryptionKey _key;
 	File _binlog;
 	Map _map;
 	std::set<Key> _removing;
 	std::set<Key> _accessed;
 	std::vector<Key> _stale;
+	FrequencySketch _frequency;
+	std::vector<Key> _prefetchQueue;
+	std::vector<std::pair<Key, TaggedValue>> _prefetched;
+	int64 _prefetchedSize = 0;
+	bool _prefetching = false;
 
 	EstimatedTimePoint _time;
+	Format _format = Format::Format_0;
 
 	int64 _binlogExcessLength = 0;
+	int64 _snapshotOffset = 0;
 	int64 _totalSize = 0;
 	uint64 _minimalEntryTime = 0;
 	size_type _entriesWithMinimalTimeCount = 0;
 
 	base::flat_map<uint8, TaggedSummary> _taggedStats;
+	TaggedUsage _fullUsage;
+	base::flat_map<uint8, TaggedUsage> _taggedUsage;
+	LatencyHistogram _getLatency;
+	LatencyHistogram _putLatency;
 	rpl::event_stream<Stats> _stats;
 	bool _pushingStats = false;
 	bool _clearingStale = false;
@@ -59,6 +59,35 @@ QString GetBinlogPath() {
 	return name + '/' + QString::number(version) + "/binlog";
 }
 
+QString GetSnapshotPath() {
+	const auto binlog = GetBinlogPath();
+	return binlog.isEmpty() ? QString() : (binlog + "-snapshot");
+}
+
+details::SnapshotHeader ReadSnapshotHeader() {
+	auto result = details::SnapshotHeader();
+	Storage::File snapshot;
+	const auto opened = snapshot.open(
+		GetSnapshotPath(),
+		Storage::File::Mode::Read,
+		key);
+	REQUIRE(opened == Storage::File::Result::Success);
+	REQUIRE(snapshot.read(bytes::object_as_span(&result))
+		== sizeof(result));
+	return result;
+}
+
+void WriteSnapshotHeader(details::SnapshotHeader header) {
+	Storage::File snapshot;
+	const auto opened = snapshot.open(
+		GetSnapshotPath(),
+		Storage::File::Mode::Write,
+		key);
+	REQUIRE(opened == Storage::File::Result::Success);
+	REQUIRE(snapshot.write(bytes::object_as_span(&header)));
+	REQUIRE(snapshot.flush());
+}
+
 const auto Test1 = [] {
 	static auto result = QByteArray("testbytetestbyt");
 	return result;
@@ -302,6 +331,50 @@ TEST_CASE("compacting db", "[storage_cache_database]") {
 		fullcheck();
 		Close(db);
 	}
+	SECTION("interrupted compact resumed") {
+		auto settings = Settings;
+		settings.writeBundleDelay = crl::time(100);
+		settings.readBlockSize = 512;
+		settings.maxBundledRecords = 5;
+		settings.compactChunkSize = 4;
+		settings.compactAfterExcess = 3 * (16 * 5 + 16) + 15 * 32;
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		put(db, 0, 30);
+		remove(db, 0, 15);
+		reput(db, 15, 29);
+		AdvanceTime(1);
+		const auto path = GetBinlogPath();
+		const auto progress = path + "-temp-progress";
+		const auto size = QFile(path).size();
+		reput(db, 29, 30); // starts compactor
+
+		// Interrupt it after some chunks are written, if we're in time.
+		for (auto i = 0; i != 1000 && !QFile(progress).exists(); ++i) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		put(db, 30, 31); // starts compactor, resuming from the progress
+		AdvanceTime(2);
+		REQUIRE(QFile(path).size() < size);
+		REQUIRE(!QFile(progress).exists());
+
+		const auto fullcheck = [&] {
+			check(db, 0, 15, {});
+			check(db, 15, 30, Test2());
+			check(db, 30, 31, Test1());
+		};
+		fullcheck();
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		fullcheck();
+		Close(db);
+	}
 	SECTION("double compact") {
 		auto settings = Settings;
 		settings.writeBundleDelay = crl::time(100);
@@ -512,6 +585,65 @@ TEST_CASE("encrypted cache db", "[storage_cache_database]") {
 	}
 }
 
+TEST_CASE("compressed cache db", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.trackEstimatedTime = true;
+	settings.maxDataSize = 4096;
+	settings.compressedTags = { 1 };
+	const auto compressible = QByteArray(2048, 'a');
+	const auto random = [] {
+		auto result = QByteArray(2048, Qt::Uninitialized);
+		bytes::set_random(bytes::make_detached_span(result));
+		return result;
+	}();
+
+	SECTION("writing compressed db") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		const auto first = Put(
+			db,
+			Key{ 0, 1 },
+			Database::TaggedValue(QByteArray(compressible), 1));
+		REQUIRE(first.type == Error::Type::None);
+		const auto second = Put(
+			db,
+			Key{ 0, 2 },
+			Database::TaggedValue(QByteArray(random), 1));
+		REQUIRE(second.type == Error::Type::None);
+		const auto third = Put(
+			db,
+			Key{ 0, 3 },
+			Database::TaggedValue(QByteArray(compressible), 2));
+		REQUIRE(third.type == Error::Type::None);
+		const auto withTag = GetWithTag(db, Key{ 0, 1 });
+		REQUIRE(((withTag.bytes == compressible) && (withTag.tag == 1)));
+		Close(db);
+	}
+	SECTION("reading compressed db") {
+		Database db(name, settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == compressible));
+		REQUIRE((Get(db, Key{ 0, 2 }) == random));
+		REQUIRE((Get(db, Key{ 0, 3 }) == compressible));
+		Close(db);
+	}
+	SECTION("reading compressed db without compression") {
+		auto plain = settings;
+		plain.compressedTags = {};
+		Database db(name, plain);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == compressible));
+		Close(db);
+	}
+}
+
 TEST_CASE("cache db remove", "[storage_cache_database]") {
 	if (!DisableLargeTest) {
 		return;
@@ -538,6 +670,35 @@ TEST_CASE("cache db remove", "[storage_cache_database]") {
 	}
 }
 
+TEST_CASE("cache db prefetch", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	SECTION("db prefetch returns stored value") {
+		Database db(name, Settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		db.prefetch({ Key{ 0, 1 }, Key{ 1, 0 } });
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE(Get(db, Key{ 1, 0 }).isEmpty());
+		Close(db);
+	}
+	SECTION("db prefetch forgets overwritten value") {
+		Database db(name, Settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		db.prefetch({ Key{ 0, 1 } });
+		REQUIRE(Put(db, Key{ 0, 1 }, Test2()).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test2()));
+		db.prefetch({ Key{ 0, 1 } });
+		Remove(db, Key{ 0, 1 });
+		REQUIRE(Get(db, Key{ 0, 1 }).isEmpty());
+		Close(db);
+	}
+}
+
 TEST_CASE("cache db bundled actions", "[storage_cache_database]") {
 	if (!DisableLargeTest) {
 		return;
@@ -672,6 +833,35 @@ TEST_CASE("cache db limits", "[storage_cache_database]") {
 		REQUIRE((Get(db, Key{ 2, 2 }) == Test2()));
 		Close(db);
 	}
+	SECTION("db frequency size limit") {
+		auto settings = Settings;
+		settings.trackEstimatedTime = true;
+		settings.evictByFrequency = true;
+		settings.totalSizeLimit = 17 * 3 + 1;
+		Database db(name, settings);
+
+		db.clear(nullptr);
+		db.open(base::duplicate(key), nullptr);
+		db.put(Key{ 0, 1 }, Test1(), nullptr);
+		db.get(Key{ 0, 1 }, nullptr);
+		AdvanceTime(2);
+		db.get(Key{ 0, 1 }, nullptr);
+		AdvanceTime(2);
+		db.put(Key{ 1, 0 }, Test2(), nullptr);
+		AdvanceTime(2);
+		db.put(Key{ 1, 1 }, Test1(), nullptr);
+		AdvanceTime(2);
+		db.put(Key{ 2, 0 }, Test2(), nullptr);
+		AdvanceTime(2);
+
+		// The least recently used { 0, 1 } is kept, because it is used
+		// more often than { 1, 0 }, that was written and never read.
+		REQUIRE(Get(db, Key{ 1, 0 }).isEmpty());
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE((Get(db, Key{ 1, 1 }) == Test1()));
+		REQUIRE((Get(db, Key{ 2, 0 }) == Test2()));
+		Close(db);
+	}
 	SECTION("db time limit") {
 		auto settings = Settings;
 		settings.trackEstimatedTime = true;
@@ -702,6 +892,231 @@ TEST_CASE("cache db limits", "[storage_cache_database]") {
 	}
 }
 
+TEST_CASE("cache db snapshot", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.snapshotAfterTail = 1;
+	auto lazy = Settings;
+	lazy.snapshotAfterTail = 1024 * 1024 * 1024;
+
+	const auto put = [](Database &db, uint32 from, uint32 till) {
+		for (auto i = from; i != till; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			const auto result = Put(db, Key{ i, i + 1 }, std::move(value));
+			REQUIRE(result.type == Error::Type::None);
+		}
+	};
+	const auto check = [](Database &db, uint32 from, uint32 till) {
+		for (auto i = from; i != till; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			REQUIRE((Get(db, Key{ i, i + 1 }) == value));
+		}
+	};
+	const auto write = [&] {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		put(db, 0, 10);
+		Close(db);
+		REQUIRE(QFile(GetSnapshotPath()).exists());
+	};
+	SECTION("db snapshot with binlog tail") {
+		write();
+		{
+			Database db(name, lazy);
+
+			REQUIRE(Open(db, key).type == Error::Type::None);
+			check(db, 0, 10);
+			put(db, 10, 15);
+			Remove(db, Key{ 0, 1 });
+			Close(db);
+		}
+		Database db(name, lazy);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Get(db, Key{ 0, 1 }).isEmpty());
+		check(db, 1, 15);
+		Close(db);
+	}
+	SECTION("db snapshot replaces binlog replay") {
+		write();
+
+		// An empty snapshot at the binlog end means an empty map.
+		auto header = ReadSnapshotHeader();
+		REQUIRE(header.count == 10);
+		header.count = 0;
+		WriteSnapshotHeader(header);
+
+		Database db(name, lazy);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Get(db, Key{ 1, 2 }).isEmpty());
+		Close(db);
+	}
+	SECTION("db snapshot of other format ignored") {
+		write();
+
+		auto header = ReadSnapshotHeader();
+		header.format = 1;
+		header.count = 0;
+		WriteSnapshotHeader(header);
+
+		Database db(name, lazy);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		check(db, 0, 10);
+		Close(db);
+	}
+	SECTION("db truncated snapshot ignored") {
+		write();
+
+		QFile file(GetSnapshotPath());
+		REQUIRE(file.resize(file.size() - 16));
+
+		Database db(name, lazy);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		check(db, 0, 10);
+		Close(db);
+	}
+	SECTION("db garbage snapshot ignored") {
+		write();
+
+		QFile file(GetSnapshotPath());
+		REQUIRE(file.open(QIODevice::WriteOnly));
+		file.write(QByteArray(256, 'x'));
+		file.close();
+
+		Database db(name, lazy);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		check(db, 0, 10);
+		Close(db);
+	}
+}
+
+TEST_CASE("sharded cache db", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.shardsCount = 4;
+	SECTION("writing sharded db") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		for (auto i = 0U; i != 16; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			const auto result = Put(
+				db,
+				Key{ i, uint64(i) << 16 },
+				std::move(value));
+			REQUIRE(result.type == Error::Type::None);
+		}
+		// Key{ 0, 0 } and Key{ 1, 1 << 16 } live in different shards.
+		REQUIRE(MoveIfEmpty(db, Key{ 0, 0 }, Key{ 1, 1ULL << 16 }).type
+			== Error::Type::None);
+		auto first = Test1();
+		first[0] = 'A';
+		auto second = Test1();
+		second[0] = 'B';
+		REQUIRE((Get(db, Key{ 0, 0 }) == first));
+		REQUIRE((Get(db, Key{ 1, 1ULL << 16 }) == second));
+		REQUIRE(MoveIfEmpty(db, Key{ 0, 0 }, Key{ 5, 1 }).type
+			== Error::Type::None);
+		Close(db);
+	}
+	SECTION("reading sharded db") {
+		Database db(name, settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Get(db, Key{ 0, 0 }).isEmpty());
+		auto moved = Test1();
+		moved[0] = 'A';
+		REQUIRE((Get(db, Key{ 5, 1 }) == moved));
+		for (auto i = 1U; i != 16; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			REQUIRE((Get(db, Key{ i, uint64(i) << 16 }) == value));
+		}
+		Close(db);
+	}
+	SECTION("sharded db sizes of slices") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+
+		// The last slices carry into the next 'low >> 16' value.
+		const auto base = Key{ 7, 0xFFFEULL };
+		const auto slice = [&](uint64 index) {
+			return Key{ base.high, base.low + index };
+		};
+		REQUIRE(Put(db, base, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, slice(1), Test2()).type == Error::Type::None);
+		REQUIRE(Put(db, slice(3), Test1()).type == Error::Type::None);
+		auto sizes = std::vector<int>();
+		db.getWithSizes(base, { slice(1), slice(2), slice(3) }, [&](
+				QByteArray &&value,
+				std::vector<int> &&result) {
+			Value = std::move(value);
+			sizes = std::move(result);
+			Semaphore.release();
+		});
+		Semaphore.acquire();
+		REQUIRE((Value == Test1()));
+		REQUIRE((sizes == std::vector<int>{
+			Test2().size(),
+			0,
+			Test1().size() }));
+		Close(db);
+	}
+	SECTION("sharded db move with following writes") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 0 }, Test1()).type == Error::Type::None);
+
+		// The put must not be removed by the move requested before it.
+		db.moveIfEmpty(Key{ 0, 0 }, Key{ 1, 1ULL << 16 }, nullptr);
+		db.put(Key{ 0, 0 }, Test2(), nullptr);
+		REQUIRE((Get(db, Key{ 0, 0 }) == Test2()));
+		REQUIRE((Get(db, Key{ 1, 1ULL << 16 }) == Test1()));
+		Close(db);
+	}
+	SECTION("sharded db shared size limit") {
+		settings.trackEstimatedTime = true;
+		settings.totalSizeLimit = 17 * 3 + 1;
+		Database db(name, settings);
+
+		db.clear(nullptr);
+		db.open(base::duplicate(key), nullptr);
+		db.put(Key{ 0, 1 }, Test2(), nullptr);
+		db.put(Key{ 1, 0 }, Test2(), nullptr);
+		db.put(Key{ 2, 0 }, Test2(), nullptr);
+		AdvanceTime(2);
+		db.put(Key{ 3, 0 }, Test2(), nullptr);
+		db.put(Key{ 4, 0 }, Test2(), nullptr);
+		AdvanceTime(3);
+		auto left = 0;
+		for (auto i = 0U; i != 5; ++i) {
+			if (!Get(db, Key{ i, (i ? 0U : 1U) }).isEmpty()) {
+				++left;
+			}
+		}
+		REQUIRE(left <= 3);
+		Close(db);
+	}
+}
+
 TEST_CASE("large db", "[storage_cache_database]") {
 	if (DisableLargeTest) {
 		return;
@@ -0,0 +1,104 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/cache/storage_cache_frequency_sketch.h"
+
+namespace Storage {
+namespace Cache {
+namespace details {
+namespace {
+
+constexpr auto kMinimalWidth = size_type(1024);
+constexpr auto kMaximalWidth = size_type(1 << 20);
+constexpr auto kResetAfterAdditionsPerCounter = 10;
+
+constexpr auto kSeeds = std::array<uint64, 4>{ {
+	0xC3A5C85C97CB3127ULL,
+	0xB492B66FBE98F273ULL,
+	0x9AE16A3B2F90404FULL,
+	0xCBF29CE484222325ULL,
+} };
+
+uint64 Mix(uint64 value) {
+	value ^= (value >> 33);
+	value *= 0xFF51AFD7ED558CCDULL;
+	value ^= (value >> 33);
+	value *= 0xC4CEB9FE1A85EC53ULL;
+	value ^= (value >> 33);
+	return value;
+}
+
+uint64 Hash(const Key &key) {
+	return Mix(key.high ^ Mix(key.low));
+}
+
+} // namespace
+
+void FrequencySketch::resize(size_type capacity) {
+	auto width = kMinimalWidth;
+	while (width < capacity && width < kMaximalWidth) {
+		width <<= 1;
+	}
+	if (width == _width) {
+		return;
+	}
+	_width = width;
+	_counters = std::vector<uint8>(_width * kDepth, uint8(0));
+	_additions = 0;
+}
+
+size_type FrequencySketch::index(uint64 hash, int row) const {
+	const auto column = size_type(Mix(hash + kSeeds[row]) & (_width - 1));
+	return (row * _width) + column;
+}
+
+void FrequencySketch::increment(const Key &key) {
+	Expects(_width > 0);
+
+	const auto hash = Hash(key);
+	auto incremented = false;
+	for (auto row = 0; row != kDepth; ++row) {
+		auto &counter = _counters[index(hash, row)];
+		if (counter < kMaxFrequency) {
+			++counter;
+			incremented = true;
+		}
+	}
+	if (incremented
+		&& ++_additions >= _width * kResetAfterAdditionsPerCounter) {
+		reset();
+	}
+}
+
+int FrequencySketch::frequency(const Key &key) const {
+	if (!_width) {
+		return 0;
+	}
+	const auto hash = Hash(key);
+	auto result = int(kMaxFrequency);
+	for (auto row = 0; row != kDepth; ++row) {
+		accumulate_min(result, int(_counters[index(hash, row)]));
+	}
+	return result;
+}
+
+void FrequencySketch::reset() {
+	for (auto &counter : _counters) {
+		counter >>= 1;
+	}
+	_additions /= 2;
+}
+
+void FrequencySketch::clear() {
+	_counters = std::vector<uint8>();
+	_width = 0;
+	_additions = 0;
+}
+
+} // namespace details
+} // namespace Cache
+} // namespace Storage
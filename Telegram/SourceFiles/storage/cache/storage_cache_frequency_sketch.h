@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/cache/storage_cache_types.h"
+
+namespace Storage {
+namespace Cache {
+namespace details {
+
+// Count-min sketch of key access frequencies with small saturating
+// counters, all of them are halved periodically so that old popularity
+// fades away (the TinyLFU "reset" operation).
+class FrequencySketch {
+public:
+	static constexpr auto kMaxFrequency = 15;
+
+	// Counters can't be rehashed, so the sketch is sized once for the
+	// expected entries count before the statistics are collected.
+	void resize(size_type capacity);
+	void increment(const Key &key);
+	[[nodiscard]] int frequency(const Key &key) const;
+	void clear();
+
+private:
+	static constexpr auto kDepth = 4;
+
+	[[nodiscard]] size_type index(uint64 hash, int row) const;
+	void reset();
+
+	std::vector<uint8> _counters;
+	size_type _width = 0;
+	size_type _additions = 0;
+
+};
+
+} // namespace details
+} // namespace Cache
+} // namespace Storage
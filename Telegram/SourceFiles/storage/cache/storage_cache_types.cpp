@@ -48,6 +48,51 @@ TaggedValue::TaggedValue(QByteArray &&bytes, uint8 tag)
 : bytes(std::move(bytes)), tag(tag) {
 }
 
+void TaggedUsage::merge(const TaggedUsage &other) {
+	hits += other.hits;
+	misses += other.misses;
+	puts += other.puts;
+	bytesRead += other.bytesRead;
+	bytesWritten += other.bytesWritten;
+}
+
+void LatencyHistogram::add(int64 microseconds) {
+	auto index = 0;
+	while (index + 1 < kBucketsCount
+		&& (int64(1) << index) <= microseconds) {
+		++index;
+	}
+	++buckets[index];
+}
+
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		buckets[i] += other.buckets[i];
+	}
+}
+
+int64 LatencyHistogram::count() const {
+	return ranges::accumulate(buckets, int64(0));
+}
+
+int64 LatencyHistogram::percentile(int percent) const {
+	Expects(percent >= 0 && percent <= 100);
+
+	const auto total = count();
+	if (!total) {
+		return 0;
+	}
+	const auto limit = (total * percent + 99) / 100;
+	auto accumulated = int64(0);
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		accumulated += buckets[i];
+		if (accumulated >= limit) {
+			return (int64(1) << i);
+		}
+	}
+	return (int64(1) << (kBucketsCount - 1));
+}
+
 QString ComputeBasePath(const QString &original) {
 	const auto result = QDir(original).absolutePath();
 	return result.endsWith('/') ? result : (result + '/');
@@ -100,6 +145,18 @@ size_type Store::getSize() const {
 	return ReadFrom(size);
 }
 
+void StoreWithTime::setCompressedRawSize(size_type rawSize) {
+	Expects(rawSize >= 0 && rawSize < kDataSizeLimit);
+
+	flags = rawSize
+		? (kCompressed | (uint32(rawSize) << kRawSizeShift))
+		: 0U;
+}
+
+size_type StoreWithTime::getCompressedRawSize() const {
+	return (flags & kCompressed) ? size_type(flags >> kRawSizeShift) : 0;
+}
+
 MultiStore::MultiStore(size_type count)
 : type(kType)
 , count(ReadTo<RecordsCount>(count)) {
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/basic_types.h"
 #include "base/flat_map.h"
+#include "base/flat_set.h"
 #include "base/optional.h"
 #include <crl/crl_time.h>
 #include <QtCore/QString>
@@ -68,6 +69,8 @@ struct Settings {
 	size_type maxBundledRecords = 16 * 1024;
 	size_type readBlockSize = 8 * 1024 * 1024;
 	size_type maxDataSize = (kDataSizeLimit - 1);
+	size_type mappedReadMinSize = 64 * 1024; // Zero disables mapped reads.
+	size_type prefetchedSizeLimit = 4 * 1024 * 1024; // Zero disables.
 	crl::time writeBundleDelay = 15 * 60 * crl::time(1000);
 	size_type staleRemoveChunk = 256;
 
@@ -75,13 +78,30 @@ struct Settings {
 	int64 compactAfterFullSize = 0;
 	size_type compactChunkSize = 16 * 1024;
 
+	int64 snapshotAfterTail = 4 * 1024 * 1024; // Zero disables snapshots.
+
 	bool trackEstimatedTime = true;
 	int64 totalSizeLimit = 1024 * 1024 * 1024;
 	size_type totalTimeLimit = 31 * 24 * 60 * 60; // One month in seconds.
 	crl::time pruneTimeout = 5 * crl::time(1000);
 	crl::time maxPruneCheckTimeout = 3600 * crl::time(1000);
 
+	// When the size limit is exceeded evict the least frequently used
+	// entries instead of the least recently used ones. Frequencies are
+	// counted from the access records, so trackEstimatedTime is required.
+	bool evictByFrequency = false;
+
 	bool clearOnWrongKey = false;
+
+	// Values with these tags are stored LZ4-compressed if that makes them
+	// smaller. The flag is kept in StoreWithTime records only, so this
+	// requires trackEstimatedTime.
+	base::flat_set<uint8> compressedTags;
+	size_type compressMinSize = 256;
+
+	// Values are spread between shards by Key, each shard has its own
+	// binlog, data folders and queue, totalSizeLimit is shared by all.
+	size_type shardsCount = 1;
 };
 
 struct SettingsUpdate {
@@ -101,9 +121,36 @@ struct TaggedSummary {
 	size_type count = 0;
 	int64 totalSize = 0;
 };
+struct TaggedUsage {
+	int64 hits = 0;
+	int64 misses = 0;
+	int64 puts = 0;
+	int64 bytesRead = 0;
+	int64 bytesWritten = 0;
+
+	void merge(const TaggedUsage &other);
+};
+
+// Bucket i counts operations that took less than 2^i microseconds,
+// but not less than 2^(i-1), the last one counts all the slower ones.
+struct LatencyHistogram {
+	static constexpr auto kBucketsCount = 16;
+
+	void add(int64 microseconds);
+	void merge(const LatencyHistogram &other);
+	[[nodiscard]] int64 count() const;
+	[[nodiscard]] int64 percentile(int percent) const;
+
+	std::array<int64, kBucketsCount> buckets = { { 0 } };
+};
+
 struct Stats {
 	TaggedSummary full;
 	base::flat_map<uint8, TaggedSummary> tagged;
+	TaggedUsage fullUsage;
+	base::flat_map<uint8, TaggedUsage> taggedUsage;
+	LatencyHistogram getLatency;
+	LatencyHistogram putLatency;
 	bool clearing = false;
 };
 
@@ -119,6 +166,7 @@ constexpr auto GoodForEncryption = ((sizeof(Record) & 0x0F) == 0);
 
 enum class Format : uint32 {
 	Format_0,
+	Format_1, // May hold LZ4-compressed values, see StoreWithTime::flags.
 };
 
 struct BasicHeader {
@@ -169,8 +217,15 @@ struct Store {
 };
 
 struct StoreWithTime : Store {
+	static constexpr auto kCompressed = 0x01U;
+	static constexpr auto kRawSizeShift = 8;
+
+	// Compressed values keep their original size in the upper bits.
+	void setCompressedRawSize(size_type rawSize);
+	size_type getCompressedRawSize() const;
+
 	EstimatedTimePoint time;
-	uint32 reserved = 0;
+	uint32 flags = 0;
 };
 
 struct MultiStore {
@@ -193,6 +248,21 @@ struct MultiStoreWithTime : MultiStore {
 	using Part = StoreWithTime;
 };
 
+struct SnapshotHeader {
+	static constexpr auto kTrackEstimatedTime = 0x01U;
+
+	uint32 format = 0;
+	uint32 flags = 0;
+	uint32 count = 0;
+	uint32 reserved1 = 0;
+	int64 binlogOffset = 0;
+	int64 binlogExcessLength = 0;
+	EstimatedTimePoint time;
+	uint32 reserved2 = 0;
+
+	using Part = StoreWithTime;
+};
+
 struct MultiRemove {
 	static constexpr auto kType = RecordType(0x03);
 
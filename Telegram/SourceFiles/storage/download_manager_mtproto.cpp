@@ -22,42 +22,140 @@ constexpr auto kStartWaitedInSession = 4 * kDownloadPartSize;
 constexpr auto kMaxWaitedInSession = 16 * kDownloadPartSize;
 constexpr auto kStartSessionsCount = 1;
 constexpr auto kMaxSessionsCount = 8;
-constexpr auto kMaxTrackedSessionRemoves = 64;
-constexpr auto kRetryAddSessionTimeout = 8 * crl::time(1000);
-constexpr auto kRetryAddSessionSuccesses = 3;
-constexpr auto kMaxTrackedSuccesses = kRetryAddSessionSuccesses
-	* kMaxTrackedSessionRemoves;
-constexpr auto kRemoveSessionAfterTimeouts = 4;
+constexpr auto kRemoveSessionTimeout = 8 * crl::time(1000);
 constexpr auto kResetDownloadPrioritiesTimeout = crl::time(200);
 constexpr auto kBadRequestDurationThreshold = 8 * crl::time(1000);
 
-// Each (session remove by timeouts) we wait for time:
-// kRetryAddSessionTimeout * max(removesCount, kMaxTrackedSessionRemoves)
-// and for successes in all remaining sessions:
-// kRetryAddSessionSuccesses * max(removesCount, kMaxTrackedSessionRemoves)
+// New sessions are added when each has this much in flight.
+constexpr auto kPreferredWaitedInSession = kStartWaitedInSession;
+
+// Bandwidth and round trip samples are kept for that long.
+constexpr auto kEstimateWindow = 10 * crl::time(1000);
+
+// While in startup we keep 2/ln(2) of the estimated bandwidth-delay
+// product in flight, after that twice as much to fill the pipe.
+constexpr auto kStartupGainPercent = 289;
+constexpr auto kCruiseGainPercent = 200;
+constexpr auto kMinInFlight = 2 * kDownloadPartSize;
+constexpr auto kMaxInFlight = kMaxSessionsCount * kMaxWaitedInSession;
+
+// Startup ends when bandwidth didn't grow by 25% in three rounds.
+constexpr auto kFullBandwidthGrowthPercent = 125;
+constexpr auto kFullBandwidthRounds = 3;
+
+// Automatic downloads are counted against the budget in such windows.
+constexpr auto kAutomaticBudgetWindow = 3600 * crl::time(1000);
+
+// Virtual time a task spends on a part with the weight of one.
+constexpr auto kPartVirtualCost = int64(1024);
+
+[[nodiscard]] int64 PartCost(DownloadClass type, int priority) {
+	// Visible tasks of the older generations have priority -1.
+	const auto weight = (type == DownloadClass::Background)
+		? 1
+		: (type == DownloadClass::Visible && priority < 0)
+		? 4
+		: 8;
+	return kPartVirtualCost / weight;
+}
 
 } // namespace
 
+int64 DownloadManagerMtproto::Estimator::delivered() const {
+	return _delivered;
+}
+
+int64 DownloadManagerMtproto::Estimator::bandwidth() const {
+	return _bandwidth.empty() ? 0 : _bandwidth.front().value;
+}
+
+crl::time DownloadManagerMtproto::Estimator::roundTrip() const {
+	return _roundTrip.empty() ? 0 : _roundTrip.front().value;
+}
+
+int DownloadManagerMtproto::Estimator::targetInFlight() const {
+	const auto rate = bandwidth();
+	const auto rtt = roundTrip();
+	if (!rate || !rtt) {
+		return kStartWaitedInSession;
+	}
+	const auto product = rate * rtt / 1000;
+	const auto gain = _startup ? kStartupGainPercent : kCruiseGainPercent;
+	return int(std::clamp(
+		product * gain / 100,
+		int64(kMinInFlight),
+		int64(kMaxInFlight)));
+}
+
+void DownloadManagerMtproto::Estimator::received(
+		int bytes,
+		int64 deliveredAtRequestStart,
+		crl::time duration,
+		bool measureRoundTrip) {
+	const auto now = crl::now();
+	const auto push = [&](std::deque<Sample> &samples, auto &&outdated) {
+		while (!samples.empty() && outdated(samples.back())) {
+			samples.pop_back();
+		}
+		while (!samples.empty()
+			&& samples.front().time + kEstimateWindow < now) {
+			samples.pop_front();
+		}
+	};
+
+	_delivered += bytes;
+	const auto elapsed = std::max(duration, crl::time(1));
+	const auto rate = (_delivered - deliveredAtRequestStart) * 1000 / elapsed;
+	push(_bandwidth, [&](const Sample &sample) {
+		return (sample.value <= rate);
+	});
+	_bandwidth.push_back({ now, rate });
+
+	if (measureRoundTrip) {
+		push(_roundTrip, [&](const Sample &sample) {
+			return (sample.value >= elapsed);
+		});
+		_roundTrip.push_back({ now, elapsed });
+	}
+	checkFullBandwidth(deliveredAtRequestStart);
+}
+
+void DownloadManagerMtproto::Estimator::checkFullBandwidth(
+		int64 deliveredAtRequestStart) {
+	// A round ends when a request sent after the previous round ended
+	// is delivered.
+	if (!_startup || deliveredAtRequestStart < _roundEndDelivered) {
+		return;
+	}
+	_roundEndDelivered = _delivered;
+	const auto rate = bandwidth();
+	if (rate * 100 >= _fullBandwidth * kFullBandwidthGrowthPercent) {
+		_fullBandwidth = rate;
+		_fullBandwidthRounds = 0;
+	} else if (++_fullBandwidthRounds >= kFullBandwidthRounds) {
+		_startup = false;
+	}
+}
+
+void DownloadManagerMtproto::Estimator::timedOut() {
+	// The pipe is overloaded, forget the bandwidth we've seen.
+	_bandwidth.clear();
+	_startup = false;
+}
+
 void DownloadManagerMtproto::Queue::enqueue(
 		not_null<Task*> task,
+		DownloadClass type,
 		int priority) {
-	const auto position = ranges::find_if(_tasks, [&](const Enqueued &task) {
-		return task.priority <= priority;
-	}) - begin(_tasks);
-	const auto now = ranges::find(_tasks, task, &Enqueued::task);
-	const auto i = [&] {
-		if (now != end(_tasks)) {
-			(now->priority = priority);
-			return now;
-		}
-		_tasks.push_back({ task, priority });
-		return end(_tasks) - 1;
-	}();
-	const auto j = begin(_tasks) + position;
-	if (j < i) {
-		std::rotate(j, i, i + 1);
-	} else if (j > i + 1) {
-		std::rotate(i, i + 1, j);
+	const auto i = ranges::find(_tasks, task, &Enqueued::task);
+	if (i != end(_tasks)) {
+		i->type = type;
+		i->priority = priority;
+
+		// Don't let a task that was idle for a while take a burst.
+		i->virtualTime = std::max(i->virtualTime, _virtualTime);
+	} else {
+		_tasks.push_back({ task, type, priority, _virtualTime });
 	}
 }
 
@@ -66,13 +164,10 @@ void DownloadManagerMtproto::Queue::remove(not_null<Task*> task) {
 }
 
 void DownloadManagerMtproto::Queue::resetGeneration() {
-	const auto from = ranges::find(_tasks, 0, &Enqueued::priority);
-	for (auto &task : ranges::make_subrange(from, end(_tasks))) {
-		if (task.priority) {
-			Assert(task.priority == -1);
-			break;
+	for (auto &enqueued : _tasks) {
+		if (enqueued.type == DownloadClass::Visible && !enqueued.priority) {
+			enqueued.priority = -1;
 		}
-		task.priority = -1;
 	}
 }
 
@@ -82,23 +177,48 @@ bool DownloadManagerMtproto::Queue::empty() const {
 
 auto DownloadManagerMtproto::Queue::nextTask(bool onlyHighestPriority) const
 -> Task* {
-	if (_tasks.empty()) {
-		return nullptr;
-	}
-	const auto highestPriority = _tasks.front().priority;
-	const auto notHighestPriority = [&](const Enqueued &enqueued) {
-		return (enqueued.priority != highestPriority);
+	const auto streaming = [](const Enqueued &enqueued) {
+		return (enqueued.type == DownloadClass::Streaming);
 	};
-	const auto till = (onlyHighestPriority && highestPriority > 0)
-		? ranges::find_if(_tasks, notHighestPriority)
-		: end(_tasks);
-	const auto readyToRequest = [&](const Enqueued &enqueued) {
-		return enqueued.task->readyToRequest();
+	auto highestPriority = 0;
+	for (const auto &enqueued : _tasks) {
+		if (streaming(enqueued)) {
+			accumulate_max(highestPriority, enqueued.priority);
+		}
+	}
+
+	// While playback waits for some parts
+	// only the most recent stream gets new requests.
+	const auto exclusive = (onlyHighestPriority && highestPriority > 0);
+	const auto better = [&](const Enqueued &a, const Enqueued &b) {
+		if (streaming(a) != streaming(b)) {
+			return streaming(a);
+		} else if (streaming(a) && a.priority != b.priority) {
+			return (a.priority > b.priority);
+		}
+		return (a.virtualTime < b.virtualTime);
 	};
-	const auto first = ranges::find_if(
-		ranges::make_subrange(begin(_tasks), till),
-		readyToRequest);
-	return (first != till) ? first->task.get() : nullptr;
+	auto result = (const Enqueued*)nullptr;
+	for (const auto &enqueued : _tasks) {
+		if (exclusive && (!streaming(enqueued)
+			|| enqueued.priority != highestPriority)) {
+			continue;
+		} else if (!enqueued.task->readyToRequest()) {
+			continue;
+		} else if (!result || better(enqueued, *result)) {
+			result = &enqueued;
+		}
+	}
+	return result ? result->task.get() : nullptr;
+}
+
+void DownloadManagerMtproto::Queue::served(not_null<Task*> task) {
+	const auto i = ranges::find(_tasks, task, &Enqueued::task);
+	if (i == end(_tasks)) {
+		return;
+	}
+	_virtualTime = std::max(_virtualTime, i->virtualTime);
+	i->virtualTime += PartCost(i->type, i->priority);
 }
 
 void DownloadManagerMtproto::Queue::removeSession(int index) {
@@ -127,16 +247,21 @@ DownloadManagerMtproto::DownloadManagerMtproto(not_null<ApiWrap*> api)
 			MTP::BareDcId(shiftedDcId),
 			MTP::GetDcIdShift(shiftedDcId));
 	}, _lifetime);
+
+	preconnectUsedDcs();
 }
 
 DownloadManagerMtproto::~DownloadManagerMtproto() {
 	killSessions();
 }
 
-void DownloadManagerMtproto::enqueue(not_null<Task*> task, int priority) {
+void DownloadManagerMtproto::enqueue(
+		not_null<Task*> task,
+		DownloadClass type,
+		int priority) {
 	const auto dcId = task->dcId();
 	auto &queue = _queues[dcId];
-	queue.enqueue(task, priority);
+	queue.enqueue(task, type, priority);
 	if (!_resetGenerationTimer.isActive()) {
 		_resetGenerationTimer.callOnce(kResetDownloadPrioritiesTimeout);
 	}
@@ -190,6 +315,7 @@ bool DownloadManagerMtproto::trySendNextPart(MTP::DcId dcId, Queue &queue) {
 	}
 	const auto onlyHighestPriority = (balanceData.totalRequested > 0);
 	if (const auto task = queue.nextTask(onlyHighestPriority)) {
+		queue.served(task);
 		task->loadPart(bestIndex);
 		return true;
 	}
@@ -220,13 +346,23 @@ int DownloadManagerMtproto::changeRequestedAmount(
 	return result;
 }
 
+int64 DownloadManagerMtproto::deliveredAmount(MTP::DcId dcId) const {
+	const auto i = _balanceData.find(dcId);
+	return (i != end(_balanceData)) ? i->second.estimator.delivered() : 0;
+}
+
+int64 DownloadManagerMtproto::bandwidth(MTP::DcId dcId) const {
+	const auto i = _balanceData.find(dcId);
+	return (i != end(_balanceData)) ? i->second.estimator.bandwidth() : 0;
+}
+
 void DownloadManagerMtproto::requestSucceeded(
 		MTP::DcId dcId,
 		int index,
+		int receivedBytes,
 		int amountAtRequestStart,
+		int64 deliveredAtRequestStart,
 		crl::time timeAtRequestStart) {
-	using namespace rpl::mappers;
-
 	const auto guard = gsl::finally([&] {
 		checkSendNext(dcId, _queues[dcId]);
 	});
@@ -246,52 +382,71 @@ void DownloadManagerMtproto::requestSucceeded(
 		).arg(duration
 		).arg(parts
 		).arg(overloaded ? " (overloaded)" : ""));
-	if (overloaded) {
-		return;
-	}
 
 	if (duration >= kBadRequestDurationThreshold) {
 		DEBUG_LOG(("Duration too large, signaling time out."));
 		sessionTimedOut(dcId, index);
 		return;
 	}
-	if (amountAtRequestStart == data.maxWaitedAmount
-		&& data.maxWaitedAmount < kMaxWaitedInSession) {
-		data.maxWaitedAmount = std::min(
-			data.maxWaitedAmount + kDownloadPartSize,
-			kMaxWaitedInSession);
-		DEBUG_LOG(("Download (%1,%2) increased max waited amount %3."
+
+	// Requests waiting behind more than we wanted in flight
+	// measure the queue, not the round trip.
+	dc.estimator.received(
+		receivedBytes,
+		deliveredAtRequestStart,
+		duration,
+		!overloaded);
+	applyEstimate(dcId, dc);
+}
+
+void DownloadManagerMtproto::automaticReceived(int bytes) {
+	const auto now = crl::now();
+	if (!_automaticWindowStart
+		|| now >= _automaticWindowStart + kAutomaticBudgetWindow) {
+		_automaticWindowStart = now;
+		_automaticBytes = 0;
+	}
+	_automaticBytes += bytes;
+}
+
+int64 DownloadManagerMtproto::automaticBytesReceived() const {
+	return (_automaticWindowStart
+		&& crl::now() < _automaticWindowStart + kAutomaticBudgetWindow)
+		? _automaticBytes
+		: 0;
+}
+
+void DownloadManagerMtproto::applyEstimate(
+		MTP::DcId dcId,
+		DcBalanceData &dc) {
+	const auto target = dc.estimator.targetInFlight();
+	const auto wanted = std::clamp(
+		(target + kPreferredWaitedInSession - 1) / kPreferredWaitedInSession,
+		kStartSessionsCount,
+		kMaxSessionsCount);
+	const auto now = crl::now();
+	const auto count = int(dc.sessions.size());
+	if (wanted > count) {
+		dc.sessions.emplace_back();
+		DEBUG_LOG(("Download (%1,%2) adding, now sessions: %3, target: %4"
 			).arg(dcId
-			).arg(index
-			).arg(data.maxWaitedAmount));
-	}
-	data.successes = std::min(data.successes + 1, kMaxTrackedSuccesses);
-	const auto notEnough = ranges::find_if(
-		dc.sessions,
-		_1 < (dc.sessionRemoveTimes + 1) * kRetryAddSessionSuccesses,
-		&DcSessionBalanceData::successes);
-	if (notEnough != end(dc.sessions)) {
-		return;
+			).arg(dc.sessions.size() - 1
+			).arg(dc.sessions.size()
+			).arg(target));
+	} else if (wanted < count
+		&& now >= dc.lastSessionRemove + kRemoveSessionTimeout) {
+		removeSession(dcId);
 	}
+	const auto sessions = int(dc.sessions.size());
+	const auto parts = (target + sessions * kDownloadPartSize - 1)
+		/ (sessions * kDownloadPartSize);
+	const auto perSession = std::clamp(
+		parts * kDownloadPartSize,
+		kDownloadPartSize,
+		kMaxWaitedInSession);
 	for (auto &session : dc.sessions) {
-		session.successes = 0;
+		session.maxWaitedAmount = perSession;
 	}
-	if (dc.timeouts > 0) {
-		--dc.timeouts;
-		return;
-	} else if (dc.sessions.size() == kMaxSessionsCount) {
-		return;
-	}
-	const auto now = crl::now();
-	const auto delay = (dc.sessionRemoveTimes + 1) * kRetryAddSessionTimeout;
-	if (dc.lastSessionRemove && now < dc.lastSessionRemove + delay) {
-		return;
-	}
-	dc.sessions.emplace_back();
-	DEBUG_LOG(("Download (%1,%2) adding, now sessions: %3"
-		).arg(dcId
-		).arg(dc.sessions.size() - 1
-		).arg(dc.sessions.size()));
 }
 
 int DownloadManagerMtproto::chooseSessionIndex(MTP::DcId dcId) const {
@@ -315,15 +470,12 @@ void DownloadManagerMtproto::sessionTimedOut(MTP::DcId dcId, int index) {
 		return;
 	}
 	DEBUG_LOG(("Download (%1,%2) session timed-out.").arg(dcId).arg(index));
-	for (auto &session : dc.sessions) {
-		session.successes = 0;
-	}
-	if (dc.sessions.size() == kStartSessionsCount
-		|| ++dc.timeouts < kRemoveSessionAfterTimeouts) {
-		return;
+	dc.estimator.timedOut();
+	if (dc.sessions.size() > kStartSessionsCount
+		&& crl::now() >= dc.lastSessionRemove + kRemoveSessionTimeout) {
+		removeSession(dcId);
 	}
-	dc.timeouts = 0;
-	removeSession(dcId);
+	applyEstimate(dcId, dc);
 }
 
 void DownloadManagerMtproto::removeSession(MTP::DcId dcId) {
@@ -334,15 +486,6 @@ void DownloadManagerMtproto::removeSession(MTP::DcId dcId) {
 		).arg(dcId
 		).arg(index
 		).arg(index));
-	auto &queue = _queues[dcId];
-	if (dc.sessionRemoveIndex == index) {
-		dc.sessionRemoveTimes = std::min(
-			dc.sessionRemoveTimes + 1,
-			kMaxTrackedSessionRemoves);
-	} else {
-		dc.sessionRemoveIndex = index;
-		dc.sessionRemoveTimes = 1;
-	}
 	auto &session = dc.sessions.back();
 
 	// Make sure we don't send anything to that session while redirecting.
@@ -356,6 +499,24 @@ void DownloadManagerMtproto::removeSession(MTP::DcId dcId) {
 	dc.lastSessionRemove = crl::now();
 }
 
+void DownloadManagerMtproto::preconnectUsedDcs() {
+	// We have persistent keys for the dcs we downloaded from before,
+	// the chats list userpics will most likely be there as well. Set up
+	// the download connections now, in parallel with the main session,
+	// instead of waiting for the first thumbnail request. They are
+	// closed as usual if nothing is requested from them in a while.
+	const auto instance = _api->instance();
+	for (const auto &key : instance->getKeysForWrite()) {
+		const auto dcId = key->dcId();
+		if (_balanceData.contains(dcId)) {
+			continue;
+		}
+		_balanceData.emplace(dcId, DcBalanceData());
+		instance->sendAnything(MTP::downloadDcId(dcId, 0));
+		killSessionsSchedule(dcId);
+	}
+}
+
 void DownloadManagerMtproto::killSessionsSchedule(MTP::DcId dcId) {
 	if (!_killSessionsWhen.contains(dcId)) {
 		_killSessionsWhen.emplace(dcId, crl::now() + kKillSessionTimeout);
@@ -503,6 +664,7 @@ mtpRequestId DownloadMtprotoTask::sendRequest(
 		_cdnDcId ? _cdnDcId : dcId(),
 		requestData.sessionIndex);
 	if (_cdnDcId) {
+		prefetchCdnFileHashes(requestData);
 		return api().request(MTPupload_GetCdnFile(
 			MTP_bytes(_cdnToken),
 			MTP_int(offset),
@@ -567,7 +729,9 @@ void DownloadMtprotoTask::makeRequest(const RequestData &requestData) {
 }
 
 void DownloadMtprotoTask::requestMoreCdnFileHashes() {
-	if (_cdnHashesRequestId || _cdnUncheckedParts.empty()) {
+	if (_cdnHashesRequestId
+		|| _cdnHashesPrefetchRequestId
+		|| _cdnUncheckedParts.empty()) {
 		return;
 	}
 
@@ -589,9 +753,16 @@ void DownloadMtprotoTask::requestMoreCdnFileHashes() {
 void DownloadMtprotoTask::normalPartLoaded(
 		const MTPupload_File &result,
 		mtpRequestId requestId) {
+	const auto receivedBytes = result.match([](
+			const MTPDupload_fileCdnRedirect &data) {
+		return 0;
+	}, [](const MTPDupload_file &data) {
+		return int(data.vbytes().v.size());
+	});
 	const auto requestData = finishSentRequest(
 		requestId,
-		FinishRequestReason::Success);
+		FinishRequestReason::Success,
+		receivedBytes);
 	result.match([&](const MTPDupload_fileCdnRedirect &data) {
 		switchToCDN(requestData, data);
 	}, [&](const MTPDupload_file &data) {
@@ -605,7 +776,8 @@ void DownloadMtprotoTask::webPartLoaded(
 	result.match([&](const MTPDupload_webFile &data) {
 		const auto requestData = finishSentRequest(
 			requestId,
-			FinishRequestReason::Success);
+			FinishRequestReason::Success,
+			data.vbytes().v.size());
 		if (setWebFileSizeHook(data.vsize().v)) {
 			partLoaded(requestData.offset, data.vbytes().v);
 		}
@@ -632,7 +804,8 @@ void DownloadMtprotoTask::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequ
 	}, [&](const MTPDupload_cdnFile &data) {
 		const auto requestData = finishSentRequest(
 			requestId,
-			FinishRequestReason::Success);
+			FinishRequestReason::Success,
+			data.vbytes().v.size());
 		auto key = bytes::make_span(_cdnEncryptionKey);
 		auto iv = bytes::make_span(_cdnEncryptionIV);
 		Expects(key.size() == MTP::CTRState::KeySize);
@@ -706,6 +879,60 @@ void DownloadMtprotoTask::getCdnFileHashesDone(
 		requestId,
 		FinishRequestReason::Redirect);
 	addCdnHashes(result.v);
+	const auto someMoreChecked = feedCheckedCdnParts();
+	if (!someMoreChecked) {
+		return;
+	} else if (!*someMoreChecked) {
+		LOG(("API Error: "
+			"Could not find cdnFileHash for offset %1 "
+			"after getCdnFileHashes request."
+			).arg(requestData.offset));
+		cancelOnFail();
+		return;
+	}
+	requestMoreCdnFileHashes();
+}
+
+void DownloadMtprotoTask::prefetchCdnFileHashes(
+		const RequestData &requestData) {
+	// Ask for the hashes together with the part at the hashes boundary,
+	// so that the part doesn't wait one more round trip to be checked.
+	if (_cdnHashesRequestId
+		|| _cdnHashesPrefetchRequestId
+		|| _cdnFileHashes.contains(requestData.offset)) {
+		return;
+	}
+	const auto shiftedDcId = MTP::downloadDcId(
+		dcId(),
+		requestData.sessionIndex);
+	_cdnHashesPrefetchRequestId = api().request(MTPupload_GetCdnFileHashes(
+		MTP_bytes(_cdnToken),
+		MTP_int(requestData.offset)
+	)).done([=](const MTPVector<MTPFileHash> &result) {
+		_cdnHashesPrefetchRequestId = 0;
+		prefetchCdnFileHashesDone(result);
+	}).fail([=](const RPCError &error) {
+		// The hashes will be requested for the unchecked parts.
+		_cdnHashesPrefetchRequestId = 0;
+		requestMoreCdnFileHashes();
+	}).toDC(shiftedDcId).send();
+}
+
+void DownloadMtprotoTask::prefetchCdnFileHashesDone(
+		const MTPVector<MTPFileHash> &result) {
+	addCdnHashes(result.v);
+	if (feedCheckedCdnParts()) {
+		requestMoreCdnFileHashes();
+	}
+}
+
+void DownloadMtprotoTask::cancelCdnFileHashesPrefetch() {
+	if (const auto requestId = base::take(_cdnHashesPrefetchRequestId)) {
+		api().request(requestId).cancel();
+	}
+}
+
+std::optional<bool> DownloadMtprotoTask::feedCheckedCdnParts() {
 	auto someMoreChecked = false;
 	for (auto i = _cdnUncheckedParts.begin(); i != _cdnUncheckedParts.cend();) {
 		const auto uncheckedData = i->first;
@@ -720,7 +947,7 @@ void DownloadMtprotoTask::getCdnFileHashesDone(
 			LOG(("API Error: Wrong cdnFileHash for offset %1."
 				).arg(uncheckedData.offset));
 			cancelOnFail();
-			return;
+			return std::nullopt;
 		} break;
 
 		case CheckCdnHashResult::Good: {
@@ -730,22 +957,14 @@ void DownloadMtprotoTask::getCdnFileHashesDone(
 			const auto weak = base::make_weak(this);
 			i = _cdnUncheckedParts.erase(i);
 			if (!feedPart(goodOffset, goodBytes) || !weak) {
-				return;
+				return std::nullopt;
 			}
 		} break;
 
 		default: Unexpected("Result of checkCdnFileHash()");
 		}
 	}
-	if (!someMoreChecked) {
-		LOG(("API Error: "
-			"Could not find cdnFileHash for offset %1 "
-			"after getCdnFileHashes request."
-			).arg(requestData.offset));
-		cancelOnFail();
-		return;
-	}
-	requestMoreCdnFileHashes();
+	return someMoreChecked;
 }
 
 void DownloadMtprotoTask::placeSentRequest(
@@ -761,6 +980,7 @@ void DownloadMtprotoTask::placeSentRequest(
 		requestId);
 
 	i->second.requestedInSession = amount;
+	i->second.deliveredInDc = _owner->deliveredAmount(dcId());
 	i->second.sent = crl::now();
 
 	Ensures(ok1 && ok2);
@@ -768,7 +988,8 @@ void DownloadMtprotoTask::placeSentRequest(
 
 auto DownloadMtprotoTask::finishSentRequest(
 	mtpRequestId requestId,
-	FinishRequestReason reason)
+	FinishRequestReason reason,
+	int receivedBytes)
 -> RequestData {
 	auto it = _sentRequests.find(requestId);
 	Assert(it != _sentRequests.cend());
@@ -785,10 +1006,15 @@ auto DownloadMtprotoTask::finishSentRequest(
 	const auto ok = _requestByOffset.remove(result.offset);
 
 	if (reason == FinishRequestReason::Success) {
+		if (_downloadClass == DownloadClass::Visible) {
+			_owner->automaticReceived(receivedBytes);
+		}
 		_owner->requestSucceeded(
 			dcId(),
 			result.sessionIndex,
+			receivedBytes,
 			result.requestedInSession,
+			result.deliveredInDc,
 			result.sent);
 	}
 
@@ -809,6 +1035,7 @@ void DownloadMtprotoTask::cancelAllRequests() {
 	while (!_sentRequests.empty()) {
 		cancelRequest(_sentRequests.begin()->first);
 	}
+	cancelCdnFileHashesPrefetch();
 	_cdnUncheckedParts.clear();
 }
 
@@ -833,8 +1060,9 @@ void DownloadMtprotoTask::cancelRequest(mtpRequestId requestId) {
 	}
 }
 
-void DownloadMtprotoTask::addToQueue(int priority) {
-	_owner->enqueue(this, priority);
+void DownloadMtprotoTask::addToQueue(DownloadClass type, int priority) {
+	_downloadClass = type;
+	_owner->enqueue(this, type, priority);
 }
 
 void DownloadMtprotoTask::removeFromQueue() {
@@ -944,6 +1172,9 @@ void DownloadMtprotoTask::changeCDNParams(
 		|| _cdnToken != token
 		|| _cdnEncryptionKey != encryptionKey
 		|| _cdnEncryptionIV != encryptionIV);
+	if (resendAllRequests) {
+		cancelCdnFileHashesPrefetch();
+	}
 	_cdnDcId = dcId;
 	_cdnToken = token;
 	_cdnEncryptionKey = encryptionKey;
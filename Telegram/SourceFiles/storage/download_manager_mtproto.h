@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "base/weak_ptr.h"
 
+#include <deque>
+
 class ApiWrap;
 class RPCError;
 
@@ -24,6 +26,14 @@ constexpr auto kDownloadPartSize = 128 * 1024;
 
 class DownloadMtprotoTask;
 
+// Tasks of an earlier class are always served first,
+// inside one class tasks share the bandwidth by their weights.
+enum class DownloadClass {
+	Streaming, // Playback is waiting for these parts.
+	Visible, // Shown on the screen right now, like thumbnails.
+	Background, // Everything else, like saving files.
+};
+
 class DownloadManagerMtproto final : public base::has_weak_ptr {
 public:
 	using Task = DownloadMtprotoTask;
@@ -35,7 +45,7 @@ public:
 		return *_api;
 	}
 
-	void enqueue(not_null<Task*> task, int priority);
+	void enqueue(not_null<Task*> task, DownloadClass type, int priority);
 	void remove(not_null<Task*> task);
 
 	[[nodiscard]] base::Observable<void> &taskFinished() {
@@ -43,46 +53,91 @@ public:
 	}
 
 	int changeRequestedAmount(MTP::DcId dcId, int index, int delta);
+	[[nodiscard]] int64 deliveredAmount(MTP::DcId dcId) const;
+	[[nodiscard]] int64 bandwidth(MTP::DcId dcId) const;
 	void requestSucceeded(
 		MTP::DcId dcId,
 		int index,
+		int receivedBytes,
 		int amountAtRequestStart,
+		int64 deliveredAtRequestStart,
 		crl::time timeAtRequestStart);
 	[[nodiscard]] int chooseSessionIndex(MTP::DcId dcId) const;
 
+	// Bytes received by automatic (DownloadClass::Visible) downloads
+	// in the current budget window.
+	void automaticReceived(int bytes);
+	[[nodiscard]] int64 automaticBytesReceived() const;
+
 private:
+	// Weighted fair queue with start time tags, a task that was served
+	// less than its share of parts is chosen first.
 	class Queue final {
 	public:
-		void enqueue(not_null<Task*> task, int priority);
+		void enqueue(not_null<Task*> task, DownloadClass type, int priority);
 		void remove(not_null<Task*> task);
 		void resetGeneration();
 		[[nodiscard]] bool empty() const;
 		[[nodiscard]] Task *nextTask(bool onlyHighestPriority) const;
+		void served(not_null<Task*> task);
 		void removeSession(int index);
 
 	private:
 		struct Enqueued {
 			not_null<Task*> task;
+			DownloadClass type = DownloadClass::Background;
 			int priority = 0;
+			int64 virtualTime = 0;
 		};
 		std::vector<Enqueued> _tasks;
+		int64 _virtualTime = 0;
+
+	};
+	// BBR-like estimate of the delivery rate and the round trip of a dc,
+	// the amount in flight is chosen to fill the measured pipe.
+	class Estimator final {
+	public:
+		[[nodiscard]] int64 delivered() const;
+		[[nodiscard]] int64 bandwidth() const; // Bytes per second.
+		[[nodiscard]] int targetInFlight() const;
+
+		void received(
+			int bytes,
+			int64 deliveredAtRequestStart,
+			crl::time duration,
+			bool measureRoundTrip);
+		void timedOut();
+
+	private:
+		struct Sample {
+			crl::time time = 0;
+			int64 value = 0;
+		};
+
+		[[nodiscard]] crl::time roundTrip() const;
+		void checkFullBandwidth(int64 deliveredAtRequestStart);
+
+		std::deque<Sample> _bandwidth; // Sliding max, decreasing values.
+		std::deque<Sample> _roundTrip; // Sliding min, increasing values.
+		int64 _delivered = 0;
+		int64 _roundEndDelivered = 0;
+		int64 _fullBandwidth = 0;
+		int _fullBandwidthRounds = 0;
+		bool _startup = true;
 
 	};
 	struct DcSessionBalanceData {
 		DcSessionBalanceData();
 
 		int requested = 0;
-		int successes = 0; // Since last timeout in this dc in any session.
 		int maxWaitedAmount = 0;
 	};
 	struct DcBalanceData {
 		DcBalanceData();
 
 		std::vector<DcSessionBalanceData> sessions;
+		Estimator estimator;
 		crl::time lastSessionRemove = 0;
-		int sessionRemoveIndex = 0;
-		int sessionRemoveTimes = 0;
-		int timeouts = 0; // Since all sessions had successes >= required.
 		int totalRequested = 0;
 	};
 
@@ -90,6 +145,7 @@ private:
 	void checkSendNext(MTP::DcId dcId, Queue &queue);
 	bool trySendNextPart(MTP::DcId dcId, Queue &queue);
 
+	void preconnectUsedDcs();
 	void killSessionsSchedule(MTP::DcId dcId);
 	void killSessionsCancel(MTP::DcId dcId);
 	void killSessions();
@@ -97,6 +153,7 @@ private:
 
 	void resetGeneration();
 	void sessionTimedOut(MTP::DcId dcId, int index);
+	void applyEstimate(MTP::DcId dcId, DcBalanceData &dc);
 	void removeSession(MTP::DcId dcId);
 
 	const not_null<ApiWrap*> _api;
@@ -110,6 +167,10 @@ private:
 	base::Timer _killSessionsTimer;
 
 	base::flat_map<MTP::DcId, Queue> _queues;
+
+	crl::time _automaticWindowStart = 0;
+	int64 _automaticBytes = 0;
+
 	rpl::lifetime _lifetime;
 
 };
@@ -153,18 +214,22 @@ protected:
 	void cancelAllRequests();
 	void cancelRequestForOffset(int offset);
 
-	void addToQueue(int priority = 0);
+	void addToQueue(DownloadClass type, int priority = 0);
 	void removeFromQueue();
 
 	[[nodiscard]] ApiWrap &api() const {
 		return _owner->api();
 	}
+	[[nodiscard]] int64 downloadBandwidth() const {
+		return _owner->bandwidth(dcId());
+	}
 
 private:
 	struct RequestData {
 		int offset = 0;
 		int sessionIndex = 0;
 		int requestedInSession = 0;
+		int64 deliveredInDc = 0;
 		crl::time sent = 0;
 
 		inline bool operator<(const RequestData &other) const {
@@ -212,6 +277,13 @@ private:
 	void getCdnFileHashesDone(
 		const MTPVector<MTPFileHash> &result,
 		mtpRequestId requestId);
+	void prefetchCdnFileHashes(const RequestData &requestData);
+	void prefetchCdnFileHashesDone(const MTPVector<MTPFileHash> &result);
+	void cancelCdnFileHashesPrefetch();
+
+	// Returns std::nullopt if the task was finished or failed,
+	// otherwise returns whether some of the parts were fed.
+	[[nodiscard]] std::optional<bool> feedCheckedCdnParts();
 
 	void partLoaded(int offset, const QByteArray &bytes);
 
@@ -228,7 +300,8 @@ private:
 		const RequestData &requestData);
 	[[nodiscard]] RequestData finishSentRequest(
 		mtpRequestId requestId,
-		FinishRequestReason reason);
+		FinishRequestReason reason,
+		int receivedBytes = 0);
 	void switchToCDN(
 		const RequestData &requestData,
 		const MTPDupload_fileCdnRedirect &redirect);
@@ -254,6 +327,7 @@ private:
 
 	base::flat_map<mtpRequestId, RequestData> _sentRequests;
 	base::flat_map<int, mtpRequestId> _requestByOffset;
+	DownloadClass _downloadClass = DownloadClass::Background;
 
 	MTP::DcId _cdnDcId = 0;
 	QByteArray _cdnToken;
@@ -262,6 +336,7 @@ private:
 	base::flat_map<int, CdnFileHash> _cdnFileHashes;
 	base::flat_map<RequestData, QByteArray> _cdnUncheckedParts;
 	mtpRequestId _cdnHashesRequestId = 0;
+	mtpRequestId _cdnHashesPrefetchRequestId = 0;
 
 };
 
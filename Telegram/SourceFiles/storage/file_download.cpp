@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "core/application.h"
 #include "storage/localstorage.h"
+#include "storage/download_manager_mtproto.h"
 #include "platform/platform_file_utilities.h"
 #include "main/main_session.h"
 #include "apiwrap.h"
@@ -23,6 +24,27 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "facades.h"
 #include "app.h"
 
+namespace {
+
+[[nodiscard]] QImage ReadImage(
+		const QByteArray &data,
+		QByteArray *format,
+		const QSize &shrinkBox) {
+	auto image = App::readImage(data, format, false, nullptr, shrinkBox);
+	if (!image.isNull()
+		&& !shrinkBox.isEmpty()
+		&& (image.width() > shrinkBox.width()
+			|| image.height() > shrinkBox.height())) {
+		return image.scaled(
+			shrinkBox,
+			Qt::KeepAspectRatio,
+			Qt::SmoothTransformation);
+	}
+	return image;
+}
+
+} // namespace
+
 FileLoader::FileLoader(
 	const QString &toFile,
 	int32 size,
@@ -33,6 +55,9 @@ FileLoader::FileLoader(
 	uint8 cacheTag)
 : _session(&Auth())
 , _autoLoading(autoLoading)
+, _downloadClass(autoLoading
+	? Storage::DownloadClass::Visible
+	: Storage::DownloadClass::Background)
 , _cacheTag(cacheTag)
 , _filename(toFile)
 , _file(_filename)
@@ -49,6 +74,14 @@ Main::Session &FileLoader::session() const {
 	return *_session;
 }
 
+void FileLoader::setDownloadClass(Storage::DownloadClass type) {
+	_downloadClass = type;
+}
+
+Storage::DownloadClass FileLoader::downloadClass() const {
+	return _downloadClass;
+}
+
 void FileLoader::finishWithBytes(const QByteArray &data) {
 	_data = data;
 	_localStatus = LocalStatus::Loaded;
@@ -76,28 +109,66 @@ void FileLoader::finishWithBytes(const QByteArray &data) {
 }
 
 QByteArray FileLoader::imageFormat(const QSize &shrinkBox) const {
-	if (_imageFormat.isEmpty() && _locationType == UnknownFileLocation) {
+	if (_imageFormat.isEmpty()
+		&& !_imageRead
+		&& _locationType == UnknownFileLocation) {
 		readImage(shrinkBox);
 	}
 	return _imageFormat;
 }
 
 QImage FileLoader::imageData(const QSize &shrinkBox) const {
-	if (_imageData.isNull() && _locationType == UnknownFileLocation) {
+	if (_imageData.isNull()
+		&& !_imageRead
+		&& _locationType == UnknownFileLocation) {
 		readImage(shrinkBox);
 	}
 	return _imageData;
 }
 
+bool FileLoader::prepareImageData(const QSize &shrinkBox) {
+	if (!_finished
+		|| _imageRead
+		|| !_imageData.isNull()
+		|| _locationType != UnknownFileLocation) {
+		return true;
+	} else if (_imageReading) {
+		return false;
+	}
+	auto done = [=, guard = _imageReading.make_guard()](
+			QImage &&image,
+			QByteArray &&format) mutable {
+		crl::on_main(std::move(guard), [
+			=,
+			image = std::move(image),
+			format = std::move(format)
+		]() mutable {
+			_imageRead = true;
+			if (!image.isNull()) {
+				_imageData = std::move(image);
+				_imageFormat = std::move(format);
+			}
+			Auth().downloaderTaskFinished().notify();
+		});
+	};
+	crl::async([
+		data = _data,
+		shrinkBox,
+		done = std::move(done)
+	]() mutable {
+		auto format = QByteArray();
+		auto image = ReadImage(data, &format, shrinkBox);
+		done(std::move(image), std::move(format));
+	});
+	return false;
+}
+
 void FileLoader::readImage(const QSize &shrinkBox) const {
 	auto format = QByteArray();
-	auto image = App::readImage(_data, &format, false);
+	auto image = ReadImage(_data, &format, shrinkBox);
+	_imageRead = true;
 	if (!image.isNull()) {
-		if (!shrinkBox.isEmpty() && (image.width() > shrinkBox.width() || image.height() > shrinkBox.height())) {
-			_imageData = image.scaled(shrinkBox, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-		} else {
-			_imageData = std::move(image);
-		}
+		_imageData = std::move(image);
 		_imageFormat = format;
 	}
 }
@@ -186,7 +257,7 @@ void FileLoader::loadLocal(const Storage::Cache::Key &key) {
 				std::move(image));
 		});
 	};
-	session().data().cache().get(key, [=, callback = std::move(done)](
+	session().data().cache().getBatched(key, [=, callback = std::move(done)](
 			QByteArray &&value) mutable {
 		if (readImage) {
 			crl::async([
@@ -26,6 +26,8 @@ namespace Cache {
 struct Key;
 } // namespace Cache
 
+enum class DownloadClass;
+
 // 10 MB max file could be hold in memory
 // This value is used in local cache database settings!
 constexpr auto kMaxFileInMemory = 10 * 1024 * 1024;
@@ -85,6 +87,10 @@ public:
 	}
 	QByteArray imageFormat(const QSize &shrinkBox = QSize()) const;
 	QImage imageData(const QSize &shrinkBox = QSize()) const;
+
+	// Decodes the loaded bytes on a worker thread. Returns false while the
+	// image is being decoded, downloaderTaskFinished() fires when done.
+	[[nodiscard]] bool prepareImageData(const QSize &shrinkBox = QSize());
 	QString fileName() const {
 		return _filename;
 	}
@@ -107,6 +113,10 @@ public:
 		return _autoLoading;
 	}
 
+	// Visible for auto loaded media and Background for the rest by default.
+	void setDownloadClass(Storage::DownloadClass type);
+	[[nodiscard]] Storage::DownloadClass downloadClass() const;
+
 	void localLoaded(
 		const StorageImageSaved &result,
 		const QByteArray &imageFormat,
@@ -144,6 +154,7 @@ protected:
 	const not_null<Main::Session*> _session;
 
 	bool _autoLoading = false;
+	Storage::DownloadClass _downloadClass;
 	uint8 _cacheTag = 0;
 	bool _finished = false;
 	bool _cancelled = false;
@@ -163,7 +174,9 @@ protected:
 	LocationType _locationType = LocationType();
 
 	base::binary_guard _localLoading;
+	base::binary_guard _imageReading;
 	mutable QByteArray _imageFormat;
 	mutable QImage _imageData;
+	mutable bool _imageRead = false;
 
 };
@@ -142,7 +142,7 @@ bool mtpFileLoader::setWebFileSizeHook(int size) {
 }
 
 void mtpFileLoader::startLoading() {
-	addToQueue();
+	addToQueue(downloadClass());
 }
 
 void mtpFileLoader::cancelHook() {
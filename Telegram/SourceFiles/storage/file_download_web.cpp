@@ -13,7 +13,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
-constexpr auto kMaxWebFileQueries = 8;
+constexpr auto kMaxWebFileQueries = 16;
+constexpr auto kMaxWebFileQueriesPerHost = 4;
 constexpr auto kMaxHttpRedirects = 5;
 constexpr auto kResetDownloadPrioritiesTimeout = crl::time(200);
 
@@ -68,9 +69,11 @@ private:
 	struct Enqueued {
 		int id = 0;
 		QString url;
+		QString host;
 	};
 	struct Sent {
 		QString url;
+		QString host; // Of the first url, before any redirects.
 		not_null<QNetworkReply*> reply;
 		QByteArray data;
 		int64 ready = 0;
@@ -86,6 +89,7 @@ private:
 	void remove(int id);
 	void resetGeneration();
 	void checkSendNext();
+	[[nodiscard]] bool canSendTo(const QString &host) const;
 	void send(const Enqueued &entry);
 	[[nodiscard]] not_null<QNetworkReply*> send(int id, const QString &url);
 	[[nodiscard]] Sent *findSent(int id, not_null<QNetworkReply*> reply);
@@ -209,7 +213,7 @@ void WebLoadManager::enqueue(int id, const QString &url) {
 	_previousGeneration.erase(
 		ranges::remove(_previousGeneration, id, &Enqueued::id),
 		end(_previousGeneration));
-	_queue.push_back(Enqueued{ id, url });
+	_queue.push_back(Enqueued{ id, url, QUrl(url).host() });
 	if (!_resetGenerationTimer.isActive()) {
 		_resetGenerationTimer.callOnce(kResetDownloadPrioritiesTimeout);
 	}
@@ -236,21 +240,41 @@ void WebLoadManager::resetGeneration() {
 }
 
 void WebLoadManager::checkSendNext() {
-	if (_sent.size() >= kMaxWebFileQueries
-		|| (_queue.empty() && _previousGeneration.empty())) {
-		return;
+	// Don't let one slow host take all the queries from the others.
+	const auto sendFirstAllowed = [&](std::deque<Enqueued> &queue) {
+		const auto i = ranges::find_if(queue, [&](const Enqueued &entry) {
+			return canSendTo(entry.host);
+		});
+		if (i == end(queue)) {
+			return false;
+		}
+		const auto entry = *i;
+		queue.erase(i);
+		send(entry);
+		return true;
+	};
+	while (_sent.size() < kMaxWebFileQueries) {
+		if (!sendFirstAllowed(_queue)
+			&& !sendFirstAllowed(_previousGeneration)) {
+			return;
+		}
+	}
+}
+
+bool WebLoadManager::canSendTo(const QString &host) const {
+	auto already = 0;
+	for (const auto &[id, sent] : _sent) {
+		if (sent.host == host && ++already >= kMaxWebFileQueriesPerHost) {
+			return false;
+		}
 	}
-	const auto entry = _queue.empty()
-		? _previousGeneration.front()
-		: _queue.front();
-	(_queue.empty() ? _previousGeneration : _queue).pop_front();
-	send(entry);
+	return true;
 }
 
 void WebLoadManager::send(const Enqueued &entry) {
 	const auto id = entry.id;
 	const auto url = entry.url;
-	_sent.emplace(id, Sent{ url, send(id, url) });
+	_sent.emplace(id, Sent{ url, entry.host, send(id, url) });
 }
 
 void WebLoadManager::removeSent(int id) {
@@ -262,7 +286,14 @@ void WebLoadManager::removeSent(int id) {
 }
 
 not_null<QNetworkReply*> WebLoadManager::send(int id, const QString &url) {
-	const auto result = _network.get(QNetworkRequest(url));
+	auto request = QNetworkRequest(url);
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+	// Many inline results and thumbnails come from the same few hosts,
+	// with HTTP/2 they share one connection instead of waiting in line.
+	request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif // Qt >= 5.8.0
+	const auto result = _network.get(request);
 	const auto handleProgress = [=](qint64 ready, qint64 total) {
 		progress(id, result, ready, total);
 	};
@@ -13,15 +13,48 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_photo.h"
 #include "data/data_session.h"
 #include "main/main_session.h"
+#include "storage/localstorage.h"
+#include "ui/ui_utility.h"
+#include "base/unixtime.h"
+
+#include <deque>
 
 namespace Storage {
 namespace {
 
-// max 512kb uploaded at the same time in each session
-constexpr auto kMaxUploadFileParallelSize = MTP::kUploadSessionsCount * 512 * 1024;
+// Up to this many files are uploaded at the same time.
+constexpr auto kMaxUploadingFiles = 4;
+
+// Start with 512kb uploaded at the same time in each of two sessions,
+// then size the window from the measured delivery rate and round trip.
+constexpr auto kInitialWindow = 2 * 512 * 1024;
+constexpr auto kMinWindow = 512 * 1024;
+constexpr auto kMaxWindow = MTP::kUploadSessionsCount * 2 * 1024 * 1024;
+constexpr auto kWindowGain = 2;
+
+// One more upload session is used for each 512kb of the window.
+constexpr auto kSessionWindow = 512 * 1024;
+
+// Minimal round trip is forgotten after that time.
+constexpr auto kRoundTripWindow = 10 * crl::time(1000);
+
+// Document parts are read and hashed on a worker thread that much ahead.
+constexpr auto kReadAheadSize = 2 * 1024 * 1024;
+
+// Larger document parts are used while that many of them fit the window.
+constexpr auto kPartsInWindow = 8;
+
+// Parts of big files uploaded earlier are reused for that time.
+constexpr auto kResumeTimeout = TimeId(6 * 3600);
+constexpr auto kMaxResumableCount = 16;
+constexpr auto kSaveResumableDelay = 3 * crl::time(1000);
 
 constexpr auto kDocumentMaxPartsCount = 3000;
 
+// Parts of the voice messages uploaded while recording are kept for the
+// message being sent and for the one recorded right after it.
+constexpr auto kMaxStreamedCount = 2;
+
 // 32kb for tiny document ( < 1mb )
 constexpr auto kDocumentUploadPartSize0 = 32 * 1024;
 
@@ -45,12 +78,61 @@ constexpr auto kKillSessionTimeout = 15 * crl::time(000);
 
 } // namespace
 
+struct Uploader::Reader {
+	struct Part {
+		int index = 0;
+		QByteArray bytes;
+	};
+
+	[[nodiscard]] bool read(int count);
+
+	QString filepath;
+	QByteArray content;
+	std::unique_ptr<QFile> file;
+	HashMd5 md5Hash;
+	std::vector<bool> skip; // Parts already stored on the server.
+	std::vector<Part> result;
+	int partSize = 0;
+	int partsCount = 0;
+	int partsRead = 0;
+	bool hash = false;
+
+};
+
+struct Uploader::Request {
+	FullMsgId fullId;
+	crl::time sent = 0;
+	int64 deliveredAtSent = 0;
+	int session = 0;
+	int size = 0;
+	int part = -1; // Index of the document part.
+	uint64 streamId = 0; // Set for the parts of a file being recorded.
+};
+
+struct Uploader::Resumable {
+	QString filepath;
+	int32 size = 0;
+	qint64 modified = 0;
+	uint64 fileId = 0;
+	int32 partSize = 0;
+	TimeId saved = 0;
+	std::vector<bool> acknowledged;
+};
+
+struct Uploader::Streamed {
+	uint64 id = 0;
+	QByteArray data;
+	int partsSent = 0;
+};
+
 struct Uploader::File {
 	File(const SendMediaReady &media);
 	File(const std::shared_ptr<FileLoadResult> &file);
 
 	void setDocSize(int32 size);
 	bool setPartSize(uint32 partSize);
+	void choosePartSize(int window);
+	void createReader();
 
 	std::shared_ptr<FileLoadResult> file;
 	SendMediaReady media;
@@ -61,17 +143,66 @@ struct Uploader::File {
 	SendMediaType type() const;
 	uint64 thumbId() const;
 	const QString &filename() const;
+	UploadFileParts &parts();
+	uint64 partsOfId() const;
+	bool uploaded();
 
-	HashMd5 md5Hash;
+	// Owned by a worker thread while reading is set.
+	std::shared_ptr<Reader> reader;
+	std::deque<Reader::Part> readParts;
+	bool reading = false;
+
+	std::shared_ptr<Resumable> resumable;
+	uint64 uploadId = 0;
 
-	std::unique_ptr<QFile> docFile;
 	int32 docSentParts = 0;
 	int32 docSize = 0;
 	int32 docPartSize = 0;
 	int32 docPartsCount = 0;
+	int docRequestsSent = 0;
+	int requestsSent = 0;
+	bool started = false;
+	bool ready = false;
 
 };
 
+bool Uploader::Reader::read(int count) {
+	if (content.isEmpty() && !file) {
+		file = std::make_unique<QFile>(filepath);
+		if (!file->open(QIODevice::ReadOnly)) {
+			return false;
+		}
+	}
+	result.clear();
+	result.reserve(count);
+	while (int(result.size()) < count && partsRead < partsCount) {
+		const auto index = partsRead++;
+		if (index < int(skip.size()) && skip[index]) {
+			continue;
+		}
+		auto part = Part{ index };
+		if (content.isEmpty()) {
+			const auto offset = qint64(index) * partSize;
+			if (file->pos() != offset && !file->seek(offset)) {
+				return false;
+			}
+			part.bytes = file->read(partSize);
+		} else {
+			part.bytes = content.mid(index * partSize, partSize);
+		}
+		const auto size = part.bytes.size();
+		const auto last = (index + 1 == partsCount);
+		if ((size > partSize) || (size < partSize && !last)) {
+			return false;
+		}
+		if (hash) {
+			md5Hash.feed(part.bytes.constData(), size);
+		}
+		result.push_back(std::move(part));
+	}
+	return true;
+}
+
 Uploader::File::File(const SendMediaReady &media) : media(media) {
 	partsCount = media.parts.size();
 	if (type() == SendMediaType::File
@@ -83,6 +214,7 @@ Uploader::File::File(const SendMediaReady &media) : media(media) {
 	} else {
 		docSize = docPartSize = docPartsCount = 0;
 	}
+	uploadId = id();
 }
 Uploader::File::File(const std::shared_ptr<FileLoadResult> &file)
 : file(file) {
@@ -97,6 +229,7 @@ Uploader::File::File(const std::shared_ptr<FileLoadResult> &file)
 	} else {
 		docSize = docPartSize = docPartsCount = 0;
 	}
+	uploadId = id();
 }
 
 void Uploader::File::setDocSize(int32 size) {
@@ -123,6 +256,33 @@ bool Uploader::File::setPartSize(uint32 partSize) {
 	return (docPartsCount <= kDocumentMaxPartsCount);
 }
 
+void Uploader::File::choosePartSize(int window) {
+	// The ladder gives the smallest allowed part, prefer larger ones
+	// if they still fit the window and the file well enough.
+	auto partSize = kDocumentUploadPartSize4;
+	while (partSize > docPartSize
+		&& (partSize * kPartsInWindow > window || partSize / 2 >= docSize)) {
+		partSize /= 2;
+	}
+	setPartSize(partSize);
+}
+
+void Uploader::File::createReader() {
+	reader = std::make_shared<Reader>();
+	reader->filepath = !file
+		? media.file
+		: file->uploadpath.isEmpty()
+		? file->filepath
+		: file->uploadpath;
+	reader->content = file ? file->content : media.data;
+	reader->partSize = docPartSize;
+	reader->partsCount = docPartsCount;
+	reader->hash = (docSize <= kUseBigFilesFrom);
+	if (resumable) {
+		reader->skip = resumable->acknowledged;
+	}
+}
+
 uint64 Uploader::File::id() const {
 	return file ? file->id : media.id;
 }
@@ -139,12 +299,40 @@ const QString &Uploader::File::filename() const {
 	return file ? file->filename : media.filename;
 }
 
+UploadFileParts &Uploader::File::parts() {
+	return file
+		? ((type() == SendMediaType::Photo
+			|| type() == SendMediaType::Secure)
+			? file->fileparts
+			: file->thumbparts)
+		: media.parts;
+}
+
+uint64 Uploader::File::partsOfId() const {
+	return file
+		? ((type() == SendMediaType::Photo
+			|| type() == SendMediaType::Secure)
+			? file->id
+			: file->thumbId)
+		: media.thumbId;
+}
+
+bool Uploader::File::uploaded() {
+	return parts().isEmpty()
+		&& (docSentParts >= docPartsCount)
+		&& !requestsSent
+		&& !reading;
+}
+
 Uploader::Uploader(not_null<ApiWrap*> api)
-: _api(api) {
+: _api(api)
+, _saveResumableTimer([=] { saveResumable(); }) {
 	nextTimer.setSingleShot(true);
 	connect(&nextTimer, SIGNAL(timeout()), this, SLOT(sendNext()));
 	stopSessionsTimer.setSingleShot(true);
 	connect(&stopSessionsTimer, SIGNAL(timeout()), this, SLOT(stopSessions()));
+
+	loadResumable();
 }
 
 void Uploader::uploadMedia(
@@ -206,41 +394,170 @@ void Uploader::upload(
 			document->setLocation(FileLocation(file->filepath));
 		}
 	}
-	queue.emplace(msgId, File(file));
+	const auto i = queue.emplace(msgId, File(file)).first;
+	if (file->type == SendMediaType::Audio && !file->content.isEmpty()) {
+		adoptStreamed(msgId, i->second);
+	}
 	sendNext();
 }
 
-void Uploader::currentFailed() {
-	auto j = queue.find(uploadingId);
-	if (j != queue.end()) {
-		if (j->second.type() == SendMediaType::Photo) {
-			_photoFailed.fire_copy(j->first);
-		} else if (j->second.type() == SendMediaType::File
-			|| j->second.type() == SendMediaType::ThemeFile
-			|| j->second.type() == SendMediaType::Audio) {
-			const auto document = Auth().data().document(j->second.id());
-			if (document->uploading()) {
-				document->status = FileUploadFailed;
-			}
-			_documentFailed.fire_copy(j->first);
-		} else if (j->second.type() == SendMediaType::Secure) {
-			_secureFailed.fire_copy(j->first);
+uint64 Uploader::startStreamedUpload() {
+	while (int(_streamed.size()) >= kMaxStreamedCount) {
+		cancelStreamedUpload(_streamed.front().id);
+	}
+	auto streamed = Streamed();
+	streamed.id = rand_value<uint64>();
+	_streamed.push_back(std::move(streamed));
+	stopSessionsTimer.stop();
+	return _streamed.back().id;
+}
+
+void Uploader::appendStreamedUpload(uint64 id, const QByteArray &bytes) {
+	const auto i = ranges::find(_streamed, id, &Streamed::id);
+	if (i == end(_streamed)) {
+		return;
+	}
+	i->data.append(bytes);
+	sendStreamedParts(*i);
+}
+
+void Uploader::cancelStreamedUpload(uint64 id) {
+	const auto i = ranges::find(_streamed, id, &Streamed::id);
+	if (i == end(_streamed)) {
+		return;
+	}
+	_streamed.erase(i);
+	for (auto j = _requests.begin(); j != _requests.end();) {
+		if (j->second.streamId == id) {
+			MTP::cancel(j->first);
+			sentSize -= j->second.size;
+			sentSizes[j->second.session] -= j->second.size;
+			j = _requests.erase(j);
 		} else {
-			Unexpected("Type in Uploader::currentFailed.");
+			++j;
 		}
-		queue.erase(j);
 	}
+	if (queue.empty() && _streamed.empty()) {
+		sendNext();
+	}
+}
 
-	requestsSent.clear();
-	docRequestsSent.clear();
-	dcMap.clear();
-	uploadingId = FullMsgId();
-	sentSize = 0;
-	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
-		sentSizes[i] = 0;
+void Uploader::sendStreamedParts(Streamed &streamed) {
+	// Only full parts of a small file are sent, the size is not known yet
+	// and the last part is sent with the rest of the finished file.
+	const auto partSize = kDocumentUploadPartSize0;
+	while ((streamed.partsSent + 1) * partSize <= streamed.data.size()
+		&& (streamed.partsSent + 1) * partSize <= kUseBigFilesFrom) {
+		const auto index = streamed.partsSent++;
+		const auto session = chooseSession();
+		const auto requestId = MTP::send(
+			MTPupload_SaveFilePart(
+				MTP_long(streamed.id),
+				MTP_int(index),
+				MTP_bytes(streamed.data.mid(index * partSize, partSize))),
+			rpcDone(&Uploader::partLoaded),
+			rpcFail(&Uploader::partFailed),
+			MTP::uploadDcId(session));
+
+		auto request = Request();
+		request.sent = crl::now();
+		request.deliveredAtSent = _delivered;
+		request.session = session;
+		request.size = partSize;
+		request.part = index;
+		request.streamId = streamed.id;
+		_requests.emplace(requestId, request);
+
+		sentSize += partSize;
+		sentSizes[session] += partSize;
 	}
+}
 
-	sendNext();
+void Uploader::streamedPartDone(const Request &request, bool success) {
+	if (!success) {
+		// The finished file will be uploaded from the beginning.
+		cancelStreamedUpload(request.streamId);
+		return;
+	}
+	measure(request.size, crl::now() - request.sent, request.deliveredAtSent);
+}
+
+void Uploader::adoptStreamed(const FullMsgId &fullId, File &file) {
+	const auto &content = file.file->content;
+	const auto i = ranges::find_if(_streamed, [&](const Streamed &streamed) {
+		const auto size = streamed.partsSent * kDocumentUploadPartSize0;
+		return (streamed.partsSent > 0)
+			&& (content.size() >= size)
+			&& !memcmp(content.constData(), streamed.data.constData(), size);
+	});
+	if (i == end(_streamed)
+		|| file.docSize > kUseBigFilesFrom
+		|| !file.setPartSize(kDocumentUploadPartSize0)) {
+		return;
+	}
+	auto streamed = std::move(*i);
+	_streamed.erase(i);
+
+	// The reader starts after the parts sent while recording, they are
+	// only hashed here, so prepareResumable() won't change the part size.
+	const auto size = streamed.partsSent * kDocumentUploadPartSize0;
+	file.uploadId = streamed.id;
+	file.createReader();
+	file.reader->md5Hash.feed(content.constData(), size);
+	file.reader->partsRead = streamed.partsSent;
+	file.docSentParts = streamed.partsSent;
+	file.started = true;
+
+	// Parts still being sent are finished as the parts of this file.
+	for (auto &[requestId, request] : _requests) {
+		if (request.streamId == streamed.id) {
+			request.streamId = 0;
+			request.fullId = fullId;
+			++file.requestsSent;
+			++file.docRequestsSent;
+		}
+	}
+	DEBUG_LOG(("Upload Info: voice message with %1 of %2 parts uploaded "
+		"while recording."
+		).arg(streamed.partsSent
+		).arg(file.docPartsCount));
+}
+
+void Uploader::fileFailed(const FullMsgId &fullId) {
+	auto j = queue.find(fullId);
+	if (j == queue.end()) {
+		return;
+	}
+	for (auto i = _requests.begin(); i != _requests.end();) {
+		if (i->second.fullId == fullId) {
+			MTP::cancel(i->first);
+			sentSize -= i->second.size;
+			sentSizes[i->second.session] -= i->second.size;
+			i = _requests.erase(i);
+		} else {
+			++i;
+		}
+	}
+	auto node = queue.extract(j);
+	const auto &file = node.mapped();
+	if (file.resumable) {
+		forgetResumable(file.resumable);
+	}
+	if (file.type() == SendMediaType::Photo) {
+		_photoFailed.fire_copy(fullId);
+	} else if (file.type() == SendMediaType::File
+		|| file.type() == SendMediaType::ThemeFile
+		|| file.type() == SendMediaType::Audio) {
+		const auto document = Auth().data().document(file.id());
+		if (document->uploading()) {
+			document->status = FileUploadFailed;
+		}
+		_documentFailed.fire_copy(fullId);
+	} else if (file.type() == SendMediaType::Secure) {
+		_secureFailed.fire_copy(fullId);
+	} else {
+		Unexpected("Type in Uploader::fileFailed.");
+	}
 }
 
 void Uploader::stopSessions() {
@@ -249,12 +566,57 @@ void Uploader::stopSessions() {
 	}
 }
 
+int Uploader::windowSize() const {
+	if (!_bandwidth) {
+		return kInitialWindow;
+	}
+	const auto product = _bandwidth * _roundTrip / 1000;
+	return int(snap(
+		product * kWindowGain,
+		int64(kMinWindow),
+		int64(kMaxWindow)));
+}
+
+int Uploader::chooseSession() const {
+	const auto sessions = snap(
+		(windowSize() + kSessionWindow - 1) / kSessionWindow,
+		1,
+		MTP::kUploadSessionsCount);
+	auto result = 0;
+	for (auto session = 1; session != sessions; ++session) {
+		if (sentSizes[session] < sentSizes[result]) {
+			result = session;
+		}
+	}
+	return result;
+}
+
+void Uploader::measure(
+		int size,
+		crl::time duration,
+		int64 deliveredAtSent) {
+	const auto now = crl::now();
+	_delivered += size;
+	accumulate_max(duration, crl::time(1));
+	if (!_roundTrip
+		|| duration < _roundTrip
+		|| now - _roundTripMeasured > kRoundTripWindow) {
+		_roundTrip = duration;
+		_roundTripMeasured = now;
+	}
+
+	// Delivery rate over the lifetime of this request.
+	const auto rate = (_delivered - deliveredAtSent) * 1000 / duration;
+	_bandwidth = _bandwidth ? ((_bandwidth * 7 + rate) / 8) : rate;
+}
+
 void Uploader::sendNext() {
-	if (sentSize >= kMaxUploadFileParallelSize || _pausedId.msg) return;
+	if (_pausedId.msg) return;
 
+	finishReady();
 	bool stopping = stopSessionsTimer.isActive();
 	if (queue.empty()) {
-		if (!stopping) {
+		if (!stopping && _streamed.empty()) {
 			stopSessionsTimer.start(kKillSessionTimeout);
 		}
 		return;
@@ -263,203 +625,280 @@ void Uploader::sendNext() {
 	if (stopping) {
 		stopSessionsTimer.stop();
 	}
-	auto i = uploadingId.msg ? queue.find(uploadingId) : queue.begin();
-	if (!uploadingId.msg) {
-		uploadingId = i->first;
-	} else if (i == queue.end()) {
-		i = queue.begin();
-		uploadingId = i->first;
-	}
-	auto &uploadingData = i->second;
-
-	auto todc = 0;
-	for (auto dc = 1; dc != MTP::kUploadSessionsCount; ++dc) {
-		if (sentSizes[dc] < sentSizes[todc]) {
-			todc = dc;
-		}
-	}
-
-	auto &parts = uploadingData.file
-		? ((uploadingData.type() == SendMediaType::Photo
-			|| uploadingData.type() == SendMediaType::Secure)
-			? uploadingData.file->fileparts
-			: uploadingData.file->thumbparts)
-		: uploadingData.media.parts;
-	const auto partsOfId = uploadingData.file
-		? ((uploadingData.type() == SendMediaType::Photo
-			|| uploadingData.type() == SendMediaType::Secure)
-			? uploadingData.file->id
-			: uploadingData.file->thumbId)
-		: uploadingData.media.thumbId;
-	if (parts.isEmpty()) {
-		if (uploadingData.docSentParts >= uploadingData.docPartsCount) {
-			if (requestsSent.empty() && docRequestsSent.empty()) {
-				const auto options = uploadingData.file
-					? uploadingData.file->to.options
-					: Api::SendOptions();
-				const auto edit = uploadingData.file &&
-					uploadingData.file->edit;
-				if (uploadingData.type() == SendMediaType::Photo) {
-					auto photoFilename = uploadingData.filename();
-					if (!photoFilename.endsWith(qstr(".jpg"), Qt::CaseInsensitive)) {
-						// Server has some extensions checking for inputMediaUploadedPhoto,
-						// so force the extension to be .jpg anyway. It doesn't matter,
-						// because the filename from inputFile is not used anywhere.
-						photoFilename += qstr(".jpg");
-					}
-					const auto md5 = uploadingData.file
-						? uploadingData.file->filemd5
-						: uploadingData.media.jpeg_md5;
-					const auto file = MTP_inputFile(
-						MTP_long(uploadingData.id()),
-						MTP_int(uploadingData.partsCount),
-						MTP_string(photoFilename),
-						MTP_bytes(md5));
-					_photoReady.fire({ uploadingId, options, file, edit });
-				} else if (uploadingData.type() == SendMediaType::File
-					|| uploadingData.type() == SendMediaType::ThemeFile
-					|| uploadingData.type() == SendMediaType::Audio) {
-					QByteArray docMd5(32, Qt::Uninitialized);
-					hashMd5Hex(uploadingData.md5Hash.result(), docMd5.data());
-
-					const auto file = (uploadingData.docSize > kUseBigFilesFrom)
-						? MTP_inputFileBig(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
-							MTP_string(uploadingData.filename()))
-						: MTP_inputFile(
-							MTP_long(uploadingData.id()),
-							MTP_int(uploadingData.docPartsCount),
-							MTP_string(uploadingData.filename()),
-							MTP_bytes(docMd5));
-					if (uploadingData.partsCount) {
-						const auto thumbFilename = uploadingData.file
-							? uploadingData.file->thumbname
-							: (qsl("thumb.") + uploadingData.media.thumbExt);
-						const auto thumbMd5 = uploadingData.file
-							? uploadingData.file->thumbmd5
-							: uploadingData.media.jpeg_md5;
-						const auto thumb = MTP_inputFile(
-							MTP_long(uploadingData.thumbId()),
-							MTP_int(uploadingData.partsCount),
-							MTP_string(thumbFilename),
-							MTP_bytes(thumbMd5));
-						_thumbDocumentReady.fire({
-							uploadingId,
-							options,
-							file,
-							thumb,
-							edit });
-					} else {
-						_documentReady.fire({
-							uploadingId,
-							options,
-							file,
-							edit });
-					}
-				} else if (uploadingData.type() == SendMediaType::Secure) {
-					_secureReady.fire({
-						uploadingId,
-						uploadingData.id(),
-						uploadingData.partsCount });
-				}
-				queue.erase(uploadingId);
-				uploadingId = FullMsgId();
-				sendNext();
+
+	auto active = std::vector<FullMsgId>();
+	active.reserve(kMaxUploadingFiles);
+	for (auto &[fullId, file] : queue) {
+		if (!file.ready) {
+			active.push_back(fullId);
+			if (active.size() == kMaxUploadingFiles) {
+				break;
 			}
-			return;
 		}
+	}
 
-		auto &content = uploadingData.file
-			? uploadingData.file->content
-			: uploadingData.media.data;
-		QByteArray toSend;
-		if (content.isEmpty()) {
-			if (!uploadingData.docFile) {
-				const auto filepath = uploadingData.file
-					? uploadingData.file->filepath
-					: uploadingData.media.file;
-				uploadingData.docFile = std::make_unique<QFile>(filepath);
-				if (!uploadingData.docFile->open(QIODevice::ReadOnly)) {
-					currentFailed();
-					return;
-				}
-			}
-			toSend = uploadingData.docFile->read(uploadingData.docPartSize);
-			if (uploadingData.docSize <= kUseBigFilesFrom) {
-				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
-			}
-		} else {
-			const auto offset = uploadingData.docSentParts
-				* uploadingData.docPartSize;
-			toSend = content.mid(offset, uploadingData.docPartSize);
-			if ((uploadingData.type() == SendMediaType::File
-				|| uploadingData.type() == SendMediaType::ThemeFile
-				|| uploadingData.type() == SendMediaType::Audio)
-				&& uploadingData.docSentParts <= kUseBigFilesFrom) {
-				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
+	// Send parts of all active files in turns while the window allows.
+	const auto window = windowSize();
+	for (auto sent = true; sent && sentSize < window;) {
+		sent = false;
+		for (const auto &fullId : active) {
+			const auto i = queue.find(fullId);
+			if (i != queue.end()
+				&& sentSize < window
+				&& sendPart(fullId, i->second)) {
+				sent = true;
 			}
 		}
-		if ((toSend.size() > uploadingData.docPartSize)
-			|| ((toSend.size() < uploadingData.docPartSize
-				&& uploadingData.docSentParts + 1 != uploadingData.docPartsCount))) {
-			currentFailed();
-			return;
+	}
+
+	// Files are reported in the queue order to keep the messages order.
+	auto finished = false;
+	for (const auto &fullId : active) {
+		const auto i = queue.find(fullId);
+		if (i != queue.end() && i->second.uploaded()) {
+			i->second.ready = finished = true;
+		}
+	}
+	if (finished) {
+		sendNext();
+		return;
+	}
+	nextTimer.start(kUploadRequestInterval);
+}
+
+void Uploader::finishReady() {
+	while (!queue.empty() && queue.begin()->second.ready) {
+		auto node = queue.extract(queue.begin());
+		fileReady(node.key(), node.mapped());
+	}
+}
+
+void Uploader::fileReady(const FullMsgId &fullId, File &file) {
+	const auto options = file.file
+		? file.file->to.options
+		: Api::SendOptions();
+	const auto edit = file.file && file.file->edit;
+	if (file.type() == SendMediaType::Photo) {
+		auto photoFilename = file.filename();
+		if (!photoFilename.endsWith(qstr(".jpg"), Qt::CaseInsensitive)) {
+			// Server has some extensions checking for inputMediaUploadedPhoto,
+			// so force the extension to be .jpg anyway. It doesn't matter,
+			// because the filename from inputFile is not used anywhere.
+			photoFilename += qstr(".jpg");
+		}
+		const auto md5 = file.file
+			? file.file->filemd5
+			: file.media.jpeg_md5;
+		const auto result = MTP_inputFile(
+			MTP_long(file.id()),
+			MTP_int(file.partsCount),
+			MTP_string(photoFilename),
+			MTP_bytes(md5));
+		_photoReady.fire({ fullId, options, result, edit });
+	} else if (file.type() == SendMediaType::File
+		|| file.type() == SendMediaType::ThemeFile
+		|| file.type() == SendMediaType::Audio) {
+		if (!file.reader) {
+			file.createReader();
+		}
+		QByteArray docMd5(32, Qt::Uninitialized);
+		hashMd5Hex(file.reader->md5Hash.result(), docMd5.data());
+
+		if (file.resumable) {
+			forgetResumable(file.resumable);
 		}
-		mtpRequestId requestId;
-		if (uploadingData.docSize > kUseBigFilesFrom) {
-			requestId = MTP::send(
-				MTPupload_SaveBigFilePart(
-					MTP_long(uploadingData.id()),
-					MTP_int(uploadingData.docSentParts),
-					MTP_int(uploadingData.docPartsCount),
-					MTP_bytes(toSend)),
-				rpcDone(&Uploader::partLoaded),
-				rpcFail(&Uploader::partFailed),
-				MTP::uploadDcId(todc));
+		const auto result = (file.docSize > kUseBigFilesFrom)
+			? MTP_inputFileBig(
+				MTP_long(file.uploadId),
+				MTP_int(file.docPartsCount),
+				MTP_string(file.filename()))
+			: MTP_inputFile(
+				MTP_long(file.uploadId),
+				MTP_int(file.docPartsCount),
+				MTP_string(file.filename()),
+				MTP_bytes(docMd5));
+		if (file.partsCount) {
+			const auto thumbFilename = file.file
+				? file.file->thumbname
+				: (qsl("thumb.") + file.media.thumbExt);
+			const auto thumbMd5 = file.file
+				? file.file->thumbmd5
+				: file.media.jpeg_md5;
+			const auto thumb = MTP_inputFile(
+				MTP_long(file.thumbId()),
+				MTP_int(file.partsCount),
+				MTP_string(thumbFilename),
+				MTP_bytes(thumbMd5));
+			_thumbDocumentReady.fire({
+				fullId,
+				options,
+				result,
+				thumb,
+				edit });
 		} else {
-			requestId = MTP::send(
-				MTPupload_SaveFilePart(
-					MTP_long(uploadingData.id()),
-					MTP_int(uploadingData.docSentParts),
-					MTP_bytes(toSend)),
-				rpcDone(&Uploader::partLoaded),
-				rpcFail(&Uploader::partFailed),
-				MTP::uploadDcId(todc));
-		}
-		docRequestsSent.emplace(requestId, uploadingData.docSentParts);
-		dcMap.emplace(requestId, todc);
-		sentSize += uploadingData.docPartSize;
-		sentSizes[todc] += uploadingData.docPartSize;
-
-		uploadingData.docSentParts++;
-	} else {
+			_documentReady.fire({
+				fullId,
+				options,
+				result,
+				edit });
+		}
+	} else if (file.type() == SendMediaType::Secure) {
+		_secureReady.fire({
+			fullId,
+			file.id(),
+			file.partsCount });
+	}
+}
+
+bool Uploader::sendPart(const FullMsgId &fullId, File &file) {
+	auto &parts = file.parts();
+	const auto session = chooseSession();
+	if (!parts.isEmpty()) {
 		auto part = parts.begin();
 
 		const auto requestId = MTP::send(
 			MTPupload_SaveFilePart(
-				MTP_long(partsOfId),
+				MTP_long(file.partsOfId()),
 				MTP_int(part.key()),
 				MTP_bytes(part.value())),
 			rpcDone(&Uploader::partLoaded),
 			rpcFail(&Uploader::partFailed),
-			MTP::uploadDcId(todc));
-		requestsSent.emplace(requestId, part.value());
-		dcMap.emplace(requestId, todc);
-		sentSize += part.value().size();
-		sentSizes[todc] += part.value().size();
+			MTP::uploadDcId(session));
+		partSent(
+			requestId,
+			fullId,
+			file,
+			session,
+			part.value().size(),
+			-1);
 
 		parts.erase(part);
+		return true;
+	} else if (!file.docPartsCount) {
+		return false;
+	} else if (!file.reader) {
+		prepareResumable(file);
+		file.createReader();
 	}
-	nextTimer.start(kUploadRequestInterval);
+	if (file.docSentParts >= file.docPartsCount) {
+		return false;
+	} else if (file.readParts.empty()) {
+		startReading(fullId, file);
+		return false;
+	}
+	const auto part = std::move(file.readParts.front());
+	file.readParts.pop_front();
+	startReading(fullId, file);
+
+	mtpRequestId requestId;
+	if (file.docSize > kUseBigFilesFrom) {
+		requestId = MTP::send(
+			MTPupload_SaveBigFilePart(
+				MTP_long(file.uploadId),
+				MTP_int(part.index),
+				MTP_int(file.docPartsCount),
+				MTP_bytes(part.bytes)),
+			rpcDone(&Uploader::partLoaded),
+			rpcFail(&Uploader::partFailed),
+			MTP::uploadDcId(session));
+	} else {
+		requestId = MTP::send(
+			MTPupload_SaveFilePart(
+				MTP_long(file.uploadId),
+				MTP_int(part.index),
+				MTP_bytes(part.bytes)),
+			rpcDone(&Uploader::partLoaded),
+			rpcFail(&Uploader::partFailed),
+			MTP::uploadDcId(session));
+	}
+	partSent(requestId, fullId, file, session, file.docPartSize, part.index);
+
+	file.docSentParts++;
+	return true;
+}
+
+void Uploader::partSent(
+		mtpRequestId requestId,
+		const FullMsgId &fullId,
+		File &file,
+		int session,
+		int size,
+		int part) {
+	auto request = Request();
+	request.fullId = fullId;
+	request.sent = crl::now();
+	request.deliveredAtSent = _delivered;
+	request.session = session;
+	request.size = size;
+	request.part = part;
+	_requests.emplace(requestId, request);
+
+	sentSize += size;
+	sentSizes[session] += size;
+	++file.requestsSent;
+	if (part >= 0) {
+		++file.docRequestsSent;
+	}
+	file.started = true;
+}
+
+void Uploader::startReading(const FullMsgId &fullId, File &file) {
+	if (file.reading) {
+		return;
+	}
+	const auto buffered = int(file.readParts.size()) * file.docPartSize;
+	const auto left = file.docPartsCount
+		- file.docSentParts
+		- int(file.readParts.size());
+	if (left <= 0 || buffered >= kReadAheadSize) {
+		return;
+	}
+	const auto count = std::min(
+		left,
+		std::max((kReadAheadSize - buffered) / file.docPartSize, 1));
+	file.reading = file.started = true;
+
+	const auto weak = Ui::MakeWeak(this);
+	crl::async([=, reader = file.reader] {
+		const auto success = reader->read(count);
+		crl::on_main(weak, [=] {
+			partsRead(fullId, reader.get(), success);
+		});
+	});
+}
+
+void Uploader::partsRead(
+		const FullMsgId &fullId,
+		not_null<const Reader*> reader,
+		bool success) {
+	const auto i = queue.find(fullId);
+	if (i == queue.end() || i->second.reader.get() != reader) {
+		return;
+	}
+	auto &file = i->second;
+	file.reading = false;
+	if (!success) {
+		fileFailed(fullId);
+	} else {
+		for (auto &part : base::take(file.reader->result)) {
+			file.readParts.push_back(std::move(part));
+		}
+	}
+	sendNext();
 }
 
 void Uploader::cancel(const FullMsgId &msgId) {
 	uploaded.erase(msgId);
-	if (uploadingId == msgId) {
-		currentFailed();
+	const auto i = queue.find(msgId);
+	if (i == queue.end()) {
+		return;
+	} else if (i->second.started) {
+		// Keep the parts uploaded so far for the same file sent again.
+		i->second.resumable = nullptr;
+		fileFailed(msgId);
+		sendNext();
 	} else {
-		queue.erase(msgId);
+		queue.erase(i);
 	}
 }
 
@@ -478,15 +917,11 @@ void Uploader::confirm(const FullMsgId &msgId) {
 void Uploader::clear() {
 	uploaded.clear();
 	queue.clear();
-	for (const auto &requestData : requestsSent) {
-		MTP::cancel(requestData.first);
+	_streamed.clear();
+	for (const auto &[requestId, request] : _requests) {
+		MTP::cancel(requestId);
 	}
-	requestsSent.clear();
-	for (const auto &requestData : docRequestsSent) {
-		MTP::cancel(requestData.first);
-	}
-	docRequestsSent.clear();
-	dcMap.clear();
+	_requests.clear();
 	sentSize = 0;
 	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
@@ -496,65 +931,67 @@ void Uploader::clear() {
 }
 
 void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
-	auto j = docRequestsSent.end();
-	auto i = requestsSent.find(requestId);
-	if (i == requestsSent.cend()) {
-		j = docRequestsSent.find(requestId);
-	}
-	if (i != requestsSent.cend() || j != docRequestsSent.cend()) {
-		if (mtpIsFalse(result)) { // failed to upload current file
-			currentFailed();
-			return;
-		} else {
-			auto dcIt = dcMap.find(requestId);
-			if (dcIt == dcMap.cend()) { // must not happen
-				currentFailed();
-				return;
-			}
-			auto dc = dcIt->second;
-			dcMap.erase(dcIt);
-
-			int32 sentPartSize = 0;
-			auto k = queue.find(uploadingId);
-			Assert(k != queue.cend());
-			auto &[fullId, file] = *k;
-			if (i != requestsSent.cend()) {
-				sentPartSize = i->second.size();
-				requestsSent.erase(i);
-			} else {
-				sentPartSize = file.docPartSize;
-				docRequestsSent.erase(j);
-			}
-			sentSize -= sentPartSize;
-			sentSizes[dc] -= sentPartSize;
-			if (file.type() == SendMediaType::Photo) {
-				file.fileSentSize += sentPartSize;
-				const auto photo = Auth().data().photo(file.id());
-				if (photo->uploading() && file.file) {
-					photo->uploadingData->size = file.file->partssize;
-					photo->uploadingData->offset = file.fileSentSize;
-				}
-				_photoProgress.fire_copy(fullId);
-			} else if (file.type() == SendMediaType::File
-				|| file.type() == SendMediaType::ThemeFile
-				|| file.type() == SendMediaType::Audio) {
-				const auto document = Auth().data().document(file.id());
-				if (document->uploading()) {
-					const auto doneParts = file.docSentParts
-						- int(docRequestsSent.size());
-					document->uploadingData->offset = std::min(
-						document->uploadingData->size,
-						doneParts * file.docPartSize);
-				}
-				_documentProgress.fire_copy(fullId);
-			} else if (file.type() == SendMediaType::Secure) {
-				file.fileSentSize += sentPartSize;
-				_secureProgress.fire_copy({
-					fullId,
-					file.fileSentSize,
-					file.file->partssize });
-			}
+	const auto i = _requests.find(requestId);
+	if (i == _requests.end()) {
+		sendNext();
+		return;
+	}
+	const auto request = i->second;
+	_requests.erase(i);
+	sentSize -= request.size;
+	sentSizes[request.session] -= request.size;
+	if (request.streamId) {
+		streamedPartDone(request, mtpIsTrue(result));
+		return;
+	}
+
+	const auto k = queue.find(request.fullId);
+	Assert(k != queue.end());
+	auto &[fullId, file] = *k;
+	--file.requestsSent;
+	if (request.part >= 0) {
+		--file.docRequestsSent;
+	}
+	if (mtpIsFalse(result)) { // failed to upload current file
+		fileFailed(fullId);
+		sendNext();
+		return;
+	}
+	measure(request.size, crl::now() - request.sent, request.deliveredAtSent);
+	if (file.resumable && request.part >= 0) {
+		file.resumable->acknowledged[request.part] = true;
+		file.resumable->saved = base::unixtime::now();
+		if (!_saveResumableTimer.isActive()) {
+			_saveResumableTimer.callOnce(kSaveResumableDelay);
+		}
+	}
+
+	if (file.type() == SendMediaType::Photo) {
+		file.fileSentSize += request.size;
+		const auto photo = Auth().data().photo(file.id());
+		if (photo->uploading() && file.file) {
+			photo->uploadingData->size = file.file->partssize;
+			photo->uploadingData->offset = file.fileSentSize;
 		}
+		_photoProgress.fire_copy(fullId);
+	} else if (file.type() == SendMediaType::File
+		|| file.type() == SendMediaType::ThemeFile
+		|| file.type() == SendMediaType::Audio) {
+		const auto document = Auth().data().document(file.id());
+		if (document->uploading()) {
+			const auto doneParts = file.docSentParts
+				- file.docRequestsSent;
+			document->uploadingData->offset = std::min(
+				document->uploadingData->size,
+				doneParts * file.docPartSize);
+		}
+		_documentProgress.fire_copy(fullId);
+	} else if (file.type() == SendMediaType::Secure) {
+		file.fileSentSize += request.size;
+		_secureProgress.fire_copy({
+			fullId,
+			file.fileSentSize,
+			file.file->partssize });
 	}
 
 	sendNext();
@@ -564,15 +1001,181 @@ bool Uploader::partFailed(const RPCError &error, mtpRequestId requestId) {
 	if (MTP::isDefaultHandledError(error)) return false;
 
 	// failed to upload current file
-	if ((requestsSent.find(requestId) != requestsSent.cend())
-		|| (docRequestsSent.find(requestId) != docRequestsSent.cend())) {
-		currentFailed();
+	const auto i = _requests.find(requestId);
+	if (i != _requests.end() && i->second.streamId) {
+		const auto request = i->second;
+		sentSize -= request.size;
+		sentSizes[request.session] -= request.size;
+		_requests.erase(i);
+		streamedPartDone(request, false);
+		return true;
+	} else if (i != _requests.end()) {
+		const auto fullId = i->second.fullId;
+		sentSize -= i->second.size;
+		sentSizes[i->second.session] -= i->second.size;
+		_requests.erase(i);
+		fileFailed(fullId);
 	}
 	sendNext();
 	return true;
 }
 
+void Uploader::loadResumable() {
+	const auto serialized = Local::ReadUploadsResumeState();
+	if (serialized.isEmpty()) {
+		return;
+	}
+	QDataStream stream(serialized);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto count = qint32();
+	stream >> count;
+	for (auto i = 0; i < count; ++i) {
+		auto filepath = QString();
+		auto size = qint32();
+		auto modified = qint64();
+		auto fileId = quint64();
+		auto partSize = qint32();
+		auto saved = qint32();
+		auto bits = QByteArray();
+		stream
+			>> filepath
+			>> size
+			>> modified
+			>> fileId
+			>> partSize
+			>> saved
+			>> bits;
+		if (stream.status() != QDataStream::Ok) {
+			LOG(("Upload Error: bad resumable uploads state."));
+			_resumable.clear();
+			return;
+		} else if (partSize <= 0 || size <= 0) {
+			continue;
+		}
+		const auto partsCount = (size + partSize - 1) / partSize;
+		if (bits.size() * 8 < partsCount) {
+			continue;
+		}
+		auto resumable = std::make_shared<Resumable>();
+		resumable->filepath = filepath;
+		resumable->size = size;
+		resumable->modified = modified;
+		resumable->fileId = fileId;
+		resumable->partSize = partSize;
+		resumable->saved = saved;
+		resumable->acknowledged.resize(partsCount);
+		for (auto part = 0; part != partsCount; ++part) {
+			resumable->acknowledged[part]
+				= (bits[part / 8] & (1 << (part % 8))) != 0;
+		}
+		_resumable.push_back(std::move(resumable));
+	}
+}
+
+void Uploader::saveResumable() {
+	_saveResumableTimer.cancel();
+
+	const auto now = base::unixtime::now();
+	_resumable.erase(ranges::remove_if(_resumable, [&](const auto &value) {
+		return (now - value->saved > kResumeTimeout);
+	}), end(_resumable));
+	if (_resumable.empty()) {
+		Local::WriteUploadsResumeState(QByteArray());
+		return;
+	}
+
+	auto serialized = QByteArray();
+	{
+		QDataStream stream(&serialized, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream << qint32(_resumable.size());
+		for (const auto &resumable : _resumable) {
+			const auto &acknowledged = resumable->acknowledged;
+			auto bits = QByteArray((acknowledged.size() + 7) / 8, 0);
+			for (auto part = 0; part != int(acknowledged.size()); ++part) {
+				if (acknowledged[part]) {
+					bits[part / 8] |= char(1 << (part % 8));
+				}
+			}
+			stream
+				<< resumable->filepath
+				<< qint32(resumable->size)
+				<< qint64(resumable->modified)
+				<< quint64(resumable->fileId)
+				<< qint32(resumable->partSize)
+				<< qint32(resumable->saved)
+				<< bits;
+		}
+	}
+	Local::WriteUploadsResumeState(serialized);
+}
+
+void Uploader::prepareResumable(File &file) {
+	const auto filepath = file.file ? file.file->filepath : file.media.file;
+	const auto &content = file.file ? file.file->content : file.media.data;
+	if (file.docSize <= kUseBigFilesFrom
+		|| filepath.isEmpty()
+		|| !content.isEmpty()) {
+		file.choosePartSize(windowSize());
+		return;
+	}
+	const auto modified = QFileInfo(filepath).lastModified();
+	const auto modifiedMs = modified.toMSecsSinceEpoch();
+	const auto now = base::unixtime::now();
+	for (const auto &resumable : _resumable) {
+		// The state is shared with a file uploading right now.
+		const auto used = (resumable.use_count() > 1);
+		if (!used
+			&& resumable->filepath == filepath
+			&& resumable->size == file.docSize
+			&& resumable->modified == modifiedMs
+			&& now - resumable->saved <= kResumeTimeout
+			&& file.setPartSize(resumable->partSize)
+			&& file.docPartsCount == int(resumable->acknowledged.size())) {
+			file.uploadId = resumable->fileId;
+			file.docSentParts = int(ranges::count(
+				resumable->acknowledged,
+				true));
+			file.resumable = resumable;
+			LOG(("Upload Info: resuming %1 with %2 of %3 parts uploaded."
+				).arg(filepath
+				).arg(file.docSentParts
+				).arg(file.docPartsCount));
+			return;
+		}
+	}
+	file.setDocSize(file.docSize);
+	file.choosePartSize(windowSize());
+
+	auto resumable = std::make_shared<Resumable>();
+	resumable->filepath = filepath;
+	resumable->size = file.docSize;
+	resumable->modified = modifiedMs;
+	resumable->fileId = file.uploadId;
+	resumable->partSize = file.docPartSize;
+	resumable->saved = now;
+	resumable->acknowledged.resize(file.docPartsCount);
+	file.resumable = resumable;
+	_resumable.push_back(std::move(resumable));
+	while (_resumable.size() > kMaxResumableCount) {
+		_resumable.erase(begin(_resumable));
+	}
+}
+
+void Uploader::forgetResumable(
+		const std::shared_ptr<Resumable> &resumable) {
+	const auto i = ranges::find(_resumable, resumable);
+	if (i != end(_resumable)) {
+		_resumable.erase(i);
+		_saveResumableTimer.callOnce(kSaveResumableDelay);
+	}
+}
+
 Uploader::~Uploader() {
+	if (_saveResumableTimer.isActive()) {
+		saveResumable();
+	}
 	clear();
 }
 
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "api/api_common.h"
 #include "mtproto/facade.h"
+#include "base/timer.h"
 
 #include <QtCore/QTimer>
 
@@ -67,6 +68,12 @@ public:
 		const FullMsgId &msgId,
 		const std::shared_ptr<FileLoadResult> &file);
 
+	// Voice messages are uploaded in parts while they are recorded and
+	// the parts are reused when the finished file is uploaded.
+	[[nodiscard]] uint64 startStreamedUpload();
+	void appendStreamedUpload(uint64 id, const QByteArray &bytes);
+	void cancelStreamedUpload(uint64 id);
+
 	void cancel(const FullMsgId &msgId);
 	void pause(const FullMsgId &msgId);
 	void confirm(const FullMsgId &msgId);
@@ -111,20 +118,61 @@ public slots:
 
 private:
 	struct File;
+	struct Request;
+	struct Reader;
+	struct Resumable;
+	struct Streamed;
 
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	bool partFailed(const RPCError &err, mtpRequestId requestId);
 
-	void currentFailed();
+	[[nodiscard]] int windowSize() const;
+	[[nodiscard]] int chooseSession() const;
+	bool sendPart(const FullMsgId &fullId, File &file);
+	void partSent(
+		mtpRequestId requestId,
+		const FullMsgId &fullId,
+		File &file,
+		int session,
+		int size,
+		int part);
+	void startReading(const FullMsgId &fullId, File &file);
+	void partsRead(
+		const FullMsgId &fullId,
+		not_null<const Reader*> reader,
+		bool success);
+	void measure(int size, crl::time duration, int64 deliveredAtSent);
+
+	void finishReady();
+	void fileReady(const FullMsgId &fullId, File &file);
+	void fileFailed(const FullMsgId &fullId);
+
+	void loadResumable();
+	void saveResumable();
+	void prepareResumable(File &file);
+	void forgetResumable(const std::shared_ptr<Resumable> &resumable);
+
+	void sendStreamedParts(Streamed &streamed);
+	void streamedPartDone(const Request &request, bool success);
+	void adoptStreamed(const FullMsgId &fullId, File &file);
 
 	not_null<ApiWrap*> _api;
-	base::flat_map<mtpRequestId, QByteArray> requestsSent;
-	base::flat_map<mtpRequestId, int32> docRequestsSent;
-	base::flat_map<mtpRequestId, int32> dcMap;
-	uint32 sentSize = 0;
-	uint32 sentSizes[MTP::kUploadSessionsCount] = { 0 };
+	base::flat_map<mtpRequestId, Request> _requests;
+	int sentSize = 0;
+	int sentSizes[MTP::kUploadSessionsCount] = { 0 };
+
+	// Delivery rate and round trip of the parts, they size the window.
+	int64 _delivered = 0;
+	int64 _bandwidth = 0; // Bytes per second.
+	crl::time _roundTrip = 0;
+	crl::time _roundTripMeasured = 0;
+
+	// Big file uploads that can be continued after a relaunch.
+	std::vector<std::shared_ptr<Resumable>> _resumable;
+	base::Timer _saveResumableTimer;
+
+	std::vector<Streamed> _streamed;
 
-	FullMsgId uploadingId;
 	FullMsgId _pausedId;
 	std::map<FullMsgId, File> queue;
 	std::map<FullMsgId, File> uploaded;
@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/unixtime.h"
 #include "media/audio/media_audio.h"
 #include "media/clip/media_clip_reader.h"
+#include "media/clip/media_clip_check_streaming.h"
 #include "lottie/lottie_animation.h"
 #include "history/history_item.h"
 #include "boxes/send_files_box.h"
@@ -29,6 +30,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "app.h"
 
 #include <QtCore/QBuffer>
+#include <QtCore/QDir>
 
 namespace {
 
@@ -241,7 +243,12 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 		0);
 }
 
-TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+TaskQueue::TaskQueue(
+	crl::time stopTimeoutMs,
+	QThread::Priority priority,
+	int workersCount)
+: _priority(priority)
+, _workersCount(std::max(workersCount, 1)) {
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -253,7 +260,9 @@ TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
 TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 	const auto result = task->id();
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
+		QMutexLocker lockToProcess(&_tasksToProcessMutex);
+		QMutexLocker lockToFinish(&_tasksToFinishMutex);
+		_tasksOrder.push_back(result);
 		_tasksToProcess.push_back(std::move(task));
 	}
 
@@ -264,8 +273,10 @@ TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 
 void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
+		QMutexLocker lockToProcess(&_tasksToProcessMutex);
+		QMutexLocker lockToFinish(&_tasksToFinishMutex);
 		for (auto &task : tasks) {
+			_tasksOrder.push_back(task->id());
 			_tasksToProcess.push_back(std::move(task));
 		}
 	}
@@ -274,40 +285,59 @@ void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 }
 
 void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
-
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
-
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
-
-		_thread->start();
+	if (_threads.empty()) {
+		for (auto i = 0; i != _workersCount; ++i) {
+			const auto thread = new QThread();
+			const auto worker = new TaskQueueWorker(this);
+			worker->moveToThread(thread);
+
+			connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+			connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+
+			thread->start(_priority);
+			_threads.push_back(thread);
+			_workers.push_back(worker);
+		}
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
 }
 
 void TaskQueue::cancelTask(TaskId id) {
-	const auto removeFrom = [&](std::deque<std::unique_ptr<Task>> &queue) {
+	{
+		QMutexLocker lock(&_tasksToProcessMutex);
 		const auto proj = [](const std::unique_ptr<Task> &task) {
 			return task->id();
 		};
-		auto i = ranges::find(queue, id, proj);
-		if (i != queue.end()) {
-			queue.erase(i);
+		auto i = ranges::find(_tasksToProcess, id, proj);
+		if (i != _tasksToProcess.end()) {
+			_tasksToProcess.erase(i);
 		}
-	};
+		_tasksInProcess.remove(id);
+	}
+	auto task = std::unique_ptr<Task>();
+	auto unblocked = false;
 	{
-		QMutexLocker lock(&_tasksToProcessMutex);
-		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
+		QMutexLocker lock(&_tasksToFinishMutex);
+		_tasksOrder.erase(
+			ranges::remove(_tasksOrder, id),
+			_tasksOrder.end());
+		const auto i = _tasksToFinish.find(id);
+		if (i != _tasksToFinish.end()) {
+			task = std::move(i->second);
+			_tasksToFinish.erase(i);
 		}
+		unblocked = !_tasksOrder.empty()
+			&& _tasksToFinish.contains(_tasksOrder.front());
+	}
+
+	// A cancelled task might have blocked the ones processed after it.
+	if (unblocked) {
+		QMetaObject::invokeMethod(
+			this,
+			"onTaskProcessed",
+			Qt::QueuedConnection);
 	}
-	QMutexLocker lock(&_tasksToFinishMutex);
-	removeFrom(_tasksToFinish);
 }
 
 void TaskQueue::onTaskProcessed() {
@@ -315,33 +345,45 @@ void TaskQueue::onTaskProcessed() {
 		auto task = std::unique_ptr<Task>();
 		{
 			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			if (_tasksOrder.empty()) break;
+			const auto i = _tasksToFinish.find(_tasksOrder.front());
+			if (i == _tasksToFinish.end()) break;
+			task = std::move(i->second);
+			_tasksToFinish.erase(i);
+			_tasksOrder.pop_front();
 		}
 		task->finish();
 	} while (true);
 
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && _tasksInProcess.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
+	for (const auto thread : _threads) {
+		thread->requestInterruption();
+		thread->quit();
+	}
+	if (!_threads.empty()) {
 		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+	}
+	for (const auto thread : _threads) {
+		thread->wait();
+	}
+	for (const auto worker : base::take(_workers)) {
+		delete worker;
+	}
+	for (const auto thread : base::take(_threads)) {
+		delete thread;
 	}
 	_tasksToProcess.clear();
+	_tasksInProcess.clear();
+	_tasksOrder.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
 }
 
 TaskQueue::~TaskQueue() {
@@ -361,7 +403,7 @@ void TaskQueueWorker::onTaskAdded() {
 			if (!_queue->_tasksToProcess.empty()) {
 				task = std::move(_queue->_tasksToProcess.front());
 				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+				_queue->_tasksInProcess.emplace(task->id());
 			}
 		}
 
@@ -370,13 +412,16 @@ void TaskQueueWorker::onTaskAdded() {
 			bool emitTaskProcessed = false;
 			{
 				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
-					someTasksLeft = !_queue->_tasksToProcess.empty();
+				someTasksLeft = !_queue->_tasksToProcess.empty();
+				const auto id = task->id();
+				const auto i = _queue->_tasksInProcess.find(id);
+				if (i != _queue->_tasksInProcess.end()) {
+					_queue->_tasksInProcess.erase(i);
 
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
-					_queue->_tasksToFinish.push_back(std::move(task));
+					emitTaskProcessed = !_queue->_tasksOrder.empty()
+						&& (_queue->_tasksOrder.front() == id);
+					_queue->_tasksToFinish.emplace(id, std::move(task));
 				}
 			}
 			if (emitTaskProcessed) {
@@ -447,6 +492,12 @@ FileLoadResult::FileLoadResult(
 , caption(caption) {
 }
 
+FileLoadResult::~FileLoadResult() {
+	if (!uploadpath.isEmpty()) {
+		QFile::remove(uploadpath);
+	}
+}
+
 void FileLoadResult::setFileData(const QByteArray &filedata) {
 	if (filedata.isEmpty()) {
 		partssize = 0;
@@ -801,6 +852,17 @@ void FileLoadTask::process() {
 			if (video->isGifv && !_album) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			}
+			if (!video->supportsStreaming && !_filepath.isEmpty()) {
+				// Move the moov atom to the front of a temporary copy,
+				// so that the video can be played while downloading.
+				const auto path = cTempDir()
+					+ qsl("upload_%1.mp4").arg(_id, 0, 16);
+				if (QDir().mkpath(cTempDir())
+					&& Media::Clip::MakeFaststartCopy(_filepath, path)) {
+					_result->uploadpath = path;
+					video->supportsStreaming = true;
+				}
+			}
 			auto flags = MTPDdocumentAttributeVideo::Flags(0);
 			if (video->supportsStreaming) {
 				flags |= MTPDdocumentAttributeVideo::Flag::f_supports_streaming;
@@ -854,15 +916,18 @@ void FileLoadTask::process() {
 			} else if (isAnimation) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != SendMediaType::File) {
-				auto thumb = (w > 100 || h > 100) ? fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				// Scale the full size image only once, each smaller size
+				// is scaled from the previous one instead of the original.
+				auto full = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				auto medium = (full.width() > 320 || full.height() > 320) ? full.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : full;
+				auto thumb = (medium.width() > 100 || medium.height() > 100) ? medium.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : medium;
+
 				photoThumbs.emplace('s', thumb);
 				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
 
-				auto medium = (w > 320 || h > 320) ? fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('m', medium);
 				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
 
-				auto full = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('y', full);
 				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
 
@@ -883,6 +948,9 @@ void FileLoadTask::process() {
 				if (filesize < 0) {
 					filesize = _result->filesize = filedata.size();
 				}
+
+				// The document thumbnail has the same size as the medium.
+				fullimage = std::move(medium);
 			}
 			thumbnail = PrepareFileThumbnail(std::move(fullimage));
 		}
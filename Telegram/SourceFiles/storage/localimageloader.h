@@ -101,11 +101,18 @@ public:
 };
 
 class TaskQueueWorker;
+
+// Tasks are processed by one or several worker threads, but finish()
+// is always called in the order the tasks were added, because sending
+// files and albums depends on it.
 class TaskQueue : public QObject {
 	Q_OBJECT
 
 public:
-	explicit TaskQueue(crl::time stopTimeoutMs = 0); // <= 0 - never stop worker
+	explicit TaskQueue(
+		crl::time stopTimeoutMs = 0, // <= 0 - never stop worker
+		QThread::Priority priority = QThread::InheritPriority,
+		int workersCount = 1);
 
 	TaskId addTask(std::unique_ptr<Task> &&task);
 	void addTasks(std::vector<std::unique_ptr<Task>> &&tasks);
@@ -126,11 +133,18 @@ private:
 	void wakeThread();
 
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
-	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+	base::flat_set<TaskId> _tasksInProcess;
+	QMutex _tasksToProcessMutex;
+
+	// Ids of all added and not finished tasks in the order of adding.
+	std::deque<TaskId> _tasksOrder;
+	base::flat_map<TaskId, std::unique_ptr<Task>> _tasksToFinish;
+	QMutex _tasksToFinishMutex;
+
+	std::vector<QThread*> _threads;
+	std::vector<TaskQueueWorker*> _workers;
+	QThread::Priority _priority = QThread::InheritPriority;
+	int _workersCount = 1;
 	QTimer *_stopTimer = nullptr;
 
 };
@@ -198,6 +212,7 @@ struct FileLoadResult {
 		const FileLoadTo &to,
 		const TextWithTags &caption,
 		std::shared_ptr<SendingAlbum> album);
+	~FileLoadResult();
 
 	TaskId taskId;
 	uint64 id;
@@ -207,6 +222,10 @@ struct FileLoadResult {
 	QString filepath;
 	QByteArray content;
 
+	// A temporary rewritten copy of filepath to upload the parts from,
+	// it is removed with the result.
+	QString uploadpath;
+
 	QString filename;
 	QString filemime;
 	int32 filesize = 0;
@@ -18,7 +18,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/widgets/input_fields.h"
 #include "ui/emoji_config.h"
 #include "export/export_settings.h"
-#include "api/api_hash.h"
 #include "core/crash_reports.h"
 #include "core/update_checker.h"
 #include "observer_peer.h"
@@ -42,6 +41,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QBuffer>
 #include <QtCore/QtEndian>
 #include <QtCore/QDirIterator>
+#include <QtCore/QWaitCondition>
 
 extern "C" {
 #include <openssl/evp.h>
@@ -55,6 +55,10 @@ constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
 constexpr auto kWriteMapTimeout = crl::time(1000);
+
+// The locations file holds an entry for every downloaded file and is
+// rewritten completely, so changes are collected for a while before it.
+constexpr auto kWriteLocationsTimeout = crl::time(5000);
 constexpr auto kSavedBackgroundFormat = QImage::Format_ARGB32_Premultiplied;
 
 constexpr auto kWallPaperLegacySerializeTagId = int32(-111);
@@ -96,6 +100,10 @@ bool _started = false;
 internal::Manager *_manager = nullptr;
 TaskQueue *_localLoader = nullptr;
 
+// Voice waveforms are counted on their own low priority thread, so that
+// a chat full of voice messages doesn't delay the _localLoader tasks.
+TaskQueue *_waveformLoader = nullptr;
+
 bool _working() {
 	return _manager && !_basePath.isEmpty();
 }
@@ -111,7 +119,71 @@ enum class FileOption {
 using FileOptions = base::flags<FileOption>;
 inline constexpr auto is_flag_type(FileOption) { return true; };
 
+// Files are written and encrypted on a background thread. Newer contents
+// of a file replace the ones still waiting to be written. Files are
+// written one by one in the order they were pushed, and an index file
+// is moved to the end on each push, so that it never points to data
+// which is not written yet.
+class WriteQueue final {
+public:
+	struct Part {
+		QByteArray data;
+		MTP::AuthKeyPtr key; // Encrypted with this key if not null.
+	};
+	struct File {
+		bool safe = false;
+		bool index = false;
+		std::vector<Part> parts;
+	};
+
+	void push(const QString &path, File &&file);
+	void cancel(const QString &path);
+	[[nodiscard]] bool pending(const QString &path);
+	void wait(const QString &path);
+	void flush();
+
+private:
+	using Files = std::deque<std::pair<QString, File>>;
+
+	[[nodiscard]] Files::iterator findLocked(const QString &path);
+	void process();
+	void writeFirstLocked(QMutexLocker &lock);
+
+	QMutex _mutex;
+	QWaitCondition _written;
+	Files _files;
+	QString _writing;
+	bool _scheduled = false;
+
+};
+
+WriteQueue &Writer() {
+	static auto Instance = WriteQueue();
+	return Instance;
+}
+
+// Big files read at session start are read and decrypted in background
+// right after the map is read, so that only deserialization is left.
+struct PrefetchedFile {
+	MTP::AuthKeyPtr key;
+	bool ready = false;
+	bool read = false;
+	int32 version = 0;
+	QByteArray data;
+	qint64 position = 0;
+};
+
+QMutex PrefetchMutex;
+QWaitCondition PrefetchReady;
+std::map<FileKey, std::shared_ptr<PrefetchedFile>> Prefetched;
+
+void DropPrefetched(FileKey key) {
+	QMutexLocker lock(&PrefetchMutex);
+	Prefetched.erase(key);
+}
+
 bool keyAlreadyUsed(QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+	if (Writer().pending(name)) return true;
 	name += '0';
 	if (QFileInfo(name).exists()) return true;
 	if (options & (FileOption::Safe)) {
@@ -148,9 +220,13 @@ void clearKey(const FileKey &key, FileOptions options = FileOption::User | FileO
 		if (!_working()) return;
 	}
 
+	DropPrefetched(key);
+
 	QString base = (options & FileOption::User) ? _userBasePath : _basePath, name;
 	name.reserve(base.size() + 0x11);
-	name.append(base).append(toFilePart(key)).append('0');
+	name.append(base).append(toFilePart(key));
+	Writer().cancel(name);
+	name.append('0');
 	QFile::remove(name);
 	if (options & FileOption::Safe) {
 		name[name.size() - 1] = '1';
@@ -234,110 +310,210 @@ struct EncryptedDescriptor {
 	}
 };
 
-struct FileWriteDescriptor {
-	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe) {
-		init(toFilePart(key), options);
+QByteArray EncryptData(QByteArray &&toEncrypt, const MTP::AuthKeyPtr &key) {
+	// prepare for encryption
+	uint32 size = toEncrypt.size(), fullSize = size;
+	if (fullSize & 0x0F) {
+		fullSize += 0x10 - (fullSize & 0x0F);
+		toEncrypt.resize(fullSize);
+		memset_rand(toEncrypt.data() + size, fullSize - size);
 	}
-	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
-		init(name, options);
-	}
-	void init(const QString &name, FileOptions options) {
-		if (options & FileOption::User) {
-			if (!_userWorking()) return;
-		} else {
-			if (!_working()) return;
-		}
+	*(uint32*)toEncrypt.data() = size;
+	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
+	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
+	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
 
-		// detect order of read attempts and file version
-		QString toTry[2];
-		toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
-		if (options & FileOption::Safe) {
-			toTry[1] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '1';
-			QFileInfo toTry0(toTry[0]);
-			QFileInfo toTry1(toTry[1]);
-			if (toTry0.exists()) {
-				if (toTry1.exists()) {
-					QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
-					if (mod0 > mod1) {
-						qSwap(toTry[0], toTry[1]);
-					}
-				} else {
+	return encrypted;
+}
+
+void WriteFile(const QString &path, WriteQueue::File &&data) {
+	// detect order of read attempts and file version
+	QString toTry[2];
+	toTry[0] = path + '0';
+	QString toDelete;
+	if (data.safe) {
+		toTry[1] = path + '1';
+		QFileInfo toTry0(toTry[0]);
+		QFileInfo toTry1(toTry[1]);
+		if (toTry0.exists()) {
+			if (toTry1.exists()) {
+				QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
+				if (mod0 > mod1) {
 					qSwap(toTry[0], toTry[1]);
 				}
-				toDelete = toTry[1];
-			} else if (toTry1.exists()) {
-				toDelete = toTry[1];
+			} else {
+				qSwap(toTry[0], toTry[1]);
 			}
+			toDelete = toTry[1];
+		} else if (toTry1.exists()) {
+			toDelete = toTry[1];
 		}
+	}
 
-		file.setFileName(toTry[0]);
-		if (file.open(QIODevice::WriteOnly)) {
-			file.write(tdfMagic, tdfMagicLen);
-			qint32 version = AppVersion;
-			file.write((const char*)&version, sizeof(version));
-
-			stream.setDevice(&file);
-			stream.setVersion(QDataStream::Qt_5_1);
-		}
+	QFile file(toTry[0]);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
 	}
-	bool writeData(const QByteArray &data) {
-		if (!file.isOpen()) return false;
+	file.write(tdfMagic, tdfMagicLen);
+	qint32 version = AppVersion;
+	file.write((const char*)&version, sizeof(version));
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
 
-		stream << data;
-		quint32 len = data.isNull() ? 0xffffffff : data.size();
+	HashMd5 md5;
+	int32 dataSize = 0;
+	for (auto &part : data.parts) {
+		const auto bytes = part.key
+			? EncryptData(std::move(part.data), part.key)
+			: std::move(part.data);
+		stream << bytes;
+		quint32 len = bytes.isNull() ? 0xffffffff : bytes.size();
 		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
 			len = qbswap(len);
 		}
 		md5.feed(&len, sizeof(len));
-		md5.feed(data.constData(), data.size());
-		dataSize += sizeof(len) + data.size();
+		md5.feed(bytes.constData(), bytes.size());
+		dataSize += sizeof(len) + bytes.size();
+	}
+	stream.setDevice(nullptr);
 
-		return true;
+	md5.feed(&dataSize, sizeof(dataSize));
+	md5.feed(&version, sizeof(version));
+	md5.feed(tdfMagic, tdfMagicLen);
+	file.write((const char*)md5.result(), 0x10);
+	file.close();
+
+	if (!toDelete.isEmpty()) {
+		QFile::remove(toDelete);
 	}
-	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
-		data.finish();
-		QByteArray &toEncrypt(data.data);
+}
 
-		// prepare for encryption
-		uint32 size = toEncrypt.size(), fullSize = size;
-		if (fullSize & 0x0F) {
-			fullSize += 0x10 - (fullSize & 0x0F);
-			toEncrypt.resize(fullSize);
-			memset_rand(toEncrypt.data() + size, fullSize - size);
-		}
-		*(uint32*)toEncrypt.data() = size;
-		QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
-		hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
-		MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+WriteQueue::Files::iterator WriteQueue::findLocked(const QString &path) {
+	return ranges::find(_files, path, &Files::value_type::first);
+}
 
-		return encrypted;
+void WriteQueue::push(const QString &path, File &&file) {
+	QMutexLocker lock(&_mutex);
+	const auto i = findLocked(path);
+	if (i == end(_files)) {
+		_files.emplace_back(path, std::move(file));
+	} else if (file.index) {
+		_files.erase(i);
+		_files.emplace_back(path, std::move(file));
+	} else {
+		// Data keeps its place, it is still written before the index.
+		i->second = std::move(file);
 	}
-	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
-		return writeData(prepareEncrypted(data, key));
+	if (!_scheduled) {
+		_scheduled = true;
+		crl::async([=] { process(); });
 	}
-	void finish() {
-		if (!file.isOpen()) return;
+}
 
-		stream.setDevice(nullptr);
+void WriteQueue::cancel(const QString &path) {
+	QMutexLocker lock(&_mutex);
+	const auto i = findLocked(path);
+	if (i != end(_files)) {
+		_files.erase(i);
+	}
+	while (_writing == path) {
+		_written.wait(&_mutex);
+	}
+}
 
-		md5.feed(&dataSize, sizeof(dataSize));
-		qint32 version = AppVersion;
-		md5.feed(&version, sizeof(version));
-		md5.feed(tdfMagic, tdfMagicLen);
-		file.write((const char*)md5.result(), 0x10);
-		file.close();
+bool WriteQueue::pending(const QString &path) {
+	QMutexLocker lock(&_mutex);
+	return (findLocked(path) != end(_files)) || (_writing == path);
+}
+
+void WriteQueue::wait(const QString &path) {
+	QMutexLocker lock(&_mutex);
+	while (findLocked(path) != end(_files)) {
+		writeFirstLocked(lock);
+	}
+	while (_writing == path) {
+		_written.wait(&_mutex);
+	}
+}
+
+void WriteQueue::flush() {
+	QMutexLocker lock(&_mutex);
+	while (!_files.empty()) {
+		writeFirstLocked(lock);
+	}
+	while (!_writing.isEmpty()) {
+		_written.wait(&_mutex);
+	}
+}
 
-		if (!toDelete.isEmpty()) {
-			QFile::remove(toDelete);
+void WriteQueue::process() {
+	QMutexLocker lock(&_mutex);
+	while (!_files.empty()) {
+		writeFirstLocked(lock);
+	}
+	_scheduled = false;
+}
+
+void WriteQueue::writeFirstLocked(QMutexLocker &lock) {
+	// Wait for the previous file, so that the order is preserved.
+	while (!_writing.isEmpty()) {
+		_written.wait(&_mutex);
+	}
+	if (_files.empty()) {
+		return;
+	}
+	auto [path, file] = std::move(_files.front());
+	_files.pop_front();
+	_writing = path;
+	lock.unlock();
+	WriteFile(path, std::move(file));
+	lock.relock();
+	_writing = QString();
+	_written.wakeAll();
+}
+
+struct FileWriteDescriptor {
+	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe) {
+		DropPrefetched(key);
+		init(toFilePart(key), options);
+	}
+	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+		init(name, options);
+	}
+	void init(const QString &name, FileOptions options) {
+		if (options & FileOption::User) {
+			if (!_userWorking()) return;
+		} else {
+			if (!_working()) return;
 		}
+		path = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+		file.safe = (options & FileOption::Safe);
 	}
-	QFile file;
-	QDataStream stream;
+	bool writeData(const QByteArray &data) {
+		if (path.isEmpty()) return false;
 
-	QString toDelete;
+		file.parts.push_back({ data, nullptr });
+		return true;
+	}
+	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+		data.finish();
+		return EncryptData(std::move(data.data), key);
+	}
+	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+		if (path.isEmpty()) return false;
 
-	HashMd5 md5;
-	int32 dataSize = 0;
+		data.finish();
+		file.parts.push_back({ std::move(data.data), key });
+		return true;
+	}
+	void finish() {
+		if (path.isEmpty()) return;
+
+		Writer().push(base::take(path), base::take(file));
+	}
+	QString path;
+	WriteQueue::File file;
 
 	~FileWriteDescriptor() {
 		finish();
@@ -351,6 +527,8 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 		if (!_working()) return false;
 	}
 
+	Writer().wait(((options & FileOption::User) ? _userBasePath : _basePath) + name);
+
 	// detect order of read attempts
 	QString toTry[2];
 	toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
@@ -507,8 +685,78 @@ bool readEncryptedFile(FileReadDescriptor &result, const QString &name, FileOpti
 	return true;
 }
 
+void PrefetchEncryptedFiles(const std::vector<FileKey> &keys) {
+	auto files = std::vector<std::pair<FileKey, std::shared_ptr<PrefetchedFile>>>();
+	{
+		QMutexLocker lock(&PrefetchMutex);
+		for (const auto key : keys) {
+			if (key && !Prefetched.count(key)) {
+				const auto file = std::make_shared<PrefetchedFile>();
+				file->key = LocalKey;
+				Prefetched.emplace(key, file);
+				files.emplace_back(key, file);
+			}
+		}
+	}
+	if (files.empty()) {
+		return;
+	}
+	// LocalKey is captured on the main thread, it may change while
+	// the files are read and it is taken only if still the same.
+	crl::async([files = std::move(files)] {
+		for (const auto &[key, file] : files) {
+			FileReadDescriptor result;
+			const auto read = readEncryptedFile(
+				result,
+				toFilePart(key),
+				FileOption::User | FileOption::Safe,
+				file->key);
+
+			QMutexLocker lock(&PrefetchMutex);
+			file->read = read;
+			if (read) {
+				file->version = result.version;
+				file->data = result.data;
+				file->position = result.buffer.pos();
+			}
+			file->ready = true;
+			PrefetchReady.wakeAll();
+		}
+	});
+}
+
+std::shared_ptr<PrefetchedFile> TakePrefetched(FileKey key) {
+	QMutexLocker lock(&PrefetchMutex);
+	const auto i = Prefetched.find(key);
+	if (i == end(Prefetched)) {
+		return nullptr;
+	}
+	const auto file = std::move(i->second);
+	Prefetched.erase(i);
+	while (!file->ready) {
+		PrefetchReady.wait(&PrefetchMutex);
+	}
+	return file;
+}
+
 bool readEncryptedFile(FileReadDescriptor &result, const FileKey &fkey, FileOptions options = FileOption::User | FileOption::Safe, const MTP::AuthKeyPtr &key = LocalKey) {
-	return readEncryptedFile(result, toFilePart(fkey), options, key);
+	const auto prefetched = (options == (FileOption::User | FileOption::Safe)
+		&& key == LocalKey)
+		? TakePrefetched(fkey)
+		: nullptr;
+	if (!prefetched || prefetched->key != key) {
+		return readEncryptedFile(result, toFilePart(fkey), options, key);
+	} else if (!prefetched->read) {
+		return false;
+	}
+	result.version = prefetched->version;
+	result.data = prefetched->data;
+	result.buffer.setBuffer(&result.data);
+	result.buffer.open(QIODevice::ReadOnly);
+	result.buffer.seek(prefetched->position);
+	result.stream.setDevice(&result.buffer);
+	result.stream.setVersion(QDataStream::Qt_5_1);
+	return true;
 }
 
 FileKey _dataNameKey = 0;
@@ -536,6 +784,9 @@ enum { // Local Storage Keys
 	lskExportSettings = 0x13, // no data
 	lskBackground = 0x14, // no data
 	lskSelfSerialized = 0x15, // serialized self
+	lskUploadsResume = 0x16, // no data
+	lskDialogsSnapshot = 0x17, // no data
+	lskSharedMediaSnapshots = 0x18, // no data
 };
 
 enum {
@@ -657,6 +908,7 @@ FileLocationPairs _fileLocationPairs;
 typedef QMap<MediaKey, MediaKey> FileLocationAliases;
 FileLocationAliases _fileLocationAliases;
 FileKey _locationsKey = 0, _trustedBotsKey = 0;
+bool _locationsRead = false;
 
 using TrustedBots = OrderedSet<uint64>;
 TrustedBots _trustedBots;
@@ -696,6 +948,9 @@ bool NoTimeLimit(qint32 storedLimitValue) {
 }
 
 FileKey _exportSettingsKey = 0;
+FileKey _uploadsResumeKey = 0;
+FileKey _dialogsSnapshotKey = 0;
+FileKey _sharedMediaSnapshotsKey = 0;
 
 FileKey _langPackKey = 0;
 FileKey _languagesKey = 0;
@@ -851,6 +1106,20 @@ void _readLocations() {
 	}
 }
 
+// The locations map is not needed before the first media is shown,
+// so it is read on first use instead of in _readMap.
+void _ensureLocationsRead() {
+	if (_locationsRead) {
+		return;
+	}
+	_locationsRead = true;
+	if (_locationsKey) {
+		const auto ms = crl::now();
+		_readLocations();
+		LOG(("Locations read time: %1").arg(crl::now() - ms));
+	}
+}
+
 struct ReadSettingsContext {
 	MTP::DcOptions dcOptions;
 };
@@ -2286,6 +2555,9 @@ ReadMapState _readMap(const QByteArray &pass) {
 	quint64 savedGifsKey = 0;
 	quint64 backgroundKeyDay = 0, backgroundKeyNight = 0;
 	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, exportSettingsKey = 0;
+	quint64 uploadsResumeKey = 0;
+	quint64 dialogsSnapshotKey = 0;
+	quint64 sharedMediaSnapshotsKey = 0;
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -2377,6 +2649,15 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskExportSettings: {
 			map.stream >> exportSettingsKey;
 		} break;
+		case lskUploadsResume: {
+			map.stream >> uploadsResumeKey;
+		} break;
+		case lskDialogsSnapshot: {
+			map.stream >> dialogsSnapshotKey;
+		} break;
+		case lskSharedMediaSnapshots: {
+			map.stream >> sharedMediaSnapshotsKey;
+		} break;
 		default:
 		LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 		return ReadMapFailed;
@@ -2404,6 +2685,9 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_userSettingsKey = userSettingsKey;
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
 	_exportSettingsKey = exportSettingsKey;
+	_uploadsResumeKey = uploadsResumeKey;
+	_dialogsSnapshotKey = dialogsSnapshotKey;
+	_sharedMediaSnapshotsKey = sharedMediaSnapshotsKey;
 	_oldMapVersion = mapData.version;
 	if (_oldMapVersion < AppVersion) {
 		_mapChanged = true;
@@ -2412,9 +2696,16 @@ ReadMapState _readMap(const QByteArray &pass) {
 		_mapChanged = false;
 	}
 
-	if (_locationsKey) {
-		_readLocations();
-	}
+	_locationsRead = false;
+	PrefetchEncryptedFiles({
+		_installedStickersKey,
+		_featuredStickersKey,
+		_recentStickersKey,
+		_favedStickersKey,
+		_savedGifsKey,
+		_dialogsSnapshotKey,
+		_sharedMediaSnapshotsKey,
+	});
 
 	_readUserSettings();
 	_readMtpData();
@@ -2449,6 +2740,7 @@ void _writeMap(WriteMapWhen when) {
 	if (!QDir().exists(_userBasePath)) QDir().mkpath(_userBasePath);
 
 	FileWriteDescriptor map(qsl("map"));
+	map.file.index = true;
 	if (_passKeySalt.isEmpty() || _passKeyEncrypted.isEmpty()) {
 		QByteArray pass(kLocalKeySize, Qt::Uninitialized), salt(LocalEncryptSaltSize, Qt::Uninitialized);
 		memset_rand(pass.data(), pass.size());
@@ -2504,6 +2796,9 @@ void _writeMap(WriteMapWhen when) {
 	if (_userSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_exportSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_uploadsResumeKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_dialogsSnapshotKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_sharedMediaSnapshotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 
 	EncryptedDescriptor mapData(mapSize);
 	if (!self.isEmpty()) {
@@ -2555,6 +2850,15 @@ void _writeMap(WriteMapWhen when) {
 	if (_exportSettingsKey) {
 		mapData.stream << quint32(lskExportSettings) << quint64(_exportSettingsKey);
 	}
+	if (_uploadsResumeKey) {
+		mapData.stream << quint32(lskUploadsResume) << quint64(_uploadsResumeKey);
+	}
+	if (_dialogsSnapshotKey) {
+		mapData.stream << quint32(lskDialogsSnapshot) << quint64(_dialogsSnapshotKey);
+	}
+	if (_sharedMediaSnapshotsKey) {
+		mapData.stream << quint32(lskSharedMediaSnapshots) << quint64(_sharedMediaSnapshotsKey);
+	}
 	map.writeEncrypted(mapData);
 
 	_mapChanged = false;
@@ -2566,9 +2870,11 @@ void finish() {
 	if (_manager) {
 		_writeMap(WriteMapWhen::Now);
 		_manager->finish();
+		Writer().flush();
 		_manager->deleteLater();
 		_manager = nullptr;
 		delete base::take(_localLoader);
+		delete base::take(_waveformLoader);
 	}
 }
 
@@ -2580,6 +2886,9 @@ void start() {
 
 	_manager = new internal::Manager();
 	_localLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
+	_waveformLoader = new TaskQueue(
+		kFileLoaderQueueStopTimeout,
+		QThread::LowPriority);
 
 	_basePath = cWorkingDir() + qsl("tdata/");
 	if (!QDir().exists(_basePath)) QDir().mkpath(_basePath);
@@ -2805,6 +3114,15 @@ void reset() {
 	if (_localLoader) {
 		_localLoader->stop();
 	}
+	if (_waveformLoader) {
+		_waveformLoader->stop();
+	}
+	Writer().flush();
+
+	{
+		QMutexLocker lock(&PrefetchMutex);
+		Prefetched.clear();
+	}
 
 	_passKeySalt.clear(); // reset passcode, local key
 	_draftsMap.clear();
@@ -2814,12 +3132,14 @@ void reset() {
 	_fileLocationAliases.clear();
 	_draftsNotReadMap.clear();
 	_locationsKey = _trustedBotsKey = 0;
+	_locationsRead = false;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = _featuredStickersKey = _recentStickersKey = _favedStickersKey = _archivedStickersKey = 0;
 	_savedGifsKey = 0;
 	_backgroundKeyDay = _backgroundKeyNight = 0;
 	Window::Theme::Background()->reset();
 	_userSettingsKey = _recentHashtagsAndBotsKey = _exportSettingsKey = 0;
+	_uploadsResumeKey = _dialogsSnapshotKey = _sharedMediaSnapshotsKey = 0;
 	_oldMapVersion = _oldSettingsVersion = 0;
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
@@ -2838,6 +3158,18 @@ bool checkPasscode(const QByteArray &passcode) {
 	return checkKey->equals(PassKey);
 }
 
+void checkPasscodeAsync(
+		const QByteArray &passcode,
+		Fn<void(bool correct)> done) {
+	crl::async([=, salt = _passKeySalt]() mutable {
+		auto checkKey = MTP::AuthKeyPtr();
+		createLocalKey(passcode, &salt, &checkKey);
+		crl::on_main([=] {
+			done(PassKey && checkKey->equals(PassKey));
+		});
+	});
+}
+
 void setPasscode(const QByteArray &passcode) {
 	createLocalKey(passcode, &_passKeySalt, &PassKey);
 
@@ -2867,6 +3199,9 @@ base::flat_set<QString> CollectGoodNames() {
 		_backgroundKeyDay,
 		_recentHashtagsAndBotsKey,
 		_exportSettingsKey,
+		_uploadsResumeKey,
+		_dialogsSnapshotKey,
+		_sharedMediaSnapshotsKey,
 		_trustedBotsKey
 	};
 	auto result = base::flat_set<QString>{ "map0", "map1" };
@@ -3113,6 +3448,7 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 	if (local.fname.isEmpty()) {
 		return;
 	}
+	_ensureLocationsRead();
 	if (!local.inMediaCache()) {
 		FileLocationAliases::const_iterator aliasIt = _fileLocationAliases.constFind(location);
 		if (aliasIt != _fileLocationAliases.cend()) {
@@ -3124,7 +3460,7 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 			if (i.value().second == local) {
 				if (i.value().first != location) {
 					_fileLocationAliases.insert(location, i.value().first);
-					_writeLocations(WriteMapWhen::Fast);
+					_writeLocations();
 				}
 				return;
 			}
@@ -3148,10 +3484,11 @@ void writeFileLocation(MediaKey location, const FileLocation &local) {
 		}
 	}
 	_fileLocations.insert(location, local);
-	_writeLocations(WriteMapWhen::Fast);
+	_writeLocations();
 }
 
 void removeFileLocation(MediaKey location) {
+	_ensureLocationsRead();
 	FileLocations::iterator i = _fileLocations.find(location);
 	if (i == _fileLocations.end()) {
 		return;
@@ -3159,10 +3496,11 @@ void removeFileLocation(MediaKey location) {
 	while (i != _fileLocations.end() && (i.key() == location)) {
 		i = _fileLocations.erase(i);
 	}
-	_writeLocations(WriteMapWhen::Fast);
+	_writeLocations();
 }
 
 FileLocation readFileLocation(MediaKey location) {
+	_ensureLocationsRead();
 	FileLocationAliases::const_iterator aliasIt = _fileLocationAliases.constFind(location);
 	if (aliasIt != _fileLocationAliases.cend()) {
 		location = aliasIt.value();
@@ -3294,10 +3632,10 @@ protected:
 
 void countVoiceWaveform(DocumentData *document) {
 	if (const auto voice = document->voice()) {
-		if (_localLoader) {
+		if (_waveformLoader) {
 			voice->waveform.resize(1 + sizeof(TaskId));
 			voice->waveform[0] = -1; // counting
-			TaskId taskId = _localLoader->addTask(
+			TaskId taskId = _waveformLoader->addTask(
 				std::make_unique<CountWaveformTask>(document));
 			memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
 		}
@@ -3305,8 +3643,8 @@ void countVoiceWaveform(DocumentData *document) {
 }
 
 void cancelTask(TaskId id) {
-	if (_localLoader) {
-		_localLoader->cancelTask(id);
+	if (_waveformLoader) {
+		_waveformLoader->cancelTask(id);
 	}
 }
 
@@ -3891,69 +4229,24 @@ void readArchivedStickers() {
 	}
 }
 
-int32 countDocumentVectorHash(const QVector<DocumentData*> vector) {
-	auto result = Api::HashInit();
-	for (const auto document : vector) {
-		Api::HashUpdate(result, document->id);
-	}
-	return Api::HashFinalize(result);
-}
-
-int32 countSpecialStickerSetHash(uint64 setId) {
-	auto &sets = Auth().data().stickerSets();
-	auto it = sets.constFind(setId);
-	if (it != sets.cend()) {
-		return countDocumentVectorHash(it->stickers);
-	}
-	return 0;
-}
-
 int32 countStickersHash(bool checkOutdatedInfo) {
-	auto result = Api::HashInit();
-	bool foundOutdated = false;
-	auto &sets = Auth().data().stickerSets();
-	auto &order = Auth().data().stickerSetsOrder();
-	for (auto i = order.cbegin(), e = order.cend(); i != e; ++i) {
-		auto j = sets.constFind(*i);
-		if (j != sets.cend()) {
-			if (j->id == Stickers::DefaultSetId) {
-				foundOutdated = true;
-			} else if (!(j->flags & MTPDstickerSet_ClientFlag::f_special)
-				&& !(j->flags & MTPDstickerSet::Flag::f_archived)) {
-				Api::HashUpdate(result, j->hash);
-			}
-		}
-	}
-	return (!checkOutdatedInfo || !foundOutdated)
-		? Api::HashFinalize(result)
-		: 0;
+	return Auth().data().stickersHash(checkOutdatedInfo);
 }
 
 int32 countRecentStickersHash() {
-	return countSpecialStickerSetHash(Stickers::CloudRecentSetId);
+	return Auth().data().recentStickersHash();
 }
 
 int32 countFavedStickersHash() {
-	return countSpecialStickerSetHash(Stickers::FavedSetId);
+	return Auth().data().favedStickersHash();
 }
 
 int32 countFeaturedStickersHash() {
-	auto result = Api::HashInit();
-	const auto &sets = Auth().data().stickerSets();
-	const auto &featured = Auth().data().featuredStickerSetsOrder();
-	for (const auto setId : featured) {
-		Api::HashUpdate(result, setId);
-
-		auto it = sets.constFind(setId);
-		if (it != sets.cend() && (it->flags & MTPDstickerSet_ClientFlag::f_unread)) {
-			Api::HashUpdate(result, 1);
-		}
-	}
-	return Api::HashFinalize(result);
+	return Auth().data().featuredStickersHash();
 }
 
 int32 countSavedGifsHash() {
-	return countDocumentVectorHash(Auth().data().savedGifs());
+	return Auth().data().savedGifsHash();
 }
 
 void writeSavedGifs() {
@@ -4736,6 +5029,8 @@ void WriteExportSettings(const Export::Settings &settings) {
 		&& settings.path == check.path
 		&& settings.format == check.format
 		&& settings.availableAt == check.availableAt
+		&& settings.incremental == check.incremental
+		&& settings.archive == check.archive
 		&& !settings.onlySinglePeer()) {
 		if (_exportSettingsKey) {
 			clearKey(_exportSettingsKey);
@@ -4751,7 +5046,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		}
 		quint32 size = sizeof(quint32) * 6
 			+ Serialize::stringSize(settings.path)
-			+ sizeof(qint32) * 2 + sizeof(quint64);
+			+ sizeof(qint32) * 5 + sizeof(quint64);
 		EncryptedDescriptor data(size);
 		data.stream
 			<< quint32(settings.types)
@@ -4784,12 +5079,137 @@ void WriteExportSettings(const Export::Settings &settings) {
 		});
 		data.stream << qint32(settings.singlePeerFrom);
 		data.stream << qint32(settings.singlePeerTill);
+		data.stream << qint32(settings.incremental ? 1 : 0);
+		data.stream << qint32(settings.archive ? 1 : 0);
 
 		FileWriteDescriptor file(_exportSettingsKey);
 		file.writeEncrypted(data);
 	}
 }
 
+void WriteUploadsResumeState(const QByteArray &serialized) {
+	if (!_working()) return;
+
+	if (serialized.isEmpty()) {
+		if (_uploadsResumeKey) {
+			clearKey(_uploadsResumeKey);
+			_uploadsResumeKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+	} else {
+		if (!_uploadsResumeKey) {
+			_uploadsResumeKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		EncryptedDescriptor data(Serialize::bytearraySize(serialized));
+		data.stream << serialized;
+
+		FileWriteDescriptor file(_uploadsResumeKey);
+		file.writeEncrypted(data);
+	}
+}
+
+QByteArray ReadUploadsResumeState() {
+	if (!_uploadsResumeKey) {
+		return QByteArray();
+	}
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _uploadsResumeKey)) {
+		clearKey(_uploadsResumeKey);
+		_uploadsResumeKey = 0;
+		_writeMap();
+		return QByteArray();
+	}
+
+	auto result = QByteArray();
+	file.stream >> result;
+	return _checkStreamStatus(file.stream) ? result : QByteArray();
+}
+
+void WriteDialogsSnapshot(const QByteArray &serialized) {
+	if (!_working()) return;
+
+	if (serialized.isEmpty()) {
+		if (_dialogsSnapshotKey) {
+			clearKey(_dialogsSnapshotKey);
+			_dialogsSnapshotKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+	} else {
+		if (!_dialogsSnapshotKey) {
+			_dialogsSnapshotKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		EncryptedDescriptor data(Serialize::bytearraySize(serialized));
+		data.stream << serialized;
+
+		FileWriteDescriptor file(_dialogsSnapshotKey);
+		file.writeEncrypted(data);
+	}
+}
+
+QByteArray ReadDialogsSnapshot() {
+	if (!_dialogsSnapshotKey) {
+		return QByteArray();
+	}
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _dialogsSnapshotKey)) {
+		clearKey(_dialogsSnapshotKey);
+		_dialogsSnapshotKey = 0;
+		_writeMap();
+		return QByteArray();
+	}
+
+	auto result = QByteArray();
+	file.stream >> result;
+	return _checkStreamStatus(file.stream) ? result : QByteArray();
+}
+
+void WriteSharedMediaSnapshots(const QByteArray &serialized) {
+	if (!_working()) return;
+
+	if (serialized.isEmpty()) {
+		if (_sharedMediaSnapshotsKey) {
+			clearKey(_sharedMediaSnapshotsKey);
+			_sharedMediaSnapshotsKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+	} else {
+		if (!_sharedMediaSnapshotsKey) {
+			_sharedMediaSnapshotsKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		EncryptedDescriptor data(Serialize::bytearraySize(serialized));
+		data.stream << serialized;
+
+		FileWriteDescriptor file(_sharedMediaSnapshotsKey);
+		file.writeEncrypted(data);
+	}
+}
+
+QByteArray ReadSharedMediaSnapshots() {
+	if (!_sharedMediaSnapshotsKey) {
+		return QByteArray();
+	}
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _sharedMediaSnapshotsKey)) {
+		clearKey(_sharedMediaSnapshotsKey);
+		_sharedMediaSnapshotsKey = 0;
+		_writeMap();
+		return QByteArray();
+	}
+
+	auto result = QByteArray();
+	file.stream >> result;
+	return _checkStreamStatus(file.stream) ? result : QByteArray();
+}
+
 Export::Settings ReadExportSettings() {
 	FileReadDescriptor file;
 	if (!readEncryptedFile(file, _exportSettingsKey)) {
@@ -4806,6 +5226,8 @@ Export::Settings ReadExportSettings() {
 	qint32 singlePeerType = 0, singlePeerBareId = 0;
 	quint64 singlePeerAccessHash = 0;
 	qint32 singlePeerFrom = 0, singlePeerTill = 0;
+	qint32 incremental = 0;
+	qint32 archive = 0;
 	file.stream
 		>> types
 		>> fullChats
@@ -4830,6 +5252,12 @@ Export::Settings ReadExportSettings() {
 	if (!file.stream.atEnd()) {
 		file.stream >> singlePeerFrom >> singlePeerTill;
 	}
+	if (!file.stream.atEnd()) {
+		file.stream >> incremental;
+	}
+	if (!file.stream.atEnd()) {
+		file.stream >> archive;
+	}
 	auto result = Export::Settings();
 	result.types = Export::Settings::Types::from_raw(types);
 	result.fullChats = Export::Settings::Types::from_raw(fullChats);
@@ -4859,6 +5287,8 @@ Export::Settings ReadExportSettings() {
 	}();
 	result.singlePeerFrom = singlePeerFrom;
 	result.singlePeerTill = singlePeerTill;
+	result.incremental = (incremental == 1);
+	result.archive = (archive == 1);
 	return (file.stream.status() == QDataStream::Ok && result.validate())
 		? result
 		: Export::Settings();
@@ -4980,6 +5410,10 @@ ClearManager::ClearManager() : data(new ClearManagerData()) {
 }
 
 bool ClearManager::addTask(int task) {
+	if (task == ClearManagerAll) {
+		// Don't let pending writes recreate files after they're cleared.
+		Writer().flush();
+	}
 	QMutexLocker lock(&data->mutex);
 	if (!data->working) return false;
 
@@ -5133,7 +5567,7 @@ void Manager::writingMap() {
 
 void Manager::writeLocations(bool fast) {
 	if (!_locationsWriteTimer.isActive() || fast) {
-		_locationsWriteTimer.start(fast ? 1 : kWriteMapTimeout);
+		_locationsWriteTimer.start(fast ? 1 : kWriteLocationsTimeout);
 	} else if (_locationsWriteTimer.remainingTime() <= 0) {
 		locationsWriteTimeout();
 	}
@@ -55,6 +55,11 @@ QString readAutoupdatePrefix();
 void reset();
 
 bool checkPasscode(const QByteArray &passcode);
+
+// Derives the key on a background thread, done() is called on main.
+void checkPasscodeAsync(
+	const QByteArray &passcode,
+	Fn<void(bool correct)> done);
 void setPasscode(const QByteArray &passcode);
 
 enum ClearManagerTask {
@@ -175,6 +180,15 @@ void saveRecentSearchHashtags(const QString &text);
 void WriteExportSettings(const Export::Settings &settings);
 Export::Settings ReadExportSettings();
 
+void WriteUploadsResumeState(const QByteArray &serialized);
+[[nodiscard]] QByteArray ReadUploadsResumeState();
+
+void WriteDialogsSnapshot(const QByteArray &serialized);
+[[nodiscard]] QByteArray ReadDialogsSnapshot();
+
+void WriteSharedMediaSnapshots(const QByteArray &serialized);
+[[nodiscard]] QByteArray ReadSharedMediaSnapshots();
+
 void writeSelf();
 void readSelf(const QByteArray &serialized, int32 streamVersion);
 
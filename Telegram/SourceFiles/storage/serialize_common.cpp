@@ -96,6 +96,21 @@ std::optional<StorageImageLocation> readStorageImageLocation(
 		: std::nullopt;
 }
 
+QByteArray mtpBufferToBytes(const mtpBuffer &buffer) {
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+mtpBuffer mtpBufferFromBytes(const QByteArray &bytes) {
+	if (bytes.size() % sizeof(mtpPrime)) {
+		return mtpBuffer();
+	}
+	auto result = mtpBuffer(bytes.size() / sizeof(mtpPrime));
+	memcpy(result.data(), bytes.constData(), bytes.size());
+	return result;
+}
+
 uint32 peerSize(not_null<PeerData*> peer) {
 	uint32 result = sizeof(quint64)
 		+ sizeof(quint64)
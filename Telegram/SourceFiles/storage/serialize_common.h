@@ -116,6 +116,21 @@ inline MTP::AuthKey::Data read<MTP::AuthKey::Data>(QDataStream &stream) {
 	return result;
 }
 
+// MTP values are kept in local storage as their raw serialized bytes.
+[[nodiscard]] QByteArray mtpBufferToBytes(const mtpBuffer &buffer);
+[[nodiscard]] mtpBuffer mtpBufferFromBytes(const QByteArray &bytes);
+
+template <typename Type>
+[[nodiscard]] std::optional<Type> readMtp(const mtpBuffer &buffer) {
+	if (buffer.isEmpty()) {
+		return std::nullopt;
+	}
+	auto result = Type();
+	auto from = buffer.constData();
+	const auto end = from + buffer.size();
+	return result.read(from, end) ? std::make_optional(result) : std::nullopt;
+}
+
 uint32 peerSize(not_null<PeerData*> peer);
 void writePeer(QDataStream &stream, PeerData *peer);
 PeerData *readPeer(int streamAppVersion, QDataStream &stream);
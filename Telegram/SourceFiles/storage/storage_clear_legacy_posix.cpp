@@ -36,11 +36,17 @@ std::vector<QString> CollectFiles(
 			continue;
 		}
 
-		const auto full = path + QByteArray(local);
-		const auto data = full.constData();
-		struct stat statbuf = { 0 };
-		if (stat(full.constData(), &statbuf) != 0 || S_ISDIR(statbuf.st_mode)) {
+		// Most file systems report the entry type right in readdir(),
+		// so stat() is required only for links and unknown entries.
+		if (entry->d_type == DT_DIR) {
 			continue;
+		} else if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+			const auto full = path + QByteArray(local);
+			struct stat statbuf = { 0 };
+			if (stat(full.constData(), &statbuf) != 0
+				|| S_ISDIR(statbuf.st_mode)) {
+				continue;
+			}
 		}
 
 		auto name = QFile::decodeName(local);
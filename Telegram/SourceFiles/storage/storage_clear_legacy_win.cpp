@@ -29,7 +29,7 @@ std::vector<QString> CollectFiles(
 		&data,
 		FindExSearchNameMatch,
 		nullptr,
-		0);
+		FIND_FIRST_EX_LARGE_FETCH);
 	if (handle == INVALID_HANDLE_VALUE) {
 		return {};
 	}
@@ -262,6 +262,57 @@ size_type File::readWithPadding(bytes::span bytes) {
 	return size;
 }
 
+const uchar *File::mapped(int64 till) {
+	if (till > _mappedSize) {
+		if (_mapped) {
+			_data.unmap(base::take(_mapped));
+			_mappedSize = 0;
+		}
+		const auto size = _data.size();
+		if (till > size) {
+			return nullptr;
+		}
+		_mapped = _data.map(0, size);
+		if (!_mapped) {
+			return nullptr;
+		}
+		_mappedSize = size;
+	}
+	return _mapped;
+}
+
+size_type File::readWithPaddingMapped(bytes::span bytes) {
+	Expects(_state.has_value());
+
+	const auto size = bytes.size();
+	const auto part = size % kBlockSize;
+	const auto good = size - part;
+	const auto full = good + (part ? kBlockSize : 0);
+	const auto available = _dataSize - offset();
+	if (full > available) {
+		return readWithPadding(bytes);
+	}
+	const auto position = _data.pos();
+	const auto data = mapped(position + full);
+	if (!data) {
+		return readWithPadding(bytes);
+	}
+	const auto source = bytes::make_span(data + position, full);
+	bytes::copy(bytes.subspan(0, good), source.subspan(0, good));
+	if (good) {
+		decrypt(bytes.subspan(0, good));
+	}
+	if (part) {
+		auto storage = bytes::array<kBlockSize>();
+		const auto padded = bytes::make_span(storage);
+		bytes::copy(padded, source.subspan(good));
+		decrypt(padded);
+		bytes::copy(bytes.subspan(good), padded.subspan(0, part));
+	}
+	_data.seek(position + full);
+	return size;
+}
+
 bool File::writeWithPadding(bytes::span bytes) {
 	const auto size = bytes.size();
 	const auto part = size % kBlockSize;
@@ -292,6 +343,10 @@ bool File::flush() {
 
 void File::close() {
 	_lock.unlock();
+	if (_mapped) {
+		_data.unmap(base::take(_mapped));
+		_mappedSize = 0;
+	}
 	_data.close();
 	_data.setFileName(QString());
 	_dataSize = _encryptionOffset = 0;
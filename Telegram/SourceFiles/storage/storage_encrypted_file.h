@@ -35,6 +35,11 @@ public:
 	size_type readWithPadding(bytes::span bytes);
 	bool writeWithPadding(bytes::span bytes);
 
+	// Same as readWithPadding, but decrypts straight from the file
+	// mapped to memory instead of reading it through the QFile buffer.
+	// The file is mapped once and stays mapped until it is closed.
+	size_type readWithPaddingMapped(bytes::span bytes);
+
 	bool flush();
 
 	bool isOpen() const;
@@ -60,11 +65,14 @@ private:
 	void decrypt(bytes::span bytes);
 	void encrypt(bytes::span bytes);
 	void decryptBack(bytes::span bytes);
+	const uchar *mapped(int64 till);
 
 	QFile _data;
 	FileLock _lock;
 	int64 _encryptionOffset = 0;
 	int64 _dataSize = 0;
+	uchar *_mapped = nullptr;
+	int64 _mappedSize = 0;
 
 	std::optional<CtrState> _state;
 
@@ -160,6 +160,25 @@ TEST_CASE("simple encrypted file", "[storage_encrypted_file]") {
 		REQUIRE(read == data.size());
 		REQUIRE(data == bytes::concatenate(Test1, Test1));
 	}
+	SECTION("reading mapped file") {
+		Storage::File file;
+
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::Read,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+
+		auto data = bytes::vector(20);
+		const auto read = file.readWithPaddingMapped(data);
+		REQUIRE(read == data.size());
+		REQUIRE(data == bytes::concatenate(Test1, Test1.subspan(0, 4)));
+		REQUIRE(file.offset() == 32);
+
+		auto rest = bytes::vector(16);
+		REQUIRE(file.readWithPaddingMapped(rest) == rest.size());
+		REQUIRE(rest == bytes::make_vector(Test1));
+	}
 	SECTION("moving file") {
 		const auto result = Storage::File::Move(Name, "other.file");
 		REQUIRE(result);
@@ -12,10 +12,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Storage {
 
 CtrState::CtrState(bytes::const_span key, bytes::const_span iv) {
-	Expects(key.size() == _key.size());
+	Expects(key.size() == kKeySize);
 	Expects(iv.size() == _iv.size());
 
-	bytes::copy(_key, key);
+	AES_set_encrypt_key(
+		reinterpret_cast<const uchar*>(key.data()),
+		key.size() * CHAR_BIT,
+		&_aes);
 	bytes::copy(_iv, iv);
 }
 
@@ -24,12 +27,6 @@ void CtrState::process(bytes::span data, int64 offset, Method method) {
 	Expects((data.size() % kBlockSize) == 0);
 	Expects((offset % kBlockSize) == 0);
 
-	AES_KEY aes;
-	AES_set_encrypt_key(
-		reinterpret_cast<const uchar*>(_key.data()),
-		_key.size() * CHAR_BIT,
-		&aes);
-
 	unsigned char ecountBuf[kBlockSize] = { 0 };
 	unsigned int offsetInBlock = 0;
 	const auto blockIndex = offset / kBlockSize;
@@ -39,7 +36,7 @@ void CtrState::process(bytes::span data, int64 offset, Method method) {
 		reinterpret_cast<const uchar*>(data.data()),
 		reinterpret_cast<uchar*>(data.data()),
 		data.size(),
-		&aes,
+		&_aes,
 		reinterpret_cast<unsigned char*>(iv.data()),
 		ecountBuf,
 		&offsetInBlock,
@@ -9,6 +9,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/bytes.h"
 
+#include <openssl/aes.h>
+
 namespace Storage {
 
 constexpr auto kSaltSize = size_type(64);
@@ -32,7 +34,9 @@ private:
 
 	static constexpr auto EcountSize = kBlockSize;
 
-	bytes::array<kKeySize> _key;
+	// The key schedule is expanded once here instead of on each
+	// encrypt() / decrypt() call, most of which process a few blocks.
+	AES_KEY _aes;
 	bytes::array<kIvSize> _iv;
 
 };
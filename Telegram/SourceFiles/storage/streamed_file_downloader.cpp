@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "media/streaming/media_streaming_loader.h"
 #include "media/streaming/media_streaming_reader.h"
+#include "ui/ui_utility.h"
 
 namespace Storage {
 namespace {
@@ -20,6 +21,46 @@ constexpr auto kRequestPartsCount = 8;
 
 } // namespace
 
+class StreamedFileDownloader::Writer final {
+public:
+	Writer(crl::weak_on_queue<Writer> weak, const QString &path);
+
+	[[nodiscard]] bool write(int offset, const QByteArray &bytes);
+	void close(bool removeFile);
+
+private:
+	QFile _file;
+
+};
+
+StreamedFileDownloader::Writer::Writer(
+	crl::weak_on_queue<Writer> weak,
+	const QString &path)
+: _file(path) {
+	// The file was created (and truncated) already by FileLoader::start,
+	// so we only write parts to their positions in it.
+	if (!_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+		LOG(("Streaming Error: Could not open '%1' for writing."
+			).arg(path));
+	}
+}
+
+bool StreamedFileDownloader::Writer::write(
+		int offset,
+		const QByteArray &bytes) {
+	return _file.isOpen()
+		&& _file.seek(offset)
+		&& (_file.write(bytes) == qint64(bytes.size()));
+}
+
+void StreamedFileDownloader::Writer::close(bool removeFile) {
+	_file.close();
+	if (removeFile) {
+		// FileLoader could not remove it while we still had it open.
+		_file.remove();
+	}
+}
+
 StreamedFileDownloader::StreamedFileDownloader(
 	uint64 objectId,
 	MTP::DcId dcId,
@@ -51,6 +92,7 @@ StreamedFileDownloader::StreamedFileDownloader(
 , _reader(std::move(reader))
 , _partsCount((size + kPartSize - 1) / kPartSize) {
 	_partIsSaved.resize(_partsCount, false);
+	_partIsWritten.resize(_partsCount, false);
 
 	_reader->partsForDownloader(
 	) | rpl::start_with_next([=](const LoadedPart &part) {
@@ -74,6 +116,10 @@ Data::FileOrigin StreamedFileDownloader::fileOrigin() const {
 	return _origin;
 }
 
+int StreamedFileDownloader::currentOffset() const {
+	return _bytesWritten;
+}
+
 void StreamedFileDownloader::requestParts() {
 	while (!_finished
 		&& _nextPartIndex < _partsCount
@@ -104,7 +150,7 @@ QByteArray StreamedFileDownloader::readLoadedPart(int offset) {
 	Expects(!(offset % kPartSize));
 
 	const auto index = (offset / kPartSize);
-	return _partIsSaved[index]
+	return _partIsWritten[index]
 		? readLoadedPartBack(offset, kPartSize)
 		: QByteArray();
 }
@@ -121,13 +167,35 @@ void StreamedFileDownloader::cancelHook() {
 	_partsRequested = 0;
 	_nextPartIndex = 0;
 
+	// All pending writes are finished on the queue before the removal.
+	closeWriter(true);
+
 	_reader->cancelForDownloader(this);
 }
 
 void StreamedFileDownloader::startLoading() {
+	if (_fileIsOpen && !_writer) {
+		_writer = std::make_unique<crl::object_on_queue<Writer>>(_filename);
+	}
 	requestParts();
 }
 
+void StreamedFileDownloader::closeWriter(
+		bool removeFile,
+		Fn<void()> closed) {
+	if (!_writer) {
+		return;
+	}
+	const auto weak = Ui::MakeWeak(this);
+	_writer->with([=](Writer &writer) {
+		writer.close(removeFile);
+		if (closed) {
+			crl::on_main(weak, closed);
+		}
+	});
+	_writer = nullptr;
+}
+
 void StreamedFileDownloader::savePart(const LoadedPart &part) {
 	Expects(part.offset >= 0 && part.offset < _reader->size());
 	Expects(part.offset % kPartSize == 0);
@@ -148,13 +216,51 @@ void StreamedFileDownloader::savePart(const LoadedPart &part) {
 	if (index < _nextPartIndex) {
 		--_partsRequested;
 	}
+	const auto size = int(part.bytes.size());
+	if (_writer) {
+		// The bytes are shared with the Reader, not copied.
+		const auto weak = Ui::MakeWeak(this);
+		_writer->with([=, bytes = part.bytes](Writer &writer) {
+			const auto success = writer.write(offset, bytes);
+			crl::on_main(weak, [=] {
+				if (success) {
+					partWritten(offset, size);
+				} else if (!_finished) {
+					cancel(true);
+				}
+			});
+		});
+		requestParts();
+		return;
+	}
 	if (!writeResultPart(offset, bytes::make_span(part.bytes))) {
 		return;
 	}
-	if (_partsSaved == _partsCount) {
-		if (!finalizeResult()) {
-			return;
-		}
+	partWritten(offset, size);
+}
+
+void StreamedFileDownloader::partWritten(int offset, int size) {
+	if (_finished || _cancelled) {
+		return;
+	}
+	const auto index = offset / kPartSize;
+	_partIsWritten[index] = true;
+	_bytesWritten += size;
+	if (++_partsWritten == _partsCount && _writer) {
+		// Finalize only after the queue has released the file.
+		closeWriter(false, [=] {
+			if (!_finished && !_cancelled) {
+				partDone(offset);
+			}
+		});
+		return;
+	}
+	partDone(offset);
+}
+
+void StreamedFileDownloader::partDone(int offset) {
+	if (_partsWritten == _partsCount && !finalizeResult()) {
+		return;
 	}
 	_reader->doneForDownloader(offset);
 	requestParts();
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/cache/storage_cache_types.h"
 #include "data/data_file_origin.h"
 
+#include <crl/crl_object_on_queue.h>
+
 namespace Media {
 namespace Streaming {
 class Reader;
@@ -42,10 +44,13 @@ public:
 
 	uint64 objId() const override;
 	Data::FileOrigin fileOrigin() const override;
+	int currentOffset() const override;
 
 	QByteArray readLoadedPart(int offset);
 
 private:
+	class Writer;
+
 	void startLoading() override;
 	Cache::Key cacheKey() const override;
 	std::optional<MediaKey> fileLocationKey() const override;
@@ -54,6 +59,9 @@ private:
 	void requestPart();
 
 	void savePart(const Media::Streaming::LoadedPart &part);
+	void partWritten(int offset, int size);
+	void partDone(int offset);
+	void closeWriter(bool removeFile, Fn<void()> closed = nullptr);
 
 	uint64 _objectId = 0;
 	Data::FileOrigin _origin;
@@ -61,11 +69,18 @@ private:
 	MediaKey _fileLocationKey;
 	std::shared_ptr<Media::Streaming::Reader> _reader;
 
+	// Parts are written to disk on a separate queue, so a part can be
+	// already received (saved) while it is not in the file yet (written).
+	std::unique_ptr<crl::object_on_queue<Writer>> _writer;
+
 	std::vector<bool> _partIsSaved; // vector<bool> :D
+	std::vector<bool> _partIsWritten;
 	mutable int _nextPartIndex = 0;
 	int _partsCount = 0;
 	int _partsRequested = 0;
 	int _partsSaved = 0;
+	int _partsWritten = 0;
+	int _bytesWritten = 0;
 
 	rpl::lifetime _lifetime;
 
@@ -506,7 +506,19 @@ void Templates::load() {
 
 void Templates::setData(TemplatesData &&data) {
 	_data = std::move(data);
+	refreshKeys();
+}
+
+void Templates::refreshKeys() {
 	_maxKeyLength = CountMaxKeyLength(_data);
+	_keys.clear();
+	for (const auto &[path, file] : _data.files) {
+		for (const auto &[normalized, question] : file.questions) {
+			for (const auto &key : question.normalizedKeys) {
+				_keys.emplace(key, QuestionByKey{ question, key });
+			}
+		}
+	}
 }
 
 void Templates::ensureUpdatesCreated() {
@@ -597,6 +609,7 @@ void Templates::updateRequestFinished(QNetworkReply *reply) {
 				_session->data().serviceNotification({ full });
 			}
 			_data.files.at(path) = std::move(one.files.at(path));
+			refreshKeys();
 
 			_updates->requests.erase(path);
 			checkUpdateFinished();
@@ -620,18 +633,11 @@ auto Templates::matchExact(QString query) const
 		return {};
 	}
 
-	query = NormalizeKey(query);
-
-	for (const auto &[path, file] : _data.files) {
-		for (const auto &[normalized, question] : file.questions) {
-			for (const auto &key : question.normalizedKeys) {
-				if (key == query) {
-					return QuestionByKey{ question, key };
-				}
-			}
-		}
+	const auto i = _keys.find(NormalizeKey(query));
+	if (i == end(_keys)) {
+		return {};
 	}
-	return {};
+	return i->second;
 }
 
 auto Templates::matchFromEnd(QString query) const
@@ -647,19 +653,14 @@ auto Templates::matchFromEnd(QString query) const
 		queries.push_back(NormalizeKey(query.mid(size - i - 1)));
 	}
 
-	auto result = std::optional<QuestionByKey>();
-	for (const auto &[path, file] : _data.files) {
-		for (const auto &[normalized, question] : file.questions) {
-			for (const auto &key : question.normalizedKeys) {
-				if (key.size() <= queries.size()
-					&& queries[key.size() - 1] == key
-					&& (!result || result->key.size() <= key.size())) {
-					result = QuestionByKey{ question, key };
-				}
-			}
+	// The longest key matching the end of the query wins.
+	for (auto length = size; length != 0; --length) {
+		const auto i = _keys.find(queries[length - 1]);
+		if (i != end(_keys) && i->first.size() == length) {
+			return i->second;
 		}
 	}
-	return result;
+	return {};
 }
 
 Templates::~Templates() = default;
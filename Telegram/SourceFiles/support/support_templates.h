@@ -78,6 +78,7 @@ private:
 	void updateRequestFinished(QNetworkReply *reply);
 	void checkUpdateFinished();
 	void setData(details::TemplatesData &&data);
+	void refreshKeys();
 
 	not_null<Main::Session*> _session;
 
@@ -89,6 +90,7 @@ private:
 	rpl::lifetime _reloadToastSubscription;
 
 	int _maxKeyLength = 0;
+	std::map<QString, QuestionByKey> _keys;
 
 	std::unique_ptr<Updates> _updates;
 
@@ -16,6 +16,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Ui {
 namespace {
 
+// Drawing the letters is slow, so the painted userpics are cached.
+// When their pixmaps don't fit in this limit the least recently used
+// ones are dropped.
+constexpr auto kCachedBytesLimit = 32 * 1024 * 1024;
+constexpr auto kCachedSizesLimit = 4;
+
+auto CachedBytes = 0;
+
+[[nodiscard]] int CachedBytesForSize(int size) {
+	const auto side = size * cIntRetinaFactor();
+	return side * side * 4;
+}
+
 void PaintSavedMessagesInner(
 		Painter &p,
 		int x,
@@ -143,21 +156,110 @@ void EmptyUserpic::paint(
 		int y,
 		int outerWidth,
 		int size) const {
-	paint(p, x, y, outerWidth, size, [&p, x, y, size] {
-		p.drawEllipse(x, y, size, size);
-	});
+	paintCached(p, x, y, outerWidth, size, Shape::Circle);
 }
 
 void EmptyUserpic::paintRounded(Painter &p, int x, int y, int outerWidth, int size) const {
-	paint(p, x, y, outerWidth, size, [&p, x, y, size] {
-		p.drawRoundedRect(x, y, size, size, st::buttonRadius, st::buttonRadius);
-	});
+	paintCached(p, x, y, outerWidth, size, Shape::Rounded);
 }
 
 void EmptyUserpic::paintSquare(Painter &p, int x, int y, int outerWidth, int size) const {
-	paint(p, x, y, outerWidth, size, [&p, x, y, size] {
-		p.fillRect(x, y, size, size, p.brush());
-	});
+	paintCached(p, x, y, outerWidth, size, Shape::Square);
+}
+
+void EmptyUserpic::paintCached(
+		Painter &p,
+		int x,
+		int y,
+		int outerWidth,
+		int size,
+		Shape shape) const {
+	const auto background = _color->c.rgba();
+	const auto foreground = st::historyPeerUserpicFg->c.rgba();
+	const auto key = std::make_pair(size, shape);
+	auto i = _cache.find(key);
+	if (i != end(_cache)
+		&& (i->second.background != background
+			|| i->second.foreground != foreground)) {
+		// The palette has changed.
+		clearCache();
+		i = end(_cache);
+	}
+	auto &uses = Uses();
+	if (i == end(_cache)) {
+		const auto bytes = CachedBytesForSize(size);
+		if (bytes > kCachedBytesLimit) {
+			paintShape(p, x, y, outerWidth, size, shape);
+			return;
+		} else if (int(_cache.size()) >= kCachedSizesLimit) {
+			clearCache();
+		}
+		while (CachedBytes + bytes > kCachedBytesLimit) {
+			const auto &oldest = uses.front();
+			oldest.owner->forgetCached(oldest.key);
+		}
+		auto pixmap = Generate(size, [&](Painter &q) {
+			paintShape(q, 0, 0, size, size, shape);
+		});
+		CachedBytes += bytes;
+		const auto use = uses.insert(end(uses), CacheUse{ this, key });
+		i = _cache.emplace(
+			key,
+			Cached{ std::move(pixmap), background, foreground, use }).first;
+	} else {
+		uses.splice(end(uses), uses, i->second.use);
+	}
+	p.drawPixmapLeft(x, y, outerWidth, i->second.pixmap);
+}
+
+void EmptyUserpic::paintShape(
+		Painter &p,
+		int x,
+		int y,
+		int outerWidth,
+		int size,
+		Shape shape) const {
+	switch (shape) {
+	case Shape::Circle:
+		paint(p, x, y, outerWidth, size, [&p, x, y, size] {
+			p.drawEllipse(x, y, size, size);
+		});
+		return;
+	case Shape::Rounded:
+		paint(p, x, y, outerWidth, size, [&p, x, y, size] {
+			p.drawRoundedRect(x, y, size, size, st::buttonRadius, st::buttonRadius);
+		});
+		return;
+	case Shape::Square:
+		paint(p, x, y, outerWidth, size, [&p, x, y, size] {
+			p.fillRect(x, y, size, size, p.brush());
+		});
+		return;
+	}
+	Unexpected("Shape in EmptyUserpic::paintShape.");
+}
+
+auto EmptyUserpic::Uses() -> CacheUses & {
+	static auto result = CacheUses();
+	return result;
+}
+
+void EmptyUserpic::forgetCached(CacheKey key) const {
+	const auto i = _cache.find(key);
+	Assert(i != end(_cache));
+
+	CachedBytes -= CachedBytesForSize(key.first);
+	Uses().erase(i->second.use);
+	_cache.erase(i);
+}
+
+void EmptyUserpic::clearCache() const {
+	auto &uses = Uses();
+	for (const auto &[key, cached] : _cache) {
+		CachedBytes -= CachedBytesForSize(key.first);
+		uses.erase(cached.use);
+	}
+	_cache.clear();
 }
 
 void EmptyUserpic::PaintSavedMessages(
@@ -307,6 +409,8 @@ void EmptyUserpic::fillString(const QString &name) {
 	_string = _string.toUpper();
 }
 
-EmptyUserpic::~EmptyUserpic() = default;
+EmptyUserpic::~EmptyUserpic() {
+	clearCache();
+}
 
 } // namespace Ui
@@ -7,11 +7,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include <list>
+
 namespace Ui {
 
 class EmptyUserpic {
 public:
 	EmptyUserpic(const style::color &color, const QString &name);
+	EmptyUserpic(const EmptyUserpic &other) = delete;
+	EmptyUserpic &operator=(const EmptyUserpic &other) = delete;
 
 	void paint(
 		Painter &p,
@@ -68,6 +72,44 @@ public:
 	~EmptyUserpic();
 
 private:
+	enum class Shape : uchar {
+		Circle,
+		Rounded,
+		Square,
+	};
+	using CacheKey = std::pair<int, Shape>;
+	struct CacheUse {
+		not_null<const EmptyUserpic*> owner;
+		CacheKey key;
+	};
+	using CacheUses = std::list<CacheUse>;
+	struct Cached {
+		QPixmap pixmap;
+		QRgb background = 0;
+		QRgb foreground = 0;
+		CacheUses::iterator use;
+	};
+
+	// Cached pixmaps of all the userpics, the least recently used first.
+	[[nodiscard]] static CacheUses &Uses();
+
+	void paintCached(
+		Painter &p,
+		int x,
+		int y,
+		int outerWidth,
+		int size,
+		Shape shape) const;
+	void paintShape(
+		Painter &p,
+		int x,
+		int y,
+		int outerWidth,
+		int size,
+		Shape shape) const;
+	void forgetCached(CacheKey key) const;
+	void clearCache() const;
+
 	template <typename Callback>
 	void paint(
 		Painter &p,
@@ -81,6 +123,7 @@ private:
 
 	style::color _color;
 	QString _string;
+	mutable base::flat_map<CacheKey, Cached> _cache;
 
 };
 
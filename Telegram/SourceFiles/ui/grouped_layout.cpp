@@ -10,6 +10,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace Ui {
 namespace {
 
+constexpr auto kLayoutCacheSize = 64;
+
+struct LayoutCacheEntry {
+	std::vector<QSize> sizes;
+	int maxWidth = 0;
+	int minWidth = 0;
+	int spacing = 0;
+	std::vector<GroupMediaLayout> layout;
+};
+
 int Round(float64 value) {
 	return int(std::round(value));
 }
@@ -572,7 +582,25 @@ std::vector<GroupMediaLayout> LayoutMediaGroup(
 		int maxWidth,
 		int minWidth,
 		int spacing) {
-	return Layouter(sizes, maxWidth, minWidth, spacing).layout();
+	// Album views are recreated and get their dimensions initialized
+	// again and again while scrolling, the layout for the same sizes
+	// stays the same, while computing it for large albums is not instant.
+	static auto cache = std::vector<LayoutCacheEntry>();
+	const auto i = ranges::find_if(cache, [&](const LayoutCacheEntry &e) {
+		return (e.maxWidth == maxWidth)
+			&& (e.minWidth == minWidth)
+			&& (e.spacing == spacing)
+			&& (e.sizes == sizes);
+	});
+	if (i != end(cache)) {
+		return i->layout;
+	}
+	auto result = Layouter(sizes, maxWidth, minWidth, spacing).layout();
+	if (cache.size() == kLayoutCacheSize) {
+		cache.erase(begin(cache));
+	}
+	cache.push_back({ sizes, maxWidth, minWidth, spacing, result });
+	return result;
 }
 
 RectParts GetCornersFromSides(RectParts sides) {
@@ -24,6 +24,10 @@ namespace {
 // After 128 MB of unpacked images we try to clear some memory.
 constexpr auto kMemoryForCache = 128 * 1024 * 1024;
 
+// Scaled and rounded variants of all images share a separate budget,
+// least recently painted variants are dropped one by one.
+constexpr auto kMemoryForScaled = 64 * 1024 * 1024;
+
 std::map<QString, std::unique_ptr<Image>> LocalFileImages;
 std::map<QString, std::unique_ptr<Image>> WebUrlImages;
 std::unordered_map<InMemoryKey, std::unique_ptr<Image>> StorageImages;
@@ -44,6 +48,7 @@ int64 ComputeUsage(const QImage &image) {
 
 [[nodiscard]] Core::MediaActiveCache<const Image> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<const Image>(
+		"images",
 		kMemoryForCache,
 		[](const Image *image) { image->unload(); });
 	return Instance;
@@ -555,15 +560,13 @@ const QPixmap &Image::pix(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::None;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixRounded(
@@ -594,15 +597,13 @@ const QPixmap &Image::pixRounded(
 	} else if (radius == ImageRoundRadius::Ellipse) {
 		options |= Option::Circled | cornerOptions(corners);
 	}
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixCircled(
@@ -618,15 +619,13 @@ const QPixmap &Image::pixCircled(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Circled;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredCircled(
@@ -642,15 +641,13 @@ const QPixmap &Image::pixBlurredCircled(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Circled | Option::Blurred;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurred(
@@ -666,15 +663,13 @@ const QPixmap &Image::pixBlurred(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Blurred;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixColored(
@@ -691,15 +686,13 @@ const QPixmap &Image::pixColored(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Colored;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixColoredNoCache(origin, add, w, h, true);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixColoredNoCache(origin, add, w, h, true);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredColored(
@@ -716,15 +709,13 @@ const QPixmap &Image::pixBlurredColored(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Blurred | Option::Smooth | Option::Colored;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixBlurredColoredNoCache(origin, add, w, h);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = findCached(k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixBlurredColoredNoCache(origin, add, w, h);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixSingle(
@@ -763,18 +754,16 @@ const QPixmap &Image::pixSingle(
 		options |= Option::Colored;
 	}
 
-	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = SinglePixKey(options);
+	const auto cached = findCached(k);
+	if (cached
+		&& cached->width() == (outerw * cIntRetinaFactor())
+		&& cached->height() == (outerh * cIntRetinaFactor())) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredSingle(
@@ -809,18 +798,16 @@ const QPixmap &Image::pixBlurredSingle(
 		options |= Option::Circled | cornerOptions(corners);
 	}
 
-	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = SinglePixKey(options);
+	const auto cached = findCached(k);
+	if (cached
+		&& cached->width() == (outerw * cIntRetinaFactor())
+		&& cached->height() == (outerh * cIntRetinaFactor())) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return storeCached(k, std::move(p));
 }
 
 QPixmap Image::pixNoCache(
@@ -883,6 +870,7 @@ QPixmap Image::pixNoCache(
 		return App::pixmapFromImageInPlace(std::move(result));
 	}
 
+	const auto span = Logs::TraceSpan("image", "prepare");
 	return App::pixmapFromImageInPlace(prepare(_data, w, h, options, outerw, outerh, colored));
 }
 
@@ -932,7 +920,7 @@ QPixmap Image::pixBlurredColoredNoCache(
 		img = img.scaled(w, h, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 	}
 
-	return App::pixmapFromImageInPlace(prepareColored(add, img));
+	return App::pixmapFromImageInPlace(prepareColored(add, std::move(img)));
 }
 
 QImage Image::original() const {
@@ -1001,10 +989,55 @@ void Image::setImageBytes(const QByteArray &bytes) {
 	checkSource();
 }
 
+Core::MediaActiveCache<const Image::Scaled> &Image::ScaledCache() {
+	static auto Instance = Core::MediaActiveCache<const Scaled>(
+		"scaled images",
+		kMemoryForScaled,
+		[](const Scaled *scaled) {
+			scaled->owner->forgetCached(scaled->key);
+		});
+	return Instance;
+}
+
+const QPixmap *Image::findCached(uint64 key) const {
+	const auto i = _sizesCache.find(key);
+	if (i == end(_sizesCache)) {
+		return nullptr;
+	}
+	ScaledCache().up(&i->second);
+	return &i->second.pixmap;
+}
+
+const QPixmap &Image::storeCached(uint64 key, QPixmap &&pixmap) const {
+	auto &cache = ScaledCache();
+	const auto i = _sizesCache.find(key);
+	if (i != end(_sizesCache)) {
+		cache.decrement(ComputeUsage(i->second.pixmap));
+		cache.remove(&i->second);
+		_sizesCache.erase(i);
+	}
+	auto &scaled = _sizesCache.emplace(
+		key,
+		Scaled{ std::move(pixmap), this, key }
+	).first->second;
+	cache.increment(ComputeUsage(scaled.pixmap));
+	cache.up(&scaled);
+	return scaled.pixmap;
+}
+
+void Image::forgetCached(uint64 key) const {
+	const auto i = _sizesCache.find(key);
+	if (i != end(_sizesCache)) {
+		ScaledCache().decrement(ComputeUsage(i->second.pixmap));
+		_sizesCache.erase(i);
+	}
+}
+
 void Image::invalidateSizeCache() const {
-	auto &cache = ActiveCache();
-	for (const auto &image : std::as_const(_sizesCache)) {
-		cache.decrement(ComputeUsage(image));
+	auto &cache = ScaledCache();
+	for (const auto &[key, scaled] : _sizesCache) {
+		cache.decrement(ComputeUsage(scaled.pixmap));
+		cache.remove(&scaled);
 	}
 	_sizesCache.clear();
 }
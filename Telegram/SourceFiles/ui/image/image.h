@@ -11,6 +11,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 class HistoryItem;
 
+namespace Core {
+template <typename Type>
+class MediaActiveCache;
+} // namespace Core
+
 namespace Images {
 
 void ClearRemote();
@@ -233,11 +238,22 @@ public:
 	~Image();
 
 private:
+	struct Scaled {
+		QPixmap pixmap;
+		not_null<const Image*> owner;
+		uint64 key = 0;
+	};
+
+	[[nodiscard]] static Core::MediaActiveCache<const Scaled> &ScaledCache();
+
 	void checkSource() const;
 	void invalidateSizeCache() const;
+	[[nodiscard]] const QPixmap *findCached(uint64 key) const;
+	const QPixmap &storeCached(uint64 key, QPixmap &&pixmap) const;
+	void forgetCached(uint64 key) const;
 
 	std::unique_ptr<Images::Source> _source;
-	mutable QMap<uint64, QPixmap> _sizesCache;
+	mutable std::map<uint64, Scaled> _sizesCache;
 	mutable QImage _data;
 
 };
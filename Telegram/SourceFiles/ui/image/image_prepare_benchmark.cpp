@@ -0,0 +1,187 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "ui/image/image_prepare.h"
+#include "ui/integration.h"
+#include "ui/style/style_core.h"
+#include "styles/palette.h"
+
+#include <QtGui/QGuiApplication>
+#include <QtGui/QImage>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Usage: benchmark_images [iterations] [-platform offscreen]
+//
+// Runs the Images::prepare steps Image::pixSingle() and its blurred and
+// colored variants use for message media on the typical thumbnails:
+// scaling a small 90px thumbnail up to a 320px bubble, the box blur on
+// both sizes, the rounded corner and circle masks and the colorize step.
+// The last case is the whole blurred and rounded preview preparation.
+//
+// The kernels live in lib_ui. The generated images use fixed random
+// seeds, so the numbers of different lib_ui versions are comparable.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Option = Images::Option;
+
+constexpr auto kDefaultIterations = 500;
+constexpr auto kSmallWidth = 90;
+constexpr auto kSmallHeight = 68;
+constexpr auto kLargeWidth = 320;
+constexpr auto kLargeHeight = 240;
+
+// The benchmark has no widgets and no application to postpone calls to.
+class BenchmarkIntegration final : public Ui::Integration {
+public:
+	void postponeCall(FnMut<void()> &&callable) override {
+		callable();
+	}
+	void registerLeaveSubscription(not_null<QWidget*> widget) override {
+	}
+	void unregisterLeaveSubscription(not_null<QWidget*> widget) override {
+	}
+
+	void writeLogEntry(const QString &entry) override {
+		std::fprintf(stderr, "%s\n", entry.toUtf8().constData());
+	}
+	QString emojiCacheFolder() override {
+		return QString();
+	}
+
+};
+
+// A gradient with noise, so that the scaling and the blur don't work on
+// flat areas only, like they would on a solid color.
+QImage GenerateThumbnail(int width, int height, uint32 seed) {
+	auto generator = std::mt19937(seed);
+	auto result = QImage(
+		width,
+		height,
+		QImage::Format_ARGB32_Premultiplied);
+	for (auto y = 0; y != height; ++y) {
+		const auto line = reinterpret_cast<uint32*>(result.scanLine(y));
+		for (auto x = 0; x != width; ++x) {
+			const auto noise = uint32(generator() % 64);
+			const auto r = (x * 191 / width) + noise;
+			const auto g = (y * 191 / height) + noise;
+			const auto b = ((x + y) * 95 / (width + height)) + noise;
+			line[x] = 0xFF000000U | (r << 16) | (g << 8) | b;
+		}
+	}
+	return result;
+}
+
+double SecondsSince(Clock::time_point started) {
+	using namespace std::chrono;
+	return duration_cast<duration<double>>(Clock::now() - started).count();
+}
+
+void Report(const char *name, int count, double seconds) {
+	std::printf(
+		"%-28s %10d ops %10.3f s %10.0f us/op\n",
+		name,
+		count,
+		seconds,
+		count ? (seconds * 1e6 / count) : 0.);
+}
+
+// Each iteration starts from its own copy, so that the in place steps
+// don't work on their previous result and the copy is not measured.
+template <typename Method>
+void Benchmark(
+		const char *name,
+		const QImage &source,
+		int iterations,
+		Method method) {
+	auto copies = std::vector<QImage>();
+	copies.reserve(iterations);
+	for (auto i = 0; i != iterations; ++i) {
+		copies.push_back(source.copy());
+	}
+	auto checksum = uint32();
+	const auto started = Clock::now();
+	for (auto &copy : copies) {
+		const auto result = method(std::move(copy));
+		checksum += *reinterpret_cast<const uint32*>(result.constBits());
+	}
+	Report(name, iterations, SecondsSince(started));
+	std::printf("%-28s %10u checksum\n", "", checksum);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+	QGuiApplication application(argc, argv);
+
+	const auto iterations = [&] {
+		const auto value = (argc > 1)
+			? QString::fromLatin1(argv[1]).toInt()
+			: 0;
+		return (value > 0) ? value : kDefaultIterations;
+	}();
+	std::printf("iterations: %d\n", iterations);
+
+	auto integration = BenchmarkIntegration();
+	Ui::Integration::Set(&integration);
+	style::internal::StartFonts();
+	style::startManager(style::kScaleDefault);
+
+	const auto small = GenerateThumbnail(kSmallWidth, kSmallHeight, 1);
+	const auto large = GenerateThumbnail(kLargeWidth, kLargeHeight, 2);
+
+	Benchmark("scale 90 to 320", small, iterations, [](QImage image) {
+		return Images::prepare(
+			std::move(image),
+			kLargeWidth,
+			kLargeHeight,
+			Option::Smooth,
+			kLargeWidth,
+			kLargeHeight);
+	});
+	Benchmark("blur 90", small, iterations, [](QImage image) {
+		return Images::prepareBlur(std::move(image));
+	});
+	Benchmark("blur 320", large, iterations, [](QImage image) {
+		return Images::prepareBlur(std::move(image));
+	});
+	Benchmark("round small 320", large, iterations, [](QImage image) {
+		Images::prepareRound(image, ImageRoundRadius::Small);
+		return image;
+	});
+	Benchmark("round large 320", large, iterations, [](QImage image) {
+		Images::prepareRound(image, ImageRoundRadius::Large);
+		return image;
+	});
+	Benchmark("circle 320", large, iterations, [](QImage image) {
+		Images::prepareCircle(image);
+		return image;
+	});
+	Benchmark("colorize 320", large, iterations, [](QImage image) {
+		return Images::prepareColored(st::windowBgOver, std::move(image));
+	});
+	Benchmark("blurred preview 90 to 320", small, iterations, [](
+			QImage image) {
+		return Images::prepare(
+			std::move(image),
+			kLargeWidth,
+			kLargeHeight,
+			(Option::Smooth
+				| Option::Blurred
+				| Option::RoundedLarge
+				| Option::RoundedAll),
+			kLargeWidth,
+			kLargeHeight);
+	});
+
+	style::stopManager();
+	return 0;
+}
@@ -283,6 +283,9 @@ QImage RemoteSource::takeLoaded() {
 		_cancelled = true;
 		destroyLoader();
 		return QImage();
+	} else if (!_loader->prepareImageData(shrinkBox())) {
+		// Keep the placeholder painted until the image is decoded.
+		return QImage();
 	}
 	auto data = _loader->imageData(shrinkBox());
 	if (data.isNull()) {
@@ -379,6 +382,8 @@ void RemoteSource::load(Data::FileOrigin origin) {
 		_loader = createLoader(origin, LoadFromCloudOrLocal, false);
 	}
 	if (_loader) {
+		// Images are loaded when they're painted.
+		_loader->setDownloadClass(Storage::DownloadClass::Visible);
 		_loader->start();
 	}
 }
@@ -46,6 +46,7 @@ namespace Window {
 namespace {
 
 constexpr auto kSaveWindowPositionTimeout = crl::time(1000);
+constexpr auto kUnreadCounterUpdateDelay = crl::time(200);
 
 } // namespace
 
@@ -162,6 +163,7 @@ MainWindow::MainWindow(not_null<Controller*> controller)
 	}
 
 	_isActiveTimer.setCallback([this] { updateIsActive(0); });
+	_unreadCounterTimer.setCallback([this] { updateUnreadCounter(); });
 }
 
 Main::Account &MainWindow::account() const {
@@ -286,8 +288,17 @@ void MainWindow::updateIsActive(int timeout) {
 	if (timeout > 0) {
 		return _isActiveTimer.callOnce(timeout);
 	}
+	const auto wasActive = _isActive;
 	_isActive = computeIsActive();
 	updateIsActiveHook();
+
+	// Paused gifs, stickers and round videos depend on the window being
+	// active, let them stop or resume right away instead of on repaint.
+	if (_isActive != wasActive) {
+		if (const auto controller = sessionController()) {
+			controller->gifPauseLevelChanged().notify();
+		}
+	}
 }
 
 bool MainWindow::computeIsActive() const {
@@ -503,9 +514,30 @@ void MainWindow::updateControlsGeometry() {
 void MainWindow::updateUnreadCounter() {
 	if (!Global::started() || App::quitting()) return;
 
+	// Counter changes come in bursts, apply at most one in a while.
+	const auto passed = crl::now() - _unreadCounterUpdated;
+	if (passed >= 0 && passed < kUnreadCounterUpdateDelay) {
+		if (!_unreadCounterTimer.isActive()) {
+			_unreadCounterTimer.callOnce(kUnreadCounterUpdateDelay - passed);
+		}
+		return;
+	}
+	_unreadCounterTimer.cancel();
+
 	const auto counter = account().sessionExists()
 		? account().session().data().unreadBadge()
 		: 0;
+	const auto muted = account().sessionExists()
+		&& account().session().data().unreadBadgeMuted();
+
+	// Rendering the tray and taskbar icons is expensive,
+	// skip it while the displayed badge stays the same.
+	if (_unreadBadge == counter && _unreadBadgeMuted == muted) {
+		return;
+	}
+	_unreadBadge = counter;
+	_unreadBadgeMuted = muted;
+	_unreadCounterUpdated = crl::now();
 	_titleText = (counter > 0) ? qsl("Telegram (%1)").arg(counter) : qsl("Telegram");
 
 	unreadCounterChangedHook();
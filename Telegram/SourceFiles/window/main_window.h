@@ -182,6 +182,10 @@ private:
 	QIcon _icon;
 	bool _usingSupportIcon = false;
 	QString _titleText;
+	int _unreadBadge = -1;
+	bool _unreadBadgeMuted = false;
+	crl::time _unreadCounterUpdated = 0;
+	base::Timer _unreadCounterTimer;
 
 	bool _isActive = false;
 	base::Timer _isActiveTimer;
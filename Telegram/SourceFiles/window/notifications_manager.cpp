@@ -429,7 +429,9 @@ void System::showNext() {
 					// then there is no reason to wait for the timer
 					// to show the previous notification.
 					showGrouped();
-					_manager->showNotification(notifyItem, forwardedCount);
+					_manager->showNotification(
+						coalesceDue(history, notifyItem, ms),
+						forwardedCount);
 				}
 
 				if (!history->hasNotification()) {
@@ -447,6 +449,41 @@ void System::showNext() {
 	}
 }
 
+not_null<HistoryItem*> System::coalesceDue(
+		not_null<History*> history,
+		not_null<HistoryItem*> item,
+		crl::time now) {
+	// When many messages in one history are already due, for example
+	// after a reconnect, only the newest of them is shown.
+	const auto j = _whenMaps.find(history);
+	if (j == _whenMaps.end()) {
+		return item;
+	}
+	auto result = item;
+	while (const auto next = history->currentNotification()) {
+		if (next->groupId() || next->Has<HistoryMessageForwarded>()) {
+			break;
+		}
+		const auto k = j.value().find(next->id);
+		if (k == j.value().end() || k.value() > now) {
+			break;
+		}
+		result = next;
+		j.value().erase(k);
+		history->skipNotification();
+		while (history->hasNotification()) {
+			const auto id = history->currentNotification()->id;
+			const auto l = j.value().constFind(id);
+			if (l != j.value().cend()) {
+				_waiters.insert(history, Waiter(l.key(), l.value(), 0));
+				break;
+			}
+			history->skipNotification();
+		}
+	}
+	return result;
+}
+
 void System::ensureSoundCreated() {
 	if (_soundTrack) {
 		return;
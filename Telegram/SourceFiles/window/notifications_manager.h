@@ -97,6 +97,10 @@ private:
 
 	void showNext();
 	void showGrouped();
+	[[nodiscard]] not_null<HistoryItem*> coalesceDue(
+		not_null<History*> history,
+		not_null<HistoryItem*> item,
+		crl::time now);
 	void ensureSoundCreated();
 
 	not_null<Main::Session*> _session;
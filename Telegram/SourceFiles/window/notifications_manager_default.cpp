@@ -306,7 +306,19 @@ void Manager::removeWidget(internal::Widget *remove) {
 void Manager::doShowNotification(
 		not_null<HistoryItem*> item,
 		int forwardedCount) {
-	_queuedNotifications.emplace_back(item, forwardedCount);
+	// A newer notification replaces the one still waiting in the queue
+	// for the same history, so a burst doesn't create a widget for each.
+	const auto i = ranges::find(
+		_queuedNotifications,
+		item->history(),
+		&QueuedNotification::history);
+	if (i != end(_queuedNotifications)
+		&& i->forwardedCount < 2
+		&& forwardedCount < 2) {
+		*i = QueuedNotification(item, forwardedCount);
+	} else {
+		_queuedNotifications.emplace_back(item, forwardedCount);
+	}
 	showNextFromQueue();
 }
 
@@ -40,6 +40,11 @@ constexpr auto kBackgroundSizeLimit = 25 * 1024 * 1024;
 constexpr auto kNightThemeFile = str_const(":/gui/night.tdesktop-theme");
 constexpr auto kMinimumTiledSize = 512;
 
+// Cached backgrounds are kept as raw premultiplied pixels after this tag,
+// older caches have the background encoded in some image format.
+constexpr auto kRawBackgroundTag = quint32(0x54445242U); // 'TDRB'
+constexpr auto kRawBackgroundHeaderSize = 16;
+
 struct Applying {
 	Saved data;
 	QByteArray paletteForRevert;
@@ -67,6 +72,66 @@ bool CalculateIsMonoColorImage(const QImage &image) {
 	return false;
 }
 
+[[nodiscard]] QByteArray SerializeBackground(QImage image) {
+	if (image.format() != QImage::Format_ARGB32_Premultiplied) {
+		image = std::move(image).convertToFormat(
+			QImage::Format_ARGB32_Premultiplied);
+	}
+	const auto perLine = image.width() * 4;
+	auto result = QByteArray(
+		kRawBackgroundHeaderSize + perLine * image.height(),
+		Qt::Uninitialized);
+	const auto header = reinterpret_cast<quint32*>(result.data());
+	header[0] = kRawBackgroundTag;
+	header[1] = quint32(image.width());
+	header[2] = quint32(image.height());
+	header[3] = quint32(perLine);
+	auto to = result.data() + kRawBackgroundHeaderSize;
+	for (auto y = 0; y != image.height(); ++y, to += perLine) {
+		memcpy(to, image.constScanLine(y), perLine);
+	}
+	return result;
+}
+
+[[nodiscard]] QImage DeserializeBackground(const QByteArray &bytes) {
+	if (bytes.size() >= kRawBackgroundHeaderSize) {
+		const auto header = reinterpret_cast<const quint32*>(
+			bytes.constData());
+		if (header[0] == kRawBackgroundTag) {
+			const auto width = int(header[1]);
+			const auto height = int(header[2]);
+			const auto perLine = int(header[3]);
+			if (width <= 0
+				|| height <= 0
+				|| int64(width) * height > kBackgroundSizeLimit
+				|| int64(perLine) != int64(width) * 4
+				|| (int64(bytes.size())
+					!= kRawBackgroundHeaderSize + int64(perLine) * height)) {
+				return QImage();
+			}
+			auto result = QImage(
+				width,
+				height,
+				QImage::Format_ARGB32_Premultiplied);
+			if (result.isNull()) {
+				return QImage();
+			}
+			auto from = bytes.constData() + kRawBackgroundHeaderSize;
+			for (auto y = 0; y != height; ++y, from += perLine) {
+				memcpy(result.scanLine(y), from, perLine);
+			}
+			return result;
+		}
+	}
+	auto result = QImage();
+	QDataStream stream(bytes);
+	QImageReader reader(stream.device());
+#ifndef OS_MAC_OLD
+	reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+	return (reader.read(&result) && !result.isNull()) ? result : QImage();
+}
+
 QByteArray readThemeContent(const QString &path) {
 	QFile file(path);
 	if (!file.exists()) {
@@ -326,11 +391,7 @@ bool LoadTheme(
 				Colorize(background, colorizer);
 			}
 			if (cache) {
-				auto buffer = QBuffer(&cache->background);
-				if (!background.save(&buffer, "BMP")) {
-					LOG(("Theme Error: could not write background image as a BMP to cache."));
-					return false;
-				}
+				cache->background = SerializeBackground(background);
 				cache->tiled = backgroundTiled;
 			}
 			applyBackground(std::move(background), backgroundTiled, out);
@@ -361,7 +422,8 @@ bool LoadTheme(
 
 bool InitializeFromCache(
 		const QByteArray &content,
-		const Cached &cache) {
+		const Cached &cache,
+		Instance *out = nullptr) {
 	if (cache.paletteChecksum != style::palette::Checksum()) {
 		return false;
 	}
@@ -369,24 +431,26 @@ bool InitializeFromCache(
 		return false;
 	}
 
-	QImage background;
+	auto background = QImage();
 	if (!cache.background.isEmpty()) {
-		QDataStream stream(cache.background);
-		QImageReader reader(stream.device());
-#ifndef OS_MAC_OLD
-		reader.setAutoTransform(true);
-#endif // OS_MAC_OLD
-		if (!reader.read(&background) || background.isNull()) {
+		background = DeserializeBackground(cache.background);
+		if (background.isNull()) {
 			return false;
 		}
 	}
 
-	if (!style::main_palette::load(cache.colors)) {
-		return false;
+	if (out) {
+		if (!out->palette.load(cache.colors)) {
+			return false;
+		}
+	} else {
+		if (!style::main_palette::load(cache.colors)) {
+			return false;
+		}
+		Background()->saveAdjustableColors();
 	}
-	Background()->saveAdjustableColors();
 	if (!background.isNull()) {
-		applyBackground(std::move(background), cache.tiled, nullptr);
+		applyBackground(std::move(background), cache.tiled, out);
 	}
 
 	return true;
@@ -1073,12 +1137,15 @@ void ChatBackground::reapplyWithNightMode(
 		auto preview = std::make_unique<Preview>();
 		preview->object = std::move(read.object);
 		preview->instance.cached = std::move(read.cache);
-		const auto loaded = LoadTheme(
+		const auto loaded = InitializeFromCache(
 			preview->object.content,
-			ColorizerForTheme(path),
-			std::nullopt,
-			&preview->instance.cached,
-			&preview->instance);
+			preview->instance.cached,
+			&preview->instance) || LoadTheme(
+				preview->object.content,
+				ColorizerForTheme(path),
+				std::nullopt,
+				&preview->instance.cached,
+				&preview->instance);
 		if (!loaded) {
 			return false;
 		}
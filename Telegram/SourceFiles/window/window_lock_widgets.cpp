@@ -145,9 +145,22 @@ void PasscodeLockWidget::submit() {
 	}
 
 	const auto passcode = _passcode->text().toUtf8();
-	const auto correct = window()->account().sessionExists()
-		? Local::checkPasscode(passcode)
-		: (Local::readMap(passcode) != Local::ReadMapPassNeeded);
+	if (window()->account().sessionExists()) {
+		if (_checking) {
+			return;
+		}
+		_checking = true;
+		Local::checkPasscodeAsync(passcode, crl::guard(this, [=](
+				bool correct) {
+			_checking = false;
+			checkDone(correct);
+		}));
+	} else {
+		checkDone(Local::readMap(passcode) != Local::ReadMapPassNeeded);
+	}
+}
+
+void PasscodeLockWidget::checkDone(bool correct) {
 	if (!correct) {
 		cSetPasscodeBadTries(cPasscodeBadTries() + 1);
 		cSetPasscodeLastTry(crl::now());
@@ -221,9 +221,10 @@ QSize MediaPreviewWidget::currentDimensions() const {
 void MediaPreviewWidget::setupLottie() {
 	Expects(_document != nullptr);
 
-	_lottie = std::make_unique<Lottie::SinglePlayer>(
-		Lottie::ReadContent(_document->data(), _document->filepath()),
-		Lottie::FrameRequest{ currentDimensions() * cIntRetinaFactor() },
+	_lottie = Stickers::LottiePlayerFromDocument(
+		_document,
+		Stickers::LottieSize::MediaPreview,
+		currentDimensions() * cIntRetinaFactor(),
 		Lottie::Quality::High);
 
 	_lottie->updates(
@@ -21,6 +21,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_folder.h"
 #include "data/data_channel.h"
 #include "data/data_chat.h"
+#include "data/data_streaming.h"
 #include "passport/passport_form_controller.h"
 #include "chat_helpers/tabbed_selector.h"
 #include "core/shortcuts.h"
@@ -127,6 +128,13 @@ SessionController::SessionController(
 		folder->updateChatListSortPosition();
 		closeFolder();
 	}, lifetime());
+
+	activeChatValue(
+	) | rpl::start_with_next([=](Dialogs::Key key) {
+		const auto peer = key.peer();
+		session->data().streaming().setShownPeer(
+			peer ? peer->id : PeerId(0));
+	}, lifetime());
 }
 
 not_null<::MainWindow*> SessionController::widget() const {
@@ -21,12 +21,16 @@ PRIVATE
     export/data/export_data_types.h
     export/output/export_output_abstract.cpp
     export/output/export_output_abstract.h
+    export/output/export_output_archive.cpp
+    export/output/export_output_archive.h
     export/output/export_output_file.cpp
     export/output/export_output_file.h
     export/output/export_output_html.cpp
     export/output/export_output_html.h
     export/output/export_output_json.cpp
     export/output/export_output_json.h
+    export/output/export_output_manifest.cpp
+    export/output/export_output_manifest.h
     export/output/export_output_result.h
     export/output/export_output_stats.cpp
     export/output/export_output_stats.h
@@ -37,10 +41,13 @@ PRIVATE
 target_include_directories(lib_export
 PUBLIC
     ${src_loc}
+PRIVATE
+    ${third_party_loc}/minizip
 )
 
 target_link_libraries(lib_export
 PUBLIC
     desktop-app::lib_base
+    desktop-app::external_zlib
     tdesktop::lib_scheme
 )
@@ -13,8 +13,12 @@ nice_target_sources(lib_mtproto ${src_loc}
 PRIVATE
     mtproto/details/mtproto_abstract_socket.cpp
     mtproto/details/mtproto_abstract_socket.h
+    mtproto/details/mtproto_aes_ige.cpp
+    mtproto/details/mtproto_aes_ige.h
     mtproto/details/mtproto_bound_key_creator.cpp
     mtproto/details/mtproto_bound_key_creator.h
+    mtproto/details/mtproto_buffer_pool.cpp
+    mtproto/details/mtproto_buffer_pool.h
     mtproto/details/mtproto_dc_key_binder.cpp
     mtproto/details/mtproto_dc_key_binder.h
     mtproto/details/mtproto_dc_key_creator.cpp
@@ -35,6 +39,8 @@ PRIVATE
     mtproto/details/mtproto_tcp_socket.h
     mtproto/details/mtproto_tls_socket.cpp
     mtproto/details/mtproto_tls_socket.h
+    mtproto/details/mtproto_traffic_recorder.cpp
+    mtproto/details/mtproto_traffic_recorder.h
     mtproto/mtproto_auth_key.cpp
     mtproto/mtproto_auth_key.h
     mtproto/mtproto_concurrent_sender.cpp
@@ -45,6 +51,7 @@ PRIVATE
     mtproto/mtproto_proxy_data.h
     mtproto/mtproto_rpc_sender.cpp
     mtproto/mtproto_rpc_sender.h
+    mtproto/mtproto_session_stats.h
 )
 
 target_include_directories(lib_mtproto
@@ -19,6 +19,7 @@
     'variables': {
       'src_loc': '../SourceFiles',
       'res_loc': '../Resources',
+      'minizip_loc': '../ThirdParty/minizip',
       'pch_source': '<(src_loc)/export/export_pch.cpp',
       'pch_header': '<(src_loc)/export/export_pch.h',
     },
@@ -34,6 +35,7 @@
     ],
     'include_dirs': [
       '<(src_loc)',
+      '<(minizip_loc)',
     ],
     'sources': [
       '<(src_loc)/export/export_api_wrap.cpp',
@@ -46,12 +48,16 @@
       '<(src_loc)/export/data/export_data_types.h',
       '<(src_loc)/export/output/export_output_abstract.cpp',
       '<(src_loc)/export/output/export_output_abstract.h',
+      '<(src_loc)/export/output/export_output_archive.cpp',
+      '<(src_loc)/export/output/export_output_archive.h',
       '<(src_loc)/export/output/export_output_file.cpp',
       '<(src_loc)/export/output/export_output_file.h',
       '<(src_loc)/export/output/export_output_html.cpp',
       '<(src_loc)/export/output/export_output_html.h',
       '<(src_loc)/export/output/export_output_json.cpp',
       '<(src_loc)/export/output/export_output_json.h',
+      '<(src_loc)/export/output/export_output_manifest.cpp',
+      '<(src_loc)/export/output/export_output_manifest.h',
       '<(src_loc)/export/output/export_output_result.h',
       '<(src_loc)/export/output/export_output_stats.cpp',
       '<(src_loc)/export/output/export_output_stats.h',
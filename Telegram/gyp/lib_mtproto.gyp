@@ -36,8 +36,12 @@
     'sources': [
       '<(src_loc)/mtproto/details/mtproto_abstract_socket.cpp',
       '<(src_loc)/mtproto/details/mtproto_abstract_socket.h',
+      '<(src_loc)/mtproto/details/mtproto_aes_ige.cpp',
+      '<(src_loc)/mtproto/details/mtproto_aes_ige.h',
       '<(src_loc)/mtproto/details/mtproto_bound_key_creator.cpp',
       '<(src_loc)/mtproto/details/mtproto_bound_key_creator.h',
+      '<(src_loc)/mtproto/details/mtproto_buffer_pool.cpp',
+      '<(src_loc)/mtproto/details/mtproto_buffer_pool.h',
       '<(src_loc)/mtproto/details/mtproto_dc_key_binder.cpp',
       '<(src_loc)/mtproto/details/mtproto_dc_key_binder.h',
       '<(src_loc)/mtproto/details/mtproto_dc_key_creator.cpp',
@@ -58,6 +62,8 @@
       '<(src_loc)/mtproto/details/mtproto_tcp_socket.h',
       '<(src_loc)/mtproto/details/mtproto_tls_socket.cpp',
       '<(src_loc)/mtproto/details/mtproto_tls_socket.h',
+      '<(src_loc)/mtproto/details/mtproto_traffic_recorder.cpp',
+      '<(src_loc)/mtproto/details/mtproto_traffic_recorder.h',
       '<(src_loc)/mtproto/mtproto_auth_key.cpp',
       '<(src_loc)/mtproto/mtproto_auth_key.h',
       '<(src_loc)/mtproto/mtproto_concurrent_sender.cpp',
@@ -68,6 +74,7 @@
       '<(src_loc)/mtproto/mtproto_proxy_data.h',
       '<(src_loc)/mtproto/mtproto_rpc_sender.cpp',
       '<(src_loc)/mtproto/mtproto_rpc_sender.h',
+      '<(src_loc)/mtproto/mtproto_session_stats.h',
     ],
   }],
 }
@@ -27,6 +27,7 @@
     ],
     'dependencies': [
       '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
+      'lib_lz4.gyp:lib_lz4',
     ],
     'export_dependent_settings': [
       '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
@@ -59,6 +60,8 @@
       '<(src_loc)/storage/cache/storage_cache_database.h',
       '<(src_loc)/storage/cache/storage_cache_database_object.cpp',
       '<(src_loc)/storage/cache/storage_cache_database_object.h',
+      '<(src_loc)/storage/cache/storage_cache_frequency_sketch.cpp',
+      '<(src_loc)/storage/cache/storage_cache_frequency_sketch.h',
       '<(src_loc)/storage/cache/storage_cache_types.cpp',
       '<(src_loc)/storage/cache/storage_cache_types.h',
     ],
@@ -144,5 +144,179 @@
         '<(linux_lib_crypto)',
       ],
     }]],
+  }, {
+    'target_name': 'benchmark_storage',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+      '../helpers/modules/openssl.gypi',
+    ],
+    'dependencies': [
+      '../lib_storage.gyp:lib_storage',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/storage/cache/storage_cache_database_benchmark.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }], [ 'build_linux', {
+      'libraries': [
+        '<(linux_lib_ssl)',
+        '<(linux_lib_crypto)',
+      ],
+    }]],
+  }, {
+    'target_name': 'benchmark_dialogs',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+      '../helpers/modules/pch.gypi',
+    ],
+    'variables': {
+      'pch_source': '<(src_loc)/storage/storage_pch.cpp',
+      'pch_header': '<(src_loc)/storage/storage_pch.h',
+    },
+    'dependencies': [
+      '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/dialogs/dialogs_list_benchmark.cpp',
+      '<(src_loc)/dialogs/dialogs_list_order.h',
+      '<(src_loc)/dialogs/dialogs_word_index.h',
+    ],
+  }, {
+    'target_name': 'benchmark_history_text',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+      '../helpers/modules/pch.gypi',
+    ],
+    'variables': {
+      'pch_source': '<(src_loc)/storage/storage_pch.cpp',
+      'pch_header': '<(src_loc)/storage/storage_pch.h',
+    },
+    'dependencies': [
+      '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
+      '<(submodules_loc)/lib_ui/lib_ui.gyp:lib_ui',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/history/view/history_view_text_benchmark.cpp',
+    ],
+  }, {
+    'target_name': 'benchmark_images',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+      '../helpers/modules/pch.gypi',
+    ],
+    'variables': {
+      'pch_source': '<(src_loc)/storage/storage_pch.cpp',
+      'pch_header': '<(src_loc)/storage/storage_pch.h',
+    },
+    'dependencies': [
+      '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
+      '<(submodules_loc)/lib_ui/lib_ui.gyp:lib_ui',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/ui/image/image_prepare_benchmark.cpp',
+    ],
+  }, {
+    'target_name': 'benchmark_streaming',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+      '../helpers/modules/openssl.gypi',
+      '../helpers/modules/pch.gypi',
+    ],
+    'variables': {
+      'pch_source': '<(src_loc)/storage/storage_pch.cpp',
+      'pch_header': '<(src_loc)/storage/storage_pch.h',
+    },
+    'dependencies': [
+      '../lib_storage.gyp:lib_storage',
+      '<(submodules_loc)/lib_ui/lib_ui.gyp:lib_ui',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/media/streaming/media_streaming_error.h',
+      '<(src_loc)/media/streaming/media_streaming_loader.cpp',
+      '<(src_loc)/media/streaming/media_streaming_loader.h',
+      '<(src_loc)/media/streaming/media_streaming_reader.cpp',
+      '<(src_loc)/media/streaming/media_streaming_reader.h',
+      '<(src_loc)/media/streaming/media_streaming_reader_benchmark.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }], [ 'build_linux', {
+      'libraries': [
+        '<(linux_lib_ssl)',
+        '<(linux_lib_crypto)',
+      ],
+    }]],
+  }, {
+    'target_name': 'benchmark_mtproto_aes',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+      '../helpers/modules/openssl.gypi',
+    ],
+    'dependencies': [
+      '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/mtproto/details/mtproto_aes_ige.cpp',
+      '<(src_loc)/mtproto/details/mtproto_aes_ige.h',
+      '<(src_loc)/mtproto/details/mtproto_aes_ige_benchmark.cpp',
+    ],
+    'conditions': [[ 'build_linux', {
+      'libraries': [
+        '<(linux_lib_crypto)',
+      ],
+    }]],
+  }, {
+    'target_name': 'benchmark_mtproto_received_ids',
+    'includes': [
+      '../helpers/common/executable.gypi',
+      '../helpers/modules/qt.gypi',
+    ],
+    'dependencies': [
+      '<(submodules_loc)/lib_base/lib_base.gyp:lib_base',
+      '<(submodules_loc)/lib_tl/lib_tl.gyp:lib_tl',
+    ],
+    'include_dirs': [
+      '<(src_loc)',
+    ],
+    'sources': [
+      '<(src_loc)/mtproto/details/mtproto_received_ids_benchmark.cpp',
+      '<(src_loc)/mtproto/details/mtproto_received_ids_manager.cpp',
+      '<(src_loc)/mtproto/details/mtproto_received_ids_manager.h',
+    ],
   }],
 }